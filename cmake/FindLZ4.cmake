@@ -0,0 +1,54 @@
+# Find shared library version of LZ4
+if(NOT LZ4_SHARED_LIBRARY)
+  find_path(LZ4_SHARED_INCLUDE_DIR "lz4.h")
+  find_library(LZ4_SHARED_LIBRARY_DEBUG
+    NAMES
+      lz4_d
+      lz4
+    PATH_SUFFIXES
+      lib
+  )
+  find_library(LZ4_SHARED_LIBRARY_RELEASE
+    NAMES
+      lz4
+    PATH_SUFFIXES
+      lib
+  )
+  set(LZ4_SHARED_LIBRARY
+    debug ${LZ4_SHARED_LIBRARY_DEBUG}
+    optimized ${LZ4_SHARED_LIBRARY_RELEASE}
+  )
+endif()
+
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4_SHARED REQUIRED_VARS
+  LZ4_SHARED_LIBRARY LZ4_SHARED_INCLUDE_DIR)
+
+mark_as_advanced(LZ4_SHARED_INCLUDE_DIRS)
+mark_as_advanced(LZ4_SHARED_LIBRARIES)
+
+if(LZ4_SHARED_FOUND)
+  set(LZ4_SHARED_INCLUDE_DIRS ${LZ4_SHARED_INCLUDE_DIR})
+  set(LZ4_SHARED_LIBRARIES ${LZ4_SHARED_LIBRARY})
+
+  if(NOT TARGET LZ4::shared)
+    add_library(LZ4::shared UNKNOWN IMPORTED)
+    set_target_properties(LZ4::shared PROPERTIES
+      INTERFACE_INCLUDE_DIRECTORIES "${LZ4_SHARED_INCLUDE_DIRS}")
+
+    set_property(TARGET LZ4::shared APPEND PROPERTY
+      IMPORTED_CONFIGURATIONS RELEASE)
+    set_property(TARGET LZ4::shared APPEND PROPERTY
+      IMPORTED_CONFIGURATIONS DEBUG)
+
+    if(LZ4_SHARED_LIBRARY_DEBUG AND LZ4_SHARED_LIBRARY_RELEASE)
+      set_target_properties(LZ4::shared PROPERTIES
+        IMPORTED_LOCATION_DEBUG "${LZ4_SHARED_LIBRARY_DEBUG}"
+        IMPORTED_LOCATION_RELEASE "${LZ4_SHARED_LIBRARY_RELEASE}"
+      )
+    else()
+      set_target_properties(LZ4::shared PROPERTIES
+        IMPORTED_LOCATION "${LZ4_SHARED_LIBRARY_RELEASE}"
+      )
+    endif()
+  endif()
+endif()
@@ -6,6 +6,9 @@
 #include <tuple>
 #include "shift/core/core.hpp"
 #include "shift/core/types.hpp"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #if defined min
 #undef min
@@ -107,6 +110,49 @@ make_array(const Ts&... values) noexcept
 /// Counts the number of 1-bits in value.
 std::uint32_t hamming_weight(std::uint32_t value);
 
+/// Returns the index of the least significant 1-bit in value.
+/// @remarks
+///   This is defined inline because it is used in the inner loops of
+///   core::hash_table and core::object_pool.
+/// @pre
+///   value must not be zero.
+inline std::uint32_t count_trailing_zeros(std::uint32_t value)
+{
+  BOOST_ASSERT(value != 0);
+#if defined(__GNUC__)
+  return static_cast<std::uint32_t>(__builtin_ctz(value));
+#elif defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return static_cast<std::uint32_t>(index);
+#else
+  std::uint32_t result = 0;
+  for (; (value & 1u) == 0u; value >>= 1)
+    ++result;
+  return result;
+#endif
+}
+
+/// Returns the index of the least significant 1-bit in value.
+/// @pre
+///   value must not be zero.
+inline std::uint32_t count_trailing_zeros(std::uint64_t value)
+{
+  BOOST_ASSERT(value != 0);
+#if defined(__GNUC__)
+  return static_cast<std::uint32_t>(__builtin_ctzll(value));
+#elif defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<std::uint32_t>(index);
+#else
+  std::uint32_t result = 0;
+  for (; (value & 1u) == 0u; value >>= 1)
+    ++result;
+  return result;
+#endif
+}
+
 /// Accesses an std::array using an enumeration key.
 template <typename T, std::size_t N, typename Enum>
 constexpr auto& at(std::array<T, N>& array, Enum key)
@@ -0,0 +1,151 @@
+#ifndef SHIFT_CORE_CONCURRENT_OBJECT_POOL_HPP
+#define SHIFT_CORE_CONCURRENT_OBJECT_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "shift/core/object_pool.hpp"
+
+namespace shift::core
+{
+/// A thread-safe object pool, which puts a small thread-local cache of free
+/// slots in front of a shared, mutex protected object_pool_storage.
+/// @remarks
+///   Most create and destroy calls are served from the calling thread's
+///   cache without any synchronization. The cache is only refilled or
+///   drained in batches. Each thread caches slots of a single pool per type
+///   at a time; switching between pools of the same type returns all cached
+///   slots to their previous pool.
+/// @remarks
+///   Unlike object_pool, all objects must be destroyed before the pool
+///   itself is destroyed.
+template <typename T,
+          std::size_t N = std::numeric_limits<unsigned long long>::digits>
+class concurrent_object_pool
+{
+public:
+  /// The maximum number of free slots cached per thread.
+  static constexpr std::size_t cache_size = 64;
+
+  /// Constructor.
+  concurrent_object_pool() : _shared(std::make_shared<shared_storage>())
+  {
+  }
+
+  concurrent_object_pool(const concurrent_object_pool&) = delete;
+  concurrent_object_pool(concurrent_object_pool&&) = delete;
+
+  /// Destructor.
+  ~concurrent_object_pool() = default;
+
+  concurrent_object_pool& operator=(const concurrent_object_pool&) = delete;
+  concurrent_object_pool& operator=(concurrent_object_pool&&) = delete;
+
+  /// Create a new object from the pool.
+  template <typename... Args>
+  T* create(Args&&... args);
+
+  /// Destroy an object previously allocated using create(). The object may
+  /// have been created by any thread.
+  void destroy(T* object) noexcept;
+
+private:
+  struct shared_storage
+  {
+    std::uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    std::mutex mutex;
+    detail::object_pool_storage<T, N> storage;
+  };
+
+  struct thread_cache
+  {
+    /// Destructor returning all cached slots to their pool.
+    ~thread_cache()
+    {
+      flush(count);
+    }
+
+    /// Returns the passed number of cached slots to their pool, if it still
+    /// exists.
+    void flush(std::size_t flush_count) noexcept
+    {
+      if (flush_count == 0)
+        return;
+      if (auto owner = shared.lock())
+      {
+        std::lock_guard lock(owner->mutex);
+        for (std::size_t i = 0; i < flush_count; ++i)
+          owner->storage.deallocate(slots[--count]);
+      }
+      else
+        count -= flush_count;
+    }
+
+    std::weak_ptr<shared_storage> shared;
+    std::uint64_t id = 0;
+    std::size_t count = 0;
+    T* slots[cache_size];
+  };
+
+  /// Returns the calling thread's cache, bound to this pool.
+  thread_cache& local_cache() noexcept
+  {
+    auto& cache = _cache;
+    if (cache.id != _shared->id)
+    {
+      cache.flush(cache.count);
+      cache.shared = _shared;
+      cache.id = _shared->id;
+    }
+    return cache;
+  }
+
+  static inline std::atomic<std::uint64_t> next_id = ATOMIC_VAR_INIT(1);
+  static inline thread_local thread_cache _cache;
+  std::shared_ptr<shared_storage> _shared;
+};
+
+template <typename T, std::size_t N>
+template <typename... Args>
+T* concurrent_object_pool<T, N>::create(Args&&... args)
+{
+  auto& cache = local_cache();
+  if (cache.count == 0)
+  {
+    // Refill half of the cache at once.
+    std::lock_guard lock(_shared->mutex);
+    while (cache.count < cache_size / 2)
+      cache.slots[cache.count++] = _shared->storage.allocate();
+  }
+  T* object = cache.slots[--cache.count];
+  try
+  {
+    new (object) T(std::forward<Args>(args)...);
+  }
+  catch (...)
+  {
+    cache.slots[cache.count++] = object;
+    throw;
+  }
+  return object;
+}
+
+template <typename T, std::size_t N>
+void concurrent_object_pool<T, N>::destroy(T* object) noexcept
+{
+  if (!object)
+    return;
+  object->~T();
+  auto& cache = local_cache();
+  if (cache.count == cache_size)
+  {
+    // Return half of the cache at once.
+    cache.flush(cache_size / 2);
+  }
+  cache.slots[cache.count++] = object;
+}
+}
+
+#endif
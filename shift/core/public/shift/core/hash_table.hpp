@@ -1,59 +1,1054 @@
 #ifndef SHIFT_CORE_HASH_TABLE_HPP
 #define SHIFT_CORE_HASH_TABLE_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
 #include <tuple>
-#include <vector>
+#include <type_traits>
+#include <utility>
 #include <shift/platform/assert.hpp>
+#include "shift/core/algorithm.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHIFT_CORE_HASH_TABLE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__ARM_ARCH_ISA_A64)
+#define SHIFT_CORE_HASH_TABLE_NEON
+#include <arm_neon.h>
+#endif
 
 namespace shift::core
 {
-/// A simple hash table.
-template <typename Key, typename Value, class KeyCompare = std::equal_to<Key>,
-          class Hash = std::hash<Key>>
+namespace detail
+{
+  /// The control byte value of an empty slot. Full slots store the lower
+  /// seven bits of their key's hash value.
+  static constexpr std::int8_t control_empty = -128;
+
+  /// Mixes the bits of a hash value, because many std::hash implementations
+  /// return integer keys unchanged.
+  inline std::size_t mix_hash(std::size_t hash) noexcept
+  {
+    auto mixed = static_cast<std::uint64_t>(hash) * 0x9e3779b97f4a7c15ull;
+    return static_cast<std::size_t>(mixed ^ (mixed >> 32));
+  }
+
+  /// Returns the part of a hash value used to select the first slot to probe.
+  inline std::size_t hash_position(std::size_t hash) noexcept
+  {
+    return hash >> 7;
+  }
+
+  /// Returns the part of a hash value stored in a slot's control byte.
+  inline std::int8_t hash_control(std::size_t hash) noexcept
+  {
+    return static_cast<std::int8_t>(hash & 0x7f);
+  }
+
+  /// A set of matching slots within a control_group. Each slot is
+  /// represented by a single bit at position (index << Shift).
+  template <typename T, int Shift>
+  class group_mask
+  {
+  public:
+    ///
+    explicit group_mask(T mask) noexcept : _mask(mask)
+    {
+    }
+
+    ///
+    explicit operator bool() const noexcept
+    {
+      return _mask != 0;
+    }
+
+    /// Returns the index of the first matching slot.
+    /// @pre
+    ///   The mask is not empty.
+    std::size_t lowest() const noexcept
+    {
+      return count_trailing_zeros(_mask) >> Shift;
+    }
+
+    /// Removes the first matching slot from the mask.
+    void clear_lowest() noexcept
+    {
+      _mask &= _mask - 1;
+    }
+
+  private:
+    T _mask;
+  };
+
+#if defined(SHIFT_CORE_HASH_TABLE_SSE2)
+  /// A group of 16 control bytes which are matched at once using SSE2.
+  class control_group
+  {
+  public:
+    static constexpr std::size_t width = 16;
+    using mask_t = group_mask<std::uint32_t, 0>;
+
+    ///
+    explicit control_group(const std::int8_t* control) noexcept
+    : _control(_mm_loadu_si128(reinterpret_cast<const __m128i*>(control)))
+    {
+    }
+
+    /// Returns all slots whose control byte equals value.
+    mask_t match(std::int8_t value) const noexcept
+    {
+      return mask_t{static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(value), _control)))};
+    }
+
+    /// Returns all empty slots.
+    mask_t match_empty() const noexcept
+    {
+      // Only empty control bytes have their sign bit set.
+      return mask_t{static_cast<std::uint32_t>(_mm_movemask_epi8(_control))};
+    }
+
+  private:
+    __m128i _control;
+  };
+#elif defined(SHIFT_CORE_HASH_TABLE_NEON)
+  /// A group of 8 control bytes which are matched at once using NEON.
+  class control_group
+  {
+  public:
+    static constexpr std::size_t width = 8;
+    using mask_t = group_mask<std::uint64_t, 3>;
+
+    ///
+    explicit control_group(const std::int8_t* control) noexcept
+    : _control(vld1_s8(control))
+    {
+    }
+
+    /// Returns all slots whose control byte equals value.
+    mask_t match(std::int8_t value) const noexcept
+    {
+      return mask_t{
+        vget_lane_u64(vreinterpret_u64_u8(vceq_s8(vdup_n_s8(value), _control)),
+                      0) &
+        0x8080808080808080ull};
+    }
+
+    /// Returns all empty slots.
+    mask_t match_empty() const noexcept
+    {
+      return mask_t{vget_lane_u64(vreinterpret_u64_s8(_control), 0) &
+                    0x8080808080808080ull};
+    }
+
+  private:
+    int8x8_t _control;
+  };
+#else
+  /// A group of 8 control bytes which are matched at once using 64 bit
+  /// integer arithmetic.
+  class control_group
+  {
+  public:
+    static constexpr std::size_t width = 8;
+    using mask_t = group_mask<std::uint64_t, 3>;
+
+    ///
+    explicit control_group(const std::int8_t* control) noexcept
+    {
+      for (std::size_t i = 0; i < width; ++i)
+      {
+        _control |= static_cast<std::uint64_t>(
+                      static_cast<std::uint8_t>(control[i]))
+                    << (i * 8);
+      }
+    }
+
+    /// Returns all slots whose control byte equals value.
+    /// @remarks
+    ///   The result may contain false positives, which are sorted out by the
+    ///   following key comparison.
+    mask_t match(std::int8_t value) const noexcept
+    {
+      auto x = _control ^ (lsbs * static_cast<std::uint8_t>(value));
+      return mask_t{(x - lsbs) & ~x & msbs};
+    }
+
+    /// Returns all empty slots.
+    mask_t match_empty() const noexcept
+    {
+      return mask_t{_control & msbs};
+    }
+
+  private:
+    static constexpr std::uint64_t lsbs = 0x0101010101010101ull;
+    static constexpr std::uint64_t msbs = 0x8080808080808080ull;
+
+    std::uint64_t _control = 0;
+  };
+#endif
+
+  template <typename T, typename = void>
+  struct is_transparent : std::false_type
+  {
+  };
+
+  template <typename T>
+  struct is_transparent<T, std::void_t<typename T::is_transparent>>
+  : std::true_type
+  {
+  };
+
+  /// Selects the key type accepted by lookup functions.
+  template <bool Transparent>
+  struct key_arg
+  {
+    template <typename K, typename Key>
+    using type = Key;
+  };
+
+  template <>
+  struct key_arg<true>
+  {
+    template <typename K, typename Key>
+    using type = K;
+  };
+}
+
+/// An open addressing hash map, which stores all elements in a single flat
+/// array of slots.
+/// @remarks
+///   Each slot has an associated control byte, which is either empty or
+///   holds seven bits of the key's hash value. Lookups compare a whole group
+///   of control bytes at once using SSE2 or NEON, and only compare keys of
+///   slots with matching control bytes. Slots are probed linearly, which
+///   allows erasing elements by shifting subsequent elements backwards
+///   instead of leaving tombstones. Thus lookups never slow down after many
+///   erase operations.
+/// @remarks
+///   Unlike std::unordered_map, inserting elements invalidates all iterators
+///   and references, and erasing an element invalidates iterators and
+///   references to all elements, except for the iterator returned by erase.
+///   Key and Value should be nothrow move constructible, because elements
+///   are moved when the table grows.
+/// @remarks
+///   If both Hash and KeyEqual define a type is_transparent, lookup functions
+///   accept any type comparable to Key without converting it first.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
 class hash_table
 {
+  // Using a nested alias instead of std::conditional_t keeps K deducible.
+  template <typename K>
+  using key_arg = typename detail::key_arg<
+    detail::is_transparent<Hash>::value &&
+    detail::is_transparent<KeyEqual>::value>::template type<K, Key>;
+
 public:
-  using entry_t = std::pair<Key, Value>;
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<const Key, Value>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
 
-  /// Initializes the hash table with next_power_of_two(size) elements.
-  hash_table(std::size_t size, const Hash& key_hash = Hash{},
-             const KeyCompare& key_compare = KeyCompare{})
-  : _key_hash(key_hash), _key_compare(key_compare)
+  /// The number of control bytes compared at once.
+  static constexpr std::size_t group_width = detail::control_group::width;
+
+  /// A forward iterator over all elements of the table.
+  template <bool Const>
+  class basic_iterator
   {
-    _table.resize(math::next_power_of_two(size));
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = hash_table::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+    using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+    /// Default constructor.
+    basic_iterator() noexcept = default;
+
+    /// Converts an iterator to a const_iterator.
+    template <bool OtherConst,
+              typename = std::enable_if_t<Const && !OtherConst>>
+    basic_iterator(const basic_iterator<OtherConst>& other) noexcept
+    : _table(other._table), _origin(other._origin), _position(other._position)
+    {
+    }
+
+    ///
+    reference operator*() const noexcept
+    {
+      return _table->_slots[index()];
+    }
+
+    ///
+    pointer operator->() const noexcept
+    {
+      return &_table->_slots[index()];
+    }
+
+    ///
+    basic_iterator& operator++() noexcept
+    {
+      ++_position;
+      skip_empty();
+      return *this;
+    }
+
+    ///
+    basic_iterator operator++(int) noexcept
+    {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    ///
+    bool operator==(const basic_iterator& other) const noexcept
+    {
+      if (_position == end_position() || other._position == end_position())
+        return _position == other._position;
+      return index() == other.index();
+    }
+
+    ///
+    bool operator!=(const basic_iterator& other) const noexcept
+    {
+      return !(*this == other);
+    }
+
+  private:
+    friend class hash_table;
+    template <bool>
+    friend class basic_iterator;
+
+    /// Constructs an iterator which visits slots starting at index origin.
+    basic_iterator(const hash_table* table, std::size_t origin,
+                   std::size_t position) noexcept
+    : _table(table), _origin(origin), _position(position)
+    {
+    }
+
+    std::size_t end_position() const noexcept
+    {
+      return _table != nullptr ? _table->_capacity : 0;
+    }
+
+    std::size_t index() const noexcept
+    {
+      return (_origin + _position) & (_table->_capacity - 1);
+    }
+
+    void skip_empty() noexcept
+    {
+      while (_position != _table->_capacity &&
+             _table->_control[index()] == detail::control_empty)
+      {
+        ++_position;
+      }
+    }
+
+    const hash_table* _table = nullptr;
+    /// The slot index where iteration started.
+    std::size_t _origin = 0;
+    /// The number of slots visited since origin.
+    std::size_t _position = 0;
+  };
+
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  /// Default constructor, which does not allocate any memory.
+  hash_table() noexcept(std::is_nothrow_default_constructible_v<Hash>&&
+                          std::is_nothrow_default_constructible_v<KeyEqual>) =
+    default;
+
+  /// Constructs an empty table with room for at least size elements.
+  explicit hash_table(std::size_t size, const Hash& hash = Hash{},
+                      const KeyEqual& key_equal = KeyEqual{})
+  : _hash(hash), _key_equal(key_equal)
+  {
+    reserve(size);
   }
 
-  /// Lookup
-  std::pair<bool, Value*> operator[](const Key& key) noexcept
+  /// Constructs a table from a list of elements.
+  hash_table(std::initializer_list<value_type> values)
   {
-    std::size_t hash = _key_hash(key);
-    std::size_t hash_mask = _table.size() - 1;
-    std::size_t bucket = hash & hash_mask;
+    insert(values);
+  }
+
+  /// Copy constructor.
+  hash_table(const hash_table& other);
+
+  /// Move constructor.
+  hash_table(hash_table&& other) noexcept
+  : _slots(std::exchange(other._slots, nullptr)),
+    _control(std::exchange(other._control, nullptr)),
+    _capacity(std::exchange(other._capacity, 0)),
+    _size(std::exchange(other._size, 0)),
+    _hash(std::move(other._hash)),
+    _key_equal(std::move(other._key_equal))
+  {
+  }
+
+  /// Destructor.
+  ~hash_table()
+  {
+    destroy_all();
+    deallocate();
+  }
+
+  /// Copy assignment operator.
+  hash_table& operator=(const hash_table& other)
+  {
+    if (this != &other)
+    {
+      hash_table copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
 
-    for (std::size_t i = 0; i < hash_mask; ++i)
+  /// Move assignment operator.
+  hash_table& operator=(hash_table&& other) noexcept
+  {
+    if (this != &other)
     {
-      auto& item = _table[bucket];
-      if (!item.first)
+      hash_table moved(std::move(other));
+      swap(moved);
+    }
+    return *this;
+  }
+
+  ///
+  iterator begin() noexcept
+  {
+    return make_begin<iterator>();
+  }
+
+  ///
+  const_iterator begin() const noexcept
+  {
+    return make_begin<const_iterator>();
+  }
+
+  ///
+  const_iterator cbegin() const noexcept
+  {
+    return begin();
+  }
+
+  ///
+  iterator end() noexcept
+  {
+    return iterator{this, 0, _capacity};
+  }
+
+  ///
+  const_iterator end() const noexcept
+  {
+    return const_iterator{this, 0, _capacity};
+  }
+
+  ///
+  const_iterator cend() const noexcept
+  {
+    return end();
+  }
+
+  /// Returns whether the table contains no elements.
+  bool empty() const noexcept
+  {
+    return _size == 0;
+  }
+
+  /// Returns the number of elements.
+  std::size_t size() const noexcept
+  {
+    return _size;
+  }
+
+  /// Returns the number of slots.
+  std::size_t bucket_count() const noexcept
+  {
+    return _capacity;
+  }
+
+  /// Returns the ratio between the number of elements and slots.
+  float load_factor() const noexcept
+  {
+    return _capacity != 0 ? static_cast<float>(_size) / _capacity : 0.0f;
+  }
+
+  /// Returns the load factor at which the table grows.
+  static constexpr float max_load_factor() noexcept
+  {
+    return 0.75f;
+  }
+
+  ///
+  hasher hash_function() const
+  {
+    return _hash;
+  }
+
+  ///
+  key_equal key_eq() const
+  {
+    return _key_equal;
+  }
+
+  /// Destroys all elements, but keeps the allocated memory.
+  void clear() noexcept;
+
+  /// Makes room for at least size elements without growing again.
+  void reserve(std::size_t size);
+
+  /// Changes the number of slots to at least slot_count, but not less than
+  /// what is needed for the current number of elements. Passing zero to an
+  /// empty table releases all memory.
+  void rehash(std::size_t slot_count);
+
+  /// Inserts a copy of value if there is no element with an equivalent key.
+  std::pair<iterator, bool> insert(const value_type& value)
+  {
+    return try_emplace_impl(value.first, value.second);
+  }
+
+  /// Inserts an element constructed from value if there is no element with
+  /// an equivalent key.
+  template <typename P, typename = std::enable_if_t<
+                          std::is_constructible_v<value_type, P&&>>>
+  std::pair<iterator, bool> insert(P&& value)
+  {
+    return emplace(std::forward<P>(value));
+  }
+
+  /// Inserts all elements of the range [first, last).
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last)
+  {
+    for (; first != last; ++first)
+      emplace(*first);
+  }
+
+  /// Inserts all elements of the list.
+  void insert(std::initializer_list<value_type> values)
+  {
+    reserve(_size + values.size());
+    insert(values.begin(), values.end());
+  }
+
+  /// Inserts value at key, or assigns it to the existing element.
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+  {
+    return insert_or_assign_impl(key, std::forward<M>(value));
+  }
+
+  /// @see insert_or_assign(const key_type&, M&&).
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+  {
+    return insert_or_assign_impl(std::move(key), std::forward<M>(value));
+  }
+
+  /// Constructs an element from the arguments if there is no element with an
+  /// equivalent key.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args)
+  {
+    std::pair<Key, Value> value(std::forward<Args>(args)...);
+    return try_emplace_impl(std::move(value.first), std::move(value.second));
+  }
+
+  /// Constructs a value from the arguments if there is no element with an
+  /// equivalent key. Otherwise the arguments are left untouched.
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+  {
+    return try_emplace_impl(key, std::forward<Args>(args)...);
+  }
+
+  /// @see try_emplace(const key_type&, Args&&...).
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+  {
+    return try_emplace_impl(std::move(key), std::forward<Args>(args)...);
+  }
+
+  /// Returns the value at key, inserting a default constructed one if there
+  /// is none.
+  Value& operator[](const key_type& key)
+  {
+    return try_emplace_impl(key).first->second;
+  }
+
+  /// @see operator[](const key_type&).
+  Value& operator[](key_type&& key)
+  {
+    return try_emplace_impl(std::move(key)).first->second;
+  }
+
+  /// Returns the value at key.
+  /// @throws std::out_of_range
+  ///   There is no element with the passed key.
+  template <typename K = key_type>
+  Value& at(const key_arg<K>& key)
+  {
+    auto iter = find(key);
+    if (iter == end())
+      throw std::out_of_range("hash_table::at");
+    return iter->second;
+  }
+
+  /// @see at(const key_arg<K>&).
+  template <typename K = key_type>
+  const Value& at(const key_arg<K>& key) const
+  {
+    auto iter = find(key);
+    if (iter == end())
+      throw std::out_of_range("hash_table::at");
+    return iter->second;
+  }
+
+  /// Returns an iterator to the element with the passed key, or end() if
+  /// there is none.
+  template <typename K = key_type>
+  iterator find(const key_arg<K>& key)
+  {
+    if (_size == 0)
+      return end();
+    auto [index, found] = find_slot(key, hash_of(key));
+    return found ? iterator{this, 0, index} : end();
+  }
+
+  /// @see find(const key_arg<K>&).
+  template <typename K = key_type>
+  const_iterator find(const key_arg<K>& key) const
+  {
+    if (_size == 0)
+      return end();
+    auto [index, found] = find_slot(key, hash_of(key));
+    return found ? const_iterator{this, 0, index} : end();
+  }
+
+  /// Returns whether there is an element with the passed key.
+  template <typename K = key_type>
+  bool contains(const key_arg<K>& key) const
+  {
+    return _size != 0 && find_slot(key, hash_of(key)).second;
+  }
+
+  /// Returns the number of elements with the passed key, which is either
+  /// zero or one.
+  template <typename K = key_type>
+  std::size_t count(const key_arg<K>& key) const
+  {
+    return contains(key) ? 1 : 0;
+  }
+
+  /// Erases the element pointed to by position.
+  /// @return
+  ///   An iterator to the element following the erased one. Iterating a
+  ///   table from begin() while erasing elements visits each element
+  ///   exactly once.
+  iterator erase(const_iterator position) noexcept
+  {
+    BOOST_ASSERT(position._table == this && position != end());
+    erase_at(position.index());
+    iterator next{this, position._origin, position._position};
+    next.skip_empty();
+    return next;
+  }
+
+  /// @see erase(const_iterator).
+  iterator erase(iterator position) noexcept
+  {
+    return erase(const_iterator{position});
+  }
+
+  /// Erases the element with the passed key if there is one.
+  /// @return
+  ///   The number of erased elements, which is either zero or one.
+  template <typename K = key_type>
+  std::size_t erase(const key_arg<K>& key)
+  {
+    if (_size == 0)
+      return 0;
+    auto [index, found] = find_slot(key, hash_of(key));
+    if (!found)
+      return 0;
+    erase_at(index);
+    return 1;
+  }
+
+  /// Exchanges the contents of two tables.
+  void swap(hash_table& other) noexcept
+  {
+    using std::swap;
+    swap(_slots, other._slots);
+    swap(_control, other._control);
+    swap(_capacity, other._capacity);
+    swap(_size, other._size);
+    swap(_hash, other._hash);
+    swap(_key_equal, other._key_equal);
+  }
+
+private:
+  /// Returns the number of slots needed to store size elements.
+  static std::size_t capacity_for(std::size_t size) noexcept
+  {
+    std::size_t capacity = group_width;
+    while (capacity / 4 * 3 < size)
+      capacity <<= 1;
+    return capacity;
+  }
+
+  /// Returns the maximum number of elements before the table needs to grow.
+  std::size_t growth_limit() const noexcept
+  {
+    return _capacity / 4 * 3;
+  }
+
+  template <typename K>
+  std::size_t hash_of(const K& key) const
+  {
+    return detail::mix_hash(_hash(key));
+  }
+
+  template <typename Iterator>
+  Iterator make_begin() const noexcept
+  {
+    if (_size == 0)
+      return Iterator{this, 0, _capacity};
+    // Start iterating at an empty slot. Erasing elements only moves
+    // subsequent elements of the same cluster backwards, so no element
+    // is moved across the origin while iterating.
+    std::size_t origin = 0;
+    for (;; origin += group_width)
+    {
+      if (auto empty = detail::control_group{_control + origin}.match_empty())
       {
-        item.first = key;
-        return std::make_pair(true, &item.second);
+        origin += empty.lowest();
+        break;
       }
-      if (_key_compare(item.first, key))
-        return std::make_pair(false, &item.second);
-      // Handle hash collision.
-      bucket = (bucket + i + 1) & hash_mask;
     }
+    Iterator result{this, origin & (_capacity - 1), 0};
+    result.skip_empty();
+    return result;
+  }
 
-    // Hash table is full.
-    BOOST_ASSERT(false);
-    return std::make_pair(false, nullptr);
+  /// Looks up the slot holding key.
+  /// @return
+  ///   The slot index and true if the key was found, or the index of the
+  ///   slot where the key is to be inserted and false if not.
+  /// @pre
+  ///   The table has at least one slot.
+  template <typename K>
+  std::pair<std::size_t, bool> find_slot(const K& key, std::size_t hash) const
+  {
+    auto mask = _capacity - 1;
+    auto control = detail::hash_control(hash);
+    for (auto position = detail::hash_position(hash) & mask;;
+         position = (position + group_width) & mask)
+    {
+      detail::control_group group{_control + position};
+      for (auto match = group.match(control); match; match.clear_lowest())
+      {
+        auto index = (position + match.lowest()) & mask;
+        if (_key_equal(_slots[index].first, key))
+          return {index, true};
+      }
+      // Elements are never stored behind an empty slot of their probe
+      // sequence, so the key is not in the table.
+      if (auto empty = group.match_empty())
+        return {(position + empty.lowest()) & mask, false};
+    }
   }
 
-private:
-  std::vector<entry_t> _table;
-  Hash _key_hash;
-  KeyCompare _key_compare;
+  /// Returns the first empty slot of the probe sequence.
+  std::size_t find_empty(std::size_t hash) const noexcept
+  {
+    auto mask = _capacity - 1;
+    for (auto position = detail::hash_position(hash) & mask;;
+         position = (position + group_width) & mask)
+    {
+      if (auto empty = detail::control_group{_control + position}.match_empty())
+        return (position + empty.lowest()) & mask;
+    }
+  }
+
+  /// Looks up key and makes sure there is an empty slot to insert it.
+  /// @return
+  ///   The slot index and whether the key is to be inserted there.
+  template <typename K>
+  std::pair<std::size_t, bool> prepare_insert(const K& key, std::size_t hash)
+  {
+    if (_capacity != 0)
+    {
+      auto [index, found] = find_slot(key, hash);
+      if (found)
+        return {index, false};
+      if (_size < growth_limit())
+        return {index, true};
+    }
+    resize(_capacity != 0 ? _capacity * 2 : group_width);
+    return {find_empty(hash), true};
+  }
+
+  /// Constructs a new element in the empty slot index.
+  template <typename... Args>
+  void construct_at(std::size_t index, std::size_t hash, Args&&... args)
+  {
+    new (&_slots[index]) value_type(std::forward<Args>(args)...);
+    set_control(index, detail::hash_control(hash));
+    ++_size;
+  }
+
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+  {
+    auto hash = hash_of(key);
+    auto [index, insert] = prepare_insert(key, hash);
+    if (insert)
+    {
+      construct_at(index, hash, std::piecewise_construct,
+                   std::forward_as_tuple(std::forward<K>(key)),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    return {iterator{this, 0, index}, insert};
+  }
+
+  template <typename K, typename M>
+  std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& value)
+  {
+    auto hash = hash_of(key);
+    auto [index, insert] = prepare_insert(key, hash);
+    if (insert)
+      construct_at(index, hash, std::forward<K>(key), std::forward<M>(value));
+    else
+      _slots[index].second = std::forward<M>(value);
+    return {iterator{this, 0, index}, insert};
+  }
+
+  /// Sets a control byte and its clone behind the end of the table, which
+  /// allows loading groups at the end of the table without wrapping around.
+  void set_control(std::size_t index, std::int8_t value) noexcept
+  {
+    _control[index] = value;
+    if (index < group_width - 1)
+      _control[_capacity + index] = value;
+  }
+
+  /// Moves an element to an empty slot.
+  void relocate(std::size_t target, std::size_t source) noexcept
+  {
+    auto& source_value = _slots[source];
+    // The key is going to be destroyed right after being moved from.
+    new (&_slots[target])
+      value_type(std::move(const_cast<Key&>(source_value.first)),
+                 std::move(source_value.second));
+    source_value.~value_type();
+  }
+
+  /// Destroys the element at index and closes the gap by shifting
+  /// subsequent elements of the same cluster backwards.
+  void erase_at(std::size_t index) noexcept;
+
+  /// Moves all elements into a new array of the passed number of slots.
+  void resize(std::size_t capacity);
+
+  /// Allocates memory for the passed number of slots and marks all of them
+  /// as empty.
+  void allocate(std::size_t capacity);
+
+  void deallocate() noexcept;
+
+  void destroy_all() noexcept;
+
+  value_type* _slots = nullptr;
+  std::int8_t* _control = nullptr;
+  std::size_t _capacity = 0;
+  std::size_t _size = 0;
+  Hash _hash;
+  KeyEqual _key_equal;
 };
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+hash_table<Key, Value, Hash, KeyEqual>::hash_table(const hash_table& other)
+: _hash(other._hash), _key_equal(other._key_equal)
+{
+  if (other._size == 0)
+    return;
+  allocate(other._capacity);
+  // Copy elements to the same slots, which keeps all probe sequences intact.
+  std::size_t index = 0;
+  try
+  {
+    for (; index < _capacity; ++index)
+    {
+      if (other._control[index] != detail::control_empty)
+        new (&_slots[index]) value_type(other._slots[index]);
+    }
+  }
+  catch (...)
+  {
+    while (index-- > 0)
+    {
+      if (other._control[index] != detail::control_empty)
+        _slots[index].~value_type();
+    }
+    deallocate();
+    throw;
+  }
+  std::memcpy(_control, other._control, _capacity + group_width - 1);
+  _size = other._size;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::clear() noexcept
+{
+  if (_size == 0)
+    return;
+  destroy_all();
+  std::memset(_control, static_cast<std::uint8_t>(detail::control_empty),
+              _capacity + group_width - 1);
+  _size = 0;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::reserve(std::size_t size)
+{
+  if (size > growth_limit())
+    resize(capacity_for(size));
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::rehash(std::size_t slot_count)
+{
+  if (slot_count == 0 && _size == 0)
+  {
+    deallocate();
+    return;
+  }
+  auto capacity = capacity_for(_size);
+  while (capacity < slot_count)
+    capacity <<= 1;
+  if (capacity != _capacity)
+    resize(capacity);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::erase_at(
+  std::size_t index) noexcept
+{
+  _slots[index].~value_type();
+  --_size;
+
+  auto mask = _capacity - 1;
+  auto gap = index;
+  for (auto next = (gap + 1) & mask; _control[next] != detail::control_empty;
+       next = (next + 1) & mask)
+  {
+    // The element may fill the gap if the gap lies within the range from its
+    // ideal slot to its current one.
+    auto ideal = detail::hash_position(hash_of(_slots[next].first)) & mask;
+    if (((next - ideal) & mask) >= ((next - gap) & mask))
+    {
+      relocate(gap, next);
+      set_control(gap, _control[next]);
+      gap = next;
+    }
+  }
+  set_control(gap, detail::control_empty);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::resize(std::size_t capacity)
+{
+  BOOST_ASSERT(capacity >= group_width && (capacity & (capacity - 1)) == 0);
+  auto* old_slots = _slots;
+  auto* old_control = _control;
+  auto old_capacity = _capacity;
+
+  allocate(capacity);
+  for (std::size_t index = 0; index < old_capacity; ++index)
+  {
+    if (old_control[index] == detail::control_empty)
+      continue;
+    auto& value = old_slots[index];
+    auto target = find_empty(hash_of(value.first));
+    new (&_slots[target]) value_type(std::move(const_cast<Key&>(value.first)),
+                                     std::move(value.second));
+    value.~value_type();
+    set_control(target, old_control[index]);
+  }
+  if (old_slots != nullptr)
+    ::operator delete(old_slots, std::align_val_t{alignof(value_type)});
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::allocate(std::size_t capacity)
+{
+  // Slots and control bytes share a single allocation.
+  auto* memory = static_cast<std::byte*>(
+    ::operator new(capacity * sizeof(value_type) + capacity + group_width - 1,
+                   std::align_val_t{alignof(value_type)}));
+  _slots = reinterpret_cast<value_type*>(memory);
+  _control =
+    reinterpret_cast<std::int8_t*>(memory + capacity * sizeof(value_type));
+  _capacity = capacity;
+  std::memset(_control, static_cast<std::uint8_t>(detail::control_empty),
+              capacity + group_width - 1);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::deallocate() noexcept
+{
+  if (_slots != nullptr)
+  {
+    ::operator delete(_slots, std::align_val_t{alignof(value_type)});
+    _slots = nullptr;
+    _control = nullptr;
+    _capacity = 0;
+  }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void hash_table<Key, Value, Hash, KeyEqual>::destroy_all() noexcept
+{
+  if constexpr (!std::is_trivially_destructible_v<value_type>)
+  {
+    for (std::size_t index = 0; index < _capacity && _size != 0; ++index)
+    {
+      if (_control[index] != detail::control_empty)
+        _slots[index].~value_type();
+    }
+  }
+}
+
+/// Exchanges the contents of two tables.
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void swap(hash_table<Key, Value, Hash, KeyEqual>& lhs,
+          hash_table<Key, Value, Hash, KeyEqual>& rhs) noexcept
+{
+  lhs.swap(rhs);
+}
 }
 
 #endif
@@ -1,30 +1,290 @@
 #ifndef SHIFT_CORE_OBJECTPOOL_HPP
 #define SHIFT_CORE_OBJECTPOOL_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <limits>
-#include <memory>
-#include <bitset>
-#include <list>
-#include <stack>
+#include <new>
+#include <type_traits>
 #include <shift/platform/assert.hpp>
 #include "shift/core/exception.hpp"
+#include "shift/core/algorithm.hpp"
 
 namespace shift::core
 {
+namespace detail
+{
+  /// Returns the smallest power of two not less than value.
+  constexpr std::size_t ceil_power_of_two(std::size_t value)
+  {
+    std::size_t result = 1;
+    while (result < value)
+      result <<= 1;
+    return result;
+  }
+
+  /// Manages raw memory for objects of type T in chunks of N objects.
+  /// @remarks
+  ///   Chunks are aligned to their own size, so the chunk header of any
+  ///   object is found by masking the object's address. Each chunk keeps an
+  ///   intrusive list of free slots, and chunks with free slots are kept in
+  ///   an intrusive list, too. Thus both allocate and deallocate run in
+  ///   constant time. Chunk memory is only released when the storage is
+  ///   destroyed.
+  template <typename T, std::size_t N>
+  class object_pool_storage
+  {
+  public:
+    static_assert(N > 0,
+                  "object_pool requires at least one object per memory chunk.");
+
+    /// Constructor.
+    object_pool_storage() noexcept = default;
+
+    object_pool_storage(const object_pool_storage&) = delete;
+    object_pool_storage(object_pool_storage&&) = delete;
+
+    /// Destructor releasing all memory without destroying any object.
+    ~object_pool_storage();
+
+    object_pool_storage& operator=(const object_pool_storage&) = delete;
+    object_pool_storage& operator=(object_pool_storage&&) = delete;
+
+    /// Returns uninitialized memory for a single object.
+    T* allocate();
+
+    /// Returns memory previously obtained from allocate().
+    void deallocate(T* object) noexcept;
+
+    /// Calls visitor for each allocated object.
+    template <typename Visitor>
+    void for_each_allocated(Visitor&& visitor);
+
+    /// Marks all memory as free, without destroying any object.
+    void reset() noexcept;
+
+    /// Returns the number of allocated objects.
+    std::size_t size() const noexcept
+    {
+      return _size;
+    }
+
+  private:
+    union slot {
+      slot* next_free;
+      std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+    };
+
+    static constexpr std::size_t bits_per_word = 64;
+    static constexpr std::size_t word_count =
+      (N + bits_per_word - 1) / bits_per_word;
+
+    struct chunk_header
+    {
+      object_pool_storage* owner;
+      /// Links all chunks of this storage.
+      chunk_header* next_chunk;
+      /// Links chunks with free slots, or empty chunks.
+      chunk_header* previous_available;
+      chunk_header* next_available;
+      /// Previously used slots which are free again.
+      slot* free_slots;
+      /// The slots starting at this index have never been used.
+      std::size_t untouched;
+      std::size_t used_count;
+      std::uint64_t used[word_count];
+    };
+
+    static constexpr std::size_t slots_offset =
+      (sizeof(chunk_header) + alignof(slot) - 1) / alignof(slot) *
+      alignof(slot);
+    static constexpr std::size_t chunk_size =
+      ceil_power_of_two(slots_offset + N * sizeof(slot));
+
+    static slot* slots(chunk_header* chunk) noexcept
+    {
+      return reinterpret_cast<slot*>(reinterpret_cast<std::byte*>(chunk) +
+                                     slots_offset);
+    }
+
+    static chunk_header* chunk_of(const void* object) noexcept
+    {
+      return reinterpret_cast<chunk_header*>(
+        reinterpret_cast<std::uintptr_t>(object) & ~(chunk_size - 1));
+    }
+
+    void link_available(chunk_header* chunk) noexcept;
+    void unlink_available(chunk_header* chunk) noexcept;
+
+    std::size_t _size = 0;
+    chunk_header* _chunks = nullptr;
+    chunk_header* _available_chunks = nullptr;
+    chunk_header* _empty_chunks = nullptr;
+  };
+
+  template <typename T, std::size_t N>
+  object_pool_storage<T, N>::~object_pool_storage()
+  {
+    while (_chunks != nullptr)
+    {
+      auto* chunk = _chunks;
+      _chunks = chunk->next_chunk;
+      ::operator delete(chunk, std::align_val_t{chunk_size});
+    }
+  }
+
+  template <typename T, std::size_t N>
+  T* object_pool_storage<T, N>::allocate()
+  {
+    auto* chunk = _available_chunks;
+    if (chunk == nullptr)
+    {
+      if (_empty_chunks != nullptr)
+      {
+        chunk = _empty_chunks;
+        _empty_chunks = chunk->next_available;
+      }
+      else
+      {
+        chunk = static_cast<chunk_header*>(
+          ::operator new(chunk_size, std::align_val_t{chunk_size}));
+        chunk->owner = this;
+        chunk->next_chunk = _chunks;
+        chunk->free_slots = nullptr;
+        chunk->untouched = 0;
+        chunk->used_count = 0;
+        for (auto& word : chunk->used)
+          word = 0;
+        _chunks = chunk;
+      }
+      link_available(chunk);
+    }
+
+    slot* free_slot;
+    if (chunk->free_slots != nullptr)
+    {
+      free_slot = chunk->free_slots;
+      chunk->free_slots = free_slot->next_free;
+    }
+    else
+      free_slot = slots(chunk) + chunk->untouched++;
+    auto index = static_cast<std::size_t>(free_slot - slots(chunk));
+    chunk->used[index / bits_per_word] |= std::uint64_t{1}
+                                          << (index % bits_per_word);
+    if (++chunk->used_count == N)
+      unlink_available(chunk);
+    ++_size;
+    return reinterpret_cast<T*>(free_slot);
+  }
+
+  template <typename T, std::size_t N>
+  void object_pool_storage<T, N>::deallocate(T* object) noexcept
+  {
+    auto* chunk = chunk_of(object);
+    // The passed object doesn't seem to be allocated from this pool.
+    BOOST_ASSERT(chunk->owner == this);
+    auto* used_slot = reinterpret_cast<slot*>(object);
+    auto index = static_cast<std::size_t>(used_slot - slots(chunk));
+    auto mask = std::uint64_t{1} << (index % bits_per_word);
+    BOOST_ASSERT(chunk->used[index / bits_per_word] & mask);
+    chunk->used[index / bits_per_word] &= ~mask;
+    used_slot->next_free = chunk->free_slots;
+    chunk->free_slots = used_slot;
+
+    if (chunk->used_count-- == N)
+      link_available(chunk);
+    if (chunk->used_count == 0)
+    {
+      // Move the chunk to the list of empty chunks, so that allocations
+      // prefer partially used chunks.
+      unlink_available(chunk);
+      chunk->next_available = _empty_chunks;
+      _empty_chunks = chunk;
+    }
+    --_size;
+  }
+
+  template <typename T, std::size_t N>
+  template <typename Visitor>
+  void object_pool_storage<T, N>::for_each_allocated(Visitor&& visitor)
+  {
+    for (auto* chunk = _chunks; chunk != nullptr; chunk = chunk->next_chunk)
+    {
+      for (std::size_t word_index = 0; word_index < word_count; ++word_index)
+      {
+        for (auto word = chunk->used[word_index]; word != 0;
+             word &= word - 1)
+        {
+          auto index = word_index * bits_per_word + count_trailing_zeros(word);
+          visitor(reinterpret_cast<T*>(slots(chunk) + index));
+        }
+      }
+    }
+  }
+
+  template <typename T, std::size_t N>
+  void object_pool_storage<T, N>::reset() noexcept
+  {
+    _available_chunks = nullptr;
+    _empty_chunks = nullptr;
+    for (auto* chunk = _chunks; chunk != nullptr; chunk = chunk->next_chunk)
+    {
+      chunk->free_slots = nullptr;
+      chunk->untouched = 0;
+      chunk->used_count = 0;
+      for (auto& word : chunk->used)
+        word = 0;
+      chunk->next_available = _empty_chunks;
+      _empty_chunks = chunk;
+    }
+    _size = 0;
+  }
+
+  template <typename T, std::size_t N>
+  void object_pool_storage<T, N>::link_available(chunk_header* chunk) noexcept
+  {
+    chunk->previous_available = nullptr;
+    chunk->next_available = _available_chunks;
+    if (_available_chunks != nullptr)
+      _available_chunks->previous_available = chunk;
+    _available_chunks = chunk;
+  }
+
+  template <typename T, std::size_t N>
+  void object_pool_storage<T, N>::unlink_available(
+    chunk_header* chunk) noexcept
+  {
+    if (chunk->previous_available != nullptr)
+      chunk->previous_available->next_available = chunk->next_available;
+    else
+      _available_chunks = chunk->next_available;
+    if (chunk->next_available != nullptr)
+      chunk->next_available->previous_available = chunk->previous_available;
+  }
+}
+
 /// The object pool allocates chunks of memory large enough to hold N
 /// instances at once, and manages allocation and deallocation.
+/// @remarks
+///   Creating and destroying objects takes constant time. The pool is not
+///   thread-safe, see concurrent_object_pool for a thread-safe alternative.
 template <typename T,
           std::size_t N = std::numeric_limits<unsigned long long>::digits>
 class object_pool
 {
 public:
-  static_assert(N > 0,
-                "object_pool requires at least one object per memory chunk.");
+  /// Constructor.
+  object_pool() noexcept = default;
+
+  object_pool(const object_pool&) = delete;
+  object_pool(object_pool&&) = delete;
 
-public:
   /// Destructor destroying any object that has not been destroyed, yet.
   ~object_pool();
 
+  object_pool& operator=(const object_pool&) = delete;
+  object_pool& operator=(object_pool&&) = delete;
+
   /// Create a new object from the pool.
   template <typename... Args>
   T* create(Args&&... args);
@@ -35,23 +295,14 @@ public:
   /// Frees all remaining objects at once.
   void clear();
 
-private:
-  struct memory_chunk
+  /// Returns the number of objects alive.
+  std::size_t size() const noexcept
   {
-    std::aligned_storage_t<sizeof(T), alignof(T)> objects[N];
-    std::bitset<N> used;
-  };
-
-  /// Allocate memory for a new object of type T.
-  T* alloc();
-
-  /// Free memory previously allocated using alloc().
-  void free(T* object);
+    return _storage.size();
+  }
 
-  std::size_t _size = 0;
-  std::size_t _capacity = 0;
-  std::list<std::unique_ptr<memory_chunk>> _used_chunks;
-  std::stack<std::unique_ptr<memory_chunk>> _empty_chunks;
+private:
+  detail::object_pool_storage<T, N> _storage;
 };
 
 template <typename T, std::size_t N>
@@ -64,16 +315,14 @@ template <typename T, std::size_t N>
 template <typename... Args>
 T* object_pool<T, N>::create(Args&&... args)
 {
-  T* object = alloc();
-  if (!object)
-    BOOST_THROW_EXCEPTION(core::out_of_memory());
+  T* object = _storage.allocate();
   try
   {
     new (object) T(std::forward<Args>(args)...);
   }
   catch (...)
   {
-    free(object);
+    _storage.deallocate(object);
     throw;
   }
   return object;
@@ -85,108 +334,15 @@ void object_pool<T, N>::destroy(T* object) noexcept
   if (object)
   {
     object->~T();
-    free(object);
+    _storage.deallocate(object);
   }
 }
 
 template <typename T, std::size_t N>
 void object_pool<T, N>::clear()
 {
-  for (auto used_chunk_iter = _used_chunks.begin();
-       used_chunk_iter != _used_chunks.end(); ++used_chunk_iter)
-  {
-    auto& chunk = *used_chunk_iter;
-    for (std::size_t index = 0, count = chunk->used.count();
-         index < N && count > 0; ++index)
-    {
-      if (chunk->used.test(index))
-      {
-        reinterpret_cast<T*>(chunk->objects + index)->~T();
-        --count;
-      }
-    }
-    chunk->used.reset();
-    _empty_chunks.push(std::move(chunk));
-  }
-  _used_chunks.clear();
-}
-
-template <typename T, std::size_t N>
-T* object_pool<T, N>::alloc()
-{
-  memory_chunk* free_chunk = nullptr;
-  if (_size >= _capacity)
-  {
-    if (_empty_chunks.empty())
-    {
-      // Create a new chunk.
-      auto new_chunk = std::make_unique<memory_chunk>();
-      free_chunk = new_chunk.get();
-      _used_chunks.emplace_back(std::move(new_chunk));
-    }
-    else
-    {
-      // Reuse an existing free chunk.
-      auto new_chunk = std::move(_empty_chunks.top());
-      _empty_chunks.pop();
-      free_chunk = new_chunk.get();
-      _used_chunks.emplace_back(std::move(new_chunk));
-    }
-    _capacity += N;
-    BOOST_ASSERT(_size < _capacity);
-  }
-  std::size_t index = 0;
-  if (!free_chunk)
-  {
-    for (auto& used_chunk : _used_chunks)
-    {
-      if (!used_chunk->used.all())
-      {
-        free_chunk = used_chunk.get();
-        break;
-      }
-    }
-    BOOST_ASSERT(free_chunk);
-    if (!free_chunk)
-      return nullptr;
-    while (index < N && free_chunk->used.test(index))
-      ++index;
-    BOOST_ASSERT(index < N);
-  }
-
-  free_chunk->used.set(index);
-  ++_size;
-  return reinterpret_cast<T*>(free_chunk->objects + index);
-}
-
-template <typename T, std::size_t N>
-void object_pool<T, N>::free(T* object)
-{
-  for (auto used_chunk_iter = _used_chunks.begin();
-       used_chunk_iter != _used_chunks.end(); ++used_chunk_iter)
-  {
-    auto& used_chunk = *used_chunk_iter;
-    if (object >= reinterpret_cast<T*>(used_chunk->objects) &&
-        object < reinterpret_cast<T*>(used_chunk->objects + N))
-    {
-      auto index = (reinterpret_cast<std::size_t>(object) -
-                    reinterpret_cast<std::size_t>(used_chunk->objects)) /
-                   sizeof(std::aligned_storage_t<sizeof(T), alignof(T)>);
-      BOOST_ASSERT(used_chunk->used.test(index));
-      used_chunk->used.reset(index);
-      if (used_chunk->used.none())
-      {
-        _empty_chunks.push(std::move(used_chunk));
-        _used_chunks.erase(used_chunk_iter);
-        _capacity -= N;
-      }
-      --_size;
-      return;
-    }
-  }
-
-  // The passed object doesn't seem to be allocated from this pool.
-  BOOST_ASSERT(false);
+  _storage.for_each_allocated([](T* object) { object->~T(); });
+  _storage.reset();
 }
 }
 
@@ -66,6 +66,17 @@ BOOST_AUTO_TEST_CASE(algorithm_hamming_weight)
   BOOST_CHECK_EQUAL(hamming_weight(0b1111'1111), 8);
 }
 
+BOOST_AUTO_TEST_CASE(algorithm_count_trailing_zeros)
+{
+  BOOST_CHECK_EQUAL(count_trailing_zeros(std::uint32_t{0b0000'0001}), 0);
+  BOOST_CHECK_EQUAL(count_trailing_zeros(std::uint32_t{0b1000'0000}), 7);
+  BOOST_CHECK_EQUAL(count_trailing_zeros(std::uint32_t{0b0101'1000}), 3);
+  BOOST_CHECK_EQUAL(count_trailing_zeros(std::uint32_t{0x80000000u}), 31);
+  BOOST_CHECK_EQUAL(count_trailing_zeros(std::uint64_t{1}), 0);
+  BOOST_CHECK_EQUAL(count_trailing_zeros(std::uint64_t{1} << 40), 40);
+  BOOST_CHECK_EQUAL(count_trailing_zeros(std::uint64_t{1} << 63), 63);
+}
+
 BOOST_AUTO_TEST_CASE(algorithm_at)
 {
   enum class at_test
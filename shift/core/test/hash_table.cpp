@@ -0,0 +1,273 @@
+#include "probe.hpp"
+#include <shift/core/hash_table.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace shift::core;
+
+namespace
+{
+/// A transparent string hash allowing lookups using std::string_view.
+struct string_hash
+{
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view value) const
+  {
+    return std::hash<std::string_view>{}(value);
+  }
+};
+
+/// A hash function mapping all keys to the same value.
+struct collision_hash
+{
+  std::size_t operator()(int /*value*/) const
+  {
+    return 42;
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE(hash_table_zero_keys)
+{
+  // Both 0 and an empty string used to be treated as unused slots.
+  hash_table<int, int> numbers;
+  BOOST_CHECK(numbers.find(0) == numbers.end());
+  numbers[0] = 1;
+  numbers[1] = 2;
+  BOOST_CHECK_EQUAL(numbers.size(), 2u);
+  BOOST_CHECK_EQUAL(numbers.at(0), 1);
+  BOOST_CHECK(!numbers.try_emplace(0, 3).second);
+  BOOST_CHECK_EQUAL(numbers.at(0), 1);
+
+  hash_table<std::string, int> strings;
+  strings[""] = 1;
+  BOOST_CHECK(strings.contains(""));
+  BOOST_CHECK_EQUAL(strings.at(""), 1);
+  BOOST_CHECK_THROW(strings.at("missing"), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(hash_table_grow)
+{
+  hash_table<std::uint64_t, std::uint64_t> table;
+  BOOST_CHECK_EQUAL(table.bucket_count(), 0u);
+  constexpr std::uint64_t count = 100000;
+  for (std::uint64_t i = 0; i < count; ++i)
+    BOOST_CHECK(table.insert({i, i * 2}).second);
+  BOOST_CHECK_EQUAL(table.size(), count);
+  BOOST_CHECK_LE(table.load_factor(), table.max_load_factor());
+  for (std::uint64_t i = 0; i < count; ++i)
+  {
+    auto iter = table.find(i);
+    BOOST_REQUIRE(iter != table.end());
+    BOOST_CHECK_EQUAL(iter->second, i * 2);
+  }
+  BOOST_CHECK(table.find(count) == table.end());
+
+  std::size_t visited = 0;
+  for (const auto& [key, value] : table)
+  {
+    BOOST_CHECK_EQUAL(value, key * 2);
+    ++visited;
+  }
+  BOOST_CHECK_EQUAL(visited, count);
+
+  table.clear();
+  BOOST_CHECK(table.empty());
+  BOOST_CHECK(table.begin() == table.end());
+  table.rehash(0);
+  BOOST_CHECK_EQUAL(table.bucket_count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(hash_table_erase)
+{
+  // Compare a long sequence of random operations to std::unordered_map. The
+  // small key range causes lots of collisions and long clusters.
+  hash_table<int, int> table;
+  std::unordered_map<int, int> reference;
+  std::mt19937 random{42};
+  std::uniform_int_distribution<int> key_distribution(0, 2000);
+  for (int i = 0; i < 200000; ++i)
+  {
+    auto key = key_distribution(random);
+    if (random() % 2 == 0)
+    {
+      table.insert_or_assign(key, i);
+      reference.insert_or_assign(key, i);
+    }
+    else
+      BOOST_CHECK_EQUAL(table.erase(key), reference.erase(key));
+  }
+  BOOST_CHECK_EQUAL(table.size(), reference.size());
+  for (const auto& [key, value] : reference)
+  {
+    auto iter = table.find(key);
+    BOOST_REQUIRE(iter != table.end());
+    BOOST_CHECK_EQUAL(iter->second, value);
+  }
+
+  // Erasing all keys leaves only empty slots, which would not be the case
+  // with tombstones.
+  for (int key = 0; key <= 2000; ++key)
+    table.erase(key);
+  BOOST_CHECK(table.empty());
+  BOOST_CHECK(table.begin() == table.end());
+}
+
+BOOST_AUTO_TEST_CASE(hash_table_erase_while_iterating)
+{
+  // All keys collide, so erasing elements shifts all subsequent ones.
+  hash_table<int, int, collision_hash> table;
+  for (int i = 0; i < 40; ++i)
+    table[i] = i;
+
+  std::vector<int> visits(40, 0);
+  for (auto iter = table.begin(); iter != table.end();)
+  {
+    ++visits[iter->first];
+    if (iter->first % 3 != 0)
+      iter = table.erase(iter);
+    else
+      ++iter;
+  }
+  for (auto visit_count : visits)
+    BOOST_CHECK_EQUAL(visit_count, 1);
+  BOOST_CHECK_EQUAL(table.size(), 14u);
+  for (int i = 0; i < 40; ++i)
+    BOOST_CHECK_EQUAL(table.contains(i), i % 3 == 0);
+}
+
+BOOST_AUTO_TEST_CASE(hash_table_heterogeneous_lookup)
+{
+  hash_table<std::string, int, string_hash, std::equal_to<>> table;
+  table.emplace("first", 1);
+  table.emplace(std::string("second"), 2);
+  std::string_view key = "second";
+  BOOST_CHECK(table.find(key) != table.end());
+  BOOST_CHECK_EQUAL(table.at(key), 2);
+  BOOST_CHECK(table.contains("first"));
+  BOOST_CHECK_EQUAL(table.erase(std::string_view{"first"}), 1u);
+  BOOST_CHECK_EQUAL(table.count("first"), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(hash_table_object_lifetime)
+{
+  using probe_t = probe<std::int32_t>;
+  {
+    hash_table<int, probe_t> table;
+    for (int i = 0; i < 1000; ++i)
+      table.try_emplace(i, i);
+    BOOST_CHECK_EQUAL(probe_t::counter(), 1000);
+    for (int i = 0; i < 1000; i += 2)
+      table.erase(i);
+    BOOST_CHECK_EQUAL(probe_t::counter(), 500);
+
+    auto copy = table;
+    BOOST_CHECK_EQUAL(probe_t::counter(), 1000);
+    BOOST_CHECK_EQUAL(copy.at(1).value(), 1);
+    auto moved = std::move(copy);
+    BOOST_CHECK_EQUAL(probe_t::counter(), 1000);
+    BOOST_CHECK_EQUAL(moved.size(), 500u);
+    moved.clear();
+    BOOST_CHECK_EQUAL(probe_t::counter(), 500);
+
+    hash_table<int, std::unique_ptr<int>> pointers;
+    for (int i = 0; i < 100; ++i)
+      pointers.emplace(i, std::make_unique<int>(i));
+    BOOST_CHECK_EQUAL(*pointers.at(99), 99);
+  }
+  BOOST_CHECK_EQUAL(probe_t::counter(), 0);
+}
+
+namespace
+{
+/// Inserts all keys, and looks them up again in the order of lookup_keys.
+/// @remarks
+///   Looking up keys in the order they were inserted favors node based maps,
+///   whose nodes are then visited in the order they were allocated.
+template <typename Table>
+void benchmark_table(const char* name, const std::vector<std::uint64_t>& keys,
+                     const std::vector<std::uint64_t>& lookup_keys,
+                     const std::vector<std::uint64_t>& missing_keys)
+{
+  auto print = [&](const char* operation, nanoseconds duration) {
+    std::cout << "    " << name << operation << std::fixed
+              << std::setprecision(1)
+              << (static_cast<double>(duration.count()) / keys.size())
+              << " ns/op" << std::endl;
+  };
+
+  Table table;
+  auto begin = high_resolution_clock::now();
+  for (auto key : keys)
+    table.emplace(key, 1);
+  print("insert:      ", high_resolution_clock::now() - begin);
+
+  std::uint64_t sum = 0;
+  begin = high_resolution_clock::now();
+  for (auto key : lookup_keys)
+    sum += table.find(key)->second;
+  print("lookup hit:  ", high_resolution_clock::now() - begin);
+
+  begin = high_resolution_clock::now();
+  for (auto key : missing_keys)
+    sum += table.count(key);
+  print("lookup miss: ", high_resolution_clock::now() - begin);
+
+  begin = high_resolution_clock::now();
+  for (auto key : keys)
+    sum += table.erase(key);
+  print("erase:       ", high_resolution_clock::now() - begin);
+  BOOST_CHECK_EQUAL(sum, 2 * keys.size());
+}
+}
+
+/// Compares hash_table to std::unordered_map.
+BOOST_AUTO_TEST_CASE(hash_table_benchmark)
+{
+  std::mt19937_64 random{42};
+  for (std::size_t count = 1000; count <= 10000000; count *= 10)
+  {
+    // Sequential keys 0..count-1 are the best case for libstdc++, which
+    // hashes integers with the identity function. Random keys resemble
+    // resource ids, which are digests of the resource contents. Both are
+    // inserted in shuffled order, and looked up in a different order.
+    std::vector<std::uint64_t> sequential_keys(count);
+    std::vector<std::uint64_t> random_keys(count);
+    std::vector<std::uint64_t> missing_keys(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      sequential_keys[i] = i;
+      random_keys[i] = random() | 1u;
+      missing_keys[i] = (count + (random() >> 1)) & ~std::uint64_t{1};
+    }
+    std::shuffle(sequential_keys.begin(), sequential_keys.end(), random);
+
+    for (const auto* keys : {&sequential_keys, &random_keys})
+    {
+      auto lookup_keys = *keys;
+      std::shuffle(lookup_keys.begin(), lookup_keys.end(), random);
+
+      std::cout << "hash_table benchmark (" << count
+                << (keys == &sequential_keys ? " sequential" : " random")
+                << " keys):" << std::endl;
+      benchmark_table<std::unordered_map<std::uint64_t, std::uint64_t>>(
+        "unordered_map ", *keys, lookup_keys, missing_keys);
+      benchmark_table<hash_table<std::uint64_t, std::uint64_t>>(
+        "hash_table    ", *keys, lookup_keys, missing_keys);
+    }
+  }
+}
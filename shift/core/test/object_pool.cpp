@@ -0,0 +1,229 @@
+#include "probe.hpp"
+#include <shift/core/object_pool.hpp>
+#include <shift/core/concurrent_object_pool.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <thread>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace shift::core;
+using probe_t = probe<std::int32_t>;
+
+BOOST_AUTO_TEST_CASE(object_pool_create_destroy)
+{
+  {
+    object_pool<probe_t, 4> pool;
+    std::vector<probe_t*> objects;
+    for (std::int32_t i = 0; i < 10; ++i)
+      objects.push_back(pool.create(i));
+    BOOST_CHECK_EQUAL(probe_t::counter(), 10);
+    for (std::int32_t i = 0; i < 10; ++i)
+      BOOST_CHECK_EQUAL(objects[i]->value(), i);
+
+    for (std::size_t i = 0; i < objects.size(); i += 2)
+      pool.destroy(objects[i]);
+    BOOST_CHECK_EQUAL(probe_t::counter(), 5);
+
+    // Freed slots get reused.
+    for (std::size_t i = 0; i < objects.size(); i += 2)
+      objects[i] = pool.create(static_cast<std::int32_t>(i) + 100);
+    for (std::size_t i = 0; i < objects.size(); ++i)
+    {
+      BOOST_CHECK_EQUAL(objects[i]->value(),
+                        static_cast<std::int32_t>(i % 2 == 0 ? i + 100 : i));
+    }
+  }
+  // The pool destroys any remaining objects.
+  BOOST_CHECK_EQUAL(probe_t::counter(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(object_pool_clear)
+{
+  object_pool<probe_t, 8> pool;
+  for (std::int32_t i = 0; i < 100; ++i)
+    pool.create(i);
+  BOOST_CHECK_EQUAL(probe_t::counter(), 100);
+  pool.clear();
+  BOOST_CHECK_EQUAL(probe_t::counter(), 0);
+  for (std::int32_t i = 0; i < 100; ++i)
+    pool.create(i);
+  BOOST_CHECK_EQUAL(probe_t::counter(), 100);
+  pool.clear();
+  BOOST_CHECK_EQUAL(probe_t::counter(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_object_pool_threads)
+{
+  constexpr std::size_t num_threads = 4;
+  constexpr std::int32_t num_objects = 10000;
+  {
+    concurrent_object_pool<probe_t, 16> pool;
+    std::vector<std::vector<probe_t*>> objects(num_threads);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t)
+    {
+      threads.emplace_back([&, t]() {
+        for (std::int32_t i = 0; i < num_objects; ++i)
+          objects[t].push_back(pool.create(i));
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    threads.clear();
+    BOOST_CHECK_EQUAL(probe_t::counter(), num_threads * num_objects);
+
+    // Destroy objects on a different thread than the one creating them.
+    for (std::size_t t = 0; t < num_threads; ++t)
+    {
+      threads.emplace_back([&, t]() {
+        auto& thread_objects = objects[(t + 1) % num_threads];
+        for (std::int32_t i = 0; i < num_objects; ++i)
+        {
+          BOOST_CHECK_EQUAL(thread_objects[i]->value(), i);
+          pool.destroy(thread_objects[i]);
+        }
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    BOOST_CHECK_EQUAL(probe_t::counter(), 0);
+  }
+
+  // Use a second pool of the same type on this thread.
+  concurrent_object_pool<probe_t, 16> other_pool;
+  auto* object = other_pool.create(42);
+  BOOST_CHECK_EQUAL(object->value(), 42);
+  other_pool.destroy(object);
+}
+
+namespace
+{
+struct payload
+{
+  std::uint64_t data[8];
+};
+
+/// Runs a churn pattern on a set of live objects using the passed allocation
+/// functions and returns the time taken.
+template <typename Create, typename Destroy>
+nanoseconds churn(int pattern, std::size_t live_objects, std::size_t operations,
+                  Create create, Destroy destroy)
+{
+  std::vector<payload*> objects;
+  objects.reserve(live_objects);
+  std::mt19937 random{42};
+  std::uniform_int_distribution<std::size_t> index_distribution(
+    0, live_objects - 1);
+
+  auto begin = high_resolution_clock::now();
+  for (std::size_t round = 0; round < operations / live_objects; ++round)
+  {
+    if (pattern == 0)
+    {
+      // LIFO: Allocate a batch of objects and free it in reverse order.
+      for (std::size_t i = 0; i < live_objects; ++i)
+        objects.push_back(create());
+      while (!objects.empty())
+      {
+        destroy(objects.back());
+        objects.pop_back();
+      }
+    }
+    else if (pattern == 1)
+    {
+      // FIFO: Allocate a batch of objects and free it in the same order.
+      for (std::size_t i = 0; i < live_objects; ++i)
+        objects.push_back(create());
+      for (auto* object : objects)
+        destroy(object);
+      objects.clear();
+    }
+    else
+    {
+      // Random: Keep a set of objects alive and replace random ones.
+      if (objects.empty())
+      {
+        for (std::size_t i = 0; i < live_objects; ++i)
+          objects.push_back(create());
+      }
+      for (std::size_t i = 0; i < live_objects; ++i)
+      {
+        auto& object = objects[index_distribution(random)];
+        destroy(object);
+        object = create();
+      }
+    }
+  }
+  for (auto* object : objects)
+    destroy(object);
+  return high_resolution_clock::now() - begin;
+}
+}
+
+/// Compares the pool to the global heap for different churn patterns.
+BOOST_AUTO_TEST_CASE(object_pool_benchmark)
+{
+  constexpr std::size_t live_objects = 10000;
+  constexpr std::size_t operations = 1000000;
+  const char* pattern_names[] = {"LIFO  ", "FIFO  ", "random"};
+
+  auto print = [&](const char* name, nanoseconds duration) {
+    std::cout << "    " << name << std::fixed << std::setprecision(1)
+              << (duration_cast<microseconds>(duration).count() * 1000.0 /
+                  operations)
+              << " ns/op" << std::endl;
+  };
+
+  std::cout << "object_pool benchmark (" << live_objects
+            << " live objects):" << std::endl;
+  for (int pattern = 0; pattern < 3; ++pattern)
+  {
+    std::cout << "  " << pattern_names[pattern] << std::endl;
+    print("new/delete:  ", churn(pattern, live_objects, operations,
+                                 []() { return new payload{}; },
+                                 [](payload* object) { delete object; }));
+
+    object_pool<payload> pool;
+    print("object_pool: ",
+          churn(pattern, live_objects, operations,
+                [&]() { return pool.create(); },
+                [&](payload* object) { pool.destroy(object); }));
+
+    concurrent_object_pool<payload> concurrent_pool;
+    print("concurrent:  ",
+          churn(pattern, live_objects, operations,
+                [&]() { return concurrent_pool.create(); },
+                [&](payload* object) { concurrent_pool.destroy(object); }));
+  }
+
+  // Run the random pattern on several threads at once.
+  constexpr std::size_t num_threads = 4;
+  auto run_threads = [&](auto create, auto destroy) {
+    std::vector<std::thread> threads;
+    auto begin = high_resolution_clock::now();
+    for (std::size_t t = 0; t < num_threads; ++t)
+    {
+      threads.emplace_back([&]() {
+        churn(2, live_objects / num_threads, operations / num_threads, create,
+              destroy);
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    return high_resolution_clock::now() - begin;
+  };
+  std::cout << "  random, " << num_threads << " threads" << std::endl;
+  print("new/delete:  ", run_threads([]() { return new payload{}; },
+                                     [](payload* object) { delete object; }));
+  concurrent_object_pool<payload> concurrent_pool;
+  print("concurrent:  ",
+        run_threads([&]() { return concurrent_pool.create(); },
+                    [&](payload* object) { concurrent_pool.destroy(object); }));
+}
@@ -10,6 +10,29 @@
 
 namespace shift::serialization2
 {
+/// Vectors of trivially serialized scalars are serialized as a whole.
+template <std::size_t N, typename T>
+struct trivial_serialization<
+  math::vector<N, T>,
+  std::enable_if_t<trivial_serialization<T>::value &&
+                   sizeof(math::vector<N, T>) == N * sizeof(T)>>
+: std::true_type
+{
+  using scalar_type = T;
+};
+
+/// Matrices of trivially serialized scalars are serialized as a whole.
+template <std::size_t Rows, std::size_t Columns, typename T>
+struct trivial_serialization<
+  math::matrix<Rows, Columns, T>,
+  std::enable_if_t<trivial_serialization<T>::value &&
+                   sizeof(math::matrix<Rows, Columns, T>) ==
+                     Rows * Columns * sizeof(T)>>
+: std::true_type
+{
+  using scalar_type = T;
+};
+
 ///
 template <boost::endian::order Order, std::size_t N, typename T>
 compact_input_archive<Order>& operator>>(compact_input_archive<Order>& archive,
@@ -1,9 +1,13 @@
 #include "shift/platform/environment.hpp"
 #include <boost/filesystem.hpp>
 #include <vector>
+#include <fstream>
+#include <string>
 #include <csignal>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 
 namespace shift::platform
 {
@@ -51,6 +55,48 @@ void environment::thread_debug_name(const std::string& /*name*/)
   // NOP.
 }
 
+std::vector<std::vector<std::uint32_t>> environment::numa_nodes()
+{
+  std::vector<std::vector<std::uint32_t>> nodes;
+  for (std::uint32_t node = 0;; ++node)
+  {
+    // Each node lists its processors in a format like "0-3,8-11".
+    std::ifstream cpu_list("/sys/devices/system/node/node" +
+                           std::to_string(node) + "/cpulist");
+    if (!cpu_list)
+      break;
+    std::vector<std::uint32_t> processors;
+    std::string range;
+    while (std::getline(cpu_list, range, ','))
+    {
+      auto separator = range.find('-');
+      auto first = static_cast<std::uint32_t>(std::stoul(range));
+      auto last = separator != std::string::npos
+                    ? static_cast<std::uint32_t>(
+                        std::stoul(range.substr(separator + 1)))
+                    : first;
+      for (auto processor = first; processor <= last; ++processor)
+        processors.push_back(processor);
+    }
+    nodes.emplace_back(std::move(processors));
+  }
+  return nodes;
+}
+
+bool environment::thread_processor_affinity(
+  const std::vector<std::uint32_t>& processors)
+{
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto processor : processors)
+  {
+    if (processor < CPU_SETSIZE)
+      CPU_SET(processor, &cpu_set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+}
+
 bool environment::is_debugger_present()
 {
   int status_fd = open("/proc/self/status", O_RDONLY);
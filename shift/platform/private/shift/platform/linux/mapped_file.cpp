@@ -0,0 +1,147 @@
+#include "shift/platform/mapped_file.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace shift::platform
+{
+struct mapped_file::impl
+{
+  impl() = default;
+  impl(const impl&) = delete;
+  impl(impl&&) = delete;
+
+  /// Destructor, which unmaps and closes the file.
+  ~impl()
+  {
+    close();
+  }
+
+  impl& operator=(const impl&) = delete;
+  impl& operator=(impl&&) = delete;
+
+  /// Unmaps and closes the file.
+  void close();
+
+  int handle = -1;
+  std::uint64_t size = 0;
+  void* address = nullptr;
+};
+
+void mapped_file::impl::close()
+{
+  if (address != nullptr)
+  {
+    ::munmap(address, size);
+    address = nullptr;
+  }
+  if (handle != -1)
+  {
+    ::close(handle);
+    handle = -1;
+  }
+  size = 0;
+}
+
+mapped_file::mapped_file() : _impl(std::make_unique<impl>())
+{
+}
+
+mapped_file::mapped_file(mapped_file&&) noexcept = default;
+
+mapped_file::~mapped_file() = default;
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    _impl = std::move(other._impl);
+  }
+  return *this;
+}
+
+bool mapped_file::open(const std::filesystem::path& path, bool allow_mapping)
+{
+  if (_impl)
+    _impl->close();
+  else
+    _impl = std::make_unique<impl>();
+
+  _impl->handle = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (!is_open())
+    return false;
+
+  struct stat file_stat;
+  if (::fstat(_impl->handle, &file_stat) != 0)
+  {
+    close();
+    return false;
+  }
+  _impl->size = static_cast<std::uint64_t>(file_stat.st_size);
+
+  // Empty files cannot be mapped, but there is nothing to read anyway.
+  if (allow_mapping && _impl->size > 0)
+  {
+    auto* address = ::mmap(nullptr, _impl->size, PROT_READ, MAP_SHARED,
+                           _impl->handle, 0);
+    if (address != MAP_FAILED)
+      _impl->address = address;
+  }
+  return true;
+}
+
+void mapped_file::close()
+{
+  if (_impl)
+    _impl->close();
+}
+
+bool mapped_file::is_open() const
+{
+  return _impl && _impl->handle != -1;
+}
+
+bool mapped_file::is_mapped() const
+{
+  return _impl && _impl->address != nullptr;
+}
+
+std::uint64_t mapped_file::size() const
+{
+  return _impl ? _impl->size : 0;
+}
+
+const std::byte* mapped_file::data() const
+{
+  return _impl ? static_cast<const std::byte*>(_impl->address) : nullptr;
+}
+
+bool mapped_file::read(std::uint64_t offset, void* destination,
+                       std::size_t size) const
+{
+  if (!is_open())
+    return false;
+
+  auto* buffer = static_cast<char*>(destination);
+  while (size > 0)
+  {
+    auto result =
+      ::pread(_impl->handle, buffer, size, static_cast<off_t>(offset));
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    else if (result == 0)
+      return false;
+    buffer += result;
+    offset += static_cast<std::uint64_t>(result);
+    size -= static_cast<std::size_t>(result);
+  }
+  return true;
+}
+}
@@ -103,6 +103,42 @@ void environment::thread_debug_name(const std::string& name)
 #endif
 }
 
+std::vector<std::vector<std::uint32_t>> environment::numa_nodes()
+{
+  std::vector<std::vector<std::uint32_t>> nodes;
+  ULONG highest_node = 0;
+  if (!GetNumaHighestNodeNumber(&highest_node))
+    return nodes;
+  for (USHORT node = 0; node <= highest_node; ++node)
+  {
+    // Only processors of the first processor group are supported.
+    GROUP_AFFINITY affinity{};
+    if (!GetNumaNodeProcessorMaskEx(node, &affinity) || affinity.Group != 0)
+      continue;
+    std::vector<std::uint32_t> processors;
+    for (std::uint32_t processor = 0; processor < sizeof(KAFFINITY) * 8;
+         ++processor)
+    {
+      if ((affinity.Mask & (KAFFINITY{1} << processor)) != 0)
+        processors.push_back(processor);
+    }
+    nodes.emplace_back(std::move(processors));
+  }
+  return nodes;
+}
+
+bool environment::thread_processor_affinity(
+  const std::vector<std::uint32_t>& processors)
+{
+  DWORD_PTR mask = 0;
+  for (auto processor : processors)
+  {
+    if (processor < sizeof(DWORD_PTR) * 8)
+      mask |= DWORD_PTR{1} << processor;
+  }
+  return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+
 bool environment::is_debugger_present()
 {
   return IsDebuggerPresent() != 0;
@@ -0,0 +1,169 @@
+#include "shift/platform/mapped_file.hpp"
+#include <algorithm>
+#include <limits>
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+
+namespace shift::platform
+{
+struct mapped_file::impl
+{
+  impl() = default;
+  impl(const impl&) = delete;
+  impl(impl&&) = delete;
+
+  /// Destructor, which unmaps and closes the file.
+  ~impl()
+  {
+    close();
+  }
+
+  impl& operator=(const impl&) = delete;
+  impl& operator=(impl&&) = delete;
+
+  /// Unmaps and closes the file.
+  void close();
+
+  HANDLE handle = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+  std::uint64_t size = 0;
+  const void* address = nullptr;
+};
+
+void mapped_file::impl::close()
+{
+  if (address != nullptr)
+  {
+    UnmapViewOfFile(address);
+    address = nullptr;
+  }
+  if (mapping != nullptr)
+  {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+  if (handle != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(handle);
+    handle = INVALID_HANDLE_VALUE;
+  }
+  size = 0;
+}
+
+mapped_file::mapped_file() : _impl(std::make_unique<impl>())
+{
+}
+
+mapped_file::mapped_file(mapped_file&&) noexcept = default;
+
+mapped_file::~mapped_file() = default;
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    _impl = std::move(other._impl);
+  }
+  return *this;
+}
+
+bool mapped_file::open(const std::filesystem::path& path, bool allow_mapping)
+{
+  if (_impl)
+    _impl->close();
+  else
+    _impl = std::make_unique<impl>();
+
+  // Allow other handles to write to the file, which is required for archives
+  // opened for writing.
+  _impl->handle = CreateFileW(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+  if (!is_open())
+    return false;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(_impl->handle, &file_size))
+  {
+    close();
+    return false;
+  }
+  _impl->size = static_cast<std::uint64_t>(file_size.QuadPart);
+
+  // Empty files cannot be mapped, but there is nothing to read anyway.
+  if (allow_mapping && _impl->size > 0)
+  {
+    _impl->mapping = CreateFileMappingW(_impl->handle, nullptr, PAGE_READONLY,
+                                        0, 0, nullptr);
+    if (_impl->mapping != nullptr)
+    {
+      _impl->address = MapViewOfFile(_impl->mapping, FILE_MAP_READ, 0, 0, 0);
+      if (_impl->address == nullptr)
+      {
+        CloseHandle(_impl->mapping);
+        _impl->mapping = nullptr;
+      }
+    }
+  }
+  return true;
+}
+
+void mapped_file::close()
+{
+  if (_impl)
+    _impl->close();
+}
+
+bool mapped_file::is_open() const
+{
+  return _impl && _impl->handle != INVALID_HANDLE_VALUE;
+}
+
+bool mapped_file::is_mapped() const
+{
+  return _impl && _impl->address != nullptr;
+}
+
+std::uint64_t mapped_file::size() const
+{
+  return _impl ? _impl->size : 0;
+}
+
+const std::byte* mapped_file::data() const
+{
+  return _impl ? static_cast<const std::byte*>(_impl->address) : nullptr;
+}
+
+bool mapped_file::read(std::uint64_t offset, void* destination,
+                       std::size_t size) const
+{
+  if (!is_open())
+    return false;
+
+  auto* buffer = static_cast<char*>(destination);
+  while (size > 0)
+  {
+    // Passing an explicit offset makes ReadFile independent of the handle's
+    // file pointer.
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    auto chunk_size = static_cast<DWORD>(
+      (std::min<std::size_t>)(size, (std::numeric_limits<DWORD>::max)()));
+    DWORD bytes_read = 0;
+    if (!ReadFile(_impl->handle, buffer, chunk_size, &bytes_read,
+                  &overlapped) ||
+        bytes_read == 0)
+    {
+      return false;
+    }
+    buffer += bytes_read;
+    offset += bytes_read;
+    size -= bytes_read;
+  }
+  return true;
+}
+}
@@ -1,7 +1,9 @@
 #ifndef SHIFT_PLATFORM_ENVIRONMENT_HPP
 #define SHIFT_PLATFORM_ENVIRONMENT_HPP
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <filesystem>
 
 namespace shift::platform
@@ -36,6 +38,17 @@ public:
   /// Assigns the current thread a readable name to support debugging.
   static void thread_debug_name(const std::string& name);
 
+  /// Returns the logical processor indices of each NUMA node reported by the
+  /// operating system. The result is empty if the platform does not report
+  /// any NUMA topology.
+  static std::vector<std::vector<std::uint32_t>> numa_nodes();
+
+  /// Restricts the current thread to the passed logical processors.
+  /// @return
+  ///   False if the operating system rejected the request.
+  static bool thread_processor_affinity(
+    const std::vector<std::uint32_t>& processors);
+
   /// Returns true if a debugger is detected to be attached to the process.
   static bool is_debugger_present();
 
@@ -0,0 +1,71 @@
+#ifndef SHIFT_PLATFORM_MAPPED_FILE_HPP
+#define SHIFT_PLATFORM_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <filesystem>
+
+namespace shift::platform
+{
+/// Read-only access to a file, which is preferably mapped into memory.
+/// @remarks
+///   If the file cannot be mapped (or mapping is not requested), the
+///   instance falls back to positional reads. Both data() and read() may be
+///   used concurrently from any number of threads, because neither relies on
+///   a shared file position.
+///   A moved-from instance behaves like a closed one and may be opened again.
+class mapped_file
+{
+public:
+  /// Default constructor.
+  mapped_file();
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file(mapped_file&&) noexcept;
+
+  /// Destructor.
+  ~mapped_file();
+
+  mapped_file& operator=(const mapped_file&) = delete;
+  mapped_file& operator=(mapped_file&&) noexcept;
+
+  /// Opens the file for reading.
+  /// @param allow_mapping
+  ///   Pass false if the file is going to be modified while being open. Data
+  ///   is then only accessible through read().
+  /// @return
+  ///   False if the file cannot be opened.
+  bool open(const std::filesystem::path& path, bool allow_mapping = true);
+
+  /// Unmaps and closes the file.
+  void close();
+
+  /// Returns whether the file is open.
+  bool is_open() const;
+
+  /// Returns whether the file contents are accessible through data().
+  bool is_mapped() const;
+
+  /// Returns the size of the file at the time it was opened.
+  std::uint64_t size() const;
+
+  /// Returns a pointer to the mapped file contents, or nullptr if the file is
+  /// not mapped.
+  const std::byte* data() const;
+
+  /// Copies size bytes starting at offset into destination.
+  /// @remarks
+  ///   This method is thread-safe and does not alter any file position.
+  /// @return
+  ///   False if not all requested bytes could be read.
+  bool read(std::uint64_t offset, void* destination, std::size_t size) const;
+
+private:
+  struct impl;
+
+  std::unique_ptr<impl> _impl;
+};
+}
+
+#endif
@@ -8,9 +8,44 @@
 #include <filesystem>
 #include <queue>
 #include <memory>
+#include <vector>
 
 namespace shift::rc
 {
+/// Loads all resources referenced by paths in parallel and returns those,
+/// which could be loaded.
+template <typename Resource>
+static std::vector<resource_db::resource_ptr<Resource>> load_resources(
+  const std::vector<std::filesystem::path>& paths, const char* kind)
+{
+  auto& repository = resource_db::repository::singleton_instance();
+  std::vector<resource_db::resource_id> ids;
+  ids.reserve(paths.size());
+  for (const auto& path : paths)
+    ids.push_back(repository.lookup_id(path));
+
+  auto futures = repository.load_all<Resource>(ids);
+  std::vector<resource_db::resource_ptr<Resource>> resources;
+  resources.reserve(futures.size());
+  for (std::size_t i = 0; i < futures.size(); ++i)
+  {
+    try
+    {
+      if (auto resource = futures[i].get())
+      {
+        resources.push_back(std::move(resource));
+        continue;
+      }
+    }
+    catch (const core::runtime_error&)
+    {
+    }
+    log::error() << "Cannot add " << kind << " " << paths[i]
+                 << " to group.";
+  }
+  return resources;
+}
+
 action_group_resources::action_group_resources()
 : action_base(action_name, action_version)
 {
@@ -24,37 +59,25 @@ bool action_group_resources::process(resource_compiler_impl& compiler,
   if (job.inputs.empty())
     return false;
 
-  auto& repository = resource_db::repository::singleton_instance();
-  auto group = std::make_shared<resource_db::resource_group>();
+  std::vector<fs::path> image_paths;
+  std::vector<fs::path> mesh_paths;
   for (const auto& [input_slot_index, input] : job.inputs)
   {
     if (input->slot->first == "images")
-    {
-      auto image = repository.load<resource_db::image>(input->file->path);
-      if (!image)
-      {
-        log::error() << "Cannot add image " << input->file->path
-                     << " to group.";
-        continue;
-      }
-      group->images.push_back(image);
-    }
+      image_paths.push_back(input->file->path);
     else if (input->slot->first == "meshes")
-    {
-      auto mesh = repository.load<resource_db::mesh>(input->file->path);
-      if (!mesh)
-      {
-        log::error() << "Cannot add mesh " << input->file->path << " to group.";
-        continue;
-      }
-      group->meshes.push_back(mesh);
-    }
+      mesh_paths.push_back(input->file->path);
     else
     {
       log::error() << "Unknown pattern name \"" << input->slot->first
                    << "\" in rule \"" << job.rule->id << "\".";
     }
   }
+
+  auto group = std::make_shared<resource_db::resource_group>();
+  group->images = load_resources<resource_db::image>(image_paths, "image");
+  group->meshes = load_resources<resource_db::mesh>(mesh_paths, "mesh");
+
   // Store resource into repository.
   compiler.save(*group, job.output_file_path("group", {}), job);
 
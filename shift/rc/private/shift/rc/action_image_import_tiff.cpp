@@ -3,12 +3,15 @@
 #include <shift/rc/image_util/tiff_io.hpp>
 #include <shift/rc/image_util/image.hpp>
 #include <shift/resource_db/image.hpp>
+#include <shift/task/parallel.hpp>
+#include <shift/task/this_task.hpp>
 #include <shift/log/log.hpp>
 #include <shift/math/utility.hpp>
 #include <shift/math/vector.hpp>
 #include <shift/core/mpl.hpp>
 #include <shift/core/string_util.hpp>
 #include <filesystem>
+#include <algorithm>
 #include <gsl/gsl>
 // #include <image/image.h>
 // #include <tiffio.h>
@@ -154,8 +157,60 @@ bool action_image_import_tiff::process(resource_compiler_impl& compiler,
       ? parser::json::get<bool>(job.rule->options.at("ignore-icc-profile"))
       : false;
 
+  image_util::convert_flags convert_flags{};
+  if (parser::json::has(job.rule->options, "bc-quality"))
+  {
+    auto bc_quality =
+      parser::json::get<std::string>(job.rule->options.at("bc-quality"));
+    if (bc_quality == "low")
+      convert_flags |= image_util::convert_flag::fast_block_compression;
+    else if (bc_quality == "high")
+      convert_flags |= image_util::convert_flag::best_block_compression;
+    else if (bc_quality != "medium")
+    {
+      log::error() << "Unknown bc-quality \"" << bc_quality
+                   << "\", expected \"low\", \"medium\", or \"high\".";
+      return false;
+    }
+  }
+
+  image_util::resize_flags mip_flags{};
+  if (parser::json::has(job.rule->options, "mip-filter"))
+  {
+    auto mip_filter =
+      parser::json::get<std::string>(job.rule->options.at("mip-filter"));
+    if (mip_filter == "box")
+      mip_flags |= image_util::resize_flag::box_filter;
+    else if (mip_filter == "triangle")
+      mip_flags |= image_util::resize_flag::triangle_filter;
+    else if (mip_filter == "lanczos")
+      mip_flags |= image_util::resize_flag::lanczos_filter;
+    else if (mip_filter == "kaiser")
+      mip_flags |= image_util::resize_flag::kaiser_filter;
+    else
+    {
+      log::error() << "Unknown mip-filter \"" << mip_filter
+                   << "\", expected \"box\", \"triangle\", \"kaiser\", or "
+                      "\"lanczos\".";
+      return false;
+    }
+  }
+
+  image_util::tiff_stream_options stream_options;
+  if (parser::json::has(job.rule->options, "stream-window-size"))
+  {
+    // The option is specified in MiB.
+    stream_options.window_size = static_cast<std::size_t>(
+      parser::json::get<double>(
+        job.rule->options.at("stream-window-size")) *
+      (1 << 20));
+  }
+
+  // Only load the image properties here. Pixels are decoded and converted
+  // piece by piece below, so the source image is never held in memory as a
+  // whole.
   std::vector<image_util::tiff_image> source_images;
-  if (!io.load(input.file->path, source_images, ignore_icc_profile) ||
+  if (!io.load_info(input.file->path, source_images, ignore_icc_profile) ||
       source_images.empty())
   {
     log::error() << "Failed loading image " << input.file->path << ".";
@@ -193,76 +248,140 @@ bool action_image_import_tiff::process(resource_compiler_impl& compiler,
   target_image->format = target_format;
   target_image->array_element_count = 1;
   target_image->face_count = 1;
-  for (auto& source_image : source_images)
+  for (std::size_t image_index = 0; image_index < source_images.size();
+       ++image_index)
   {
-    image_util::source_image_descriptor source;
-    source.width = source_image.width;
-    source.height = source_image.height;
-    source.row_stride = 0;
-    source.format = to_image_format(source_image);
-    source.buffer_size = source_image.pixel_data.size();
-    source.buffer = source_image.pixel_data.data();
+    const auto& source_image = source_images[image_index];
+    auto source_format = to_image_format(source_image);
 
     auto target_buffer = std::make_shared<resource_db::buffer>();
+    image_util::destination_image_descriptor converted;
+    converted.width = source_image.width;
+    converted.height = source_image.height;
+    converted.row_stride = 0;
+    converted.format = target_format;
+    target_buffer->storage.resize(
+      image_util::required_image_buffer_size(converted));
+    converted.buffer_size = target_buffer->storage.size();
+    converted.buffer = target_buffer->storage.data();
 
-    if (source.format == target_format)
+    // All mip levels are generated from the source pixels while streaming
+    // through the image, before converting them to the target format.
+    std::unique_ptr<image_util::mip_chain> mip_chain;
+    if (generate_mip_maps)
     {
-      target_buffer->storage.resize(source.buffer_size);
-      std::copy_n(source.buffer, source.buffer_size,
-                  target_buffer->storage.begin());
+      image_util::image_descriptor base_image;
+      base_image.width = source_image.width;
+      base_image.height = source_image.height;
+      base_image.row_stride = 0;
+      base_image.format = source_format;
+      mip_chain =
+        std::make_unique<image_util::mip_chain>(base_image, mip_flags);
     }
-    else
-    {
-      image_util::destination_image_descriptor converted;
-      converted.width = source_image.width;
-      converted.height = source_image.height;
-      converted.row_stride = 0;
-      converted.format = target_format;
-      target_buffer->storage.resize(
-        image_util::required_image_buffer_size(converted));
-      converted.buffer_size = target_buffer->storage.size();
-      converted.buffer = target_buffer->storage.data();
-
-      image_util::convert_region region;
-      region.destination_x = 0;
-      region.destination_y = 0;
-      region.source_x = 0;
-      region.source_y = 0;
-      region.width = source.width;
-      region.height = source.height;
-
-      if (auto error = image_util::convert_image(converted, source, region, {});
-          error)
+
+    // Regions need to consist of whole blocks of block compressed formats.
+    stream_options.row_alignment =
+      resource_db::is_block_compressed(target_format) ? 4 : 1;
+    std::error_code convert_error;
+    auto convert_region = [&](const image_util::tiff_region& region) {
+      image_util::source_image_descriptor source;
+      source.width = source_image.width;
+      source.height = region.height;
+      source.row_stride = 0;
+      source.format = source_format;
+      source.buffer_size = region.size;
+      source.buffer = region.pixel_data;
+      if (mip_chain)
       {
-        log::error() << "Image compression failed: " << error;
-        return false;
+        convert_error = mip_chain->add_rows(source);
+        if (convert_error)
+          return false;
+      }
+
+      if (source_format == target_format &&
+          !resource_db::is_block_compressed(target_format))
+      {
+        auto row_size = converted.buffer_size / converted.height;
+        std::copy_n(region.pixel_data, region.size,
+                    converted.buffer + region.y * row_size);
+        return true;
       }
+
+      convert_error = image_util::convert_image(
+        converted, source,
+        image_util::convert_region{0, region.y, 0, 0, source.width,
+                                   region.height},
+        convert_flags);
+      return !convert_error;
+    };
+    if (!io.load_regions(input.file->path, image_index, source_image,
+                         stream_options, convert_region))
+    {
+      if (convert_error)
+        log::error() << "Image compression failed: " << convert_error;
+      else
+        log::error() << "Failed loading image " << input.file->path << ".";
+      return false;
     }
 
-    image_util::source_image_descriptor next_image;
-    auto* current_image = &source;
-    do
+    auto& base_mipmap = target_image->mipmaps.emplace_back();
+    base_mipmap.buffer = target_buffer;
+    base_mipmap.offset = 0;
+    base_mipmap.width = source_image.width;
+    base_mipmap.height = source_image.height;
+    base_mipmap.depth = 1;
+
+    if (!mip_chain)
+      continue;
+
+    // Convert all remaining mip levels in parallel, which mostly pays off
+    // for block compressed target formats.
+    auto level_count = mip_chain->level_count();
+    std::vector<std::shared_ptr<resource_db::buffer>> level_buffers(
+      level_count);
+    std::vector<std::error_code> level_errors(level_count);
+    auto convert_level = [&](std::uint32_t level) {
+      auto level_image = mip_chain->level(level);
+      auto level_buffer = std::make_shared<resource_db::buffer>();
+      image_util::destination_image_descriptor destination;
+      destination.width = level_image.width;
+      destination.height = level_image.height;
+      destination.row_stride = 0;
+      destination.format = target_format;
+      level_buffer->storage.resize(
+        image_util::required_image_buffer_size(destination));
+      destination.buffer_size = level_buffer->storage.size();
+      destination.buffer = level_buffer->storage.data();
+      level_errors[level] = image_util::convert_image(
+        destination, level_image,
+        image_util::convert_region{0, 0, 0, 0, level_image.width,
+                                   level_image.height},
+        convert_flags);
+      level_buffers[level] = std::move(level_buffer);
+    };
+    if (task::this_task::inside_task())
+      task::parallel_for(std::uint32_t{1}, level_count, convert_level, 1);
+    else
     {
+      for (std::uint32_t level = 1; level < level_count; ++level)
+        convert_level(level);
+    }
 
+    for (std::uint32_t level = 1; level < level_count; ++level)
+    {
+      if (level_errors[level])
+      {
+        log::error() << "Image compression failed: " << level_errors[level];
+        return false;
+      }
+      auto level_image = mip_chain->level(level);
       auto& mipmap = target_image->mipmaps.emplace_back();
-      mipmap.buffer = target_buffer;
+      mipmap.buffer = level_buffers[level];
       mipmap.offset = 0;
-      mipmap.width = source.width;
-      mipmap.height = source.height;
+      mipmap.width = level_image.width;
+      mipmap.height = level_image.height;
       mipmap.depth = 1;
-
-      if (!generate_mip_maps)
-        break;
-      /// ToDo: Save image to target_image->mipmaps.
-      break;  /// ToDo: remove when scale_down is back.
-
-      // if (!scale_down(*last_image, next_image))
-      // {
-      //   log::error() << "Image resize failed.";
-      //   return false;
-      // }
-      // current_image = &next_image;
-    } while (current_image->width > 1u || current_image->height > 1u);
+    }
   }
 
   std::size_t lod_level = 0;
@@ -12,7 +12,7 @@ class action_mesh_import_ply : public action_base,
 {
 public:
   static constexpr const char* action_name = "mesh-import-ply";
-  static constexpr const char* action_version = "1.0.0002";
+  static constexpr const char* action_version = "1.0.0004";
 
 public:
   /// Default constructor.
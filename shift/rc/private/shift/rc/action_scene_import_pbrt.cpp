@@ -78,7 +78,8 @@ struct action_scene_import_pbrt::parser_context
 };
 
 action_scene_import_pbrt::action_scene_import_pbrt()
-: action_base(action_name, action_version)
+: action_base(action_name, action_version, support_multithreading,
+              depends_on_previous_passes)
 {
 }
 
@@ -18,6 +18,9 @@ class action_scene_import_pbrt
 public:
   static constexpr const char* action_name = "scene-import-pbrt";
   static constexpr const char* action_version = "1.0.0001";
+  static constexpr const bool support_multithreading = true;
+  /// Scenes reference textures and meshes imported by previous passes.
+  static constexpr const bool depends_on_previous_passes = true;
 
 public:
   /// Default constructor.
@@ -0,0 +1,87 @@
+#ifndef SHIFT_RC_ARTIFACT_STORE_HPP
+#define SHIFT_RC_ARTIFACT_STORE_HPP
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <shift/resource_db/resource.hpp>
+
+namespace shift::rc
+{
+/// Identifies the outputs of a job by everything that affects them, i.e. the
+/// action and its version, the rule, and the contents of all input files.
+using artifact_key = std::uint64_t;
+
+/// Describes a single output file of an artifact.
+struct artifact_output
+{
+  /// The file's path, which starts with one of the variables
+  /// "<input-path/>", "<build-path/>", or "<output-path/>", so that
+  /// artifacts can be shared between machines with different folder
+  /// layouts.
+  std::string path;
+  std::uint64_t size = 0;
+  std::uint64_t content_hash = 0;
+  /// The resource id the file is indexed with, or zero if the file was not
+  /// written through the resource repository.
+  resource_db::resource_id id = 0;
+  /// The portable path of an input file which is aliased by this output, or
+  /// an empty string.
+  std::string alias;
+};
+
+/// Hit and miss counters of a single action.
+struct artifact_statistics
+{
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t stores = 0;
+};
+
+/// Interface of a content addressed store of job outputs.
+/// @remarks
+///   Implementations are called from multiple tasks in parallel and must
+///   therefore be thread-safe. They also need to cope with other processes
+///   accessing the same store concurrently, because a store may be shared
+///   between several developers and build agents.
+class artifact_store
+{
+public:
+  /// Destructor.
+  virtual ~artifact_store() = 0;
+
+  /// Looks up the list of output files of an artifact.
+  /// @return
+  ///   False if the store does not contain the artifact.
+  virtual bool find(artifact_key key,
+                    std::vector<artifact_output>& outputs) = 0;
+
+  /// Copies a single output file of an artifact to target_path.
+  /// @return
+  ///   False if the file is missing or fails the integrity check against the
+  ///   output's size and content hash. In the latter case the artifact is
+  ///   removed from the store.
+  virtual bool fetch(artifact_key key, std::size_t output_index,
+                     const artifact_output& output,
+                     const std::filesystem::path& target_path) = 0;
+
+  /// Adds an artifact to the store.
+  /// @param source_paths
+  ///   The local paths of all output files, in the same order as outputs.
+  virtual bool store(
+    artifact_key key, const std::vector<artifact_output>& outputs,
+    const std::vector<std::filesystem::path>& source_paths) = 0;
+
+  /// Removes all artifacts that were not used within max_age, and then the
+  /// least recently used ones until the store's size is at most max_size
+  /// bytes.
+  /// @return
+  ///   The number of removed artifacts.
+  virtual std::size_t evict(std::uint64_t max_size,
+                            std::chrono::seconds max_age) = 0;
+};
+}
+
+#endif
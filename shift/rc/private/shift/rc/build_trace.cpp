@@ -0,0 +1,158 @@
+#include "shift/rc/build_trace.hpp"
+#include <shift/parser/json/json.hpp>
+#include <shift/log/log.hpp>
+#include <shift/core/stream_util.hpp>
+#include <algorithm>
+#include <fstream>
+
+namespace shift::rc
+{
+using milliseconds = std::chrono::duration<double, std::milli>;
+
+/// Returns the number of microseconds between two points in time.
+static std::int64_t microseconds(job_trace::clock::time_point from,
+                                 job_trace::clock::time_point to)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(to - from)
+    .count();
+}
+
+std::vector<std::size_t> critical_path(const build_trace& trace)
+{
+  std::vector<std::size_t> result;
+  if (trace.jobs.empty())
+    return result;
+
+  auto finished_later = [&](std::size_t lhs, std::size_t rhs) {
+    return trace.jobs[lhs].finished < trace.jobs[rhs].finished;
+  };
+
+  std::size_t current = 0;
+  for (std::size_t index = 1; index < trace.jobs.size(); ++index)
+  {
+    if (finished_later(current, index))
+      current = index;
+  }
+  while (current != job_trace::no_job)
+  {
+    result.push_back(current);
+    const auto& job = trace.jobs[current];
+    auto predecessor = job.trigger;
+    for (auto dependency : job.dependencies)
+    {
+      if (predecessor == job_trace::no_job ||
+          finished_later(predecessor, dependency))
+      {
+        predecessor = dependency;
+      }
+    }
+    current = predecessor;
+  }
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+void log_critical_path(const build_trace& trace, std::uint32_t verbose)
+{
+  auto path = critical_path(trace);
+  if (path.empty())
+    return;
+
+  milliseconds processing_time{0};
+  milliseconds waiting_time{0};
+  for (auto index : path)
+  {
+    const auto& job = trace.jobs[index];
+    processing_time += job.finished - job.started;
+    waiting_time += job.started - job.queued;
+  }
+  log::info() << "Critical path of " << path.size() << " job(s) spent "
+              << processing_time.count() << "ms processing and "
+              << waiting_time.count() << "ms waiting for workers, out of "
+              << milliseconds{trace.finished - trace.started}.count()
+              << "ms total update time.";
+
+  if (verbose >= 1)
+  {
+    for (auto index : path)
+    {
+      const auto& job = trace.jobs[index];
+      log::info() << "  " << milliseconds{job.finished - job.started}.count()
+                  << "ms (pass " << job.pass << R"(, rule ")" << job.rule_id
+                  << R"(", action ")" << job.action_name << R"("): )"
+                  << job.name;
+    }
+  }
+}
+
+bool save_chrome_trace(const build_trace& trace,
+                       const std::filesystem::path& trace_filename)
+{
+  using namespace shift::parser;
+
+  json::array events;
+  for (std::size_t index = 0; index < trace.jobs.size(); ++index)
+  {
+    const auto& job = trace.jobs[index];
+
+    json::object arguments;
+    arguments["rule"] = job.rule_id;
+    arguments["pass"] = static_cast<std::int64_t>(job.pass);
+    arguments["queued-us"] = microseconds(job.queued, job.started);
+    arguments["succeeded"] = job.succeeded;
+    arguments["restored"] = job.restored;
+
+    json::object event;
+    event["name"] = job.name;
+    event["cat"] = job.action_name;
+    event["ph"] = std::string{"X"};
+    event["ts"] = microseconds(trace.started, job.started);
+    event["dur"] = microseconds(job.started, job.finished);
+    event["pid"] = std::int64_t{1};
+    event["tid"] = static_cast<std::int64_t>(job.worker_id);
+    event["args"] = std::move(arguments);
+    events.emplace_back(std::move(event));
+
+    // Connect each job with the jobs producing its inputs.
+    for (auto dependency_index : job.dependencies)
+    {
+      const auto& dependency = trace.jobs[dependency_index];
+      auto flow_id = static_cast<std::int64_t>(events.size());
+
+      json::object flow_start;
+      flow_start["name"] = std::string{"dependency"};
+      flow_start["cat"] = std::string{"dependency"};
+      flow_start["ph"] = std::string{"s"};
+      flow_start["id"] = flow_id;
+      flow_start["ts"] = microseconds(trace.started, dependency.finished) - 1;
+      flow_start["pid"] = std::int64_t{1};
+      flow_start["tid"] = static_cast<std::int64_t>(dependency.worker_id);
+      events.emplace_back(std::move(flow_start));
+
+      json::object flow_end;
+      flow_end["name"] = std::string{"dependency"};
+      flow_end["cat"] = std::string{"dependency"};
+      flow_end["ph"] = std::string{"f"};
+      flow_end["bp"] = std::string{"e"};
+      flow_end["id"] = flow_id;
+      flow_end["ts"] = microseconds(trace.started, job.started);
+      flow_end["pid"] = std::int64_t{1};
+      flow_end["tid"] = static_cast<std::int64_t>(job.worker_id);
+      events.emplace_back(std::move(flow_end));
+    }
+  }
+
+  json::object root;
+  root["displayTimeUnit"] = std::string{"ms"};
+  root["traceEvents"] = std::move(events);
+
+  std::ofstream file{trace_filename.generic_string(),
+                     std::ios_base::out | std::ios_base::binary |
+                       std::ios_base::trunc};
+  if (!file.is_open())
+    return false;
+  file << core::indent_character(' ') << core::indent_width(2);
+  file << root;
+  return file.good();
+}
+}
@@ -0,0 +1,75 @@
+#ifndef SHIFT_RC_BUILD_TRACE_HPP
+#define SHIFT_RC_BUILD_TRACE_HPP
+
+#include <cstdint>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <shift/task/types.hpp>
+
+namespace shift::rc
+{
+/// Timing information about a single job processed during an update.
+struct job_trace
+{
+  using clock = std::chrono::steady_clock;
+
+  /// A dependency index which refers to no job at all.
+  static constexpr std::size_t no_job = std::numeric_limits<std::size_t>::max();
+
+  std::string rule_id;
+  std::string action_name;
+  std::uint32_t pass = 0;
+  /// The generic path of the job's first input file.
+  std::string name;
+  /// The time at which the job's rule released the job for processing.
+  clock::time_point queued;
+  /// The time at which the job started, which may be later than queued if all
+  /// workers were busy or the action does not support multithreading.
+  clock::time_point started;
+  clock::time_point finished;
+  task::worker_id_t worker_id = 0;
+  bool succeeded = false;
+  /// Whether the job's outputs were restored from the artifact store.
+  bool restored = false;
+  /// Indices of the jobs which produced any of this job's input files.
+  std::vector<std::size_t> dependencies;
+  /// Index of the job whose completion released this job, or no_job if the
+  /// job was ready right from the start.
+  std::size_t trigger = no_job;
+};
+
+/// Records all jobs processed during a single update.
+struct build_trace
+{
+  job_trace::clock::time_point started;
+  job_trace::clock::time_point finished;
+  std::vector<job_trace> jobs;
+};
+
+/// Returns the chain of jobs which determined the duration of an update,
+/// ordered from the first to the last job.
+/// @remarks
+///   Starting with the job that finished last, the chain is built by
+///   repeatedly stepping to the latest finishing job among the dependencies
+///   and the trigger of the current job.
+std::vector<std::size_t> critical_path(const build_trace& trace);
+
+/// Logs the critical path of an update.
+/// @param verbose
+///   Each job on the critical path is listed if verbose is at least one.
+///   Otherwise only a summary is printed.
+void log_critical_path(const build_trace& trace, std::uint32_t verbose);
+
+/// Writes a trace of an update in the Chrome trace event format, which can be
+/// viewed in chrome://tracing or Perfetto.
+/// @remarks
+///   Each job is written as a complete event on the timeline of the worker
+///   that processed it, and each dependency as a flow event.
+bool save_chrome_trace(const build_trace& trace,
+                       const std::filesystem::path& trace_filename);
+}
+
+#endif
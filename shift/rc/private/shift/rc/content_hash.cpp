@@ -0,0 +1,174 @@
+#include "shift/rc/content_hash.hpp"
+#include <shift/platform/mapped_file.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace shift::rc
+{
+static constexpr std::uint64_t prime1 = 11400714785074694791ull;
+static constexpr std::uint64_t prime2 = 14029467366897019727ull;
+static constexpr std::uint64_t prime3 = 1609587929392839161ull;
+static constexpr std::uint64_t prime4 = 9650029242287828579ull;
+static constexpr std::uint64_t prime5 = 2870177450012600261ull;
+
+/// The size of blocks read from files which cannot be memory mapped.
+static constexpr std::size_t read_block_size = 1 << 20;
+
+static constexpr std::uint64_t rotate_left(std::uint64_t value, int count)
+{
+  return (value << count) | (value >> (64 - count));
+}
+
+/// Reads a little endian 64 bit value.
+static std::uint64_t read64(const std::byte* data)
+{
+  std::uint64_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static std::uint32_t read32(const std::byte* data)
+{
+  std::uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static constexpr std::uint64_t round(std::uint64_t accumulator,
+                                     std::uint64_t input)
+{
+  return rotate_left(accumulator + input * prime2, 31) * prime1;
+}
+
+static constexpr std::uint64_t merge_round(std::uint64_t hash,
+                                           std::uint64_t accumulator)
+{
+  return (hash ^ round(0, accumulator)) * prime1 + prime4;
+}
+
+/// Processes a number of complete 32 byte stripes.
+static const std::byte* process_stripes(
+  std::array<std::uint64_t, 4>& accumulators, const std::byte* data,
+  std::size_t stripe_count)
+{
+  auto [v1, v2, v3, v4] = accumulators;
+  for (; stripe_count > 0; --stripe_count, data += 32)
+  {
+    v1 = round(v1, read64(data));
+    v2 = round(v2, read64(data + 8));
+    v3 = round(v3, read64(data + 16));
+    v4 = round(v4, read64(data + 24));
+  }
+  accumulators = {v1, v2, v3, v4};
+  return data;
+}
+
+content_hasher::content_hasher(std::uint64_t seed)
+: _accumulators{seed + prime1 + prime2, seed + prime2, seed, seed - prime1},
+  _seed(seed)
+{
+}
+
+void content_hasher::update(const void* data, std::size_t size)
+{
+  const auto* bytes = static_cast<const std::byte*>(data);
+  _total_size += size;
+
+  // Complete a previously buffered stripe.
+  if (_buffer_size > 0)
+  {
+    auto count = std::min(size, _buffer.size() - _buffer_size);
+    std::memcpy(_buffer.data() + _buffer_size, bytes, count);
+    _buffer_size += count;
+    bytes += count;
+    size -= count;
+    if (_buffer_size < _buffer.size())
+      return;
+    process_stripes(_accumulators, _buffer.data(), 1);
+    _buffer_size = 0;
+  }
+
+  bytes = process_stripes(_accumulators, bytes, size / 32);
+  _buffer_size = size % 32;
+  std::memcpy(_buffer.data(), bytes, _buffer_size);
+}
+
+std::uint64_t content_hasher::finish() const
+{
+  std::uint64_t hash;
+  if (_total_size >= 32)
+  {
+    const auto& [v1, v2, v3, v4] = _accumulators;
+    hash = rotate_left(v1, 1) + rotate_left(v2, 7) + rotate_left(v3, 12) +
+           rotate_left(v4, 18);
+    hash = merge_round(hash, v1);
+    hash = merge_round(hash, v2);
+    hash = merge_round(hash, v3);
+    hash = merge_round(hash, v4);
+  }
+  else
+    hash = _seed + prime5;
+  hash += _total_size;
+
+  const auto* data = _buffer.data();
+  auto size = _buffer_size;
+  for (; size >= 8; size -= 8, data += 8)
+    hash = rotate_left(hash ^ round(0, read64(data)), 27) * prime1 + prime4;
+  if (size >= 4)
+  {
+    hash = rotate_left(hash ^ (read32(data) * prime1), 23) * prime2 + prime3;
+    size -= 4;
+    data += 4;
+  }
+  for (; size > 0; --size, ++data)
+  {
+    hash = rotate_left(hash ^ (std::to_integer<std::uint64_t>(*data) * prime5),
+                       11) *
+           prime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= prime2;
+  hash ^= hash >> 29;
+  hash *= prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+std::uint64_t hash_content(const void* data, std::size_t size,
+                           std::uint64_t seed)
+{
+  content_hasher hasher(seed);
+  hasher.update(data, size);
+  return hasher.finish();
+}
+
+bool hash_file(const std::filesystem::path& path, std::uint64_t& hash)
+{
+  platform::mapped_file file;
+  if (!file.open(path))
+    return false;
+
+  content_hasher hasher;
+  if (file.is_mapped())
+    hasher.update(file.data(), static_cast<std::size_t>(file.size()));
+  else
+  {
+    std::vector<std::byte> block(
+      static_cast<std::size_t>(std::min<std::uint64_t>(file.size(),
+                                                       read_block_size)));
+    for (std::uint64_t offset = 0; offset < file.size();
+         offset += block.size())
+    {
+      auto size = static_cast<std::size_t>(
+        std::min<std::uint64_t>(file.size() - offset, block.size()));
+      if (!file.read(offset, block.data(), size))
+        return false;
+      hasher.update(block.data(), size);
+    }
+  }
+  hash = hasher.finish();
+  return true;
+}
+}
@@ -0,0 +1,46 @@
+#ifndef SHIFT_RC_CONTENT_HASH_HPP
+#define SHIFT_RC_CONTENT_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <filesystem>
+
+namespace shift::rc
+{
+/// An incremental implementation of the 64 bit xxHash (XXH64) algorithm,
+/// which is used to fingerprint file contents.
+/// @remarks
+///   The hash is not cryptographically secure, but processes several
+///   gigabytes per second, so fingerprinting is usually bound by disk I/O.
+class content_hasher
+{
+public:
+  /// Constructor.
+  content_hasher(std::uint64_t seed = 0);
+
+  /// Appends a block of data.
+  void update(const void* data, std::size_t size);
+
+  /// Returns the hash of all data passed to update so far.
+  std::uint64_t finish() const;
+
+private:
+  std::array<std::uint64_t, 4> _accumulators;
+  std::array<std::byte, 32> _buffer;
+  std::size_t _buffer_size = 0;
+  std::uint64_t _total_size = 0;
+  std::uint64_t _seed;
+};
+
+/// Returns the XXH64 hash of a block of data.
+std::uint64_t hash_content(const void* data, std::size_t size,
+                           std::uint64_t seed = 0);
+
+/// Computes the XXH64 hash of a file's contents.
+/// @return
+///   False if the file cannot be read.
+bool hash_file(const std::filesystem::path& path, std::uint64_t& hash);
+}
+
+#endif
@@ -1,12 +1,192 @@
 #include "shift/rc/data_cache.hpp"
 #include "shift/rc/resource_compiler_impl.hpp"
+#include "shift/rc/content_hash.hpp"
 #include <shift/parser/json/json.hpp>
+#include <shift/platform/mapped_file.hpp>
+#include <shift/task/parallel.hpp>
+#include <shift/task/this_task.hpp>
 #include <shift/log/log.hpp>
+#include <boost/crc.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
 
 namespace shift::rc
 {
+static constexpr std::array<char, 4> cache_magic = {{'R', 'C', 'C', 'H'}};
+// Version 2 stores write times in ticks of the file clock instead of
+// nanoseconds.
+static constexpr std::uint32_t cache_version = 2;
+
+/// References a string in the string table of binary cache files.
+struct string_reference
+{
+  std::uint32_t offset;
+  std::uint32_t size;
+};
+
+/// The header of binary cache files. It is followed by the records of all
+/// actions, rules, rule inputs, rule outputs, group-by indices, files, jobs,
+/// job file indices, and finally the string table.
+struct cache_header
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint32_t action_count;
+  std::uint32_t rule_count;
+  std::uint32_t rule_input_count;
+  std::uint32_t rule_output_count;
+  std::uint32_t group_by_count;
+  std::uint32_t file_count;
+  std::uint32_t job_count;
+  std::uint32_t job_file_count;
+  std::uint64_t string_table_size;
+  /// A CRC-32 of all preceding header fields.
+  std::uint32_t checksum;
+  std::uint32_t reserved;
+};
+
+struct cached_action_record
+{
+  string_reference name;
+  string_reference version;
+};
+
+struct cached_rule_record
+{
+  string_reference id;
+  string_reference action;
+  string_reference path;
+  /// The rule's options stored as JSON text.
+  string_reference options;
+  std::uint32_t pass;
+  std::uint32_t first_input;
+  std::uint32_t input_count;
+  std::uint32_t first_output;
+  std::uint32_t output_count;
+  std::uint32_t first_group_by;
+  std::uint32_t group_by_count;
+  std::uint32_t reserved;
+};
+
+/// A named rule input pattern or output path.
+struct cached_slot_record
+{
+  string_reference name;
+  string_reference value;
+};
+
+struct cached_file_record
+{
+  /// The last write time in ticks of the file clock since its epoch.
+  std::int64_t write_time;
+  std::uint64_t size;
+  std::uint64_t content_hash;
+  /// The id of the job which generated the file, if has_source is set.
+  std::uint64_t source;
+  string_reference path;
+  std::uint32_t pass;
+  std::uint32_t has_source;
+};
+
+struct cached_job_record
+{
+  std::uint64_t id;
+  string_reference rule;
+  /// The index of the job's first entry in the job file index table. All
+  /// input file indices are followed by all output file indices.
+  std::uint32_t first_file;
+  std::uint32_t input_count;
+  std::uint32_t output_count;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(cache_header) == 56);
+static_assert(sizeof(cached_action_record) == 16);
+static_assert(sizeof(cached_rule_record) == 64);
+static_assert(sizeof(cached_slot_record) == 16);
+static_assert(sizeof(cached_file_record) == 48);
+static_assert(sizeof(cached_job_record) == 32);
+
+/// Denotes a job file which is not stored in the cache.
+static constexpr std::uint32_t missing_file = ~std::uint32_t{0};
+
+static std::uint32_t header_checksum(const cache_header& header)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(&header, offsetof(cache_header, checksum));
+  return crc.checksum();
+}
+
+// Write times are stored in ticks of the file clock, which avoids any
+// conversion that could overflow. Clocks with a period of 100ns and an epoch
+// in 1601 would already exceed the range of nanoseconds in 64 bits.
+static_assert(std::is_integral_v<file_time_t::rep> &&
+              sizeof(file_time_t::rep) <= sizeof(std::int64_t));
+
+static std::int64_t to_ticks(const file_time_t& time)
+{
+  return static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+static file_time_t from_ticks(std::int64_t ticks)
+{
+  return file_time_t{
+    file_time_t::duration{static_cast<file_time_t::rep>(ticks)}};
+}
+
+/// Returns a pointer to count records of type T at offset, and advances
+/// offset past these records.
+template <typename T>
+static const T* take_records(const std::byte* data, std::size_t& offset,
+                             std::size_t count)
+{
+  const auto* result = reinterpret_cast<const T*>(data + offset);
+  offset += count * sizeof(T);
+  return result;
+}
+
+template <typename T>
+static void write_records(std::ostream& stream, const std::vector<T>& records)
+{
+  stream.write(reinterpret_cast<const char*>(records.data()),
+               static_cast<std::streamsize>(records.size() * sizeof(T)));
+}
+
+/// Collects unique strings into a single string table.
+class string_table_builder
+{
+public:
+  string_reference intern(std::string_view value)
+  {
+    auto [iter, inserted] =
+      _references.try_emplace(std::string{value}, string_reference{});
+    if (inserted)
+    {
+      iter->second = {static_cast<std::uint32_t>(_strings.size()),
+                      static_cast<std::uint32_t>(value.size())};
+      _strings.append(value);
+    }
+    return iter->second;
+  }
+
+  const std::string& strings() const
+  {
+    return _strings;
+  }
+
+private:
+  std::unordered_map<std::string, string_reference> _references;
+  std::string _strings;
+};
+
 data_cache::data_cache(resource_compiler_impl& impl) : _impl(&impl)
 {
 }
@@ -30,12 +210,288 @@ void data_cache::register_action(std::string name, action_version version,
 bool data_cache::load(const std::filesystem::path& cache_filename)
 {
   using namespace std::chrono;
-  using namespace shift::parser;
 
   clear();
 
   if (!fs::exists(cache_filename))
     return false;
+  auto begin = steady_clock::now();
+
+  bool result = false;
+  try
+  {
+    platform::mapped_file file;
+    if (!file.open(cache_filename))
+      return false;
+    const auto* data = file.data();
+    std::vector<std::byte> data_copy;
+    if (!file.is_mapped())
+    {
+      data_copy.resize(static_cast<std::size_t>(file.size()));
+      if (!file.read(0, data_copy.data(), data_copy.size()))
+        return false;
+      data = data_copy.data();
+    }
+
+    if (file.size() >= cache_magic.size() &&
+        std::memcmp(data, cache_magic.data(), cache_magic.size()) == 0)
+    {
+      result = load_binary(data, static_cast<std::size_t>(file.size()));
+    }
+    else
+    {
+      // Import caches written by export_json or by older versions.
+      file.close();
+      result = load_json(cache_filename);
+    }
+  }
+  catch (const std::regex_error&)
+  {
+    log::warning() << "The cache contains an invalid rule input pattern.";
+    result = false;
+  }
+  if (!result)
+  {
+    clear();
+    return false;
+  }
+
+  // Check for unreferenced or invalid nodes.
+  auto file_iterator = _files.begin();
+  while (file_iterator != _files.end())
+  {
+    auto& file = *file_iterator->second;
+    if (!file.flags.test(entity_flag::used))
+    {
+      if (_impl->verbose >= 2)
+      {
+        log::info() << R"(Removing unreferenced file ")" << file.generic_string
+                    << R"(" from cache.)";
+      }
+      file_iterator = _files.erase(file_iterator);
+    }
+    else
+      ++file_iterator;
+  }
+
+  if (_impl->verbose >= 1)
+  {
+    log::info() << "Loaded " << _rules.size() << " rules, " << _jobs.size()
+                << " jobs and " << _files.size() << " files from cache in "
+                << duration_cast<duration<double, std::milli>>(
+                     steady_clock::now() - begin)
+                     .count()
+                << " ms.";
+  }
+  return true;
+}
+
+bool data_cache::load_binary(const std::byte* data, std::size_t size)
+{
+  cache_header header;
+  if (size < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != cache_magic || header.version != cache_version ||
+      header.checksum != header_checksum(header))
+  {
+    log::warning() << "The cache file has an unsupported version.";
+    return false;
+  }
+  if (header.string_table_size > size ||
+      sizeof(header) +
+          header.action_count * std::uint64_t{sizeof(cached_action_record)} +
+          header.rule_count * std::uint64_t{sizeof(cached_rule_record)} +
+          header.rule_input_count * std::uint64_t{sizeof(cached_slot_record)} +
+          header.rule_output_count *
+            std::uint64_t{sizeof(cached_slot_record)} +
+          header.group_by_count * std::uint64_t{sizeof(std::uint64_t)} +
+          header.file_count * std::uint64_t{sizeof(cached_file_record)} +
+          header.job_count * std::uint64_t{sizeof(cached_job_record)} +
+          header.job_file_count * std::uint64_t{sizeof(std::uint32_t)} +
+          header.string_table_size !=
+        size)
+  {
+    log::warning() << "The cache file is truncated.";
+    return false;
+  }
+
+  std::size_t offset = sizeof(header);
+  const auto* actions =
+    take_records<cached_action_record>(data, offset, header.action_count);
+  const auto* rules =
+    take_records<cached_rule_record>(data, offset, header.rule_count);
+  const auto* rule_inputs =
+    take_records<cached_slot_record>(data, offset, header.rule_input_count);
+  const auto* rule_outputs =
+    take_records<cached_slot_record>(data, offset, header.rule_output_count);
+  const auto* group_by_values =
+    take_records<std::uint64_t>(data, offset, header.group_by_count);
+  const auto* files =
+    take_records<cached_file_record>(data, offset, header.file_count);
+  const auto* jobs =
+    take_records<cached_job_record>(data, offset, header.job_count);
+  const auto* job_files =
+    take_records<std::uint32_t>(data, offset, header.job_file_count);
+  const auto* strings = reinterpret_cast<const char*>(data + offset);
+
+  bool valid = true;
+  auto get_string = [&](string_reference reference) {
+    if (std::uint64_t{reference.offset} + reference.size >
+        header.string_table_size)
+    {
+      valid = false;
+      return std::string_view{};
+    }
+    return std::string_view{strings + reference.offset, reference.size};
+  };
+  // Only the header is covered by the checksum, so all counts are widened
+  // before adding them up.
+  auto in_range = [](std::uint64_t first, std::uint64_t count,
+                     std::uint64_t total) { return first + count <= total; };
+
+  for (std::uint32_t action_index = 0; action_index < header.action_count;
+       ++action_index)
+  {
+    const auto& action = actions[action_index];
+    auto name = get_string(action.name);
+    auto version = get_string(action.version);
+    if (!valid)
+      return false;
+    load_action(name, version);
+  }
+
+  for (std::uint32_t rule_index = 0; rule_index < header.rule_count;
+       ++rule_index)
+  {
+    const auto& rule = rules[rule_index];
+    if (!in_range(rule.first_input, rule.input_count,
+                  header.rule_input_count) ||
+        !in_range(rule.first_output, rule.output_count,
+                  header.rule_output_count) ||
+        !in_range(rule.first_group_by, rule.group_by_count,
+                  header.group_by_count))
+    {
+      return false;
+    }
+
+    auto new_rule = std::make_unique<rule_description>();
+    new_rule->id = get_string(rule.id);
+    new_rule->pass = rule.pass;
+    new_rule->path = get_string(rule.path);
+    for (std::uint32_t i = 0; i < rule.input_count; ++i)
+    {
+      const auto& input = rule_inputs[rule.first_input + i];
+      std::string pattern{get_string(input.value)};
+      new_rule->inputs.insert_or_assign(
+        std::string{get_string(input.name)},
+        rule_input{pattern, rule_pattern{pattern}});
+    }
+    for (std::uint32_t i = 0; i < rule.output_count; ++i)
+    {
+      const auto& output = rule_outputs[rule.first_output + i];
+      new_rule->outputs.insert_or_assign(std::string{get_string(output.name)},
+                                         std::string{get_string(output.value)});
+    }
+    for (std::uint32_t i = 0; i < rule.group_by_count; ++i)
+    {
+      new_rule->group_by.insert(
+        static_cast<std::size_t>(group_by_values[rule.first_group_by + i]));
+    }
+
+    parser::json::value options;
+    std::istringstream options_stream{std::string{get_string(rule.options)}};
+    try
+    {
+      options_stream >> options;
+    }
+    catch (parser::json::parse_error&)
+    {
+      return false;
+    }
+    if (auto* options_object = parser::json::get_if<parser::json::object>(
+          &options);
+        options_object != nullptr)
+    {
+      new_rule->options = std::move(*options_object);
+    }
+    else
+      return false;
+
+    auto action_name = get_string(rule.action);
+    if (!valid || !load_rule(std::move(new_rule), action_name))
+      return false;
+  }
+
+  std::vector<file_description*> file_pointers;
+  file_pointers.reserve(header.file_count);
+  for (std::uint32_t file_index = 0; file_index < header.file_count;
+       ++file_index)
+  {
+    const auto& file = files[file_index];
+    auto path = get_string(file.path);
+    if (!valid)
+      return false;
+    auto new_file = std::make_unique<file_description>(fs::path{path});
+    new_file->last_write_time = from_ticks(file.write_time);
+    new_file->size = file.size;
+    new_file->content_hash = file.content_hash;
+    new_file->pass = file.pass;
+    file_pointers.push_back(new_file.get());
+    if (!load_file(std::move(new_file)))
+      return false;
+  }
+
+  std::vector<file_description*> inputs;
+  std::vector<file_description*> outputs;
+  auto get_file_pointer = [&](std::uint32_t index) {
+    return index < file_pointers.size() ? file_pointers[index] : nullptr;
+  };
+  for (std::uint32_t job_index = 0; job_index < header.job_count;
+       ++job_index)
+  {
+    const auto& job = jobs[job_index];
+    if (!in_range(job.first_file,
+                  std::uint64_t{job.input_count} + job.output_count,
+                  header.job_file_count))
+    {
+      return false;
+    }
+    inputs.clear();
+    for (std::uint32_t i = 0; i < job.input_count; ++i)
+      inputs.push_back(get_file_pointer(job_files[job.first_file + i]));
+    outputs.clear();
+    for (std::uint32_t i = 0; i < job.output_count; ++i)
+    {
+      outputs.push_back(
+        get_file_pointer(job_files[job.first_file + job.input_count + i]));
+    }
+    auto rule_id = get_string(job.rule);
+    if (!valid || !load_job(static_cast<std::size_t>(job.id), rule_id, inputs,
+                            outputs))
+    {
+      return false;
+    }
+  }
+
+  // Resolve file source references once all jobs are loaded.
+  for (std::uint32_t i = 0; i < header.file_count; ++i)
+  {
+    if (files[i].has_source == 0)
+      continue;
+    if (auto job_iter = _jobs.find(static_cast<std::size_t>(files[i].source));
+        job_iter != _jobs.end())
+    {
+      file_pointers[i]->source = job_iter->second.get();
+    }
+  }
+  return true;
+}
+
+bool data_cache::load_json(const std::filesystem::path& cache_filename)
+{
+  using namespace shift::parser;
+
   json::value root;
   if (std::ifstream file{cache_filename.generic_string(),
                          std::ios_base::in | std::ios_base::binary};
@@ -54,69 +510,29 @@ bool data_cache::load(const std::filesystem::path& cache_filename)
   else
     return false;
 
-  auto& root_object = json::get<json::object>(root);
+  auto* root_object = json::get_if<json::object>(&root);
+  if (root_object == nullptr)
+    return false;
 
   // Read all cached actions.
   if (const auto* cached_actions =
-        json::get_if<json::object>(root_object, "actions");
+        json::get_if<json::object>(*root_object, "actions");
       cached_actions != nullptr)
   {
     for (const auto& cached_action : *cached_actions)
     {
-      auto& cached_action_name = cached_action.first;
       if (const auto* cached_version =
             json::get_if<std::string>(&cached_action.second);
           cached_version != nullptr)
       {
-        if (auto action_iter = _actions.find(cached_action_name);
-            action_iter != _actions.end())
-        {
-          auto& action = *action_iter->second;
-          if (action.version == *cached_version)
-          {
-            // The cached action has the same version, so remove the modified
-            // flag and set the used flag.
-            if (_impl->verbose >= 2)
-            {
-              log::info() << R"(Cached action ")" << cached_action_name
-                          << R"(" matches.)";
-            }
-            action.flags.reset(entity_flag::modified);
-            action.flags.set(entity_flag::used);
-          }
-          else
-          {
-            // The cached action has a different version than the built-in one.
-            // Keep the modified flag because we need to re-run all associated
-            // jobs. This happens if the action's implementation changed.
-            if (_impl->verbose >= 1)
-            {
-              log::info() << R"(Cached action ")" << cached_action_name
-                          << R"(" has a different version (")" << cached_version
-                          << R"(" != ")" << action.version << R"(").)";
-            }
-          }
-        }
-        else
-        {
-          // The cached action does not exist. This happens if the action was
-          // removed from code or if we're running an older version of the
-          // resource compiler using a more recent cache file. In this case we
-          // simply ignore the cached action. As a consequence, rules loaded
-          // below still using the non-existing action will also fail to load.
-          if (_impl->verbose >= 1)
-          {
-            log::info() << R"(Cached action ")" << cached_action_name
-                        << R"(" does not exist in code.)";
-          }
-        }
+        load_action(cached_action.first, *cached_version);
       }
     }
   }
 
   // Read all cached rules.
   if (const auto* cached_rules =
-        json::get_if<json::object>(root_object, "rules");
+        json::get_if<json::object>(*root_object, "rules");
       cached_rules != nullptr)
   {
     for (const auto& cached_rule : *cached_rules)
@@ -139,34 +555,15 @@ bool data_cache::load(const std::filesystem::path& cache_filename)
           continue;
         }
 
-        if (const auto* action_name =
-              json::get_if<std::string>(*rule_object, "action");
-            action_name != nullptr)
-        {
-          auto action_iter = _actions.find(*action_name);
-          // Skip this rule because the associated action does not exist. This
-          // may happen when the action is removed from code. Any cached jobs
-          // associated with this action will also fail to load.
-          if (action_iter == _actions.end())
-          {
-            log::warning() << R"(Cached rule ")" << new_rule->id
-                           << R"(" links to non-existent action ")"
-                           << *action_name << R"(".)";
-            continue;
-          }
-          new_rule->action = action_iter->second.get();
-          if (new_rule->action->flags.test(entity_flag::modified))
-            new_rule->flags.set(entity_flag::modified);
-        }
-        else
+        const auto* action_name =
+          json::get_if<std::string>(*rule_object, "action");
+        if (action_name == nullptr)
         {
           log::warning() << R"(Cached rule ")" << new_rule->id
                          << R"(" does not have a valid "action" attribute.)";
           continue;
         }
 
-        // new_rule->action->flags
-
         if (const auto* path = json::get_if<std::string>(*rule_object, "path");
             path != nullptr)
         {
@@ -190,10 +587,7 @@ bool data_cache::load(const std::filesystem::path& cache_filename)
                 input != nullptr)
             {
               new_rule->inputs.insert_or_assign(
-                input_iter.first,
-                rule_input{*input,
-                           std::regex{*input, std::regex_constants::ECMAScript |
-                                                std::regex_constants::icase}});
+                input_iter.first, rule_input{*input, rule_pattern{*input}});
             }
           }
         }
@@ -244,25 +638,22 @@ bool data_cache::load(const std::filesystem::path& cache_filename)
           continue;
         }
 
-        new_rule->options =
-          *json::get_if<json::object>(*rule_object, "options");
-
-        std::string_view id = new_rule->id;
-        if (!_rules.insert_or_assign(id, std::move(new_rule)).second)
+        if (const auto* options =
+              json::get_if<json::object>(*rule_object, "options");
+            options != nullptr)
         {
-          log::error() << R"(Found non-unique rule id ")" << id
-                       << R"(" in cache.)";
-          clear();
-          return false;
+          new_rule->options = *options;
         }
+
+        if (!load_rule(std::move(new_rule), *action_name))
+          return false;
       }
     }
   }
 
   // Read all cached files.
-  if (const auto* cached_files =
-        json::get_if<json::object>(root_object, "files");
-      cached_files != nullptr)
+  const auto* cached_files = json::get_if<json::object>(*root_object, "files");
+  if (cached_files != nullptr)
   {
     for (const auto& cached_file : *cached_files)
     {
@@ -273,196 +664,94 @@ bool data_cache::load(const std::filesystem::path& cache_filename)
         auto new_file =
           std::make_unique<file_description>(fs::path{cached_file.first});
 
-        if (json::has(*cached_file_object, "write-time") &&
-            (json::get_if<std::int64_t>(
-               &cached_file_object->at("write-time")) != nullptr))
+        if (const auto* write_time =
+              json::get_if<std::int64_t>(*cached_file_object, "write-time");
+            write_time != nullptr)
         {
-          new_file->last_write_time =
-            time_point<file_clock_t>() +
-            nanoseconds(static_cast<std::uint64_t>(
-              json::get<std::int64_t>(cached_file_object->at("write-time"))));
+          new_file->last_write_time = from_ticks(*write_time);
         }
-
-        if (json::has(*cached_file_object, "pass") &&
-            (json::get_if<std::int64_t>(&cached_file_object->at("pass")) !=
-             nullptr))
+        if (const auto* size =
+              json::get_if<std::int64_t>(*cached_file_object, "size");
+            size != nullptr)
         {
-          new_file->pass = static_cast<std::uint32_t>(
-            json::get<std::int64_t>(cached_file_object->at("pass")));
+          new_file->size = static_cast<std::uint64_t>(*size);
         }
-
-        std::string_view file_key = new_file->generic_string;
-        if (!_files.try_emplace(file_key, std::move(new_file)).second)
+        if (const auto* content_hash =
+              json::get_if<std::string>(*cached_file_object, "content-hash");
+            content_hash != nullptr)
         {
-          log::error() << R"(Found non-unique file path ")" << file_key
-                       << R"(" in cache.)";
-          clear();
-          return false;
+          std::istringstream{*content_hash} >> std::hex >>
+            new_file->content_hash;
         }
+        if (const auto* pass =
+              json::get_if<std::int64_t>(*cached_file_object, "pass");
+            pass != nullptr)
+        {
+          new_file->pass = static_cast<std::uint32_t>(*pass);
+        }
+
+        if (!load_file(std::move(new_file)))
+          return false;
       }
     }
-
-    // // Resolve alias references in a second pass to make sure that all
-    // files
-    // // are present.
-    // for (const auto& cached_file : *cached_files)
-    // {
-    //   if (const auto* cached_file_object =
-    //         json::get_if<json::object>(&cached_file.second))
-    //   {
-    //     if (json::has(*cached_file_object, "alias") &&
-    //         (json::get_if<std::string>(&cached_file_object->at("alias")) !=
-    //          nullptr))
-    //     {
-    //       if (auto* file = get_file(fs::path{cached_file.first}))
-    //       {
-    //         file->alias = get_file(fs::path{
-    //           json::get<std::string>(cached_file_object->at("alias"))});
-    //       }
-    //     }
-    //   }
-    // }
   }
 
   // Read all jobs.
-  if (const auto* cached_jobs = json::get_if<json::object>(root_object, "jobs");
+  if (const auto* cached_jobs =
+        json::get_if<json::object>(*root_object, "jobs");
       cached_jobs != nullptr)
   {
-    for (const auto& cached_job : *cached_jobs)
-    {
-      if (const auto* job_object =
-            json::get_if<json::object>(&cached_job.second))
+    std::vector<file_description*> inputs;
+    std::vector<file_description*> outputs;
+    // Looks up all files of an array of paths, where missing files and
+    // invalid values are stored as nullptr.
+    auto get_files = [&](const json::object& job_object, const char* name,
+                         std::vector<file_description*>& result) {
+      result.clear();
+      const auto* paths = json::get_if<json::array>(job_object, name);
+      if (paths == nullptr)
+        return false;
+      for (const auto& path_value : *paths)
       {
-        auto new_job = std::make_unique<job_description>();
-
-        if (!json::has(*job_object, "rule") ||
-            (json::get_if<std::string>(&job_object->at("rule")) == nullptr))
-        {
-          continue;
-        }
-        auto rule_id = json::get<std::string>(job_object->at("rule"));
-
-        if (auto rule_iter = _rules.find(rule_id); rule_iter != _rules.end())
-          new_job->rule = rule_iter->second.get();
+        if (const auto* path = json::get_if<std::string>(&path_value))
+          result.push_back(get_file(std::string_view{*path}));
         else
         {
-          /// ToDo: Log warning about missing rule reference in cached job.
-          log::warning()
-            << "Some cached job references the non-existing rule \"" << rule_id
-            << "\".";
-          continue;
-        }
-
-        if (!json::has(*job_object, "inputs") ||
-            (json::get_if<json::array>(&job_object->at("inputs")) == nullptr))
-        {
-          continue;
-        }
-        bool input_files_missing = false;
-        auto inputs_array = json::get<json::array>(job_object->at("inputs"));
-        for (const auto& input_value : inputs_array)
-        {
-          const auto* input_name = json::get_if<std::string>(&input_value);
-          if (input_name == nullptr)
-          {
-            log::warning()
-              << "The inputs array of some cached job contains "
-                 "a value that is not of type string, which will be ignored.";
-            input_files_missing = true;
-            break;
-          }
-
-          auto match = std::make_unique<input_match>();
-          match->file = get_file(std::string_view{*input_name});
-          if (match->file == nullptr)
-          {
-            input_files_missing = true;
-            break;
-          }
-          match->file->flags |= entity_flag::used;
-          std::size_t slot_index = 0;
-          for (auto input_iter = new_job->rule->inputs.begin();
-               input_iter != new_job->rule->inputs.end();
-               ++input_iter, ++slot_index)
-          {
-            if (std::regex_search(match->file->generic_string,
-                                  match->match_results,
-                                  input_iter->second.pattern))
-            {
-              match->slot = input_iter;
-              match->slot_index = slot_index;
-              new_job->inputs.insert({slot_index, std::move(match)});
-              break;
-            }
-          }
-          if (match)
-          {
-            // If match was not moved to the new job's inputs vector
-            // something is wrong.
-            input_files_missing = true;
-            break;
-          }
-        }
-
-        bool output_files_missing = false;
-        if (!json::has(*job_object, "outputs") ||
-            (json::get_if<json::array>(&job_object->at("outputs")) == nullptr))
-        {
-          continue;
-        }
-        auto outputs_array = json::get<json::array>(job_object->at("outputs"));
-        for (const auto& output_value : outputs_array)
-        {
-          const auto* output_name = json::get_if<std::string>(&output_value);
-          if (output_value == nullptr)
-          {
-            log::warning()
-              << "The outputs array of some cached job contains a value that "
-                 "is not of type string, which will be ignored.";
-            output_files_missing = true;
-            break;
-          }
-          auto* output = get_file(std::string_view{*output_name});
-          if (output == nullptr)
-          {
-            output_files_missing = true;
-            break;
-          }
-          output->flags |= entity_flag::used;
-          new_job->outputs.insert(output);
+          log::warning() << "The " << name
+                         << " array of some cached job contains a value that "
+                            "is not of type string.";
+          result.push_back(nullptr);
         }
+      }
+      return true;
+    };
 
-        if (input_files_missing || output_files_missing)
-          continue;
+    for (const auto& cached_job : *cached_jobs)
+    {
+      const auto* job_object = json::get_if<json::object>(&cached_job.second);
+      if (job_object == nullptr)
+        continue;
+      const auto* rule_id = json::get_if<std::string>(*job_object, "rule");
+      if (rule_id == nullptr || !get_files(*job_object, "inputs", inputs) ||
+          !get_files(*job_object, "outputs", outputs))
+      {
+        continue;
+      }
 
-        std::size_t job_id;
-        if (std::stringstream job_id_stream(cached_job.first);
-            !(job_id_stream >> job_id))
-        {
-          /// ToDo: Warn about bad job id.
-          continue;
-        }
-        if (job_id != std::hash<job_description>()(*new_job))
-        {
-          /// ToDo: Warn about bad job id.
-          continue;
-        }
-        new_job->id = job_id;
-        if (!_jobs.insert_or_assign(job_id, std::move(new_job)).second)
-        {
-          log::error() << R"(Found non-unique job id ")" << job_id
-                       << R"(" in cache.)";
-          clear();
-          return false;
-        }
+      std::size_t job_id;
+      if (std::stringstream job_id_stream(cached_job.first);
+          !(job_id_stream >> job_id))
+      {
+        /// ToDo: Warn about bad job id.
+        continue;
       }
+      if (!load_job(job_id, *rule_id, inputs, outputs))
+        return false;
     }
   }
 
   // Read file source references in a second pass.
-  if (const auto* cached_files =
-        json::get_if<json::object>(root_object, "files");
-      cached_files != nullptr)
+  if (cached_files != nullptr)
   {
     for (const auto& cached_file : *cached_files)
     {
@@ -488,31 +777,338 @@ bool data_cache::load(const std::filesystem::path& cache_filename)
       }
     }
   }
+  return true;
+}
 
-  // Check for unreferenced or invalid nodes.
-  auto file_iterator = _files.begin();
-  while (file_iterator != _files.end())
+void data_cache::load_action(std::string_view name, std::string_view version)
+{
+  if (auto action_iter = _actions.find(name); action_iter != _actions.end())
   {
-    auto& file = *file_iterator->second;
-    if (!file.flags.test(entity_flag::used))
+    auto& action = *action_iter->second;
+    if (action.version == version)
     {
+      // The cached action has the same version, so remove the modified
+      // flag and set the used flag.
       if (_impl->verbose >= 2)
+        log::info() << R"(Cached action ")" << name << R"(" matches.)";
+      action.flags.reset(entity_flag::modified);
+      action.flags.set(entity_flag::used);
+    }
+    else
+    {
+      // The cached action has a different version than the built-in one.
+      // Keep the modified flag because we need to re-run all associated
+      // jobs. This happens if the action's implementation changed.
+      if (_impl->verbose >= 1)
       {
-        log::info() << R"(Removing unreferenced file ")" << file.generic_string
-                    << R"(" from cache.)";
+        log::info() << R"(Cached action ")" << name
+                    << R"(" has a different version (")" << version
+                    << R"(" != ")" << action.version << R"(").)";
       }
-      file_iterator = _files.erase(file_iterator);
     }
-    else
-      ++file_iterator;
   }
+  else
+  {
+    // The cached action does not exist. This happens if the action was
+    // removed from code or if we're running an older version of the
+    // resource compiler using a more recent cache file. In this case we
+    // simply ignore the cached action. As a consequence, rules loaded
+    // below still using the non-existing action will also fail to load.
+    if (_impl->verbose >= 1)
+    {
+      log::info() << R"(Cached action ")" << name
+                  << R"(" does not exist in code.)";
+    }
+  }
+}
+
+bool data_cache::load_rule(std::unique_ptr<rule_description> rule,
+                           std::string_view action_name)
+{
+  auto action_iter = _actions.find(action_name);
+  // Skip this rule because the associated action does not exist. This
+  // may happen when the action is removed from code. Any cached jobs
+  // associated with this action will also fail to load.
+  if (action_iter == _actions.end())
+  {
+    log::warning() << R"(Cached rule ")" << rule->id
+                   << R"(" links to non-existent action ")" << action_name
+                   << R"(".)";
+    return true;
+  }
+  rule->action = action_iter->second.get();
+  if (rule->action->flags.test(entity_flag::modified))
+    rule->flags.set(entity_flag::modified);
 
+  std::string_view id = rule->id;
+  if (!_rules.insert_or_assign(id, std::move(rule)).second)
+  {
+    log::error() << R"(Found non-unique rule id ")" << id << R"(" in cache.)";
+    return false;
+  }
   return true;
 }
 
-void data_cache::save(const std::filesystem::path& cache_filename) const
+bool data_cache::load_file(std::unique_ptr<file_description> file)
+{
+  std::string_view file_key = file->generic_string;
+  if (!_files.try_emplace(file_key, std::move(file)).second)
+  {
+    log::error() << R"(Found non-unique file path ")" << file_key
+                 << R"(" in cache.)";
+    return false;
+  }
+  return true;
+}
+
+bool data_cache::load_job(std::size_t job_id, std::string_view rule_id,
+                          const std::vector<file_description*>& inputs,
+                          const std::vector<file_description*>& outputs)
+{
+  auto new_job = std::make_unique<job_description>();
+  if (auto rule_iter = _rules.find(rule_id); rule_iter != _rules.end())
+    new_job->rule = rule_iter->second.get();
+  else
+  {
+    log::warning() << "Some cached job references the non-existing rule \""
+                   << rule_id << "\".";
+    return true;
+  }
+
+  for (auto* file : inputs)
+  {
+    if (file == nullptr)
+      return true;
+    file->flags |= entity_flag::used;
+
+    auto match = std::make_unique<input_match>();
+    match->file = file;
+    std::size_t slot_index = 0;
+    for (auto input_iter = new_job->rule->inputs.begin();
+         input_iter != new_job->rule->inputs.end(); ++input_iter, ++slot_index)
+    {
+      if (input_iter->second.pattern.search(file->generic_string,
+                                            &match->match_results))
+      {
+        match->slot = input_iter;
+        match->slot_index = slot_index;
+        new_job->inputs.insert({slot_index, std::move(match)});
+        break;
+      }
+    }
+    // The file does not match any of the rule's inputs anymore.
+    if (match)
+      return true;
+  }
+
+  for (auto* file : outputs)
+  {
+    if (file == nullptr)
+      return true;
+    file->flags |= entity_flag::used;
+    new_job->outputs.insert(file);
+  }
+
+  if (job_id != std::hash<job_description>()(*new_job))
+  {
+    /// ToDo: Warn about bad job id.
+    return true;
+  }
+  new_job->id = job_id;
+  if (!_jobs.insert_or_assign(job_id, std::move(new_job)).second)
+  {
+    log::error() << R"(Found non-unique job id ")" << job_id
+                 << R"(" in cache.)";
+    return false;
+  }
+  return true;
+}
+
+std::vector<file_description*> data_cache::files_to_save() const
 {
   using namespace std::chrono;
+
+  std::vector<file_description*> result;
+  for (auto& [file_path, file] : _impl->files)
+  {
+    if (!(file->flags & entity_flag::exists) ||
+        !(file->flags & entity_flag::used))
+    {
+      continue;
+    }
+
+    auto previous_write_time = file->last_write_time;
+    auto previous_size = file->size;
+    /// ToDo: This hack is required because some files magically change their
+    /// time-stamp when it is queried right after the files were closed.
+#if defined(_MSC_VER)
+    // This ugly hack attempts to convert a std::filesystem::file_time_type to
+    // system_clock::time_point. It likely produces wrong results
+    // because there is no guarantee that both clocks have the same epoch.
+    // C++20 will fix this issue and make clocks convertible.
+    auto last_write_time = fs::last_write_time(file_path);
+    file->last_write_time = system_clock::time_point(
+      system_clock::duration(decltype(last_write_time)::clock::duration::rep{
+        last_write_time.time_since_epoch().count()}));
+#else
+    file->last_write_time = fs::last_write_time(file_path);
+#endif
+    file->size = fs::file_size(file_path);
+    if (file->last_write_time != previous_write_time ||
+        file->size != previous_size)
+    {
+      file->content_hash = 0;
+    }
+    result.push_back(file.get());
+  }
+
+  // Hashing files that were generated in this run is the main cost of saving.
+  update_fingerprints(result);
+  return result;
+}
+
+void data_cache::save(const std::filesystem::path& cache_filename) const
+{
+  string_table_builder strings;
+
+  std::vector<cached_action_record> actions;
+  for (const auto& [action_name, action] : _actions)
+  {
+    actions.push_back(
+      {strings.intern(action_name), strings.intern(action->version)});
+  }
+
+  std::vector<cached_rule_record> rules;
+  std::vector<cached_slot_record> rule_inputs;
+  std::vector<cached_slot_record> rule_outputs;
+  std::vector<std::uint64_t> group_by_values;
+  for (const auto& rule : _impl->rules)
+  {
+    if (rule->action == nullptr)
+      continue;
+
+    std::ostringstream options;
+    options << rule->options;
+
+    auto& record = rules.emplace_back();
+    record.id = strings.intern(rule->id);
+    record.action = strings.intern(rule->action->name);
+    record.path = strings.intern(rule->path.generic_string());
+    record.options = strings.intern(options.str());
+    record.pass = rule->pass;
+    record.first_input = static_cast<std::uint32_t>(rule_inputs.size());
+    record.input_count = static_cast<std::uint32_t>(rule->inputs.size());
+    for (const auto& input : rule->inputs)
+    {
+      rule_inputs.push_back(
+        {strings.intern(input.first), strings.intern(input.second.source)});
+    }
+    record.first_output = static_cast<std::uint32_t>(rule_outputs.size());
+    record.output_count = static_cast<std::uint32_t>(rule->outputs.size());
+    for (const auto& output : rule->outputs)
+    {
+      rule_outputs.push_back(
+        {strings.intern(output.first), strings.intern(output.second)});
+    }
+    record.first_group_by = static_cast<std::uint32_t>(group_by_values.size());
+    record.group_by_count = static_cast<std::uint32_t>(rule->group_by.size());
+    group_by_values.insert(group_by_values.end(), rule->group_by.begin(),
+                           rule->group_by.end());
+    record.reserved = 0;
+  }
+
+  std::vector<cached_file_record> files;
+  std::unordered_map<std::string_view, std::uint32_t> file_indices;
+  for (const auto* file : files_to_save())
+  {
+    file_indices.try_emplace(file->generic_string,
+                             static_cast<std::uint32_t>(files.size()));
+    auto& record = files.emplace_back();
+    record.write_time = to_ticks(file->last_write_time);
+    record.size = file->size;
+    record.content_hash = file->content_hash;
+    record.source = file->source != nullptr ? file->source->id : 0;
+    record.path = strings.intern(file->generic_string);
+    record.pass = file->pass;
+    record.has_source = file->source != nullptr ? 1 : 0;
+  }
+
+  std::vector<cached_job_record> jobs;
+  std::vector<std::uint32_t> job_files;
+  auto file_index = [&](const file_description& file) {
+    auto iter = file_indices.find(file.generic_string);
+    return iter != file_indices.end() ? iter->second : missing_file;
+  };
+  for (const auto& [job_id, job] : _jobs)
+  {
+    // Don't cache jobs that failed execution.
+    if (job->flags.test(entity_flag::failed))
+      continue;
+
+    auto& record = jobs.emplace_back();
+    record.id = job_id;
+    record.rule = strings.intern(job->rule->id);
+    record.first_file = static_cast<std::uint32_t>(job_files.size());
+    record.input_count = static_cast<std::uint32_t>(job->inputs.size());
+    record.output_count = static_cast<std::uint32_t>(job->outputs.size());
+    record.reserved = 0;
+    for (const auto& [input_slot_index, input] : job->inputs)
+      job_files.push_back(file_index(*input->file));
+    for (const auto* output : job->outputs)
+      job_files.push_back(file_index(*output));
+  }
+
+  cache_header header;
+  header.magic = cache_magic;
+  header.version = cache_version;
+  header.action_count = static_cast<std::uint32_t>(actions.size());
+  header.rule_count = static_cast<std::uint32_t>(rules.size());
+  header.rule_input_count = static_cast<std::uint32_t>(rule_inputs.size());
+  header.rule_output_count = static_cast<std::uint32_t>(rule_outputs.size());
+  header.group_by_count = static_cast<std::uint32_t>(group_by_values.size());
+  header.file_count = static_cast<std::uint32_t>(files.size());
+  header.job_count = static_cast<std::uint32_t>(jobs.size());
+  header.job_file_count = static_cast<std::uint32_t>(job_files.size());
+  header.string_table_size = strings.strings().size();
+  header.checksum = header_checksum(header);
+  header.reserved = 0;
+
+  // Write to a temporary file first, so that a crash cannot leave a corrupt
+  // cache behind.
+  auto temporary_filename = cache_filename;
+  temporary_filename += ".tmp";
+  {
+    std::ofstream file{temporary_filename.generic_string(),
+                       std::ios_base::out | std::ios_base::binary |
+                         std::ios_base::trunc};
+    if (!file.is_open())
+      return;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_records(file, actions);
+    write_records(file, rules);
+    write_records(file, rule_inputs);
+    write_records(file, rule_outputs);
+    write_records(file, group_by_values);
+    write_records(file, files);
+    write_records(file, jobs);
+    write_records(file, job_files);
+    file.write(strings.strings().data(),
+               static_cast<std::streamsize>(strings.strings().size()));
+    if (!file.good())
+      return;
+  }
+  std::error_code error_code;
+  fs::rename(temporary_filename, cache_filename, error_code);
+  if (error_code)
+  {
+    log::error() << "Cannot write cache file " << cache_filename << ": "
+                 << error_code.message();
+  }
+}
+
+void data_cache::export_json(const std::filesystem::path& json_filename) const
+{
   using namespace shift::parser;
 
   json::object root;
@@ -580,52 +1176,34 @@ void data_cache::save(const std::filesystem::path& cache_filename) const
 
   // Cache all existing files.
   auto& files_object = json::get<json::object>(root["files"] = json::object{});
-  for (auto& file : _impl->files)
+  for (const auto* file : files_to_save())
   {
-    if (!(file.second->flags & entity_flag::exists) ||
-        !(file.second->flags & entity_flag::used))
-    {
-      continue;
-    }
-
     auto& file_object = json::get<json::object>(
-      files_object[file.first.generic_string()] = json::object{});
-    /// ToDo: This hack is required because some files magically change their
-    /// time-stamp when it is queried right after the files were closed.
-#if defined(_MSC_VER)
-    // This ugly hack attempts to convert a std::filesystem::file_time_type to
-    // system_clock::time_point. It likely produces wrong results
-    // because there is no guarantee that both clocks have the same epoch.
-    // C++20 will fix this issue and make clocks convertible.
-    auto last_write_time = fs::last_write_time(file.first);
-    file.second->last_write_time = system_clock::time_point(
-      system_clock::duration(decltype(last_write_time)::clock::duration::rep{
-        last_write_time.time_since_epoch().count()}));
-#else
-    file.second->last_write_time = fs::last_write_time(file.first);
-#endif
-    file_object["write-time"] = static_cast<std::int64_t>(
-      duration_cast<nanoseconds>(
-        file.second->last_write_time.time_since_epoch())
-        .count());
-    if (file.second->pass > 0)
-      file_object["pass"] = static_cast<std::int64_t>(file.second->pass);
-    if ((file.second->alias != nullptr) &&
-        (file.second->alias->flags & entity_flag::exists) &&
-        (file.second->alias->flags & entity_flag::used))
+      files_object[file->generic_string] = json::object{});
+    file_object["write-time"] = to_ticks(file->last_write_time);
+    file_object["size"] = static_cast<std::int64_t>(file->size);
+    if (file->content_hash != 0)
     {
-      file_object["alias"] = file.second->alias->generic_string;
+      std::ostringstream content_hash;
+      content_hash << std::hex << std::setw(16) << std::setfill('0')
+                   << file->content_hash;
+      file_object["content-hash"] = content_hash.str();
     }
-    if (file.second->source != nullptr)
+    if (file->pass > 0)
+      file_object["pass"] = static_cast<std::int64_t>(file->pass);
+    if ((file->alias != nullptr) &&
+        (file->alias->flags & entity_flag::exists) &&
+        (file->alias->flags & entity_flag::used))
     {
-      file_object["source"] =
-        static_cast<std::int64_t>(file.second->source->id);
+      file_object["alias"] = file->alias->generic_string;
     }
+    if (file->source != nullptr)
+      file_object["source"] = static_cast<std::int64_t>(file->source->id);
   }
 
-  std::ofstream file{cache_filename.generic_string(), std::ios_base::out |
-                                                        std::ios_base::binary |
-                                                        std::ios_base::trunc};
+  std::ofstream file{json_filename.generic_string(), std::ios_base::out |
+                                                       std::ios_base::binary |
+                                                       std::ios_base::trunc};
   if (!file.is_open())
     return;
 
@@ -782,23 +1360,29 @@ bool data_cache::is_modified(const file_description& file) const
   auto cached_file_iter = _files.find(file.generic_string);
   if (cached_file_iter != _files.end())
   {
-    if (file.last_write_time != cached_file_iter->second->last_write_time)
+    const auto& cached_file = *cached_file_iter->second;
+    if (file.last_write_time == cached_file.last_write_time)
+      return false;
+    if (file.content_hash != 0 &&
+        file.content_hash == cached_file.content_hash &&
+        file.size == cached_file.size)
     {
       if (_impl->verbose >= 2)
       {
         log::debug() << R"(File ")" << file.generic_string
-                     << R"(" modified because timestamps do not match ()"
-                     << file.last_write_time.time_since_epoch().count()
-                     << " != "
-                     << cached_file_iter->second->last_write_time
-                          .time_since_epoch()
-                          .count()
-                     << ").";
+                     << R"(" has a new timestamp but unchanged contents.)";
       }
-      return true;
-    }
-    else
       return false;
+    }
+    if (_impl->verbose >= 2)
+    {
+      log::debug() << R"(File ")" << file.generic_string
+                   << R"(" modified because timestamps do not match ()"
+                   << file.last_write_time.time_since_epoch().count() << " != "
+                   << cached_file.last_write_time.time_since_epoch().count()
+                   << ").";
+    }
+    return true;
   }
   if (_impl->verbose >= 2)
   {
@@ -807,4 +1391,59 @@ bool data_cache::is_modified(const file_description& file) const
   }
   return true;
 }
+
+void data_cache::update_fingerprint(file_description& file) const
+{
+  if (file.content_hash != 0)
+    return;
+
+  const file_description* cached_file = nullptr;
+  if (auto cached_file_iter = _files.find(file.generic_string);
+      cached_file_iter != _files.end())
+  {
+    cached_file = cached_file_iter->second.get();
+    if (cached_file->content_hash != 0 && cached_file->size == file.size &&
+        cached_file->last_write_time == file.last_write_time)
+    {
+      file.content_hash = cached_file->content_hash;
+      return;
+    }
+  }
+
+  if (!hash_file(file.path, file.content_hash))
+  {
+    file.content_hash = 0;
+    return;
+  }
+  if (cached_file != nullptr &&
+      cached_file->last_write_time != file.last_write_time &&
+      cached_file->content_hash == file.content_hash &&
+      cached_file->size == file.size)
+  {
+    ++_unchanged_content_count;
+  }
+}
+
+void data_cache::update_fingerprints(
+  const std::vector<file_description*>& files) const
+{
+  // Each file must only be hashed by a single task.
+  auto unique_files = files;
+  std::sort(unique_files.begin(), unique_files.end());
+  unique_files.erase(std::unique(unique_files.begin(), unique_files.end()),
+                     unique_files.end());
+
+  auto update = [&](file_description* file) { update_fingerprint(*file); };
+  if (task::this_task::inside_task())
+  {
+    task::parallel_for(unique_files.begin(), unique_files.end(), update);
+  }
+  else
+    std::for_each(unique_files.begin(), unique_files.end(), update);
+}
+
+std::size_t data_cache::unchanged_content_count() const
+{
+  return _unchanged_content_count;
+}
 }
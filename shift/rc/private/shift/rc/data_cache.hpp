@@ -1,7 +1,9 @@
 #ifndef SHIFT_RC_DATA_CACHE_HPP
 #define SHIFT_RC_DATA_CACHE_HPP
 
+#include <atomic>
 #include <filesystem>
+#include <shift/core/hash_table.hpp>
 #include "shift/rc/types.hpp"
 
 namespace shift::rc
@@ -25,7 +27,7 @@ public:
   void register_action(std::string name, action_version version,
                        action_base& impl);
 
-  /// Loads cached data from a previously saved JSON file.
+  /// Loads cached data from a previously saved cache file.
   /// @pre
   ///   All built-in actions must be registered before loading the cache file.
   /// @post
@@ -36,11 +38,22 @@ public:
   ///   Only those that are found in this cache are reset to unmodified. Note
   ///   that jobs and files are created dynamically during run-time and their
   ///   modification state get evaluated later on.
+  ///   Both the binary format written by save() and the JSON format written
+  ///   by export_json() are accepted.
   bool load(const std::filesystem::path& cache_filename);
 
-  /// Saves all cached data to a JSON file.
+  /// Saves all cached data to a binary file.
+  /// @remarks
+  ///   The file starts with a header followed by fixed size records of all
+  ///   actions, rules, files and jobs. All strings are interned in a single
+  ///   string table, and jobs reference files by index. Loading thus requires
+  ///   neither parsing nor path lookups, and is a linear pass over a memory
+  ///   mapped file.
   void save(const std::filesystem::path& cache_filename) const;
 
+  /// Saves all cached data to a human readable JSON file for debugging.
+  void export_json(const std::filesystem::path& json_filename) const;
+
   /// Saves a GraphViz document of the file cache.
   void save_graph(const fs::path& graph_filename) const;
 
@@ -79,17 +92,69 @@ public:
   bool is_modified(const job_description& job) const;
 
   /// Checks whether a file is modified compared to the ones cached.
+  /// @remarks
+  ///   Files with a different timestamp are still considered unmodified if
+  ///   their size and content hash match the cached ones.
   bool is_modified(const file_description& file) const;
 
+  /// Computes the content hash of a file unless it is already known.
+  /// @remarks
+  ///   The hash is taken from the cache if the file's size and timestamp did
+  ///   not change. Otherwise, the file is read and hashed.
+  void update_fingerprint(file_description& file) const;
+
+  /// Computes content hashes of a list of files in parallel.
+  /// @remarks
+  ///   Files are processed serially if not called from within a task.
+  void update_fingerprints(
+    const std::vector<file_description*>& files) const;
+
+  /// Returns the number of files whose timestamp changed since they were
+  /// cached but whose contents are still the same.
+  std::size_t unchanged_content_count() const;
+
 private:
+  /// Applies a cached action version.
+  void load_action(std::string_view name, std::string_view version);
+
+  /// Adds a cached rule, unless its action does not exist anymore.
+  /// @return
+  ///   False if the rule id is not unique.
+  bool load_rule(std::unique_ptr<rule_description> rule,
+                 std::string_view action_name);
+
+  /// Adds a cached file.
+  /// @return
+  ///   False if the file path is not unique.
+  bool load_file(std::unique_ptr<file_description> file);
+
+  /// Adds a cached job, unless its rule or any of its files are missing, or
+  /// the job's id does not match its contents.
+  /// @param inputs
+  ///   The job's input files, where nullptr denotes a missing file.
+  /// @return
+  ///   False if the job id is not unique.
+  bool load_job(std::size_t job_id, std::string_view rule_id,
+                const std::vector<file_description*>& inputs,
+                const std::vector<file_description*>& outputs);
+
+  /// Reads the binary cache format.
+  bool load_binary(const std::byte* data, std::size_t size);
+
+  /// Reads the JSON cache format.
+  bool load_json(const std::filesystem::path& cache_filename);
+
+  /// Refreshes the timestamps and content hashes of all files that are going
+  /// to be saved, and returns them.
+  std::vector<file_description*> files_to_save() const;
+
   resource_compiler_impl* _impl = nullptr;
-  std::unordered_map<std::string_view, std::unique_ptr<action_description>>
+  core::hash_table<std::string_view, std::unique_ptr<action_description>>
     _actions;
-  std::unordered_map<std::string_view, std::unique_ptr<rule_description>>
-    _rules;
-  std::unordered_map<std::string_view, std::unique_ptr<file_description>>
-    _files;
-  std::unordered_map<std::size_t, std::unique_ptr<job_description>> _jobs;
+  core::hash_table<std::string_view, std::unique_ptr<rule_description>> _rules;
+  core::hash_table<std::string_view, std::unique_ptr<file_description>> _files;
+  core::hash_table<std::size_t, std::unique_ptr<job_description>> _jobs;
+  mutable std::atomic_size_t _unchanged_content_count{0};
 };
 }
 
@@ -0,0 +1,301 @@
+#include "shift/rc/directory_artifact_store.hpp"
+#include "shift/rc/content_hash.hpp"
+#include <shift/parser/json/json.hpp>
+#include <shift/platform/mapped_file.hpp>
+#include <shift/log/log.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+namespace shift::rc
+{
+namespace fs = std::filesystem;
+
+static const std::string manifest_filename = "manifest.json";
+static const std::string temporary_folder_name = ".tmp";
+
+static std::string to_hex(std::uint64_t value)
+{
+  std::ostringstream result;
+  result << std::hex << std::setw(16) << std::setfill('0') << value;
+  return result.str();
+}
+
+static bool from_hex(const std::string& text, std::uint64_t& value)
+{
+  std::istringstream stream{text};
+  return static_cast<bool>(stream >> std::hex >> value);
+}
+
+/// Returns the total size of all files in a folder.
+static std::uint64_t folder_size(const fs::path& path)
+{
+  std::error_code error_code;
+  std::uint64_t result = 0;
+  for (fs::directory_iterator entry{path, error_code}, end;
+       !error_code && entry != end; entry.increment(error_code))
+  {
+    auto size = fs::file_size(entry->path(), error_code);
+    if (!error_code)
+      result += size;
+  }
+  return result;
+}
+
+artifact_store::~artifact_store() = default;
+
+directory_artifact_store::directory_artifact_store(fs::path path)
+: _path(std::move(path))
+{
+}
+
+bool directory_artifact_store::find(artifact_key key,
+                                    std::vector<artifact_output>& outputs)
+{
+  using namespace shift::parser;
+
+  auto manifest_path = artifact_path(key) / manifest_filename;
+  json::value root;
+  if (std::ifstream file{manifest_path.generic_string(),
+                         std::ios_base::in | std::ios_base::binary};
+      file.is_open())
+  {
+    try
+    {
+      file >> root;
+    }
+    catch (json::parse_error&)
+    {
+      return false;
+    }
+  }
+  else
+    return false;
+
+  const auto* root_object = json::get_if<json::object>(&root);
+  if (root_object == nullptr)
+    return false;
+  const auto* output_array = json::get_if<json::array>(*root_object, "outputs");
+  if (output_array == nullptr)
+    return false;
+
+  outputs.clear();
+  for (const auto& output_value : *output_array)
+  {
+    const auto* output_object = json::get_if<json::object>(&output_value);
+    if (output_object == nullptr)
+      return false;
+    const auto* path = json::get_if<std::string>(*output_object, "path");
+    const auto* size = json::get_if<std::int64_t>(*output_object, "size");
+    const auto* content_hash =
+      json::get_if<std::string>(*output_object, "content-hash");
+    const auto* id = json::get_if<std::string>(*output_object, "id");
+    if (path == nullptr || size == nullptr || content_hash == nullptr ||
+        id == nullptr)
+    {
+      return false;
+    }
+
+    auto& output = outputs.emplace_back();
+    output.path = *path;
+    output.size = static_cast<std::uint64_t>(*size);
+    if (!from_hex(*content_hash, output.content_hash) ||
+        !from_hex(*id, output.id))
+    {
+      return false;
+    }
+    if (const auto* alias = json::get_if<std::string>(*output_object, "alias");
+        alias != nullptr)
+    {
+      output.alias = *alias;
+    }
+  }
+
+  // Mark the artifact as recently used.
+  std::error_code error_code;
+  fs::last_write_time(manifest_path, fs::file_time_type::clock::now(),
+                      error_code);
+  return true;
+}
+
+bool directory_artifact_store::fetch(artifact_key key,
+                                     std::size_t output_index,
+                                     const artifact_output& output,
+                                     const fs::path& target_path)
+{
+  auto source_path = artifact_path(key) / std::to_string(output_index);
+
+  platform::mapped_file source;
+  if (!source.open(source_path))
+    return false;
+  const std::byte* data = source.data();
+  std::vector<std::byte> data_copy;
+  if (!source.is_mapped())
+  {
+    data_copy.resize(static_cast<std::size_t>(source.size()));
+    if (!source.read(0, data_copy.data(), data_copy.size()))
+      return false;
+    data = data_copy.data();
+  }
+
+  if (source.size() != output.size ||
+      hash_content(data, static_cast<std::size_t>(source.size())) !=
+        output.content_hash)
+  {
+    log::warning() << "Removing corrupt artifact " << to_hex(key)
+                   << " from store " << _path << ".";
+    source.close();
+    std::error_code error_code;
+    fs::remove_all(artifact_path(key), error_code);
+    return false;
+  }
+
+  std::error_code error_code;
+  fs::create_directories(target_path.parent_path(), error_code);
+  auto temporary_path = target_path;
+  temporary_path += ".artifact";
+  {
+    std::ofstream target{temporary_path.generic_string(),
+                         std::ios_base::out | std::ios_base::binary |
+                           std::ios_base::trunc};
+    if (!target.is_open())
+      return false;
+    target.write(reinterpret_cast<const char*>(data),
+                 static_cast<std::streamsize>(source.size()));
+    if (!target.good())
+      return false;
+  }
+  fs::rename(temporary_path, target_path, error_code);
+  return !error_code;
+}
+
+bool directory_artifact_store::store(
+  artifact_key key, const std::vector<artifact_output>& outputs,
+  const std::vector<fs::path>& source_paths)
+{
+  using namespace shift::parser;
+
+  BOOST_ASSERT(outputs.size() == source_paths.size());
+  auto final_path = artifact_path(key);
+  std::error_code error_code;
+  if (fs::exists(final_path / manifest_filename, error_code))
+    return true;
+
+  // Use a unique temporary folder, because other processes might store the
+  // same artifact at the same time.
+  thread_local std::mt19937_64 random_engine{std::random_device{}()};
+  auto temporary_path = _path / temporary_folder_name /
+                        (to_hex(key) + "-" + to_hex(random_engine()));
+  if (!fs::create_directories(temporary_path, error_code))
+    return false;
+
+  json::array output_array;
+  bool result = true;
+  for (std::size_t i = 0; i < outputs.size() && result; ++i)
+  {
+    const auto& output = outputs[i];
+    result = fs::copy_file(source_paths[i], temporary_path / std::to_string(i),
+                           error_code) &&
+             !error_code;
+
+    json::object output_object;
+    output_object["path"] = output.path;
+    output_object["size"] = static_cast<std::int64_t>(output.size);
+    output_object["content-hash"] = to_hex(output.content_hash);
+    output_object["id"] = to_hex(output.id);
+    if (!output.alias.empty())
+      output_object["alias"] = output.alias;
+    output_array.emplace_back(std::move(output_object));
+  }
+
+  if (result)
+  {
+    json::object root;
+    root["outputs"] = std::move(output_array);
+    auto manifest_path = temporary_path / manifest_filename;
+    std::ofstream manifest{manifest_path.generic_string(),
+                           std::ios_base::out | std::ios_base::binary |
+                             std::ios_base::trunc};
+    manifest << core::indent_character(' ') << core::indent_width(2);
+    manifest << root;
+    result = manifest.good();
+  }
+
+  if (result)
+  {
+    fs::create_directories(final_path.parent_path(), error_code);
+    fs::rename(temporary_path, final_path, error_code);
+    // Another process may have stored the same artifact in the meantime.
+    result = !error_code || fs::exists(final_path / manifest_filename);
+  }
+  fs::remove_all(temporary_path, error_code);
+  return result;
+}
+
+std::size_t directory_artifact_store::evict(std::uint64_t max_size,
+                                            std::chrono::seconds max_age)
+{
+  struct artifact_entry
+  {
+    fs::path path;
+    fs::file_time_type last_access;
+    std::uint64_t size;
+  };
+
+  auto now = fs::file_time_type::clock::now();
+  std::vector<artifact_entry> artifacts;
+  std::uint64_t total_size = 0;
+  std::size_t removed_count = 0;
+  std::error_code prefix_error_code;
+  for (fs::directory_iterator prefix{_path, prefix_error_code}, end;
+       !prefix_error_code && prefix != end; prefix.increment(prefix_error_code))
+  {
+    if (!prefix->is_directory() ||
+        prefix->path().filename() == temporary_folder_name)
+    {
+      continue;
+    }
+    std::error_code entry_error_code;
+    for (fs::directory_iterator entry{prefix->path(), entry_error_code};
+         !entry_error_code && entry != end; entry.increment(entry_error_code))
+    {
+      std::error_code error_code;
+      auto last_access =
+        fs::last_write_time(entry->path() / manifest_filename, error_code);
+      if (error_code || now - last_access > max_age)
+      {
+        // Also remove incomplete artifacts without a manifest.
+        fs::remove_all(entry->path(), error_code);
+        ++removed_count;
+        continue;
+      }
+      auto size = folder_size(entry->path());
+      artifacts.push_back({entry->path(), last_access, size});
+      total_size += size;
+    }
+  }
+
+  std::sort(artifacts.begin(), artifacts.end(),
+            [](const auto& lhs, const auto& rhs) {
+              return lhs.last_access < rhs.last_access;
+            });
+  for (const auto& artifact : artifacts)
+  {
+    if (total_size <= max_size)
+      break;
+    std::error_code error_code;
+    fs::remove_all(artifact.path, error_code);
+    total_size -= artifact.size;
+    ++removed_count;
+  }
+  return removed_count;
+}
+
+fs::path directory_artifact_store::artifact_path(artifact_key key) const
+{
+  auto name = to_hex(key);
+  return _path / name.substr(0, 2) / name;
+}
+}
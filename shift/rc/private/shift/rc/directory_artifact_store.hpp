@@ -0,0 +1,46 @@
+#ifndef SHIFT_RC_DIRECTORY_ARTIFACT_STORE_HPP
+#define SHIFT_RC_DIRECTORY_ARTIFACT_STORE_HPP
+
+#include "shift/rc/artifact_store.hpp"
+
+namespace shift::rc
+{
+/// An artifact store which keeps each artifact in a separate folder of a
+/// local or network directory.
+/// @remarks
+///   Each artifact folder contains a "manifest.json" file listing all
+///   outputs, followed by one file per output named by its index. Artifacts
+///   are written to a temporary folder first and then renamed, so readers
+///   never see incomplete artifacts. The manifest's timestamp is refreshed
+///   on each hit and serves as the artifact's last access time for eviction.
+class directory_artifact_store final : public artifact_store
+{
+public:
+  /// Constructor.
+  directory_artifact_store(std::filesystem::path path);
+
+  ///
+  bool find(artifact_key key, std::vector<artifact_output>& outputs) override;
+
+  ///
+  bool fetch(artifact_key key, std::size_t output_index,
+             const artifact_output& output,
+             const std::filesystem::path& target_path) override;
+
+  ///
+  bool store(artifact_key key, const std::vector<artifact_output>& outputs,
+             const std::vector<std::filesystem::path>& source_paths) override;
+
+  ///
+  std::size_t evict(std::uint64_t max_size,
+                    std::chrono::seconds max_age) override;
+
+private:
+  /// Returns the folder of an artifact.
+  std::filesystem::path artifact_path(artifact_key key) const;
+
+  std::filesystem::path _path;
+};
+}
+
+#endif
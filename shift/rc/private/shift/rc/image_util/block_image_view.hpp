@@ -163,14 +163,26 @@ public:
   //    converter(pixel, _read_cache[x % block_width][y % block_height]);
   //  }
 
+  /// Selects the squish compressor used by write_pixel_block.
+  /// @param flags
+  ///   A combination of squish::squish_flag::compressor_* flags, or an empty
+  ///   set to use the squish default.
+  void compressor(squish::flags_t flags)
+  {
+    _flags = _flags | flags;
+  }
+
   /// Writes a compressed pixel block.
   /// @param block_x
   ///   The n-th block on the x-axis.
   /// @param block_y
   ///   The n-th block on the y-axis.
+  /// @remarks
+  ///   This method doesn't modify the view, so different blocks may be
+  ///   written concurrently.
   void write_pixel_block(std::uint32_t x, std::uint32_t y,
                          std::uint32_t pixel_mask,
-                         const uncompressed_pixel_block_t& pixels)
+                         const uncompressed_pixel_block_t& pixels) const
   {
     BOOST_ASSERT(x % block_width == 0);
     BOOST_ASSERT(y % block_height == 0);
@@ -27,7 +27,10 @@ namespace detail
 
     static constexpr T from_float(float value)
     {
-      return static_cast<T>(value * ((1 << PixelChannel::size_in_bits) - 1));
+      // Round to nearest, because truncation would map values which are
+      // slightly off after filtering or sRGB encoding to the next lower one.
+      return static_cast<T>(
+        value * ((1 << PixelChannel::size_in_bits) - 1) + 0.5f);
     }
   };
 
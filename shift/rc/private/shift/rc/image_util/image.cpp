@@ -2,7 +2,16 @@
 #include "shift/rc/image_util/linear_image_view.hpp"
 #include "shift/rc/image_util/block_image_view.hpp"
 #include "shift/rc/image_util/convert.hpp"
+#include "shift/rc/image_util/resample.hpp"
 #include <boost/assert.hpp>
+#include <array>
+#include <cstring>
+#include <functional>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define SHIFT_RC_IMAGE_UTIL_SSSE3
+#include <tmmintrin.h>
+#endif
 
 namespace shift::rc::image_util
 {
@@ -128,10 +137,131 @@ std::size_t required_image_buffer_size(const image_descriptor& image)
   return result;
 }
 
+struct image_channel_count_dispatcher
+{
+  template <resource_db::image_format Format, typename Pixel>
+  void operator()(const format_pair<Format, Pixel>*,
+                  resource_db::image_format format, std::uint32_t& result) const
+  {
+    if constexpr (!Pixel::is_block_format)
+    {
+      if (Format == format)
+        result = static_cast<std::uint32_t>(Pixel::channel_count);
+    }
+  }
+};
+
+std::uint32_t image_channel_count(resource_db::image_format format)
+{
+  std::uint32_t result = 0;
+  core::for_each<format_map>(image_channel_count_dispatcher{}, format, result);
+  return result;
+}
+
+/// The minimum number of pixels converted by a single task.
+static constexpr std::size_t min_pixels_per_task = 1 << 16;
+
+/// The minimum number of pixel blocks compressed by a single task.
+static constexpr std::size_t min_blocks_per_task = 256;
+
+/// Checks whether pixels of SourcePixel can be converted to DestinationPixel
+/// by merely reordering bytes, which is the case if both formats consist of
+/// the same four 8 bit channels of equal data type in different order.
+template <typename DestinationPixel, typename SourcePixel,
+          typename DestinationChannels = typename DestinationPixel::channels_t>
+struct pixel_swizzle
+{
+  static constexpr bool value = false;
+};
+
+template <typename DestinationPixel, typename SourcePixel,
+          typename... DestinationChannels>
+struct pixel_swizzle<DestinationPixel, SourcePixel,
+                     core::vector<DestinationChannels...>>
+{
+  using source_channels_t = typename SourcePixel::channels_t;
+
+  static constexpr bool value =
+    !DestinationPixel::is_block_format && !SourcePixel::is_block_format &&
+    DestinationPixel::data_type == SourcePixel::data_type &&
+    std::is_same_v<typename DestinationPixel::component_t,
+                   typename SourcePixel::component_t> &&
+    sizeof(typename DestinationPixel::component_t) == 1 &&
+    DestinationPixel::size_in_bytes == 4 && SourcePixel::size_in_bytes == 4 &&
+    detail::channel_count_v<source_channels_t> == 4 &&
+    (std::is_same_v<
+       core::get_type_opt_t<
+         detail::channel_index_v<source_channels_t, DestinationChannels>,
+         source_channels_t>,
+       DestinationChannels> &&
+     ...);
+
+  /// The byte offset within a source pixel of each destination channel.
+  static constexpr std::array<std::uint8_t, 4> offsets = {
+    static_cast<std::uint8_t>(
+      detail::channel_offset_v<source_channels_t, DestinationChannels> / 8)...};
+
+  static constexpr bool identity =
+    offsets[0] == 0 && offsets[1] == 1 && offsets[2] == 2 && offsets[3] == 3;
+};
+
+/// Converts count pixels by reordering the bytes of each pixel as described
+/// by Swizzle.
+template <typename Swizzle>
+void swizzle_pixels(std::byte* destination, const std::byte* source,
+                    std::size_t count)
+{
+  static_assert(Swizzle::value);
+  if constexpr (Swizzle::identity)
+  {
+    std::memcpy(destination, source, count * 4);
+    return;
+  }
+
+  constexpr auto offsets = Swizzle::offsets;
+  std::size_t i = 0;
+#if defined(SHIFT_RC_IMAGE_UTIL_SSSE3)
+  // Shuffle four pixels at once.
+  const auto mask = _mm_setr_epi8(
+    offsets[0], offsets[1], offsets[2], offsets[3], 4 + offsets[0],
+    4 + offsets[1], 4 + offsets[2], 4 + offsets[3], 8 + offsets[0],
+    8 + offsets[1], 8 + offsets[2], 8 + offsets[3], 12 + offsets[0],
+    12 + offsets[1], 12 + offsets[2], 12 + offsets[3]);
+  for (; i + 4 <= count; i += 4)
+  {
+    auto pixels =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4),
+                     _mm_shuffle_epi8(pixels, mask));
+  }
+#endif
+  for (; i < count; ++i)
+  {
+    for (std::size_t channel = 0; channel < 4; ++channel)
+      destination[i * 4 + channel] = source[i * 4 + offsets[channel]];
+  }
+}
+
+/// Returns the squish compressor flags selected by flags.
+static squish::flags_t block_compressor(convert_flags flags)
+{
+  squish::flags_t result{};
+  if (flags & convert_flag::fast_block_compression)
+    result = result | squish::squish_flag::compressor_color_range_fit;
+  else if (flags & convert_flag::best_block_compression)
+  {
+    result = result |
+             squish::squish_flag::compressor_color_iterative_cluster_fit |
+             squish::squish_flag::compressor_alpha_iterative_fit;
+  }
+  return result;
+}
+
 template <typename DestinationPixel, typename SourcePixel>
 std::error_code convert_image(
   const destination_image_descriptor& destination_image,
-  const source_image_descriptor& source_image, const convert_region& region)
+  const source_image_descriptor& source_image, const convert_region& region,
+  convert_flags flags)
 {
   auto destination_image_buffer_size =
     required_image_buffer_size<DestinationPixel>(destination_image);
@@ -141,10 +271,14 @@ std::error_code convert_image(
   {
     return error_code::destination_row_stride_with_bc;
   }
+  // Regions may end with partial blocks at the right and bottom edges of the
+  // destination image, e.g. in small mip levels.
   if (region.destination_x % DestinationPixel::block_width != 0 ||
       region.destination_y % DestinationPixel::block_height != 0 ||
-      region.width % DestinationPixel::block_width != 0 ||
-      region.height % DestinationPixel::block_height != 0)
+      (region.width % DestinationPixel::block_width != 0 &&
+       region.destination_x + region.width != destination_image.width) ||
+      (region.height % DestinationPixel::block_height != 0 &&
+       region.destination_y + region.height != destination_image.height))
   {
     return error_code::destination_region_not_block_aligned;
   }
@@ -190,46 +324,72 @@ std::error_code convert_image(
     if constexpr (DestinationPixel::is_block_format)
     {
       using destination_view_t = block_image_view<DestinationPixel>;
+      using intermediate_pixel_t =
+        typename destination_view_t::uncompressed_pixel_t;
+      using swizzle_t = pixel_swizzle<intermediate_pixel_t, SourcePixel>;
       destination_view_t destination_view(
         destination_image.buffer, destination_image.buffer_size,
         destination_image.width, destination_image.height, 0);
+      destination_view.compressor(block_compressor(flags));
 
       constexpr auto block_width = DestinationPixel::block_width;
       constexpr auto block_height = DestinationPixel::block_height;
+      static_assert(!swizzle_t::value ||
+                    sizeof(intermediate_pixel_t) * block_width == 16);
+
+      auto compress_block_row = [&](std::uint32_t block_row) {
+        auto block_y = block_row * block_height;
+        // Block compression formats only work on a limited set of input
+        // formats. Thus, convert the input region to an intermediate buffer.
+        typename destination_view_t::uncompressed_pixel_block_t
+          intermediate_pixels{};
+        pixel_converter<intermediate_pixel_t, SourcePixel> converter;
 
-      for (std::uint32_t block_y = 0; block_y < region.height;
-           block_y += block_height)
-      {
         for (std::uint32_t block_x = 0; block_x < region.width;
              block_x += block_width)
         {
-          // Block compression formats only work on a limited set of input
-          // formats. Thus, convert the input region to an intermediate buffer.
-          typename destination_view_t::uncompressed_pixel_block_t
-            intermediate_pixels{};
-          pixel_converter<typename destination_view_t::uncompressed_pixel_t,
-                          SourcePixel>
-            converter;
-
-          // Pixels outside the image need to be masked out.
+          auto source_x = region.source_x + block_x;
+          auto source_y = region.source_y + block_y;
           std::uint32_t pixel_mask = 0;
-          for (std::uint32_t y = 0; y < block_height; ++y)
+          if (swizzle_t::value && block_x + block_width <= region.width &&
+              block_y + block_height <= region.height)
+          {
+            // Fast path, which gathers whole rows of pixels using SIMD
+            // instructions.
+            if constexpr (swizzle_t::value)
+            {
+              for (std::uint32_t y = 0; y < block_height; ++y)
+              {
+                swizzle_pixels<swizzle_t>(
+                  reinterpret_cast<std::byte*>(
+                    &intermediate_pixels[y * block_width]),
+                  source_view.data(source_x, source_y + y), block_width);
+              }
+              pixel_mask = (1u << (block_width * block_height)) - 1;
+            }
+          }
+          else
           {
-            auto absolute_y = region.source_y + block_y + y;
-            if (absolute_y < source_image.height)
+            // Pixels outside the region need to be masked out.
+            for (std::uint32_t y = 0; y < block_height; ++y)
             {
-              for (std::uint32_t x = 0; x < block_width; ++x)
+              auto absolute_y = source_y + y;
+              if (block_y + y < region.height)
               {
-                auto absolute_x = region.source_x + block_x + x;
-                if (absolute_x < source_image.width)
+                for (std::uint32_t x = 0; x < block_width; ++x)
                 {
-                  typename source_view_t::pixel_t source_pixel;
+                  auto absolute_x = source_x + x;
+                  if (block_x + x < region.width)
+                  {
+                    typename source_view_t::pixel_t source_pixel;
 
-                  source_view.read_pixel(absolute_x, absolute_y, source_pixel);
-                  converter(intermediate_pixels[y * block_width + x],
-                            source_pixel);
+                    source_view.read_pixel(absolute_x, absolute_y,
+                                           source_pixel);
+                    converter(intermediate_pixels[y * block_width + x],
+                              source_pixel);
 
-                  pixel_mask |= 1 << (y * block_width + x);
+                    pixel_mask |= 1 << (y * block_width + x);
+                  }
                 }
               }
             }
@@ -241,7 +401,12 @@ std::error_code convert_image(
                                              region.destination_y + block_y,
                                              pixel_mask, intermediate_pixels);
         }
-      }
+      };
+      auto blocks_per_row = (region.width + block_width - 1) / block_width;
+      for_each_row((region.height + block_height - 1) / block_height,
+                   std::max<std::size_t>(min_blocks_per_task / blocks_per_row,
+                                         1),
+                   compress_block_row);
     }
     else if constexpr (SourcePixel::is_block_format)
     {
@@ -254,8 +419,7 @@ std::error_code convert_image(
                       typename source_view_t::uncompressed_pixel_t>
         converter;
 
-      for (std::uint32_t y = 0; y < region.height; ++y)
-      {
+      auto convert_row = [&](std::uint32_t y) {
         for (std::uint32_t x = 0; x < region.width; ++x)
         {
           typename source_view_t::uncompressed_pixel_t source_pixel;
@@ -268,32 +432,51 @@ std::error_code convert_image(
                                        region.destination_y + y,
                                        destination_pixel);
         }
-      }
+      };
+      for_each_row(region.height,
+                   std::max<std::size_t>(min_pixels_per_task / region.width,
+                                         1),
+                   convert_row);
     }
     else
     {
       using destination_view_t = linear_image_view<DestinationPixel>;
+      using swizzle_t = pixel_swizzle<DestinationPixel, SourcePixel>;
       destination_view_t destination_view(
         destination_image.buffer, destination_image.buffer_size,
         destination_image.width, destination_image.height,
         destination_image.row_stride);
-      pixel_converter<DestinationPixel, SourcePixel> converter;
 
-      for (std::uint32_t y = 0; y < region.height; ++y)
-      {
-        for (std::uint32_t x = 0; x < region.width; ++x)
+      auto convert_row = [&](std::uint32_t y) {
+        if constexpr (swizzle_t::value)
         {
-          typename source_view_t::pixel_t source_pixel;
-          typename destination_view_t::pixel_t destination_pixel;
+          swizzle_pixels<swizzle_t>(
+            destination_view.data(region.destination_x,
+                                  region.destination_y + y),
+            source_view.data(region.source_x, region.source_y + y),
+            region.width);
+        }
+        else
+        {
+          pixel_converter<DestinationPixel, SourcePixel> converter;
+          for (std::uint32_t x = 0; x < region.width; ++x)
+          {
+            typename source_view_t::pixel_t source_pixel;
+            typename destination_view_t::pixel_t destination_pixel;
 
-          source_view.read_pixel(region.source_x + x, region.source_y + y,
-                                 source_pixel);
-          converter(destination_pixel, source_pixel);
-          destination_view.write_pixel(region.destination_x + x,
-                                       region.destination_y + y,
-                                       destination_pixel);
+            source_view.read_pixel(region.source_x + x, region.source_y + y,
+                                   source_pixel);
+            converter(destination_pixel, source_pixel);
+            destination_view.write_pixel(region.destination_x + x,
+                                         region.destination_y + y,
+                                         destination_pixel);
+          }
         }
-      }
+      };
+      for_each_row(region.height,
+                   std::max<std::size_t>(min_pixels_per_task / region.width,
+                                         1),
+                   convert_row);
     }
   }
   return {};
@@ -309,7 +492,8 @@ struct convert_image_dispatcher_2
   void operator()(const format_pair<Format, SourcePixel>*,
                   const destination_image_descriptor& destination_image,
                   const source_image_descriptor& source_image,
-                  const convert_region& region, std::error_code& result) const
+                  const convert_region& region, convert_flags flags,
+                  std::error_code& result) const
   {
     if (Format == source_image.format)
     {
@@ -318,7 +502,7 @@ struct convert_image_dispatcher_2
                     !SourcePixel::is_block_format)
       {
         result = convert_image<DestinationPixel, SourcePixel>(
-          destination_image, source_image, region);
+          destination_image, source_image, region, flags);
       }
       else
       {
@@ -337,13 +521,14 @@ struct convert_image_dispatcher_1
   void operator()(const format_pair<Format, DestinationPixel>*,
                   const destination_image_descriptor& destination_image,
                   const source_image_descriptor& source_image,
-                  const convert_region& region, std::error_code& result) const
+                  const convert_region& region, convert_flags flags,
+                  std::error_code& result) const
   {
     if (Format == destination_image.format)
     {
       core::for_each<format_map>(convert_image_dispatcher_2<DestinationPixel>{},
                                  destination_image, source_image, region,
-                                 result);
+                                 flags, result);
     }
   }
 };
@@ -351,9 +536,8 @@ struct convert_image_dispatcher_1
 std::error_code convert_image(
   const destination_image_descriptor& destination_image,
   const source_image_descriptor& source_image, const convert_region& region,
-  convert_flags /*flags*/)
+  convert_flags flags)
 {
-  /// ToDo: Make use of flags.
   if (region.width == 0 || region.height == 0)
   {
     // Nothing to do.
@@ -364,11 +548,6 @@ std::error_code convert_image(
     return error_code::destination_buffer_null;
   if (source_image.buffer == nullptr)
     return error_code::source_buffer_null;
-  if (destination_image.width != source_image.width ||
-      destination_image.height != source_image.height)
-  {
-    return error_code::different_image_size;
-  }
 
   /// ToDo: check for empty regions.
   if (region.destination_x + region.width > destination_image.width ||
@@ -387,49 +566,7 @@ std::error_code convert_image(
   // possible combination of source and destination image formats to select an
   // optimized conversion function.
   core::for_each<format_map>(convert_image_dispatcher_1{}, destination_image,
-                             source_image, region, result);
+                             source_image, region, flags, result);
   return result;
 }
-
-std::error_code resize_image(
-  const destination_image_descriptor& destination_image,
-  const source_image_descriptor& source_image, const resize_region& region,
-  resize_flags /*flags*/)
-{
-  if (region.destination_width == 0 || region.destination_height == 0)
-  {
-    // Nothing to do.
-    return {};
-  }
-
-  if (resource_db::is_block_compressed(destination_image.format) ||
-      !resource_db::is_linear(destination_image.format))
-  {
-    return error_code::destination_format_unsupported;
-  }
-  if (destination_image.format != source_image.format)
-    return error_code::different_image_format;
-  if (destination_image.buffer == nullptr)
-    return error_code::destination_buffer_null;
-  if (source_image.buffer == nullptr)
-    return error_code::source_buffer_null;
-
-  if (region.destination_x + region.destination_width >
-        destination_image.width ||
-      region.destination_y + region.destination_height >
-        destination_image.height)
-  {
-    return error_code::destination_region_bounds;
-  }
-  if (region.source_x + region.source_width > source_image.width ||
-      region.source_y + region.source_height > source_image.height)
-  {
-    return error_code::source_region_bounds;
-  }
-  if (region.source_width == 0 || region.source_height == 0)
-    return error_code::source_region_empty;
-
-  /// ToDo: implement...
-  return error_code::not_implemented;
-}
 }
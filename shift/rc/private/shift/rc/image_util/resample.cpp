@@ -0,0 +1,650 @@
+#include "shift/rc/image_util/resample.hpp"
+#include "shift/rc/image_util/convert.hpp"
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHIFT_RC_IMAGE_UTIL_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace shift::rc::image_util
+{
+/// The minimum number of floats filtered by a single task.
+static constexpr std::size_t min_floats_per_task = 1 << 16;
+
+/// The maximum number of floats of decoded source rows held in memory at once.
+static constexpr std::size_t max_floats_per_band = 1 << 22;
+
+/// Returns sin(pi * x) / (pi * x).
+static float sinc(float x)
+{
+  constexpr float pi = 3.14159265358979323846f;
+
+  if (std::abs(x) < 1e-6f)
+    return 1.0f;
+  x *= pi;
+  return std::sin(x) / x;
+}
+
+/// Returns the zeroth order modified Bessel function of the first kind.
+static float bessel_i0(float x)
+{
+  // The power series converges quickly for the small arguments used here.
+  float result = 1.0f;
+  float term = 1.0f;
+  for (int k = 1; k < 32 && term > result * 1e-8f; ++k)
+  {
+    term *= x * x * 0.25f / static_cast<float>(k * k);
+    result += term;
+  }
+  return result;
+}
+
+/// Returns the distance from the filter's center beyond which all weights are
+/// zero.
+static float filter_radius(resample_filter filter)
+{
+  switch (filter)
+  {
+  case resample_filter::box:
+    return 0.5f;
+  case resample_filter::triangle:
+    return 1.0f;
+  case resample_filter::kaiser:
+  case resample_filter::lanczos:
+    return 3.0f;
+  }
+  return 0.5f;
+}
+
+/// Returns the unnormalized weight of a filter at distance x from its center.
+static float filter_weight(resample_filter filter, float x)
+{
+  switch (filter)
+  {
+  case resample_filter::box:
+    return x >= -0.5f && x < 0.5f ? 1.0f : 0.0f;
+
+  case resample_filter::triangle:
+    return std::max(0.0f, 1.0f - std::abs(x));
+
+  case resample_filter::kaiser:
+  {
+    constexpr float radius = 3.0f;
+    constexpr float alpha = 4.0f;
+    auto t = x / radius;
+    if (t * t >= 1.0f)
+      return 0.0f;
+    return sinc(x) * bessel_i0(alpha * std::sqrt(1.0f - t * t)) /
+           bessel_i0(alpha);
+  }
+
+  case resample_filter::lanczos:
+    if (std::abs(x) >= 3.0f)
+      return 0.0f;
+    return sinc(x) * sinc(x / 3.0f);
+  }
+  return 0.0f;
+}
+
+resample_filter select_filter(resize_flags flags)
+{
+  if (flags & resize_flag::box_filter)
+    return resample_filter::box;
+  else if (flags & resize_flag::triangle_filter)
+    return resample_filter::triangle;
+  else if (flags & resize_flag::kaiser_filter)
+    return resample_filter::kaiser;
+  else if (flags & resize_flag::lanczos_filter)
+    return resample_filter::lanczos;
+  return resample_filter::kaiser;
+}
+
+resample_taps::resample_taps(std::uint32_t source_size,
+                             std::uint32_t destination_size,
+                             resample_filter filter,
+                             std::uint32_t tap_alignment)
+{
+  BOOST_ASSERT(source_size > 0 && destination_size > 0);
+  BOOST_ASSERT(tap_alignment > 0);
+
+  // When downsampling, the filter is stretched to cover all source pixels
+  // which fall into a destination pixel.
+  auto scale = static_cast<float>(source_size) / destination_size;
+  auto filter_scale = std::max(scale, 1.0f);
+  auto support = filter_radius(filter) * filter_scale;
+  auto last = static_cast<int>(source_size) - 1;
+  auto center = [&](std::uint32_t index) {
+    return (static_cast<float>(index) + 0.5f) * scale - 0.5f;
+  };
+
+  // Use the same number of taps for all destination pixels, which keeps the
+  // inner loops simple.
+  std::uint32_t max_tap_count = 1;
+  for (std::uint32_t index = 0; index < destination_size; ++index)
+  {
+    auto begin = std::clamp(
+      static_cast<int>(std::ceil(center(index) - support)), 0, last);
+    auto end = std::clamp(
+      static_cast<int>(std::floor(center(index) + support)), 0, last);
+    max_tap_count =
+      std::max(max_tap_count, static_cast<std::uint32_t>(end - begin + 1));
+  }
+  tap_count = std::min(
+    (max_tap_count + tap_alignment - 1) / tap_alignment * tap_alignment,
+    source_size);
+
+  first.resize(destination_size);
+  weights.resize(static_cast<std::size_t>(destination_size) * tap_count, 0.0f);
+  for (std::uint32_t index = 0; index < destination_size; ++index)
+  {
+    auto c = center(index);
+    auto begin = static_cast<int>(std::ceil(c - support));
+    auto end = static_cast<int>(std::floor(c + support));
+    first[index] = std::min(static_cast<std::uint32_t>(std::max(begin, 0)),
+                            source_size - tap_count);
+
+    auto* row = weights.data() + static_cast<std::size_t>(index) * tap_count;
+    float sum = 0.0f;
+    for (auto tap = begin; tap <= end; ++tap)
+    {
+      auto weight =
+        filter_weight(filter, (static_cast<float>(tap) - c) / filter_scale);
+      // Pixels outside the image repeat the nearest edge pixel.
+      row[std::clamp(tap, 0, last) - static_cast<int>(first[index])] += weight;
+      sum += weight;
+    }
+    if (sum != 0.0f)
+    {
+      for (std::uint32_t tap = 0; tap < tap_count; ++tap)
+        row[tap] /= sum;
+    }
+    else
+    {
+      auto nearest = std::clamp(static_cast<int>(std::lround(c)), 0, last);
+      row[nearest - static_cast<int>(first[index])] = 1.0f;
+    }
+  }
+}
+
+resampler::resampler(std::uint32_t source_width, std::uint32_t source_height,
+                     std::uint32_t destination_width,
+                     std::uint32_t destination_height,
+                     std::uint32_t channel_count, resample_filter filter)
+: _source_width(source_width),
+  _source_height(source_height),
+  _destination_width(destination_width),
+  _destination_height(destination_height),
+  _channel_count(channel_count),
+  // Single channel rows are filtered four taps at a time.
+  _horizontal_taps(source_width, destination_width, filter,
+                   channel_count == 1 ? 4 : 1),
+  _vertical_taps(source_height, destination_height, filter, 1)
+{
+  BOOST_ASSERT(channel_count >= 1 && channel_count <= 4);
+}
+
+void resampler::push_rows(const float* rows, std::uint32_t row_count,
+                          const row_handler& handler)
+{
+  BOOST_ASSERT(_first_row + _row_count + row_count <= _source_height);
+  const auto source_row_size =
+    static_cast<std::size_t>(_source_width) * _channel_count;
+  const auto row_size =
+    static_cast<std::size_t>(_destination_width) * _channel_count;
+
+  // Filter all new rows horizontally and append them to the buffered rows.
+  _rows.resize((_row_count + row_count) * row_size);
+  auto* filtered_rows = _rows.data() + _row_count * row_size;
+  for_each_row(
+    row_count, std::max<std::size_t>(1, min_floats_per_task / source_row_size),
+    [&](std::uint32_t row) {
+      filter_row_horizontally(rows + row * source_row_size,
+                              filtered_rows + row * row_size);
+    });
+  _row_count += row_count;
+
+  // Produce all destination rows whose source rows are complete.
+  auto end_row = _next_row;
+  while (end_row < _destination_height &&
+         _vertical_taps.first[end_row] + _vertical_taps.tap_count <=
+           _first_row + _row_count)
+  {
+    ++end_row;
+  }
+  if (end_row > _next_row)
+  {
+    auto output_row_count = end_row - _next_row;
+    _output.resize(output_row_count * row_size);
+    for_each_row(
+      output_row_count,
+      std::max<std::size_t>(
+        1, min_floats_per_task / (row_size * _vertical_taps.tap_count)),
+      [&](std::uint32_t row) {
+        filter_row_vertically(_next_row + row, _output.data() + row * row_size);
+      });
+    handler(_output.data(), _next_row, output_row_count);
+    _next_row = end_row;
+  }
+
+  // Drop all buffered rows which no remaining destination row depends on.
+  auto needed_row = _next_row < _destination_height
+                      ? _vertical_taps.first[_next_row]
+                      : _first_row + _row_count;
+  auto drop_count = std::min(needed_row - _first_row, _row_count);
+  if (drop_count > 0)
+  {
+    std::copy(_rows.begin() + drop_count * row_size,
+              _rows.begin() + _row_count * row_size, _rows.begin());
+    _first_row += drop_count;
+    _row_count -= drop_count;
+    _rows.resize(_row_count * row_size);
+  }
+}
+
+void resampler::filter_row_horizontally(const float* source,
+                                        float* destination) const
+{
+  const auto tap_count = _horizontal_taps.tap_count;
+  const auto* first = _horizontal_taps.first.data();
+  const auto* weights = _horizontal_taps.weights.data();
+
+#if defined(SHIFT_RC_IMAGE_UTIL_SSE2)
+  if (_channel_count == 4)
+  {
+    // Each pixel fits into a single register, so each tap is a single
+    // multiply-add of four channels.
+    for (std::uint32_t x = 0; x < _destination_width;
+         ++x, weights += tap_count)
+    {
+      const auto* pixels = source + static_cast<std::size_t>(first[x]) * 4;
+      auto sum = _mm_setzero_ps();
+      for (std::uint32_t tap = 0; tap < tap_count; ++tap)
+      {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]),
+                                         _mm_loadu_ps(pixels + tap * 4)));
+      }
+      _mm_storeu_ps(destination + static_cast<std::size_t>(x) * 4, sum);
+    }
+    return;
+  }
+  else if (_channel_count == 1 && tap_count % 4 == 0)
+  {
+    // Compute dot products of four consecutive pixels and weights at a time.
+    for (std::uint32_t x = 0; x < _destination_width;
+         ++x, weights += tap_count)
+    {
+      const auto* pixels = source + first[x];
+      auto sum = _mm_setzero_ps();
+      for (std::uint32_t tap = 0; tap < tap_count; tap += 4)
+      {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(weights + tap),
+                                         _mm_loadu_ps(pixels + tap)));
+      }
+      sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+      sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+      destination[x] = _mm_cvtss_f32(sum);
+    }
+    return;
+  }
+#endif
+
+  for (std::uint32_t x = 0; x < _destination_width; ++x, weights += tap_count)
+  {
+    const auto* pixels =
+      source + static_cast<std::size_t>(first[x]) * _channel_count;
+    for (std::uint32_t channel = 0; channel < _channel_count; ++channel)
+    {
+      float sum = 0.0f;
+      for (std::uint32_t tap = 0; tap < tap_count; ++tap)
+        sum += weights[tap] * pixels[tap * _channel_count + channel];
+      *destination++ = sum;
+    }
+  }
+}
+
+void resampler::filter_row_vertically(std::uint32_t row,
+                                      float* destination) const
+{
+  const auto tap_count = _vertical_taps.tap_count;
+  const auto* weights =
+    _vertical_taps.weights.data() + static_cast<std::size_t>(row) * tap_count;
+  const auto row_size =
+    static_cast<std::size_t>(_destination_width) * _channel_count;
+  const auto* source =
+    _rows.data() + (_vertical_taps.first[row] - _first_row) * row_size;
+
+  // The filter is independent of the channel layout in this direction, so
+  // rows are processed as plain arrays of floats.
+  std::size_t i = 0;
+#if defined(SHIFT_RC_IMAGE_UTIL_SSE2)
+  for (; i + 4 <= row_size; i += 4)
+  {
+    auto sum = _mm_setzero_ps();
+    for (std::uint32_t tap = 0; tap < tap_count; ++tap)
+    {
+      sum = _mm_add_ps(
+        sum, _mm_mul_ps(_mm_set1_ps(weights[tap]),
+                        _mm_loadu_ps(source + tap * row_size + i)));
+    }
+    _mm_storeu_ps(destination + i, sum);
+  }
+#endif
+  for (; i < row_size; ++i)
+  {
+    float sum = 0.0f;
+    for (std::uint32_t tap = 0; tap < tap_count; ++tap)
+      sum += weights[tap] * source[tap * row_size + i];
+    destination[i] = sum;
+  }
+}
+
+/// Returns the 32 bit floating point format with channel_count channels.
+static resource_db::image_format float_format(std::uint32_t channel_count)
+{
+  switch (channel_count)
+  {
+  case 1:
+    return resource_db::image_format::r32_sfloat;
+  case 2:
+    return resource_db::image_format::r32g32_sfloat;
+  case 3:
+    return resource_db::image_format::r32g32b32_sfloat;
+  default:
+    return resource_db::image_format::r32g32b32a32_sfloat;
+  }
+}
+
+/// Decodes a region of an image to tightly packed linear 32 bit floating
+/// point pixels.
+static std::error_code decode_rows(const source_image_descriptor& source,
+                                   std::uint32_t x, std::uint32_t y,
+                                   std::uint32_t width, std::uint32_t height,
+                                   std::uint32_t channel_count,
+                                   float* destination)
+{
+  using resource_db::image_format;
+
+  if (source.format == image_format::r8g8b8a8_unorm ||
+      source.format == image_format::r8g8b8a8_srgb)
+  {
+    // Most imported images use this format. Look up the same values
+    // convert_image computes, instead of evaluating the sRGB transfer
+    // function for each component.
+    static const auto tables = []() {
+      std::array<std::array<float, 256>, 2> result{};
+      for (std::size_t i = 0; i < 256; ++i)
+      {
+        result[0][i] = static_cast<float>(i) / 255.0f;
+        result[1][i] = detail::srgb_converter::to_linear(result[0][i]);
+      }
+      return result;
+    }();
+    const auto& table =
+      tables[source.format == image_format::r8g8b8a8_srgb ? 1 : 0];
+    const std::size_t row_stride =
+      source.row_stride != 0 ? source.row_stride : source.width * 4;
+    const auto row_size = static_cast<std::size_t>(width) * 4;
+    for_each_row(
+      height, std::max<std::size_t>(1, min_floats_per_task / row_size),
+      [&](std::uint32_t row) {
+        const auto* pixels = reinterpret_cast<const std::uint8_t*>(
+          source.buffer + (y + row) * row_stride + x * 4);
+        auto* floats = destination + row * row_size;
+        for (std::size_t i = 0; i < row_size; ++i)
+          floats[i] = table[pixels[i]];
+      });
+    return {};
+  }
+
+  destination_image_descriptor floats;
+  floats.width = width;
+  floats.height = height;
+  floats.row_stride = 0;
+  floats.format = float_format(channel_count);
+  floats.buffer_size =
+    static_cast<std::size_t>(width) * height * channel_count * sizeof(float);
+  floats.buffer = reinterpret_cast<std::byte*>(destination);
+  return convert_image(floats, source,
+                       convert_region{0, 0, x, y, width, height}, {});
+}
+
+/// Encodes tightly packed linear 32 bit floating point pixels to a region of
+/// an image.
+static std::error_code encode_rows(const float* source, std::uint32_t width,
+                                   std::uint32_t height,
+                                   std::uint32_t channel_count,
+                                   const destination_image_descriptor& image,
+                                   std::uint32_t x, std::uint32_t y)
+{
+  source_image_descriptor floats;
+  floats.width = width;
+  floats.height = height;
+  floats.row_stride = 0;
+  floats.format = float_format(channel_count);
+  floats.buffer_size =
+    static_cast<std::size_t>(width) * height * channel_count * sizeof(float);
+  floats.buffer = reinterpret_cast<const std::byte*>(source);
+  return convert_image(image, floats,
+                       convert_region{x, y, 0, 0, width, height}, {});
+}
+
+/// Returns the number of rows decoded at once for images of the given width.
+static std::uint32_t band_height(std::uint32_t width,
+                                 std::uint32_t channel_count)
+{
+  auto row_size = static_cast<std::size_t>(width) * channel_count;
+  return static_cast<std::uint32_t>(
+    std::max<std::size_t>(1, max_floats_per_band / row_size));
+}
+
+std::error_code resize_image(
+  const destination_image_descriptor& destination_image,
+  const source_image_descriptor& source_image, const resize_region& region,
+  resize_flags flags)
+{
+  if (region.destination_width == 0 || region.destination_height == 0)
+  {
+    // Nothing to do.
+    return {};
+  }
+
+  auto channel_count = image_channel_count(destination_image.format);
+  if (resource_db::is_block_compressed(destination_image.format) ||
+      channel_count == 0 || channel_count > 4)
+  {
+    return error_code::destination_format_unsupported;
+  }
+  if (destination_image.format != source_image.format)
+    return error_code::different_image_format;
+  if (destination_image.buffer == nullptr)
+    return error_code::destination_buffer_null;
+  if (source_image.buffer == nullptr)
+    return error_code::source_buffer_null;
+
+  if (region.destination_x + region.destination_width >
+        destination_image.width ||
+      region.destination_y + region.destination_height >
+        destination_image.height)
+  {
+    return error_code::destination_region_bounds;
+  }
+  if (region.source_x + region.source_width > source_image.width ||
+      region.source_y + region.source_height > source_image.height)
+  {
+    return error_code::source_region_bounds;
+  }
+  if (region.source_width == 0 || region.source_height == 0)
+    return error_code::source_region_empty;
+
+  resampler resampler{region.source_width,      region.source_height,
+                      region.destination_width, region.destination_height,
+                      channel_count,            select_filter(flags)};
+  std::error_code result;
+  auto store_rows = [&](const float* rows, std::uint32_t first_row,
+                        std::uint32_t row_count) {
+    if (!result)
+    {
+      result = encode_rows(rows, region.destination_width, row_count,
+                           channel_count, destination_image,
+                           region.destination_x,
+                           region.destination_y + first_row);
+    }
+  };
+
+  auto rows_per_band = band_height(region.source_width, channel_count);
+  std::vector<float> band;
+  for (std::uint32_t y = 0; y < region.source_height && !result;
+       y += rows_per_band)
+  {
+    auto row_count = std::min(rows_per_band, region.source_height - y);
+    band.resize(static_cast<std::size_t>(row_count) * region.source_width *
+                channel_count);
+    result = decode_rows(source_image, region.source_x, region.source_y + y,
+                         region.source_width, row_count, channel_count,
+                         band.data());
+    if (!result)
+      resampler.push_rows(band.data(), row_count, store_rows);
+  }
+  return result;
+}
+
+std::uint32_t mip_level_count(std::uint32_t width, std::uint32_t height)
+{
+  std::uint32_t result = 1;
+  for (auto size = std::max(width, height); size > 1; size >>= 1)
+    ++result;
+  return result;
+}
+
+struct mip_chain::impl
+{
+  struct level
+  {
+    image_descriptor image;
+    std::vector<std::byte> pixels;
+    /// Computes this level from the previous one.
+    std::unique_ptr<resampler> reduce;
+  };
+
+  /// Passes completed rows of level index - 1 down the chain, starting with
+  /// level index.
+  void push_rows(std::size_t index, const float* rows, std::uint32_t row_count)
+  {
+    auto& current = levels[index];
+    current.reduce->push_rows(
+      rows, row_count,
+      [&](const float* reduced_rows, std::uint32_t first_row,
+          std::uint32_t reduced_row_count) {
+        if (error)
+          return;
+        destination_image_descriptor destination;
+        static_cast<image_descriptor&>(destination) = current.image;
+        destination.buffer_size = current.pixels.size();
+        destination.buffer = current.pixels.data();
+        error = encode_rows(reduced_rows, current.image.width,
+                            reduced_row_count, channel_count, destination, 0,
+                            first_row);
+        if (!error && index + 1 < levels.size())
+          push_rows(index + 1, reduced_rows, reduced_row_count);
+      });
+  }
+
+  image_descriptor base_image;
+  std::uint32_t channel_count = 0;
+  std::uint32_t next_row = 0;
+  /// All levels below the base level.
+  std::vector<level> levels;
+  std::vector<float> band;
+  std::error_code error;
+};
+
+mip_chain::mip_chain(const image_descriptor& base_image, resize_flags flags)
+: _impl(std::make_unique<impl>())
+{
+  _impl->base_image = base_image;
+  _impl->channel_count = image_channel_count(base_image.format);
+  BOOST_ASSERT(_impl->channel_count > 0 && _impl->channel_count <= 4);
+  if (_impl->channel_count == 0 || _impl->channel_count > 4)
+  {
+    _impl->error = make_error_code(error_code::destination_format_unsupported);
+    return;
+  }
+
+  auto filter = select_filter(flags);
+  auto width = base_image.width;
+  auto height = base_image.height;
+  _impl->levels.resize(mip_level_count(width, height) - 1);
+  for (auto& level : _impl->levels)
+  {
+    auto level_width = std::max(width / 2, 1u);
+    auto level_height = std::max(height / 2, 1u);
+    level.image.width = level_width;
+    level.image.height = level_height;
+    level.image.row_stride = 0;
+    level.image.format = base_image.format;
+    level.pixels.resize(required_image_buffer_size(level.image));
+    level.reduce =
+      std::make_unique<resampler>(width, height, level_width, level_height,
+                                  _impl->channel_count, filter);
+    width = level_width;
+    height = level_height;
+  }
+}
+
+mip_chain::~mip_chain() = default;
+
+std::error_code mip_chain::add_rows(const source_image_descriptor& rows)
+{
+  auto& impl = *_impl;
+  if (impl.error)
+    return impl.error;
+  if (rows.format != impl.base_image.format)
+    return error_code::different_image_format;
+  if (rows.width != impl.base_image.width)
+    return error_code::different_image_size;
+  if (rows.buffer == nullptr)
+    return error_code::source_buffer_null;
+  if (impl.next_row + rows.height > impl.base_image.height)
+    return error_code::source_region_bounds;
+
+  if (!impl.levels.empty())
+  {
+    auto rows_per_band = band_height(rows.width, impl.channel_count);
+    for (std::uint32_t y = 0; y < rows.height && !impl.error;
+         y += rows_per_band)
+    {
+      auto row_count = std::min(rows_per_band, rows.height - y);
+      impl.band.resize(static_cast<std::size_t>(row_count) * rows.width *
+                       impl.channel_count);
+      impl.error = decode_rows(rows, 0, y, rows.width, row_count,
+                               impl.channel_count, impl.band.data());
+      if (!impl.error)
+        impl.push_rows(0, impl.band.data(), row_count);
+    }
+  }
+  impl.next_row += rows.height;
+  return impl.error;
+}
+
+std::uint32_t mip_chain::level_count() const
+{
+  return static_cast<std::uint32_t>(_impl->levels.size()) + 1;
+}
+
+source_image_descriptor mip_chain::level(std::uint32_t level) const
+{
+  BOOST_ASSERT(level >= 1 && level < level_count());
+  BOOST_ASSERT(_impl->next_row == _impl->base_image.height);
+  const auto& current = _impl->levels[level - 1];
+  source_image_descriptor result;
+  static_cast<image_descriptor&>(result) = current.image;
+  result.buffer_size = current.pixels.size();
+  result.buffer = current.pixels.data();
+  return result;
+}
+}
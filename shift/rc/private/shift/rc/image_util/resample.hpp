@@ -0,0 +1,102 @@
+#ifndef SHIFT_RC_IMAGE_UTIL_RESAMPLE_H
+#define SHIFT_RC_IMAGE_UTIL_RESAMPLE_H
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <shift/task/parallel.hpp>
+#include <shift/task/this_task.hpp>
+#include "shift/rc/image_util/image.hpp"
+
+namespace shift::rc::image_util
+{
+/// Calls function with each row index in [0, row_count). When called from
+/// within a task, the rows are split into chunks of up to grain_size rows,
+/// which are processed in parallel.
+inline void for_each_row(std::uint32_t row_count, std::size_t grain_size,
+                         const std::function<void(std::uint32_t)>& function)
+{
+  if (row_count > grain_size && task::this_task::inside_task())
+    task::parallel_for(std::uint32_t{0}, row_count, function, grain_size);
+  else
+  {
+    for (std::uint32_t row = 0; row < row_count; ++row)
+      function(row);
+  }
+}
+
+/// The reconstruction filters supported by resampler.
+enum class resample_filter
+{
+  box,
+  triangle,
+  kaiser,
+  lanczos
+};
+
+/// Selects the filter from a set of resize flags.
+resample_filter select_filter(resize_flags flags);
+
+/// The precomputed filter taps of one axis. Each destination pixel is
+/// computed from tap_count consecutive source pixels, starting at
+/// first[destination_index]. Source pixels outside the image are folded into
+/// the edge taps, so no tap ever reads outside the source image.
+struct resample_taps
+{
+  resample_taps(std::uint32_t source_size, std::uint32_t destination_size,
+                resample_filter filter, std::uint32_t tap_alignment);
+
+  std::uint32_t tap_count = 0;
+  std::vector<std::uint32_t> first;
+  /// tap_count normalized weights for each destination pixel.
+  std::vector<float> weights;
+};
+
+/// A separable polyphase resampler for images of linear 32 bit floating point
+/// pixels with up to four channels.
+/// @remarks
+///   Source rows are pushed in bands from top to bottom. Each destination row
+///   is produced as soon as all source rows it depends on are available, and
+///   each source row is filtered horizontally exactly once. Thus, neither the
+///   source nor the destination image has to be held in memory as a whole.
+class resampler
+{
+public:
+  /// Called with each band of completed destination rows, which are only
+  /// valid during the call.
+  using row_handler = std::function<void(
+    const float* rows, std::uint32_t first_row, std::uint32_t row_count)>;
+
+  resampler(std::uint32_t source_width, std::uint32_t source_height,
+            std::uint32_t destination_width, std::uint32_t destination_height,
+            std::uint32_t channel_count, resample_filter filter);
+
+  /// Pushes the next row_count rows of tightly packed source pixels.
+  /// @remarks
+  ///   When called from within a task, rows are filtered in parallel.
+  void push_rows(const float* rows, std::uint32_t row_count,
+                 const row_handler& handler);
+
+private:
+  void filter_row_horizontally(const float* source, float* destination) const;
+  void filter_row_vertically(std::uint32_t row, float* destination) const;
+
+  std::uint32_t _source_width;
+  std::uint32_t _source_height;
+  std::uint32_t _destination_width;
+  std::uint32_t _destination_height;
+  std::uint32_t _channel_count;
+  resample_taps _horizontal_taps;
+  resample_taps _vertical_taps;
+
+  /// Horizontally filtered source rows, starting with row _first_row.
+  std::vector<float> _rows;
+  std::uint32_t _first_row = 0;
+  std::uint32_t _row_count = 0;
+  /// The index of the next destination row to produce.
+  std::uint32_t _next_row = 0;
+  std::vector<float> _output;
+};
+}
+
+#endif
@@ -1,8 +1,16 @@
 #include "shift/rc/image_util/tiff_io.hpp"
 #include "shift/rc/image_util/built_in_icc_profiles.hpp"
 #include <shift/log/log.hpp>
+#include <shift/task/async.hpp>
+#include <shift/task/parallel.hpp>
+#include <shift/task/this_task.hpp>
 #include <fstream>
 #include <array>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <numeric>
 #include <tiffio.h>
 #define register
 #include <lcms2_plugin.h>
@@ -111,6 +119,8 @@ tiff_image::tiff_image(const tiff_image& other)
   width(other.width),
   height(other.height),
   rows_per_strip(other.rows_per_strip),
+  tile_width(other.tile_width),
+  tile_height(other.tile_height),
   photometric(other.photometric),
   planar_config(other.planar_config),
   pixel_data(other.pixel_data),
@@ -140,6 +150,8 @@ tiff_image& tiff_image::operator=(const tiff_image& other)
   width = other.width;
   height = other.height;
   rows_per_strip = other.rows_per_strip;
+  tile_width = other.tile_width;
+  tile_height = other.tile_height;
   photometric = other.photometric;
   planar_config = other.planar_config;
   pixel_data = other.pixel_data;
@@ -404,369 +416,637 @@ tiff_io::tiff_io()
 #endif
 }
 
-bool tiff_io::load(const std::filesystem::path& filename,
-                   std::vector<tiff_image>& images, bool ignore_icc_profile)
+namespace
 {
-  struct read_context_t
+/// A TIFF handle reading from its own file stream, such that several readers
+/// may decode different parts of the same file concurrently.
+struct tiff_reader
+{
+  tiff_reader() = default;
+  tiff_reader(const tiff_reader&) = delete;
+  tiff_reader& operator=(const tiff_reader&) = delete;
+
+  ~tiff_reader()
   {
-    std::ifstream stream;
-    toff_t start_offset = 0;
-  };
+    if (tiff != nullptr)
+      TIFFClose(tiff);
+  }
+
+  std::ifstream stream;
+  toff_t start_offset = 0;
+  TIFF* tiff = nullptr;
+  /// A buffer large enough to hold a single decoded strip or tile.
+  std::vector<std::byte> scratch;
+};
+}
 
-  static auto tiff_read = [](thandle_t user_data, tdata_t buffer,
-                             tsize_t size) -> tsize_t {
-    auto* data = static_cast<read_context_t*>(user_data);
+static tsize_t tiff_read(thandle_t user_data, tdata_t buffer, tsize_t size)
+{
+  auto* reader = static_cast<tiff_reader*>(user_data);
 
-    data->stream.read(static_cast<char*>(buffer),
+  reader->stream.read(static_cast<char*>(buffer),
                       static_cast<std::streamsize>(size));
-    return data->stream.gcount();
-  };
+  return reader->stream.gcount();
+}
 
-  static auto tiff_write = [](thandle_t /*user_data*/, tdata_t /*buffer*/,
-                              tsize_t /*size*/) -> tsize_t {
-    // Disallow writing on read-only images.
-    return 0;
-  };
+static tsize_t tiff_write(thandle_t /*user_data*/, tdata_t /*buffer*/,
+                          tsize_t /*size*/)
+{
+  // Disallow writing on read-only images.
+  return 0;
+}
 
-  static auto tiff_close = [](thandle_t /*user_data*/) -> int {
-    // NOP.
-    return 0;
-  };
+static int tiff_close(thandle_t /*user_data*/)
+{
+  // NOP.
+  return 0;
+}
 
-  static auto tiff_seek = [](thandle_t user_data, toff_t offset,
-                             int whence) -> toff_t {
-    if (offset == std::numeric_limits<toff_t>::max())
-      return std::numeric_limits<toff_t>::max();
+static toff_t tiff_seek(thandle_t user_data, toff_t offset, int whence)
+{
+  if (offset == std::numeric_limits<toff_t>::max())
+    return std::numeric_limits<toff_t>::max();
 
-    auto* data = static_cast<read_context_t*>(user_data);
+  auto* reader = static_cast<tiff_reader*>(user_data);
+  // Seeking fails on streams which hit the end of file before.
+  reader->stream.clear();
 
-    switch (whence)
-    {
-    case SEEK_SET:
-      data->stream.seekg(
-        static_cast<std::streamoff>(data->start_offset + offset),
-        std::ios::beg);
-      break;
+  switch (whence)
+  {
+  case SEEK_SET:
+    reader->stream.seekg(
+      static_cast<std::streamoff>(reader->start_offset + offset),
+      std::ios::beg);
+    break;
 
-    case SEEK_CUR:
-      data->stream.seekg(static_cast<std::streamoff>(offset), std::ios::cur);
-      break;
+  case SEEK_CUR:
+    reader->stream.seekg(static_cast<std::streamoff>(offset), std::ios::cur);
+    break;
 
-    case SEEK_END:
-      data->stream.seekg(static_cast<std::streamoff>(offset), std::ios::end);
-      break;
-    }
+  case SEEK_END:
+    reader->stream.seekg(static_cast<std::streamoff>(offset), std::ios::end);
+    break;
+  }
 
-    return static_cast<toff_t>(data->stream.tellg()) - data->start_offset;
-  };
+  return static_cast<toff_t>(reader->stream.tellg()) - reader->start_offset;
+}
 
-  static auto tiff_size = [](thandle_t user_data) -> toff_t {
-    auto* data = static_cast<read_context_t*>(user_data);
+static toff_t tiff_size(thandle_t user_data)
+{
+  auto* reader = static_cast<tiff_reader*>(user_data);
 
-    auto current_offset = data->stream.tellg();
-    data->stream.seekg(0, std::ios::end);
-    auto end_offset = data->stream.tellg();
-    data->stream.seekg(current_offset);
+  auto current_offset = reader->stream.tellg();
+  reader->stream.seekg(0, std::ios::end);
+  auto end_offset = reader->stream.tellg();
+  reader->stream.seekg(current_offset);
 
-    return static_cast<toff_t>(end_offset);
-  };
+  return static_cast<toff_t>(end_offset);
+}
 
-  static auto tiff_map = [](thandle_t /*user_data*/, tdata_t*, toff_t*) -> int {
-    // NOP.
-    return 0;
-  };
+static int tiff_map(thandle_t /*user_data*/, tdata_t*, toff_t*)
+{
+  // NOP.
+  return 0;
+}
 
-  static auto tiff_unmap = [](thandle_t /*user_data*/, tdata_t, toff_t) {
-    // NOP.
-  };
+static void tiff_unmap(thandle_t /*user_data*/, tdata_t, toff_t)
+{
+  // NOP.
+}
 
-  read_context_t context;
+/// Opens a TIFF file for reading.
+/// @return
+///   A null pointer if the file cannot be opened.
+static std::unique_ptr<tiff_reader> open_tiff(
+  const std::filesystem::path& filename)
+{
+  auto reader = std::make_unique<tiff_reader>();
   // First open file stream.
-  context.stream.open(filename.generic_string(),
+  reader->stream.open(filename.generic_string(),
                       std::ios_base::in | std::ios_base::binary);
-  if (!context.stream.is_open())
+  if (!reader->stream.is_open())
   {
     log::error() << "Cannot open file " << filename;
-    return false;
+    return nullptr;
   }
 
   // Now open TIFF image from stream.
-  auto* tiff =
-    TIFFClientOpen("-", "r", &context, tiff_read, tiff_write, tiff_seek,
+  reader->tiff =
+    TIFFClientOpen("-", "r", reader.get(), tiff_read, tiff_write, tiff_seek,
                    tiff_close, tiff_size, tiff_map, tiff_unmap);
-  if (tiff == nullptr)
+  if (reader->tiff == nullptr)
   {
     log::error() << "Cannot open TIFF file " << filename;
-    context.stream.close();
+    return nullptr;
+  }
+  return reader;
+}
+
+/// Reads the properties of the current image of a TIFF file.
+static bool read_image_info(TIFF* tiff, const std::filesystem::path& filename,
+                            tiff_image& image, bool ignore_icc_profile)
+{
+  if (!TIFFGetField(tiff, TIFFTAG_SAMPLESPERPIXEL, &image.samples_per_pixel))
+  {
+    log::error()
+      << filename
+      << ": Missing required TIFF field 'TIFFTAG_SAMPLESPERPIXEL'.";
     return false;
   }
 
-  // Read all images stored in the TIFF file/stream.
-  do
   {
-    tiff_image image;
+    // TIFF extra samples are usually used for the number of alpha channels.
+    std::uint16_t* extra_samples_info;
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_EXTRASAMPLES, &image.extra_samples,
+                          &extra_samples_info);
+  }
+
+  if (!TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &image.bits_per_sample))
+  {
+    log::error() << filename
+                 << ": Missing required TIFF field 'TIFFTAG_BITSPERSAMPLE'.";
+    return false;
+  }
+  if (image.bits_per_sample == 1)
+  {
+    log::error() << filename << ": Bilevel TIFF images are not supported.";
+    return false;
+  }
+  else if (image.bits_per_sample != 8 && image.bits_per_sample != 16 &&
+           image.bits_per_sample != 32)
+  {
+    log::error()
+      << filename
+      << ": TIFF images with bits per pixel other than 8, 16, or 32 "
+         "are not supported.";
+    return false;
+  }
 
-    if (!TIFFGetField(tiff, TIFFTAG_SAMPLESPERPIXEL, &image.samples_per_pixel))
+  if (std::uint16_t orientation;
+      TIFFGetField(tiff, TIFFTAG_ORIENTATION, &orientation))
+  {
+    if (orientation != ORIENTATION_TOPLEFT)
     {
-      log::error()
-        << filename
-        << ": Missing required TIFF field 'TIFFTAG_SAMPLESPERPIXEL'.";
+      /// ToDo: Implement image rotation and mirroring functions.
+      log::error() << filename << ": Unsupported TIFF image orientation.";
       return false;
     }
+  }
+  else
+  {
+    log::warning()
+      << "Missing TIFF field 'TIFFTAG_ORIENTATION'. Fallback to default.";
+  }
 
-    {
-      // TIFF extra samples are usually used for the number of alpha channels.
-      std::uint16_t* extra_samples_info;
-      TIFFGetFieldDefaulted(tiff, TIFFTAG_EXTRASAMPLES, &image.extra_samples,
-                            &extra_samples_info);
-    }
+  if (!TIFFGetField(tiff, TIFFTAG_SAMPLEFORMAT, &image.samples_format))
+  {
+    // Fallback to default.
+    image.samples_format = tiff_samples_format::unsigned_int;
+  }
+
+  if (!TIFFGetField(tiff, TIFFTAG_COMPRESSION, &image.compression))
+  {
+    log::error() << filename
+                 << ": Missing required TIFF field 'TIFFTAG_COMPRESSION'.";
+    return false;
+  }
+
+  if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &image.width))
+  {
+    log::error() << filename
+                 << ": Missing required TIFF field 'TIFFTAG_IMAGEWIDTH'.";
+    return false;
+  }
+
+  if (!TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &image.height))
+  {
+    log::error() << filename
+                 << ": Missing required TIFF field 'TIFFTAG_IMAGELENGTH'.";
+    return false;
+  }
 
-    if (!TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &image.bits_per_sample))
+  if (TIFFIsTiled(tiff))
+  {
+    if (!TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &image.tile_width) ||
+        !TIFFGetField(tiff, TIFFTAG_TILELENGTH, &image.tile_height) ||
+        image.tile_width == 0 || image.tile_height == 0)
     {
       log::error() << filename
-                   << ": Missing required TIFF field 'TIFFTAG_BITSPERSAMPLE'.";
+                   << ": Missing required TIFF fields 'TIFFTAG_TILEWIDTH' "
+                      "and 'TIFFTAG_TILELENGTH'.";
       return false;
     }
-    if (image.bits_per_sample == 1)
+  }
+  else if (!TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &image.rows_per_strip))
+  {
+    log::error() << filename
+                 << ": Missing required TIFF field 'TIFFTAG_ROWSPERSTRIP'.";
+    return false;
+  }
+
+  if (!TIFFGetField(tiff, TIFFTAG_PLANARCONFIG, &image.planar_config))
+  {
+    log::error() << filename
+                 << ": Missing required TIFF field 'TIFFTAG_PLANARCONFIG'.";
+    return false;
+  }
+  if (image.planar_config != tiff_planar_config::contiguous &&
+      image.planar_config != tiff_planar_config::separate)
+  {
+    log::error() << filename << ": Unsupported planar configuration ("
+                 << core::underlying_type_cast(image.planar_config) << ").";
+    return false;
+  }
+
+  if (!TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &image.photometric))
+  {
+    log::error() << filename
+                 << ": Missing required TIFF field 'TIFFTAG_PHOTOMETRIC'.";
+    return false;
+  }
+
+  switch (image.photometric)
+  {
+  case tiff_photometric::min_is_white:
+  case tiff_photometric::min_is_black:
+  case tiff_photometric::rgb:
+  case tiff_photometric::separated:
+  case tiff_photometric::cie_lab:
+  case tiff_photometric::icc_lab:
+    // NOP.
+    break;
+
+  case tiff_photometric::ycbcr:
+    if (std::uint16_t subsampling_x = 1, subsampling_y = 1;
+        !TIFFGetFieldDefaulted(tiff, TIFFTAG_YCBCRSUBSAMPLING, &subsampling_x,
+                               &subsampling_y) ||
+        subsampling_x != 1 || subsampling_y != 1)
     {
-      log::error() << filename << ": Bilevel TIFF images are not supported.";
+      log::error() << filename << ": Subsampled images are not supported.";
       return false;
     }
-    else if (image.bits_per_sample != 8 && image.bits_per_sample != 16 &&
-             image.bits_per_sample != 32)
+    break;
+
+  case tiff_photometric::log_luv:
+    if (image.bits_per_sample != 16)
     {
       log::error()
         << filename
-        << ": TIFF images with bits per pixel other than 8, 16, or 32 "
-           "are not supported.";
+        << ": TIFF images with color space CIE Log2(L) (u',v') are "
+           "required to have 16bits per sample.";
       return false;
     }
+    break;
+
+  case tiff_photometric::palette:
+    log::error() << filename
+                 << ": TIFF images with color palettes are note supported.";
+    return false;
 
-    if (std::uint16_t orientation;
-        TIFFGetField(tiff, TIFFTAG_ORIENTATION, &orientation))
+  default:
+    log::error() << filename << ": Unsupported TIFF color space (photometric "
+                 << core::underlying_type_cast(image.photometric) << ").";
+    return false;
+  }
+
+  if (!ignore_icc_profile)
+  {
+    if (std::pair<std::uint8_t*, std::uint32_t> icc_buffer = {nullptr, 0u};
+        TIFFGetField(tiff, TIFFTAG_ICCPROFILE, &icc_buffer.second,
+                     &icc_buffer.first) &&
+        icc_buffer.first != nullptr && icc_buffer.second > 0)
     {
-      if (orientation != ORIENTATION_TOPLEFT)
-      {
-        /// ToDo: Implement image rotation and mirroring functions.
-        log::error() << filename << ": Unsupported TIFF image orientation.";
-        return false;
-      }
+      image.icc_profile.reset(
+        cmsOpenProfileFromMem(icc_buffer.first, icc_buffer.second));
+
+      /// ToDo: Optionally print ICC profile info using
+      /// PrintProfileInformation from
+      /// https://github.com/mm2/Little-CMS/blob/lcms2.9/utils/common/vprf.c
+      // // Print description found in the profile
+      // if (Verbose && (image.icc_profile != nullptr))
+      // {
+      //   fprintf(stdout, "\n[Embedded profile]\n");
+      //   PrintProfileInformation(image.icc_profile);
+      // }
     }
-    else
+    // Try to see if "colorimetric" tiff
+    else if (float* primary_values = nullptr, *white_point_values = nullptr;
+             TIFFGetField(tiff, TIFFTAG_PRIMARYCHROMATICITIES,
+                          &primary_values) &&
+             TIFFGetField(tiff, TIFFTAG_WHITEPOINT, &white_point_values) &&
+             primary_values != nullptr && white_point_values != nullptr)
     {
-      log::warning()
-        << "Missing TIFF field 'TIFFTAG_ORIENTATION'. Fallback to default.";
+      cmsCIExyYTRIPLE primaries;
+      primaries.Red.x = static_cast<double>(primary_values[0]);
+      primaries.Red.y = static_cast<double>(primary_values[1]);
+      primaries.Red.Y = 1.0;
+      primaries.Green.x = static_cast<double>(primary_values[2]);
+      primaries.Green.y = static_cast<double>(primary_values[3]);
+      primaries.Green.Y = 1.0;
+      primaries.Blue.x = static_cast<double>(primary_values[4]);
+      primaries.Blue.y = static_cast<double>(primary_values[5]);
+      primaries.Blue.Y = 1.0;
+
+      cmsCIExyY white_point;
+      white_point.x = static_cast<double>(white_point_values[0]);
+      white_point.y = static_cast<double>(white_point_values[1]);
+      white_point.Y = 1.0;
+
+      std::array<std::uint16_t*, 3> gm_rgb = {};
+      TIFFGetFieldDefaulted(tiff, TIFFTAG_TRANSFERFUNCTION, &gm_rgb[0],
+                            &gm_rgb[1], &gm_rgb[2]);
+      std::array<cmsToneCurve*, 3> curves = {
+        cmsBuildTabulatedToneCurve16(nullptr, 256, gm_rgb[0]),
+        cmsBuildTabulatedToneCurve16(nullptr, 256, gm_rgb[1]),
+        cmsBuildTabulatedToneCurve16(nullptr, 256, gm_rgb[2])};
+
+      image.icc_profile.reset(cmsCreateRGBProfileTHR(
+        nullptr, &white_point, &primaries, curves.data()));
+
+      for (auto* curve : curves)
+        cmsFreeToneCurve(curve);
+
+      //        if (Verbose)
+      //          fprintf(stdout, "\n[Colorimetric TIFF]\n");
     }
+  }
+  return true;
+}
 
-    if (!TIFFGetField(tiff, TIFFTAG_SAMPLEFORMAT, &image.samples_format))
-    {
-      // Fallback to default.
-      image.samples_format = tiff_samples_format::unsigned_int;
-    }
+/// A set of TIFF handles, which are handed out to concurrent decoders.
+class tiff_reader_pool
+{
+public:
+  tiff_reader_pool(const std::filesystem::path& filename,
+                   std::size_t image_index)
+  : _filename(filename), _image_index(image_index)
+  {
+  }
 
-    if (!TIFFGetField(tiff, TIFFTAG_COMPRESSION, &image.compression))
+  /// Returns an unused reader, opening a new one if necessary.
+  /// @return
+  ///   A null pointer if the file cannot be opened.
+  std::unique_ptr<tiff_reader> acquire()
+  {
     {
-      log::error() << filename
-                   << ": Missing required TIFF field 'TIFFTAG_COMPRESSION'.";
-      return false;
+      std::lock_guard lock(_mutex);
+      if (!_readers.empty())
+      {
+        auto reader = std::move(_readers.back());
+        _readers.pop_back();
+        return reader;
+      }
     }
 
-    if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &image.width))
+    auto reader = open_tiff(_filename);
+    if (reader && !TIFFSetDirectory(reader->tiff,
+                                    static_cast<tdir_t>(_image_index)))
     {
-      log::error() << filename
-                   << ": Missing required TIFF field 'TIFFTAG_IMAGEWIDTH'.";
-      return false;
+      log::error() << _filename << ": Cannot find image " << _image_index
+                   << ".";
+      return nullptr;
     }
+    return reader;
+  }
 
-    if (!TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &image.height))
-    {
-      log::error() << filename
-                   << ": Missing required TIFF field 'TIFFTAG_IMAGELENGTH'.";
-      return false;
-    }
+  /// Returns a reader to the pool.
+  void release(std::unique_ptr<tiff_reader> reader)
+  {
+    std::lock_guard lock(_mutex);
+    _readers.push_back(std::move(reader));
+  }
 
-    if (!TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &image.rows_per_strip))
-    {
-      log::error() << filename
-                   << ": Missing required TIFF field 'TIFFTAG_ROWSPERSTRIP'.";
-      return false;
-    }
+private:
+  std::filesystem::path _filename;
+  std::size_t _image_index;
+  std::mutex _mutex;
+  std::vector<std::unique_ptr<tiff_reader>> _readers;
+};
 
-    if (!TIFFGetField(tiff, TIFFTAG_PLANARCONFIG, &image.planar_config))
-    {
-      log::error() << filename
-                   << ": Missing required TIFF field 'TIFFTAG_PLANARCONFIG'.";
-      return false;
-    }
-    if (image.planar_config != tiff_planar_config::contiguous &&
-        image.planar_config != tiff_planar_config::separate)
-    {
-      log::error() << filename << ": Unsupported planar configuration ("
-                   << core::underlying_type_cast(image.planar_config) << ").";
-      return 0;
-    }
+bool tiff_io::load(const std::filesystem::path& filename,
+                   std::vector<tiff_image>& images, bool ignore_icc_profile)
+{
+  auto first_image = images.size();
+  if (!load_info(filename, images, ignore_icc_profile))
+    return false;
 
-    if (!TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &image.photometric))
+  // Decode each image using a single window covering the whole image.
+  tiff_stream_options options;
+  options.window_size = std::numeric_limits<std::size_t>::max();
+  for (auto i = first_image; i < images.size(); ++i)
+  {
+    auto& image = images[i];
+    auto row_size = static_cast<std::size_t>(image.width) *
+                    image.samples_per_pixel * image.bits_per_sample / 8u;
+    image.pixel_data.resize(row_size * image.height);
+    if (!load_regions(filename, i - first_image, image, options,
+                      [&](const tiff_region& region) {
+                        std::copy_n(region.pixel_data, region.size,
+                                    image.pixel_data.data() +
+                                      region.y * row_size);
+                        return true;
+                      }))
     {
-      log::error() << filename
-                   << ": Missing required TIFF field 'TIFFTAG_PHOTOMETRIC'.";
       return false;
     }
+    image.planar_config = tiff_planar_config::contiguous;
+  }
+  return true;
+}
 
-    switch (image.photometric)
-    {
-    case tiff_photometric::min_is_white:
-    case tiff_photometric::min_is_black:
-    case tiff_photometric::rgb:
-    case tiff_photometric::separated:
-    case tiff_photometric::cie_lab:
-    case tiff_photometric::icc_lab:
-      // NOP.
-      break;
-
-    case tiff_photometric::ycbcr:
-      if (std::uint16_t subsampling_x = 1, subsampling_y = 1;
-          !TIFFGetFieldDefaulted(tiff, TIFFTAG_YCBCRSUBSAMPLING, &subsampling_x,
-                                 &subsampling_y) ||
-          subsampling_x != 1 || subsampling_y != 1)
-      {
-        log::error() << filename << ": Subsampled images are not supported.";
-        return false;
-      }
-      break;
-
-    case tiff_photometric::log_luv:
-      if (image.bits_per_sample != 16)
-      {
-        log::error()
-          << filename
-          << ": TIFF images with color space CIE Log2(L) (u',v') are "
-             "required to have 16bits per sample.";
-        return false;
-      }
-      break;
+bool tiff_io::load_info(const std::filesystem::path& filename,
+                        std::vector<tiff_image>& images,
+                        bool ignore_icc_profile)
+{
+  auto reader = open_tiff(filename);
+  if (!reader)
+    return false;
 
-    case tiff_photometric::palette:
-      log::error() << filename
-                   << ": TIFF images with color palettes are note supported.";
+  // Read all images stored in the TIFF file/stream.
+  do
+  {
+    tiff_image image;
+    if (!read_image_info(reader->tiff, filename, image, ignore_icc_profile))
       return false;
+    images.emplace_back(std::move(image));
+  } while (TIFFReadDirectory(reader->tiff) != 0);
+  return true;
+}
 
-    default:
-      log::error() << filename << ": Unsupported TIFF color space (photometric "
-                   << core::underlying_type_cast(image.photometric) << ").";
-      return false;
-    }
+bool tiff_io::load_regions(const std::filesystem::path& filename,
+                           std::size_t image_index, const tiff_image& image,
+                           const tiff_stream_options& options,
+                           const tiff_region_handler& handler)
+{
+  if (image.width == 0 || image.height == 0)
+    return true;
 
-    if (TIFFIsTiled(tiff))
-    {
-      log::error() << filename << ": We don't support tiled TIFF files, yet.";
-      /// ToDo: Implement this case using TIFFReadEncodedTile().
-      return false;
-    }
-    else
-    {
-      auto strip_size = TIFFStripSize(tiff);
-#if 0
-      log::info() << "TIFF file: " << filename;
-      log::info() << "samples_per_pixel: " << image.samples_per_pixel;
-      log::info() << "bits_per_sample: " << image.bits_per_sample;
-      log::info() << "samples_format: " << image.samples_format;
-      log::info() << "width: " << image.width;
-      log::info() << "height: " << image.height;
-      log::info() << "rows_per_strip: " << image.rows_per_strip;
-      log::info() << "compression: " << image.compression;
-      log::info() << "strip_size = " << strip_size;
-#endif
+  const std::size_t sample_size = image.bits_per_sample / 8u;
+  const std::size_t pixel_size = image.samples_per_pixel * sample_size;
+  const std::size_t row_size = image.width * pixel_size;
+  const bool tiled = image.tile_width > 0;
+  const std::size_t plane_count =
+    image.planar_config == tiff_planar_config::separate
+      ? image.samples_per_pixel
+      : 1u;
+  // The size of a single pixel within a decoded strip or tile.
+  const std::size_t unit_pixel_size =
+    plane_count > 1 ? sample_size : pixel_size;
+  const std::uint32_t unit_width = tiled ? image.tile_width : image.width;
+  const std::uint32_t unit_height =
+    tiled ? image.tile_height : std::min(image.rows_per_strip, image.height);
+  if (unit_height == 0)
+    return false;
+  const std::size_t column_count =
+    (image.width + unit_width - 1) / unit_width;
+  const std::size_t unit_row_count =
+    (image.height + unit_height - 1) / unit_height;
+
+  // Pick the number of rows of strips or tiles decoded at once, such that the
+  // window does not exceed the memory budget and each region's height is a
+  // multiple of the requested alignment.
+  auto alignment = std::max(options.row_alignment, 1u);
+  std::size_t alignment_units = alignment / std::gcd(unit_height, alignment);
+  // Clamp before rounding up, as tiff_io::load passes the maximum window
+  // size, which would otherwise overflow for single byte rows.
+  auto window_units = std::clamp<std::size_t>(
+    options.window_size / (row_size * unit_height), 1u, unit_row_count);
+  window_units = std::min(
+    (window_units + alignment_units - 1) / alignment_units * alignment_units,
+    unit_row_count);
+  BOOST_ASSERT(window_units > 0);
+
+  tiff_reader_pool readers(filename, image_index);
+  if (auto reader = readers.acquire(); reader)
+    readers.release(std::move(reader));
+  else
+    return false;
 
-      auto pixel_size = image.samples_per_pixel * image.bits_per_sample / 8u;
-      image.pixel_data.resize(image.width * image.height * pixel_size);
-      for (std::uint32_t y = 0, strip_id = 0; y < image.height;
-           y += image.rows_per_strip, ++strip_id)
+  std::vector<std::byte> window(
+    std::min<std::size_t>(window_units * unit_height, image.height) *
+    row_size);
+  for (std::size_t first_unit_row = 0; first_unit_row < unit_row_count;
+       first_unit_row += window_units)
+  {
+    auto window_y = static_cast<std::uint32_t>(first_unit_row * unit_height);
+    auto window_height = static_cast<std::uint32_t>(
+      std::min<std::size_t>((first_unit_row + window_units) * unit_height,
+                            image.height) -
+      window_y);
+    auto unit_count =
+      std::min(window_units, unit_row_count - first_unit_row) * column_count *
+      plane_count;
+
+    std::atomic<bool> failed = false;
+    auto decode_unit = [&](std::size_t unit) {
+      if (failed)
+        return;
+      auto reader = readers.acquire();
+      if (!reader)
       {
-        auto bytes_read = TIFFReadEncodedStrip(
-          tiff, strip_id,
-          image.pixel_data.data() + y * image.width * pixel_size,
-          std::min(static_cast<tmsize_t>(image.height - y) * image.width *
-                     pixel_size * image.rows_per_strip,
-                   strip_size));
-        if (bytes_read < 0)
-          return false;
+        failed = true;
+        return;
       }
-    }
 
-    if (!ignore_icc_profile)
-    {
-      if (std::pair<std::uint8_t*, std::uint32_t> icc_buffer = {nullptr, 0u};
-          TIFFGetField(tiff, TIFFTAG_ICCPROFILE, &icc_buffer.second,
-                       &icc_buffer.first) &&
-          icc_buffer.first != nullptr && icc_buffer.second > 0)
+      auto plane = static_cast<std::uint16_t>(unit % plane_count);
+      auto x = static_cast<std::uint32_t>(unit / plane_count % column_count *
+                                          unit_width);
+      auto y = window_y + static_cast<std::uint32_t>(
+                            unit / (plane_count * column_count) * unit_height);
+      auto rows = std::min(unit_height, image.height - y);
+      auto columns = std::min(unit_width, image.width - x);
+      auto* destination = window.data() + (y - window_y) * row_size;
+
+      if (!tiled && plane_count == 1)
       {
-        image.icc_profile.reset(
-          cmsOpenProfileFromMem(icc_buffer.first, icc_buffer.second));
-
-        /// ToDo: Optionally print ICC profile info using
-        /// PrintProfileInformation from
-        /// https://github.com/mm2/Little-CMS/blob/lcms2.9/utils/common/vprf.c
-        // // Print description found in the profile
-        // if (Verbose && (image.icc_profile != nullptr))
-        // {
-        //   fprintf(stdout, "\n[Embedded profile]\n");
-        //   PrintProfileInformation(image.icc_profile);
-        // }
+        // Strips of contiguous samples already have the window's layout.
+        if (TIFFReadEncodedStrip(reader->tiff,
+                                 TIFFComputeStrip(reader->tiff, y, 0),
+                                 destination,
+                                 static_cast<tmsize_t>(rows * row_size)) < 0)
+        {
+          failed = true;
+        }
       }
-      // Try to see if "colorimetric" tiff
-      else if (float* primary_values = nullptr, *white_point_values = nullptr;
-               TIFFGetField(tiff, TIFFTAG_PRIMARYCHROMATICITIES,
-                            &primary_values) &&
-               TIFFGetField(tiff, TIFFTAG_WHITEPOINT, &white_point_values) &&
-               primary_values != nullptr && white_point_values != nullptr)
+      else
       {
-        cmsCIExyYTRIPLE primaries;
-        primaries.Red.x = static_cast<double>(primary_values[0]);
-        primaries.Red.y = static_cast<double>(primary_values[1]);
-        primaries.Red.Y = 1.0;
-        primaries.Green.x = static_cast<double>(primary_values[2]);
-        primaries.Green.y = static_cast<double>(primary_values[3]);
-        primaries.Green.Y = 1.0;
-        primaries.Blue.x = static_cast<double>(primary_values[4]);
-        primaries.Blue.y = static_cast<double>(primary_values[5]);
-        primaries.Blue.Y = 1.0;
-
-        cmsCIExyY white_point;
-        white_point.x = static_cast<double>(white_point_values[0]);
-        white_point.y = static_cast<double>(white_point_values[1]);
-        white_point.Y = 1.0;
-
-        std::array<std::uint16_t*, 3> gm_rgb = {};
-        TIFFGetFieldDefaulted(tiff, TIFFTAG_TRANSFERFUNCTION, &gm_rgb[0],
-                              &gm_rgb[1], &gm_rgb[2]);
-        std::array<cmsToneCurve*, 3> curves = {
-          cmsBuildTabulatedToneCurve16(nullptr, 256, gm_rgb[0]),
-          cmsBuildTabulatedToneCurve16(nullptr, 256, gm_rgb[1]),
-          cmsBuildTabulatedToneCurve16(nullptr, 256, gm_rgb[2])};
-
-        image.icc_profile.reset(cmsCreateRGBProfileTHR(
-          nullptr, &white_point, &primaries, curves.data()));
-
-        for (auto* curve : curves)
-          cmsFreeToneCurve(curve);
-
-        //        if (Verbose)
-        //          fprintf(stdout, "\n[Colorimetric TIFF]\n");
+        tmsize_t bytes_read;
+        if (tiled)
+        {
+          reader->scratch.resize(
+            static_cast<std::size_t>(TIFFTileSize(reader->tiff)));
+          bytes_read = TIFFReadEncodedTile(
+            reader->tiff, TIFFComputeTile(reader->tiff, x, y, 0, plane),
+            reader->scratch.data(),
+            static_cast<tmsize_t>(reader->scratch.size()));
+        }
+        else
+        {
+          reader->scratch.resize(
+            static_cast<std::size_t>(TIFFStripSize(reader->tiff)));
+          bytes_read = TIFFReadEncodedStrip(
+            reader->tiff, TIFFComputeStrip(reader->tiff, y, plane),
+            reader->scratch.data(),
+            static_cast<tmsize_t>(reader->scratch.size()));
+        }
+        if (bytes_read < 0 ||
+            static_cast<std::size_t>(bytes_read) <
+              ((rows - 1) * unit_width + columns) * unit_pixel_size)
+        {
+          failed = true;
+        }
+        else if (plane_count == 1)
+        {
+          for (std::uint32_t row = 0; row < rows; ++row)
+          {
+            std::copy_n(reader->scratch.data() +
+                          row * unit_width * unit_pixel_size,
+                        columns * pixel_size,
+                        destination + row * row_size + x * pixel_size);
+          }
+        }
+        else
+        {
+          // Interleave the samples of this plane with the other ones.
+          destination += x * pixel_size + plane * sample_size;
+          for (std::uint32_t row = 0; row < rows; ++row)
+          {
+            const auto* source =
+              reader->scratch.data() + row * unit_width * sample_size;
+            auto* target = destination + row * row_size;
+            for (std::uint32_t column = 0; column < columns; ++column)
+            {
+              std::copy_n(source, sample_size, target);
+              source += sample_size;
+              target += pixel_size;
+            }
+          }
+        }
       }
+      readers.release(std::move(reader));
+    };
+    if (unit_count > 1 && task::this_task::inside_task())
+      task::parallel_for(std::size_t{0}, unit_count, decode_unit, 1);
+    else
+    {
+      for (std::size_t unit = 0; unit < unit_count; ++unit)
+        decode_unit(unit);
+    }
+    if (failed)
+    {
+      log::error() << filename << ": Failed decoding image " << image_index
+                   << ".";
+      return false;
     }
 
-    images.emplace_back(std::move(image));
-  } while (TIFFReadDirectory(tiff) != 0);
-
-  if (tiff != nullptr)
-  {
-    TIFFClose(tiff);
-    tiff = nullptr;
-
-    context.stream.close();
+    tiff_region region;
+    region.y = window_y;
+    region.height = window_height;
+    region.pixel_data = window.data();
+    region.size = window_height * row_size;
+    if (!handler(region))
+      return false;
   }
-
   return true;
 }
 
@@ -0,0 +1,289 @@
+#include "shift/rc/job_scheduler.hpp"
+#include "shift/rc/resource_compiler_impl.hpp"
+#include <shift/task/async.hpp>
+#include <shift/task/this_task.hpp>
+#include <shift/log/log.hpp>
+#include <algorithm>
+#include <exception>
+
+namespace shift::rc
+{
+/// Prints the list of a job's input files.
+static void print_inputs(log::info& line, const job_description& job)
+{
+  bool first = true;
+  line << "(";
+  for (const auto& [input_slot_index, input] : job.inputs)
+  {
+    if (first)
+      first = false;
+    else
+      line << ", ";
+    line << input_slot_index << ": " << input->file->generic_string;
+  }
+  line << ")";
+}
+
+/// Logs that a job failed with an exception.
+static void print_failure(const job_description& job)
+{
+  log::info line;
+  print_inputs(line, job);
+  line << " -> failed";
+}
+
+job_scheduler::job_scheduler(resource_compiler_impl& compiler,
+                             build_trace& trace)
+: _compiler(compiler), _trace(trace)
+{
+  std::shared_lock read_lock(_compiler.rules_mutex);
+  _rules = _compiler.rules;
+  std::stable_sort(_rules.begin(), _rules.end(),
+                   [](const auto* lhs, const auto* rhs) {
+                     return lhs->pass < rhs->pass;
+                   });
+
+  for (const auto* rule : _rules)
+  {
+    BOOST_ASSERT(rule->action != nullptr && rule->action->impl != nullptr);
+    const auto* action = rule->action->impl;
+    if (!action->support_multithreading() &&
+        _action_mutexes.find(action) == _action_mutexes.end())
+    {
+      _action_mutexes.emplace(action, std::make_unique<task::mutex>());
+    }
+  }
+}
+
+job_scheduler::~job_scheduler() = default;
+
+std::tuple<std::size_t /*succeeded_job_count*/,
+           std::size_t /*failed_job_count*/>
+job_scheduler::run()
+{
+  auto idle = _idle.get_future();
+  {
+    std::unique_lock lock(_mutex);
+    _trace.started = job_trace::clock::now();
+    schedule(job_trace::no_job);
+    if (_running_jobs.empty())
+      _idle.set_value();
+  }
+  idle.get();
+
+  // Wait until the last task also left the scheduler.
+  std::vector<task::future<bool>> tasks;
+  {
+    std::unique_lock lock(_mutex);
+    tasks.swap(_tasks);
+  }
+  for (auto& task : tasks)
+    task.get();
+  _trace.finished = job_trace::clock::now();
+
+  log::info() << "Processed " << _succeeded_job_count + _failed_job_count
+              << " modified job(s) (skipping " << _skipped_job_count
+              << " unmodified job(s)).";
+  return {_succeeded_job_count, _failed_job_count};
+}
+
+void job_scheduler::schedule(std::size_t trigger)
+{
+  std::shared_lock read_lock(_compiler.rules_mutex);
+  for (auto* rule : _rules)
+  {
+    {
+      std::lock_guard rule_lock(rule->matches_mutex);
+      if (rule->matches.empty())
+        continue;
+    }
+
+    // Jobs of lower passes might still produce further inputs for this rule.
+    // Rules are sorted by pass, so this also accounts for jobs spawned by
+    // previous iterations of this loop.
+    if (!_running_jobs.empty() && _running_jobs.begin()->first < rule->pass &&
+        (!rule->group_by.empty() ||
+         rule->action->impl->depends_on_previous_passes()))
+    {
+      continue;
+    }
+
+    std::size_t modified_job_count = 0;
+    std::size_t unmodified_job_count = 0;
+    for (auto& job : _compiler.query_jobs(*rule, read_lock))
+    {
+      if (!job->flags.test(entity_flag::modified))
+      {
+        ++unmodified_job_count;
+        job->mark_as_used();
+        // Push all output files of cached jobs into the pipeline. This is
+        // required to make sure that jobs with multiple input files, but only
+        // few of these modified, get re-run with all associated input files.
+        for (auto* output_file : job->outputs)
+        {
+          BOOST_ASSERT(output_file != nullptr);
+          _compiler.match_file(*output_file, rule->pass);
+        }
+        _compiler.cache.add_job(std::move(job));
+        continue;
+      }
+      ++modified_job_count;
+
+      auto trace_index = _trace.jobs.size();
+      auto& trace = _trace.jobs.emplace_back();
+      trace.rule_id = rule->id;
+      trace.action_name = rule->action->name;
+      trace.pass = rule->pass;
+      trace.queued = job_trace::clock::now();
+      trace.trigger = trigger;
+      for (const auto& [input_slot_index, input] : job->inputs)
+      {
+        if (trace.name.empty() || input->file->generic_string < trace.name)
+          trace.name = input->file->generic_string;
+        if (auto producer = _producers.find(input->file);
+            producer != _producers.end())
+        {
+          trace.dependencies.push_back(producer->second);
+        }
+      }
+      std::sort(trace.dependencies.begin(), trace.dependencies.end());
+      trace.dependencies.erase(
+        std::unique(trace.dependencies.begin(), trace.dependencies.end()),
+        trace.dependencies.end());
+
+      ++_running_jobs[rule->pass];
+      auto* job_pointer = job.get();
+      _jobs.emplace_back(std::move(job));
+      _tasks.emplace_back(task::async([this, job_pointer, trace_index]() {
+        return process(*job_pointer, trace_index);
+      }));
+    }
+    _skipped_job_count += unmodified_job_count;
+
+    if (_compiler.verbose >= 2)
+    {
+      log::info() << "Queuing " << modified_job_count
+                  << R"( modified job(s) of rule ")" << rule->id
+                  << R"(" in pass )" << rule->pass << " (skipping "
+                  << unmodified_job_count << " unmodified job(s))...";
+    }
+  }
+}
+
+bool job_scheduler::process(job_description& job, std::size_t trace_index)
+{
+  job_trace::clock::time_point started;
+  bool restored = false;
+  bool result = false;
+  {
+    std::unique_lock<task::mutex> action_lock;
+    if (auto action_mutex = _action_mutexes.find(job.rule->action->impl);
+        action_mutex != _action_mutexes.end())
+    {
+      action_lock = std::unique_lock(*action_mutex->second);
+    }
+    started = job_trace::clock::now();
+    result = run_action(job, restored);
+  }
+  auto finished = job_trace::clock::now();
+
+  std::unique_lock lock(_mutex);
+  auto& trace = _trace.jobs[trace_index];
+  trace.started = started;
+  trace.finished = finished;
+  trace.worker_id = task::this_task::current_worker_id();
+  trace.succeeded = result;
+  trace.restored = restored;
+
+  if (result)
+  {
+    job.flags.reset(entity_flag::failed);
+    ++_succeeded_job_count;
+    job.mark_as_used();
+
+    // Push all output files into the pipeline.
+    for (auto* output_file : job.outputs)
+    {
+      BOOST_ASSERT(output_file != nullptr);
+      _producers[output_file] = trace_index;
+      _compiler.match_file(*output_file, job.rule->pass);
+    }
+    _compiler.cache.add_job(std::move(_jobs[trace_index]));
+  }
+  else
+  {
+    job.flags.set(entity_flag::failed);
+    ++_failed_job_count;
+    log::error() << "A job using rule " << job.rule->id << " failed.";
+  }
+
+  if (auto running_jobs = _running_jobs.find(job.rule->pass);
+      --running_jobs->second == 0)
+  {
+    _running_jobs.erase(running_jobs);
+  }
+  schedule(trace_index);
+  if (_running_jobs.empty())
+    _idle.set_value();
+  return result;
+}
+
+bool job_scheduler::run_action(job_description& job, bool& restored)
+{
+  // There should be no tasks for unmodified jobs.
+  BOOST_ASSERT(job.flags.test(entity_flag::modified));
+
+  bool result = false;
+  try
+  {
+    if (_compiler.artifacts && _compiler.restore_artifact(job))
+    {
+      result = true;
+      restored = true;
+    }
+    else
+    {
+      result = job.rule->action->impl->process(_compiler, job);
+      if (result && _compiler.artifacts)
+        _compiler.store_artifact(job);
+    }
+    if (_compiler.verbose >= 1)
+    {
+      log::info line;
+      print_inputs(line, job);
+      line << " -> (";
+      bool first = true;
+      for (const auto& output : job.outputs)
+      {
+        if (first)
+          first = false;
+        else
+          line << ", ";
+        line << output->generic_string;
+      }
+      line << ")";
+    }
+  }
+  // Any exception escaping this method would skip the bookkeeping in
+  // process, and thus leave run waiting forever.
+  catch (boost::exception& e)
+  {
+    print_failure(job);
+    log::exception() << boost::diagnostic_information(e);
+    result = false;
+  }
+  catch (std::exception& e)
+  {
+    print_failure(job);
+    log::exception() << "Caught unhandled standard exception: " << e.what();
+    result = false;
+  }
+  catch (...)
+  {
+    print_failure(job);
+    log::exception() << "Caught unhandled exception of unknown type.";
+    result = false;
+  }
+  return result;
+}
+}
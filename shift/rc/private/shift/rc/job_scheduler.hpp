@@ -0,0 +1,104 @@
+#ifndef SHIFT_RC_JOB_SCHEDULER_HPP
+#define SHIFT_RC_JOB_SCHEDULER_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <shift/task/mutex.hpp>
+#include <shift/task/future.hpp>
+#include <shift/task/promise.hpp>
+#include "shift/rc/types.hpp"
+#include "shift/rc/build_trace.hpp"
+
+namespace shift::rc
+{
+/// Processes all jobs of an update as soon as their inputs are available.
+/// @remarks
+///   The scheduler tracks which job produced each output file, and thus
+///   which jobs depend on each other. A rule without a group-by set turns
+///   each match into a separate job, so new matches become jobs right away
+///   and start as soon as the job producing their input file completed. Rules
+///   that group multiple matches into a single job only know their final set
+///   of inputs once all jobs of lower passes completed, so their jobs wait
+///   for all of these. The same applies to actions which depend on previous
+///   passes, see action_base::depends_on_previous_passes.
+///   Jobs of actions that do not support multithreading are serialized using
+///   one mutex per action, so they do not block jobs of other actions.
+class job_scheduler
+{
+public:
+  /// Constructor.
+  /// @param trace
+  ///   Receives timing information about each processed job.
+  job_scheduler(resource_compiler_impl& compiler, build_trace& trace);
+
+  job_scheduler(const job_scheduler&) = delete;
+  job_scheduler(job_scheduler&&) = delete;
+
+  /// Destructor.
+  ~job_scheduler();
+
+  job_scheduler& operator=(const job_scheduler&) = delete;
+  job_scheduler& operator=(job_scheduler&&) = delete;
+
+  /// Turns all pending matches into jobs and processes them, along with all
+  /// jobs resulting from their outputs, until there is no more work to do.
+  /// @pre
+  ///   Must be called from within a task.
+  std::tuple<std::size_t /*succeeded_job_count*/,
+             std::size_t /*failed_job_count*/>
+  run();
+
+private:
+  /// Creates jobs from the pending matches of all rules that are ready, and
+  /// spawns a task for each modified job.
+  /// @param trigger
+  ///   The trace index of the job whose completion caused this call, or
+  ///   job_trace::no_job.
+  /// @pre
+  ///   _mutex is locked.
+  void schedule(std::size_t trigger);
+
+  /// Processes a single job, and schedules all jobs depending on it
+  /// afterwards.
+  /// @return
+  ///   Whether the job succeeded.
+  bool process(job_description& job, std::size_t trace_index);
+
+  /// Either restores a job's outputs from the artifact store or runs its
+  /// action.
+  bool run_action(job_description& job, bool& restored);
+
+  resource_compiler_impl& _compiler;
+  build_trace& _trace;
+
+  /// Guards all of the following members. Jobs are created while holding
+  /// this lock, so that the file cache is never accessed concurrently.
+  task::mutex _mutex;
+  /// All rules, ordered by pass.
+  std::vector<rule_description*> _rules;
+  /// The number of running jobs per pass.
+  std::map<std::uint32_t, std::size_t> _running_jobs;
+  /// Maps each file written during this update to the trace index of the job
+  /// that produced it.
+  std::unordered_map<const file_description*, std::size_t> _producers;
+  /// All modified jobs, indexed like _trace.jobs. Successful jobs are moved to
+  /// the cache when they complete.
+  std::vector<std::unique_ptr<job_description>> _jobs;
+  std::vector<task::future<bool>> _tasks;
+  /// Becomes ready once no job is running anymore.
+  task::promise<void> _idle;
+  std::size_t _succeeded_job_count = 0;
+  std::size_t _failed_job_count = 0;
+  std::size_t _skipped_job_count = 0;
+
+  /// One mutex per action which does not support multithreading. This map is
+  /// not modified after construction and may thus be read without locking.
+  std::map<const action_base*, std::unique_ptr<task::mutex>> _action_mutexes;
+};
+}
+
+#endif
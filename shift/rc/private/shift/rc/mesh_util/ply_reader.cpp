@@ -0,0 +1,1015 @@
+#include "shift/rc/mesh_util/ply_reader.hpp"
+#include <shift/task/parallel.hpp>
+#include <shift/task/this_task.hpp>
+#include <shift/log/log.hpp>
+#include <shift/math/aabb.hpp>
+#include <shift/math/vector.hpp>
+#include <boost/assert.hpp>
+#include <boost/endian/conversion.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define SHIFT_RC_MESH_UTIL_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace shift::rc::mesh_util
+{
+/// The number of vertices or faces decoded by a single task.
+static constexpr std::size_t elements_per_task = 1 << 16;
+
+/// The number of vertices each column pass works on at once. A pass gathers
+/// one property of this many vertices into a small buffer, which stays in
+/// the L1 cache while it is transformed and scattered to the destination.
+static constexpr std::size_t vertices_per_block = 256;
+
+enum class ply_format
+{
+  ascii,
+  binary_little_endian,
+  binary_big_endian
+};
+
+enum class property_type
+{
+  undefined,
+  uint8,
+  uint16,
+  uint32
+};
+
+/// The vertex properties we understand, which are all 32 bit floats.
+enum class property_name
+{
+  x,
+  y,
+  z,
+  nx,
+  ny,
+  nz,
+  u,
+  v,
+  count
+};
+
+struct ply_header
+{
+  ply_format format = ply_format::binary_little_endian;
+  std::size_t vertex_count = 0;
+  /// The number of properties of each vertex.
+  std::size_t property_count = 0;
+  /// The index of each named property within a vertex, or -1.
+  std::array<int, static_cast<std::size_t>(property_name::count)> properties;
+  std::size_t face_count = 0;
+  property_type list_type = property_type::undefined;
+  property_type index_type = property_type::undefined;
+  /// The offset of the first byte following the header.
+  std::size_t body_offset = 0;
+};
+
+/// Describes how a single vertex property is decoded into one component of a
+/// vertex attribute.
+struct vertex_column
+{
+  /// The byte offset of the property within a source vertex.
+  std::size_t source_offset = 0;
+  /// The component of the first vertex.
+  float* destination = nullptr;
+  /// The distance between the components of two vertices in floats.
+  std::size_t destination_stride = 0;
+  /// Each value is transformed to value * factor + offset.
+  float factor = 1.0f;
+  float offset = 0.0f;
+  /// The axis of the bounding box this column contributes to, or -1.
+  int bounds_axis = -1;
+};
+
+/// The bounding box of a range of vertices.
+struct vertex_bounds
+{
+  std::array<float, 3> min = {std::numeric_limits<float>::infinity(),
+                              std::numeric_limits<float>::infinity(),
+                              std::numeric_limits<float>::infinity()};
+  std::array<float, 3> max = {-std::numeric_limits<float>::infinity(),
+                              -std::numeric_limits<float>::infinity(),
+                              -std::numeric_limits<float>::infinity()};
+};
+
+/// Splits text into whitespace separated tokens.
+class tokenizer
+{
+public:
+  tokenizer(const char* first, const char* last) : _position(first), _last(last)
+  {
+  }
+
+  /// Returns the next token, or an empty string at the end of the text.
+  std::string_view next()
+  {
+    skip_whitespace();
+    const auto* first = _position;
+    while (_position != _last && !is_whitespace(*_position))
+      ++_position;
+    return {first, static_cast<std::size_t>(_position - first)};
+  }
+
+  /// Parses the next token as a number.
+  /// @return
+  ///   False if the token is missing or is not entirely a number.
+  template <typename T>
+  bool next(T& value)
+  {
+    skip_whitespace();
+    auto [end, error] = std::from_chars(_position, _last, value);
+    if (error != std::errc{} || (end != _last && !is_whitespace(*end)))
+      return false;
+    _position = end;
+    return true;
+  }
+
+private:
+  static bool is_whitespace(char character)
+  {
+    return character == ' ' || character == '\t' || character == '\r' ||
+           character == '\n';
+  }
+
+  void skip_whitespace()
+  {
+    while (_position != _last && is_whitespace(*_position))
+      ++_position;
+  }
+
+  const char* _position;
+  const char* _last;
+};
+
+/// Reads face lists from a binary PLY body.
+class binary_face_reader
+{
+public:
+  binary_face_reader(const std::byte* first, const std::byte* last,
+                     std::size_t list_size, std::size_t index_size,
+                     bool swap_bytes)
+  : _position(first),
+    _last(last),
+    _list_size(list_size),
+    _index_size(index_size),
+    _swap_bytes(swap_bytes)
+  {
+  }
+
+  bool read_count(std::uint32_t& value)
+  {
+    return read(_list_size, value);
+  }
+
+  bool read_index(std::uint32_t& value)
+  {
+    return read(_index_size, value);
+  }
+
+private:
+  bool read(std::size_t size, std::uint32_t& value);
+
+  const std::byte* _position;
+  const std::byte* _last;
+  std::size_t _list_size;
+  std::size_t _index_size;
+  bool _swap_bytes;
+};
+
+/// Reads face lists from an ASCII PLY body.
+class ascii_face_reader
+{
+public:
+  explicit ascii_face_reader(tokenizer& tokens) : _tokens(tokens)
+  {
+  }
+
+  bool read_count(std::uint32_t& value)
+  {
+    return _tokens.next(value);
+  }
+
+  bool read_index(std::uint32_t& value)
+  {
+    return _tokens.next(value);
+  }
+
+private:
+  tokenizer& _tokens;
+};
+
+/// Returns the size of a binary property in bytes.
+static std::size_t property_size(property_type type)
+{
+  switch (type)
+  {
+  case property_type::uint8:
+    return 1;
+
+  case property_type::uint16:
+    return 2;
+
+  case property_type::uint32:
+    return 4;
+
+  default:
+    return 0;
+  }
+}
+
+/// Reads an unsigned integer of 1, 2, or 4 bytes.
+static std::uint32_t load_unsigned(const std::byte* source, std::size_t size,
+                                   bool swap_bytes)
+{
+  if (size == 1)
+    return std::to_integer<std::uint32_t>(*source);
+  else if (size == 2)
+  {
+    std::uint16_t value;
+    std::memcpy(&value, source, sizeof(value));
+    return swap_bytes ? boost::endian::endian_reverse(value) : value;
+  }
+  else
+  {
+    std::uint32_t value;
+    std::memcpy(&value, source, sizeof(value));
+    return swap_bytes ? boost::endian::endian_reverse(value) : value;
+  }
+}
+
+/// Reads a binary vertex index.
+template <typename Index>
+static Index load_index(const std::byte* source, bool swap_bytes)
+{
+  Index value;
+  std::memcpy(&value, source, sizeof(value));
+  if constexpr (sizeof(Index) > 1)
+  {
+    if (swap_bytes)
+      value = boost::endian::endian_reverse(value);
+  }
+  return value;
+}
+
+bool binary_face_reader::read(std::size_t size, std::uint32_t& value)
+{
+  if (static_cast<std::size_t>(_last - _position) < size)
+    return false;
+  value = load_unsigned(_position, size, _swap_bytes);
+  _position += size;
+  return true;
+}
+
+/// Calls function with each chunk index in [0, chunk_count). When called from
+/// within a task, chunks are processed in parallel.
+static void for_each_chunk(std::size_t chunk_count,
+                           const std::function<void(std::size_t)>& function)
+{
+  if (chunk_count > 1 && task::this_task::inside_task())
+    task::parallel_for(std::size_t{0}, chunk_count, function, 1);
+  else
+  {
+    for (std::size_t chunk = 0; chunk < chunk_count; ++chunk)
+      function(chunk);
+  }
+}
+
+/// Calls function with a default constructed value of the C++ type matching
+/// an index property type.
+template <typename Function>
+static bool visit_index_type(property_type type, Function&& function)
+{
+  switch (type)
+  {
+  case property_type::uint8:
+    return function(std::uint8_t{});
+
+  case property_type::uint16:
+    return function(std::uint16_t{});
+
+  case property_type::uint32:
+    return function(std::uint32_t{});
+
+  default:
+    BOOST_ASSERT(false);
+    return false;
+  }
+}
+
+/// Parses an index list property type.
+static property_type parse_index_type(std::string_view token, bool is_signed)
+{
+  if (token == "uchar" || token == "uint8" || (is_signed && token == "char"))
+    return property_type::uint8;
+  else if (token == "ushort" || token == "uint16" ||
+           (is_signed && token == "short"))
+  {
+    return property_type::uint16;
+  }
+  else if (token == "uint" || token == "uint32" ||
+           (is_signed && token == "int"))
+  {
+    return property_type::uint32;
+  }
+  else
+    return property_type::undefined;
+}
+
+/// Parses a PLY header.
+/// @return
+///   Whether the header is valid and describes a mesh we support. Errors are
+///   logged.
+static bool parse_header(const char* text, std::size_t size,
+                         ply_header& header)
+{
+  enum class element
+  {
+    none,
+    vertex,
+    face
+  };
+
+  header.properties.fill(-1);
+  bool has_magic = false;
+  bool has_end = false;
+  bool has_vertex_element = false;
+  bool has_face_element = false;
+  auto current_element = element::none;
+  for (std::size_t position = 0; position < size && !has_end;)
+  {
+    auto line_end = static_cast<std::size_t>(
+      std::find(text + position, text + size, '\n') - text);
+    std::string_view line{text + position, line_end - position};
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    position = std::min(line_end + 1, size);
+
+    tokenizer tokens{line.data(), line.data() + line.size()};
+    auto token = tokens.next();
+    if (!has_magic)
+    {
+      if (token != "ply")
+      {
+        log::error() << "No valid PLY header found.";
+        return false;
+      }
+      has_magic = true;
+    }
+    else if (token == "format")
+    {
+      auto format = tokens.next();
+      if (tokens.next() != "1.0")
+      {
+        log::error() << "Unsupported PLY format: " << line;
+        return false;
+      }
+      if (format == "ascii")
+        header.format = ply_format::ascii;
+      else if (format == "binary_little_endian")
+        header.format = ply_format::binary_little_endian;
+      else if (format == "binary_big_endian")
+        header.format = ply_format::binary_big_endian;
+      else
+      {
+        log::error() << "Unsupported PLY format: " << line;
+        return false;
+      }
+    }
+    else if (token == "element")
+    {
+      auto name = tokens.next();
+      std::size_t count = 0;
+      if (!tokens.next(count))
+      {
+        log::error() << "Invalid PLY element: " << line;
+        return false;
+      }
+      if (name == "vertex")
+      {
+        if (has_vertex_element)
+        {
+          log::error() << "Cannot specify multiple vertex definitions";
+          return false;
+        }
+        has_vertex_element = true;
+        current_element = element::vertex;
+        header.vertex_count = count;
+      }
+      else if (name == "face")
+      {
+        if (has_face_element)
+        {
+          log::error() << "Cannot specify multiple vertex index lists";
+          return false;
+        }
+        has_face_element = true;
+        current_element = element::face;
+        header.face_count = count;
+      }
+      else
+      {
+        log::error() << "Unknown PLY element type: " << line;
+        return false;
+      }
+    }
+    else if (token == "property")
+    {
+      auto type = tokens.next();
+      if (type == "list" && current_element == element::face)
+      {
+        auto list_type = parse_index_type(tokens.next(), false);
+        if (list_type == property_type::undefined)
+        {
+          log::error() << "Unsupported vertex index list type: " << line;
+          return false;
+        }
+        auto index_type = parse_index_type(tokens.next(), true);
+        if (index_type == property_type::undefined)
+        {
+          log::error() << "Unsupported vertex element type: " << line;
+          return false;
+        }
+        if (tokens.next() != "vertex_indices")
+        {
+          log::error() << "Expected 'vertex_indices' at end of line: "
+                       << line;
+          return false;
+        }
+        header.list_type = list_type;
+        header.index_type = index_type;
+      }
+      else if ((type == "float" || type == "float32") &&
+               current_element == element::vertex)
+      {
+        auto name = tokens.next();
+        property_name property;
+        if (name == "x")
+          property = property_name::x;
+        else if (name == "y")
+          property = property_name::y;
+        else if (name == "z")
+          property = property_name::z;
+        else if (name == "nx")
+          property = property_name::nx;
+        else if (name == "ny")
+          property = property_name::ny;
+        else if (name == "nz")
+          property = property_name::nz;
+        else if (name == "u" || name == "s")
+          property = property_name::u;
+        else if (name == "v" || name == "t")
+          property = property_name::v;
+        else
+        {
+          log::error() << "Unsupported vertex property: " << line;
+          return false;
+        }
+        auto& index = header.properties[static_cast<std::size_t>(property)];
+        if (index >= 0)
+        {
+          log::error() << "Duplicate vertex property: " << line;
+          return false;
+        }
+        index = static_cast<int>(header.property_count++);
+      }
+      else
+      {
+        log::error() << "Unsupported property type: " << line;
+        return false;
+      }
+    }
+    else if (token == "comment" || token == "obj_info")
+      continue;
+    else if (token == "end_header")
+    {
+      has_end = true;
+      header.body_offset = position;
+    }
+    else
+      log::warning() << "Unknown PLY header: " << line;
+  }
+
+  if (!has_end)
+  {
+    log::error() << "Unexpected end of file within the PLY header.";
+    return false;
+  }
+  if (!has_vertex_element)
+  {
+    log::error() << "PLY files without vertex definitions are not supported.";
+    return false;
+  }
+  if (!has_face_element || header.index_type == property_type::undefined)
+  {
+    log::error() << "PLY files without vertex indices are not supported.";
+    return false;
+  }
+  return true;
+}
+
+/// Byte swaps, transforms, and bounds count values of a single column in
+/// place.
+static void transform_values(std::uint32_t* values, std::size_t count,
+                             bool swap_bytes, float factor, float offset,
+                             float& min, float& max)
+{
+  std::size_t i = 0;
+#if defined(SHIFT_RC_MESH_UTIL_SSSE3)
+  const auto swap_mask =
+    _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  const auto factors = _mm_set1_ps(factor);
+  const auto offsets = _mm_set1_ps(offset);
+  auto mins = _mm_set1_ps(min);
+  auto maxs = _mm_set1_ps(max);
+  for (; i + 4 <= count; i += 4)
+  {
+    auto bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    if (swap_bytes)
+      bits = _mm_shuffle_epi8(bits, swap_mask);
+    auto floats = _mm_mul_ps(_mm_castsi128_ps(bits), factors);
+    // Adding a zero offset would turn negative zeros positive.
+    if (offset != 0.0f)
+      floats = _mm_add_ps(floats, offsets);
+    mins = _mm_min_ps(mins, floats);
+    maxs = _mm_max_ps(maxs, floats);
+    _mm_storeu_ps(reinterpret_cast<float*>(values + i), floats);
+  }
+  alignas(16) std::array<float, 4> lanes;
+  _mm_store_ps(lanes.data(), mins);
+  min = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+  _mm_store_ps(lanes.data(), maxs);
+  max = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+  for (; i < count; ++i)
+  {
+    auto bits = values[i];
+    if (swap_bytes)
+      bits = boost::endian::endian_reverse(bits);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    value *= factor;
+    if (offset != 0.0f)
+      value += offset;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    std::memcpy(&values[i], &value, sizeof(value));
+  }
+}
+
+/// Decodes a single column of count vertices, starting with vertex first.
+static void decode_column(const std::byte* source, std::size_t vertex_size,
+                          std::size_t first, std::size_t count,
+                          bool swap_bytes, const vertex_column& column,
+                          float& min, float& max)
+{
+  alignas(16) std::array<std::uint32_t, vertices_per_block> block;
+  for (std::size_t block_first = first; block_first < first + count;
+       block_first += vertices_per_block)
+  {
+    auto block_count =
+      std::min(vertices_per_block, first + count - block_first);
+
+    const auto* property =
+      source + block_first * vertex_size + column.source_offset;
+    for (std::size_t i = 0; i < block_count; ++i)
+      std::memcpy(&block[i], property + i * vertex_size, sizeof(block[i]));
+
+    transform_values(block.data(), block_count, swap_bytes, column.factor,
+                     column.offset, min, max);
+
+    auto* destination =
+      column.destination + block_first * column.destination_stride;
+    for (std::size_t i = 0; i < block_count; ++i)
+    {
+      std::memcpy(destination + i * column.destination_stride, &block[i],
+                  sizeof(block[i]));
+    }
+  }
+}
+
+/// Decodes all vertices of a binary vertex array.
+/// @return
+///   The bounding box of all columns with a bounds axis.
+static vertex_bounds decode_vertices(const std::byte* source,
+                                     std::size_t vertex_size,
+                                     std::size_t vertex_count, bool swap_bytes,
+                                     const std::vector<vertex_column>& columns)
+{
+  auto chunk_count = (vertex_count + elements_per_task - 1) / elements_per_task;
+  std::vector<vertex_bounds> chunk_bounds(chunk_count);
+  for_each_chunk(chunk_count, [&](std::size_t chunk) {
+    auto first = chunk * elements_per_task;
+    auto count = std::min(elements_per_task, vertex_count - first);
+    auto& bounds = chunk_bounds[chunk];
+    for (const auto& column : columns)
+    {
+      float min = std::numeric_limits<float>::infinity();
+      float max = -std::numeric_limits<float>::infinity();
+      decode_column(source, vertex_size, first, count, swap_bytes, column, min,
+                    max);
+      if (column.bounds_axis >= 0)
+      {
+        bounds.min[column.bounds_axis] = min;
+        bounds.max[column.bounds_axis] = max;
+      }
+    }
+  });
+
+  vertex_bounds result;
+  for (const auto& bounds : chunk_bounds)
+  {
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+      result.min[axis] = std::min(result.min[axis], bounds.min[axis]);
+      result.max[axis] = std::max(result.max[axis], bounds.max[axis]);
+    }
+  }
+  return result;
+}
+
+/// Copies binary faces which are known to all be triangles.
+/// @return
+///   False if any face turns out not to be a triangle.
+template <typename Index>
+static bool copy_triangles(const std::byte* source, std::size_t face_count,
+                           std::size_t list_size, bool swap_bytes, bool flip,
+                           Index* destination)
+{
+  const auto face_size = list_size + 3 * sizeof(Index);
+  std::atomic<bool> valid = true;
+  auto chunk_count = (face_count + elements_per_task - 1) / elements_per_task;
+  for_each_chunk(chunk_count, [&](std::size_t chunk) {
+    auto first = chunk * elements_per_task;
+    auto last = std::min(first + elements_per_task, face_count);
+    for (auto face = first; face < last; ++face)
+    {
+      const auto* face_source = source + face * face_size;
+      if (load_unsigned(face_source, list_size, swap_bytes) != 3)
+      {
+        valid.store(false, std::memory_order_relaxed);
+        return;
+      }
+      face_source += list_size;
+      auto a = load_index<Index>(face_source, swap_bytes);
+      auto b = load_index<Index>(face_source + sizeof(Index), swap_bytes);
+      auto c = load_index<Index>(face_source + 2 * sizeof(Index), swap_bytes);
+      if (flip)
+        std::swap(a, b);
+      destination[face * 3 + 0] = a;
+      destination[face * 3 + 1] = b;
+      destination[face * 3 + 2] = c;
+    }
+  });
+  return valid.load();
+}
+
+/// Reads faces of arbitrary size and triangulates them as fans.
+template <typename Index, typename FaceReader>
+static bool triangulate_faces(FaceReader& reader, std::size_t face_count,
+                              bool flip, std::vector<std::byte>& storage)
+{
+  auto read_index = [&](Index& index) {
+    std::uint32_t value;
+    if (!reader.read_index(value) ||
+        value > std::numeric_limits<Index>::max())
+    {
+      return false;
+    }
+    index = static_cast<Index>(value);
+    return true;
+  };
+
+  std::vector<Index> indices;
+  indices.reserve(face_count * 3);
+  for (std::size_t face = 0; face < face_count; ++face)
+  {
+    std::uint32_t corner_count = 0;
+    if (!reader.read_count(corner_count))
+    {
+      log::error() << "Invalid or truncated face list.";
+      return false;
+    }
+    if (corner_count < 3)
+    {
+      log::error() << "Faces need at least 3 vertices.";
+      return false;
+    }
+
+    Index first;
+    Index previous;
+    Index current;
+    if (!read_index(first) || !read_index(previous))
+    {
+      log::error() << "Invalid or truncated face list.";
+      return false;
+    }
+    for (std::uint32_t corner = 2; corner < corner_count; ++corner)
+    {
+      if (!read_index(current))
+      {
+        log::error() << "Invalid or truncated face list.";
+        return false;
+      }
+      if (flip)
+        indices.insert(indices.end(), {previous, first, current});
+      else
+        indices.insert(indices.end(), {first, previous, current});
+      previous = current;
+    }
+  }
+  storage.resize(indices.size() * sizeof(Index));
+  std::memcpy(storage.data(), indices.data(), storage.size());
+  return true;
+}
+
+/// Adds a region of tightly packed 32 bit floating point vectors for all
+/// vertices to the vertex buffer.
+/// @param vertex_buffer_size
+///   The size of all previous regions, which is increased by the size of the
+///   new region.
+/// @return
+///   The offset of the new region within the vertex buffer.
+/// @remarks
+///   The vertex buffer is not resized. Assigning the buffer to a buffer view
+///   caches the buffer's id, which would hash its whole content otherwise.
+static std::size_t add_attribute(
+  resource_db::mesh& mesh, std::shared_ptr<resource_db::buffer> vertex_buffer,
+  std::size_t& vertex_buffer_size, resource_db::vertex_attribute_usage usage,
+  resource_db::vertex_attribute_data_type data_type,
+  std::size_t component_count, std::size_t vertex_count)
+{
+  resource_db::vertex_attribute attribute;
+  attribute.offset = 0u;
+  attribute.stride =
+    static_cast<std::uint16_t>(component_count * sizeof(float));
+  attribute.usage = usage;
+  attribute.component_type =
+    resource_db::vertex_attribute_component_type::float32;
+  attribute.data_type = data_type;
+  attribute.size = resource_db::vertex_attribute_size(attribute.component_type,
+                                                      attribute.data_type);
+
+  resource_db::buffer_view buffer_view;
+  buffer_view.buffer = vertex_buffer;
+  buffer_view.offset = vertex_buffer_size;
+  buffer_view.size = vertex_count * attribute.stride;
+  vertex_buffer_size += buffer_view.size;
+  attribute.vertex_buffer_view = buffer_view;
+
+  mesh.vertex_attributes.push_back(std::move(attribute));
+  return buffer_view.offset;
+}
+
+bool read_ply(const std::byte* data, std::size_t size,
+              const ply_import_options& options, resource_db::mesh& mesh,
+              std::shared_ptr<resource_db::buffer> vertex_buffer,
+              std::shared_ptr<resource_db::buffer> index_buffer)
+{
+  const auto* text = reinterpret_cast<const char*>(data);
+  ply_header header;
+  if (!parse_header(text, size, header))
+    return false;
+
+  auto index_of = [&](property_name name) {
+    return header.properties[static_cast<std::size_t>(name)];
+  };
+  auto index_x = index_of(property_name::x);
+  auto index_y = index_of(property_name::y);
+  auto index_z = index_of(property_name::z);
+  auto index_nx = index_of(property_name::nx);
+  auto index_ny = index_of(property_name::ny);
+  auto index_nz = index_of(property_name::nz);
+  auto index_u = index_of(property_name::u);
+  auto index_v = index_of(property_name::v);
+  if (options.swap_x_y)
+  {
+    std::swap(index_x, index_y);
+    std::swap(index_nx, index_ny);
+  }
+  if (options.swap_y_z)
+  {
+    std::swap(index_y, index_z);
+    std::swap(index_ny, index_nz);
+  }
+  if (options.swap_x_z)
+  {
+    std::swap(index_x, index_z);
+    std::swap(index_nx, index_nz);
+  }
+  if (index_x < 0 || index_y < 0 || index_z < 0)
+  {
+    log::error() << "We only support 3D position vectors.";
+    return false;
+  }
+  if ((index_nx >= 0 || index_ny >= 0 || index_nz >= 0) &&
+      (index_nx < 0 || index_ny < 0 || index_nz < 0))
+  {
+    log::error() << "We only support 3D normal vectors.";
+    return false;
+  }
+  if ((index_u >= 0) != (index_v >= 0))
+  {
+    log::error() << "We only support 2D texture coordinates.";
+    return false;
+  }
+
+  // Set up all buffer views while the buffers are still empty, see
+  // add_attribute.
+  mesh.index_buffer_view.buffer = index_buffer;
+  const auto vertex_count = header.vertex_count;
+  std::size_t vertex_buffer_size = 0;
+  auto position_offset =
+    add_attribute(mesh, vertex_buffer, vertex_buffer_size,
+                  resource_db::vertex_attribute_usage::position,
+                  resource_db::vertex_attribute_data_type::vec3, 3,
+                  vertex_count);
+  std::size_t normal_offset = 0;
+  if (index_nx >= 0)
+  {
+    normal_offset =
+      add_attribute(mesh, vertex_buffer, vertex_buffer_size,
+                    resource_db::vertex_attribute_usage::normal,
+                    resource_db::vertex_attribute_data_type::vec3, 3,
+                    vertex_count);
+  }
+  std::size_t texcoord_offset = 0;
+  if (index_u >= 0)
+  {
+    texcoord_offset =
+      add_attribute(mesh, vertex_buffer, vertex_buffer_size,
+                    resource_db::vertex_attribute_usage::texcoord,
+                    resource_db::vertex_attribute_data_type::vec2, 2,
+                    vertex_count);
+  }
+  vertex_buffer->storage.resize(vertex_buffer_size);
+
+  // Describe where each property goes.
+  auto* vertices = reinterpret_cast<float*>(vertex_buffer->storage.data());
+  std::vector<vertex_column> columns;
+  auto add_column = [&](int property_index, std::size_t region_offset,
+                        std::size_t component, std::size_t component_count,
+                        float factor, float offset, int bounds_axis) {
+    vertex_column column;
+    column.source_offset =
+      static_cast<std::size_t>(property_index) * sizeof(float);
+    column.destination =
+      vertices + region_offset / sizeof(float) + component;
+    column.destination_stride = component_count;
+    column.factor = factor;
+    column.offset = offset;
+    column.bounds_axis = bounds_axis;
+    columns.push_back(column);
+  };
+  auto position_factor = [&](bool flip) {
+    return flip ? -options.scale : options.scale;
+  };
+  add_column(index_x, position_offset, 0, 3, position_factor(options.flip_x),
+             0.0f, 0);
+  add_column(index_y, position_offset, 1, 3, position_factor(options.flip_y),
+             0.0f, 1);
+  add_column(index_z, position_offset, 2, 3, position_factor(options.flip_z),
+             0.0f, 2);
+  if (index_nx >= 0)
+  {
+    add_column(index_nx, normal_offset, 0, 3, options.flip_nx ? -1.0f : 1.0f,
+               0.0f, -1);
+    add_column(index_ny, normal_offset, 1, 3, options.flip_ny ? -1.0f : 1.0f,
+               0.0f, -1);
+    add_column(index_nz, normal_offset, 2, 3, options.flip_nz ? -1.0f : 1.0f,
+               0.0f, -1);
+  }
+  if (index_u >= 0)
+  {
+    add_column(index_u, texcoord_offset, 0, 2, options.flip_u ? -1.0f : 1.0f,
+               options.flip_u ? 1.0f : 0.0f, -1);
+    add_column(index_v, texcoord_offset, 1, 2, options.flip_v ? -1.0f : 1.0f,
+               options.flip_v ? 1.0f : 0.0f, -1);
+  }
+
+  const bool flip_indices = options.flip_indices ^ options.swap_x_y ^
+                            options.swap_y_z ^ options.swap_x_z ^
+                            options.flip_x ^ options.flip_y ^ options.flip_z;
+  const auto vertex_size = header.property_count * sizeof(float);
+  const auto index_size = property_size(header.index_type);
+  vertex_bounds bounds;
+  if (header.format == ply_format::ascii)
+  {
+    tokenizer tokens{text + header.body_offset, text + size};
+
+    // Parse all values into a native binary vertex array first, which is
+    // then decoded just like a binary file.
+    std::vector<float> values(vertex_count * header.property_count);
+    for (auto& value : values)
+    {
+      if (!tokens.next(value))
+      {
+        log::error() << "Invalid or truncated vertex list.";
+        return false;
+      }
+    }
+    bounds = decode_vertices(reinterpret_cast<const std::byte*>(values.data()),
+                             vertex_size, vertex_count, false, columns);
+
+    ascii_face_reader reader{tokens};
+    if (!visit_index_type(header.index_type, [&](auto index) {
+          return triangulate_faces<decltype(index)>(
+            reader, header.face_count, flip_indices, index_buffer->storage);
+        }))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    const bool swap_bytes =
+      (header.format == ply_format::binary_little_endian) !=
+      (boost::endian::order::native == boost::endian::order::little);
+    const auto body_size = size - header.body_offset;
+    if (vertex_count > body_size / vertex_size)
+    {
+      log::error() << "Unexpected end of file.";
+      return false;
+    }
+    const auto* body = data + header.body_offset;
+    bounds =
+      decode_vertices(body, vertex_size, vertex_count, swap_bytes, columns);
+
+    // Each face has at least three vertices, so if the remaining size
+    // exactly matches that of triangles only, all faces are triangles.
+    const auto* faces = body + vertex_count * vertex_size;
+    const auto faces_size = body_size - vertex_count * vertex_size;
+    const auto list_size = property_size(header.list_type);
+    const auto triangle_size = list_size + 3 * index_size;
+    if (faces_size % triangle_size == 0 &&
+        faces_size / triangle_size == header.face_count)
+    {
+      index_buffer->storage.resize(header.face_count * 3 * index_size);
+      if (!visit_index_type(header.index_type, [&](auto index) {
+            using index_t = decltype(index);
+            return copy_triangles(
+              faces, header.face_count, list_size, swap_bytes, flip_indices,
+              reinterpret_cast<index_t*>(index_buffer->storage.data()));
+          }))
+      {
+        log::error() << "Faces need at least 3 vertices.";
+        return false;
+      }
+    }
+    else
+    {
+      binary_face_reader reader{faces, faces + faces_size, list_size,
+                                index_size, swap_bytes};
+      if (!visit_index_type(header.index_type, [&](auto index) {
+            return triangulate_faces<decltype(index)>(
+              reader, header.face_count, flip_indices, index_buffer->storage);
+          }))
+      {
+        return false;
+      }
+    }
+  }
+  if (vertex_count > 0)
+  {
+    mesh.bounding_box = math::make_aabb_from_min_max<3, float>(
+      math::make_vector_from(bounds.min[0], bounds.min[1], bounds.min[2]),
+      math::make_vector_from(bounds.max[0], bounds.max[1], bounds.max[2]));
+  }
+
+  switch (header.index_type)
+  {
+  case property_type::uint8:
+    mesh.index_data_type = resource_db::vertex_index_data_type::uint8;
+    break;
+
+  case property_type::uint16:
+    mesh.index_data_type = resource_db::vertex_index_data_type::uint16;
+    break;
+
+  default:
+    mesh.index_data_type = resource_db::vertex_index_data_type::uint32;
+    break;
+  }
+  mesh.index_buffer_view.offset = 0;
+  mesh.index_buffer_view.size = index_buffer->storage.size();
+
+  resource_db::sub_mesh sub_mesh;
+  sub_mesh.topology = resource_db::primitive_topology::triangle_list;
+  sub_mesh.vertex_offset = 0;
+  sub_mesh.first_index = 0;
+  sub_mesh.index_count =
+    static_cast<std::uint32_t>(index_buffer->storage.size() / index_size);
+  mesh.sub_meshes.push_back(std::move(sub_mesh));
+  return true;
+}
+}
@@ -0,0 +1,57 @@
+#ifndef SHIFT_RC_MESH_UTIL_PLY_READER_HPP
+#define SHIFT_RC_MESH_UTIL_PLY_READER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <shift/resource_db/buffer.hpp>
+#include <shift/resource_db/mesh.hpp>
+
+namespace shift::rc::mesh_util
+{
+/// Transformations applied to PLY meshes while decoding.
+struct ply_import_options
+{
+  /// A uniform scale factor applied to all positions.
+  float scale = 1.0f;
+
+  bool swap_x_y = false;
+  bool swap_y_z = false;
+  bool swap_x_z = false;
+  bool flip_x = false;
+  bool flip_y = false;
+  bool flip_z = false;
+  bool flip_nx = false;
+  bool flip_ny = false;
+  bool flip_nz = false;
+  /// Replaces each u texture coordinate by 1 - u.
+  bool flip_u = false;
+  /// Replaces each v texture coordinate by 1 - v.
+  bool flip_v = false;
+  /// Reverses the winding order of all faces. Swapping or flipping an odd
+  /// number of axes implicitly toggles this flag.
+  bool flip_indices = false;
+};
+
+/// Decodes a PLY mesh in ASCII, binary little endian, or binary big endian
+/// format from memory.
+/// @param data
+///   The whole PLY file, typically a memory mapped file.
+/// @param vertex_buffer
+///   Receives positions, normals, and texture coordinates in separate
+///   tightly packed regions.
+/// @param index_buffer
+///   Receives a triangle list. Polygons are triangulated as fans.
+/// @return
+///   Whether the file was decoded successfully. Errors are logged.
+/// @remarks
+///   When called from within a task, vertices and triangles of binary files
+///   are decoded in parallel. Vertex properties are decoded one column at a
+///   time, which lets byte swapping, flipping, scaling, and computing the
+///   bounding box each run on four values at once.
+bool read_ply(const std::byte* data, std::size_t size,
+              const ply_import_options& options, resource_db::mesh& mesh,
+              std::shared_ptr<resource_db::buffer> vertex_buffer,
+              std::shared_ptr<resource_db::buffer> index_buffer);
+}
+
+#endif
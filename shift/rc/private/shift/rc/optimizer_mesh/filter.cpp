@@ -1,268 +1,662 @@
 #include "shift/rc/optimizer_mesh/filter.hpp"
 #include <shift/resource_db/mesh.hpp>
-#include <shift/log/log.hpp>
-#include <shift/math/vector.hpp>
-#include <shift/core/hash_table.hpp>
-#include <boost/endian/conversion.hpp>
-#include <filesystem>
-#include <queue>
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
 #include <memory>
 
-namespace std
+namespace shift::rc
+{
+/// Marks a primitive restart in decoded index lists.
+static constexpr std::uint32_t restart_index =
+  std::numeric_limits<std::uint32_t>::max();
+
+/// A region of a vertex buffer holding one or more interleaved vertex
+/// attributes.
+struct mesh_vertex_stream
+{
+  std::shared_ptr<resource_db::buffer> buffer;
+  std::uint32_t offset = 0;
+  std::uint32_t size = 0;
+  std::size_t stride = 0;
+  std::vector<resource_db::vertex_attribute*> attributes;
+};
+
+/// The indices of a sub-mesh decoded to absolute vertex indices.
+struct decoded_sub_mesh
 {
-/// Implementation of the 64bit Murmur hash algorithm to hash vertex data of
-/// arbitrary size.
-template <>
-struct hash<const void*>
+  resource_db::primitive_topology topology;
+  std::vector<std::uint32_t> indices;
+};
+
+static std::size_t index_size(resource_db::vertex_index_data_type data_type)
+{
+  switch (data_type)
+  {
+  case resource_db::vertex_index_data_type::uint8:
+    return 1;
+  case resource_db::vertex_index_data_type::uint16:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+static std::uint32_t read_index(const std::byte* data, std::size_t size)
 {
-  std::size_t operator()(const void* vertex) const
+  switch (size)
   {
-    constexpr auto m = static_cast<std::size_t>(0xc6a4a7935bd1e995ULL);
-    constexpr int r = 47;
+  case 1:
+    return std::to_integer<std::uint32_t>(*data);
 
-    std::size_t remaining_size = vertex_size;
-    std::size_t h = vertex_size;
+  case 2:
+  {
+    std::uint16_t index;
+    std::memcpy(&index, data, sizeof(index));
+    return index;
+  }
 
-    // Mix 4 bytes at a time into the hash
-    const auto* data = reinterpret_cast<const std::uint8_t*>(vertex);
+  default:
+  {
+    std::uint32_t index;
+    std::memcpy(&index, data, sizeof(index));
+    return index;
+  }
+  }
+}
 
-    while (remaining_size >= sizeof(std::size_t))
-    {
-      auto k = *reinterpret_cast<const std::size_t*>(data);
+static void write_index(std::byte* data, std::size_t size,
+                        std::uint32_t index)
+{
+  switch (size)
+  {
+  case 1:
+    *data = static_cast<std::byte>(index);
+    break;
 
-      k *= m;
-      k ^= k >> r;
-      k *= m;
+  case 2:
+  {
+    auto index16 = static_cast<std::uint16_t>(index);
+    std::memcpy(data, &index16, sizeof(index16));
+    break;
+  }
 
-      h *= m;
-      h ^= k;
+  default:
+    std::memcpy(data, &index, sizeof(index));
+    break;
+  }
+}
 
-      data += sizeof(std::size_t);
-      remaining_size -= sizeof(std::size_t);
+/// Converts a sequence of strip or fan indices without restarts into a
+/// triangle list, skipping degenerate triangles.
+static void append_triangles(std::vector<std::uint32_t>& triangles,
+                             const std::uint32_t* first, std::size_t count,
+                             bool fan)
+{
+  for (std::size_t i = 2; i < count; ++i)
+  {
+    std::uint32_t a;
+    std::uint32_t b;
+    if (fan)
+    {
+      a = first[0];
+      b = first[i - 1];
+    }
+    else if (i % 2 == 0)
+    {
+      a = first[i - 2];
+      b = first[i - 1];
     }
+    else
+    {
+      // Every other triangle in a strip has its winding order flipped.
+      a = first[i - 1];
+      b = first[i - 2];
+    }
+    auto c = first[i];
+    if (a != b && b != c && c != a)
+      triangles.insert(triangles.end(), {a, b, c});
+  }
+}
 
-    // Handle the last few bytes of the input array
-    switch (remaining_size)
+/// Splits strips and fans at primitive restarts and converts them to triangle
+/// lists.
+static std::vector<std::uint32_t> to_triangle_list(
+  const std::vector<std::uint32_t>& indices, bool fan)
+{
+  std::vector<std::uint32_t> triangles;
+  triangles.reserve(indices.size() * 3);
+  std::size_t first = 0;
+  for (std::size_t i = 0; i <= indices.size(); ++i)
+  {
+    if (i == indices.size() || indices[i] == restart_index)
     {
-    case 7:
-      h ^= static_cast<std::size_t>(data[6]) << 48;
-      [[fallthrough]];
-    case 6:
-      h ^= static_cast<std::size_t>(data[5]) << 40;
-      [[fallthrough]];
-    case 5:
-      h ^= static_cast<std::size_t>(data[4]) << 32;
-      [[fallthrough]];
-    case 4:
-      h ^= *reinterpret_cast<const std::uint32_t*>(&data[0]);
-      break;
-    case 3:
-      h ^= static_cast<std::size_t>(data[2]) << 16;
-      [[fallthrough]];
-    case 2:
-      h ^= *reinterpret_cast<const std::uint16_t*>(&data[0]);
-      break;
-    case 1:
-      h ^= static_cast<std::size_t>(data[0]);
-    };
-    h *= m;
+      append_triangles(triangles, indices.data() + first, i - first, fan);
+      first = i + 1;
+    }
+  }
+  return triangles;
+}
 
-    h ^= h >> 13;
-    h *= m;
-    h ^= h >> 15;
+static bool is_triangle_list(const decoded_sub_mesh& sub_mesh)
+{
+  return sub_mesh.topology == resource_db::primitive_topology::triangle_list;
+}
 
-    return h;
+/// Simulates the vertex cache over the triangles of all sub-meshes.
+static vertex_cache_statistics analyze_sub_meshes(
+  const std::vector<decoded_sub_mesh>& sub_meshes, std::size_t vertex_count,
+  std::uint32_t cache_size, std::size_t& triangle_count)
+{
+  std::vector<std::uint32_t> triangles;
+  for (const auto& sub_mesh : sub_meshes)
+  {
+    if (is_triangle_list(sub_mesh))
+    {
+      triangles.insert(triangles.end(), sub_mesh.indices.begin(),
+                       sub_mesh.indices.end());
+    }
   }
+  triangle_count = triangles.size() / 3;
+  return analyze_vertex_cache(triangles, vertex_count, cache_size);
+}
 
-  std::size_t vertex_size;
-};
-
-/// An overload of std::equal_to to compare arbitrary vertices.
-template <>
-struct equal_to<const void*>
+/// An implementation of the 64bit Murmur hash algorithm.
+static std::size_t hash_bytes(const std::byte* data, std::size_t size)
 {
-  using first_argument_type = const void*;
-  using second_argument_type = const void*;
-  using result_type = bool;
+  constexpr std::uint64_t m = 0xc6a4a7935bd1e995ULL;
+  constexpr int r = 47;
+
+  std::uint64_t h = size * m;
+  for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t))
+  {
+    std::uint64_t k;
+    std::memcpy(&k, data, sizeof(k));
+    data += sizeof(k);
 
-  bool operator()(const first_argument_type lhs, const second_argument_type rhs)
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+  if (size > 0)
   {
-    return std::memcmp(lhs, rhs, vertex_size) == 0;
+    std::uint64_t k = 0;
+    std::memcpy(&k, data, size);
+    h ^= k;
+    h *= m;
   }
 
-  std::size_t vertex_size;
-};
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return static_cast<std::size_t>(h);
 }
 
-namespace shift::rc
+/// Maps each vertex to the first vertex with equal attributes.
+/// @remarks
+///   All attributes of a vertex are packed into a key. Floating point
+///   components are optionally snapped to a grid before, so that vertices
+///   within the same grid cell produce the same key.
+static std::vector<std::uint32_t> generate_weld_remap(
+  const std::vector<mesh_vertex_stream>& streams, std::size_t vertex_count,
+  const mesh_optimization_options& options)
 {
-namespace fs = std::filesystem;
+  std::size_t key_size = 0;
+  for (const auto& stream : streams)
+  {
+    for (const auto* attribute : stream.attributes)
+      key_size += attribute->size;
+  }
 
-bool optimize_mesh(const job_description& /*job*/)
+  std::vector<std::byte> keys(vertex_count * key_size);
+  std::size_t key_offset = 0;
+  for (const auto& stream : streams)
+  {
+    const auto* source = stream.buffer->storage.data() + stream.offset;
+    for (const auto* attribute : stream.attributes)
+    {
+      auto tolerance =
+        attribute->usage == resource_db::vertex_attribute_usage::position
+          ? options.position_weld_tolerance
+          : options.attribute_weld_tolerance;
+      bool quantize = tolerance > 0.0f &&
+                      attribute->component_type ==
+                        resource_db::vertex_attribute_component_type::float32;
+      for (std::size_t v = 0; v < vertex_count; ++v)
+      {
+        auto* key = keys.data() + v * key_size + key_offset;
+        std::memcpy(key, source + v * stream.stride + attribute->offset,
+                    attribute->size);
+        if (!quantize)
+          continue;
+        for (std::size_t c = 0; c + sizeof(float) <= attribute->size;
+             c += sizeof(float))
+        {
+          float value;
+          std::memcpy(&value, key + c, sizeof(float));
+          // Adding zero turns negative zero into positive zero.
+          value = std::floor(value / tolerance + 0.5f) + 0.0f;
+          std::memcpy(key + c, &value, sizeof(float));
+        }
+      }
+      key_offset += attribute->size;
+    }
+  }
+
+  std::size_t table_size = 1;
+  while (table_size < vertex_count * 2)
+    table_size *= 2;
+  std::vector<std::uint32_t> table(table_size, restart_index);
+
+  std::vector<std::uint32_t> remap(vertex_count);
+  for (std::size_t v = 0; v < vertex_count; ++v)
+  {
+    const auto* key = keys.data() + v * key_size;
+    auto slot = hash_bytes(key, key_size) & (table_size - 1);
+    while (true)
+    {
+      auto& entry = table[slot];
+      if (entry == restart_index)
+      {
+        entry = static_cast<std::uint32_t>(v);
+        remap[v] = entry;
+        break;
+      }
+      if (std::memcmp(keys.data() + entry * key_size, key, key_size) == 0)
+      {
+        remap[v] = entry;
+        break;
+      }
+      slot = (slot + 1) & (table_size - 1);
+    }
+  }
+  return remap;
+}
+
+/// Reorders the triangles of a single triangle list sub-mesh.
+/// @remarks
+///   The sub-mesh's vertices are first mapped to a compact local range so
+///   that the cost of the optimization only depends on the size of the
+///   sub-mesh.
+static void optimize_triangle_order(
+  std::vector<std::uint32_t>& indices, std::vector<std::uint32_t>& local_ids,
+  const std::byte* positions, std::size_t position_stride,
+  const mesh_optimization_options& options)
 {
-  // auto input_file_path = job.input_base_path / job.input_file_path;
-  // if (!fs::exists(input_file_path) ||
-  // !fs::is_regular_file(input_file_path))
-  //{
-  //  log::error() << "Cannot find input file " << input_file_path << ".";
-  //  return false;
-  //}
-
-  // std::ifstream file;
-  // file.open(input_file_path.generic_string(),
-  //          std::ios_base::in | std::ios_base::binary);
-  // if (!file.is_open())
-  //{
-  //  /// ToDo: Throw exception.
-  //  return false;
-  //}
-
-  // std::vector<std::uint32_t> indices;
-  // indices.resize(1000);  // total_indices
-  // std::size_t unique_vertex_count;
-  // unique_vertex_count =
-  //  generate_index_buffer(indices, nullptr, sizeof(vertex));
-  // generate_vertex_buffer(indices, vertices.data(), indices.size(),
-  //                       sizeof(vertex));
-
-  //// Store resource into repository.
-  // resource_db::repository::singleton_instance().save(*mesh,
+  std::vector<std::uint32_t> global_ids;
+  for (auto& index : indices)
+  {
+    auto& local_id = local_ids[index];
+    if (local_id == restart_index)
+    {
+      local_id = static_cast<std::uint32_t>(global_ids.size());
+      global_ids.push_back(index);
+    }
+    index = local_id;
+  }
+  for (auto global_id : global_ids)
+    local_ids[global_id] = restart_index;
 
-  return true;
+  switch (options.vertex_cache)
+  {
+  case vertex_cache_algorithm::tipsify:
+    optimize_vertex_cache_tipsify(indices, global_ids.size(),
+                                  options.cache_size);
+    break;
+
+  case vertex_cache_algorithm::forsyth:
+    optimize_vertex_cache_forsyth(indices, global_ids.size());
+    break;
+
+  case vertex_cache_algorithm::none:
+    break;
+  }
+
+  if (positions != nullptr && options.optimize_overdraw)
+  {
+    std::vector<float> local_positions;
+    local_positions.reserve(global_ids.size() * 3);
+    for (auto global_id : global_ids)
+    {
+      float xyz[3];
+      std::memcpy(xyz, positions + global_id * position_stride, sizeof(xyz));
+      local_positions.insert(local_positions.end(), xyz, xyz + 3);
+    }
+    optimize_overdraw(indices, local_positions, options.overdraw_threshold,
+                      options.cache_size);
+  }
+
+  for (auto& index : indices)
+    index = global_ids[index];
 }
 
-template <typename Index>
-std::vector<std::uint8_t> resolve_vertex_indices(resource_db::mesh& mesh,
-                                                 /* Index* indices, */
-                                                 std::size_t index_count)
+/// Moves all vertices of a stream to their new location. The stream shrinks
+/// to the new vertex count.
+static void reorder_stream(mesh_vertex_stream& stream,
+                           const std::vector<std::uint32_t>& new_ids,
+                           std::size_t new_vertex_count)
 {
-  std::size_t vertex_size = 0;
-  for (auto& attribute : mesh.vertex_attributes)
+  auto* data = stream.buffer->storage.data() + stream.offset;
+  std::vector<std::byte> old_data(data, data + stream.size);
+  for (std::size_t v = 0; v < new_ids.size(); ++v)
   {
-    vertex_size += resource_db::vertex_attribute_size(attribute.component_type,
-                                                      attribute.data_type);
+    if (new_ids[v] == restart_index)
+      continue;
+    auto source = v * stream.stride;
+    std::memcpy(data + new_ids[v] * stream.stride, old_data.data() + source,
+                std::min<std::size_t>(stream.stride, stream.size - source));
   }
-  const auto& index_buffer = mesh.index_buffer_view.buffer->storage;
+  stream.size = static_cast<std::uint32_t>(
+    std::min<std::size_t>(stream.size, new_vertex_count * stream.stride));
+  for (auto* attribute : stream.attributes)
+    attribute->vertex_buffer_view.size = stream.size;
+}
+
+/// Drops the unused tail of each stream from buffers which exclusively store
+/// consecutive vertex streams.
+static void compact_buffers(std::vector<mesh_vertex_stream>& streams,
+                            const std::vector<std::uint32_t>& old_sizes)
+{
+  std::map<resource_db::buffer*, std::vector<std::size_t>> buffer_streams;
+  for (std::size_t s = 0; s < streams.size(); ++s)
+    buffer_streams[streams[s].buffer.get()].push_back(s);
 
-  std::vector<std::uint8_t> destination;
-  destination.resize(index_count * vertex_size);
-  for (std::size_t i = 0; i < index_count; ++i)
+  for (auto& [buffer, stream_ids] : buffer_streams)
   {
-    for (auto& attribute : mesh.vertex_attributes)
+    std::sort(stream_ids.begin(), stream_ids.end(),
+              [&](auto lhs, auto rhs) {
+                return streams[lhs].offset < streams[rhs].offset;
+              });
+    std::size_t end = 0;
+    for (auto s : stream_ids)
+    {
+      if (streams[s].offset != end)
+        break;
+      end += old_sizes[s];
+    }
+    if (end != buffer->storage.size())
+      continue;
+
+    std::uint32_t offset = 0;
+    for (auto s : stream_ids)
     {
-      const auto& vertex_buffer = attribute.vertex_buffer_view.buffer->storage;
-      std::memcpy(
-        destination.data() + i * attribute.stride + attribute.offset,
-        vertex_buffer.data() +
-          *reinterpret_cast<const Index*>(&index_buffer[i * sizeof(Index)]) *
-            attribute.stride +
-          attribute.offset,
-        attribute.size);
+      auto& stream = streams[s];
+      std::memmove(buffer->storage.data() + offset,
+                   buffer->storage.data() + stream.offset, stream.size);
+      stream.offset = offset;
+      for (auto* attribute : stream.attributes)
+        attribute->vertex_buffer_view.offset = offset;
+      offset += stream.size;
     }
+    buffer->storage.resize(offset);
   }
-  return destination;
 }
 
-bool optimize_mesh(resource_db::mesh& mesh)
+bool optimize_mesh(resource_db::mesh& mesh,
+                   const mesh_optimization_options& options,
+                   mesh_optimization_statistics* statistics)
 {
-  if (mesh.sub_meshes.size() != 1)
+  if (mesh.vertex_attributes.empty() || !mesh.index_buffer_view.buffer)
     return true;
 
+  // Group attributes into streams and determine the vertex count.
+  std::vector<mesh_vertex_stream> streams;
+  auto vertex_count = std::numeric_limits<std::size_t>::max();
   for (auto& attribute : mesh.vertex_attributes)
   {
-    if (!attribute.vertex_buffer_view.buffer)
+    auto& view = attribute.vertex_buffer_view;
+    if (!view.buffer || attribute.stride == 0 ||
+        attribute.offset + attribute.size > attribute.stride)
+    {
       return false;
-  }
-  std::vector<std::uint8_t> vertex_buffer;
+    }
+    auto buffer = view.buffer.get_shared();
+    if (static_cast<std::size_t>(view.offset) + view.size >
+        buffer->storage.size())
+    {
+      return false;
+    }
+    if (view.size < attribute.offset + attribute.size)
+      vertex_count = 0;
+    else
+    {
+      vertex_count =
+        std::min<std::size_t>(vertex_count, (view.size - attribute.offset -
+                                             attribute.size) /
+                                                attribute.stride +
+                                              1);
+    }
 
-  if (!mesh.index_buffer_view.buffer)
+    auto stream =
+      std::find_if(streams.begin(), streams.end(), [&](const auto& stream) {
+        return stream.buffer == buffer && stream.offset == view.offset;
+      });
+    if (stream == streams.end())
+    {
+      stream = streams.insert(
+        streams.end(), mesh_vertex_stream{buffer, view.offset, view.size,
+                                          attribute.stride, {}});
+    }
+    else if (stream->size != view.size || stream->stride != attribute.stride)
+      return false;
+    stream->attributes.push_back(&attribute);
+  }
+  if (vertex_count >= restart_index)
     return false;
 
-  std::size_t index_count = 0;
-  for (auto sub_mesh : mesh.sub_meshes)
+  // We can only safely rewrite buffers whose contents are entirely owned by
+  // this mesh's streams.
+  auto index_buffer = mesh.index_buffer_view.buffer.get_shared();
+  if (mesh.index_buffer_view.offset != 0 ||
+      mesh.index_buffer_view.size != index_buffer->storage.size())
+  {
+    return true;
+  }
+  for (std::size_t s = 0; s < streams.size(); ++s)
+  {
+    if (streams[s].buffer == index_buffer)
+      return true;
+    for (std::size_t t = 0; t < s; ++t)
+    {
+      if (streams[s].buffer == streams[t].buffer &&
+          streams[s].offset < streams[t].offset + streams[t].size &&
+          streams[t].offset < streams[s].offset + streams[s].size)
+      {
+        return true;
+      }
+    }
+  }
+
+  // Decode all indices and convert strips and fans to triangle lists.
+  auto old_index_size = index_size(mesh.index_data_type);
+  auto old_restart_index = static_cast<std::uint32_t>(
+    (std::uint64_t{1} << (old_index_size * 8)) - 1);
+  std::vector<decoded_sub_mesh> sub_meshes;
+  sub_meshes.reserve(mesh.sub_meshes.size());
+  for (const auto& sub_mesh : mesh.sub_meshes)
   {
-    switch (sub_mesh.topology)
+    if ((static_cast<std::size_t>(sub_mesh.first_index) +
+         sub_mesh.index_count) *
+          old_index_size >
+        index_buffer->storage.size())
+    {
+      return false;
+    }
+    const auto* source =
+      index_buffer->storage.data() + sub_mesh.first_index * old_index_size;
+    decoded_sub_mesh& decoded = sub_meshes.emplace_back();
+    decoded.topology = sub_mesh.topology;
+    decoded.indices.resize(sub_mesh.index_count);
+    for (std::size_t i = 0; i < sub_mesh.index_count; ++i)
+    {
+      auto index = read_index(source + i * old_index_size, old_index_size);
+      if (index == old_restart_index &&
+          sub_mesh.topology != resource_db::primitive_topology::points &&
+          sub_mesh.topology != resource_db::primitive_topology::line_list &&
+          sub_mesh.topology != resource_db::primitive_topology::triangle_list)
+      {
+        decoded.indices[i] = restart_index;
+        continue;
+      }
+      index += sub_mesh.vertex_offset;
+      if (index >= vertex_count)
+        return false;
+      decoded.indices[i] = index;
+    }
+
+    switch (decoded.topology)
     {
     case resource_db::primitive_topology::triangle_list:
-      index_count = sub_mesh.index_count / 3;
+      decoded.indices.resize(decoded.indices.size() / 3 * 3);
       break;
 
     case resource_db::primitive_topology::triangle_strip:
-      /// ToDo: Find and subtract empty triangles.
-      BOOST_ASSERT(false);  // Not yet implemented.
-      return false;
-
     case resource_db::primitive_topology::triangle_fan:
-      BOOST_ASSERT(false);  // Not yet implemented.
-      return false;
+      decoded.indices = to_triangle_list(
+        decoded.indices,
+        decoded.topology == resource_db::primitive_topology::triangle_fan);
+      decoded.topology = resource_db::primitive_topology::triangle_list;
+      break;
 
     default:
-      BOOST_ASSERT(false);  // Unsupported.
-      return false;
+      break;
     }
   }
 
-  switch (mesh.index_data_type)
-  {
-  case resource_db::vertex_index_data_type::uint8:
-    resolve_vertex_indices<std::uint8_t>(
-      mesh, /*mesh.index_buffer_view.buffer->storage.data(),*/ index_count);
-    break;
+  mesh_optimization_statistics result;
+  result.vertex_count_before = vertex_count;
+  result.before = analyze_sub_meshes(sub_meshes, vertex_count,
+                                     options.cache_size,
+                                     result.triangle_count_before);
 
-  default:
-    // Ignore other cases for now.
-    break;
+  // Weld vertices and drop triangles which became degenerate.
+  auto remap = generate_weld_remap(streams, vertex_count, options);
+  for (auto& sub_mesh : sub_meshes)
+  {
+    for (auto& index : sub_mesh.indices)
+    {
+      if (index != restart_index)
+        index = remap[index];
+    }
+    if (!is_triangle_list(sub_mesh))
+      continue;
+    auto& indices = sub_mesh.indices;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      auto a = indices[i];
+      auto b = indices[i + 1];
+      auto c = indices[i + 2];
+      if (a == b || b == c || c == a)
+        continue;
+      indices[kept++] = a;
+      indices[kept++] = b;
+      indices[kept++] = c;
+    }
+    indices.resize(kept);
   }
 
-  // resolve_vertex_indices(mesh.
-  return true;
-}
-
-std::pair<std::vector<std::uint32_t>, std::size_t> generate_index_buffer(
-  std::vector<std::uint8_t>& vertex_buffer, std::size_t vertex_size)
-{
-  std::size_t vertex_count = vertex_buffer.size() / vertex_size;
-  std::vector<std::uint32_t> indices;
-  indices.resize(vertex_count);
-
-  std::hash<const void*> hasher{vertex_size};
-  std::equal_to<const void*> compare{vertex_size};
-  core::hash_table<const void*, std::size_t> table(vertex_count, hasher,
-                                                   compare);
-
-  std::size_t next_vertex = 0;
-  for (std::size_t i = 0; i < vertex_count; ++i)
+  // Optimize the triangle order of each sub-mesh.
+  const std::byte* positions = nullptr;
+  std::size_t position_stride = 0;
+  for (const auto& stream : streams)
+  {
+    for (const auto* attribute : stream.attributes)
+    {
+      if (positions == nullptr &&
+          attribute->usage == resource_db::vertex_attribute_usage::position &&
+          attribute->component_type ==
+            resource_db::vertex_attribute_component_type::float32 &&
+          attribute->size >= 3 * sizeof(float))
+      {
+        positions =
+          stream.buffer->storage.data() + stream.offset + attribute->offset;
+        position_stride = stream.stride;
+      }
+    }
+  }
+  std::vector<std::uint32_t> local_ids(vertex_count, restart_index);
+  for (auto& sub_mesh : sub_meshes)
   {
-    const void* vertex = vertex_buffer.data() + i * vertex_size;
-    bool unique;
-    std::size_t* value;
-    std::tie(unique, value) = table[vertex];
-    if (unique)
-      *value = next_vertex++;
-    indices[i] = *value;
+    if (is_triangle_list(sub_mesh) && !sub_mesh.indices.empty())
+    {
+      optimize_triangle_order(sub_mesh.indices, local_ids, positions,
+                              position_stride, options);
+    }
   }
 
-  return std::make_pair(std::move(indices), next_vertex);
-}
+  // Reorder vertices by first use, which also drops unreferenced vertices.
+  std::vector<std::uint32_t> new_ids(vertex_count, restart_index);
+  std::uint32_t new_vertex_count = 0;
+  for (auto& sub_mesh : sub_meshes)
+  {
+    for (auto& index : sub_mesh.indices)
+    {
+      if (index == restart_index)
+        continue;
+      if (new_ids[index] == restart_index)
+        new_ids[index] = new_vertex_count++;
+      index = new_ids[index];
+    }
+  }
+  std::vector<std::uint32_t> old_stream_sizes;
+  for (auto& stream : streams)
+  {
+    old_stream_sizes.push_back(stream.size);
+    reorder_stream(stream, new_ids, new_vertex_count);
+  }
+  compact_buffers(streams, old_stream_sizes);
+
+  // Write back all indices, using a larger index type if necessary.
+  auto max_index = new_vertex_count > 0 ? new_vertex_count - 1 : 0;
+  if (max_index >= 0xFFFF)
+    mesh.index_data_type = resource_db::vertex_index_data_type::uint32;
+  else if (max_index >= 0xFF &&
+           mesh.index_data_type == resource_db::vertex_index_data_type::uint8)
+  {
+    mesh.index_data_type = resource_db::vertex_index_data_type::uint16;
+  }
+  auto new_index_size = index_size(mesh.index_data_type);
+  auto new_restart_index = static_cast<std::uint32_t>(
+    (std::uint64_t{1} << (new_index_size * 8)) - 1);
 
-void compress_vertex_buffer(std::vector<std::uint8_t>& vertex_buffer,
-                            std::size_t vertex_size,
-                            std::size_t unique_vertex_count,
-                            const std::vector<std::uint32_t>& indices)
-{
-  std::uint32_t next_vertex = 0;
-  for (std::size_t i = 0; i < unique_vertex_count; ++i)
+  std::size_t index_count = 0;
+  for (const auto& sub_mesh : sub_meshes)
+    index_count += sub_mesh.indices.size();
+  auto& storage = index_buffer->storage;
+  storage.resize(index_count * new_index_size);
+  std::size_t first_index = 0;
+  for (std::size_t s = 0; s < sub_meshes.size(); ++s)
   {
-    BOOST_ASSERT(indices[i] <= next_vertex);
-    if (indices[i] == next_vertex)
+    const auto& indices = sub_meshes[s].indices;
+    for (std::size_t i = 0; i < indices.size(); ++i)
     {
-      if (next_vertex != i)
-      {
-        std::memcpy(vertex_buffer.data() + next_vertex * vertex_size,
-                    vertex_buffer.data() + i * vertex_size, vertex_size);
-      }
-      ++next_vertex;
+      write_index(storage.data() + (first_index + i) * new_index_size,
+                  new_index_size,
+                  indices[i] == restart_index ? new_restart_index
+                                              : indices[i]);
     }
+    auto& sub_mesh = mesh.sub_meshes[s];
+    sub_mesh.topology = sub_meshes[s].topology;
+    sub_mesh.vertex_offset = 0;
+    sub_mesh.first_index = static_cast<std::uint32_t>(first_index);
+    sub_mesh.index_count = static_cast<std::uint32_t>(indices.size());
+    first_index += indices.size();
   }
+  mesh.index_buffer_view.size = static_cast<std::uint32_t>(storage.size());
+
+  result.vertex_count_after = new_vertex_count;
+  result.after = analyze_sub_meshes(sub_meshes, new_vertex_count,
+                                    options.cache_size,
+                                    result.triangle_count_after);
+  if (statistics != nullptr)
+    *statistics = result;
+  return true;
 }
 }
@@ -1,9 +1,9 @@
 #ifndef SHIFT_RC_OPTIMIZER_MESH_FILTER_HPP
 #define SHIFT_RC_OPTIMIZER_MESH_FILTER_HPP
 
-#include <shift/core/exception.hpp>
-#include <shift/resource_db/repository.hpp>
-#include "shift/rc/types.hpp"
+#include <cstdint>
+#include <vector>
+#include "shift/rc/optimizer_mesh/vertex_cache.hpp"
 
 namespace shift::resource_db
 {
@@ -12,26 +12,64 @@ class mesh;
 
 namespace shift::rc
 {
-///
-bool optimize_mesh(const job_description& job);
-
-///
-bool optimize_mesh(resource_db::mesh& mesh);
+/// The algorithm optimize_mesh uses to reorder triangles for the vertex
+/// cache.
+enum class vertex_cache_algorithm
+{
+  none,
+  tipsify,
+  forsyth
+};
 
-///
-std::vector<std::uint8_t> resolve_vertex_indices(
-  const std::vector<std::uint8_t>& vertex_buffer, std::size_t vertex_size,
-  const std::vector<std::uint8_t>& indices, std::size_t index_size);
+/// Selects the optimizations performed by optimize_mesh.
+struct mesh_optimization_options
+{
+  /// Positions are welded if they fall into the same cell of a grid of this
+  /// size. Zero only welds vertices whose positions are bitwise identical.
+  float position_weld_tolerance = 0.0f;
+  /// The same as position_weld_tolerance for all other floating point vertex
+  /// attributes, e.g. normals and texture coordinates.
+  float attribute_weld_tolerance = 0.0f;
+  vertex_cache_algorithm vertex_cache = vertex_cache_algorithm::tipsify;
+  /// The cache size used for Tipsify, overdraw optimization, and statistics.
+  std::uint32_t cache_size = default_vertex_cache_size;
+  /// Whether to reorder triangle clusters to reduce overdraw. This requires
+  /// 32 bit floating point positions.
+  bool optimize_overdraw = true;
+  /// See optimize_overdraw.
+  float overdraw_threshold = 1.05f;
+};
 
-///
-std::pair<std::vector<std::uint32_t>, std::size_t> generate_index_buffer(
-  std::vector<std::uint8_t>& vertex_buffer, std::size_t vertex_size);
+/// Describes a mesh before and after optimization.
+struct mesh_optimization_statistics
+{
+  std::size_t vertex_count_before = 0;
+  std::size_t vertex_count_after = 0;
+  std::size_t triangle_count_before = 0;
+  std::size_t triangle_count_after = 0;
+  vertex_cache_statistics before;
+  vertex_cache_statistics after;
+};
 
-///
-void compress_vertex_buffer(std::vector<std::uint8_t>& vertex_buffer,
-                            std::size_t vertex_size,
-                            std::size_t unique_vertex_count,
-                            const std::vector<std::uint32_t>& indices);
+/// Optimizes a mesh for rendering.
+/// @remarks
+///   The optimization first welds identical vertices and removes
+///   triangles that became degenerate. Triangles of each sub-mesh are then
+///   reordered for the vertex cache and to reduce overdraw. Finally,
+///   vertices are reordered by first use and unreferenced vertices are
+///   removed. Triangle strips and fans are converted to triangle lists,
+///   while the indices of other topologies are only remapped. All index
+///   types are supported. Attributes may either be interleaved or stored in
+///   separate regions.
+///   The function does not use any global state and may be called
+///   concurrently for different meshes. Ids of modified buffers are not
+///   updated.
+/// @return
+///   False if the mesh is malformed. Meshes whose index buffer contains
+///   anything but the mesh's indices are left untouched.
+bool optimize_mesh(resource_db::mesh& mesh,
+                   const mesh_optimization_options& options = {},
+                   mesh_optimization_statistics* statistics = nullptr);
 }
 
 #endif
@@ -0,0 +1,512 @@
+#include "shift/rc/optimizer_mesh/vertex_cache.hpp"
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace shift::rc
+{
+/// Lists the triangles adjacent to each vertex.
+struct vertex_adjacency
+{
+  /// The triangles of vertex v are stored in triangles from offsets[v] up to
+  /// offsets[v + 1].
+  std::vector<std::uint32_t> offsets;
+  /// The number of triangles adjacent to each vertex.
+  std::vector<std::uint32_t> counts;
+  std::vector<std::uint32_t> triangles;
+};
+
+/// Builds the vertex to triangle adjacency of a triangle list.
+static vertex_adjacency build_adjacency(
+  const std::vector<std::uint32_t>& indices, std::size_t vertex_count)
+{
+  vertex_adjacency result;
+  result.counts.resize(vertex_count, 0);
+  for (auto index : indices)
+  {
+    BOOST_ASSERT(index < vertex_count);
+    ++result.counts[index];
+  }
+
+  result.offsets.resize(vertex_count + 1);
+  std::uint32_t offset = 0;
+  for (std::size_t vertex = 0; vertex < vertex_count; ++vertex)
+  {
+    result.offsets[vertex] = offset;
+    offset += result.counts[vertex];
+  }
+  result.offsets[vertex_count] = offset;
+
+  result.triangles.resize(indices.size());
+  auto next = result.offsets;
+  for (std::size_t i = 0; i < indices.size(); ++i)
+    result.triangles[next[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+  return result;
+}
+
+/// Advances a FIFO cache simulated by per vertex timestamps.
+/// @return
+///   Whether the vertex missed the cache.
+static bool update_fifo_cache(std::vector<std::uint32_t>& timestamps,
+                              std::uint32_t& time, std::uint32_t vertex,
+                              std::uint32_t cache_size)
+{
+  if (time - timestamps[vertex] > cache_size)
+  {
+    timestamps[vertex] = time++;
+    return true;
+  }
+  return false;
+}
+
+vertex_cache_statistics analyze_vertex_cache(
+  const std::vector<std::uint32_t>& indices, std::size_t vertex_count,
+  std::uint32_t cache_size)
+{
+  vertex_cache_statistics result;
+  if (indices.size() < 3)
+    return result;
+
+  std::vector<std::uint32_t> timestamps(vertex_count, 0);
+  std::vector<bool> referenced(vertex_count, false);
+  std::size_t referenced_vertex_count = 0;
+  std::uint32_t time = cache_size + 1;
+  for (auto index : indices)
+  {
+    BOOST_ASSERT(index < vertex_count);
+    if (update_fifo_cache(timestamps, time, index, cache_size))
+      ++result.transformed_vertex_count;
+    if (!referenced[index])
+    {
+      referenced[index] = true;
+      ++referenced_vertex_count;
+    }
+  }
+  result.acmr = static_cast<float>(result.transformed_vertex_count) /
+                static_cast<float>(indices.size() / 3);
+  result.atvr = static_cast<float>(result.transformed_vertex_count) /
+                static_cast<float>(referenced_vertex_count);
+  return result;
+}
+
+/// Returns a vertex which still has triangles left, preferring the most
+/// recently used vertices on the dead end stack, or -1 if all triangles have
+/// been emitted.
+static std::int64_t skip_dead_end(const std::vector<std::uint32_t>& live,
+                                  std::vector<std::uint32_t>& dead_end,
+                                  std::size_t& cursor)
+{
+  while (!dead_end.empty())
+  {
+    auto vertex = dead_end.back();
+    dead_end.pop_back();
+    if (live[vertex] > 0)
+      return vertex;
+  }
+  for (; cursor < live.size(); ++cursor)
+  {
+    if (live[cursor] > 0)
+      return static_cast<std::int64_t>(cursor);
+  }
+  return -1;
+}
+
+void optimize_vertex_cache_tipsify(std::vector<std::uint32_t>& indices,
+                                   std::size_t vertex_count,
+                                   std::uint32_t cache_size)
+{
+  if (indices.size() < 6)
+    return;
+
+  auto adjacency = build_adjacency(indices, vertex_count);
+  auto& live = adjacency.counts;
+  std::vector<std::uint32_t> timestamps(vertex_count, 0);
+  std::vector<bool> emitted(indices.size() / 3, false);
+  std::vector<std::uint32_t> dead_end;
+  dead_end.reserve(indices.size());
+  std::vector<std::uint32_t> candidates;
+  std::vector<std::uint32_t> result;
+  result.reserve(indices.size());
+
+  std::uint32_t time = cache_size + 1;
+  std::size_t cursor = 0;
+  for (auto fanning = skip_dead_end(live, dead_end, cursor); fanning >= 0;)
+  {
+    // Emit all remaining triangles around the fanning vertex.
+    candidates.clear();
+    for (auto i = adjacency.offsets[fanning];
+         i < adjacency.offsets[fanning + 1]; ++i)
+    {
+      auto triangle = adjacency.triangles[i];
+      if (emitted[triangle])
+        continue;
+      emitted[triangle] = true;
+      for (std::size_t corner = 0; corner < 3; ++corner)
+      {
+        auto vertex = indices[triangle * 3 + corner];
+        result.push_back(vertex);
+        dead_end.push_back(vertex);
+        candidates.push_back(vertex);
+        --live[vertex];
+        update_fifo_cache(timestamps, time, vertex, cache_size);
+      }
+    }
+
+    // Continue with the candidate that entered the cache earliest, but will
+    // still be cached after emitting all of its triangles.
+    std::int64_t next = -1;
+    std::int64_t best_priority = -1;
+    for (auto vertex : candidates)
+    {
+      if (live[vertex] == 0)
+        continue;
+      std::int64_t priority = 0;
+      if (time - timestamps[vertex] + 2 * live[vertex] <= cache_size)
+        priority = time - timestamps[vertex];
+      if (priority > best_priority)
+      {
+        best_priority = priority;
+        next = vertex;
+      }
+    }
+    if (next < 0)
+      next = skip_dead_end(live, dead_end, cursor);
+    fanning = next;
+  }
+  BOOST_ASSERT(result.size() == indices.size());
+  indices = std::move(result);
+}
+
+/// Tuning constants of Forsyth's vertex cache optimization.
+static constexpr std::uint32_t forsyth_cache_size = 32;
+static constexpr float forsyth_cache_decay_power = 1.5f;
+static constexpr float forsyth_last_triangle_score = 0.75f;
+static constexpr float forsyth_valence_boost_scale = 2.0f;
+static constexpr float forsyth_valence_boost_power = 0.5f;
+
+/// Computes the score of a vertex.
+/// @param cache_position
+///   The position in the LRU cache, or -1 if the vertex is not cached.
+/// @param live
+///   The number of triangles still to be emitted using this vertex.
+static float forsyth_vertex_score(int cache_position, std::uint32_t live)
+{
+  if (live == 0)
+    return -1.0f;
+
+  float score = 0.0f;
+  if (cache_position >= 0)
+  {
+    // The vertices of the last triangle get a fixed score, so that the
+    // algorithm does not prefer triangles sharing an edge with it too much.
+    if (cache_position < 3)
+      score = forsyth_last_triangle_score;
+    else
+    {
+      constexpr float scale = 1.0f / (forsyth_cache_size - 3);
+      score = std::pow(1.0f - (cache_position - 3) * scale,
+                       forsyth_cache_decay_power);
+    }
+  }
+  // Boost vertices with few triangles left, so that the algorithm does not
+  // leave lone triangles behind.
+  score += forsyth_valence_boost_scale *
+           std::pow(static_cast<float>(live), -forsyth_valence_boost_power);
+  return score;
+}
+
+void optimize_vertex_cache_forsyth(std::vector<std::uint32_t>& indices,
+                                   std::size_t vertex_count)
+{
+  if (indices.size() < 6)
+    return;
+
+  const auto triangle_count = indices.size() / 3;
+  auto adjacency = build_adjacency(indices, vertex_count);
+  auto& live = adjacency.counts;
+  std::vector<int> cache_positions(vertex_count, -1);
+  std::vector<float> vertex_scores(vertex_count);
+  for (std::size_t vertex = 0; vertex < vertex_count; ++vertex)
+    vertex_scores[vertex] = forsyth_vertex_score(-1, live[vertex]);
+  std::vector<float> triangle_scores(triangle_count);
+  for (std::size_t triangle = 0; triangle < triangle_count; ++triangle)
+  {
+    triangle_scores[triangle] = vertex_scores[indices[triangle * 3 + 0]] +
+                                vertex_scores[indices[triangle * 3 + 1]] +
+                                vertex_scores[indices[triangle * 3 + 2]];
+  }
+  std::vector<bool> emitted(triangle_count, false);
+
+  // The cache temporarily holds three more entries to make room for the
+  // vertices of the emitted triangle.
+  std::vector<std::uint32_t> cache;
+  std::vector<std::uint32_t> new_cache;
+  cache.reserve(forsyth_cache_size + 3);
+  new_cache.reserve(forsyth_cache_size + 3);
+  std::vector<std::uint32_t> result;
+  result.reserve(indices.size());
+
+  auto best_triangle = static_cast<std::size_t>(std::distance(
+    triangle_scores.begin(),
+    std::max_element(triangle_scores.begin(), triangle_scores.end())));
+  std::size_t cursor = 0;
+  for (std::size_t emitted_count = 0; emitted_count < triangle_count;
+       ++emitted_count)
+  {
+    if (best_triangle == triangle_count)
+    {
+      // We ran into a dead end, so continue with the next triangle in input
+      // order.
+      while (emitted[cursor])
+        ++cursor;
+      best_triangle = cursor;
+    }
+
+    // Emit the triangle and remove it from the adjacency of its vertices.
+    emitted[best_triangle] = true;
+    new_cache.clear();
+    for (std::size_t corner = 0; corner < 3; ++corner)
+    {
+      auto vertex = indices[best_triangle * 3 + corner];
+      result.push_back(vertex);
+      auto* first = adjacency.triangles.data() + adjacency.offsets[vertex];
+      auto* last = first + live[vertex];
+      auto* position = std::find(first, last, best_triangle);
+      BOOST_ASSERT(position != last);
+      std::swap(*position, *(last - 1));
+      --live[vertex];
+      if (std::find(new_cache.begin(), new_cache.end(), vertex) ==
+          new_cache.end())
+      {
+        new_cache.push_back(vertex);
+      }
+    }
+    for (auto vertex : cache)
+    {
+      if (std::find(new_cache.begin(), new_cache.end(), vertex) ==
+          new_cache.end())
+      {
+        new_cache.push_back(vertex);
+      }
+    }
+
+    // Update the scores of all vertices which entered, moved within, or left
+    // the cache, and find the best triangle using any cached vertex.
+    for (std::size_t i = forsyth_cache_size; i < new_cache.size(); ++i)
+      cache_positions[new_cache[i]] = -1;
+    for (std::size_t i = 0; i < new_cache.size(); ++i)
+    {
+      auto vertex = new_cache[i];
+      if (i < forsyth_cache_size)
+        cache_positions[vertex] = static_cast<int>(i);
+      auto score = forsyth_vertex_score(cache_positions[vertex], live[vertex]);
+      auto delta = score - vertex_scores[vertex];
+      vertex_scores[vertex] = score;
+      const auto* triangles =
+        adjacency.triangles.data() + adjacency.offsets[vertex];
+      for (std::uint32_t j = 0; j < live[vertex]; ++j)
+        triangle_scores[triangles[j]] += delta;
+    }
+    if (new_cache.size() > forsyth_cache_size)
+      new_cache.resize(forsyth_cache_size);
+    std::swap(cache, new_cache);
+
+    best_triangle = triangle_count;
+    float best_score = -1.0f;
+    for (auto vertex : cache)
+    {
+      const auto* triangles =
+        adjacency.triangles.data() + adjacency.offsets[vertex];
+      for (std::uint32_t j = 0; j < live[vertex]; ++j)
+      {
+        if (triangle_scores[triangles[j]] > best_score)
+        {
+          best_score = triangle_scores[triangles[j]];
+          best_triangle = triangles[j];
+        }
+      }
+    }
+  }
+  indices = std::move(result);
+}
+
+/// Splits a vertex cache optimized triangle list into clusters, which may be
+/// reordered without significantly increasing the ACMR.
+/// @return
+///   The index of the first triangle of each cluster.
+static std::vector<std::size_t> find_clusters(
+  const std::vector<std::uint32_t>& indices, std::size_t vertex_count,
+  float threshold, std::uint32_t cache_size)
+{
+  const auto triangle_count = indices.size() / 3;
+  std::vector<std::uint32_t> timestamps(vertex_count, 0);
+  std::uint32_t time = cache_size + 1;
+  auto triangle_misses = [&](std::size_t triangle) {
+    std::uint32_t misses = 0;
+    for (std::size_t corner = 0; corner < 3; ++corner)
+    {
+      if (update_fifo_cache(timestamps, time, indices[triangle * 3 + corner],
+                            cache_size))
+      {
+        ++misses;
+      }
+    }
+    return misses;
+  };
+  // Invalidates all cache entries.
+  auto flush_cache = [&]() { time += cache_size + 1; };
+
+  // Start a hard cluster at each triangle whose vertices all miss the cache,
+  // because the order of triangles before does not matter for it.
+  std::vector<std::size_t> hard_clusters;
+  for (std::size_t triangle = 0; triangle < triangle_count; ++triangle)
+  {
+    if (triangle_misses(triangle) == 3 || triangle == 0)
+      hard_clusters.push_back(triangle);
+  }
+
+  // Split each hard cluster at each triangle where the ACMR of the current
+  // part, simulated from an empty cache, reaches the ACMR of the whole
+  // cluster times threshold.
+  std::vector<std::size_t> result;
+  for (std::size_t cluster = 0; cluster < hard_clusters.size(); ++cluster)
+  {
+    auto first = hard_clusters[cluster];
+    auto last = cluster + 1 < hard_clusters.size() ? hard_clusters[cluster + 1]
+                                                   : triangle_count;
+    flush_cache();
+    std::size_t cluster_misses = 0;
+    for (auto triangle = first; triangle < last; ++triangle)
+      cluster_misses += triangle_misses(triangle);
+    auto cluster_threshold = threshold * static_cast<float>(cluster_misses) /
+                             static_cast<float>(last - first);
+
+    result.push_back(first);
+    flush_cache();
+    std::size_t misses = 0;
+    std::size_t triangles = 0;
+    for (auto triangle = first; triangle + 1 < last; ++triangle)
+    {
+      misses += triangle_misses(triangle);
+      ++triangles;
+      if (static_cast<float>(misses) <=
+          cluster_threshold * static_cast<float>(triangles))
+      {
+        result.push_back(triangle + 1);
+        flush_cache();
+        misses = 0;
+        triangles = 0;
+      }
+    }
+  }
+  return result;
+}
+
+void optimize_overdraw(std::vector<std::uint32_t>& indices,
+                       const std::vector<float>& positions, float threshold,
+                       std::uint32_t cache_size)
+{
+  const auto triangle_count = indices.size() / 3;
+  if (triangle_count < 2)
+    return;
+
+  const auto vertex_count = positions.size() / 3;
+  auto clusters = find_clusters(indices, vertex_count, threshold, cache_size);
+  if (clusters.size() < 2)
+    return;
+
+  auto position = [&](std::size_t triangle, std::size_t corner) {
+    const auto* vertex = positions.data() + indices[triangle * 3 + corner] * 3;
+    return std::array<float, 3>{vertex[0], vertex[1], vertex[2]};
+  };
+
+  // Compute the area weighted centroid and normal of each cluster, as well as
+  // the centroid of the whole mesh.
+  struct cluster_info
+  {
+    std::size_t first;
+    std::size_t last;
+    std::array<double, 3> centroid;
+    std::array<double, 3> normal;
+    double area;
+    double sort_key;
+  };
+  std::vector<cluster_info> infos(clusters.size());
+  std::array<double, 3> mesh_centroid = {0.0, 0.0, 0.0};
+  double mesh_area = 0.0;
+  for (std::size_t cluster = 0; cluster < clusters.size(); ++cluster)
+  {
+    auto& info = infos[cluster];
+    info.first = clusters[cluster];
+    info.last = cluster + 1 < clusters.size() ? clusters[cluster + 1]
+                                              : triangle_count;
+    info.centroid = {0.0, 0.0, 0.0};
+    info.normal = {0.0, 0.0, 0.0};
+    info.area = 0.0;
+    for (auto triangle = info.first; triangle < info.last; ++triangle)
+    {
+      auto a = position(triangle, 0);
+      auto b = position(triangle, 1);
+      auto c = position(triangle, 2);
+      std::array<double, 3> ab;
+      std::array<double, 3> ac;
+      for (std::size_t axis = 0; axis < 3; ++axis)
+      {
+        ab[axis] = static_cast<double>(b[axis]) - a[axis];
+        ac[axis] = static_cast<double>(c[axis]) - a[axis];
+      }
+      std::array<double, 3> normal = {ab[1] * ac[2] - ab[2] * ac[1],
+                                      ab[2] * ac[0] - ab[0] * ac[2],
+                                      ab[0] * ac[1] - ab[1] * ac[0]};
+      auto area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
+                            normal[2] * normal[2]);
+      for (std::size_t axis = 0; axis < 3; ++axis)
+      {
+        info.centroid[axis] +=
+          (static_cast<double>(a[axis]) + b[axis] + c[axis]) / 3.0 * area;
+        info.normal[axis] += normal[axis];
+      }
+      info.area += area;
+    }
+    for (std::size_t axis = 0; axis < 3; ++axis)
+      mesh_centroid[axis] += info.centroid[axis];
+    mesh_area += info.area;
+  }
+  if (mesh_area <= 0.0)
+    return;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+    mesh_centroid[axis] /= mesh_area;
+
+  for (auto& info : infos)
+  {
+    info.sort_key = 0.0;
+    auto normal_length =
+      std::sqrt(info.normal[0] * info.normal[0] +
+                info.normal[1] * info.normal[1] +
+                info.normal[2] * info.normal[2]);
+    if (info.area <= 0.0 || normal_length <= 0.0)
+      continue;
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+      info.sort_key += (info.centroid[axis] / info.area - mesh_centroid[axis]) *
+                       info.normal[axis] / normal_length;
+    }
+  }
+
+  // Clusters far out along their normal likely occlude other parts of the
+  // mesh, so draw them first.
+  std::stable_sort(infos.begin(), infos.end(),
+                   [](const cluster_info& lhs, const cluster_info& rhs) {
+                     return lhs.sort_key > rhs.sort_key;
+                   });
+  std::vector<std::uint32_t> result;
+  result.reserve(indices.size());
+  for (const auto& info : infos)
+  {
+    result.insert(result.end(), indices.begin() + info.first * 3,
+                  indices.begin() + info.last * 3);
+  }
+  indices = std::move(result);
+}
+}
@@ -0,0 +1,72 @@
+#ifndef SHIFT_RC_OPTIMIZER_MESH_VERTEX_CACHE_HPP
+#define SHIFT_RC_OPTIMIZER_MESH_VERTEX_CACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace shift::rc
+{
+/// The cache size most vertex cache statistics and optimizations assume.
+static constexpr std::uint32_t default_vertex_cache_size = 16;
+
+/// Statistics about how well a triangle list makes use of a post-transform
+/// vertex cache.
+struct vertex_cache_statistics
+{
+  /// The number of vertices transformed by the simulated cache.
+  std::size_t transformed_vertex_count = 0;
+  /// The average cache miss ratio, which is the number of transformed
+  /// vertices per triangle. It ranges from 3 down to about 0.5 for regular
+  /// meshes.
+  float acmr = 0.0f;
+  /// The average transform to vertex ratio, which is the number of
+  /// transformed vertices per referenced vertex. The optimum is 1.
+  float atvr = 0.0f;
+};
+
+/// Simulates a FIFO vertex cache to rate the order of a triangle list.
+/// @param indices
+///   A triangle list with all indices less than vertex_count.
+vertex_cache_statistics analyze_vertex_cache(
+  const std::vector<std::uint32_t>& indices, std::size_t vertex_count,
+  std::uint32_t cache_size = default_vertex_cache_size);
+
+/// Reorders the triangles of a triangle list to reduce vertex cache misses
+/// using the Tipsify algorithm.
+/// @remarks
+///   See Sander, Nehab, and Barczak, "Fast Triangle Reordering for Vertex
+///   Locality and Reduced Overdraw", 2007. Tipsify fans out from one vertex
+///   at a time and runs in linear time.
+void optimize_vertex_cache_tipsify(
+  std::vector<std::uint32_t>& indices, std::size_t vertex_count,
+  std::uint32_t cache_size = default_vertex_cache_size);
+
+/// Reorders the triangles of a triangle list to reduce vertex cache misses
+/// using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+/// @remarks
+///   This greedily picks the triangle with the best score based on an LRU
+///   cache of 32 entries, which is slower than Tipsify, but usually yields a
+///   slightly lower ACMR and does not depend on the exact cache size.
+void optimize_vertex_cache_forsyth(std::vector<std::uint32_t>& indices,
+                                   std::size_t vertex_count);
+
+/// Reorders clusters of triangles so that triangles likely to occlude others
+/// are drawn first.
+/// @param positions
+///   Three floats for each vertex.
+/// @param threshold
+///   Triangle clusters are split further as long as this does not raise the
+///   ACMR of a cluster by more than this factor. Larger values result in
+///   smaller clusters, and thus less overdraw but more cache misses.
+/// @remarks
+///   The triangle list is expected to be optimized for the vertex cache
+///   already. Clusters start at triangles whose vertices all miss the
+///   simulated cache, and are sorted by how far each cluster faces outwards
+///   of the mesh center.
+void optimize_overdraw(std::vector<std::uint32_t>& indices,
+                       const std::vector<float>& positions, float threshold,
+                       std::uint32_t cache_size = default_vertex_cache_size);
+}
+
+#endif
@@ -1,8 +1,9 @@
 #include "shift/rc/resource_compiler.hpp"
 #include "shift/rc/resource_compiler_impl.hpp"
+#include "shift/rc/directory_artifact_store.hpp"
+#include "shift/rc/job_scheduler.hpp"
 #include "shift/rc/optimizer_mesh/filter.hpp"
 #include <shift/rc/image_util/tiff_io.hpp>
-#include "shift/task/async.hpp"
 #include <shift/log/log.hpp>
 #include <shift/core/stream_util.hpp>
 #include <boost/iostreams/device/file.hpp>
@@ -97,6 +98,25 @@ void resource_compiler::verbose(std::uint32_t level)
   _impl->verbose = level;
 }
 
+const fs::path& resource_compiler::artifact_path() const
+{
+  return _impl->artifact_path;
+}
+
+void resource_compiler::artifact_path(const fs::path& path)
+{
+  std::unique_lock lock(_impl->global_mutex);
+
+  _impl->artifact_path = path;
+  if (path.empty())
+    _impl->artifacts.reset();
+  else
+  {
+    fs::create_directories(path);
+    _impl->artifacts = std::make_unique<directory_artifact_store>(path);
+  }
+}
+
 const fs::path& resource_compiler::image_magick() const
 {
   return _impl->image_magick;
@@ -115,6 +135,8 @@ void resource_compiler::load_rules(const std::string_view rules_filename)
     log::info() << "Loading rule files...";
   /// ToDo: We certainly need to clear more data when rebuilding the rules list.
   _impl->rules.clear();
+  // Drop all references to the old rules in case reading the new ones fails.
+  _impl->compile_rules();
 
   _impl->rules_filename = rules_filename;
 
@@ -134,6 +156,7 @@ void resource_compiler::load_rules(const std::string_view rules_filename)
       _impl->read_rules(rules_file_path, rule_path);
     }
   }
+  _impl->compile_rules();
 }
 
 bool resource_compiler::load_cache(const std::filesystem::path& cache_filename)
@@ -156,6 +179,16 @@ void resource_compiler::save_cache(const std::filesystem::path& cache_filename)
   _impl->cache.save(cache_filename);
 }
 
+void resource_compiler::export_cache(
+  const std::filesystem::path& json_filename)
+{
+  std::unique_lock lock(_impl->global_mutex);
+
+  if (verbose() >= 1)
+    log::info() << "Exporting cache to " << json_filename << "...";
+  _impl->cache.export_json(json_filename);
+}
+
 void resource_compiler::save_cache_graph(
   const std::filesystem::path& cache_graph_filename)
 {
@@ -172,98 +205,8 @@ resource_compiler::update()
 {
   std::unique_lock lock(_impl->global_mutex);
 
-  std::atomic_size_t succeeded_job_count = ATOMIC_VAR_INIT(0);
-  std::atomic_size_t failed_job_count = ATOMIC_VAR_INIT(0);
-
-  // Process a single modified job.
-  auto process_job = [&](rc::job_description* job) -> bool {
-    /// ToDo: Change job parameter of reference type.
-    BOOST_ASSERT(job != nullptr);
-    BOOST_ASSERT(job->rule != nullptr);
-    BOOST_ASSERT(job->rule->action != nullptr);
-    if (job == nullptr || job->rule == nullptr || job->rule->action == nullptr)
-    {
-      job->flags.set(entity_flag::failed);
-      ++failed_job_count;
-      return false;
-    }
-
-    // There should be no tasks for unmodified jobs.
-    BOOST_ASSERT(job->flags.test(entity_flag::modified));
-
-    bool result = false;
-    try
-    {
-      result = job->rule->action->impl->process(*_impl, *job);
-      if (verbose() >= 1)
-      {
-        log::info line;
-        bool first = true;
-        line << "(";
-        for (const auto& [input_slot_index, input] : job->inputs)
-        {
-          if (first)
-            first = false;
-          else
-            line << ", ";
-          line << input_slot_index << ": " << input->file->generic_string;
-        }
-        line << ") -> (";
-        first = true;
-        for (const auto& output : job->outputs)
-        {
-          if (first)
-            first = false;
-          else
-            line << ", ";
-          line << output->generic_string;
-        }
-        line << ")";
-      }
-    }
-    catch (boost::exception& e)
-    {
-      {
-        log::info line;
-        bool first = true;
-        line << "(";
-        for (const auto& [input_slot_index, input] : job->inputs)
-        {
-          if (first)
-            first = false;
-          else
-            line << ", ";
-          line << input_slot_index << ": " << input->file->generic_string;
-        }
-        line << ") -> failed";
-      }
-      log::exception() << boost::diagnostic_information(e);
-    }
-
-    if (result)
-    {
-      job->flags.reset(entity_flag::failed);
-      ++succeeded_job_count;
-      job->mark_as_used();
-
-      // Push all output files into the pipeline.
-      for (auto* output_file : job->outputs)
-      {
-        BOOST_ASSERT(output_file != nullptr);
-        _impl->match_file(*output_file, job->rule->pass);
-      }
-      return true;
-    }
-    else
-    {
-      job->flags.set(entity_flag::failed);
-      log::error() << "A job using rule " << job->rule->id << " failed.";
-      return false;
-    }
-  };
-
   // Try to match each file found in input_path with one of the available rules.
-  std::uint32_t current_pass = 0;
+  std::vector<file_description*> input_files;
   for (auto input_iterator =
          fs::recursive_directory_iterator(_impl->input_path);
        input_iterator != fs::recursive_directory_iterator(); ++input_iterator)
@@ -271,108 +214,52 @@ resource_compiler::update()
     const auto& file_path = input_iterator->path();
     if (fs::is_regular_file(file_path))
     {
-      if (auto* file = _impl->add_file(file_path, current_pass);
-          file != nullptr)
-      {
-        _impl->match_file(*file, current_pass);
-      }
+      if (auto* file = _impl->add_file(file_path, 0); file != nullptr)
+        input_files.push_back(file);
     }
   }
+  _impl->match_files(input_files, 0);
 
-  // Loop until there is no more work to do.
-  /// ToDo: Add method to quit this loop early.
-  for (;;)
-  {
-    std::vector<std::unique_ptr<job_description>> jobs;
-    {
-      std::shared_lock read_lock(_impl->rules_mutex);
-      do
-      {
-        current_pass = _impl->next_pass(current_pass, read_lock);
-        if (current_pass == 0)
-          return {succeeded_job_count, failed_job_count};
-        jobs = _impl->query_jobs(current_pass, read_lock);
-      } while (jobs.empty());
-    }
-    BOOST_ASSERT(current_pass != 0);
-
-    std::vector<task::future<bool>> task_results;
-    // Count the number of modified jobs in the current pass.
-    std::size_t modified_jobs_count = 0;
-    for (const auto& job : jobs)
-    {
-      if (job->flags.test(entity_flag::modified))
-        ++modified_jobs_count;
-      else
-      {
-        job->mark_as_used();
-        // Push all output files of cached jobs into the pipeline. This is
-        // required to make sure that jobs with multiple input files, but only
-        // few of these modified, get re-run with all associated input files.
-        for (auto* output_file : job->outputs)
-        {
-          BOOST_ASSERT(output_file != nullptr);
-          _impl->match_file(*output_file, job->rule->pass);
-        }
-      }
-    }
-    task_results.reserve(modified_jobs_count);
-    log::info() << "Queuing " << modified_jobs_count
-                << " modified jobs(s) in pass " << current_pass << " (skipping "
-                << (jobs.size() - modified_jobs_count)
-                << " unmodified job(s))...";
+  _impl->trace = {};
+  job_scheduler scheduler(*_impl, _impl->trace);
+  auto result = scheduler.run();
 
-    {
-      // Spawn all jobs serially that don't support multithreading.
-      // Use an empty dummy task to ease initialization of serial_result.
-      auto serial_result = task::async([]() -> bool { return true; });
-      bool has_serial_job = false;
-      for (const auto& job : jobs)
-      {
-        if (!job->flags.test(entity_flag::modified) ||
-            job->rule->action->impl->support_multithreading())
-        {
-          continue;
-        }
-
-        serial_result = std::move(serial_result)
-                          .then(
-                            [&](task::future<bool> previous_result,
-                                rc::job_description* job) -> bool {
-                              return previous_result.get() && process_job(job);
-                            },
-                            job.get());
-        has_serial_job = true;
-      }
-      if (has_serial_job)
-      {
-        // Add the last serial_result to the list of futures to wait on.
-        task_results.emplace_back(std::move(serial_result));
-      }
-    }
+  if (_impl->artifacts)
+    _impl->flush_artifact_statistics();
+  if (_impl->verbose >= 1)
+  {
+    log::info() << "Avoided rebuilds of "
+                << _impl->cache.unchanged_content_count()
+                << " file(s) with new timestamps but unchanged contents.";
+  }
+  log_critical_path(_impl->trace, _impl->verbose);
+  return result;
+}
 
-    // Spawn all jobs in parallel that do support multithreading.
-    for (const auto& job : jobs)
-    {
-      if (!job->flags.test(entity_flag::modified) ||
-          !job->rule->action->impl->support_multithreading())
-      {
-        continue;
-      }
+void resource_compiler::save_trace(const std::filesystem::path& trace_filename)
+{
+  std::unique_lock lock(_impl->global_mutex);
 
-      task_results.emplace_back(task::async(process_job, job.get()));
-    }
+  if (verbose() >= 1)
+    log::info() << "Saving build trace " << trace_filename << "...";
+  if (!save_chrome_trace(_impl->trace, trace_filename))
+    log::warning() << "Cannot write build trace " << trace_filename << ".";
+}
 
-    // Wait until all tasks completed.
-    task::when_all(begin(task_results), end(task_results)).get();
+std::size_t resource_compiler::collect_artifacts(std::uint64_t max_size,
+                                                std::chrono::seconds max_age)
+{
+  std::unique_lock lock(_impl->global_mutex);
 
-    // Cache all succeeded jobs.
-    for (auto& job : jobs)
-    {
-      if (!job->flags.test(entity_flag::failed))
-        _impl->cache.add_job(std::move(job));
-    }
+  if (!_impl->artifacts)
+    return 0;
+  auto removed_count = _impl->artifacts->evict(max_size, max_age);
+  if (verbose() >= 1)
+  {
+    log::info() << "Evicted " << removed_count << " artifact(s) from "
+                << _impl->artifact_path << ".";
   }
+  return removed_count;
 }
 
 void resource_compiler::collect_garbage()
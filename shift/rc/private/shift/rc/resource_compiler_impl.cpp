@@ -1,5 +1,6 @@
 #include "shift/rc/resource_compiler_impl.hpp"
 #include "shift/rc/types.hpp"
+#include "shift/rc/content_hash.hpp"
 #include "shift/rc/action_group_resources.hpp"
 #include "shift/rc/action_image_import_tiff.hpp"
 #include "shift/rc/action_image_export_tiff.hpp"
@@ -13,12 +14,14 @@
 #include "shift/rc/action_scene_import_pbrt.hpp"
 #include <shift/resource_db/repository.hpp>
 #include <shift/parser/json/json.hpp>
+#include <shift/task/parallel.hpp>
 #include <shift/log/log.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/lexical_cast.hpp>
 #include <chrono>
 #include <map>
 #include <set>
+#include <sstream>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
@@ -102,9 +105,7 @@ void resource_compiler_impl::read_rules(const fs::path& rules_file_path,
     input = merge_slashes(input);
     try
     {
-      return rule_input{input,
-                        std::regex{input, std::regex_constants::ECMAScript |
-                                            std::regex_constants::icase}};
+      return rule_input{input, rule_pattern{input}};
     }
     catch (const std::regex_error&)
     {
@@ -350,7 +351,12 @@ file_description* resource_compiler_impl::add_file(const fs::path& file_path,
   if (insert_result.second)
     insert_result.first->second = std::make_unique<file_description>(file_path);
   auto* file = insert_result.first->second.get();
+  auto previous_write_time = file->last_write_time;
+  auto previous_size = file->size;
 
+  file->size = fs::file_size(file_path, error_code);
+  if (error_code)
+    return nullptr;
 #if defined(_MSC_VER)
   // This ugly hack attempts to convert a std::filesystem::file_time_type to
   // std::chrono::system_clock::time_point. It likely produces wrong results
@@ -368,6 +374,12 @@ file_description* resource_compiler_impl::add_file(const fs::path& file_path,
   if (error_code)
     return nullptr;
 #endif
+  // The content hash needs to be recomputed if the file changed.
+  if (file->last_write_time != previous_write_time ||
+      file->size != previous_size)
+  {
+    file->content_hash = 0;
+  }
   if (file->pass < pass)
     file->pass = pass;
   file->flags.set(entity_flag::exists).set(entity_flag::modified);
@@ -384,91 +396,286 @@ file_description* resource_compiler_impl::get_file(const fs::path& file_path)
     return nullptr;
 }
 
-void resource_compiler_impl::match_file(file_description& file,
-                                        std::uint32_t current_pass)
+std::string resource_compiler_impl::portable_path(const fs::path& path) const
 {
-  file.flags |= entity_flag::used;
+  const auto generic_path = path.generic_string();
+  for (const auto& [base_path, variable] :
+       {std::pair{&input_path, "<input-path/>"},
+        std::pair{&build_path, "<build-path/>"},
+        std::pair{&output_path, "<output-path/>"}})
+  {
+    auto prefix = base_path->generic_string() + '/';
+    if (generic_path.compare(0, prefix.size(), prefix) == 0)
+      return variable + generic_path.substr(prefix.size());
+  }
+  return {};
+}
 
-  // Skip rule files because they cannot be source of any action.
-  if (file.path.filename() == rules_filename)
-    return;
+fs::path resource_compiler_impl::resolve_portable_path(
+  const std::string& path) const
+{
+  for (const auto& [base_path, variable] :
+       {std::pair{&input_path, std::string_view{"<input-path/>"}},
+        std::pair{&build_path, std::string_view{"<build-path/>"}},
+        std::pair{&output_path, std::string_view{"<output-path/>"}}})
+  {
+    if (path.compare(0, variable.size(), variable) == 0)
+      return *base_path / path.substr(variable.size());
+  }
+  return {};
+}
+
+artifact_key resource_compiler_impl::make_artifact_key(
+  const job_description& job) const
+{
+  content_hasher hasher;
+  auto add_value = [&](std::uint64_t value) {
+    hasher.update(&value, sizeof(value));
+  };
+  auto add_string = [&](std::string_view value) {
+    add_value(value.size());
+    hasher.update(value.data(), value.size());
+  };
+
+  const auto& rule = *job.rule;
+  // Such actions read further files by path, e.g. meshes and textures
+  // referenced by a scene, whose contents are not covered by the key.
+  if (rule.action->impl->depends_on_previous_passes())
+    return 0;
 
-  std::size_t match_count = 0;
-  for (auto& rule : rules)
+  add_string(rule.action->name);
+  add_string(rule.action->version);
+  add_string(rule.path.generic_string());
+  for (const auto& [name, output] : rule.outputs)
   {
-    // Ignore rules of previous passes to avoid infinite recursion.
-    if (rule->pass <= current_pass)
-      continue;
+    add_string(name);
+    add_string(output);
+  }
+  for (const auto index : rule.group_by)
+    add_value(index);
+  std::ostringstream options;
+  options << rule.options;
+  add_string(options.str());
+
+  // Input patterns contain local paths, so instead of these hash the
+  // portable input paths along with the captures used for naming outputs.
+  std::vector<std::pair<std::size_t, const input_match*>> ordered_inputs;
+  for (const auto& [slot_index, input] : job.inputs)
+    ordered_inputs.emplace_back(slot_index, input.get());
+  std::sort(ordered_inputs.begin(), ordered_inputs.end(),
+            [](const auto& lhs, const auto& rhs) {
+              return lhs.first < rhs.first ||
+                     (lhs.first == rhs.first &&
+                      lhs.second->file->generic_string <
+                        rhs.second->file->generic_string);
+            });
+  for (const auto& [slot_index, input] : ordered_inputs)
+  {
+    auto path = portable_path(input->file->path);
+    if (path.empty() || input->file->content_hash == 0)
+      return 0;
+    add_string(input->slot->first);
+    add_string(path);
+    add_value(input->file->content_hash);
+    for (std::size_t i = 1; i < input->match_results.size(); ++i)
+      add_string(input->match_results[i].str());
+  }
+
+  // Zero denotes jobs which cannot be cached.
+  auto key = hasher.finish();
+  return key != 0 ? key : 1;
+}
+
+bool resource_compiler_impl::restore_artifact(job_description& job)
+{
+  BOOST_ASSERT(artifacts);
+  auto count = [&](bool hit) {
+    std::lock_guard lock(artifact_statistics_mutex);
+    auto& statistics = artifact_statistics_by_action[job.rule->action->name];
+    ++(hit ? statistics.hits : statistics.misses);
+    return hit;
+  };
 
-    // Try to match the relative file path with each rule input regex.
-    std::size_t slot_index = 0;
-    for (auto input_iter = rule->inputs.begin();
-         input_iter != rule->inputs.end(); ++input_iter, ++slot_index)
+  auto key = make_artifact_key(job);
+  std::vector<artifact_output> outputs;
+  if (key == 0 || !artifacts->find(key, outputs))
+    return count(false);
+
+  std::vector<fs::path> target_paths;
+  target_paths.reserve(outputs.size());
+  for (std::size_t i = 0; i < outputs.size(); ++i)
+  {
+    auto target_path = resolve_portable_path(outputs[i].path);
+    if (target_path.empty() ||
+        !artifacts->fetch(key, i, outputs[i], target_path))
     {
-      std::smatch match_results;
-      if (std::regex_search(file.generic_string, match_results,
-                            input_iter->second.pattern))
-      {
-        ++match_count;
+      return count(false);
+    }
+    target_paths.push_back(std::move(target_path));
+  }
 
-        auto match = std::make_unique<input_match>();
-        match->slot_index = slot_index;
-        match->slot = input_iter;
-        match->file = &file;
-        match->match_results = std::move(match_results);
-        std::lock_guard rule_lock(rule->matches_mutex);
-        rule->matches.emplace_back(std::move(match));
+  auto& repository = resource_db::repository::singleton_instance();
+  for (std::size_t i = 0; i < outputs.size(); ++i)
+  {
+    const auto& output = outputs[i];
+    if (output.id != 0 && !repository.insert(output.id, target_paths[i]))
+    {
+      job.outputs.clear();
+      return count(false);
+    }
+    auto* output_file = push(target_paths[i], job);
+    if (output_file == nullptr)
+    {
+      job.outputs.clear();
+      return count(false);
+    }
+    // The contents have just been verified against the stored hash.
+    output_file->content_hash = output.content_hash;
+    if (output.alias.empty())
+      continue;
+    for (auto& [input_slot_index, input] : job.inputs)
+    {
+      if (portable_path(input->file->path) == output.alias)
+        input->file->alias = output_file;
+    }
+  }
+  return count(true);
+}
 
-        if (verbose >= 2)
-        {
-          log::info() << "File " << file.path << R"( matched against rule ")"
-                      << rule->id << '"';
-        }
-        // A file can only match one slot per rule.
-        break;
-      }
+void resource_compiler_impl::store_artifact(job_description& job)
+{
+  BOOST_ASSERT(artifacts);
+  auto key = make_artifact_key(job);
+  if (key == 0)
+    return;
+
+  auto& repository = resource_db::repository::singleton_instance();
+  std::vector<artifact_output> outputs;
+  std::vector<fs::path> source_paths;
+  for (auto* output_file : job.outputs)
+  {
+    auto& output = outputs.emplace_back();
+    output.path = portable_path(output_file->path);
+    cache.update_fingerprint(*output_file);
+    if (output.path.empty() || output_file->content_hash == 0)
+      return;
+    output.size = output_file->size;
+    output.content_hash = output_file->content_hash;
+    output.id = repository.lookup_id(output_file->path);
+    for (const auto& [input_slot_index, input] : job.inputs)
+    {
+      if (input->file->alias == output_file)
+        output.alias = portable_path(input->file->path);
     }
+    source_paths.push_back(output_file->path);
+  }
+
+  if (artifacts->store(key, outputs, source_paths))
+  {
+    std::lock_guard lock(artifact_statistics_mutex);
+    ++artifact_statistics_by_action[job.rule->action->name].stores;
   }
+}
 
-  if (match_count == 0 && verbose >= 2)
+void resource_compiler_impl::flush_artifact_statistics()
+{
+  std::lock_guard lock(artifact_statistics_mutex);
+  for (const auto& [action_name, statistics] : artifact_statistics_by_action)
+  {
+    log::info() << R"(Artifacts of action ")" << action_name
+                << R"(": )" << statistics.hits << " hit(s), "
+                << statistics.misses << " miss(es), " << statistics.stores
+                << " stored.";
+  }
+  artifact_statistics_by_action.clear();
+}
+
+void resource_compiler_impl::compile_rules()
+{
+  matcher = rule_matcher(rules);
+}
+
+resource_compiler_impl::rule_matches resource_compiler_impl::find_matches(
+  file_description& file, std::uint32_t current_pass)
+{
+  rule_matches result;
+  file.flags |= entity_flag::used;
+
+  // Skip rule files because they cannot be source of any action.
+  if (file.path.filename() == rules_filename)
+    return result;
+
+  matcher.match(
+    file.generic_string, current_pass,
+    [&](rule_description& rule, std::size_t slot_index,
+        std::map<std::string, rule_input>::const_iterator slot,
+        pattern_match& match_results) {
+      auto match = std::make_unique<input_match>();
+      match->slot_index = slot_index;
+      match->slot = slot;
+      match->file = &file;
+      match->match_results = std::move(match_results);
+      result.emplace_back(&rule, std::move(match));
+
+      if (verbose >= 2)
+      {
+        log::info() << "File " << file.path << R"( matched against rule ")"
+                    << rule.id << '"';
+      }
+    });
+
+  if (result.empty() && verbose >= 2)
     log::info() << "File " << file.path << " didn't match against any rule.";
+  return result;
 }
 
-std::uint32_t resource_compiler_impl::next_pass(
-  std::uint32_t previous_pass,
-  std::shared_lock<std::shared_mutex>& /* rules_read_lock */)
+void resource_compiler_impl::match_file(file_description& file,
+                                        std::uint32_t current_pass)
 {
-  std::uint32_t next_pass = 0;
-  for (auto& rule : rules)
+  for (auto& [rule, match] : find_matches(file, current_pass))
   {
-    if (!rule->matches.empty() && rule->pass > previous_pass &&
-        (next_pass == 0 || next_pass > rule->pass))
+    std::lock_guard rule_lock(rule->matches_mutex);
+    rule->matches.emplace_back(std::move(match));
+  }
+}
+
+void resource_compiler_impl::match_files(
+  const std::vector<file_description*>& files, std::uint32_t current_pass)
+{
+  std::vector<rule_matches> matches(files.size());
+  task::parallel_transform(files.begin(), files.end(), matches.begin(),
+                           [&](file_description* file) {
+                             return find_matches(*file, current_pass);
+                           });
+
+  // Jobs are generated in the order of matches, which thus must not depend on
+  // scheduling.
+  for (auto& file_matches : matches)
+  {
+    for (auto& [rule, match] : file_matches)
     {
-      next_pass = rule->pass;
+      std::lock_guard rule_lock(rule->matches_mutex);
+      rule->matches.emplace_back(std::move(match));
     }
   }
-  return next_pass;
 }
 
 std::vector<std::unique_ptr<job_description>>
 resource_compiler_impl::query_jobs(
-  std::uint32_t pass, std::shared_lock<std::shared_mutex>& /* read_lock */)
+  rule_description& rule,
+  std::shared_lock<std::shared_mutex>& /* rules_read_lock */)
 {
   std::vector<std::unique_ptr<job_description>> jobs;
+  auto pass = rule.pass;
 
-  // Process each rule's matches separately.
-  for (auto* rule : rules)
   {
-    // Skip rules that are not in the current pass.
-    if (rule->pass != pass)
-      continue;
-
-    for (auto& new_match : rule->matches)
+    std::lock_guard rule_lock(rule.matches_mutex);
+    for (auto& new_match : rule.matches)
     {
       // Multiple matches may be grouped together into a single job when the
       // rule's group_by set is not empty.
       bool merged_with_existing_job = false;
-      if (!rule->group_by.empty())
+      if (!rule.group_by.empty())
       {
         // Check whether this match shall be merged into an existing job of the
         // same rule.
@@ -476,7 +683,7 @@ resource_compiler_impl::query_jobs(
              existing_job_iter != jobs.rend(); ++existing_job_iter)
         {
           auto& existing_job = **existing_job_iter;
-          if (existing_job.rule != rule)
+          if (existing_job.rule != &rule)
             break;
 
           bool do_match = true;
@@ -497,7 +704,7 @@ resource_compiler_impl::query_jobs(
             for (std::size_t match_id = 1;
                  match_id < new_match->match_results.size(); ++match_id)
             {
-              if (rule->group_by.find(match_id) != rule->group_by.end())
+              if (rule.group_by.find(match_id) != rule.group_by.end())
                 continue;
               if (existing_match.match_results[match_id].str() !=
                   new_match->match_results[match_id].str())
@@ -521,102 +728,115 @@ resource_compiler_impl::query_jobs(
       {
         if (verbose >= 2)
         {
-          log::debug() << R"(Adding new job based on rule ")" << rule->id
+          log::debug() << R"(Adding new job based on rule ")" << rule.id
                        << '"';
         }
         auto& new_job = jobs.emplace_back(std::make_unique<job_description>());
-        new_job->rule = rule;
+        new_job->rule = &rule;
         auto slot_index = new_match->slot_index;
         new_job->inputs.insert({slot_index, std::move(new_match)});
       }
     }
 
     // All matches of this rule should have been moved to jobs at this point.
-    rule->matches.clear();
+    rule.matches.clear();
+  }
+
+  // Fingerprint all input files in parallel up front, so that files which
+  // were merely touched do not cause their jobs to be re-run.
+  std::vector<file_description*> input_files;
+  for (const auto& job : jobs)
+  {
+    for (const auto& [input_slot_index, input] : job->inputs)
+    {
+      if (input->file->content_hash == 0)
+        input_files.push_back(input->file);
+    }
   }
+  cache.update_fingerprints(input_files);
 
   // Add all modified jobs to the list of jobs to process.
   for (auto& job : jobs)
   {
-    if (job->rule->pass == pass)
+    bool skip_job = true;
+    // Check if there is an equivalent job in our cache.
+    if (const auto* cached_job = cache.get_job(*job);
+        cached_job != nullptr && !cache.is_modified(*cached_job))
     {
-      bool skip_job = true;
-      // Check if there is an equivalent job in our cache.
-      if (const auto* cached_job = cache.get_job(*job);
-          cached_job != nullptr && !cache.is_modified(*cached_job))
+      // If so, copy the cached job output files over.
+      for (const auto* cached_output : cached_job->outputs)
       {
-        // If so, copy the cached job output files over.
-        for (const auto* cached_output : cached_job->outputs)
+        if (auto* output_file = add_file(cached_output->path, pass);
+            output_file != nullptr)
         {
-          if (auto* output_file = add_file(cached_output->path, pass);
-              output_file != nullptr)
-            job->outputs.insert(output_file);
-          else
-          {
-            // If one of the cached output files does not exist we have to
-            // process this job.
-            // log::debug() << "Won't skip job because output file "
-            //             << cached_output->path << " cannot be found.";
-            job->outputs.clear();
-            skip_job = false;
-            break;
-          }
+          cache.update_fingerprint(*output_file);
+          job->outputs.insert(output_file);
+        }
+        else
+        {
+          // If one of the cached output files does not exist we have to
+          // process this job.
+          // log::debug() << "Won't skip job because output file "
+          //             << cached_output->path << " cannot be found.";
+          job->outputs.clear();
+          skip_job = false;
+          break;
         }
+      }
 
-        if (skip_job && !cache.is_modified(*job))
+      if (skip_job && !cache.is_modified(*job))
+      {
+        // If the job is indeed unmodified we can eventually adopt alias links
+        // from input to output files.
+        for (const auto& [cached_input_slot_index, cached_input_match] :
+             cached_job->inputs)
         {
-          // If the job is indeed unmodified we can eventually adopt alias links
-          // from input to output files.
-          for (const auto& [cached_input_slot_index, cached_input_match] :
-               cached_job->inputs)
+          if (cached_input_match->file->alias)
           {
-            if (cached_input_match->file->alias)
+            for (const auto& [input_slot_index, input_match] : job->inputs)
             {
-              for (const auto& [input_slot_index, input_match] : job->inputs)
+              if (cached_input_slot_index == input_slot_index &&
+                  input_match->file->hash == cached_input_match->file->hash &&
+                  input_match->file->path == cached_input_match->file->path)
               {
-                if (cached_input_slot_index == input_slot_index &&
-                    input_match->file->hash == cached_input_match->file->hash &&
-                    input_match->file->path == cached_input_match->file->path)
+                for (auto* output_file : job->outputs)
                 {
-                  for (auto* output_file : job->outputs)
+                  if (output_file->hash ==
+                        cached_input_match->file->alias->hash &&
+                      output_file->path ==
+                        cached_input_match->file->alias->path)
                   {
-                    if (output_file->hash ==
-                          cached_input_match->file->alias->hash &&
-                        output_file->path ==
-                          cached_input_match->file->alias->path)
-                    {
-                      input_match->file->alias = output_file;
-                      break;
-                    }
+                    input_match->file->alias = output_file;
+                    break;
                   }
-                  break;
                 }
+                break;
               }
             }
           }
         }
-        else
-        {
-          // The job is modified because one of the dependencies (action, rule,
-          // input, or output) is modified.
-          // log::debug() << "Won't skip job because some dependency is
-          // modified.";
-          skip_job = false;
-        }
       }
       else
       {
-        // There is no cached job.
-        // log::debug() << "Won't skip job because there is no cached
-        // equivalent.";
+        // The job is modified because one of the dependencies (action, rule,
+        // input, or output) is modified.
+        // log::debug() << "Won't skip job because some dependency is
+        // modified.";
         skip_job = false;
-        /// ToDo: Do this later!
-        // cache.add_job(*job);
       }
-
-      if (!skip_job)
-        job->flags.set(entity_flag::modified);
     }
+    else
+    {
+      // There is no cached job.
+      // log::debug() << "Won't skip job because there is no cached
+      // equivalent.";
+      skip_job = false;
+      /// ToDo: Do this later!
+      // cache.add_job(*job);
+    }
+
+    if (!skip_job)
+      job->flags.set(entity_flag::modified);
   }
 
   return jobs;
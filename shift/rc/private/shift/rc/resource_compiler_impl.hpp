@@ -3,11 +3,16 @@
 
 #include <vector>
 #include <queue>
+#include <map>
+#include <memory>
 #include <unordered_map>
 #include <shared_mutex>
 #include <shift/resource_db/resource.hpp>
 #include "shift/rc/types.hpp"
 #include "shift/rc/data_cache.hpp"
+#include "shift/rc/rule_matcher.hpp"
+#include "shift/rc/artifact_store.hpp"
+#include "shift/rc/build_trace.hpp"
 #include "shift/rc/resource_compiler.hpp"
 
 namespace shift::rc
@@ -48,23 +53,77 @@ public:
   /// Looks up a file in the list of previously added files.
   file_description* get_file(const fs::path& file_path);
 
+  /// A list of new matches along with the rules they belong to.
+  using rule_matches =
+    std::vector<std::pair<rule_description*, std::unique_ptr<input_match>>>;
+
+  /// Compiles the input patterns of the currently loaded rule set. This must
+  /// be called after each change to rules.
+  void compile_rules();
+
+  /// Matches a file against the currently loaded rule set, without modifying
+  /// any rule.
+  /// @remarks
+  ///   This method may be called concurrently for different files.
+  rule_matches find_matches(file_description& file,
+                            std::uint32_t current_pass);
+
   /// Try to match a file against the currently loaded rule set, eventually
   /// adding a new match to a rule's matches vector.
   void match_file(file_description& file, std::uint32_t current_pass);
 
-  /// Walk through the currently loaded rule set and finds the next pass that
-  /// contains matches which eventually transform to jobs.
-  /// @return
-  ///   Either the next valid pass always larger than previous_pass, or zero
-  ///   if there aren't any more matches in higher passes available.
-  std::uint32_t next_pass(
-    std::uint32_t previous_pass,
+  /// Matches a list of files in parallel, and adds the new matches to the
+  /// rules in the order of files.
+  /// @pre
+  ///   Must be called from within a task.
+  void match_files(const std::vector<file_description*>& files,
+                   std::uint32_t current_pass);
+
+  /// Turns all pending matches of a rule into jobs, and flags those that are
+  /// modified compared to their cached equivalent.
+  /// @remarks
+  ///   Outputs of unmodified jobs are taken over from the cache, but are not
+  ///   matched against subsequent rules yet.
+  /// @pre
+  ///   Must be called from within a task.
+  std::vector<std::unique_ptr<job_description>> query_jobs(
+    rule_description& rule,
     std::shared_lock<std::shared_mutex>& /* rules_read_lock */);
 
-  /// Walk through the currently loaded rule set and generates a list of jobs
-  /// for the pass selected.
-  std::vector<std::unique_ptr<job_description>> query_jobs(
-    std::uint32_t pass, std::shared_lock<std::shared_mutex>& /* read_lock */);
+  /// Replaces the input, build, or output path prefix of path with the
+  /// respective variable.
+  /// @return
+  ///   An empty string if path is not located in one of these folders.
+  std::string portable_path(const fs::path& path) const;
+
+  /// Reverts portable_path.
+  /// @return
+  ///   An empty path if path does not start with a known variable.
+  fs::path resolve_portable_path(const std::string& path) const;
+
+  /// Computes the key under which a job's outputs are stored in the artifact
+  /// store.
+  /// @return
+  ///   Zero if the job cannot be cached, e.g. because some input file has no
+  ///   content hash or is located outside of the known folders, or because
+  ///   its action depends on previous passes and thus reads files that are
+  ///   no inputs of the job.
+  artifact_key make_artifact_key(const job_description& job) const;
+
+  /// Tries to restore all outputs of a job from the artifact store instead of
+  /// running its action.
+  /// @pre
+  ///   An artifact store is set and all of the job's input files have been
+  ///   fingerprinted.
+  bool restore_artifact(job_description& job);
+
+  /// Adds the outputs of a successfully processed job to the artifact store.
+  /// @pre
+  ///   An artifact store is set.
+  void store_artifact(job_description& job);
+
+  /// Logs and resets the artifact statistics of all actions.
+  void flush_artifact_statistics();
 
   fs::path input_path;
   fs::path build_path;
@@ -78,10 +137,22 @@ public:
   std::mutex global_mutex;
   std::shared_mutex rules_mutex;
   std::vector<rule_description*> rules;
+  rule_matcher matcher;
   data_cache cache;
 
   std::shared_mutex files_mutex;
   std::unordered_map<fs::path, std::unique_ptr<file_description>> files;
+
+  fs::path artifact_path;
+  /// An optional store of job outputs, which may be shared between
+  /// multiple machines.
+  std::unique_ptr<artifact_store> artifacts;
+  std::mutex artifact_statistics_mutex;
+  /// Artifact hits and misses per action name.
+  std::map<std::string, artifact_statistics> artifact_statistics_by_action;
+
+  /// Timing information about all jobs processed during the last update.
+  build_trace trace;
 };
 }
 
@@ -0,0 +1,148 @@
+#include "shift/rc/rule_matcher.hpp"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+namespace shift::rc
+{
+static char to_lower(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+rule_matcher::rule_matcher(const std::vector<rule_description*>& rules)
+{
+  _trie.emplace_back();
+  std::unordered_map<std::string, std::uint32_t> literal_ids;
+  for (auto* rule : rules)
+  {
+    std::size_t slot_index = 0;
+    for (auto slot = rule->inputs.cbegin(); slot != rule->inputs.cend();
+         ++slot, ++slot_index)
+    {
+      auto entry_index = static_cast<std::uint32_t>(_entries.size());
+      _entries.push_back({rule, slot_index, slot});
+
+      const auto& literal = slot->second.pattern.required_literal();
+      if (literal.empty())
+      {
+        _unfiltered_entries.push_back(entry_index);
+        continue;
+      }
+      auto [literal_iter, inserted] = literal_ids.try_emplace(
+        literal, static_cast<std::uint32_t>(_literal_entries.size()));
+      if (inserted)
+      {
+        _literal_entries.emplace_back();
+
+        // Insert the new literal into the trie.
+        std::uint32_t node = 0;
+        for (auto c : literal)
+        {
+          auto next = child(node, c);
+          if (next == 0)
+          {
+            next = static_cast<std::uint32_t>(_trie.size());
+            auto& children = _trie[node].children;
+            children.insert(
+              std::upper_bound(
+                children.begin(), children.end(), c,
+                [](char lhs, const auto& rhs) { return lhs < rhs.first; }),
+              std::make_pair(c, next));
+            _trie.emplace_back();
+          }
+          node = next;
+        }
+        _trie[node].literal = static_cast<std::int32_t>(literal_iter->second);
+      }
+      _literal_entries[literal_iter->second].push_back(entry_index);
+    }
+  }
+
+  // Compute failure links in breadth first order, so that the links of all
+  // shorter prefixes are already known.
+  std::queue<std::uint32_t> queue;
+  for (const auto& [c, node] : _trie.front().children)
+    queue.push(node);
+  while (!queue.empty())
+  {
+    auto node = queue.front();
+    queue.pop();
+    for (const auto& [c, next] : _trie[node].children)
+    {
+      auto failure = _trie[node].failure;
+      while (failure != 0 && child(failure, c) == 0)
+        failure = _trie[failure].failure;
+      failure = child(failure, c);
+      auto& next_node = _trie[next];
+      next_node.failure = failure;
+      next_node.output =
+        _trie[failure].literal >= 0 ? failure : _trie[failure].output;
+      queue.push(next);
+    }
+  }
+}
+
+std::size_t rule_matcher::match(std::string_view path,
+                                std::uint32_t current_pass,
+                                const match_handler& handler) const
+{
+  std::vector<std::uint32_t> candidates = _unfiltered_entries;
+  if (!_literal_entries.empty())
+  {
+    // Find all required literals contained in the path, ignoring case.
+    std::vector<bool> found_literals(_literal_entries.size(), false);
+    std::uint32_t node = 0;
+    for (auto c : path)
+    {
+      c = to_lower(c);
+      while (node != 0 && child(node, c) == 0)
+        node = _trie[node].failure;
+      node = child(node, c);
+      for (auto output = _trie[node].literal >= 0 ? node : _trie[node].output;
+           output != 0; output = _trie[output].output)
+      {
+        auto literal = static_cast<std::size_t>(_trie[output].literal);
+        if (!found_literals[literal])
+        {
+          found_literals[literal] = true;
+          candidates.insert(candidates.end(), _literal_entries[literal].begin(),
+                            _literal_entries[literal].end());
+        }
+      }
+    }
+    // Restore the order of the rule set and its input slots.
+    std::sort(candidates.begin(), candidates.end());
+  }
+
+  std::size_t match_count = 0;
+  const rule_description* matched_rule = nullptr;
+  for (auto entry_index : candidates)
+  {
+    const auto& entry = _entries[entry_index];
+    // Ignore rules of previous passes to avoid infinite recursion, and
+    // further slots of rules which already matched, because a file can only
+    // match one slot per rule.
+    if (entry.rule->pass <= current_pass || entry.rule == matched_rule)
+      continue;
+
+    pattern_match match_results;
+    if (entry.slot->second.pattern.search(path, &match_results))
+    {
+      matched_rule = entry.rule;
+      ++match_count;
+      handler(*entry.rule, entry.slot_index, entry.slot, match_results);
+    }
+  }
+  return match_count;
+}
+
+std::uint32_t rule_matcher::child(std::uint32_t node, char c) const
+{
+  const auto& children = _trie[node].children;
+  auto iter = std::lower_bound(
+    children.begin(), children.end(), c,
+    [](const auto& lhs, char rhs) { return lhs.first < rhs; });
+  return (iter != children.end() && iter->first == c) ? iter->second : 0;
+}
+}
@@ -0,0 +1,75 @@
+#ifndef SHIFT_RC_RULE_MATCHER_HPP
+#define SHIFT_RC_RULE_MATCHER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "shift/rc/types.hpp"
+
+namespace shift::rc
+{
+/// Matches file paths against the input patterns of a whole rule set.
+/// @remarks
+///   Instead of running every pattern of every rule on each file, the
+///   required literals of all patterns (usually the file extension) are
+///   combined into a single Aho-Corasick automaton. One scan over a path then
+///   yields the few patterns which may match at all, and only those are run.
+///   The matcher keeps pointers into the rules, so it must be rebuilt
+///   whenever the rule set changes.
+class rule_matcher
+{
+public:
+  /// Called for each rule that matches a file. slot is the first matching
+  /// input slot of the rule and slot_index its position in rule.inputs.
+  using match_handler = std::function<void(
+    rule_description& rule, std::size_t slot_index,
+    std::map<std::string, rule_input>::const_iterator slot,
+    pattern_match& match_results)>;
+
+  /// Default constructor creating a matcher without any rules.
+  rule_matcher() = default;
+
+  /// Compiles the input patterns of all rules.
+  explicit rule_matcher(const std::vector<rule_description*>& rules);
+
+  /// Matches path against all rules of passes later than current_pass and
+  /// calls handler for each match, in the order of the rule set.
+  /// @return
+  ///   The number of matching rules.
+  /// @remarks
+  ///   This method may be called concurrently.
+  std::size_t match(std::string_view path, std::uint32_t current_pass,
+                    const match_handler& handler) const;
+
+private:
+  struct entry
+  {
+    rule_description* rule;
+    std::size_t slot_index;
+    std::map<std::string, rule_input>::const_iterator slot;
+  };
+
+  struct trie_node
+  {
+    /// Outgoing edges sorted by character.
+    std::vector<std::pair<char, std::uint32_t>> children;
+    std::uint32_t failure = 0;
+    /// The next node along the failure chain which ends a literal.
+    std::uint32_t output = 0;
+    /// The index of the literal ending in this node, or -1.
+    std::int32_t literal = -1;
+  };
+
+  std::uint32_t child(std::uint32_t node, char c) const;
+
+  std::vector<entry> _entries;
+  /// Entries whose pattern has no required literal and must always be tried.
+  std::vector<std::uint32_t> _unfiltered_entries;
+  /// For each distinct literal the entries requiring it.
+  std::vector<std::vector<std::uint32_t>> _literal_entries;
+  std::vector<trie_node> _trie;
+};
+}
+
+#endif
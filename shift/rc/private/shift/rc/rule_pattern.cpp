@@ -0,0 +1,969 @@
+#include "shift/rc/rule_pattern.hpp"
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+
+namespace shift::rc
+{
+namespace
+{
+  using byte_set = std::bitset<256>;
+
+  /// Thrown by the parser when it encounters a construct which is not
+  /// supported by the automaton. Such patterns are handed to std::regex, which
+  /// also takes care of reporting syntax errors.
+  struct unsupported_pattern
+  {
+  };
+
+  /// The maximum number of instructions of a compiled pattern.
+  constexpr std::size_t max_program_size = 1 << 14;
+
+  /// The maximum number of states of a pattern's automaton. Patterns
+  /// exceeding this limit are matched using the Pike VM alone.
+  constexpr std::size_t max_state_count = 1 << 12;
+
+  /// The maximum number of a counted repetition, e.g. a{1,1000}.
+  constexpr int max_repeat_count = 1000;
+
+  constexpr bool is_upper(int c)
+  {
+    return c >= 'A' && c <= 'Z';
+  }
+
+  constexpr bool is_lower(int c)
+  {
+    return c >= 'a' && c <= 'z';
+  }
+
+  constexpr bool is_digit(int c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  constexpr int to_lower(int c)
+  {
+    return is_upper(c) ? c - 'A' + 'a' : c;
+  }
+
+  /// Adds the other case of all letters in set.
+  byte_set fold_case(byte_set set)
+  {
+    for (int c = 'a'; c <= 'z'; ++c)
+    {
+      if (set.test(c) || set.test(c - 'a' + 'A'))
+        set.set(c).set(c - 'a' + 'A');
+    }
+    return set;
+  }
+
+  /// Returns the smallest character in set, or -1 if set is empty.
+  int first_character(const byte_set& set)
+  {
+    for (int c = 0; c < 256; ++c)
+    {
+      if (set.test(static_cast<std::size_t>(c)))
+        return c;
+    }
+    return -1;
+  }
+
+  byte_set range_set(int first, int last)
+  {
+    byte_set result;
+    for (int c = first; c <= last; ++c)
+      result.set(c);
+    return result;
+  }
+
+  byte_set char_set(std::string_view characters)
+  {
+    byte_set result;
+    for (auto c : characters)
+      result.set(static_cast<unsigned char>(c));
+    return result;
+  }
+
+  /// A node of a pattern's abstract syntax tree.
+  struct node
+  {
+    enum class kind
+    {
+      set,
+      concat,
+      alternate,
+      repeat,
+      group,
+      begin,
+      end
+    };
+
+    kind type = kind::concat;
+    byte_set set;
+    std::vector<node> children;
+    int min = 0;
+    /// The maximum number of repetitions, or -1 for no upper bound.
+    int max = 0;
+    bool greedy = true;
+    /// The index of a capturing group, or -1 for non-capturing groups.
+    int capture = -1;
+  };
+
+  /// Returns whether n matches the empty string.
+  bool nullable(const node& n)
+  {
+    switch (n.type)
+    {
+    case node::kind::set:
+      return false;
+    case node::kind::concat:
+      return std::all_of(n.children.begin(), n.children.end(), nullable);
+    case node::kind::alternate:
+      return std::any_of(n.children.begin(), n.children.end(), nullable);
+    case node::kind::repeat:
+      return n.min == 0 || nullable(n.children.front());
+    case node::kind::group:
+      return nullable(n.children.front());
+    default:
+      return true;
+    }
+  }
+
+  /// A recursive descent parser for the supported subset of ECMAScript
+  /// regular expressions.
+  class parser
+  {
+  public:
+    parser(std::string_view source) : _source(source)
+    {
+    }
+
+    node parse()
+    {
+      auto result = parse_alternation();
+      if (!at_end())
+        throw unsupported_pattern{};
+      return result;
+    }
+
+    int capture_count() const
+    {
+      return _capture_count;
+    }
+
+  private:
+    bool at_end() const
+    {
+      return _position >= _source.size();
+    }
+
+    int peek(std::size_t offset = 0) const
+    {
+      return _position + offset < _source.size()
+               ? static_cast<unsigned char>(_source[_position + offset])
+               : -1;
+    }
+
+    int next()
+    {
+      if (at_end())
+        throw unsupported_pattern{};
+      return static_cast<unsigned char>(_source[_position++]);
+    }
+
+    bool consume(int c)
+    {
+      if (peek() != c)
+        return false;
+      ++_position;
+      return true;
+    }
+
+    node parse_alternation()
+    {
+      auto first = parse_concat();
+      if (peek() != '|')
+        return first;
+
+      node result;
+      result.type = node::kind::alternate;
+      result.children.push_back(std::move(first));
+      while (consume('|'))
+        result.children.push_back(parse_concat());
+      return result;
+    }
+
+    node parse_concat()
+    {
+      node result;
+      result.type = node::kind::concat;
+      while (!at_end() && peek() != '|' && peek() != ')')
+        result.children.push_back(parse_quantified());
+      return result;
+    }
+
+    node parse_quantified()
+    {
+      auto atom = parse_atom();
+
+      int min = 0;
+      int max = 0;
+      if (consume('*'))
+        max = -1;
+      else if (consume('+'))
+      {
+        min = 1;
+        max = -1;
+      }
+      else if (consume('?'))
+        max = 1;
+      else if (peek() == '{')
+        parse_braces(min, max);
+      else
+        return atom;
+
+      // Repeating empty matches, as in (a*)*, is left to std::regex because
+      // the captures of such loops differ between implementations.
+      if (atom.type == node::kind::begin || atom.type == node::kind::end ||
+          (max < 0 && nullable(atom)))
+      {
+        throw unsupported_pattern{};
+      }
+      node result;
+      result.type = node::kind::repeat;
+      result.min = min;
+      result.max = max;
+      result.greedy = !consume('?');
+      result.children.push_back(std::move(atom));
+      return result;
+    }
+
+    /// Parses {n}, {n,} and {n,m}.
+    void parse_braces(int& min, int& max)
+    {
+      next();
+      auto parse_number = [&]() {
+        if (!is_digit(peek()))
+          throw unsupported_pattern{};
+        int result = 0;
+        while (is_digit(peek()))
+        {
+          result = result * 10 + (next() - '0');
+          if (result > max_repeat_count)
+            throw unsupported_pattern{};
+        }
+        return result;
+      };
+      min = parse_number();
+      max = min;
+      if (consume(','))
+        max = peek() == '}' ? -1 : parse_number();
+      if (!consume('}') || (max >= 0 && max < min))
+        throw unsupported_pattern{};
+    }
+
+    node parse_atom()
+    {
+      node result;
+      auto c = next();
+      switch (c)
+      {
+      case '(':
+        result.type = node::kind::group;
+        if (peek() == '?')
+        {
+          // Only non-capturing groups are supported, but no lookaheads.
+          if (peek(1) != ':')
+            throw unsupported_pattern{};
+          _position += 2;
+        }
+        else
+          result.capture = ++_capture_count;
+        result.children.push_back(parse_alternation());
+        if (!consume(')'))
+          throw unsupported_pattern{};
+        return result;
+
+      case '[':
+        result.type = node::kind::set;
+        result.set = parse_class();
+        return result;
+
+      case '.':
+        result.type = node::kind::set;
+        result.set = ~char_set("\n\r");
+        return result;
+
+      case '^':
+        result.type = node::kind::begin;
+        return result;
+
+      case '$':
+        result.type = node::kind::end;
+        return result;
+
+      case '\\':
+        result.type = node::kind::set;
+        result.set = parse_escape(false);
+        return result;
+
+      case ')':
+      case '*':
+      case '+':
+      case '?':
+      case '{':
+      case '}':
+      case ']':
+        throw unsupported_pattern{};
+
+      default:
+        result.type = node::kind::set;
+        result.set.set(static_cast<std::size_t>(c));
+        result.set = fold_case(result.set);
+        return result;
+      }
+    }
+
+    /// Parses the character following a backslash.
+    byte_set parse_escape(bool in_class)
+    {
+      static const auto digits = range_set('0', '9');
+      static const auto word =
+        range_set('a', 'z') | range_set('A', 'Z') | digits | char_set("_");
+      static const auto space = char_set(" \t\n\v\f\r");
+
+      auto c = next();
+      switch (c)
+      {
+      case 'd':
+        return digits;
+      case 'D':
+        return ~digits;
+      case 'w':
+        return word;
+      case 'W':
+        return ~word;
+      case 's':
+        return space;
+      case 'S':
+        return ~space;
+      case 't':
+        return char_set("\t");
+      case 'n':
+        return char_set("\n");
+      case 'r':
+        return char_set("\r");
+      case 'v':
+        return char_set("\v");
+      case 'f':
+        return char_set("\f");
+      case '0':
+        if (is_digit(peek()))
+          throw unsupported_pattern{};
+        return byte_set{}.set(0);
+      case 'b':
+        // Word boundaries are not supported, but a backspace in classes is.
+        if (!in_class)
+          throw unsupported_pattern{};
+        return byte_set{}.set('\b');
+      case 'x':
+      {
+        auto hex_digit = [&]() {
+          auto digit = to_lower(next());
+          if (is_digit(digit))
+            return digit - '0';
+          else if (digit >= 'a' && digit <= 'f')
+            return digit - 'a' + 10;
+          throw unsupported_pattern{};
+        };
+        auto high = hex_digit();
+        return fold_case(byte_set{}.set(high * 16 + hex_digit()));
+      }
+      default:
+        // Back references, \B, \c, \u and other letters are not supported.
+        if (is_digit(c) || is_lower(c) || is_upper(c))
+          throw unsupported_pattern{};
+        return byte_set{}.set(static_cast<std::size_t>(c));
+      }
+    }
+
+    /// Parses a character class after the opening bracket.
+    byte_set parse_class()
+    {
+      bool negate = consume('^');
+      // An empty class has a different meaning in std::regex than in
+      // ECMAScript.
+      if (peek() == ']')
+        throw unsupported_pattern{};
+
+      byte_set result;
+      while (!consume(']'))
+      {
+        // Returns a single character or -1 for escaped sets like \d.
+        auto parse_class_atom = [&](byte_set& set) {
+          auto c = next();
+          if (c != '\\')
+          {
+            set.set(static_cast<std::size_t>(c));
+            return c;
+          }
+          set = parse_escape(true);
+          return set.count() == 1 ? first_character(set) : -1;
+        };
+
+        byte_set first_set;
+        auto first = parse_class_atom(first_set);
+        if (peek() == '-' && peek(1) != ']' && peek(1) != -1)
+        {
+          ++_position;
+          byte_set last_set;
+          auto last = parse_class_atom(last_set);
+          if (first < 0 || last < 0 || last < first)
+            throw unsupported_pattern{};
+          result |= range_set(first, last);
+        }
+        else
+          result |= first_set;
+      }
+      result = fold_case(result);
+      return negate ? ~result : result;
+    }
+
+    std::string_view _source;
+    std::size_t _position = 0;
+    int _capture_count = 0;
+  };
+
+  /// Returns the lower case character matched by set, if it matches a single
+  /// character regardless of case, or -1 otherwise.
+  int single_character(const byte_set& set)
+  {
+    auto count = set.count();
+    auto first = first_character(set);
+    if (count == 1)
+      return first;
+    if (count == 2 && is_upper(first) && set.test(to_lower(first)))
+      return to_lower(first);
+    return -1;
+  }
+
+  /// Collects runs of literal characters which are part of every match.
+  void collect_literals(const node& n, std::vector<std::string>& runs)
+  {
+    switch (n.type)
+    {
+    case node::kind::concat:
+      for (const auto& child : n.children)
+        collect_literals(child, runs);
+      return;
+
+    case node::kind::group:
+      collect_literals(n.children.front(), runs);
+      return;
+
+    case node::kind::set:
+      if (auto c = single_character(n.set); c >= 0)
+      {
+        runs.back().push_back(static_cast<char>(c));
+        return;
+      }
+      break;
+
+    default:
+      break;
+    }
+    // Anything else interrupts the current run of literals.
+    if (!runs.back().empty())
+      runs.emplace_back();
+  }
+}
+
+enum class opcode : std::uint8_t
+{
+  /// Consumes a character of set x.
+  set,
+  /// Continues at x, or with lower priority at y.
+  split,
+  /// Continues at x.
+  jump,
+  /// Stores the current position in capture slot x.
+  save,
+  /// Asserts to be at the start of the text.
+  begin,
+  /// Asserts to be at the end of the text.
+  end,
+  match
+};
+
+struct instruction
+{
+  opcode op;
+  std::uint32_t x = 0;
+  std::uint32_t y = 0;
+};
+
+struct rule_pattern::program
+{
+  enum state_flag : std::uint8_t
+  {
+    /// The pattern matches when reaching this state.
+    accepting = 0b001,
+    /// The pattern matches if the text ends in this state.
+    accepting_at_end = 0b010,
+    /// No match is possible anymore.
+    dead = 0b100
+  };
+
+  std::vector<instruction> code;
+  std::vector<byte_set> sets;
+  std::uint32_t slot_count = 2;
+
+  /// Maps each byte to its equivalence class.
+  std::array<std::uint8_t, 256> byte_classes{};
+  std::uint32_t class_count = 0;
+  /// The automaton's transition table of class_count entries per state, or
+  /// empty if the pattern exceeded max_state_count.
+  std::vector<std::uint32_t> transitions;
+  std::vector<std::uint8_t> state_flags;
+};
+
+namespace
+{
+  using program = rule_pattern::program;
+
+  void emit(program& p, const node& n)
+  {
+    if (p.code.size() > max_program_size)
+      throw unsupported_pattern{};
+
+    auto here = [&]() { return static_cast<std::uint32_t>(p.code.size()); };
+    switch (n.type)
+    {
+    case node::kind::set:
+      p.code.push_back(
+        {opcode::set, static_cast<std::uint32_t>(p.sets.size()), 0});
+      p.sets.push_back(n.set);
+      break;
+
+    case node::kind::concat:
+      for (const auto& child : n.children)
+        emit(p, child);
+      break;
+
+    case node::kind::alternate:
+    {
+      std::vector<std::uint32_t> jumps;
+      for (std::size_t i = 0; i < n.children.size(); ++i)
+      {
+        if (i + 1 < n.children.size())
+        {
+          auto split = here();
+          p.code.push_back({opcode::split, split + 1, 0});
+          emit(p, n.children[i]);
+          jumps.push_back(here());
+          p.code.push_back({opcode::jump, 0, 0});
+          p.code[split].y = here();
+        }
+        else
+          emit(p, n.children[i]);
+      }
+      for (auto jump : jumps)
+        p.code[jump].x = here();
+      break;
+    }
+
+    case node::kind::group:
+      if (n.capture >= 0)
+      {
+        p.code.push_back(
+          {opcode::save, static_cast<std::uint32_t>(n.capture * 2), 0});
+      }
+      emit(p, n.children.front());
+      if (n.capture >= 0)
+      {
+        p.code.push_back(
+          {opcode::save, static_cast<std::uint32_t>(n.capture * 2 + 1), 0});
+      }
+      break;
+
+    case node::kind::repeat:
+    {
+      const auto& child = n.children.front();
+      for (int i = 0; i < n.min; ++i)
+        emit(p, child);
+
+      // Greedy repetitions prefer another iteration over leaving the loop.
+      auto add_split = [&](std::uint32_t body, std::uint32_t exit) {
+        if (n.greedy)
+          p.code.push_back({opcode::split, body, exit});
+        else
+          p.code.push_back({opcode::split, exit, body});
+      };
+      if (n.max < 0)
+      {
+        auto loop = here();
+        add_split(loop + 1, 0);
+        emit(p, child);
+        p.code.push_back({opcode::jump, loop, 0});
+        (n.greedy ? p.code[loop].y : p.code[loop].x) = here();
+      }
+      else
+      {
+        std::vector<std::uint32_t> splits;
+        for (int i = n.min; i < n.max; ++i)
+        {
+          splits.push_back(here());
+          add_split(here() + 1, 0);
+          emit(p, child);
+        }
+        for (auto split : splits)
+          (n.greedy ? p.code[split].y : p.code[split].x) = here();
+      }
+      break;
+    }
+
+    case node::kind::begin:
+      p.code.push_back({opcode::begin, 0, 0});
+      break;
+
+    case node::kind::end:
+      p.code.push_back({opcode::end, 0, 0});
+      break;
+    }
+  }
+
+  /// Adds all instructions reachable from pc without consuming a character to
+  /// states. Assertions for the end of the text are added as well, because
+  /// their outcome is only known later.
+  void closure(const program& p, std::uint32_t pc, bool at_begin,
+               std::vector<std::uint32_t>& states, std::vector<bool>& visited)
+  {
+    if (visited[pc])
+      return;
+    visited[pc] = true;
+    const auto& ins = p.code[pc];
+    switch (ins.op)
+    {
+    case opcode::jump:
+      closure(p, ins.x, at_begin, states, visited);
+      break;
+    case opcode::split:
+      closure(p, ins.x, at_begin, states, visited);
+      closure(p, ins.y, at_begin, states, visited);
+      break;
+    case opcode::save:
+      closure(p, pc + 1, at_begin, states, visited);
+      break;
+    case opcode::begin:
+      if (at_begin)
+        closure(p, pc + 1, at_begin, states, visited);
+      break;
+    default:
+      states.push_back(pc);
+      break;
+    }
+  }
+
+  /// Returns whether a match is reached from pc at the end of the text.
+  bool matches_at_end(const program& p, std::uint32_t pc,
+                      std::vector<bool>& visited)
+  {
+    if (visited[pc])
+      return false;
+    visited[pc] = true;
+    const auto& ins = p.code[pc];
+    switch (ins.op)
+    {
+    case opcode::match:
+      return true;
+    case opcode::jump:
+      return matches_at_end(p, ins.x, visited);
+    case opcode::split:
+      return matches_at_end(p, ins.x, visited) ||
+             matches_at_end(p, ins.y, visited);
+    case opcode::save:
+    case opcode::end:
+      return matches_at_end(p, pc + 1, visited);
+    default:
+      return false;
+    }
+  }
+
+  /// Builds the automaton of a search for the pattern anywhere in a text by
+  /// subset construction, which is feasible because rule patterns are small.
+  void build_automaton(program& p)
+  {
+    // Bytes which are contained in the same sets are equivalent.
+    std::map<std::vector<bool>, std::uint8_t> classes;
+    for (std::size_t c = 0; c < 256; ++c)
+    {
+      std::vector<bool> signature(p.sets.size());
+      for (std::size_t i = 0; i < p.sets.size(); ++i)
+        signature[i] = p.sets[i].test(c);
+      auto [iter, inserted] = classes.try_emplace(
+        std::move(signature), static_cast<std::uint8_t>(classes.size()));
+      p.byte_classes[c] = iter->second;
+    }
+    p.class_count = static_cast<std::uint32_t>(classes.size());
+    std::vector<unsigned char> representatives(p.class_count);
+    for (std::size_t c = 256; c-- > 0;)
+      representatives[p.byte_classes[c]] = static_cast<unsigned char>(c);
+
+    std::vector<bool> visited(p.code.size());
+    auto make_closure = [&](const std::vector<std::uint32_t>& sources,
+                            bool at_begin) {
+      std::vector<std::uint32_t> states;
+      std::fill(visited.begin(), visited.end(), false);
+      for (auto pc : sources)
+        closure(p, pc, at_begin, states, visited);
+      std::sort(states.begin(), states.end());
+      return states;
+    };
+    // A match may start at any position, so the start instruction is added to
+    // every state.
+    const auto restart = make_closure({0}, false);
+
+    std::map<std::vector<std::uint32_t>, std::uint32_t> state_ids;
+    std::vector<std::vector<std::uint32_t>> states;
+    auto add_state = [&](std::vector<std::uint32_t> state) {
+      auto [iter, inserted] = state_ids.try_emplace(
+        state, static_cast<std::uint32_t>(states.size()));
+      if (inserted)
+      {
+        std::uint8_t flags = 0;
+        for (auto pc : state)
+        {
+          if (p.code[pc].op == opcode::match)
+            flags |= program::accepting;
+          else if (p.code[pc].op == opcode::end)
+          {
+            std::vector<bool> end_visited(p.code.size());
+            if (matches_at_end(p, pc, end_visited))
+              flags |= program::accepting_at_end;
+          }
+        }
+        if (state.empty())
+          flags |= program::dead;
+        p.state_flags.push_back(flags);
+        states.push_back(std::move(state));
+      }
+      return iter->second;
+    };
+
+    add_state(make_closure({0}, true));
+    for (std::size_t state = 0; state < states.size(); ++state)
+    {
+      if (states.size() > max_state_count)
+      {
+        p.transitions.clear();
+        p.state_flags.clear();
+        return;
+      }
+      for (std::uint32_t byte_class = 0; byte_class < p.class_count;
+           ++byte_class)
+      {
+        auto c = representatives[byte_class];
+        std::vector<std::uint32_t> targets;
+        for (auto pc : states[state])
+        {
+          const auto& ins = p.code[pc];
+          if (ins.op == opcode::set && p.sets[ins.x].test(c))
+            targets.push_back(pc + 1);
+        }
+        auto next = make_closure(targets, false);
+        std::vector<std::uint32_t> merged;
+        std::set_union(next.begin(), next.end(), restart.begin(), restart.end(),
+                       std::back_inserter(merged));
+        auto id = add_state(std::move(merged));
+        p.transitions.resize(states.size() * p.class_count);
+        p.transitions[state * p.class_count + byte_class] = id;
+      }
+    }
+  }
+
+  /// Finds the first match using a Pike VM, which runs all alternatives in
+  /// lock step while preserving their backtracking priority.
+  bool pike_search(const program& p, std::string_view text,
+                   std::vector<std::ptrdiff_t>* captures)
+  {
+    using slots = std::vector<std::ptrdiff_t>;
+    struct thread
+    {
+      std::uint32_t pc;
+      slots caps;
+    };
+
+    std::vector<std::size_t> generations(p.code.size(), 0);
+    auto add = [&](auto& self, std::vector<thread>& list, std::uint32_t pc,
+                   slots caps, std::size_t position) -> void {
+      // Threads of a single step are marked with position + 1.
+      if (generations[pc] == position + 1)
+        return;
+      generations[pc] = position + 1;
+      const auto& ins = p.code[pc];
+      switch (ins.op)
+      {
+      case opcode::jump:
+        self(self, list, ins.x, std::move(caps), position);
+        break;
+      case opcode::split:
+        self(self, list, ins.x, caps, position);
+        self(self, list, ins.y, std::move(caps), position);
+        break;
+      case opcode::save:
+        caps[ins.x] = static_cast<std::ptrdiff_t>(position);
+        self(self, list, pc + 1, std::move(caps), position);
+        break;
+      case opcode::begin:
+        if (position == 0)
+          self(self, list, pc + 1, std::move(caps), position);
+        break;
+      case opcode::end:
+        if (position == text.size())
+          self(self, list, pc + 1, std::move(caps), position);
+        break;
+      default:
+        list.push_back({pc, std::move(caps)});
+        break;
+      }
+    };
+
+    std::vector<thread> current;
+    std::vector<thread> next;
+    bool found = false;
+    for (std::size_t position = 0; position <= text.size(); ++position)
+    {
+      // Matches starting further left take precedence, so new threads have
+      // the lowest priority and are no longer started after a match.
+      if (!found)
+        add(add, current, 0, slots(p.slot_count, -1), position);
+      else if (current.empty())
+        break;
+      for (auto& t : current)
+      {
+        const auto& ins = p.code[t.pc];
+        if (ins.op == opcode::match)
+        {
+          found = true;
+          if (captures != nullptr)
+            *captures = std::move(t.caps);
+          // Drop all threads of lower priority.
+          break;
+        }
+        if (position < text.size() &&
+            p.sets[ins.x].test(static_cast<unsigned char>(text[position])))
+        {
+          add(add, next, t.pc + 1, std::move(t.caps), position + 1);
+        }
+      }
+      current.swap(next);
+      next.clear();
+    }
+    return found;
+  }
+}
+
+rule_pattern::rule_pattern(const std::string& source)
+{
+  try
+  {
+    parser pattern_parser(source);
+    auto root = pattern_parser.parse();
+
+    auto compiled = std::make_shared<program>();
+    compiled->slot_count =
+      static_cast<std::uint32_t>(pattern_parser.capture_count() + 1) * 2;
+    compiled->code.push_back({opcode::save, 0, 0});
+    emit(*compiled, root);
+    compiled->code.push_back({opcode::save, 1, 0});
+    compiled->code.push_back({opcode::match, 0, 0});
+    build_automaton(*compiled);
+    _program = std::move(compiled);
+
+    if (root.type != node::kind::alternate)
+    {
+      std::vector<std::string> runs(1);
+      collect_literals(root, runs);
+      // Prefer the last literal with at least three characters, which skips
+      // short separators like slashes.
+      for (auto run = runs.rbegin(); run != runs.rend(); ++run)
+      {
+        if (run->size() >= 3)
+        {
+          _required_literal = *run;
+          break;
+        }
+      }
+    }
+  }
+  catch (const unsupported_pattern&)
+  {
+    _program.reset();
+    _fallback = std::make_shared<std::regex>(
+      source, std::regex_constants::ECMAScript | std::regex_constants::icase);
+  }
+}
+
+rule_pattern::~rule_pattern() = default;
+
+bool rule_pattern::search(std::string_view text, pattern_match* match) const
+{
+  if (_fallback)
+  {
+    std::match_results<std::string_view::const_iterator> results;
+    if (!std::regex_search(text.begin(), text.end(), results, *_fallback))
+      return false;
+    if (match != nullptr)
+    {
+      match->resize(results.size());
+      for (std::size_t i = 0; i < results.size(); ++i)
+      {
+        (*match)[i].matched = results[i].matched;
+        (*match)[i].value = results[i].str();
+      }
+    }
+    return true;
+  }
+  if (!_program)
+    return false;
+
+  const auto& p = *_program;
+  if (match == nullptr && !p.transitions.empty() && !text.empty())
+  {
+    std::uint32_t state = 0;
+    for (auto c : text)
+    {
+      if (p.state_flags[state] & (program::accepting | program::dead))
+        break;
+      state = p.transitions[state * p.class_count +
+                            p.byte_classes[static_cast<unsigned char>(c)]];
+    }
+    return (p.state_flags[state] &
+            (program::accepting | program::accepting_at_end)) != 0;
+  }
+
+  std::vector<std::ptrdiff_t> captures;
+  if (!pike_search(p, text, match != nullptr ? &captures : nullptr))
+    return false;
+  if (match != nullptr)
+  {
+    match->resize(p.slot_count / 2);
+    for (std::size_t i = 0; i < match->size(); ++i)
+    {
+      auto begin = captures[i * 2];
+      auto end = captures[i * 2 + 1];
+      auto& submatch = (*match)[i];
+      submatch.matched = begin >= 0 && end >= begin;
+      submatch.value =
+        submatch.matched
+          ? std::string{text.substr(static_cast<std::size_t>(begin),
+                                    static_cast<std::size_t>(end - begin))}
+          : std::string{};
+    }
+  }
+  return true;
+}
+}
@@ -0,0 +1,86 @@
+#ifndef SHIFT_RC_RULE_PATTERN_HPP
+#define SHIFT_RC_RULE_PATTERN_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <regex>
+
+namespace shift::rc
+{
+/// A single capture group of a pattern match.
+struct pattern_submatch
+{
+  /// Returns the matched text.
+  const std::string& str() const
+  {
+    return value;
+  }
+
+  /// False if the group did not participate in the match.
+  bool matched = false;
+  std::string value;
+};
+
+/// The whole match followed by all capture groups, just like std::smatch.
+using pattern_match = std::vector<pattern_submatch>;
+
+/// A case insensitive regular expression as used in rule input patterns.
+/// @remarks
+///   Patterns are compiled to a deterministic finite automaton, which decides
+///   in a single pass over a path whether it matches. Capture groups are only
+///   extracted from matching paths, using a Pike VM that reproduces the
+///   leftmost, backtracking priority semantics of ECMAScript. The supported
+///   subset covers literals, escapes, character classes, groups, alternation,
+///   greedy and lazy quantifiers, and the anchors ^ and $. Any other pattern
+///   (e.g. using back references or lookaheads) falls back to std::regex.
+class rule_pattern
+{
+public:
+  /// Default constructor creating a pattern that never matches.
+  rule_pattern() = default;
+
+  /// Compiles a pattern using ECMAScript syntax.
+  /// @throws std::regex_error
+  ///   The pattern is not a valid regular expression.
+  explicit rule_pattern(const std::string& source);
+
+  rule_pattern(const rule_pattern&) = default;
+  rule_pattern(rule_pattern&&) = default;
+  ~rule_pattern();
+  rule_pattern& operator=(const rule_pattern&) = default;
+  rule_pattern& operator=(rule_pattern&&) = default;
+
+  /// Searches text for the first match of the pattern.
+  /// @param match
+  ///   If not null and the pattern matches, receives the whole match and all
+  ///   capture groups.
+  bool search(std::string_view text, pattern_match* match = nullptr) const;
+
+  /// Returns a lower case string which is contained in all texts matching the
+  /// pattern, or an empty string if there is none.
+  /// @remarks
+  ///   Of all mandatory literals the last one is used, which usually is the
+  ///   most selective part of file patterns (e.g. the file extension).
+  const std::string& required_literal() const
+  {
+    return _required_literal;
+  }
+
+  /// Returns true if the pattern is matched by std::regex.
+  bool uses_fallback() const
+  {
+    return _fallback != nullptr;
+  }
+
+  struct program;
+
+private:
+  std::shared_ptr<const program> _program;
+  std::shared_ptr<const std::regex> _fallback;
+  std::string _required_literal;
+};
+}
+
+#endif
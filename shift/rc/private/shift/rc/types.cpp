@@ -165,9 +165,11 @@ void job_description::mark_as_used()
 
 action_base::action_base(const std::string& action_name,
                          const action_version& action_version,
-                         const bool action_support_multithreading)
+                         const bool action_support_multithreading,
+                         const bool action_depends_on_previous_passes)
 : _description({action_name, action_version, this}),
-  _support_multithreading(action_support_multithreading)
+  _support_multithreading(action_support_multithreading),
+  _depends_on_previous_passes(action_depends_on_previous_passes)
 {
 }
 
@@ -183,6 +185,11 @@ bool action_base::support_multithreading() const
   return _support_multithreading;
 }
 
+bool action_base::depends_on_previous_passes() const
+{
+  return _depends_on_previous_passes;
+}
+
 std::string merge_slashes(const std::string& input)
 {
   static const std::regex successive_slashes("//+", std::regex::ECMAScript);
@@ -15,6 +15,7 @@
 #include <shift/core/bit_field.hpp>
 #include <shift/parser/json/json.hpp>
 #include <shift/parser/json/hash.hpp>
+#include "shift/rc/rule_pattern.hpp"
 
 namespace shift::rc
 {
@@ -66,12 +67,12 @@ struct action_description
   entity_flags flags;
 };
 
-/// Stores a filename regex and a copy of the pattern string from which the
-/// regex was constructed from.
+/// Stores a compiled filename pattern and a copy of the pattern string from
+/// which it was constructed from.
 struct rule_input
 {
   std::string source;
-  std::regex pattern;
+  rule_pattern pattern;
 };
 
 struct rule_create_info
@@ -108,12 +109,8 @@ bool operator==(const rule_description& lhs, const rule_description& rhs);
 /// Input matches are generated from the list of source files against all
 /// defined rules.
 /// @remarks
-///   std::smatch stores iterators into the string that matched the regex. We
-///   can neither move nor swap the string to a different place without
-///   invalidating those iterators (and thus the smatch object) and need to
-///   dynamically allocate instances of input_match to work around this
-///   limitation. To prevent any errors this type is non-copyable and
-///   non-movable.
+///   Instances are referenced by jobs and their cache entries, so this type is
+///   non-copyable and non-movable and gets allocated dynamically.
 struct input_match
 {
   input_match() = default;
@@ -129,8 +126,8 @@ struct input_match
 
   file_description* file = nullptr;
 
-  /// The regex search match pointing into generic_string.
-  std::smatch match_results;
+  /// The whole match and capture groups found in the file's generic_string.
+  pattern_match match_results;
 };
 
 /// A job description contains all information needed to feed any action.
@@ -170,9 +167,15 @@ public:
   ///   Set this parameter to false to enforce all instances of this action to
   ///   be processed in a serial fashion. This is required e.g. when using
   ///   external libs that make use of global/static variables to store state.
+  /// @param action_depends_on_previous_passes
+  ///   Set this parameter to true if the action reads files other than its
+  ///   job's inputs, e.g. through resource_compiler_impl::alias. Jobs of such
+  ///   actions only start once all jobs of previous passes completed, and
+  ///   are never restored from or stored to the artifact store.
   action_base(const std::string& action_name,
               const action_version& action_version,
-              bool action_support_multithreading = true);
+              bool action_support_multithreading = true,
+              bool action_depends_on_previous_passes = false);
 
   action_base(const action_base&) = delete;
   action_base(action_base&&) = delete;
@@ -189,6 +192,10 @@ public:
   /// Returns whether the action can be used from multiple threads.
   bool support_multithreading() const;
 
+  /// Returns whether jobs of this action need to wait for all jobs of
+  /// previous passes, instead of only for the jobs producing their inputs.
+  bool depends_on_previous_passes() const;
+
   /// Process a single job.
   /// @remarks
   ///   This method may be called from multiple threads in parallel. You are
@@ -200,6 +207,7 @@ public:
 private:
   action_description _description;
   bool _support_multithreading = true;
+  bool _depends_on_previous_passes = false;
 };
 
 using file_time_t = decltype(std::filesystem::last_write_time({}));
@@ -228,6 +236,14 @@ struct file_description
   std::string generic_string;
   std::size_t hash;
   file_time_t last_write_time;
+  /// The file size in bytes.
+  std::uint64_t size = 0;
+  /// An XXH64 hash of the file contents, or zero if not computed yet.
+  /// @remarks
+  ///   Content hashes allow detecting files with a new timestamp but unchanged
+  ///   contents, e.g. after a fresh checkout or when a job reproduced an
+  ///   identical output file.
+  std::uint64_t content_hash = 0;
   std::uint32_t pass = 0;
   entity_flags flags = entity_flags{0};
   file_description* alias = nullptr;
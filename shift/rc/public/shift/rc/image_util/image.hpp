@@ -2,6 +2,7 @@
 #define SHIFT_RC_IMAGE_UTIL_IMAGE_H
 
 #include <system_error>
+#include <memory>
 #include <shift/resource_db/image.hpp>
 #include "shift/rc/error_code.hpp"
 
@@ -43,6 +44,10 @@ struct destination_image_descriptor : image_descriptor
 /// bytes that an image of given dimensions and format.
 std::size_t required_image_buffer_size(const image_descriptor& image);
 
+/// Returns the number of channels of an uncompressed image format, or zero for
+/// block compressed formats.
+std::uint32_t image_channel_count(resource_db::image_format format);
+
 struct convert_region
 {
   std::uint32_t destination_x;
@@ -55,16 +60,34 @@ struct convert_region
 
 enum class convert_flag
 {
+  /// Use a fast but low quality compressor for block compressed destination
+  /// formats.
+  fast_block_compression = 0b01,
+  /// Use a very slow but high quality compressor for block compressed
+  /// destination formats. If neither this flag nor fast_block_compression is
+  /// set, a compressor balancing quality and speed is used.
+  best_block_compression = 0b10
 };
 
 using convert_flags = core::bit_field<convert_flag>;
 
 /// Converts the content of an image to a different format. This includes block
 /// compressed formats to pack/unpack images.
+/// @remarks
+///   When called from within a task, the rows of the region are split across
+///   multiple tasks.
 /// @param destination_image
 ///   The descriptor of the image to write to. The destination buffer has to be
 ///   already allocated. Use required_image_buffer_size to create a buffer of
 ///   appropriate size.
+/// @param source_image
+///   The descriptor of the image to read from. Source and destination images
+///   may differ in size, which allows converting an image piece by piece,
+///   e.g. from bands of rows decoded by tiff_io::load_regions.
+/// @param region
+///   The region to convert, which must lie within both images.
+/// @param flags
+///   A set of options that influence the conversion.
 std::error_code convert_image(
   const destination_image_descriptor& destination_image,
   const source_image_descriptor& source_image, const convert_region& region,
@@ -84,29 +107,91 @@ struct resize_region
 
 enum class resize_flag
 {
+  /// Averages all source pixels covered by a destination pixel. This is the
+  /// fastest filter, but it blurs when upsampling.
+  box_filter = 0b0001,
+  /// A tent filter, which interpolates linearly when upsampling.
+  triangle_filter = 0b0010,
+  /// A Kaiser windowed sinc filter, which keeps images sharp with little
+  /// ringing. This filter is used if no filter flag is set.
+  kaiser_filter = 0b0100,
+  /// A three lobed Lanczos filter, which is slightly sharper than the Kaiser
+  /// filter but rings more at hard edges.
+  lanczos_filter = 0b1000
 };
 
 using resize_flags = core::bit_field<resize_flag>;
 
 /// Resize a region of an image and store it in a region of another image.
 /// @param destination_image
-///   Descriptor of the destination to write the resized image to. The format of
-///   destination_image must be in linear color space and must not be a block
-///   compressed format.
+///   Descriptor of the destination to write the resized image to. The format
+///   of destination_image must not be a block compressed format.
 /// @param source_image
 ///   Descriptor of the source image to resize. The format of source_image must
 ///   match the format of destination_image.
 /// @param region
 ///   Source and destination rectangular regions.
 /// @param flags
-///   A set of options that influence the resize algorithm.
+///   A set of options that influence the resize algorithm. If multiple filter
+///   flags are set, the first one in the order of resize_flag is used.
 /// @remarks
-///   It is highly recommended to use a high precision format to avoid data
-///   loss.
+///   Pixels are filtered as 32 bit floating point values in linear color
+///   space, i.e. sRGB formats are linearized before and encoded again after
+///   resampling. When called from within a task, rows are filtered in
+///   parallel.
 std::error_code resize_image(
   const destination_image_descriptor& destination_image,
   const source_image_descriptor& source_image, const resize_region& region,
   resize_flags flags);
+
+/// Returns the number of levels of a full mip chain of an image of the given
+/// size, including the base level and going down to a single pixel.
+std::uint32_t mip_level_count(std::uint32_t width, std::uint32_t height);
+
+/// Generates a full mip chain in a single pass over the rows of a base image.
+/// @remarks
+///   Each level is resampled from the previous one with half its size,
+///   rounded down, while the rows of the base image are added band by band.
+///   Rows are passed down the chain as soon as they are complete, so the base
+///   image never has to be held in memory as a whole and every level is only
+///   decoded once. All levels below the base level are stored in the format
+///   of the base image.
+class mip_chain
+{
+public:
+  /// Constructor.
+  /// @param base_image
+  ///   The size and format of the base image, which must not be a block
+  ///   compressed format.
+  /// @param flags
+  ///   Selects the filter used to reduce each level.
+  mip_chain(const image_descriptor& base_image, resize_flags flags);
+
+  /// Destructor.
+  ~mip_chain();
+
+  mip_chain(const mip_chain&) = delete;
+  mip_chain& operator=(const mip_chain&) = delete;
+
+  /// Adds the next band of full rows of the base image.
+  /// @param rows
+  ///   A band of rows of the same width and format as the base image. Bands
+  ///   have to be added in top to bottom order.
+  std::error_code add_rows(const source_image_descriptor& rows);
+
+  /// Returns the number of levels, including the base level.
+  std::uint32_t level_count() const;
+
+  /// Returns a generated mip level.
+  /// @param level
+  ///   The index of the level in [1, level_count()). The level is only
+  ///   complete after all rows of the base image have been added.
+  source_image_descriptor level(std::uint32_t level) const;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> _impl;
+};
 }
 
 #endif
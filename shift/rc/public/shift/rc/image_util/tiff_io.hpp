@@ -4,6 +4,8 @@
 #include <tiff.h>
 #include <cstdint>
 #include <vector>
+#include <memory>
+#include <functional>
 #include <filesystem>
 #include <shift/core/singleton.hpp>
 
@@ -126,6 +128,9 @@ struct tiff_image
   std::uint32_t width = 0;
   std::uint32_t height = 0;
   std::uint32_t rows_per_strip = 0;
+  /// The size of each tile, or zero if the image is stored in strips.
+  std::uint32_t tile_width = 0;
+  std::uint32_t tile_height = 0;
 
   tiff_photometric photometric = tiff_photometric::rgb;
   tiff_planar_config planar_config = tiff_planar_config::contiguous;
@@ -136,6 +141,37 @@ struct tiff_image
   std::unique_ptr<cms_profile, cms_profile_deleter> icc_profile;
 };
 
+/// A band of full rows of pixels, decoded by tiff_io::load_regions.
+struct tiff_region
+{
+  /// The index of the first row within the image.
+  std::uint32_t y = 0;
+  /// The number of rows.
+  std::uint32_t height = 0;
+  /// The pixels of all rows, packed in the same contiguous layout as
+  /// tiff_image::pixel_data.
+  const std::byte* pixel_data = nullptr;
+  /// The number of bytes in pixel_data.
+  std::size_t size = 0;
+};
+
+/// Called by tiff_io::load_regions for each decoded region. Returning false
+/// aborts loading.
+using tiff_region_handler = std::function<bool(const tiff_region& region)>;
+
+/// Options of tiff_io::load_regions.
+struct tiff_stream_options
+{
+  /// The maximum number of bytes of decoded pixels held in memory at once.
+  /// The window always covers at least one row of strips or tiles.
+  std::size_t window_size = 64 << 20;
+
+  /// The height of all regions except the last one is a multiple of this
+  /// value. Use the block height when converting regions to a block
+  /// compressed format.
+  std::uint32_t row_alignment = 4;
+};
+
 /// A TIFF file reader and writer.
 class tiff_io : public core::singleton<tiff_io, core::create::on_stack>
 {
@@ -147,6 +183,28 @@ public:
   bool load(const std::filesystem::path& filename,
             std::vector<tiff_image>& images, bool ignore_icc_profile);
 
+  /// Loads the properties of all images contained in a TIFF file, without
+  /// decoding any pixels.
+  bool load_info(const std::filesystem::path& filename,
+                 std::vector<tiff_image>& images, bool ignore_icc_profile);
+
+  /// Decodes the pixels of a single image in regions of full rows, such that
+  /// the whole image never needs to be held in memory.
+  /// @param image
+  ///   The properties of the image, as returned by load_info.
+  /// @param handler
+  ///   Called with each region in top to bottom order. The region's data is
+  ///   only valid during the call.
+  /// @remarks
+  ///   When called from within a task the strips or tiles of each region are
+  ///   decoded in parallel, each worker using its own TIFF handle. Separately
+  ///   stored sample planes are interleaved, so regions always use a
+  ///   contiguous planar configuration.
+  bool load_regions(const std::filesystem::path& filename,
+                    std::size_t image_index, const tiff_image& image,
+                    const tiff_stream_options& options,
+                    const tiff_region_handler& handler);
+
   /// Saves a list of images to a TIFF file.
   bool save(const std::filesystem::path& filename,
             const std::vector<tiff_image>& images, bool ignore_icc_profile);
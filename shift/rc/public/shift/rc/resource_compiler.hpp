@@ -2,6 +2,7 @@
 #define SHIFT_RC_RESOURCECOMPILER_HPP
 
 #include <memory>
+#include <chrono>
 #include <string_view>
 #include <filesystem>
 #include <shift/core/singleton.hpp>
@@ -52,6 +53,19 @@ public:
   ///
   void verbose(std::uint32_t level);
 
+  /// Returns the path of the artifact store, or an empty path if it is
+  /// disabled.
+  const fs::path& artifact_path() const;
+
+  /// Enables a content addressed store of job outputs in the passed folder.
+  /// @remarks
+  ///   Jobs whose action, rule and input contents match an artifact in the
+  ///   store get their outputs copied from there instead of being processed.
+  ///   The folder may be shared between multiple machines. Pass an empty path
+  ///   to disable the store. Actions which read files other than their inputs
+  ///   are always processed.
+  void artifact_path(const fs::path& path);
+
   ///
   const fs::path& image_magick() const;
 
@@ -67,18 +81,39 @@ public:
   ///
   void save_cache(const fs::path& cache_filename);
 
+  /// Writes the cache in a human readable JSON format, which may also be
+  /// passed to load_cache.
+  void export_cache(const fs::path& json_filename);
+
   ///
   void save_cache_graph(const fs::path& cache_graph_filename);
 
-  ///
+  /// Processes all jobs whose inputs changed since the last run.
+  /// @remarks
+  ///   Each job starts as soon as the jobs producing its input files
+  ///   completed, instead of waiting for whole passes. The critical path of
+  ///   the update gets logged afterwards.
   std::tuple<std::size_t /*succeeded_job_count*/,
              std::size_t /*failed_job_count*/>
   update();
 
+  /// Writes the timing of all jobs processed during the last update in the
+  /// Chrome trace event format, which can be viewed using chrome://tracing
+  /// or Perfetto.
+  void save_trace(const fs::path& trace_filename);
+
   /// Drop all resources that are neither references by any other resource nor
   /// marked as named resources.
   void collect_garbage();
 
+  /// Removes artifacts that were not used within max_age, and afterwards the
+  /// least recently used ones until the artifact store's size drops to
+  /// max_size bytes.
+  /// @return
+  ///   The number of removed artifacts.
+  std::size_t collect_artifacts(std::uint64_t max_size,
+                                std::chrono::seconds max_age);
+
 private:
   std::unique_ptr<resource_compiler_impl> _impl;
 };
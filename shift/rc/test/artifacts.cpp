@@ -0,0 +1,244 @@
+#include <shift/rc/directory_artifact_store.hpp>
+#include <shift/rc/content_hash.hpp>
+#include <shift/rc/resource_compiler.hpp>
+#include <shift/rc/resource_compiler_impl.hpp>
+#include <shift/task/task_system.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include "utility.hpp"
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <shared_mutex>
+
+using namespace shift;
+using namespace shift::rc;
+
+namespace
+{
+std::string read_text_file(const fs::path& filename)
+{
+  std::ifstream file(filename, std::ios_base::in | std::ios_base::binary);
+  return {std::istreambuf_iterator<char>{file},
+          std::istreambuf_iterator<char>{}};
+}
+
+artifact_output make_output(std::string path, std::string_view content)
+{
+  artifact_output result;
+  result.path = std::move(path);
+  result.size = content.size();
+  result.content_hash = hash_content(content.data(), content.size());
+  result.id = 42;
+  return result;
+}
+}
+
+BOOST_AUTO_TEST_CASE(rc_artifact_store)
+{
+  auto root_path = fs::temp_directory_path() / "rc_artifact_store";
+  fs::remove_all(root_path);
+  fs::create_directories(root_path / "source");
+  write_text_file(root_path / "source" / "a.txt", "first output");
+  write_text_file(root_path / "source" / "b.txt", "second output");
+
+  directory_artifact_store store(root_path / "artifacts");
+  std::vector<artifact_output> outputs = {
+    make_output("<build-path/>a.txt", "first output"),
+    make_output("<output-path/>b.txt", "second output")};
+  outputs[1].alias = "<input-path/>b.src";
+  const std::vector<fs::path> source_paths = {root_path / "source" / "a.txt",
+                                              root_path / "source" / "b.txt"};
+  std::vector<artifact_output> found_outputs;
+  BOOST_CHECK(!store.find(1, found_outputs));
+  BOOST_CHECK(store.store(1, outputs, source_paths));
+  BOOST_CHECK(store.store(2, {outputs[0]}, {source_paths[0]}));
+
+  BOOST_REQUIRE(store.find(1, found_outputs));
+  BOOST_REQUIRE_EQUAL(found_outputs.size(), 2u);
+  for (std::size_t i = 0; i < outputs.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(found_outputs[i].path, outputs[i].path);
+    BOOST_CHECK_EQUAL(found_outputs[i].size, outputs[i].size);
+    BOOST_CHECK_EQUAL(found_outputs[i].content_hash, outputs[i].content_hash);
+    BOOST_CHECK_EQUAL(found_outputs[i].id, outputs[i].id);
+    BOOST_CHECK_EQUAL(found_outputs[i].alias, outputs[i].alias);
+  }
+  BOOST_CHECK(store.fetch(1, 1, found_outputs[1], root_path / "b.txt"));
+  BOOST_CHECK_EQUAL(read_text_file(root_path / "b.txt"), "second output");
+
+  // Corrupt outputs must not be restored and remove the whole artifact.
+  auto corrupt_output = found_outputs[0];
+  ++corrupt_output.content_hash;
+  BOOST_CHECK(!store.fetch(1, 0, corrupt_output, root_path / "a.txt"));
+  BOOST_CHECK(!fs::exists(root_path / "a.txt"));
+  BOOST_CHECK(!store.find(1, found_outputs));
+
+  // Evict artifacts by size and by age. Artifact 1 is the least recently
+  // used one.
+  BOOST_CHECK(store.store(1, outputs, source_paths));
+  auto artifact_path = [&](artifact_key key) {
+    return root_path / "artifacts" / "00" / ("000000000000000" +
+                                             std::to_string(key));
+  };
+  fs::last_write_time(artifact_path(1) / "manifest.json",
+                      fs::file_time_type::clock::now() -
+                        std::chrono::minutes{10});
+  std::uint64_t artifact2_size = 0;
+  for (const auto& entry : fs::directory_iterator{artifact_path(2)})
+    artifact2_size += fs::file_size(entry.path());
+
+  BOOST_CHECK_EQUAL(store.evict(1024 * 1024, std::chrono::hours{1}), 0u);
+  BOOST_CHECK_EQUAL(store.evict(artifact2_size, std::chrono::hours{1}), 1u);
+  BOOST_CHECK(!store.find(1, found_outputs));
+  BOOST_CHECK(store.find(2, found_outputs));
+  BOOST_CHECK_EQUAL(store.evict(1024 * 1024, std::chrono::seconds{-1}), 1u);
+  BOOST_CHECK(!store.find(2, found_outputs));
+
+  fs::remove_all(root_path);
+}
+
+BOOST_AUTO_TEST_CASE(rc_artifact_restore)
+{
+  auto settings = create_working_folders();
+  settings.artifact_path = settings.root_path / "artifacts";
+  fs::remove_all(settings.artifact_path);
+
+  write_tiff_image(settings.input_path / "test_image1.tif", 32, 32, 0xFF0077FF);
+  write_tiff_image(settings.input_path / "test_image2.tif", 32, 32, 0xFF77FF00);
+  write_text_file(settings.input_path / ".rc-rules.json",
+                  R"({ "import": {
+    "pass": 1,
+    "action": "image-import-tiff",
+    "input": {
+      "image": "<input-path/><rule-path/>(test_image.*)\\.tif$"
+    },
+    "output": {
+      "header": "<build-path/><rule-path/><image:1>.image_header",
+      "buffer": "<output-path/><rule-path/><image:1>.lod_<lod-level>.image_buffer"
+    },
+    "options": {
+      "target-format": "rgba8_srgb",
+      "normalized": false
+    }
+  }
+}
+)");
+
+  run_rc(settings, 2, 0);
+  auto header = read_text_file(settings.build_path /
+                               "test_image1.image_header");
+  BOOST_CHECK(!header.empty());
+
+  // Simulate a fresh checkout, where neither the local cache nor any build
+  // results exist. All outputs are restored from the artifact store.
+  fs::remove_all(settings.build_path);
+  fs::remove_all(settings.output_path);
+  fs::create_directories(settings.build_path);
+  fs::create_directories(settings.output_path);
+  run_rc(settings, 2, 0);
+  BOOST_CHECK_EQUAL(
+    read_text_file(settings.build_path / "test_image1.image_header"), header);
+  BOOST_CHECK(fs::exists(settings.build_path / "test_image2.image_header"));
+  BOOST_CHECK(
+    fs::exists(settings.output_path / "test_image1.lod_0.image_buffer"));
+  BOOST_CHECK(
+    fs::exists(settings.output_path / "test_image2.lod_0.image_buffer"));
+
+  // Everything is cached locally now.
+  run_rc(settings, 0, 0);
+
+  fs::remove_all(settings.artifact_path);
+}
+
+namespace
+{
+/// An action which does nothing, optionally declaring that it reads files
+/// other than its inputs.
+class noop_action : public action_base
+{
+public:
+  noop_action(const std::string& name, bool depends_on_previous_passes)
+  : action_base(name, "1.0.0001", true, depends_on_previous_passes)
+  {
+  }
+
+  bool process(resource_compiler_impl& /*compiler*/,
+               job_description& /*job*/) const override
+  {
+    return true;
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE(rc_artifact_key_dependent_actions)
+{
+  auto settings = create_working_folders();
+  write_text_file(settings.input_path / "a.txt", "a");
+  write_text_file(settings.input_path / ".rc-rules.json",
+                  R"({ "independent": {
+    "pass": 1,
+    "action": "independent",
+    "input": {
+      "text": "<input-path/>(.*)\\.txt$"
+    },
+    "output": {
+      "text": "<build-path/><text:1>.independent.txt"
+    },
+    "options": {}
+  },
+  "dependent": {
+    "pass": 1,
+    "action": "dependent",
+    "input": {
+      "text": "<input-path/>(.*)\\.txt$"
+    },
+    "output": {
+      "text": "<build-path/><text:1>.dependent.txt"
+    },
+    "options": {}
+  }
+}
+)");
+
+  std::map<std::string, artifact_key> keys;
+  auto primary_task = [&]() -> int {
+    auto local_path = [](const fs::path& path) {
+      return fs::relative(fs::canonical(fs::absolute(path)),
+                          fs::current_path());
+    };
+
+    noop_action independent_action("independent", false);
+    noop_action dependent_action("dependent", true);
+    resource_compiler_impl compiler;
+    compiler.input_path = local_path(settings.input_path);
+    compiler.build_path = local_path(settings.build_path);
+    compiler.output_path = local_path(settings.output_path);
+    compiler.cache.register_action("independent", "1.0.0001",
+                                   independent_action);
+    compiler.cache.register_action("dependent", "1.0.0001", dependent_action);
+    compiler.read_rules(settings.input_path / ".rc-rules.json", {});
+    compiler.compile_rules();
+
+    auto* input_file = compiler.add_file(compiler.input_path / "a.txt", 0);
+    compiler.cache.update_fingerprint(*input_file);
+    compiler.match_files({input_file}, 0);
+
+    std::shared_lock read_lock(compiler.rules_mutex);
+    for (auto* rule : compiler.rules)
+    {
+      for (auto& job : compiler.query_jobs(*rule, read_lock))
+        keys[rule->action->name] = compiler.make_artifact_key(*job);
+    }
+    return 0;
+  };
+  task::task_system{}.num_workers(2).start(primary_task).join();
+
+  // Actions reading files other than their inputs must never be restored
+  // from the artifact store, because the key does not cover those files.
+  BOOST_CHECK_EQUAL(keys.size(), 2u);
+  BOOST_CHECK_NE(keys["independent"], 0u);
+  BOOST_CHECK_EQUAL(keys["dependent"], 0u);
+  remove_working_folders(settings);
+}
@@ -1,11 +1,15 @@
 #include <shift/rc/resource_compiler.hpp>
+#include <shift/parser/json/json.hpp>
+#include <shift/task/task_system.hpp>
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/test/unit_test.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
 #include "utility.hpp"
 #include <thread>
 #include <chrono>
+#include <fstream>
 
+using namespace shift;
 using namespace shift::rc;
 
 BOOST_AUTO_TEST_CASE(rc_cache)
@@ -48,8 +52,7 @@ BOOST_AUTO_TEST_CASE(rc_cache)
 )");
 
   auto check_files = [&]() {
-    BOOST_CHECK(
-      fs::file_size(settings.build_path / ".index.json", error_code) == 221);
+    BOOST_CHECK(fs::exists(settings.build_path / ".index"));
     BOOST_CHECK(!fs::exists(settings.input_path / "test_image1.tif") ^
                 fs::exists(settings.build_path / "test_image1.image_header"));
     BOOST_CHECK(!fs::exists(settings.input_path / "test_image2.tif") ^
@@ -57,8 +60,7 @@ BOOST_AUTO_TEST_CASE(rc_cache)
     BOOST_CHECK(!fs::exists(settings.input_path / "test_image3.tif") ^
                 fs::exists(settings.build_path / "test_image3.image_header"));
 
-    BOOST_CHECK(
-      fs::file_size(settings.output_path / ".index.json", error_code) == 294);
+    BOOST_CHECK(fs::exists(settings.output_path / ".index"));
     BOOST_CHECK(
       fs::file_size(settings.output_path / "global.cache", error_code) == 134);
     BOOST_CHECK(
@@ -81,6 +83,46 @@ BOOST_AUTO_TEST_CASE(rc_cache)
     run_rc(settings, 0, 0);
   }
 
+  {
+    // Write times must survive a round trip through the binary cache
+    // unchanged. Load it and check the write time in its json export.
+    auto json_filepath = settings.build_path / "round-trip.json";
+    auto primary_task = [&]() -> int {
+      rc::resource_compiler compiler;
+      compiler.input_path(settings.input_path);
+      compiler.build_path(settings.build_path);
+      compiler.output_path(settings.output_path);
+      BOOST_CHECK(
+        compiler.load_cache(settings.build_path / settings.cache_filename));
+      compiler.export_cache(json_filepath);
+      return 0;
+    };
+    task::task_system{}.num_workers(1).start(primary_task).join();
+
+    std::ifstream file{json_filepath.generic_string(),
+                       std::ios_base::in | std::ios_base::binary};
+    BOOST_REQUIRE(file.is_open());
+    parser::json::value root;
+    file >> root;
+    std::size_t checked_count = 0;
+    for (const auto& [path, cached_file] : parser::json::get<
+           parser::json::object>(parser::json::get<parser::json::object>(root),
+                                 "files"))
+    {
+      if (fs::path{path}.filename() != "test_image1.tif")
+        continue;
+      BOOST_CHECK_EQUAL(
+        parser::json::get<std::int64_t>(
+          parser::json::get<parser::json::object>(cached_file), "write-time"),
+        fs::last_write_time(settings.input_path / "test_image1.tif")
+          .time_since_epoch()
+          .count());
+      ++checked_count;
+    }
+    BOOST_CHECK_EQUAL(checked_count, 1u);
+    fs::remove(json_filepath, error_code);
+  }
+
   {
     // Remove an output file and check if it will be rebuilt on next rc
     // invocation.
@@ -120,17 +162,42 @@ BOOST_AUTO_TEST_CASE(rc_cache)
   }
 
   {
-    // Try to remove .index.json from output folder and check if it will be
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    // Rewrite an image file with identical contents. Its new timestamp alone
+    // must not trigger any jobs, because the content hash is unchanged.
+    write_tiff_image(settings.input_path / "test_image2.tif", 32, 32,
+                     0xFF123456);
+    run_rc(settings, 0, 0);
+    check_files();
+  }
+
+  {
+    // Replace the binary cache by its json export, which must be accepted as
+    // well.
+    auto cache_filepath = settings.build_path / settings.cache_filename;
+    fs::copy_file(fs::path{cache_filepath}.replace_extension(".json"),
+                  cache_filepath, fs::copy_options::overwrite_existing,
+                  error_code);
+    BOOST_CHECK(!error_code);
+    run_rc(settings, 0, 0);
+    check_files();
+  }
+
+  {
+    // Try to remove the index from output folder and check if it will be
     // regenerated.
-    fs::remove(settings.output_path / ".index.json", error_code);
+    fs::remove(settings.output_path / ".index", error_code);
+    fs::remove(settings.output_path / ".index.journal", error_code);
     run_rc(settings, 0, 0);
     check_files();
   }
 
   {
-    // Try to remove .index.json from build folder and check if it will be
+    // Try to remove the index from build folder and check if it will be
     // regenerated.
-    fs::remove(settings.build_path / ".index.json", error_code);
+    fs::remove(settings.build_path / ".index", error_code);
+    fs::remove(settings.build_path / ".index.journal", error_code);
     run_rc(settings, 0, 0);
     check_files();
   }
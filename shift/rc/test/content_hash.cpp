@@ -0,0 +1,86 @@
+#include <shift/rc/content_hash.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace shift::rc;
+
+namespace
+{
+std::uint64_t hash_string(const std::string& text, std::uint64_t seed = 0)
+{
+  return hash_content(text.data(), text.size(), seed);
+}
+
+std::vector<std::uint8_t> byte_sequence(std::size_t size)
+{
+  std::vector<std::uint8_t> result(size);
+  for (std::size_t i = 0; i < size; ++i)
+    result[i] = static_cast<std::uint8_t>(i);
+  return result;
+}
+}
+
+BOOST_AUTO_TEST_CASE(rc_content_hash)
+{
+  // Reference values computed using the xxHash reference implementation.
+  BOOST_CHECK_EQUAL(hash_string(""), 0xef46db3751d8e999ull);
+  BOOST_CHECK_EQUAL(hash_string("a"), 0xd24ec4f1a98c6e5bull);
+  BOOST_CHECK_EQUAL(hash_string("abc"), 0x44bc2cf5ad770999ull);
+  BOOST_CHECK_EQUAL(
+    hash_string("The quick brown fox jumps over the lazy dog"),
+    0x0b242d361fda71bcull);
+
+  std::string digits;
+  for (int i = 0; i < 10; ++i)
+    digits += "0123456789";
+  BOOST_CHECK_EQUAL(hash_string(digits), 0xf80e7b96315afffaull);
+
+  auto bytes = byte_sequence(45);
+  BOOST_CHECK_EQUAL(hash_content(bytes.data(), bytes.size()),
+                    0x10fdd84d6409abdfull);
+
+  bytes = byte_sequence(256 * 5);
+  BOOST_CHECK_EQUAL(hash_content(bytes.data(), bytes.size(), 7),
+                    0x133cf6ca9d1c1256ull);
+
+  // Feeding data in arbitrary chunks must yield the same hash.
+  for (std::size_t chunk_size : {1, 3, 31, 32, 33, 100})
+  {
+    content_hasher hasher(7);
+    for (std::size_t offset = 0; offset < bytes.size(); offset += chunk_size)
+    {
+      hasher.update(bytes.data() + offset,
+                    std::min(chunk_size, bytes.size() - offset));
+    }
+    BOOST_CHECK_EQUAL(hasher.finish(), 0x133cf6ca9d1c1256ull);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rc_content_hash_file)
+{
+  auto filename = std::filesystem::temp_directory_path() / "rc_content_hash";
+  {
+    std::ofstream file(filename, std::ios_base::out | std::ios_base::binary |
+                                   std::ios_base::trunc);
+    file << "The quick brown fox jumps over the lazy dog";
+  }
+  std::uint64_t hash = 0;
+  BOOST_CHECK(hash_file(filename, hash));
+  BOOST_CHECK_EQUAL(hash, 0x0b242d361fda71bcull);
+
+  {
+    std::ofstream file(filename, std::ios_base::out | std::ios_base::binary |
+                                   std::ios_base::trunc);
+  }
+  BOOST_CHECK(hash_file(filename, hash));
+  BOOST_CHECK_EQUAL(hash, 0xef46db3751d8e999ull);
+
+  std::filesystem::remove(filename);
+  BOOST_CHECK(!hash_file(filename, hash));
+}
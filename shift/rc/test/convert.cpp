@@ -4,6 +4,7 @@
 #include <boost/test/unit_test.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
 #include <array>
+#include <vector>
 
 using namespace shift;
 using namespace shift::rc::image_util;
@@ -93,6 +94,64 @@ BOOST_AUTO_TEST_CASE(rc_image_util_swizzle)
   //   image_format::b16g16r16a16_unorm);
 }
 
+BOOST_AUTO_TEST_CASE(rc_image_util_swizzle_rows)
+{
+  // Seven pixels per row cover both the vectorized and the scalar code path.
+  constexpr std::uint32_t width = 7;
+  constexpr std::uint32_t height = 8;
+  std::vector<std::byte> rgba(width * height * 4);
+  std::vector<std::byte> bgra(rgba.size());
+  for (std::size_t i = 0; i < rgba.size(); i += 4)
+  {
+    for (std::size_t c = 0; c < 4; ++c)
+      rgba[i + c] = static_cast<std::byte>(i * 3 + c * 71);
+    bgra[i + 0] = rgba[i + 2];
+    bgra[i + 1] = rgba[i + 1];
+    bgra[i + 2] = rgba[i + 0];
+    bgra[i + 3] = rgba[i + 3];
+  }
+
+  auto convert = [&](const std::vector<std::byte>& source_buffer,
+                     image_format source_format, image_format format,
+                     std::uint32_t region_width) {
+    destination_image_descriptor destination;
+    destination.width = region_width;
+    destination.height = height;
+    destination.row_stride = 0;
+    destination.format = format;
+    std::vector<std::byte> result(required_image_buffer_size(destination));
+    destination.buffer_size = result.size();
+    destination.buffer = result.data();
+
+    source_image_descriptor source;
+    source.width = width;
+    source.height = height;
+    source.row_stride = 0;
+    source.format = source_format;
+    source.buffer_size = source_buffer.size();
+    source.buffer = source_buffer.data();
+    BOOST_CHECK(!convert_image(destination, source,
+                               convert_region{0, 0, 0, 0, region_width, height},
+                               {}));
+    return result;
+  };
+
+  BOOST_CHECK(convert(rgba, image_format::r8g8b8a8_unorm,
+                      image_format::b8g8r8a8_unorm, width) == bgra);
+  BOOST_CHECK(convert(bgra, image_format::b8g8r8a8_unorm,
+                      image_format::r8g8b8a8_unorm, width) == rgba);
+
+  // Block compression gathers pixels of either channel order into the same
+  // intermediate block.
+  for (auto format : {image_format::bc1_rgba_unorm_block,
+                      image_format::bc3_unorm_block,
+                      image_format::bc7_unorm_block})
+  {
+    BOOST_CHECK(convert(rgba, image_format::r8g8b8a8_unorm, format, 4) ==
+                convert(bgra, image_format::b8g8r8a8_unorm, format, 4));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(rc_image_util_skip)
 {
   test_convert(make_byte_vector(0x11, 0x22, 0x33, 0x44),
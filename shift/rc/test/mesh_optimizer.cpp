@@ -0,0 +1,443 @@
+#include <shift/rc/optimizer_mesh/filter.hpp>
+#include <shift/resource_db/mesh.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::rc;
+
+namespace
+{
+using position = std::array<float, 3>;
+using triangle = std::array<position, 3>;
+
+/// Creates a mesh with separate position and normal streams.
+std::shared_ptr<resource_db::mesh> make_mesh(
+  const std::vector<position>& positions, const std::vector<position>& normals,
+  resource_db::vertex_index_data_type index_data_type)
+{
+  auto mesh = std::make_shared<resource_db::mesh>();
+  auto vertex_buffer = std::make_shared<resource_db::buffer>();
+  auto index_buffer = std::make_shared<resource_db::buffer>();
+
+  auto stream_size =
+    static_cast<std::uint32_t>(positions.size() * sizeof(position));
+  for (std::uint32_t i = 0; i < 2; ++i)
+  {
+    resource_db::vertex_attribute attribute;
+    attribute.vertex_buffer_view.buffer = vertex_buffer;
+    attribute.vertex_buffer_view.offset = i * stream_size;
+    attribute.vertex_buffer_view.size = stream_size;
+    attribute.offset = 0;
+    attribute.stride = sizeof(position);
+    attribute.usage = i == 0 ? resource_db::vertex_attribute_usage::position
+                             : resource_db::vertex_attribute_usage::normal;
+    attribute.component_type =
+      resource_db::vertex_attribute_component_type::float32;
+    attribute.data_type = resource_db::vertex_attribute_data_type::vec3;
+    attribute.size = sizeof(position);
+    mesh->vertex_attributes.push_back(attribute);
+  }
+  mesh->index_buffer_view.buffer = index_buffer;
+  mesh->index_data_type = index_data_type;
+
+  vertex_buffer->storage.resize(stream_size * 2);
+  std::memcpy(vertex_buffer->storage.data(), positions.data(), stream_size);
+  std::memcpy(vertex_buffer->storage.data() + stream_size, normals.data(),
+              stream_size);
+  return mesh;
+}
+
+std::size_t index_size(const resource_db::mesh& mesh)
+{
+  switch (mesh.index_data_type)
+  {
+  case resource_db::vertex_index_data_type::uint8:
+    return 1;
+  case resource_db::vertex_index_data_type::uint16:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+/// Appends a sub-mesh and its indices to the mesh's index buffer.
+void add_sub_mesh(resource_db::mesh& mesh,
+                  resource_db::primitive_topology topology,
+                  const std::vector<std::uint32_t>& indices,
+                  std::uint32_t vertex_offset = 0)
+{
+  auto& storage = mesh.index_buffer_view.buffer.get_shared()->storage;
+  auto size = index_size(mesh);
+  resource_db::sub_mesh sub_mesh;
+  sub_mesh.topology = topology;
+  sub_mesh.vertex_offset = vertex_offset;
+  sub_mesh.first_index = static_cast<std::uint32_t>(storage.size() / size);
+  sub_mesh.index_count = static_cast<std::uint32_t>(indices.size());
+  for (auto index : indices)
+  {
+    std::array<std::byte, 4> bytes;
+    if (size == 1)
+      bytes[0] = static_cast<std::byte>(index);
+    else if (size == 2)
+    {
+      auto index16 = static_cast<std::uint16_t>(index);
+      std::memcpy(bytes.data(), &index16, size);
+    }
+    else
+      std::memcpy(bytes.data(), &index, size);
+    storage.insert(storage.end(), bytes.begin(), bytes.begin() + size);
+  }
+  mesh.index_buffer_view.size = static_cast<std::uint32_t>(storage.size());
+  mesh.sub_meshes.push_back(sub_mesh);
+}
+
+/// Returns the absolute vertex indices of a sub-mesh.
+std::vector<std::uint32_t> sub_mesh_indices(resource_db::mesh& mesh,
+                                            std::size_t sub_mesh_id)
+{
+  const auto& sub_mesh = mesh.sub_meshes[sub_mesh_id];
+  const auto& storage = mesh.index_buffer_view.buffer.get_shared()->storage;
+  auto size = index_size(mesh);
+  std::vector<std::uint32_t> result;
+  for (std::size_t i = 0; i < sub_mesh.index_count; ++i)
+  {
+    std::uint32_t index = 0;
+    std::memcpy(&index,
+                storage.data() + (sub_mesh.first_index + i) * size +
+                  mesh.index_buffer_view.offset,
+                size);
+    result.push_back(index + sub_mesh.vertex_offset);
+  }
+  return result;
+}
+
+position vertex_position(resource_db::mesh& mesh, std::uint32_t index)
+{
+  auto& attribute = mesh.vertex_attributes.front();
+  auto& view = attribute.vertex_buffer_view;
+  BOOST_REQUIRE(
+    (index + 1) * static_cast<std::size_t>(attribute.stride) <= view.size);
+  position result;
+  std::memcpy(result.data(),
+              view.buffer.get_shared()->storage.data() + view.offset +
+                index * attribute.stride + attribute.offset,
+              sizeof(result));
+  return result;
+}
+
+/// Returns a sorted list of all triangles of a triangle list sub-mesh, with
+/// each triangle rotated so that the winding order is kept.
+std::vector<triangle> sub_mesh_triangles(resource_db::mesh& mesh,
+                                         std::size_t sub_mesh_id)
+{
+  BOOST_REQUIRE(mesh.sub_meshes[sub_mesh_id].topology ==
+                resource_db::primitive_topology::triangle_list);
+  auto indices = sub_mesh_indices(mesh, sub_mesh_id);
+  std::vector<triangle> result;
+  for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    triangle t = {vertex_position(mesh, indices[i]),
+                  vertex_position(mesh, indices[i + 1]),
+                  vertex_position(mesh, indices[i + 2])};
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    result.push_back(t);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/// Creates the triangles of a regular grid of size x size quads in random
+/// order.
+std::vector<std::uint32_t> grid_indices(std::uint32_t size,
+                                        std::uint32_t seed)
+{
+  std::vector<std::array<std::uint32_t, 3>> triangles;
+  for (std::uint32_t y = 0; y < size; ++y)
+  {
+    for (std::uint32_t x = 0; x < size; ++x)
+    {
+      auto v = y * (size + 1) + x;
+      triangles.push_back({v, v + 1, v + size + 1});
+      triangles.push_back({v + 1, v + size + 2, v + size + 1});
+    }
+  }
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937{seed});
+
+  std::vector<std::uint32_t> indices;
+  for (const auto& t : triangles)
+    indices.insert(indices.end(), t.begin(), t.end());
+  return indices;
+}
+
+std::vector<position> grid_positions(std::uint32_t size)
+{
+  std::vector<position> positions;
+  for (std::uint32_t y = 0; y <= size; ++y)
+  {
+    for (std::uint32_t x = 0; x <= size; ++x)
+      positions.push_back({static_cast<float>(x), static_cast<float>(y), 0});
+  }
+  return positions;
+}
+}
+
+BOOST_AUTO_TEST_CASE(rc_mesh_optimizer_weld)
+{
+  // Expand a grid into a triangle soup with three unique vertices per
+  // triangle.
+  const std::uint32_t size = 16;
+  auto grid = grid_positions(size);
+  auto grid_triangles = grid_indices(size, 1);
+  std::vector<position> positions;
+  std::vector<std::uint32_t> indices;
+  for (auto index : grid_triangles)
+  {
+    indices.push_back(static_cast<std::uint32_t>(positions.size()));
+    positions.push_back(grid[index]);
+  }
+  std::vector<position> normals(positions.size(), position{0, 0, 1});
+
+  auto mesh =
+    make_mesh(positions, normals, resource_db::vertex_index_data_type::uint32);
+  add_sub_mesh(*mesh, resource_db::primitive_topology::triangle_list,
+               indices);
+  auto triangles_before = sub_mesh_triangles(*mesh, 0);
+
+  mesh_optimization_statistics statistics;
+  BOOST_REQUIRE(optimize_mesh(*mesh, {}, &statistics));
+  BOOST_CHECK_EQUAL(statistics.vertex_count_before, positions.size());
+  BOOST_CHECK_EQUAL(statistics.vertex_count_after, grid.size());
+  BOOST_CHECK_EQUAL(statistics.triangle_count_after, 2 * size * size);
+  BOOST_CHECK_CLOSE(statistics.before.acmr, 3.0f, 0.01f);
+  BOOST_CHECK_LT(statistics.after.acmr, 1.0f);
+  BOOST_CHECK_LT(statistics.after.atvr, 2.0f);
+  BOOST_CHECK(sub_mesh_triangles(*mesh, 0) == triangles_before);
+
+  // Both streams are compacted to the welded vertex count.
+  auto& vertex_buffer =
+    *mesh->vertex_attributes.front().vertex_buffer_view.buffer;
+  BOOST_CHECK_EQUAL(vertex_buffer.storage.size(),
+                    2 * grid.size() * sizeof(position));
+  for (const auto& attribute : mesh->vertex_attributes)
+  {
+    BOOST_CHECK_EQUAL(attribute.vertex_buffer_view.size,
+                      grid.size() * sizeof(position));
+  }
+  BOOST_CHECK_EQUAL(mesh->vertex_attributes[1].vertex_buffer_view.offset,
+                    grid.size() * sizeof(position));
+}
+
+BOOST_AUTO_TEST_CASE(rc_mesh_optimizer_weld_tolerance)
+{
+  // Two triangles sharing an edge, whose shared vertices differ slightly.
+  std::vector<position> positions = {{0.0f, 0.0f, 0.0f},
+                                     {1.0f, 0.0f, 0.0f},
+                                     {0.0f, 1.0f, 0.0f},
+                                     {1.00001f, 0.0f, 0.0f},
+                                     {1.0f, 1.0f, 0.0f},
+                                     {0.0f, 1.00001f, 0.0f}};
+  std::vector<position> normals(positions.size(), position{0, 0, 1});
+  normals[5] = {0.0f, 0.00001f, 1.0f};
+
+  for (auto [position_tolerance, attribute_tolerance, expected_count] :
+       {std::make_tuple(0.0f, 0.0f, 6u), std::make_tuple(0.001f, 0.0f, 5u),
+        std::make_tuple(0.001f, 0.001f, 4u)})
+  {
+    auto mesh = make_mesh(positions, normals,
+                          resource_db::vertex_index_data_type::uint16);
+    add_sub_mesh(*mesh, resource_db::primitive_topology::triangle_list,
+                 {0, 1, 2, 3, 4, 5});
+
+    mesh_optimization_options options;
+    options.position_weld_tolerance = position_tolerance;
+    options.attribute_weld_tolerance = attribute_tolerance;
+    mesh_optimization_statistics statistics;
+    BOOST_REQUIRE(optimize_mesh(*mesh, options, &statistics));
+    BOOST_CHECK_EQUAL(statistics.vertex_count_after, expected_count);
+    BOOST_CHECK_EQUAL(statistics.triangle_count_after, 2u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rc_mesh_optimizer_vertex_cache)
+{
+  const std::uint32_t size = 64;
+  auto positions = grid_positions(size);
+  std::vector<position> normals(positions.size(), position{0, 0, 1});
+
+  for (auto algorithm :
+       {vertex_cache_algorithm::tipsify, vertex_cache_algorithm::forsyth})
+  {
+    for (auto overdraw : {false, true})
+    {
+      auto mesh = make_mesh(positions, normals,
+                            resource_db::vertex_index_data_type::uint16);
+      add_sub_mesh(*mesh, resource_db::primitive_topology::triangle_list,
+                   grid_indices(size, 2));
+      auto triangles_before = sub_mesh_triangles(*mesh, 0);
+
+      mesh_optimization_options options;
+      options.vertex_cache = algorithm;
+      options.optimize_overdraw = overdraw;
+      mesh_optimization_statistics statistics;
+      auto begin = steady_clock::now();
+      BOOST_REQUIRE(optimize_mesh(*mesh, options, &statistics));
+      auto elapsed = steady_clock::now() - begin;
+
+      BOOST_CHECK(sub_mesh_triangles(*mesh, 0) == triangles_before);
+      BOOST_CHECK_EQUAL(statistics.vertex_count_after, positions.size());
+      BOOST_CHECK_GT(statistics.before.acmr, 1.5f);
+      BOOST_CHECK_LT(statistics.after.acmr, 0.8f);
+      BOOST_CHECK_LT(statistics.after.atvr, 1.6f);
+      std::cout << (algorithm == vertex_cache_algorithm::tipsify
+                      ? "tipsify"
+                      : "forsyth")
+                << (overdraw ? " + overdraw" : "")
+                << ": ACMR " << statistics.before.acmr << " -> "
+                << statistics.after.acmr << ", ATVR "
+                << statistics.before.atvr << " -> " << statistics.after.atvr
+                << " in "
+                << duration_cast<duration<double, std::milli>>(elapsed)
+                     .count()
+                << " ms" << std::endl;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rc_mesh_optimizer_topologies)
+{
+  // A row of quads, stored behind unused vertices which are only skipped by
+  // the sub-meshes' vertex offset.
+  const std::uint32_t padding = 300;
+  std::vector<position> positions(padding, position{-1, -1, -1});
+  for (std::uint32_t x = 0; x < 4; ++x)
+  {
+    positions.push_back({static_cast<float>(x), 0, 0});
+    positions.push_back({static_cast<float>(x), 1, 0});
+  }
+  std::vector<position> normals(positions.size(), position{0, 0, 1});
+
+  auto mesh =
+    make_mesh(positions, normals, resource_db::vertex_index_data_type::uint8);
+  // A strip with a primitive restart.
+  add_sub_mesh(*mesh, resource_db::primitive_topology::triangle_strip,
+               {0, 1, 2, 3, 0xFF, 4, 5, 6, 7}, padding);
+  // A fan around the first vertex.
+  add_sub_mesh(*mesh, resource_db::primitive_topology::triangle_fan,
+               {0, 2, 3, 1}, padding);
+  add_sub_mesh(*mesh, resource_db::primitive_topology::line_list, {0, 7},
+               padding);
+
+  mesh_optimization_statistics statistics;
+  BOOST_REQUIRE(optimize_mesh(*mesh, {}, &statistics));
+  BOOST_CHECK(mesh->index_data_type ==
+              resource_db::vertex_index_data_type::uint8);
+  BOOST_CHECK_EQUAL(statistics.vertex_count_after, 8u);
+  BOOST_CHECK_EQUAL(statistics.triangle_count_after, 6u);
+
+  auto strip = sub_mesh_triangles(*mesh, 0);
+  std::vector<triangle> expected_strip;
+  for (auto t : {triangle{position{0, 0, 0}, {0, 1, 0}, {1, 0, 0}},
+                 triangle{position{0, 1, 0}, {1, 1, 0}, {1, 0, 0}},
+                 triangle{position{2, 0, 0}, {2, 1, 0}, {3, 0, 0}},
+                 triangle{position{2, 1, 0}, {3, 1, 0}, {3, 0, 0}}})
+  {
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    expected_strip.push_back(t);
+  }
+  std::sort(expected_strip.begin(), expected_strip.end());
+  BOOST_CHECK(strip == expected_strip);
+
+  auto fan = sub_mesh_triangles(*mesh, 1);
+  BOOST_CHECK_EQUAL(fan.size(), 2u);
+  for (const auto& t : fan)
+    BOOST_CHECK(t[0] == (position{0, 0, 0}));
+
+  BOOST_REQUIRE(mesh->sub_meshes[2].topology ==
+                resource_db::primitive_topology::line_list);
+  auto line = sub_mesh_indices(*mesh, 2);
+  BOOST_REQUIRE_EQUAL(line.size(), 2u);
+  BOOST_CHECK(vertex_position(*mesh, line[0]) == (position{0, 0, 0}));
+  BOOST_CHECK(vertex_position(*mesh, line[1]) == (position{3, 1, 0}));
+}
+
+BOOST_AUTO_TEST_CASE(rc_mesh_optimizer_overdraw)
+{
+  // A UV sphere, whose clusters face in all directions.
+  const std::uint32_t rings = 32;
+  const std::uint32_t segments = 64;
+  const float pi = 3.14159265f;
+  std::vector<position> positions;
+  for (std::uint32_t r = 0; r <= rings; ++r)
+  {
+    for (std::uint32_t s = 0; s <= segments; ++s)
+    {
+      // Both poles and the seam are stored as duplicate vertices.
+      if (r == 0 || r == rings)
+      {
+        positions.push_back({0.0f, 0.0f, r == 0 ? 1.0f : -1.0f});
+        continue;
+      }
+      auto theta = pi * r / rings;
+      auto phi = 2.0f * pi * (s % segments) / segments;
+      positions.push_back({std::sin(theta) * std::cos(phi),
+                           std::sin(theta) * std::sin(phi), std::cos(theta)});
+    }
+  }
+  std::vector<std::uint32_t> indices;
+  for (std::uint32_t r = 0; r < rings; ++r)
+  {
+    for (std::uint32_t s = 0; s < segments; ++s)
+    {
+      auto v = r * (segments + 1) + s;
+      indices.insert(indices.end(), {v, v + segments + 1, v + 1, v + 1,
+                                     v + segments + 1, v + segments + 2});
+    }
+  }
+  auto normals = positions;
+
+  mesh_optimization_statistics cache_only;
+  for (auto overdraw : {false, true})
+  {
+    auto mesh = make_mesh(positions, normals,
+                          resource_db::vertex_index_data_type::uint16);
+    add_sub_mesh(*mesh, resource_db::primitive_topology::triangle_list,
+                 indices);
+    // Welding the vertices at each pole removes all triangles touching it.
+    auto triangles_before = sub_mesh_triangles(*mesh, 0);
+    triangles_before.erase(
+      std::remove_if(triangles_before.begin(), triangles_before.end(),
+                     [](const triangle& t) {
+                       return t[0] == t[1] || t[1] == t[2] || t[2] == t[0];
+                     }),
+      triangles_before.end());
+
+    mesh_optimization_options options;
+    options.optimize_overdraw = overdraw;
+    mesh_optimization_statistics statistics;
+    BOOST_REQUIRE(optimize_mesh(*mesh, options, &statistics));
+    BOOST_CHECK(sub_mesh_triangles(*mesh, 0) == triangles_before);
+    if (!overdraw)
+      cache_only = statistics;
+    else
+    {
+      // Splitting clusters only costs a few additional cache misses.
+      BOOST_CHECK_LT(statistics.after.acmr, cache_only.after.acmr * 1.1f);
+    }
+    std::cout << "sphere" << (overdraw ? " + overdraw" : "") << ": ACMR "
+              << statistics.before.acmr << " -> " << statistics.after.acmr
+              << std::endl;
+  }
+}
@@ -0,0 +1,327 @@
+#include <shift/rc/mesh_util/ply_reader.hpp>
+#include <shift/platform/mapped_file.hpp>
+#include <shift/task/task_system.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/endian/conversion.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::rc::mesh_util;
+
+namespace
+{
+/// Position, normal, and texture coordinate of a single vertex.
+using ply_vertex = std::array<float, 8>;
+
+enum class ply_format
+{
+  ascii,
+  binary_little_endian,
+  binary_big_endian
+};
+
+/// Writes a PLY file with uchar face sizes and uint vertex indices.
+std::string make_ply(ply_format format, const std::vector<ply_vertex>& vertices,
+                     const std::vector<std::vector<std::uint32_t>>& faces)
+{
+  std::ostringstream result;
+  result << std::setprecision(9);
+  result << "ply\nformat "
+         << (format == ply_format::ascii
+               ? "ascii"
+               : format == ply_format::binary_little_endian
+                   ? "binary_little_endian"
+                   : "binary_big_endian")
+         << " 1.0\ncomment generated by test.shift.rc\n"
+         << "element vertex " << vertices.size() << "\n"
+         << "property float x\nproperty float y\nproperty float z\n"
+         << "property float nx\nproperty float ny\nproperty float nz\n"
+         << "property float u\nproperty float v\n"
+         << "element face " << faces.size() << "\n"
+         << "property list uchar uint vertex_indices\nend_header\n";
+
+  auto write_binary = [&](auto value) {
+    if (format == ply_format::binary_little_endian)
+      boost::endian::native_to_little_inplace(value);
+    else
+      boost::endian::native_to_big_inplace(value);
+    result.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  for (const auto& vertex : vertices)
+  {
+    for (auto value : vertex)
+    {
+      if (format == ply_format::ascii)
+        result << value << " ";
+      else
+      {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        write_binary(bits);
+      }
+    }
+    if (format == ply_format::ascii)
+      result << "\n";
+  }
+  for (const auto& face : faces)
+  {
+    if (format == ply_format::ascii)
+    {
+      result << face.size();
+      for (auto index : face)
+        result << " " << index;
+      result << "\n";
+    }
+    else
+    {
+      result.put(static_cast<char>(face.size()));
+      for (auto index : face)
+        write_binary(index);
+    }
+  }
+  return result.str();
+}
+
+/// The decoded contents of a PLY file.
+struct ply_result
+{
+  bool valid = false;
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+  std::vector<std::uint32_t> indices;
+  std::array<float, 3> min;
+  std::array<float, 3> max;
+};
+
+ply_result decode(const std::string& content,
+                  const ply_import_options& options = {})
+{
+  resource_db::mesh mesh;
+  auto vertex_buffer = std::make_shared<resource_db::buffer>();
+  auto index_buffer = std::make_shared<resource_db::buffer>();
+  ply_result result;
+  result.valid =
+    read_ply(reinterpret_cast<const std::byte*>(content.data()),
+             content.size(), options, mesh, vertex_buffer, index_buffer);
+  if (!result.valid)
+    return result;
+
+  for (const auto& attribute : mesh.vertex_attributes)
+  {
+    const auto& view = attribute.vertex_buffer_view;
+    auto& target =
+      attribute.usage == resource_db::vertex_attribute_usage::position
+        ? result.positions
+        : attribute.usage == resource_db::vertex_attribute_usage::normal
+            ? result.normals
+            : result.texcoords;
+    target.resize(view.size / sizeof(float));
+    std::memcpy(target.data(), vertex_buffer->storage.data() + view.offset,
+                view.size);
+  }
+  BOOST_CHECK(mesh.index_data_type ==
+              resource_db::vertex_index_data_type::uint32);
+  result.indices.resize(index_buffer->storage.size() / sizeof(std::uint32_t));
+  std::memcpy(result.indices.data(), index_buffer->storage.data(),
+              index_buffer->storage.size());
+  BOOST_CHECK_EQUAL(mesh.sub_meshes.size(), 1u);
+  BOOST_CHECK_EQUAL(mesh.sub_meshes.front().index_count,
+                    result.indices.size());
+  for (std::size_t axis = 0; axis < 3; ++axis)
+  {
+    result.min[axis] =
+      mesh.bounding_box.center(axis) - mesh.bounding_box.extent(axis);
+    result.max[axis] =
+      mesh.bounding_box.center(axis) + mesh.bounding_box.extent(axis);
+  }
+  return result;
+}
+
+/// Creates a grid of size * size vertices, split into triangles.
+void make_grid(std::vector<ply_vertex>& vertices,
+               std::vector<std::vector<std::uint32_t>>& faces,
+               std::uint32_t size)
+{
+  vertices.clear();
+  faces.clear();
+  for (std::uint32_t y = 0; y < size; ++y)
+  {
+    for (std::uint32_t x = 0; x < size; ++x)
+    {
+      vertices.push_back({static_cast<float>(x), static_cast<float>(y),
+                          static_cast<float>((x * 7 + y * 3) % 11) - 5.0f,
+                          0.0f, 0.0f, 1.0f, x / static_cast<float>(size),
+                          y / static_cast<float>(size)});
+    }
+  }
+  for (std::uint32_t y = 0; y + 1 < size; ++y)
+  {
+    for (std::uint32_t x = 0; x + 1 < size; ++x)
+    {
+      auto index = y * size + x;
+      faces.push_back({index, index + 1, index + size});
+      faces.push_back({index + 1, index + size + 1, index + size});
+    }
+  }
+}
+}
+
+BOOST_AUTO_TEST_CASE(rc_ply_reader)
+{
+  const std::vector<ply_vertex> vertices = {
+    {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f},
+    {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f},
+    {1.0f, 1.0f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f},
+    {2.0f, -1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.25f, 0.75f},
+    {2.0f, 1.0f, -3.0f, 0.0f, -1.0f, 0.0f, 0.5f, 0.5f}};
+  // A triangle and a quad, which is triangulated as a fan.
+  const std::vector<std::vector<std::uint32_t>> faces = {{0, 1, 2},
+                                                         {1, 3, 4, 2}};
+
+  auto little =
+    decode(make_ply(ply_format::binary_little_endian, vertices, faces));
+  BOOST_REQUIRE(little.valid);
+  BOOST_REQUIRE_EQUAL(little.positions.size(), 15u);
+  BOOST_REQUIRE_EQUAL(little.normals.size(), 15u);
+  BOOST_REQUIRE_EQUAL(little.texcoords.size(), 10u);
+  for (std::size_t i = 0; i < vertices.size(); ++i)
+  {
+    for (std::size_t c = 0; c < 3; ++c)
+    {
+      BOOST_CHECK_EQUAL(little.positions[i * 3 + c], vertices[i][c]);
+      BOOST_CHECK_EQUAL(little.normals[i * 3 + c], vertices[i][3 + c]);
+    }
+    for (std::size_t c = 0; c < 2; ++c)
+      BOOST_CHECK_EQUAL(little.texcoords[i * 2 + c], vertices[i][6 + c]);
+  }
+  BOOST_CHECK(little.indices ==
+              (std::vector<std::uint32_t>{0, 1, 2, 1, 3, 4, 1, 4, 2}));
+  BOOST_CHECK(little.min == (std::array<float, 3>{0.0f, -1.0f, -3.0f}));
+  BOOST_CHECK(little.max == (std::array<float, 3>{2.0f, 1.0f, 0.5f}));
+
+  // All formats yield identical results.
+  for (auto format : {ply_format::binary_big_endian, ply_format::ascii})
+  {
+    auto other = decode(make_ply(format, vertices, faces));
+    BOOST_REQUIRE(other.valid);
+    BOOST_CHECK(other.positions == little.positions);
+    BOOST_CHECK(other.normals == little.normals);
+    BOOST_CHECK(other.texcoords == little.texcoords);
+    BOOST_CHECK(other.indices == little.indices);
+  }
+
+  // Flipping an axis also flips the winding order.
+  ply_import_options options;
+  options.scale = 2.0f;
+  options.flip_x = true;
+  options.flip_v = true;
+  auto flipped =
+    decode(make_ply(ply_format::binary_big_endian, vertices, faces), options);
+  BOOST_REQUIRE(flipped.valid);
+  BOOST_CHECK_EQUAL(flipped.positions[3], -2.0f);
+  BOOST_CHECK_EQUAL(flipped.positions[7], 2.0f);
+  BOOST_CHECK_EQUAL(flipped.texcoords[7], 0.25f);
+  BOOST_CHECK(flipped.indices ==
+              (std::vector<std::uint32_t>{1, 0, 2, 3, 1, 4, 4, 1, 2}));
+  BOOST_CHECK(flipped.min == (std::array<float, 3>{-4.0f, -2.0f, -6.0f}));
+  BOOST_CHECK(flipped.max == (std::array<float, 3>{-0.0f, 2.0f, 1.0f}));
+
+  // Malformed files are rejected.
+  auto content = make_ply(ply_format::binary_little_endian, vertices, faces);
+  BOOST_CHECK(!decode(content.substr(0, content.size() - 1)).valid);
+  BOOST_CHECK(!decode(make_ply(ply_format::binary_little_endian, vertices,
+                               {{0, 1}, {0, 1, 2, 3}}))
+                 .valid);
+  BOOST_CHECK(!decode(make_ply(ply_format::ascii, vertices, {{0, 1}})).valid);
+  BOOST_CHECK(!decode("ply\nformat ascii 1.0\nelement vertex 1\n").valid);
+}
+
+BOOST_AUTO_TEST_CASE(rc_ply_reader_parallel)
+{
+  std::vector<ply_vertex> vertices;
+  std::vector<std::vector<std::uint32_t>> faces;
+  // Use more vertices than a single task decodes.
+  make_grid(vertices, faces, 300);
+
+  for (auto format :
+       {ply_format::binary_little_endian, ply_format::binary_big_endian})
+  {
+    auto content = make_ply(format, vertices, faces);
+    auto serial = decode(content);
+    BOOST_REQUIRE(serial.valid);
+    BOOST_CHECK_EQUAL(serial.indices.size(), faces.size() * 3);
+    BOOST_CHECK_EQUAL(serial.positions[299 * 3], 299.0f);
+    BOOST_CHECK(serial.max == (std::array<float, 3>{299.0f, 299.0f, 5.0f}));
+
+    auto primary_task = [&]() {
+      auto parallel = decode(content);
+      BOOST_REQUIRE(parallel.valid);
+      BOOST_CHECK(parallel.positions == serial.positions);
+      BOOST_CHECK(parallel.normals == serial.normals);
+      BOOST_CHECK(parallel.texcoords == serial.texcoords);
+      BOOST_CHECK(parallel.indices == serial.indices);
+      BOOST_CHECK(parallel.min == serial.min);
+      BOOST_CHECK(parallel.max == serial.max);
+      return 0;
+    };
+    task::task_system{}.num_workers(4).start(primary_task).join();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rc_ply_reader_benchmark)
+{
+  constexpr std::uint32_t size = 1024;
+  std::vector<ply_vertex> vertices;
+  std::vector<std::vector<std::uint32_t>> faces;
+  make_grid(vertices, faces, size);
+
+  std::cout << "PLY import (" << vertices.size() << " vertices, "
+            << faces.size() << " triangles):" << std::endl;
+  auto filename = std::filesystem::temp_directory_path() / "rc_ply_reader.ply";
+  for (auto [name, format] :
+       {std::make_pair("little endian:", ply_format::binary_little_endian),
+        std::make_pair("big endian:   ", ply_format::binary_big_endian),
+        std::make_pair("ascii:        ", ply_format::ascii)})
+  {
+    {
+      std::ofstream file{filename, std::ios_base::out | std::ios_base::binary |
+                                     std::ios_base::trunc};
+      file << make_ply(format, vertices, faces);
+    }
+
+    auto primary_task = [&, name = name]() {
+      auto begin = high_resolution_clock::now();
+      platform::mapped_file file;
+      BOOST_REQUIRE(file.open(filename));
+      resource_db::mesh mesh;
+      auto vertex_buffer = std::make_shared<resource_db::buffer>();
+      auto index_buffer = std::make_shared<resource_db::buffer>();
+      BOOST_CHECK(read_ply(file.data(), static_cast<std::size_t>(file.size()),
+                           {}, mesh, vertex_buffer, index_buffer));
+      auto seconds = duration_cast<duration<double>>(
+                       high_resolution_clock::now() - begin)
+                       .count();
+      std::cout << "    " << name << " " << std::fixed << std::setprecision(3)
+                << seconds << " s, " << std::setprecision(1)
+                << file.size() / seconds / 1e6 << " MB/s, "
+                << vertices.size() / seconds / 1e6 << " MVertex/s"
+                << std::endl;
+      return 0;
+    };
+    task::task_system{}.num_workers(8).start(primary_task).join();
+  }
+  std::filesystem::remove(filename);
+}
@@ -0,0 +1,218 @@
+#include <shift/rc/image_util/image.hpp>
+#include <shift/task/task_system.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <cstring>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::rc::image_util;
+using namespace shift::resource_db;
+
+namespace
+{
+/// Resizes a whole image of the given format and returns the result.
+std::vector<std::byte> resize(const std::vector<std::byte>& source_buffer,
+                              image_format format, std::uint32_t source_width,
+                              std::uint32_t source_height,
+                              std::uint32_t destination_width,
+                              std::uint32_t destination_height,
+                              resize_flags flags)
+{
+  destination_image_descriptor destination;
+  destination.width = destination_width;
+  destination.height = destination_height;
+  destination.row_stride = 0;
+  destination.format = format;
+  std::vector<std::byte> result(required_image_buffer_size(destination));
+  destination.buffer_size = result.size();
+  destination.buffer = result.data();
+
+  source_image_descriptor source;
+  source.width = source_width;
+  source.height = source_height;
+  source.row_stride = 0;
+  source.format = format;
+  source.buffer_size = source_buffer.size();
+  source.buffer = source_buffer.data();
+  BOOST_CHECK(!resize_image(
+    destination, source,
+    resize_region{0, 0, destination_width, destination_height, 0, 0,
+                  source_width, source_height},
+    flags));
+  return result;
+}
+
+template <typename T>
+std::vector<std::byte> to_bytes(const std::vector<T>& values)
+{
+  std::vector<std::byte> result(values.size() * sizeof(T));
+  std::memcpy(result.data(), values.data(), result.size());
+  return result;
+}
+
+/// Returns an image with 8 bit RGBA pixels and a pattern of noise.
+std::vector<std::byte> make_noise(std::uint32_t width, std::uint32_t height)
+{
+  std::vector<std::byte> result(static_cast<std::size_t>(width) * height * 4);
+  std::uint32_t state = 1;
+  for (auto& value : result)
+  {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<std::byte>(state >> 24);
+  }
+  return result;
+}
+
+/// Generates a mip chain, adding band_height rows at a time.
+std::vector<std::vector<std::byte>> make_mip_chain(
+  const std::vector<std::byte>& pixels, image_format format,
+  std::uint32_t width, std::uint32_t height, std::uint32_t band_height,
+  resize_flags flags)
+{
+  image_descriptor base_image;
+  base_image.width = width;
+  base_image.height = height;
+  base_image.row_stride = 0;
+  base_image.format = format;
+  mip_chain chain(base_image, flags);
+  auto row_size = pixels.size() / height;
+  for (std::uint32_t y = 0; y < height; y += band_height)
+  {
+    source_image_descriptor rows;
+    rows.width = width;
+    rows.height = std::min(band_height, height - y);
+    rows.row_stride = 0;
+    rows.format = format;
+    rows.buffer_size = rows.height * row_size;
+    rows.buffer = pixels.data() + y * row_size;
+    BOOST_CHECK(!chain.add_rows(rows));
+  }
+
+  std::vector<std::vector<std::byte>> result;
+  for (std::uint32_t level = 1; level < chain.level_count(); ++level)
+  {
+    auto level_image = chain.level(level);
+    BOOST_CHECK_EQUAL(level_image.width, std::max(width >> level, 1u));
+    BOOST_CHECK_EQUAL(level_image.height, std::max(height >> level, 1u));
+    result.emplace_back(level_image.buffer,
+                        level_image.buffer + level_image.buffer_size);
+  }
+  return result;
+}
+}
+
+BOOST_AUTO_TEST_CASE(rc_image_util_resize_constant)
+{
+  // Normalized filters must not change the color of a constant image, in any
+  // direction and for any channel layout.
+  for (auto flag : {resize_flag::box_filter, resize_flag::triangle_filter,
+                    resize_flag::kaiser_filter, resize_flag::lanczos_filter})
+  {
+    std::vector<std::byte> rgba(13 * 9 * 4);
+    for (std::size_t i = 0; i < rgba.size(); ++i)
+      rgba[i] = static_cast<std::byte>(0x30 + (i & 3) * 0x40);
+    for (auto format :
+         {image_format::r8g8b8a8_unorm, image_format::r8g8b8a8_srgb})
+    {
+      auto result = resize(rgba, format, 13, 9, 5, 4, flag);
+      for (std::size_t i = 0; i < result.size(); ++i)
+        BOOST_CHECK(result[i] == rgba[i & 3]);
+      result = resize(rgba, format, 13, 9, 29, 17, flag);
+      for (std::size_t i = 0; i < result.size(); ++i)
+        BOOST_CHECK(result[i] == rgba[i & 3]);
+    }
+
+    auto r16 = to_bytes(std::vector<std::uint16_t>(23 * 5, 0x1234));
+    BOOST_CHECK(resize(r16, image_format::r16_unorm, 23, 5, 7, 3, flag) ==
+                to_bytes(std::vector<std::uint16_t>(7 * 3, 0x1234)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rc_image_util_resize_box)
+{
+  auto r32 = to_bytes(std::vector<float>{1, 2, 3, 4,  //
+                                         5, 6, 7, 8,  //
+                                         0, 0, 4, 4,  //
+                                         0, 0, 4, 4});
+  BOOST_CHECK(resize(r32, image_format::r32_sfloat, 4, 4, 2, 2,
+                     resize_flag::box_filter) ==
+              to_bytes(std::vector<float>{3.5f, 5.5f, 0.0f, 4.0f}));
+
+  // Averaging black and white gives middle gray in linear space, which is
+  // much brighter than the average of both sRGB values.
+  auto black_and_white = to_bytes(std::vector<std::uint8_t>{0x00, 0xFF});
+  BOOST_CHECK(resize(black_and_white, image_format::r8_unorm, 2, 1, 1, 1,
+                     resize_flag::box_filter) ==
+              to_bytes(std::vector<std::uint8_t>{0x80}));
+  BOOST_CHECK(resize(black_and_white, image_format::r8_srgb, 2, 1, 1, 1,
+                     resize_flag::box_filter) ==
+              to_bytes(std::vector<std::uint8_t>{0xBC}));
+}
+
+BOOST_AUTO_TEST_CASE(rc_image_util_mip_chain)
+{
+  BOOST_CHECK_EQUAL(mip_level_count(1, 1), 1u);
+  BOOST_CHECK_EQUAL(mip_level_count(37, 20), 6u);
+  BOOST_CHECK_EQUAL(mip_level_count(1, 1024), 11u);
+
+  constexpr std::uint32_t width = 37;
+  constexpr std::uint32_t height = 20;
+  auto pixels = make_noise(width, height);
+  auto primary_task = [&]() {
+    for (auto flag : {resize_flag::box_filter, resize_flag::lanczos_filter})
+    {
+      for (auto format :
+           {image_format::r8g8b8a8_unorm, image_format::r8g8b8a8_srgb})
+      {
+        // The result must not depend on how rows are passed to the chain.
+        auto levels = make_mip_chain(pixels, format, width, height, 3, flag);
+        BOOST_CHECK(levels ==
+                    make_mip_chain(pixels, format, width, height, height, flag));
+
+        // The first level is computed directly from the base image.
+        BOOST_REQUIRE_EQUAL(levels.size(), 5u);
+        BOOST_CHECK(levels.front() == resize(pixels, format, width, height,
+                                             width / 2, height / 2, flag));
+      }
+    }
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+}
+
+BOOST_AUTO_TEST_CASE(rc_image_util_mip_chain_benchmark)
+{
+  constexpr std::uint32_t size = 4096;
+  constexpr std::uint32_t band_height = 256;
+  auto pixels = make_noise(size, size);
+
+  std::cout << "Mip chain generation (" << size << "x" << size
+            << " r8g8b8a8_srgb, " << band_height
+            << " rows per band):" << std::endl;
+  auto primary_task = [&]() {
+    for (auto [name, flag] :
+         {std::make_pair("box:     ", resize_flag::box_filter),
+          std::make_pair("triangle:", resize_flag::triangle_filter),
+          std::make_pair("kaiser:  ", resize_flag::kaiser_filter),
+          std::make_pair("lanczos: ", resize_flag::lanczos_filter)})
+    {
+      auto begin = high_resolution_clock::now();
+      auto levels = make_mip_chain(pixels, image_format::r8g8b8a8_srgb, size,
+                                   size, band_height, flag);
+      auto seconds = duration_cast<duration<double>>(
+                       high_resolution_clock::now() - begin)
+                       .count();
+      std::cout << "    " << name << " " << std::fixed << std::setprecision(2)
+                << seconds << " s, " << std::setprecision(1)
+                << size * size / seconds / 1e6 << " MPixel/s" << std::endl;
+    }
+    return 0;
+  };
+  task::task_system{}.num_workers(8).start(primary_task).join();
+}
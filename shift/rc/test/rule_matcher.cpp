@@ -0,0 +1,289 @@
+#include <shift/rc/rule_matcher.hpp>
+#include <shift/task/task_system.hpp>
+#include <shift/task/parallel.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <regex>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::rc;
+
+namespace
+{
+/// Compares the results of rule_pattern with those of std::regex.
+void check_pattern(const std::string& source, const std::string& text)
+{
+  std::regex regex(source, std::regex_constants::ECMAScript |
+                             std::regex_constants::icase);
+  std::smatch expected;
+  bool expected_result = std::regex_search(text, expected, regex);
+
+  rule_pattern pattern(source);
+  pattern_match match;
+  BOOST_CHECK_EQUAL(pattern.search(text), expected_result);
+  BOOST_CHECK_EQUAL(pattern.search(text, &match), expected_result);
+  if (!expected_result)
+    return;
+  BOOST_REQUIRE_EQUAL(match.size(), expected.size());
+  for (std::size_t i = 0; i < match.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(match[i].matched, expected[i].matched);
+    BOOST_CHECK_EQUAL(match[i].str(), expected[i].str());
+  }
+}
+
+/// Creates a rule with a single input slot for each pattern.
+std::unique_ptr<rule_description> make_rule(
+  std::string id, std::uint32_t pass, const std::vector<std::string>& patterns)
+{
+  auto rule = std::make_unique<rule_description>();
+  rule->id = std::move(id);
+  rule->pass = pass;
+  for (std::size_t i = 0; i < patterns.size(); ++i)
+  {
+    rule->inputs.insert_or_assign("slot" + std::to_string(i),
+                                  rule_input{patterns[i],
+                                             rule_pattern{patterns[i]}});
+  }
+  return rule;
+}
+
+using match_list = std::vector<std::pair<std::string, std::size_t>>;
+
+/// Returns the ids and slot indices of all rules matching path.
+/// @remarks
+///   This function is called from multiple tasks and thus must not use any
+///   Boost.Test assertions.
+match_list match(const rule_matcher& matcher, const std::string& path,
+                 std::uint32_t current_pass)
+{
+  match_list result;
+  matcher.match(path, current_pass,
+                [&](rule_description& rule, std::size_t slot_index,
+                    std::map<std::string, rule_input>::const_iterator slot,
+                    pattern_match& match_results) {
+                  // Report inconsistent slots and empty matches as an invalid
+                  // slot index.
+                  auto distance = static_cast<std::size_t>(
+                    std::distance(rule.inputs.cbegin(), slot));
+                  result.emplace_back(rule.id,
+                                      distance == slot_index &&
+                                          !match_results.empty()
+                                        ? slot_index
+                                        : ~std::size_t{0});
+                });
+  return result;
+}
+
+/// The reference implementation, which tries each regex of each rule.
+match_list match_naive(const std::vector<rule_description*>& rules,
+                       const std::vector<std::vector<std::regex>>& regexes,
+                       const std::string& path, std::uint32_t current_pass)
+{
+  match_list result;
+  for (std::size_t rule_index = 0; rule_index < rules.size(); ++rule_index)
+  {
+    if (rules[rule_index]->pass <= current_pass)
+      continue;
+    const auto& rule_regexes = regexes[rule_index];
+    for (std::size_t slot_index = 0; slot_index < rule_regexes.size();
+         ++slot_index)
+    {
+      std::smatch match_results;
+      if (std::regex_search(path, match_results, rule_regexes[slot_index]))
+      {
+        result.emplace_back(rules[rule_index]->id, slot_index);
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<std::vector<std::regex>> make_regexes(
+  const std::vector<rule_description*>& rules)
+{
+  std::vector<std::vector<std::regex>> result;
+  for (const auto* rule : rules)
+  {
+    auto& rule_regexes = result.emplace_back();
+    for (const auto& input : rule->inputs)
+    {
+      rule_regexes.emplace_back(input.second.source,
+                                std::regex_constants::ECMAScript |
+                                  std::regex_constants::icase);
+    }
+  }
+  return result;
+}
+}
+
+BOOST_AUTO_TEST_CASE(rc_rule_pattern)
+{
+  const std::vector<std::string> patterns = {
+    R"(/input/textures/(.*-albedo)\.tif(f)?$)",
+    R"(^(.*)/([^/]+)\.([^.]+)$)",
+    R"((a|ab)(c|bcd)(d*))",
+    R"(a+?b)",
+    R"((x*)(x+))",
+    R"([a-z]+_(\d{2,3}))",
+    R"([^/]*\.(obj|ply)$)",
+    R"((?:ab)+c|^y)",
+    R"((a|b)*?c)",
+    R"(\w+\s\W)",
+    R"(^$)",
+    R"($)",
+    // Patterns using unsupported features fall back to std::regex.
+    R"((a*)*b)",
+    R"(\bwall)",
+    R"((?=a)ab)"};
+  const std::vector<std::string> texts = {"",
+                                          "ab",
+                                          "abcd",
+                                          "abbcd",
+                                          "xxxx",
+                                          "ababc",
+                                          "y",
+                                          "aab",
+                                          "foo bar!",
+                                          "textures/rock_123.png",
+                                          "/input/textures/Wall-Albedo.TIFF",
+                                          "/input/textures/wall-albedo.tif.1",
+                                          "/data/dir/file.Name.Png",
+                                          "mesh/a.OBJ"};
+  for (const auto& pattern : patterns)
+  {
+    for (const auto& text : texts)
+      check_pattern(pattern, text);
+  }
+
+  BOOST_CHECK(!rule_pattern{"[a-z]+"}.uses_fallback());
+  BOOST_CHECK(rule_pattern{"(a)\\1"}.uses_fallback());
+  BOOST_CHECK_THROW(rule_pattern{"(a"}, std::regex_error);
+  BOOST_CHECK_THROW(rule_pattern{"a{2,1}"}, std::regex_error);
+
+  BOOST_CHECK_EQUAL(
+    rule_pattern{R"(/input/(.*-Albedo)\.tif(f)?$)"}.required_literal(),
+    "-albedo.tif");
+  BOOST_CHECK_EQUAL(rule_pattern{R"(.*\.ply$)"}.required_literal(), ".ply");
+  BOOST_CHECK_EQUAL(rule_pattern{R"(.*\.(ply|obj)$)"}.required_literal(), "");
+  BOOST_CHECK_EQUAL(rule_pattern{R"(abc|def)"}.required_literal(), "");
+}
+
+BOOST_AUTO_TEST_CASE(rc_rule_matcher)
+{
+  std::vector<std::unique_ptr<rule_description>> rule_storage;
+  rule_storage.push_back(make_rule("tiff", 1, {R"(^/in/(.*)\.tiff?$)"}));
+  rule_storage.push_back(make_rule(
+    "mesh", 1, {R"(^/in/(.*)\.ply$)", R"(^/in/(.*)\.obj$)", R"(\.(ply)$)"}));
+  rule_storage.push_back(make_rule("any", 2, {R"(^/in/.*)"}));
+  rule_storage.push_back(
+    make_rule("group", 3, {R"(/(\w+)-(albedo|normal)\.)"}));
+  rule_storage.push_back(make_rule("none", 3, {R"(\.never$)"}));
+  std::vector<rule_description*> rules;
+  for (auto& rule : rule_storage)
+    rules.push_back(rule.get());
+
+  rule_matcher matcher(rules);
+  auto regexes = make_regexes(rules);
+  for (const std::string path :
+       {"/in/a.tif", "/in/dir/B.TIFF", "/in/mesh.ply", "/in/mesh.OBJ",
+        "/out/mesh.ply", "/in/wall-albedo.tif", "/in/wall-Normal.ply",
+        "/in/readme.txt", "", "/in/x.never"})
+  {
+    for (std::uint32_t current_pass = 0; current_pass < 4; ++current_pass)
+    {
+      BOOST_CHECK(match(matcher, path, current_pass) ==
+                  match_naive(rules, regexes, path, current_pass));
+    }
+  }
+  BOOST_CHECK(match(matcher, "/in/mesh.ply", 0) ==
+              (match_list{{"mesh", 0}, {"any", 0}}));
+  BOOST_CHECK(match(rule_matcher{}, "/in/mesh.ply", 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(rc_rule_matcher_benchmark)
+{
+  constexpr std::size_t rule_count = 100;
+  constexpr std::size_t file_count = 10000;
+
+  // Generate rules similar to those found in real projects, each matching
+  // files with a different suffix in a common input folder.
+  const std::vector<std::string> extensions = {"tif", "png", "ply", "obj",
+                                               "ttf"};
+  std::vector<std::unique_ptr<rule_description>> rule_storage;
+  std::vector<rule_description*> rules;
+  for (std::size_t i = 0; i < rule_count; ++i)
+  {
+    const auto& extension = extensions[i % extensions.size()];
+    rule_storage.push_back(make_rule(
+      "rule" + std::to_string(i), 1,
+      {R"(^/project/input/(.*)-suffix)" + std::to_string(i) + R"(\.)" +
+       extension + "$"}));
+    rules.push_back(rule_storage.back().get());
+  }
+  std::vector<std::string> paths;
+  for (std::size_t i = 0; i < file_count; ++i)
+  {
+    auto rule_index = (i * 7) % (rule_count + 10);
+    paths.push_back("/project/input/folder" + std::to_string(i % 50) +
+                    "/asset" + std::to_string(i) + "-suffix" +
+                    std::to_string(rule_index) + "." +
+                    extensions[rule_index % extensions.size()]);
+  }
+
+  std::cout << "Rule matching (" << file_count << " files, " << rule_count
+            << " rules):" << std::endl;
+  auto print = [](const char* name, high_resolution_clock::time_point begin,
+                  std::size_t match_count) {
+    auto seconds =
+      duration_cast<duration<double>>(high_resolution_clock::now() - begin)
+        .count();
+    std::cout << "    " << name << " " << std::fixed << std::setprecision(3)
+              << seconds << " s, " << std::setprecision(0)
+              << file_count / seconds << " files/s (" << match_count
+              << " matches)" << std::endl;
+  };
+
+  auto regexes = make_regexes(rules);
+  auto begin = high_resolution_clock::now();
+  std::vector<match_list> expected;
+  std::size_t match_count = 0;
+  for (const auto& path : paths)
+  {
+    expected.push_back(match_naive(rules, regexes, path, 0));
+    match_count += expected.back().size();
+  }
+  print("std::regex:       ", begin, match_count);
+
+  begin = high_resolution_clock::now();
+  rule_matcher matcher(rules);
+  std::vector<match_list> serial_matches;
+  match_count = 0;
+  for (const auto& path : paths)
+  {
+    serial_matches.push_back(match(matcher, path, 0));
+    match_count += serial_matches.back().size();
+  }
+  print("matcher:          ", begin, match_count);
+  BOOST_CHECK(serial_matches == expected);
+
+  auto primary_task = [&]() {
+    begin = high_resolution_clock::now();
+    std::vector<match_list> parallel_matches(paths.size());
+    task::parallel_transform(
+      paths.begin(), paths.end(), parallel_matches.begin(),
+      [&](const std::string& path) { return match(matcher, path, 0); });
+    print("parallel matcher: ", begin, match_count);
+    BOOST_CHECK(parallel_matches == expected);
+    return 0;
+  };
+  task::task_system{}.num_workers(8).start(primary_task).join();
+}
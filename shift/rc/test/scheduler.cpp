@@ -0,0 +1,198 @@
+#include <shift/rc/build_trace.hpp>
+#include <shift/rc/job_scheduler.hpp>
+#include <shift/rc/resource_compiler.hpp>
+#include <shift/rc/resource_compiler_impl.hpp>
+#include <shift/parser/json/json.hpp>
+#include <shift/task/task_system.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include "utility.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+using namespace shift;
+using namespace shift::rc;
+
+BOOST_AUTO_TEST_CASE(rc_critical_path)
+{
+  build_trace trace;
+  trace.started = job_trace::clock::now();
+  auto add_job = [&](int started, int finished, std::size_t trigger,
+                     std::vector<std::size_t> dependencies) {
+    auto& job = trace.jobs.emplace_back();
+    job.queued = trace.started + std::chrono::milliseconds{started};
+    job.started = job.queued;
+    job.finished = trace.started + std::chrono::milliseconds{finished};
+    job.trigger = trigger;
+    job.dependencies = std::move(dependencies);
+  };
+  add_job(0, 10, job_trace::no_job, {});
+  add_job(0, 30, job_trace::no_job, {});
+  add_job(10, 20, 0, {0});
+  add_job(30, 50, 1, {1, 2});
+  add_job(5, 15, job_trace::no_job, {});
+  trace.finished = trace.started + std::chrono::milliseconds{50};
+
+  BOOST_CHECK(critical_path(trace) == (std::vector<std::size_t>{1, 3}));
+
+  // Jobs waiting for a whole pass are released by a job which didn't
+  // produce any of their inputs.
+  add_job(50, 60, 3, {2});
+  BOOST_CHECK(critical_path(trace) == (std::vector<std::size_t>{1, 3, 5}));
+
+  BOOST_CHECK(critical_path(build_trace{}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(rc_scheduler_trace)
+{
+  using namespace shift::parser;
+
+  auto settings = create_working_folders();
+  write_tiff_image(settings.input_path / "test_image1.tif", 32, 32, 0xFF0077FF);
+  write_tiff_image(settings.input_path / "test_image2.tif", 32, 32, 0xFF77FF00);
+  write_tiff_image(settings.input_path / "test_image3.tif", 32, 32, 0xFFFF0077);
+  write_text_file(settings.input_path / ".rc-rules.json",
+                  R"({ "import": {
+    "pass": 1,
+    "action": "image-import-tiff",
+    "input": {
+      "image": "<input-path/><rule-path/>(test_image.*)\\.tif$"
+    },
+    "output": {
+      "header": "<build-path/><rule-path/><image:1>.image_header",
+      "buffer": "<output-path/><rule-path/><image:1>.lod_<lod-level>.image_buffer"
+    },
+    "options": {
+      "target-format": "rgba8_srgb",
+      "normalized": false
+    }
+  },
+  "global-cache": {
+    "pass": 2,
+    "action": "group-resources",
+    "input": {
+      "images": "<build-path/>(.*)\\.image_header$"
+    },
+    "group-by": [ 1 ],
+    "output": {
+      "group": "<output-path/>global.cache"
+    },
+    "options": {}
+  }
+}
+)");
+  // Returns the number of jobs and dependencies in the last build trace.
+  auto read_trace = [&]() -> std::pair<std::size_t, std::size_t> {
+    std::ifstream file{
+      (settings.build_path / ".rc-cache.trace.json").generic_string(),
+      std::ios_base::in | std::ios_base::binary};
+    BOOST_REQUIRE(file.is_open());
+    json::value root;
+    file >> root;
+
+    std::size_t job_count = 0;
+    std::size_t dependency_count = 0;
+    for (const auto& event : json::get<json::array>(
+           json::get<json::object>(root), "traceEvents"))
+    {
+      const auto& phase =
+        json::get<std::string>(json::get<json::object>(event), "ph");
+      if (phase == "X")
+        ++job_count;
+      else if (phase == "f")
+        ++dependency_count;
+    }
+    return {job_count, dependency_count};
+  };
+
+  run_rc(settings, 4, 0);
+  auto [job_count, dependency_count] = read_trace();
+  BOOST_CHECK_EQUAL(job_count, 4u);
+  // The grouping job depends on all three import jobs.
+  BOOST_CHECK_EQUAL(dependency_count, 3u);
+
+  // Nothing is processed when running again.
+  run_rc(settings, 0, 0);
+  std::tie(job_count, dependency_count) = read_trace();
+  BOOST_CHECK_EQUAL(job_count, 0u);
+  BOOST_CHECK_EQUAL(dependency_count, 0u);
+}
+
+namespace
+{
+/// An action which always fails with a standard exception.
+class throwing_action : public action_base
+{
+public:
+  throwing_action() : action_base("throw", "1.0.0001")
+  {
+  }
+
+  bool process(resource_compiler_impl& /*compiler*/,
+               job_description& /*job*/) const override
+  {
+    throw std::runtime_error("throwing_action");
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE(rc_scheduler_action_throws)
+{
+  auto settings = create_working_folders();
+  write_text_file(settings.input_path / "a.txt", "a");
+  write_text_file(settings.input_path / "b.txt", "b");
+  write_text_file(settings.input_path / ".rc-rules.json",
+                  R"({ "throw": {
+    "pass": 1,
+    "action": "throw",
+    "input": {
+      "text": "<input-path/>(.*)\\.txt$"
+    },
+    "output": {
+      "text": "<build-path/><text:1>.txt"
+    },
+    "options": {}
+  }
+}
+)");
+
+  std::size_t succeeded = 0;
+  std::size_t failed = 0;
+  auto primary_task = [&]() -> int {
+    auto local_path = [](const fs::path& path) {
+      return fs::relative(fs::canonical(fs::absolute(path)),
+                          fs::current_path());
+    };
+
+    throwing_action action;
+    resource_compiler_impl compiler;
+    compiler.input_path = local_path(settings.input_path);
+    compiler.build_path = local_path(settings.build_path);
+    compiler.output_path = local_path(settings.output_path);
+    compiler.cache.register_action("throw", "1.0.0001", action);
+    compiler.read_rules(settings.input_path / ".rc-rules.json", {});
+    compiler.compile_rules();
+
+    std::vector<file_description*> input_files;
+    for (const auto* filename : {"a.txt", "b.txt"})
+    {
+      input_files.push_back(
+        compiler.add_file(compiler.input_path / filename, 0));
+    }
+    compiler.match_files(input_files, 0);
+
+    // Exceptions other than boost::exception must fail the job instead of
+    // leaving the scheduler waiting forever.
+    build_trace trace;
+    job_scheduler scheduler(compiler, trace);
+    std::tie(succeeded, failed) = scheduler.run();
+    return 0;
+  };
+  task::task_system{}.num_workers(2).start(primary_task).join();
+
+  BOOST_CHECK_EQUAL(succeeded, 0u);
+  BOOST_CHECK_EQUAL(failed, 2u);
+  remove_working_folders(settings);
+}
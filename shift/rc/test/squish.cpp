@@ -2,9 +2,17 @@
 #include <boost/test/unit_test.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
 #include <shift/rc/image_util/tiff_io.hpp>
+#include <shift/rc/image_util/image.hpp>
+#include <shift/task/task_system.hpp>
 #include <shift/log/log_server.hpp>
 #include <shift/core/at_exit_scope.hpp>
 #include <squish.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
 #include "utility.hpp"
 
 //#include <iostream>
@@ -214,3 +222,109 @@
 //    io.save(destination_filename, destination_images, false);
 //  }
 //}
+
+BOOST_AUTO_TEST_CASE(rc_squish_benchmark)
+{
+  using namespace std::chrono;
+  using namespace shift;
+  using namespace shift::rc::image_util;
+  using resource_db::image_format;
+
+  // BC7 compression is very slow, so keep the image small.
+  constexpr std::uint32_t size = 64;
+
+  std::vector<std::byte> source_pixels(size * size * 4);
+  std::uint32_t state = 1;
+  for (std::size_t i = 0; i < source_pixels.size(); ++i)
+  {
+    state = state * 1664525u + 1013904223u;
+    source_pixels[i] =
+      static_cast<std::byte>((i / 4 % size + (i & 3) * 64) ^ (state >> 28));
+  }
+  source_image_descriptor source;
+  source.width = size;
+  source.height = size;
+  source.row_stride = 0;
+  source.format = image_format::r8g8b8a8_unorm;
+  source.buffer_size = source_pixels.size();
+  source.buffer = source_pixels.data();
+
+  struct benchmark_format
+  {
+    const char* name;
+    image_format format;
+  };
+  static const benchmark_format formats[] = {
+    {"bc1_rgba_unorm", image_format::bc1_rgba_unorm_block},
+    {"bc2_unorm     ", image_format::bc2_unorm_block},
+    {"bc3_unorm     ", image_format::bc3_unorm_block},
+    {"bc4_unorm     ", image_format::bc4_unorm_block},
+    {"bc5_unorm     ", image_format::bc5_unorm_block},
+    {"bc7_unorm     ", image_format::bc7_unorm_block}};
+
+  struct benchmark_quality
+  {
+    const char* name;
+    convert_flags flags;
+  };
+  static const benchmark_quality qualities[] = {
+    {"low", convert_flag::fast_block_compression},
+    {"medium", convert_flags{}},
+    {"high", convert_flag::best_block_compression}};
+
+  auto measure = [&](image_format format, convert_flags flags) {
+    destination_image_descriptor destination;
+    destination.width = size;
+    destination.height = size;
+    destination.row_stride = 0;
+    destination.format = format;
+    std::vector<std::byte> destination_pixels(
+      required_image_buffer_size(destination));
+    destination.buffer_size = destination_pixels.size();
+    destination.buffer = destination_pixels.data();
+
+    auto begin = high_resolution_clock::now();
+    BOOST_CHECK(!convert_image(destination, source,
+                               convert_region{0, 0, 0, 0, size, size}, flags));
+    auto seconds =
+      duration_cast<duration<double>>(high_resolution_clock::now() - begin)
+        .count();
+    return size * size / seconds / 1.0e3;
+  };
+
+  auto num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+  // BOOST_CHECK resets the formatting flags of std::cout, so set them for
+  // each value printed.
+  auto print = [](auto value) {
+    std::cout << std::fixed << std::setprecision(1) << std::setw(8) << value;
+  };
+  std::cout << "block compression (" << size << "x" << size
+            << " r8g8b8a8_unorm, " << num_workers
+            << " workers, kPixel/s):" << std::endl;
+  std::cout << "                  ";
+  print("serial");
+  for (const auto& quality : qualities)
+    print(quality.name);
+  std::cout << std::endl;
+  auto primary_task = [&]() {
+    for (const auto& format : formats)
+    {
+      // Measure the serial implementation by running outside of any task.
+      double serial_rate = 0.0;
+      std::thread serial(
+        [&]() { serial_rate = measure(format.format, convert_flags{}); });
+      serial.join();
+      std::vector<double> rates;
+      for (const auto& quality : qualities)
+        rates.push_back(measure(format.format, quality.flags));
+
+      std::cout << "    " << format.name;
+      print(serial_rate);
+      for (auto rate : rates)
+        print(rate);
+      std::cout << std::endl;
+    }
+    return 0;
+  };
+  task::task_system{}.num_workers(num_workers).start(primary_task).join();
+}
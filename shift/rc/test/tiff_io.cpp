@@ -0,0 +1,329 @@
+#include <shift/rc/image_util/tiff_io.hpp>
+#include <shift/rc/image_util/image.hpp>
+#include <shift/task/task_system.hpp>
+#include <shift/task/async.hpp>
+#include <shift/log/log_server.hpp>
+#include <shift/core/at_exit_scope.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <tiffio.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::rc::image_util;
+namespace fs = std::filesystem;
+
+namespace
+{
+/// Returns a test image with 8 bit RGBA pixels and a pattern which is not
+/// trivially compressible.
+tiff_image make_image(std::uint32_t width, std::uint32_t height,
+                      std::uint32_t rows_per_strip)
+{
+  tiff_image image;
+  image.samples_per_pixel = 4;
+  image.extra_samples = 0;
+  image.bits_per_sample = 8;
+  image.samples_format = tiff_samples_format::unsigned_int;
+  image.compression = tiff_compression::adobe_deflate;
+  image.width = width;
+  image.height = height;
+  image.rows_per_strip = rows_per_strip;
+  image.photometric = tiff_photometric::rgb;
+  image.planar_config = tiff_planar_config::contiguous;
+  image.pixel_data.resize(static_cast<std::size_t>(width) * height * 4);
+  std::uint32_t state = 1;
+  for (std::size_t i = 0; i < image.pixel_data.size(); ++i)
+  {
+    state = state * 1664525u + 1013904223u;
+    image.pixel_data[i] =
+      static_cast<std::byte>((i / 4 % width + (i & 3) * 64) ^ (state >> 29));
+  }
+  return image;
+}
+
+/// Writes image as a tiled TIFF file, optionally storing each sample in a
+/// separate plane.
+void write_tiled_tiff(const fs::path& filename, const tiff_image& image,
+                      std::uint32_t tile_size, bool separate_planes)
+{
+  auto* tiff = TIFFOpen(filename.generic_string().c_str(), "w");
+  BOOST_REQUIRE(tiff != nullptr);
+  TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, image.width);
+  TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, image.height);
+  TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, image.bits_per_sample);
+  TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, image.samples_per_pixel);
+  TIFFSetField(tiff, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+  TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+  std::uint16_t extra_sample = EXTRASAMPLE_UNASSALPHA;
+  TIFFSetField(tiff, TIFFTAG_EXTRASAMPLES, 1, &extra_sample);
+  TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
+  TIFFSetField(tiff, TIFFTAG_PLANARCONFIG,
+               separate_planes ? PLANARCONFIG_SEPARATE : PLANARCONFIG_CONTIG);
+  TIFFSetField(tiff, TIFFTAG_TILEWIDTH, tile_size);
+  TIFFSetField(tiff, TIFFTAG_TILELENGTH, tile_size);
+
+  std::uint16_t plane_count = separate_planes ? image.samples_per_pixel : 1;
+  std::size_t tile_pixel_size = separate_planes ? 1 : image.samples_per_pixel;
+  std::vector<std::byte> tile(tile_size * tile_size * tile_pixel_size);
+  for (std::uint16_t plane = 0; plane < plane_count; ++plane)
+  {
+    for (std::uint32_t tile_y = 0; tile_y < image.height; tile_y += tile_size)
+    {
+      for (std::uint32_t tile_x = 0; tile_x < image.width;
+           tile_x += tile_size)
+      {
+        std::fill(tile.begin(), tile.end(), std::byte{0});
+        for (std::uint32_t y = tile_y;
+             y < std::min(tile_y + tile_size, image.height); ++y)
+        {
+          for (std::uint32_t x = tile_x;
+               x < std::min(tile_x + tile_size, image.width); ++x)
+          {
+            const auto* pixel =
+              image.pixel_data.data() + (y * image.width + x) * 4;
+            auto* target = tile.data() + ((y - tile_y) * tile_size +
+                                          (x - tile_x)) *
+                                           tile_pixel_size;
+            if (separate_planes)
+              *target = pixel[plane];
+            else
+              std::copy_n(pixel, 4, target);
+          }
+        }
+        TIFFWriteEncodedTile(
+          tiff, TIFFComputeTile(tiff, tile_x, tile_y, 0, plane), tile.data(),
+          static_cast<tmsize_t>(tile.size()));
+      }
+    }
+  }
+  TIFFWriteDirectory(tiff);
+  TIFFClose(tiff);
+}
+
+/// Loads filename in regions and compares the result with reference.
+/// @param max_height
+///   The expected height of the largest region.
+void check_regions(const fs::path& filename, const tiff_image& reference,
+                   std::size_t window_size, std::uint32_t max_height)
+{
+  auto& io = tiff_io::singleton_instance();
+  std::vector<tiff_image> images;
+  BOOST_REQUIRE(io.load_info(filename, images, true));
+  BOOST_REQUIRE_EQUAL(images.size(), 1u);
+  BOOST_CHECK(images.front().pixel_data.empty());
+
+  tiff_stream_options options;
+  options.window_size = window_size;
+  options.row_alignment = 4;
+  std::vector<std::byte> pixel_data;
+  BOOST_REQUIRE(io.load_regions(
+    filename, 0, images.front(), options, [&](const tiff_region& region) {
+      BOOST_CHECK_EQUAL(region.y * reference.width * 4u, pixel_data.size());
+      BOOST_CHECK_EQUAL(region.size, region.height * reference.width * 4u);
+      BOOST_CHECK_LE(region.height, max_height);
+      if (region.y + region.height < reference.height)
+        BOOST_CHECK_EQUAL(region.height % 4, 0u);
+      pixel_data.insert(pixel_data.end(), region.pixel_data,
+                        region.pixel_data + region.size);
+      return true;
+    }));
+  BOOST_CHECK(pixel_data == reference.pixel_data);
+
+  images.clear();
+  BOOST_REQUIRE(io.load(filename, images, true));
+  BOOST_REQUIRE_EQUAL(images.size(), 1u);
+  BOOST_CHECK(images.front().planar_config == tiff_planar_config::contiguous);
+  BOOST_CHECK(images.front().pixel_data == reference.pixel_data);
+}
+
+#if defined(SHIFT_PLATFORM_LINUX)
+/// Resets the peak resident set size of this process.
+void reset_peak_memory()
+{
+  std::ofstream{"/proc/self/clear_refs"} << "5";
+}
+
+/// Returns the peak resident set size of this process in MiB.
+std::size_t peak_memory()
+{
+  std::ifstream status{"/proc/self/status"};
+  for (std::string line; std::getline(status, line);)
+  {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+    {
+      std::size_t kilobytes = 0;
+      std::istringstream{line.substr(6)} >> kilobytes;
+      return kilobytes >> 10;
+    }
+  }
+  return 0;
+}
+#else
+void reset_peak_memory()
+{
+}
+
+std::size_t peak_memory()
+{
+  return 0;
+}
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(rc_tiff_load_regions)
+{
+  core::at_exit_scope at_exit([]() { log::log_server::singleton_destroy(); });
+  auto& log_server = log::log_server::singleton_create();
+  log_server.add_console_sink(false, true, true, false);
+  tiff_io io;
+  auto path = fs::temp_directory_path() / "test.shift.rc.tiff_regions.tif";
+  auto reference = make_image(37, 53, 7);
+
+  auto primary_task = [&]() {
+    BOOST_REQUIRE(io.save(path, {reference}, true));
+    check_regions(path, reference, 37 * 4 * 10, 28);
+    check_regions(path, reference, 37 * 4 * 40, 53);
+    check_regions(path, reference, 0, 28);
+
+    write_tiled_tiff(path, reference, 16, false);
+    check_regions(path, reference, 37 * 4 * 20, 16);
+
+    write_tiled_tiff(path, reference, 16, true);
+    check_regions(path, reference, 37 * 4 * 20, 16);
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+  fs::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(rc_tiff_load_single_pixel)
+{
+  core::at_exit_scope at_exit([]() { log::log_server::singleton_destroy(); });
+  auto& log_server = log::log_server::singleton_create();
+  log_server.add_console_sink(false, true, true, false);
+  tiff_io io;
+  auto path = fs::temp_directory_path() / "test.shift.rc.tiff_pixel.tif";
+
+  // A single 8 bit gray pixel results in a row size of one byte.
+  auto* tiff = TIFFOpen(path.generic_string().c_str(), "w");
+  BOOST_REQUIRE(tiff != nullptr);
+  TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, 1);
+  TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, 1);
+  TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
+  TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 1);
+  TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, 1);
+  TIFFSetField(tiff, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+  TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+  TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+  TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+  std::uint8_t pixel = 0x5A;
+  TIFFWriteEncodedStrip(tiff, 0, &pixel, 1);
+  TIFFWriteDirectory(tiff);
+  TIFFClose(tiff);
+
+  auto primary_task = [&]() {
+    std::vector<tiff_image> images;
+    BOOST_REQUIRE(io.load(path, images, true));
+    BOOST_REQUIRE_EQUAL(images.size(), 1u);
+    BOOST_REQUIRE_EQUAL(images.front().pixel_data.size(), 1u);
+    BOOST_CHECK(images.front().pixel_data.front() == std::byte{0x5A});
+    return 0;
+  };
+  task::task_system{}.num_workers(2).start(primary_task).join();
+  fs::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(rc_tiff_streaming_benchmark)
+{
+  constexpr std::uint32_t size = 16384;
+  constexpr std::size_t window_size = 64 << 20;
+
+  core::at_exit_scope at_exit([]() { log::log_server::singleton_destroy(); });
+  auto& log_server = log::log_server::singleton_create();
+  log_server.add_console_sink(false, true, true, false);
+  tiff_io io;
+  auto path = fs::temp_directory_path() / "test.shift.rc.tiff_streaming.tif";
+  {
+    auto image = make_image(size, size, 64);
+    BOOST_REQUIRE(io.save(path, {image}, true));
+  }
+  std::cout << "TIFF import (" << size << "x" << size << " r8g8b8a8, "
+            << (fs::file_size(path) >> 20) << " MiB file):" << std::endl;
+
+  auto make_destination = [&](std::vector<std::byte>& buffer) {
+    destination_image_descriptor destination;
+    destination.width = size;
+    destination.height = size;
+    destination.row_stride = 0;
+    destination.format = resource_db::image_format::b8g8r8a8_unorm;
+    buffer.resize(required_image_buffer_size(destination));
+    destination.buffer_size = buffer.size();
+    destination.buffer = buffer.data();
+    return destination;
+  };
+  auto print = [&](const char* name, nanoseconds elapsed) {
+    std::cout << "    " << name << std::fixed << std::setprecision(1)
+              << duration_cast<duration<double>>(elapsed).count()
+              << " s, peak RSS " << peak_memory() << " MiB" << std::endl;
+  };
+
+  auto primary_task = [&]() {
+    {
+      reset_peak_memory();
+      auto begin = high_resolution_clock::now();
+      std::vector<tiff_image> images;
+      BOOST_REQUIRE(io.load(path, images, true));
+      std::vector<std::byte> buffer;
+      auto destination = make_destination(buffer);
+      source_image_descriptor source;
+      source.width = size;
+      source.height = size;
+      source.row_stride = 0;
+      source.format = resource_db::image_format::r8g8b8a8_unorm;
+      source.buffer_size = images.front().pixel_data.size();
+      source.buffer = images.front().pixel_data.data();
+      BOOST_CHECK(!convert_image(destination, source,
+                                 convert_region{0, 0, 0, 0, size, size}, {}));
+      print("whole image:     ", high_resolution_clock::now() - begin);
+    }
+
+    {
+      reset_peak_memory();
+      auto begin = high_resolution_clock::now();
+      std::vector<tiff_image> images;
+      BOOST_REQUIRE(io.load_info(path, images, true));
+      std::vector<std::byte> buffer;
+      auto destination = make_destination(buffer);
+      tiff_stream_options options;
+      options.window_size = window_size;
+      BOOST_REQUIRE(io.load_regions(
+        path, 0, images.front(), options, [&](const tiff_region& region) {
+          source_image_descriptor source;
+          source.width = size;
+          source.height = region.height;
+          source.row_stride = 0;
+          source.format = resource_db::image_format::r8g8b8a8_unorm;
+          source.buffer_size = region.size;
+          source.buffer = region.pixel_data;
+          return !convert_image(
+            destination, source,
+            convert_region{0, region.y, 0, 0, size, region.height}, {});
+        }));
+      print("streaming 64MiB: ", high_resolution_clock::now() - begin);
+    }
+    return 0;
+  };
+  task::task_system{}.num_workers(8).start(primary_task).join();
+  fs::remove(path);
+}
@@ -72,14 +72,19 @@ void run_rc(const settings_t& settings, std::size_t expect_succeeded,
     compiler.build_path(settings.build_path);
     compiler.output_path(settings.output_path);
     compiler.verbose(3);
+    if (!settings.artifact_path.empty())
+      compiler.artifact_path(settings.artifact_path);
     auto cache_filepath = settings.build_path / settings.cache_filename;
     if (fs::exists(cache_filepath))
       BOOST_CHECK(compiler.load_cache(cache_filepath));
     compiler.load_rules(".rc-rules.json");
     std::tie(succeeded, failed) = compiler.update();
+    compiler.save_trace(
+      fs::path{cache_filepath}.replace_extension(".trace.json"));
 
     compiler.collect_garbage();
     compiler.save_cache(cache_filepath);
+    compiler.export_cache(fs::path{cache_filepath}.replace_extension(".json"));
     compiler.save_cache_graph(
       fs::path{cache_filepath}.replace_extension(".dot"));
     return 0;
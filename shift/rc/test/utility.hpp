@@ -11,7 +11,9 @@ struct settings_t
   std::filesystem::path input_path;
   std::filesystem::path build_path;
   std::filesystem::path output_path;
-  std::string cache_filename = ".rc-cache.json";
+  /// An optional artifact store folder.
+  std::filesystem::path artifact_path;
+  std::string cache_filename = ".rc-cache";
   std::string rules_filename = ".rc-rules.json";
 };
 
@@ -1,36 +1,60 @@
 #include "shift/resource_db/archive.hpp"
 #include "shift/resource_db/repository.hpp"
 #include <shift/serialization2/all.hpp>
-#include <shift/core/substream_device.hpp>
 #include <shift/core/exception.hpp>
 #include <shift/core/string_util.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/device/file.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <zstd.h>
+#include <lz4.h>
 #include <filesystem>
+#include <algorithm>
+#include <cstddef>
+#include <unordered_set>
+#include <limits>
 #include <array>
-
-#include <iostream>
+#include <mutex>
+#include <vector>
 
 namespace shift::resource_db
 {
 static constexpr std::array<char, 4> archive_magic = {{'R', 'E', 'P', 'O'}};
 
+// Version 1 stores a zlib compressed dictionary of entries without raw sizes.
+// Version 2 added per-entry codecs and the free-space list, and version 3
+// stores an uncompressed dictionary of sorted arrays. These three versions
+// lack the header's version field, so versions 2 and 3 are identified by
+// their magic value instead. Version 4 added the version field.
+static constexpr std::array<char, 4> archive_magic_v2 = {{'R', 'E', 'P', '2'}};
+static constexpr std::array<char, 4> archive_magic_v3 = {{'R', 'E', 'P', '3'}};
+static constexpr std::uint32_t archive_version = 4;
+static constexpr std::uint32_t legacy_header_size =
+  offsetof(archive_header, version);
+
+namespace
+{
+/// An archive entry as stored by versions 1 and 2.
+template <std::uint32_t Version>
+struct legacy_archive_entry
+{
+  archive_entry entry;
+};
+
+template <std::uint32_t Version>
 serialization2::compact_input_archive<>& operator>>(
-  serialization2::compact_input_archive<>& archive, archive_entry& entry)
+  serialization2::compact_input_archive<>& archive,
+  legacy_archive_entry<Version>& legacy_entry)
 {
+  auto& entry = legacy_entry.entry;
   archive >> entry.id >> entry.type >> entry.flags >> entry.offset >>
     entry.size;
+  if constexpr (Version >= 2)
+    archive >> entry.raw_size;
+  else
+    entry.raw_size = entry.size;
   return archive;
 }
-
-serialization2::compact_output_archive<>& operator<<(
-  serialization2::compact_output_archive<>& archive, const archive_entry& entry)
-{
-  archive << entry.id << entry.type << entry.flags << entry.offset
-          << entry.size;
-  return archive;
 }
 
 serialization2::compact_input_archive<>& operator>>(
@@ -51,6 +75,283 @@ serialization2::compact_output_archive<>& operator<<(
   return archive;
 }
 
+/// Returns a zstd decompression context, which is reused by all loads on the
+/// calling thread.
+static ZSTD_DCtx* zstd_decompression_context()
+{
+  thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context{
+    ZSTD_createDCtx(), &ZSTD_freeDCtx};
+  return context.get();
+}
+
+/// Returns the position of a resource type in the order used by
+/// archive::compact. Types which are usually referenced by other types come
+/// first.
+static int dependency_rank(resource_type type)
+{
+  switch (type)
+  {
+  case resource_type::buffer:
+    return 0;
+  case resource_type::image:
+    return 1;
+  case resource_type::font:
+    return 2;
+  case resource_type::shader:
+    return 3;
+  case resource_type::mesh:
+    return 4;
+  case resource_type::material_descriptor:
+    return 5;
+  case resource_type::material:
+    return 6;
+  case resource_type::scene:
+    return 7;
+  case resource_type::resource_group:
+    return 8;
+  default:
+    return 9;
+  }
+}
+
+void archive::open_mapping()
+{
+  // Writable archives grow while being open, so we cannot map them.
+  if (!_mapping.open(_path, _read_only))
+  {
+    BOOST_THROW_EXCEPTION(
+      core::file_open_error()
+      << core::context_info("Cannot open archive file for reading.")
+      << core::path_name_info(_path.generic_string()));
+  }
+}
+
+template <typename Handler>
+void archive::with_data(std::uint64_t offset, std::uint64_t size,
+                        Handler&& handler) const
+{
+  if (_mapping.is_mapped() && offset + size <= _mapping.size())
+  {
+    handler(reinterpret_cast<const char*>(_mapping.data() + offset),
+            static_cast<std::size_t>(size));
+    return;
+  }
+
+  std::vector<char> buffer(static_cast<std::size_t>(size));
+  if (!_mapping.read(offset, buffer.data(), buffer.size()))
+  {
+    BOOST_THROW_EXCEPTION(
+      core::file_read_error()
+      << core::context_info("Cannot read from archive file.")
+      << core::path_name_info(_path.generic_string()));
+  }
+  handler(buffer.data(), buffer.size());
+}
+
+template <typename Handler>
+void archive::with_raw_data(const archive_entry& entry, Handler&& handler) const
+{
+  with_data(
+    _header.header_size + entry.offset, entry.size,
+    [&](const char* data, std::size_t size) {
+      if (!(entry.flags & file_flag::zstd_compressed) &&
+          !(entry.flags & file_flag::lz4_compressed))
+      {
+        handler(data, size);
+        return;
+      }
+
+      std::vector<char> buffer(static_cast<std::size_t>(entry.raw_size));
+      bool success;
+      if (entry.flags & file_flag::zstd_compressed)
+      {
+        auto result =
+          ZSTD_decompressDCtx(zstd_decompression_context(), buffer.data(),
+                              buffer.size(), data, size);
+        success = !ZSTD_isError(result) && result == buffer.size();
+      }
+      else
+      {
+        auto result = LZ4_decompress_safe(data, buffer.data(),
+                                          static_cast<int>(size),
+                                          static_cast<int>(buffer.size()));
+        success = result >= 0 && static_cast<std::size_t>(result) ==
+                                    buffer.size();
+      }
+      if (!success)
+      {
+        BOOST_THROW_EXCEPTION(
+          core::file_read_error()
+          << core::context_info("Cannot decompress archive entry.")
+          << core::path_name_info(_path.generic_string()));
+      }
+      handler(buffer.data(), buffer.size());
+    });
+}
+
+file_flags archive::encode(std::vector<char>& buffer) const
+{
+  const auto& policy = _codec_policy;
+  if (buffer.size() < policy.min_compression_size)
+    return file_flags{0};
+
+  std::vector<char> zstd_buffer(ZSTD_compressBound(buffer.size()));
+  auto zstd_size =
+    ZSTD_compress(zstd_buffer.data(), zstd_buffer.size(), buffer.data(),
+                  buffer.size(), policy.zstd_level);
+  if (ZSTD_isError(zstd_size))
+    zstd_size = std::numeric_limits<std::size_t>::max();
+
+  std::vector<char> lz4_buffer;
+  auto lz4_size = std::numeric_limits<std::size_t>::max();
+  if (buffer.size() <= LZ4_MAX_INPUT_SIZE)
+  {
+    auto input_size = static_cast<int>(buffer.size());
+    lz4_buffer.resize(static_cast<std::size_t>(LZ4_compressBound(input_size)));
+    if (auto result =
+          LZ4_compress_default(buffer.data(), lz4_buffer.data(), input_size,
+                               static_cast<int>(lz4_buffer.size()));
+        result > 0)
+    {
+      lz4_size = static_cast<std::size_t>(result);
+    }
+  }
+
+  auto raw_size = static_cast<double>(buffer.size());
+  auto max_size = raw_size * policy.max_compression_ratio;
+  if (static_cast<double>(lz4_size) <= max_size &&
+      (zstd_size >= lz4_size ||
+       static_cast<double>(lz4_size - zstd_size) <=
+         raw_size * policy.zstd_min_saving))
+  {
+    lz4_buffer.resize(lz4_size);
+    buffer.swap(lz4_buffer);
+    return file_flag::lz4_compressed;
+  }
+  if (static_cast<double>(zstd_size) <= max_size)
+  {
+    zstd_buffer.resize(zstd_size);
+    buffer.swap(zstd_buffer);
+    return file_flag::zstd_compressed;
+  }
+  return file_flags{0};
+}
+
+void archive::read_dictionary(std::uint32_t version, const char* data,
+                              std::size_t size)
+{
+  if (version >= 3)
+  {
+    // The dictionary is stored uncompressed, so each of its arrays is copied
+    // straight out of the file mapping.
+    serialization2::compact_input_archive<> archive{data, size};
+    _dictionary.load(archive);
+    archive >> _names >> _free_space;
+    return;
+  }
+
+  boost::iostreams::filtering_istream stream;
+  stream.push(boost::iostreams::zlib_decompressor());
+  stream.push(boost::iostreams::array_source(data, size));
+  serialization2::compact_input_archive<> archive{stream};
+  std::vector<archive_entry> entries;
+  if (version == 1)
+  {
+    std::vector<legacy_archive_entry<1>> legacy_entries;
+    archive >> legacy_entries >> _names;
+    for (const auto& legacy_entry : legacy_entries)
+      entries.push_back(legacy_entry.entry);
+  }
+  else
+  {
+    std::vector<legacy_archive_entry<2>> legacy_entries;
+    archive >> legacy_entries >> _names >> _free_space;
+    for (const auto& legacy_entry : legacy_entries)
+      entries.push_back(legacy_entry.entry);
+  }
+  _dictionary.assign(std::move(entries));
+  std::sort(_names.begin(), _names.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.id < rhs.id; });
+}
+
+void archive::write_dictionary(std::ostream& file)
+{
+  std::vector<char> dictionary_buffer;
+  // First, store object into a memory buffer.
+  {
+    serialization2::compact_output_archive<> archive{dictionary_buffer};
+    _dictionary.save(archive);
+    archive << _names << _free_space;
+  }
+  _header.dictionary_size = dictionary_buffer.size();
+
+  file.seekp(0, std::ios_base::beg);
+  file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+  file.seekp(_header.header_size + _header.data_size, std::ios_base::beg);
+  file.write(dictionary_buffer.data(), dictionary_buffer.size());
+}
+
+std::uint64_t archive::allocate(std::uint64_t size)
+{
+  // Pick the smallest free range which is large enough, to keep large ranges
+  // available for large entries.
+  auto best_iter = _free_space.end();
+  for (auto range_iter = _free_space.begin(); range_iter != _free_space.end();
+       ++range_iter)
+  {
+    if (range_iter->second >= size &&
+        (best_iter == _free_space.end() ||
+         range_iter->second < best_iter->second))
+    {
+      best_iter = range_iter;
+      if (best_iter->second == size)
+        break;
+    }
+  }
+  if (best_iter == _free_space.end())
+  {
+    auto offset = _header.data_size;
+    _header.data_size += size;
+    return offset;
+  }
+
+  auto [offset, range_size] = *best_iter;
+  _free_space.erase(best_iter);
+  if (range_size > size)
+    _free_space.emplace(offset + size, range_size - size);
+  return offset;
+}
+
+void archive::release(std::uint64_t offset, std::uint64_t size)
+{
+  if (size == 0)
+    return;
+
+  // Merge with the adjacent free ranges.
+  auto next_iter = _free_space.lower_bound(offset);
+  if (next_iter != _free_space.end() && offset + size == next_iter->first)
+  {
+    size += next_iter->second;
+    next_iter = _free_space.erase(next_iter);
+  }
+  if (next_iter != _free_space.begin())
+  {
+    auto previous_iter = std::prev(next_iter);
+    if (previous_iter->first + previous_iter->second == offset)
+    {
+      offset = previous_iter->first;
+      size += previous_iter->second;
+      _free_space.erase(previous_iter);
+    }
+  }
+
+  // Free ranges at the end of the data section simply shrink it.
+  if (offset + size == _header.data_size)
+    _header.data_size = offset;
+  else
+    _free_space.emplace(offset, size);
+}
+
 archive::archive(const std::filesystem::path& path) : mountable(path)
 {
 }
@@ -91,6 +392,9 @@ bool archive::open(bool read_only)
     _header.header_size = sizeof(_header);
     _header.data_size = 0;
     _header.dictionary_size = 0;
+    _header.version = archive_version;
+    _header.reserved = 0;
+    open_mapping();
   }
   else if (!fs::is_regular_file(_path))
   {
@@ -130,43 +434,85 @@ bool archive::open(bool read_only)
     }
 
     _file.seekg(0, std::ios_base::end);
-    auto file_size = _file.tellg();
+    auto file_size = static_cast<std::uint64_t>(_file.tellg());
     _file.seekg(0, std::ios_base::beg);
 
-    // Read file dictionary offset.
-    if (file_size < static_cast<std::streamoff>(sizeof(_header)))
+    // Read the part of the header which is common to all versions. Make sure
+    // not to write anything back to files we cannot read, which would destroy
+    // their contents.
+    if (file_size < legacy_header_size)
+    {
+      _file.close();
       return false;
-    _file.read(reinterpret_cast<char*>(&_header), sizeof(_header));
-    if (_header.magic != archive_magic ||
-        _header.header_size != sizeof(_header))
+    }
+    _header = {};
+    _file.read(reinterpret_cast<char*>(&_header), legacy_header_size);
+    std::uint32_t version = 0;
+    if (_header.header_size == legacy_header_size)
+    {
+      if (_header.magic == archive_magic)
+        version = 1;
+      else if (_header.magic == archive_magic_v2)
+        version = 2;
+      else if (_header.magic == archive_magic_v3)
+        version = 3;
+    }
+    else if (_header.magic == archive_magic &&
+             _header.header_size == sizeof(_header) &&
+             file_size >= sizeof(_header))
+    {
+      _file.read(reinterpret_cast<char*>(&_header) + legacy_header_size,
+                 sizeof(_header) - legacy_header_size);
+      version = _header.version;
+    }
+    const char* error = nullptr;
+    if (version == 0)
+      error = "File is not an archive.";
+    else if (version > archive_version)
+      error = "Unsupported archive version.";
+    else if (_header.header_size + _header.data_size +
+               _header.dictionary_size >
+             file_size)
     {
-      // Referenced file is not a valid archive, so reset it.
-      _header.magic = archive_magic;
-      _header.header_size = sizeof(_header);
-      _header.data_size = 0;
-      _header.dictionary_size = 0;
+      error = "Archive file is truncated.";
+    }
+    if (error != nullptr)
+    {
+      _file.close();
+      BOOST_THROW_EXCEPTION(core::file_read_error()
+                            << core::context_info(error)
+                            << core::path_name_info(_path.generic_string()));
     }
 
-    if (_header.dictionary_size > 0)
+    try
     {
-      boost::iostreams::filtering_istream stream;
-      stream.push(boost::iostreams::zlib_decompressor());
-      stream.push(core::substream_device<std::fstream>(
-        _file, _header.header_size + _header.data_size,
-        _header.dictionary_size));
-      /// ToDo: serialization does not yet support boost multi_index
-      /// containers. Thus we have to copy all data into a regular vector.
-      std::vector<archive_entry> temp_dictionary;
-      std::vector<named_resource> temp_names;
-      serialization2::compact_input_archive<> archive{stream};
-      archive >> temp_dictionary >> temp_names;
-      for (auto& entry : temp_dictionary)
+      open_mapping();
+      if (_header.dictionary_size > 0)
       {
-        entry.source = this;
-        _dictionary.insert(std::move(entry));
+        with_data(_header.header_size + _header.data_size,
+                  _header.dictionary_size,
+                  [&](const char* data, std::size_t size) {
+                    read_dictionary(version, data, size);
+                  });
+      }
+      // Older versions are upgraded by rewriting the archive, because the
+      // current header doesn't fit in front of their data.
+      if (version < archive_version && !_read_only && !compact())
+      {
+        BOOST_THROW_EXCEPTION(
+          core::file_write_error()
+          << core::context_info("Cannot upgrade archive file.")
+          << core::path_name_info(_path.generic_string()));
       }
-      for (auto& name : temp_names)
-        _names.insert(name);
+    }
+    catch (...)
+    {
+      _mapping.close();
+      _file.close();
+      _dictionary.clear();
+      _names.clear();
+      _free_space.clear();
+      throw;
     }
   }
   return true;
@@ -177,33 +523,13 @@ void archive::close()
   if (_file.is_open())
   {
     if (!_read_only)
-    {
-      std::vector<char> dictionary_buffer;
-      // First, store object into a memory buffer.
-      {
-        boost::iostreams::filtering_ostream stream;
-        stream.push(boost::iostreams::zlib_compressor());
-        stream.push(boost::iostreams::back_inserter(dictionary_buffer));
-        /// ToDo: serialization does not yet support boost multi_index
-        /// containers. Thus we have to copy all data into a regular vector.
-        std::vector<archive_entry> temp_dictionary;
-        std::vector<named_resource> temp_names;
-        for (const auto& entry : _dictionary)
-          temp_dictionary.push_back(entry);
-        for (const auto& name : _names)
-          temp_names.push_back(name);
-        serialization2::compact_output_archive<> archive{stream};
-        archive << temp_dictionary << temp_names;
-      }
-      _header.dictionary_size = dictionary_buffer.size();
-
-      _file.seekp(0, std::ios_base::beg);
-      _file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
-      _file.seekp(_header.header_size + _header.data_size, std::ios_base::beg);
-      _file.write(dictionary_buffer.data(), dictionary_buffer.size());
-    }
+      write_dictionary(_file);
+    _mapping.close();
     _file.close();
   }
+  _dictionary.clear();
+  _names.clear();
+  _free_space.clear();
 }
 
 resource_id archive::lookup_id(const std::filesystem::path& /*relative_path*/)
@@ -215,21 +541,52 @@ bool archive::load(resource_id id, resource_base& resource,
                    resource_type /*type*/)
 {
   std::shared_lock lock(_mutex);
-  auto entry_iter = _dictionary.find(id);
-  if (entry_iter == _dictionary.end())
+  auto found_entry = _dictionary.find(id);
+  if (!found_entry)
     return false;
 
-  auto& entry = *entry_iter;
-  BOOST_ASSERT(entry.type == resource.type());
-  if (entry.type != resource.type())
+  BOOST_ASSERT(found_entry->type == resource.type());
+  if (found_entry->type != resource.type())
     return false;
+  const auto& entry = *found_entry;
+  // Storage is only ever reused in writable archives, so for read-only
+  // archives we don't need to hold the lock while reading the entry's data.
+  if (_read_only)
+    lock.unlock();
 
-  boost::iostreams::filtering_istream stream;
   if (entry.flags & file_flag::zlib_compressed)
-    stream.push(boost::iostreams::zlib_decompressor());
-  stream.push(core::substream_device<std::fstream>(
-    _file, _header.header_size + entry.offset, entry.size));
-  resource.load(id, stream);
+  {
+    with_data(_header.header_size + entry.offset, entry.size,
+              [&](const char* data, std::size_t size) {
+                boost::iostreams::filtering_istream stream;
+                stream.push(boost::iostreams::zlib_decompressor());
+                stream.push(boost::iostreams::array_source(data, size));
+                serialization2::compact_input_archive<> archive{stream};
+                resource.load(id, archive);
+              });
+  }
+  else
+  {
+    with_raw_data(entry, [&](const char* data, std::size_t size) {
+      serialization2::compact_input_archive<> archive{data, size};
+      resource.load(id, archive);
+    });
+  }
+  return true;
+}
+
+bool archive::read(resource_id id, std::vector<char>& data)
+{
+  std::shared_lock lock(_mutex);
+  auto entry = _dictionary.find(id);
+  if (!entry)
+    return false;
+  if (_read_only)
+    lock.unlock();
+
+  with_raw_data(*entry, [&](const char* raw_data, std::size_t size) {
+    data.assign(raw_data, raw_data + size);
+  });
   return true;
 }
 
@@ -237,70 +594,185 @@ bool archive::save(const resource_base& resource, resource_type type,
                    resource_id id,
                    const std::filesystem::path& /*relative_path*/)
 {
-  namespace fs = std::filesystem;
-
   if (_read_only)
   {
     /// ToDo: Throw exception.
     return false;
   }
 
+  // Resource ids are derived from their contents, so an existing entry with
+  // the same id and type already holds this resource.
+  auto is_stored = [&]() {
+    auto old_entry = _dictionary.find(id);
+    return old_entry && old_entry->type == type;
+  };
   {
     std::shared_lock lock(_mutex);
-    if (_dictionary.find(id) != _dictionary.end())
-    {
-      // Object already exists.
+    if (is_stored())
       return true;
-    }
   }
 
   archive_entry entry;
+  entry.id = id;
   entry.type = type;
-  entry.source = this;
 
   std::vector<char> buffer;
   // First, store object into a memory buffer.
   {
-    boost::iostreams::filtering_ostream stream;
-    stream.push(boost::iostreams::back_inserter(buffer));
-    resource.save(stream);
+    serialization2::compact_output_archive<> archive{buffer};
+    resource.save(archive);
   }
-  //{
-  //  // Compress the buffer and test whether this yields a smaller size.
-  //  std::vector<char> compressed_buffer;
-  //  {
-  //    serialization::compact_output_archive<> compact_archive(1);
-  //    compact_archive.push(boost::iostreams::zlib_compressor());
-  //    compact_archive.push(
-  //      boost::iostreams::back_inserter(compressed_buffer));
-  //    compact_archive.write(buffer.data(), buffer.size());
-  //  }
-  //  if (compressed_buffer.size() < buffer.size())
-  //  {
-  //    buffer.swap(compressed_buffer);
-  //    entry.flags |= file_flag::zlib_compressed;
-  //  }
-  //}
-
-  /// ToDo: Find free storage, instead of simply appending new data to the
-  /// end.
+  entry.raw_size = buffer.size();
+  entry.flags = encode(buffer);
+  entry.size = buffer.size();
 
   {
     std::unique_lock lock(_mutex);
-    entry.id = id;
-    entry.offset = _header.data_size;
-    entry.size = buffer.size();
+    // Another thread may have stored the same resource in the meantime.
+    if (is_stored())
+      return true;
+    // Replace an existing entry with the same id, but of a different type.
+    if (auto old_entry = _dictionary.find(id))
+      release(old_entry->offset, old_entry->size);
+    entry.offset = allocate(entry.size);
     _file.seekp(_header.header_size + entry.offset, std::ios_base::beg);
     _file.write(buffer.data(), entry.size);
-    _header.data_size += entry.size;
-    _dictionary.insert(std::move(entry));
+    // Make the data visible to concurrent positional reads.
+    _file.flush();
+    _dictionary.insert_or_assign(entry);
+  }
+  return true;
+}
+
+bool archive::insert(resource_id /*id*/,
+                     const std::filesystem::path& /*relative_path*/)
+{
+  return false;
+}
+
+void archive::erase(resource_id id)
+{
+  if (_read_only)
+    return;
+
+  std::unique_lock lock(_mutex);
+  auto entry = _dictionary.find(id);
+  if (!entry)
+    return;
+  release(entry->offset, entry->size);
+  _dictionary.erase(id);
+  auto name_iter = std::lower_bound(
+    _names.begin(), _names.end(), id,
+    [](const auto& name, resource_id id) { return name.id < id; });
+  if (name_iter != _names.end() && name_iter->id == id)
+    _names.erase(name_iter);
+}
+
+bool archive::locate(resource_id id, std::uint64_t& position)
+{
+  std::shared_lock lock(_mutex);
+  auto entry = _dictionary.find(id);
+  if (!entry)
+    return false;
+  position = entry->offset;
+  return true;
+}
+
+bool archive::compact(const std::vector<resource_id>& order)
+{
+  namespace fs = std::filesystem;
+
+  if (_read_only || !_file.is_open())
+    return false;
+
+  std::unique_lock lock(_mutex);
+
+  std::vector<archive_entry> entries;
+  entries.reserve(_dictionary.size());
+  std::unordered_set<resource_id> ordered_ids;
+  for (auto id : order)
+  {
+    auto entry = _dictionary.find(id);
+    if (entry && ordered_ids.insert(id).second)
+      entries.push_back(*entry);
+  }
+  auto ordered_count = entries.size();
+  _dictionary.for_each([&](const archive_entry& entry) {
+    if (ordered_ids.find(entry.id) == ordered_ids.end())
+      entries.push_back(entry);
+  });
+  std::sort(entries.begin() + static_cast<std::ptrdiff_t>(ordered_count),
+            entries.end(), [](const auto& lhs, const auto& rhs) {
+              auto lhs_rank = dependency_rank(lhs.type);
+              auto rhs_rank = dependency_rank(rhs.type);
+              if (lhs_rank != rhs_rank)
+                return lhs_rank < rhs_rank;
+              return lhs.offset < rhs.offset;
+            });
+
+  // Copy all entries to a new file without decompressing them.
+  auto temp_path = _path;
+  temp_path += ".compact";
+  std::fstream target(temp_path.generic_string(),
+                      std::ios_base::in | std::ios_base::out |
+                        std::ios_base::binary | std::ios_base::trunc);
+  if (!target.is_open())
+    return false;
+  // The header is rewritten along with the dictionary.
+  target.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+
+  std::uint64_t data_size = 0;
+  for (auto& entry : entries)
+  {
+    with_data(_header.header_size + entry.offset, entry.size,
+              [&](const char* data, std::size_t size) {
+                target.write(data, static_cast<std::streamsize>(size));
+              });
+    entry.offset = data_size;
+    data_size += entry.size;
   }
+  if (!target)
+  {
+    target.close();
+    fs::remove(temp_path);
+    return false;
+  }
+
+  _dictionary.assign(std::move(entries));
+  _free_space.clear();
+  // Archives of older versions are upgraded by compaction.
+  _header.magic = archive_magic;
+  _header.header_size = sizeof(_header);
+  _header.version = archive_version;
+  _header.reserved = 0;
+  _header.data_size = data_size;
+  write_dictionary(target);
+  target.close();
+
+  _mapping.close();
+  _file.close();
+  fs::rename(temp_path, _path);
+  _file.open(_path.generic_string(), std::ios_base::in | std::ios_base::out |
+                                       std::ios_base::binary);
+  if (!_file.is_open())
+  {
+    BOOST_THROW_EXCEPTION(
+      core::file_open_error()
+      << core::context_info(
+           "Cannot open archive file for reading and writing.")
+      << core::path_name_info(_path.generic_string()));
+  }
+  open_mapping();
   return true;
 }
 
-void archive::erase(resource_id /*id*/)
+std::uint64_t archive::free_size() const
 {
-  /// ToDo: ...
+  std::shared_lock lock(_mutex);
+  std::uint64_t result = 0;
+  for (const auto& [offset, size] : _free_space)
+    result += size;
+  return result;
 }
 
 // void archive::add_named_resource(const std::string& name, resource_id id,
@@ -3,27 +3,20 @@
 
 #include <cstdint>
 #include <array>
-#include <unordered_map>
+#include <map>
+#include <vector>
 #include <fstream>
 #include <shared_mutex>
 #include <filesystem>
-#include <shift/core/bit_field.hpp>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
+#include <string>
+#include <ctime>
+#include <shift/platform/mapped_file.hpp>
 #include "shift/resource_db/resource.hpp"
+#include "shift/resource_db/archive_dictionary.hpp"
 #include "shift/resource_db/mountable.hpp"
 
 namespace shift::resource_db
 {
-enum class file_flag : std::uint32_t
-{
-  zlib_compressed = 0b0001,
-  bzip2_compressed = 0b0010
-};
-
-using file_flags = core::bit_field<file_flag>;
-
 // Data header used for archive files.
 struct archive_header
 {
@@ -31,28 +24,10 @@ struct archive_header
   std::uint32_t header_size;
   std::uint64_t data_size;
   std::uint64_t dictionary_size;
-};
-
-class archive;
-
-struct archive_entry
-{
-  ///
-  friend serialization2::compact_input_archive<>& operator>>(
-    serialization2::compact_input_archive<>& archive, archive_entry& entry);
-
-  ///
-  friend serialization2::compact_output_archive<>& operator<<(
-    serialization2::compact_output_archive<>& archive,
-    const archive_entry& entry);
-
-  resource_id id = 0;
-  resource_type type = resource_type::undefined;
-  file_flags flags = file_flags{0};
-  std::uint64_t offset = 0;
-  std::uint64_t size = 0;
-  mutable archive* source = nullptr;
-  mutable std::shared_ptr<resource_base> instance;
+  /// The version of the archive format. Headers of archives written before
+  /// this field was added end right in front of it.
+  std::uint32_t version;
+  std::uint32_t reserved;
 };
 
 struct named_resource
@@ -71,42 +46,35 @@ struct named_resource
   std::time_t last_write_time;
 };
 
-struct id_tag
+/// Thresholds used to select the compression codec of each archive entry.
+struct archive_codec_policy
 {
-};
+  /// Entries smaller than this number of bytes are stored uncompressed.
+  std::size_t min_compression_size = 512;
 
-struct type_tag
-{
-};
+  /// Compressed data is only stored if its size is at most this fraction of
+  /// the raw size.
+  float max_compression_ratio = 0.9f;
 
-struct name_tag
-{
-};
+  /// LZ4 decodes several times faster than zstd, so zstd is only used if it
+  /// saves at least this fraction of the raw size compared to LZ4.
+  float zstd_min_saving = 0.05f;
 
-struct last_write_time_tag
-{
+  /// The zstd compression level.
+  int zstd_level = 9;
 };
 
-using resource_set = boost::multi_index_container<
-  archive_entry,
-  boost::multi_index::indexed_by<
-    boost::multi_index::ordered_unique<boost::multi_index::tag<id_tag>,
-                                       BOOST_MULTI_INDEX_MEMBER(
-                                         archive_entry, resource_id, id)>,
-    boost::multi_index::ordered_non_unique<
-      boost::multi_index::tag<type_tag>,
-      BOOST_MULTI_INDEX_MEMBER(archive_entry, resource_type, type)>>>;
-
-using named_resource_set = boost::multi_index_container<
-  named_resource,
-  boost::multi_index::indexed_by<
-    boost::multi_index::ordered_unique<boost::multi_index::tag<id_tag>,
-                                       BOOST_MULTI_INDEX_MEMBER(
-                                         named_resource, resource_id, id)>,
-    boost::multi_index::ordered_unique<boost::multi_index::tag<name_tag>,
-                                       BOOST_MULTI_INDEX_MEMBER(
-                                         named_resource, std::string, name)>>>;
 /// An archive is the storage class for the repository key-value database.
+/// @remarks
+///   Read-only archives are mapped into memory and uncompressed resources are
+///   deserialized straight from the mapping. Archives opened for writing fall
+///   back to positional reads. In both cases any number of threads may load
+///   resources concurrently, because no shared file position is involved.
+///   Each entry is stored either uncompressed or compressed using zstd or LZ4,
+///   depending on the archive's codec policy. Storage of replaced and erased
+///   entries is tracked in a free-space list and reused by subsequent saves.
+///   Archives written in an older version of the format can still be read.
+///   Opening such an archive for writing rewrites it in the current format.
 class archive final : public mountable
 {
 public:
@@ -133,17 +101,54 @@ public:
   bool save(const resource_base& resource, resource_type type, resource_id id,
             const std::filesystem::path& relative_path) override;
 
+  /// Archives store resources in a single file, so this always fails.
+  bool insert(resource_id id,
+              const std::filesystem::path& relative_path) override;
+
   ///
   void erase(resource_id id) override;
 
   ///
-  const resource_set& dictionary() const
+  bool locate(resource_id id, std::uint64_t& position) override;
+
+  /// Reads the serialized and decompressed data of a resource.
+  /// @return
+  ///   False if there is no resource with the passed id.
+  bool read(resource_id id, std::vector<char>& data);
+
+  /// Rewrites the archive without any free space.
+  /// @param order
+  ///   Resources to store first, in the passed order. All remaining resources
+  ///   follow ordered by their type, such that resources are usually stored
+  ///   behind their dependencies, and by their previous position.
+  /// @remarks
+  ///   The archive must be open for writing. Compaction is meant to be run
+  ///   offline, because it blocks all other operations on the archive.
+  bool compact(const std::vector<resource_id>& order = {});
+
+  ///
+  const archive_codec_policy& codec_policy() const
   {
-    return _dictionary;
+    return _codec_policy;
   }
 
   ///
-  const named_resource_set& names() const
+  void codec_policy(const archive_codec_policy& new_policy)
+  {
+    _codec_policy = new_policy;
+  }
+
+  /// Returns the total size of unused storage within the archive file.
+  std::uint64_t free_size() const;
+
+  ///
+  const archive_dictionary& dictionary() const
+  {
+    return _dictionary;
+  }
+
+  /// Returns all named resources, ordered by id.
+  const std::vector<named_resource>& names() const
   {
     return _names;
   }
@@ -152,13 +157,58 @@ private:
   ///
   static std::filesystem::path to_path(resource_id id);
 
+  /// Opens _mapping for the archive file.
+  void open_mapping();
+
+  /// Calls handler with a pointer to size bytes of the archive file starting
+  /// at offset. The data either points into the file mapping or into a
+  /// temporary buffer.
+  template <typename Handler>
+  void with_data(std::uint64_t offset, std::uint64_t size,
+                 Handler&& handler) const;
+
+  /// Calls handler with the decompressed data of the passed entry.
+  /// @remarks
+  ///   Uncompressed entries are passed to handler without copying them.
+  template <typename Handler>
+  void with_raw_data(const archive_entry& entry, Handler&& handler) const;
+
+  /// Compresses buffer according to the codec policy.
+  /// @return
+  ///   The flags describing the codec which was used.
+  file_flags encode(std::vector<char>& buffer) const;
+
+  /// Deserializes the dictionary, the names and the free-space list.
+  /// @param version
+  ///   The version of the archive format the data was written in.
+  void read_dictionary(std::uint32_t version, const char* data,
+                       std::size_t size);
+
+  /// Writes the header and the dictionary to file.
+  void write_dictionary(std::ostream& file);
+
+  /// Finds storage for size bytes, either from the free-space list or from
+  /// the end of the data section, and returns its offset.
+  /// @pre
+  ///   _mutex is locked exclusively.
+  std::uint64_t allocate(std::uint64_t size);
+
+  /// Adds a range of storage to the free-space list.
+  /// @pre
+  ///   _mutex is locked exclusively.
+  void release(std::uint64_t offset, std::uint64_t size);
+
   bool _read_only = true;
 
   std::fstream _file;
+  platform::mapped_file _mapping;
   archive_header _header;
-  std::shared_timed_mutex _mutex;
-  resource_set _dictionary;
-  named_resource_set _names;
+  mutable std::shared_timed_mutex _mutex;
+  archive_dictionary _dictionary;
+  std::vector<named_resource> _names;
+  /// Unused ranges of the data section, mapping offsets to sizes.
+  std::map<std::uint64_t, std::uint64_t> _free_space;
+  archive_codec_policy _codec_policy;
 };
 }
 
@@ -0,0 +1,180 @@
+#include "shift/resource_db/archive_dictionary.hpp"
+#include <shift/serialization2/all.hpp>
+#include <algorithm>
+
+namespace shift::resource_db
+{
+std::optional<archive_entry> archive_dictionary::find(resource_id id) const
+{
+  auto index = lower_bound(id);
+  if (index < _ids.size() && _ids[index] == id)
+    return entry_at(index);
+  if (!_pending.empty())
+  {
+    if (auto pending_iter = _pending.find(id);
+        pending_iter != _pending.end())
+    {
+      return pending_iter->second;
+    }
+  }
+  return std::nullopt;
+}
+
+void archive_dictionary::insert_or_assign(const archive_entry& entry)
+{
+  _type_index_valid = false;
+  auto index = lower_bound(entry.id);
+  if (index < _ids.size() && _ids[index] == entry.id)
+  {
+    _types[index] = entry.type;
+    _flags[index] = entry.flags;
+    _offsets[index] = entry.offset;
+    _sizes[index] = entry.size;
+    _raw_sizes[index] = entry.raw_size;
+    return;
+  }
+
+  _pending.insert_or_assign(entry.id, entry);
+  if (_pending.size() > std::max<std::size_t>(64, _ids.size() / 16))
+    merge();
+}
+
+bool archive_dictionary::erase(resource_id id)
+{
+  _type_index_valid = false;
+  if (_pending.erase(id) > 0)
+    return true;
+
+  auto index = lower_bound(id);
+  if (index >= _ids.size() || _ids[index] != id)
+    return false;
+  auto offset = static_cast<std::ptrdiff_t>(index);
+  _ids.erase(_ids.begin() + offset);
+  _types.erase(_types.begin() + offset);
+  _flags.erase(_flags.begin() + offset);
+  _offsets.erase(_offsets.begin() + offset);
+  _sizes.erase(_sizes.begin() + offset);
+  _raw_sizes.erase(_raw_sizes.begin() + offset);
+  return true;
+}
+
+void archive_dictionary::assign(std::vector<archive_entry> entries)
+{
+  // Keep the last of several entries with the same id.
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const auto& lhs, const auto& rhs) {
+                     return lhs.id < rhs.id;
+                   });
+  clear();
+  _ids.reserve(entries.size());
+  _types.reserve(entries.size());
+  _flags.reserve(entries.size());
+  _offsets.reserve(entries.size());
+  _sizes.reserve(entries.size());
+  _raw_sizes.reserve(entries.size());
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    if (i + 1 < entries.size() && entries[i + 1].id == entries[i].id)
+      continue;
+    push_back(entries[i]);
+  }
+}
+
+void archive_dictionary::clear()
+{
+  _type_index_valid = false;
+  _ids.clear();
+  _types.clear();
+  _flags.clear();
+  _offsets.clear();
+  _sizes.clear();
+  _raw_sizes.clear();
+  _pending.clear();
+}
+
+void archive_dictionary::load(serialization2::compact_input_archive<>& archive)
+{
+  clear();
+  archive >> _ids >> _types >> _flags >> _offsets >> _sizes >> _raw_sizes;
+  auto count = _ids.size();
+  if (_types.size() != count || _flags.size() != count ||
+      _offsets.size() != count || _sizes.size() != count ||
+      _raw_sizes.size() != count ||
+      std::adjacent_find(_ids.begin(), _ids.end(),
+                         std::greater_equal<resource_id>{}) != _ids.end())
+  {
+    clear();
+    BOOST_THROW_EXCEPTION(serialization2::serialization_error()
+                          << serialization2::serialization_error_info(
+                               "Malformed archive dictionary."));
+  }
+}
+
+void archive_dictionary::save(serialization2::compact_output_archive<>& archive)
+{
+  merge();
+  archive << _ids << _types << _flags << _offsets << _sizes << _raw_sizes;
+}
+
+std::size_t archive_dictionary::lower_bound(resource_id id) const
+{
+  if (_ids.empty())
+    return 0;
+
+  // The loop compiles to conditional moves, which avoids branch mispredictions
+  // on random lookups.
+  const auto* base = _ids.data();
+  auto count = _ids.size();
+  while (count > 1)
+  {
+    auto half = count / 2;
+    base = base[half] < id ? base + half : base;
+    count -= half;
+  }
+  return static_cast<std::size_t>(base - _ids.data()) + (*base < id ? 1 : 0);
+}
+
+archive_entry archive_dictionary::entry_at(std::size_t index) const
+{
+  return archive_entry{_ids[index],     _types[index], _flags[index],
+                       _offsets[index], _sizes[index], _raw_sizes[index]};
+}
+
+void archive_dictionary::push_back(const archive_entry& entry)
+{
+  _ids.push_back(entry.id);
+  _types.push_back(entry.type);
+  _flags.push_back(entry.flags);
+  _offsets.push_back(entry.offset);
+  _sizes.push_back(entry.size);
+  _raw_sizes.push_back(entry.raw_size);
+}
+
+void archive_dictionary::merge()
+{
+  if (_pending.empty())
+    return;
+
+  std::vector<archive_entry> entries;
+  entries.reserve(size());
+  for_each([&](const archive_entry& entry) { entries.push_back(entry); });
+  clear();
+  for (const auto& entry : entries)
+    push_back(entry);
+}
+
+void archive_dictionary::update_type_index() const
+{
+  std::lock_guard lock(_type_index_mutex);
+  if (_type_index_valid)
+    return;
+
+  _type_index.clear();
+  _type_index.reserve(size());
+  for_each([&](const archive_entry& entry) {
+    _type_index.emplace_back(entry.type, entry.id);
+  });
+  std::sort(_type_index.begin(), _type_index.end());
+  _type_index_valid = true;
+}
+}
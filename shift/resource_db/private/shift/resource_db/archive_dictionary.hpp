@@ -0,0 +1,155 @@
+#ifndef SHIFT_RESOURCE_DB_ARCHIVE_DICTIONARY_HPP
+#define SHIFT_RESOURCE_DB_ARCHIVE_DICTIONARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <shift/core/bit_field.hpp>
+#include "shift/resource_db/resource.hpp"
+
+namespace shift::resource_db
+{
+enum class file_flag : std::uint32_t
+{
+  zlib_compressed = 0b0001,
+  bzip2_compressed = 0b0010,
+  zstd_compressed = 0b0100,
+  lz4_compressed = 0b1000
+};
+
+using file_flags = core::bit_field<file_flag>;
+
+/// The location and encoding of a single resource within an archive file.
+struct archive_entry
+{
+  resource_id id = 0;
+  resource_type type = resource_type::undefined;
+  file_flags flags = file_flags{0};
+  std::uint64_t offset = 0;
+  /// The number of bytes stored in the archive file.
+  std::uint64_t size = 0;
+  /// The size of the serialized resource before compression.
+  std::uint64_t raw_size = 0;
+};
+
+/// The dictionary of an archive, which maps resource ids to entries.
+/// @remarks
+///   Entries are kept sorted by id in one array per field, which are
+///   serialized as single blocks of memory and searched using a branchless
+///   binary search. Entries inserted since the last merge are kept in a small
+///   ordered map, which is merged into the arrays once it grows beyond a
+///   fraction of the dictionary size. Thus read-only archives never touch the
+///   map, while random inserts remain cheap. Const methods may be called
+///   concurrently.
+class archive_dictionary
+{
+public:
+  /// Returns the number of entries.
+  std::size_t size() const
+  {
+    return _ids.size() + _pending.size();
+  }
+
+  /// Returns whether the dictionary contains no entries.
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  /// Returns the entry with the passed id.
+  std::optional<archive_entry> find(resource_id id) const;
+
+  /// Inserts an entry, replacing any existing entry with the same id.
+  void insert_or_assign(const archive_entry& entry);
+
+  /// Removes the entry with the passed id.
+  /// @return
+  ///   False if there is no such entry.
+  bool erase(resource_id id);
+
+  /// Replaces all entries.
+  void assign(std::vector<archive_entry> entries);
+
+  /// Removes all entries.
+  void clear();
+
+  /// Calls function with each entry, ordered by id.
+  template <typename Function>
+  void for_each(Function&& function) const;
+
+  /// Calls function with each entry, ordered by type and id.
+  /// @remarks
+  ///   The type index is built on first use and dropped on the next
+  ///   modification.
+  template <typename Function>
+  void for_each_by_type(Function&& function) const;
+
+  /// Deserializes the dictionary.
+  void load(serialization2::compact_input_archive<>& archive);
+
+  /// Serializes the dictionary, merging pending entries first.
+  void save(serialization2::compact_output_archive<>& archive);
+
+private:
+  /// Returns the index of the first entry in the arrays whose id is not less
+  /// than the passed id.
+  std::size_t lower_bound(resource_id id) const;
+
+  /// Returns the entry at the passed index of the arrays.
+  archive_entry entry_at(std::size_t index) const;
+
+  /// Appends an entry to the arrays.
+  void push_back(const archive_entry& entry);
+
+  /// Merges all pending entries into the arrays.
+  void merge();
+
+  /// Builds _type_index unless it is already valid.
+  void update_type_index() const;
+
+  std::vector<resource_id> _ids;
+  std::vector<resource_type> _types;
+  std::vector<file_flags> _flags;
+  std::vector<std::uint64_t> _offsets;
+  std::vector<std::uint64_t> _sizes;
+  std::vector<std::uint64_t> _raw_sizes;
+
+  /// Entries inserted since the last merge.
+  std::map<resource_id, archive_entry> _pending;
+
+  mutable std::mutex _type_index_mutex;
+  mutable bool _type_index_valid = false;
+  mutable std::vector<std::pair<resource_type, resource_id>> _type_index;
+};
+
+template <typename Function>
+void archive_dictionary::for_each(Function&& function) const
+{
+  auto pending_iter = _pending.begin();
+  for (std::size_t i = 0; i < _ids.size(); ++i)
+  {
+    for (; pending_iter != _pending.end() && pending_iter->first < _ids[i];
+         ++pending_iter)
+    {
+      function(pending_iter->second);
+    }
+    function(entry_at(i));
+  }
+  for (; pending_iter != _pending.end(); ++pending_iter)
+    function(pending_iter->second);
+}
+
+template <typename Function>
+void archive_dictionary::for_each_by_type(Function&& function) const
+{
+  update_type_index();
+  for (const auto& [type, id] : _type_index)
+    function(*find(id));
+}
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "shift/resource_db/archive_maintenance.hpp"
+#include "shift/resource_db/archive.hpp"
+
+namespace shift::resource_db
+{
+archive_report report_archive(const std::filesystem::path& path)
+{
+  using std::chrono::high_resolution_clock;
+
+  archive_report result;
+  archive source{path};
+  if (!source.open(true))
+    return result;
+  result.free_size = source.free_size();
+
+  // Collect the ids of each type separately, so that we can measure the
+  // decode time per type.
+  std::vector<std::vector<resource_id>> ids_by_type;
+  source.dictionary().for_each_by_type([&](const archive_entry& entry) {
+    if (result.types.empty() || result.types.back().type != entry.type)
+    {
+      result.types.emplace_back().type = entry.type;
+      ids_by_type.emplace_back();
+    }
+    auto& report = result.types.back();
+    ids_by_type.back().push_back(entry.id);
+    ++report.entry_count;
+    if (entry.flags & file_flag::zstd_compressed)
+      ++report.zstd_count;
+    if (entry.flags & file_flag::lz4_compressed)
+      ++report.lz4_count;
+    report.stored_size += entry.size;
+    report.raw_size += entry.raw_size;
+  });
+
+  std::vector<char> data;
+  for (std::size_t i = 0; i < result.types.size(); ++i)
+  {
+    auto begin = high_resolution_clock::now();
+    for (auto id : ids_by_type[i])
+      source.read(id, data);
+    result.types[i].decode_time = high_resolution_clock::now() - begin;
+  }
+  return result;
+}
+
+bool compact_archive(const std::filesystem::path& path)
+{
+  archive target{path};
+  return target.open(false) && target.compact();
+}
+}
@@ -1,24 +1,71 @@
 #include "shift/resource_db/buffer.hpp"
 #include <shift/serialization2/all.hpp>
 #include <shift/crypto/sha256.hpp>
+#include <shift/task/parallel.hpp>
+#include <shift/task/this_task.hpp>
+#include <algorithm>
 
 namespace shift::resource_db
 {
-void buffer::load(resource_id id, boost::iostreams::filtering_istream& stream)
+/// Buffers of at least this size are hashed as a tree of chunks.
+static constexpr std::size_t tree_hash_threshold = 4 << 20;
+
+/// The size of each chunk hashed independently by the tree hash.
+static constexpr std::size_t tree_hash_chunk_size = 1 << 20;
+
+void buffer::load(resource_id id,
+                  serialization2::compact_input_archive<>& archive)
 {
   _id = id;
-  serialization2::compact_input_archive<> archive{stream};
   archive >> storage;
 }
 
-void buffer::save(boost::iostreams::filtering_ostream& stream) const
+void buffer::save(serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   archive << storage;
 }
 
+std::size_t buffer::memory_size() const
+{
+  return sizeof(*this) + storage.capacity();
+}
+
 void buffer::hash(crypto::sha256& context) const
 {
-  context << "buffer" << storage;
+  if (storage.size() < tree_hash_threshold)
+  {
+    context << "buffer" << storage;
+    return;
+  }
+
+  // Hash each chunk independently, which lets us spread the work over all
+  // task workers, and hash the list of chunk digests. The separate tag
+  // distinguishes these ids from those of the plain hash used for smaller
+  // buffers.
+  auto chunk_count =
+    (storage.size() + tree_hash_chunk_size - 1) / tree_hash_chunk_size;
+  std::vector<crypto::sha256::digest_t> chunk_digests(chunk_count);
+  auto hash_chunk = [&](std::size_t chunk) {
+    auto offset = chunk * tree_hash_chunk_size;
+    auto size = std::min(tree_hash_chunk_size, storage.size() - offset);
+    crypto::sha256 chunk_context(chunk_digests[chunk]);
+    chunk_context(reinterpret_cast<const char*>(storage.data()) + offset,
+                  size);
+    chunk_context.finalize();
+  };
+  if (task::this_task::inside_task())
+    task::parallel_for(std::size_t{0}, chunk_count, hash_chunk, 1);
+  else
+  {
+    for (std::size_t chunk = 0; chunk < chunk_count; ++chunk)
+      hash_chunk(chunk);
+  }
+
+  context << "buffer-tree" << static_cast<std::uint64_t>(storage.size());
+  for (const auto& chunk_digest : chunk_digests)
+  {
+    context(reinterpret_cast<const char*>(chunk_digest.data()),
+            chunk_digest.size());
+  }
 }
 }
@@ -10,15 +10,54 @@
 #include <boost/iostreams/filter/bzip2.hpp>
 #include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/crc.hpp>
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <array>
+#include <mutex>
 
 namespace shift::resource_db
 {
 namespace fs = std::filesystem;
 
-static const std::string index_filename = ".index.json";
+static const std::string index_filename = ".index";
+static const std::string journal_filename = ".index.journal";
+static const std::string json_index_filename = ".index.json";
+
+static constexpr std::array<char, 4> index_magic = {{'R', 'I', 'D', 'X'}};
+static constexpr std::array<char, 4> journal_magic = {{'R', 'J', 'N', 'L'}};
+static constexpr std::uint32_t index_version = 1;
+
+/// The header of binary index files. It is followed by all records sorted by
+/// id, the record indices sorted by path, and the path string table.
+struct index_header
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint64_t record_count;
+  std::uint64_t string_table_size;
+  /// A CRC-32 of all preceding header fields.
+  std::uint32_t checksum;
+  std::uint32_t reserved;
+};
+
+/// The header of journal files.
+struct journal_header
+{
+  std::array<char, 4> magic;
+  /// The checksum of the binary index the journal belongs to.
+  std::uint32_t index_checksum;
+};
+
+static std::uint32_t header_checksum(const index_header& header)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(&header, offsetof(index_header, checksum));
+  return crc.checksum();
+}
 
 filesystem::filesystem(const std::filesystem::path& path) : mountable(path)
 {
@@ -31,8 +70,6 @@ filesystem::~filesystem()
 
 bool filesystem::open(bool read_only)
 {
-  using namespace shift::parser;
-
   _read_only = read_only;
 
   if (!fs::exists(_path))
@@ -51,112 +88,70 @@ bool filesystem::open(bool read_only)
                        << core::path_name_info(_path.generic_string()));
   }
 
-  std::ifstream index_file;
-  index_file.open((_path / index_filename).generic_string(),
-                  std::ios::in | std::ios_base::binary);
-  // Simply ignore any errors from this point on.
-  if (!index_file.is_open())
-    return true;
-
-  json::value root;
-  try
-  {
-    index_file.unsetf(std::ios_base::skipws);
-    index_file >> root;
-    index_file.close();
-  }
-  catch (...)
+  std::unique_lock write_lock(_index_mutex);
+  bool imported = !open_index() && import_json();
+  replay_journal();
+  if (!_read_only)
   {
-    // Ignore any errors during index file reading and parsing.
-    return true;
-  }
-
-  if (json::get_if<json::object>(&root) == nullptr)
-    return true;
-  json::object& root_object = json::get<json::object>(root);
-
-  if (!json::has(root_object, "index"))
-    return true;
-  const auto& index_value = root_object.at("index");
-  const auto* index_object = json::get_if<json::object>(&index_value);
-  if (index_object == nullptr)
-    return true;
-
-  for (const auto& key_object : *index_object)
-  {
-    const auto* index_array = json::get_if<json::array>(&key_object.second);
-    if (index_array == nullptr)
-      continue;
-    for (const auto& value_object : *index_array)
+    // Convert imported indices once, so that subsequent mounts are fast.
+    if (imported)
+      write_index();
+    if (!_journal.is_open())
     {
-      const auto* relative_path = json::get_if<std::string>(&value_object);
-
-      if ((relative_path != nullptr) && fs::exists(_path / *relative_path))
+      auto journal_path = _path / journal_filename;
+      if (fs::exists(journal_path))
       {
-        _index.insert(
-          {static_cast<resource_id>(std::stoull(key_object.first, nullptr, 16)),
-           *relative_path});
+        _journal.open(journal_path.generic_string(),
+                      std::ios_base::out | std::ios_base::binary |
+                        std::ios_base::app);
       }
+      else
+        reset_journal();
     }
   }
-
   return true;
 }
 
 void filesystem::close()
 {
-  using namespace shift::parser;
-
-  std::ofstream file(
-    (_path / index_filename).generic_string(),
-    std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-  if (!file.is_open())
-    return;
-
-  const auto& id_index = _index.get<by_id>();
-  json::object root;
-  auto& index_object = json::get<json::object>(root["index"] = json::object{});
-
-  // auto next = id_index.begin();
-  for (auto first = id_index.begin(), last = id_index.upper_bound(first->id),
-            end = id_index.end();
-       first != end; first = last, last = id_index.upper_bound(first->id))
+  std::unique_lock write_lock(_index_mutex);
+  // Rewrite the index once the journal grew to a quarter of its size.
+  if (!_read_only && _journal_record_count > 0 &&
+      _journal_record_count * 4 >= _record_count)
   {
-    std::stringstream id_value;
-    id_value << std::hex << std::setw(16) << std::setfill('0') << first->id;
-    auto& entry_array =
-      json::get<json::array>(index_object[id_value.str()] = json::array{});
-
-    for (auto iter = first; iter != last; ++iter)
-      entry_array.emplace_back(iter->generic_path);
+    write_index();
   }
-
-  file << core::indent_character(' ') << core::indent_width(2);
-  file << root;
-  file.close();
+  _journal.close();
+  _journal_record_count = 0;
+  _index_file.close();
+  _index_copy.clear();
+  _records = nullptr;
+  _path_order = nullptr;
+  _strings = nullptr;
+  _record_count = 0;
+  _index_checksum = 0;
+  _index.clear();
+  _erased_ids.clear();
+  _replaced_paths.clear();
 }
 
 resource_id filesystem::lookup_id(const std::filesystem::path& relative_path)
 {
   std::shared_lock read_lock(_index_mutex);
-  const auto& path_index = _index.get<by_path>();
-  auto index_iter = path_index.find(relative_path.generic_string());
-  if (index_iter != path_index.end())
-    return index_iter->id;
+  resource_id id;
+  if (find_id(relative_path.generic_string(), id))
+    return id;
   return 0;
 }
 
 bool filesystem::load(resource_id id, resource_base& resource,
                       resource_type /*type*/)
 {
-  fs::path relative_path;
+  std::string relative_path;
   {
     std::shared_lock read_lock(_index_mutex);
-    const auto& id_index = _index.get<by_id>();
-    auto index_iter = id_index.find(id);
-    if (index_iter == id_index.end())
+    if (!find_path(id, relative_path))
       return false;
-    relative_path = index_iter->generic_path;
   }
 
   auto filename = _path / relative_path;
@@ -178,7 +173,8 @@ bool filesystem::load(resource_id id, resource_base& resource,
   if (filename.extension().generic_string() == ".bz2")
     stream.push(boost::iostreams::bzip2_decompressor());
   stream.push(std::move(file_source));
-  resource.load(id, stream);
+  serialization2::compact_input_archive<> archive{stream};
+  resource.load(id, archive);
   return true;
 }
 
@@ -192,31 +188,444 @@ bool filesystem::save(const resource_base& resource, resource_type type,
     return false;
   }
 
-  if (save_impl(resource, type, id, relative_path))
-  {
-    std::unique_lock write_lock(_index_mutex);
-    return _index.insert({id, relative_path.generic_string()}).second;
-  }
-  else
+  if (!save_impl(resource, type, id, relative_path))
     return false;
+  return insert(id, relative_path);
+}
+
+bool filesystem::insert(resource_id id,
+                        const std::filesystem::path& relative_path)
+{
+  if (_read_only)
+    return false;
+
+  auto generic_path = relative_path.generic_string();
+  std::unique_lock write_lock(_index_mutex);
+  resource_id existing_id;
+  if (find_id(generic_path, existing_id) && existing_id == id)
+    return true;
+  append_journal(journal_operation::insert, id, generic_path);
+  apply(journal_operation::insert, id, generic_path);
+  return true;
 }
 
 void filesystem::erase(resource_id id)
 {
+  std::unique_lock write_lock(_index_mutex);
+  std::string generic_path;
+  if (!find_path(id, generic_path))
+    return;
+
+  std::error_code error_code;
+  for (auto [entry_iter, entries_end] = _index.get<by_id>().equal_range(id);
+       entry_iter != entries_end; ++entry_iter)
+  {
+    fs::remove(_path / entry_iter->generic_path, error_code);
+  }
+  auto* records_end = _records + _record_count;
+  for (auto* record = std::lower_bound(
+         _records, records_end, id,
+         [](const index_record& record, resource_id id) {
+           return record.id < id;
+         });
+       record != records_end && record->id == id; ++record)
+  {
+    if (!is_stale(*record))
+      fs::remove(_path / record_path(*record), error_code);
+  }
+
+  if (!_read_only)
+  {
+    append_journal(journal_operation::erase, id, {});
+    apply(journal_operation::erase, id, {});
+  }
+}
+
+bool filesystem::locate(resource_id id, std::uint64_t& position)
+{
+  // Each resource is stored in a separate file, so there is no meaningful
+  // order.
+  std::shared_lock read_lock(_index_mutex);
+  std::string generic_path;
+  position = 0;
+  return find_path(id, generic_path);
+}
+
+bool filesystem::export_json(const std::filesystem::path& filename)
+{
+  using namespace shift::parser;
+
+  std::ofstream file(filename.generic_string(), std::ios_base::out |
+                                                  std::ios_base::binary |
+                                                  std::ios_base::trunc);
+  if (!file.is_open())
+    return false;
+
+  json::object root;
+  auto& index_object = json::get<json::object>(root["index"] = json::object{});
   {
     std::shared_lock read_lock(_index_mutex);
-    const auto& id_index = _index.get<by_id>();
-    auto index_iter = id_index.find(id);
-    if (index_iter != id_index.end())
+    for_each_entry([&](resource_id id, std::string_view generic_path) {
+      std::stringstream id_value;
+      id_value << std::hex << std::setw(16) << std::setfill('0') << id;
+      auto [entry_iter, inserted] =
+        index_object.try_emplace(id_value.str(), json::array{});
+      json::get<json::array>(entry_iter->second)
+        .emplace_back(std::string{generic_path});
+    });
+  }
+
+  file << core::indent_character(' ') << core::indent_width(2);
+  file << root;
+  return static_cast<bool>(file);
+}
+
+bool filesystem::open_index()
+{
+  if (!_index_file.open(_path / index_filename))
+    return false;
+
+  const std::byte* data = _index_file.data();
+  if (!_index_file.is_mapped())
+  {
+    _index_copy.resize(static_cast<std::size_t>(_index_file.size()));
+    if (!_index_file.read(0, _index_copy.data(), _index_copy.size()))
     {
-      auto absolute_path = _path / index_iter->generic_path;
-      if (fs::exists(absolute_path))
-      {
-        std::error_code error_code;
-        fs::remove(absolute_path, error_code);
-      }
+      _index_file.close();
+      _index_copy.clear();
+      return false;
     }
+    data = _index_copy.data();
+  }
+
+  index_header header;
+  if (_index_file.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+  auto records_size = header.record_count * sizeof(index_record);
+  auto path_order_size = header.record_count * sizeof(std::uint32_t);
+  if (header.magic != index_magic || header.version != index_version ||
+      header.checksum != header_checksum(header) ||
+      _index_file.size() != sizeof(header) + records_size + path_order_size +
+                              header.string_table_size)
+  {
+    _index_file.close();
+    _index_copy.clear();
+    return false;
   }
+
+  data += sizeof(header);
+  _records = reinterpret_cast<const index_record*>(data);
+  _path_order = reinterpret_cast<const std::uint32_t*>(data + records_size);
+  _strings = reinterpret_cast<const char*>(data + records_size +
+                                           path_order_size);
+  _record_count = static_cast<std::size_t>(header.record_count);
+  _index_checksum = header.checksum;
+  return true;
+}
+
+bool filesystem::import_json()
+{
+  using namespace shift::parser;
+
+  std::ifstream index_file;
+  index_file.open((_path / json_index_filename).generic_string(),
+                  std::ios::in | std::ios_base::binary);
+  // Simply ignore any errors from this point on.
+  if (!index_file.is_open())
+    return false;
+
+  json::value root;
+  try
+  {
+    index_file.unsetf(std::ios_base::skipws);
+    index_file >> root;
+    index_file.close();
+  }
+  catch (...)
+  {
+    // Ignore any errors during index file reading and parsing.
+    return false;
+  }
+
+  if (json::get_if<json::object>(&root) == nullptr)
+    return false;
+  json::object& root_object = json::get<json::object>(root);
+
+  if (!json::has(root_object, "index"))
+    return false;
+  const auto& index_value = root_object.at("index");
+  const auto* index_object = json::get_if<json::object>(&index_value);
+  if (index_object == nullptr)
+    return false;
+
+  for (const auto& key_object : *index_object)
+  {
+    const auto* index_array = json::get_if<json::array>(&key_object.second);
+    if (index_array == nullptr)
+      continue;
+    auto id =
+      static_cast<resource_id>(std::stoull(key_object.first, nullptr, 16));
+    for (const auto& value_object : *index_array)
+    {
+      if (const auto* relative_path = json::get_if<std::string>(&value_object))
+        apply(journal_operation::insert, id, *relative_path);
+    }
+  }
+  return true;
+}
+
+void filesystem::replay_journal()
+{
+  std::ifstream journal((_path / journal_filename).generic_string(),
+                        std::ios_base::in | std::ios_base::binary);
+  if (!journal.is_open())
+    return;
+
+  journal_header header;
+  if (!journal.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != journal_magic ||
+      header.index_checksum != _index_checksum)
+  {
+    // The journal belongs to a different index file, which happens if
+    // writing the index was interrupted after renaming the index file.
+    journal.close();
+    if (!_read_only)
+      reset_journal();
+    return;
+  }
+
+  std::string generic_path;
+  auto valid_size = static_cast<std::uint64_t>(journal.tellg());
+  for (;;)
+  {
+    journal_operation operation;
+    resource_id id;
+    std::uint32_t path_size;
+    if (!journal.read(reinterpret_cast<char*>(&operation), sizeof(operation)) ||
+        !journal.read(reinterpret_cast<char*>(&id), sizeof(id)) ||
+        !journal.read(reinterpret_cast<char*>(&path_size), sizeof(path_size)))
+    {
+      break;
+    }
+    generic_path.resize(path_size);
+    if (!journal.read(generic_path.data(), path_size))
+      break;
+    apply(operation, id, generic_path);
+    ++_journal_record_count;
+    valid_size += sizeof(operation) + sizeof(id) + sizeof(path_size) +
+                  path_size;
+  }
+  journal.close();
+
+  // Cut off a trailing record which has only been written partially, so that
+  // new records can be appended.
+  auto journal_path = _path / journal_filename;
+  std::error_code error_code;
+  if (!_read_only && fs::file_size(journal_path, error_code) > valid_size)
+    fs::resize_file(journal_path, valid_size, error_code);
+}
+
+void filesystem::reset_journal()
+{
+  _journal.close();
+  _journal.open((_path / journal_filename).generic_string(),
+                std::ios_base::out | std::ios_base::binary |
+                  std::ios_base::trunc);
+  journal_header header;
+  header.magic = journal_magic;
+  header.index_checksum = _index_checksum;
+  _journal.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  _journal.flush();
+  _journal_record_count = 0;
+}
+
+void filesystem::append_journal(journal_operation operation, resource_id id,
+                                std::string_view generic_path)
+{
+  auto path_size = static_cast<std::uint32_t>(generic_path.size());
+  _journal.write(reinterpret_cast<const char*>(&operation), sizeof(operation));
+  _journal.write(reinterpret_cast<const char*>(&id), sizeof(id));
+  _journal.write(reinterpret_cast<const char*>(&path_size), sizeof(path_size));
+  _journal.write(generic_path.data(), path_size);
+  _journal.flush();
+  ++_journal_record_count;
+}
+
+void filesystem::apply(journal_operation operation, resource_id id,
+                       std::string_view generic_path)
+{
+  if (operation == journal_operation::insert)
+  {
+    std::string path{generic_path};
+    auto& path_index = _index.get<by_path>();
+    if (auto entry_iter = path_index.find(path); entry_iter != path_index.end())
+      path_index.replace(entry_iter, index_entry{id, std::move(path)});
+    else
+    {
+      resource_id base_id;
+      if (find_id(path, base_id))
+        _replaced_paths.insert(path);
+      _index.insert(index_entry{id, std::move(path)});
+    }
+  }
+  else if (operation == journal_operation::erase)
+  {
+    _index.get<by_id>().erase(id);
+    _erased_ids.insert(id);
+  }
+}
+
+void filesystem::write_index()
+{
+  // Collect all entries before unmapping the current index.
+  std::vector<std::pair<resource_id, std::string>> entries;
+  entries.reserve(_record_count + _index.size());
+  for_each_entry([&](resource_id id, std::string_view generic_path) {
+    entries.emplace_back(id, std::string{generic_path});
+  });
+  std::sort(entries.begin(), entries.end());
+
+  std::vector<index_record> records;
+  records.reserve(entries.size());
+  std::string strings;
+  for (const auto& [id, generic_path] : entries)
+  {
+    records.push_back(index_record{
+      id, static_cast<std::uint32_t>(strings.size()),
+      static_cast<std::uint32_t>(generic_path.size())});
+    strings += generic_path;
+  }
+  std::vector<std::uint32_t> path_order(records.size());
+  for (std::size_t i = 0; i < path_order.size(); ++i)
+    path_order[i] = static_cast<std::uint32_t>(i);
+  std::sort(path_order.begin(), path_order.end(),
+            [&](std::uint32_t lhs, std::uint32_t rhs) {
+              return entries[lhs].second < entries[rhs].second;
+            });
+
+  index_header header;
+  header.magic = index_magic;
+  header.version = index_version;
+  header.record_count = records.size();
+  header.string_table_size = strings.size();
+  header.checksum = header_checksum(header);
+  header.reserved = 0;
+
+  // Write to a temporary file first, so that the old index stays intact if
+  // anything goes wrong.
+  auto index_path = _path / index_filename;
+  auto temp_path = index_path;
+  temp_path += ".tmp";
+  {
+    std::ofstream file(temp_path.generic_string(), std::ios_base::out |
+                                                     std::ios_base::binary |
+                                                     std::ios_base::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()),
+               static_cast<std::streamsize>(records.size() *
+                                            sizeof(index_record)));
+    file.write(reinterpret_cast<const char*>(path_order.data()),
+               static_cast<std::streamsize>(path_order.size() *
+                                            sizeof(std::uint32_t)));
+    file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    if (!file)
+      return;
+  }
+
+  // The index file has to be unmapped before it can be replaced.
+  _index_file.close();
+  _index_copy.clear();
+  std::error_code error_code;
+  fs::rename(temp_path, index_path, error_code);
+  if (error_code)
+  {
+    fs::remove(temp_path, error_code);
+    // Keep using the old index along with the journal.
+    _record_count = 0;
+    open_index();
+    return;
+  }
+
+  _index.clear();
+  _erased_ids.clear();
+  _replaced_paths.clear();
+  _record_count = 0;
+  if (open_index())
+    reset_journal();
+}
+
+template <typename Function>
+void filesystem::for_each_entry(Function&& function) const
+{
+  for (std::size_t i = 0; i < _record_count; ++i)
+  {
+    if (!is_stale(_records[i]))
+      function(_records[i].id, record_path(_records[i]));
+  }
+  for (const auto& entry : _index)
+    function(entry.id, std::string_view{entry.generic_path});
+}
+
+bool filesystem::find_path(resource_id id, std::string& generic_path) const
+{
+  const auto& id_index = _index.get<by_id>();
+  if (auto index_iter = id_index.find(id); index_iter != id_index.end())
+  {
+    generic_path = index_iter->generic_path;
+    return true;
+  }
+
+  auto* records_end = _records + _record_count;
+  for (auto* record = std::lower_bound(
+         _records, records_end, id,
+         [](const index_record& record, resource_id id) {
+           return record.id < id;
+         });
+       record != records_end && record->id == id; ++record)
+  {
+    if (!is_stale(*record))
+    {
+      generic_path = record_path(*record);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool filesystem::find_id(std::string_view generic_path, resource_id& id) const
+{
+  const auto& path_index = _index.get<by_path>();
+  if (auto index_iter = path_index.find(std::string{generic_path});
+      index_iter != path_index.end())
+  {
+    id = index_iter->id;
+    return true;
+  }
+
+  auto* path_order_end = _path_order + _record_count;
+  auto* order = std::lower_bound(
+    _path_order, path_order_end, generic_path,
+    [&](std::uint32_t index, std::string_view path) {
+      return record_path(_records[index]) < path;
+    });
+  if (order == path_order_end ||
+      record_path(_records[*order]) != generic_path ||
+      is_stale(_records[*order]))
+  {
+    return false;
+  }
+  id = _records[*order].id;
+  return true;
+}
+
+bool filesystem::is_stale(const index_record& record) const
+{
+  if (_erased_ids.empty() && _replaced_paths.empty())
+    return false;
+  return _erased_ids.find(record.id) != _erased_ids.end() ||
+         _replaced_paths.find(std::string{record_path(record)}) !=
+           _replaced_paths.end();
 }
 
 bool filesystem::save_impl(const resource_base& resource,
@@ -228,27 +637,28 @@ bool filesystem::save_impl(const resource_base& resource,
 
   // Check whether a different file with the same id already exists. If so we
   // create a hard link to avoid duplicate data.
+  std::string other_generic_path;
   {
     std::shared_lock read_lock(_index_mutex);
-    const auto& id_index = _index.get<by_id>();
-    auto index_iter = id_index.find(id);
-    if (index_iter != id_index.end())
+    if (!find_path(id, other_generic_path))
+      other_generic_path.clear();
+  }
+  if (!other_generic_path.empty())
+  {
+    auto other_path = _path / other_generic_path;
+    if (absolute_path == other_path)
     {
-      auto other_path = _path / index_iter->generic_path;
-      if (absolute_path == other_path)
-      {
-        if (fs::exists(absolute_path))
-          return true;
-      }
-      else if (fs::exists(other_path))
-      {
-        std::error_code error_code;
-        fs::create_hard_link(other_path, absolute_path, error_code);
-        /// ToDo: What to do if the file already exists? This may happen if only
-        /// the rc db is deleted but output files are still there.
-        // return !error_code;
+      if (fs::exists(absolute_path))
         return true;
-      }
+    }
+    else if (fs::exists(other_path))
+    {
+      std::error_code error_code;
+      fs::create_hard_link(other_path, absolute_path, error_code);
+      /// ToDo: What to do if the file already exists? This may happen if only
+      /// the rc db is deleted but output files are still there.
+      // return !error_code;
+      return true;
     }
   }
 
@@ -264,9 +674,8 @@ bool filesystem::save_impl(const resource_base& resource,
   std::vector<char> buffer;
   // First, store object into a memory buffer.
   {
-    boost::iostreams::filtering_ostream stream;
-    stream.push(boost::iostreams::back_inserter(buffer));
-    resource.save(stream);
+    serialization2::compact_output_archive<> archive{buffer};
+    resource.save(archive);
   }
   //{
   //  // compress the buffer and test whether this yields a smaller size.
@@ -3,11 +3,15 @@
 
 #include <cstdint>
 #include <array>
-#include <unordered_map>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_set>
 #include <fstream>
 #include <shared_mutex>
 #include <filesystem>
 #include <shift/core/bit_field.hpp>
+#include <shift/platform/mapped_file.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -17,7 +21,14 @@
 
 namespace shift::resource_db
 {
-///
+/// A mount point storing each resource in a separate file below a directory.
+/// @remarks
+///   The mapping between resource ids and file paths is kept in a binary
+///   index file, which is memory mapped on open and only rewritten on close
+///   once enough changes have accumulated. All changes in between are
+///   appended to a journal, which is replayed on open. Whether the indexed
+///   files still exist is only checked when loading them. Index files written
+///   in the previous JSON format are imported automatically.
 class filesystem final : public mountable
 {
 public:
@@ -44,10 +55,35 @@ public:
   bool save(const resource_base& resource, resource_type type, resource_id id,
             const std::filesystem::path& relative_path) override;
 
+  ///
+  bool insert(resource_id id,
+              const std::filesystem::path& relative_path) override;
+
   ///
   void erase(resource_id id) override;
 
+  ///
+  bool locate(resource_id id, std::uint64_t& position) override;
+
+  /// Writes all index entries to a JSON file, using the format read by
+  /// previous versions.
+  bool export_json(const std::filesystem::path& filename);
+
 private:
+  /// A single entry of the binary index file.
+  struct index_record
+  {
+    resource_id id;
+    std::uint32_t path_offset;
+    std::uint32_t path_size;
+  };
+
+  enum class journal_operation : std::uint8_t
+  {
+    insert = 1,
+    erase = 2
+  };
+
   struct index_entry
   {
     resource_id id;
@@ -77,9 +113,82 @@ private:
   bool save_impl(const resource_base& resource, resource_type type,
                  resource_id id, const std::filesystem::path& relative_path);
 
-  bool _read_only;
+  /// Maps the binary index file and validates its header.
+  bool open_index();
+
+  /// Reads index entries from a JSON index file.
+  bool import_json();
+
+  /// Applies all valid records from the journal file.
+  void replay_journal();
+
+  /// Creates a new journal file, which belongs to the current binary index.
+  void reset_journal();
+
+  /// Appends a record to the journal file.
+  /// @pre
+  ///   _index_mutex is locked exclusively.
+  void append_journal(journal_operation operation, resource_id id,
+                      std::string_view generic_path);
+
+  /// Applies a journal record to the in-memory index.
+  /// @pre
+  ///   _index_mutex is locked exclusively.
+  void apply(journal_operation operation, resource_id id,
+             std::string_view generic_path);
+
+  /// Rewrites the binary index file containing all entries and resets the
+  /// journal.
+  void write_index();
+
+  /// Calls function with the id and path of each index entry.
+  /// @pre
+  ///   _index_mutex is locked.
+  template <typename Function>
+  void for_each_entry(Function&& function) const;
+
+  /// Returns the path of a file storing the resource with the passed id.
+  /// @pre
+  ///   _index_mutex is locked.
+  bool find_path(resource_id id, std::string& generic_path) const;
+
+  /// Returns the id of the resource stored in the passed file.
+  /// @pre
+  ///   _index_mutex is locked.
+  bool find_id(std::string_view generic_path, resource_id& id) const;
+
+  /// Returns the path of a record of the binary index.
+  std::string_view record_path(const index_record& record) const
+  {
+    return {_strings + record.path_offset, record.path_size};
+  }
+
+  /// Returns whether a record of the binary index has been superseded by the
+  /// journal.
+  bool is_stale(const index_record& record) const;
+
+  bool _read_only = true;
   std::shared_mutex _index_mutex;
+
+  /// The binary index file, whose records are sorted by id.
+  platform::mapped_file _index_file;
+  /// A copy of the binary index in case it cannot be mapped.
+  std::vector<std::byte> _index_copy;
+  const index_record* _records = nullptr;
+  /// Record indices sorted by path.
+  const std::uint32_t* _path_order = nullptr;
+  const char* _strings = nullptr;
+  std::size_t _record_count = 0;
+  std::uint32_t _index_checksum = 0;
+
+  /// Entries added through the journal.
   index_map _index;
+  /// Ids whose records in the binary index have been erased.
+  std::unordered_set<resource_id> _erased_ids;
+  /// Paths whose records in the binary index have been replaced.
+  std::unordered_set<std::string> _replaced_paths;
+  std::ofstream _journal;
+  std::size_t _journal_record_count = 0;
 };
 }
 
@@ -27,19 +27,26 @@ serialization2::compact_output_archive<>& operator<<(
   return archive;
 }
 
-void font::load(resource_id id, boost::iostreams::filtering_istream& stream)
+void font::load(resource_id id,
+                serialization2::compact_input_archive<>& archive)
 {
   _id = id;
-  serialization2::compact_input_archive<> archive{stream};
   archive >> mesh >> ascent >> descent >> line_gap >> glyphs;
 }
 
-void font::save(boost::iostreams::filtering_ostream& stream) const
+void font::save(serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   archive << mesh << ascent << descent << line_gap << glyphs;
 }
 
+std::size_t font::memory_size() const
+{
+  // Approximate the overhead of each map node by four pointers.
+  return sizeof(*this) +
+         glyphs.size() * (sizeof(decltype(glyphs)::value_type) +
+                          4 * sizeof(void*));
+}
+
 void font::hash(crypto::sha256& context) const
 {
   context << "font" << mesh.id() << ascent << descent << line_gap;
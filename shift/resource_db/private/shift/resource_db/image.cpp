@@ -135,19 +135,23 @@ serialization2::compact_output_archive<>& operator<<(
   return archive;
 }
 
-void image::load(resource_id id, boost::iostreams::filtering_istream& stream)
+void image::load(resource_id id,
+                 serialization2::compact_input_archive<>& archive)
 {
   _id = id;
-  serialization2::compact_input_archive<> archive{stream};
   archive >> format >> array_element_count >> face_count >> mipmaps;
 }
 
-void image::save(boost::iostreams::filtering_ostream& stream) const
+void image::save(serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   archive << format << array_element_count << face_count << mipmaps;
 }
 
+std::size_t image::memory_size() const
+{
+  return sizeof(*this) + mipmaps.capacity() * sizeof(mipmap_info);
+}
+
 void image::hash(crypto::sha256& context) const
 {
   context << "image" << format << array_element_count << face_count;
@@ -70,22 +70,32 @@ serialization2::compact_output_archive<>& operator<<(
   return archive;
 }
 
-void material::load(resource_id id, boost::iostreams::filtering_istream& stream)
+void material::load(resource_id id,
+                    serialization2::compact_input_archive<>& archive)
 {
   _id = id;
-  serialization2::compact_input_archive<> archive{stream};
   archive >> albedo_map >> ambient_occlusion_map >> normal_map >> height_map >>
     roughness_map >> metalness_map >> specular_map >> material_parameters;
 }
 
-void material::save(boost::iostreams::filtering_ostream& stream) const
+void material::save(serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   archive << albedo_map << ambient_occlusion_map << normal_map << height_map
           << roughness_map << metalness_map << specular_map
           << material_parameters;
 }
 
+std::size_t material::memory_size() const
+{
+  std::size_t result = sizeof(*this);
+  for (const auto& [name, parameter] : material_parameters)
+  {
+    result += sizeof(decltype(material_parameters)::value_type) +
+              sizeof(void*) + name.capacity();
+  }
+  return result;
+}
+
 void material::hash(crypto::sha256& context) const
 {
   context << albedo_map.first << albedo_map.second
@@ -5,18 +5,23 @@
 
 namespace shift::resource_db
 {
-void material_descriptor::load(resource_id /*id*/,
-                               boost::iostreams::filtering_istream& /*stream*/)
+void material_descriptor::load(
+  resource_id /*id*/, serialization2::compact_input_archive<>& /*archive*/)
 {
   /// ToDo: implement...
 }
 
 void material_descriptor::save(
-  boost::iostreams::filtering_ostream& /*stream*/) const
+  serialization2::compact_output_archive<>& /*archive*/) const
 {
   /// ToDo: implement...
 }
 
+std::size_t material_descriptor::memory_size() const
+{
+  return sizeof(*this);
+}
+
 void material_descriptor::hash(crypto::sha256& context) const
 {
   context << "material_descriptor";  // << storage << stage_inputs;
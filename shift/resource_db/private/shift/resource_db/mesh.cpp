@@ -110,21 +110,27 @@ serialization2::compact_output_archive<>& operator<<(
   return archive;
 }
 
-void mesh::load(resource_id id, boost::iostreams::filtering_istream& stream)
+void mesh::load(resource_id id,
+                serialization2::compact_input_archive<>& archive)
 {
   _id = id;
-  serialization2::compact_input_archive<> archive{stream};
   archive >> vertex_attributes >> index_buffer_view >> index_data_type >>
     sub_meshes >> bounding_box;
 }
 
-void mesh::save(boost::iostreams::filtering_ostream& stream) const
+void mesh::save(serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   archive << vertex_attributes << index_buffer_view << index_data_type
           << sub_meshes << bounding_box;
 }
 
+std::size_t mesh::memory_size() const
+{
+  return sizeof(*this) +
+         vertex_attributes.capacity() * sizeof(vertex_attribute) +
+         sub_meshes.capacity() * sizeof(sub_mesh);
+}
+
 void mesh::hash(crypto::sha256& context) const
 {
   for (const auto& attribute : vertex_attributes)
@@ -37,9 +37,23 @@ public:
                     resource_id id,
                     const std::filesystem::path& relative_path) = 0;
 
+  /// Adds an index entry for a resource file that was written to
+  /// relative_path by other means than save, e.g. restored from a cache.
+  /// @return
+  ///   False if the mount point cannot reference external files.
+  virtual bool insert(resource_id id,
+                      const std::filesystem::path& relative_path) = 0;
+
   ///
   virtual void erase(resource_id id) = 0;
 
+  /// Returns whether the resource is stored in this mount point, and its
+  /// position within the mount point's storage.
+  /// @remarks
+  ///   The position is only used to order batched loads for sequential
+  ///   reads.
+  virtual bool locate(resource_id id, std::uint64_t& position) = 0;
+
   ///
   const std::filesystem::path& path()
   {
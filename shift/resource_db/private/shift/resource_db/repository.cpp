@@ -14,12 +14,17 @@
 #include <shift/core/bit_field.hpp>
 #include <shift/core/exception.hpp>
 #include <shift/core/string_util.hpp>
+#include <shift/task/async.hpp>
+#include <shift/task/this_task.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/device/back_inserter.hpp>
 #include <filesystem>
 #include <map>
 #include <array>
+#include <tuple>
+#include <limits>
+#include <algorithm>
 
 namespace shift::resource_db
 {
@@ -27,6 +32,47 @@ namespace fs = std::filesystem;
 
 thread_local std::stack<mountable*> repository::impl::target_archives;
 
+/// The maximum number of resources loaded sequentially by a single task of
+/// load_all.
+static constexpr std::size_t load_batch_size = 16;
+
+std::shared_ptr<resource_base> repository::impl::cache_shard::cache_resource(
+  resource_id id, std::shared_ptr<resource_base> resource)
+{
+  auto& cached = cache[id];
+  if (auto existing = cached.lock())
+  {
+    // Another thread loaded the same resource in the meantime. Keep the
+    // existing instance to avoid having two copies around.
+    return existing;
+  }
+  cached = resource;
+  if (residents.budget() > 0)
+    residents.insert(id, resource, resource->memory_size());
+  return resource;
+}
+
+std::shared_ptr<resource_base> repository::impl::cache_shard::cached_resource(
+  resource_id id)
+{
+  auto cache_iter = cache.find(id);
+  if (cache_iter == cache.end())
+    return nullptr;
+  auto resource = cache_iter->second.lock();
+  if (!resource)
+  {
+    cache.erase(cache_iter);
+    return nullptr;
+  }
+  ++hits;
+  if (residents.budget() > 0 && !residents.touch(id))
+  {
+    // The resource has been evicted before, but is still in use.
+    residents.insert(id, resource, resource->memory_size());
+  }
+  return resource;
+}
+
 repository::repository() : _impl(std::make_unique<impl>())
 {
   _impl->resource_factory.template register_type<resource_group>(
@@ -102,8 +148,47 @@ void repository::unmount(mountable* handle)
 
 void repository::add(std::shared_ptr<resource_base> resource, resource_id id)
 {
-  std::unique_lock write_lock(_impl->cache_mutex);
-  _impl->cache[id] = resource;
+  auto& shard = _impl->shard(id);
+  std::lock_guard lock(shard.mutex);
+  shard.cache[id] = resource;
+  if (shard.residents.budget() > 0)
+    shard.residents.insert(id, resource, resource->memory_size());
+}
+
+std::size_t repository::residency_budget() const
+{
+  std::size_t budget = 0;
+  for (auto& shard : _impl->cache_shards)
+  {
+    std::lock_guard lock(shard.mutex);
+    budget += shard.residents.budget();
+  }
+  return budget;
+}
+
+void repository::residency_budget(std::size_t budget)
+{
+  // Each shard gets an equal share of the budget.
+  for (auto& shard : _impl->cache_shards)
+  {
+    std::lock_guard lock(shard.mutex);
+    shard.residents.budget(budget / impl::cache_shard_count);
+  }
+}
+
+repository::cache_statistics repository::statistics() const
+{
+  cache_statistics result;
+  for (auto& shard : _impl->cache_shards)
+  {
+    std::lock_guard lock(shard.mutex);
+    result.hits += shard.hits;
+    result.misses += shard.misses;
+    result.evictions += shard.residents.evictions();
+    result.resident_count += shard.residents.size();
+    result.resident_size += shard.residents.memory_size();
+  }
+  return result;
 }
 
 // resource_id repository::query(const std::filesystem::path& name)
@@ -125,6 +210,20 @@ void repository::add(std::shared_ptr<resource_base> resource, resource_id id)
 //  return crypto::reduce<resource_id>(context.finalize());
 //}
 
+resource_id repository::lookup_id(const std::filesystem::path& absolute_path)
+{
+  std::shared_lock mount_read_lock(_impl->mount_point_mutex);
+  for (auto& mount_point : _impl->mount_points)
+  {
+    fs::path relative_path = fs::relative(absolute_path, mount_point->path());
+    if (relative_path.empty() || *relative_path.begin() == "..")
+      continue;
+    if (auto id = mount_point->lookup_id(relative_path))
+      return id;
+  }
+  return 0;
+}
+
 std::pair<std::shared_ptr<resource_base>, resource_id> repository::load(
   const std::filesystem::path& absolute_path, resource_type type)
 {
@@ -137,25 +236,21 @@ std::pair<std::shared_ptr<resource_base>, resource_id> repository::load(
       continue;
     if (auto id = mount_point->lookup_id(relative_path))
     {
+      auto& shard = _impl->shard(id);
       {
         // Check if we already loaded the resource.
-        std::shared_lock cache_read_lock(_impl->cache_mutex);
-        auto cache_iter = _impl->cache.find(id);
-        if (cache_iter != _impl->cache.end())
-        {
-          if (auto cached_resource = cache_iter->second.lock())
-            return {cached_resource, id};
-        }
+        std::lock_guard lock(shard.mutex);
+        if (auto cached_resource = shard.cached_resource(id))
+          return {cached_resource, id};
+        ++shard.misses;
       }
 
       if (mount_point->load(id, *resource, type))
       {
         BOOST_ASSERT(resource->id() == id);
 
-        std::unique_lock write_lock(_impl->cache_mutex);
-        _impl->cache[id] = resource;
-
-        return {resource, id};
+        std::lock_guard lock(shard.mutex);
+        return {shard.cache_resource(id, resource), id};
       }
     }
   }
@@ -165,15 +260,13 @@ std::pair<std::shared_ptr<resource_base>, resource_id> repository::load(
 std::shared_ptr<resource_base> repository::load(resource_id id,
                                                 resource_type type)
 {
+  auto& shard = _impl->shard(id);
   {
     // Check if we already loaded the resource.
-    std::shared_lock read_lock(_impl->cache_mutex);
-    auto cache_iter = _impl->cache.find(id);
-    if (cache_iter != _impl->cache.end())
-    {
-      if (auto cached_resource = cache_iter->second.lock())
-        return cached_resource;
-    }
+    std::lock_guard lock(shard.mutex);
+    if (auto cached_resource = shard.cached_resource(id))
+      return cached_resource;
+    ++shard.misses;
   }
 
   // Load the resource from repository.
@@ -191,10 +284,8 @@ std::shared_ptr<resource_base> repository::load(resource_id id,
             std::to_string(resource->id()) + " != " + std::to_string(id)));
       }
 
-      std::unique_lock write_lock(_impl->cache_mutex);
-      _impl->cache[id] = resource;
-
-      return resource;
+      std::lock_guard lock(shard.mutex);
+      return shard.cache_resource(id, resource);
     }
   }
   SHIFT_THROW_EXCEPTION(core::runtime_error()
@@ -202,35 +293,168 @@ std::shared_ptr<resource_base> repository::load(resource_id id,
   return nullptr;
 }
 
-bool repository::save(const resource_base& resource, resource_type type,
-                      resource_id id,
-                      const std::filesystem::path& absolute_path)
+void repository::load_async(resource_id id, resource_type type,
+                            load_handler handler)
 {
-  namespace fs = std::filesystem;
+  std::vector<load_request> requests;
+  requests.push_back({id, type, std::move(handler)});
+  load_all(std::move(requests));
+}
 
-  mountable* target_mount_point = nullptr;
+void repository::load_all(std::vector<load_request> requests)
+{
+  std::vector<std::pair<load_handler, std::shared_ptr<resource_base>>>
+    cached_requests;
+  std::vector<load_handler> failed_requests;
+  std::vector<std::pair<resource_id, resource_type>> new_loads;
+  // Register all requests in the pending_loads tables. Only the first
+  // request for each id starts a new load, all other ones simply wait for
+  // that load to finish.
+  for (auto& request : requests)
   {
-    std::shared_lock read_lock(_impl->mount_point_mutex);
-    for (const auto& mount_point : _impl->mount_points)
+    auto& shard = _impl->shard(request.id);
+    std::lock_guard lock(shard.mutex);
+    if (auto cached_resource = shard.cached_resource(request.id))
     {
-      const auto& mount_path = mount_point->path();
-      auto mount_path_iter = mount_path.begin();
-      auto file_path_iter = absolute_path.begin();
-      while (mount_path_iter != mount_path.end() &&
-             file_path_iter != absolute_path.end())
+      if (cached_resource->type() == request.type)
       {
-        if (*mount_path_iter != *file_path_iter)
-          break;
-        ++mount_path_iter;
-        ++file_path_iter;
+        cached_requests.emplace_back(std::move(request.handler),
+                                     std::move(cached_resource));
       }
-      if (mount_path_iter == mount_path.end() &&
-          file_path_iter != absolute_path.end())
+      else
+        failed_requests.push_back(std::move(request.handler));
+      continue;
+    }
+
+    auto [pending_iter, inserted] =
+      shard.pending_loads.try_emplace(request.id);
+    auto& pending = pending_iter->second;
+    if (inserted)
+    {
+      pending.type = request.type;
+      new_loads.emplace_back(request.id, request.type);
+    }
+    else if (pending.type != request.type)
+    {
+      failed_requests.push_back(std::move(request.handler));
+      continue;
+    }
+    else
+    {
+      // Sharing a load in flight counts as a cache hit.
+      ++shard.hits;
+    }
+    pending.handlers.push_back(std::move(request.handler));
+  }
+
+  // Call handlers outside of the lock, because they may issue new requests.
+  for (auto& [handler, resource] : cached_requests)
+    handler(resource, nullptr);
+  for (auto& handler : failed_requests)
+  {
+    handler(nullptr, std::make_exception_ptr(core::runtime_error()
+                                             << core::context_info(
+                                                  "Resource type mismatch.")));
+  }
+
+  if (new_loads.empty())
+    return;
+  if (new_loads.size() > 1)
+  {
+    // Sort loads by mount point and by position within each mount point, so
+    // that archives are read sequentially.
+    std::vector<std::tuple<std::size_t, std::uint64_t,
+                           std::pair<resource_id, resource_type>>>
+      sorted_loads;
+    sorted_loads.reserve(new_loads.size());
+    {
+      std::shared_lock read_lock(_impl->mount_point_mutex);
+      for (const auto& new_load : new_loads)
       {
-        target_mount_point = mount_point.get();
-        break;
+        auto mount_point_index = std::numeric_limits<std::size_t>::max();
+        std::uint64_t position = 0;
+        for (std::size_t i = 0; i < _impl->mount_points.size(); ++i)
+        {
+          if (_impl->mount_points[i]->locate(new_load.first, position))
+          {
+            mount_point_index = i;
+            break;
+          }
+        }
+        sorted_loads.emplace_back(mount_point_index, position, new_load);
       }
     }
+    std::sort(sorted_loads.begin(), sorted_loads.end());
+    for (std::size_t i = 0; i < sorted_loads.size(); ++i)
+      new_loads[i] = std::get<2>(sorted_loads[i]);
+  }
+
+  // Tasks can only be spawned from within a task. Otherwise load all
+  // resources right away, so that the handlers are called in any case.
+  if (!task::this_task::inside_task())
+  {
+    for (const auto& [id, type] : new_loads)
+      finish_load(id, type);
+    return;
+  }
+
+  // Split the sorted loads into batches, which are processed in parallel.
+  for (std::size_t first = 0; first < new_loads.size();
+       first += load_batch_size)
+  {
+    auto last = std::min(first + load_batch_size, new_loads.size());
+    std::vector<std::pair<resource_id, resource_type>> batch(
+      new_loads.begin() + static_cast<std::ptrdiff_t>(first),
+      new_loads.begin() + static_cast<std::ptrdiff_t>(last));
+    // Tasks cannot return void. The result is delivered to the handlers
+    // instead, so the returned future is not needed.
+    task::async([this, batch = std::move(batch)]() {
+      for (const auto& [id, type] : batch)
+        finish_load(id, type);
+      return 0;
+    });
+  }
+}
+
+/// Returns the mount point containing absolute_path, or nullptr if there is
+/// none.
+static mountable* find_mount_point(
+  const std::vector<std::unique_ptr<mountable>>& mount_points,
+  const std::filesystem::path& absolute_path)
+{
+  for (const auto& mount_point : mount_points)
+  {
+    const auto& mount_path = mount_point->path();
+    auto mount_path_iter = mount_path.begin();
+    auto file_path_iter = absolute_path.begin();
+    while (mount_path_iter != mount_path.end() &&
+           file_path_iter != absolute_path.end())
+    {
+      if (*mount_path_iter != *file_path_iter)
+        break;
+      ++mount_path_iter;
+      ++file_path_iter;
+    }
+    if (mount_path_iter == mount_path.end() &&
+        file_path_iter != absolute_path.end())
+    {
+      return mount_point.get();
+    }
+  }
+  return nullptr;
+}
+
+bool repository::save(const resource_base& resource, resource_type type,
+                      resource_id id,
+                      const std::filesystem::path& absolute_path)
+{
+  namespace fs = std::filesystem;
+
+  mountable* target_mount_point = nullptr;
+  {
+    std::shared_lock read_lock(_impl->mount_point_mutex);
+    target_mount_point =
+      find_mount_point(_impl->mount_points, absolute_path);
     if (!target_mount_point)
       return false;
   }
@@ -245,4 +469,55 @@ bool repository::save(const resource_base& resource, resource_type type,
 
   return true;
 }
+
+bool repository::insert(resource_id id,
+                        const std::filesystem::path& absolute_path)
+{
+  namespace fs = std::filesystem;
+
+  mountable* target_mount_point = nullptr;
+  {
+    std::shared_lock read_lock(_impl->mount_point_mutex);
+    target_mount_point =
+      find_mount_point(_impl->mount_points, absolute_path);
+    if (!target_mount_point)
+      return false;
+  }
+
+  std::error_code error_code;
+  auto relative_path =
+    fs::relative(absolute_path, target_mount_point->path(), error_code);
+  if (error_code)
+    return false;
+
+  return target_mount_point->insert(id, relative_path);
+}
+
+void repository::finish_load(resource_id id, resource_type type)
+{
+  std::shared_ptr<resource_base> resource;
+  std::exception_ptr error;
+  try
+  {
+    resource = load(id, type);
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  // The resource has been added to the cache by now, so new requests won't
+  // start another load after removing the pending entry.
+  std::vector<load_handler> handlers;
+  {
+    auto& shard = _impl->shard(id);
+    std::lock_guard lock(shard.mutex);
+    auto pending_iter = shard.pending_loads.find(id);
+    BOOST_ASSERT(pending_iter != shard.pending_loads.end());
+    handlers = std::move(pending_iter->second.handlers);
+    shard.pending_loads.erase(pending_iter);
+  }
+  for (auto& handler : handlers)
+    handler(resource, error);
+}
 }
@@ -3,12 +3,15 @@
 
 #include <set>
 #include <stack>
+#include <array>
 #include <unordered_set>
-#include <unordered_map>
+#include <mutex>
 #include <shared_mutex>
 #include <shift/core/abstract_factory.hpp>
+#include <shift/core/hash_table.hpp>
 #include "shift/resource_db/repository.hpp"
 #include "shift/resource_db/mountable.hpp"
+#include "shift/resource_db/resident_set.hpp"
 
 namespace shift::resource_db
 {
@@ -23,8 +26,54 @@ struct repository::impl
 
   resource_factory_t resource_factory;
 
-  std::shared_mutex cache_mutex;
-  std::unordered_map<resource_id, std::weak_ptr<resource_base>> cache;
+  /// All handlers waiting for a single resource load.
+  struct pending_load
+  {
+    resource_type type = resource_type::undefined;
+    std::vector<load_handler> handlers;
+  };
+
+  /// The cache is split into independently locked shards to reduce lock
+  /// contention.
+  struct cache_shard
+  {
+    /// Adds a resource to the cache, unless a different instance with the
+    /// same id is still alive.
+    /// @pre
+    ///   mutex is locked.
+    /// @return
+    ///   The cached instance.
+    std::shared_ptr<resource_base> cache_resource(
+      resource_id id, std::shared_ptr<resource_base> resource);
+
+    /// Returns the cached resource, or nullptr. Counts a cache hit if the
+    /// resource is found.
+    /// @pre
+    ///   mutex is locked.
+    std::shared_ptr<resource_base> cached_resource(resource_id id);
+
+    std::mutex mutex;
+    /// All resources which are still alive.
+    core::hash_table<resource_id, std::weak_ptr<resource_base>> cache;
+    /// Strong references keeping recently used resources alive.
+    resident_set residents;
+    /// Loads currently in flight.
+    core::hash_table<resource_id, pending_load> pending_loads;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+  };
+
+  static constexpr std::size_t cache_shard_count = 16;
+
+  /// Returns the shard responsible for the passed id.
+  cache_shard& shard(resource_id id)
+  {
+    // Resource ids are derived from SHA-256 hashes, so the lowest bits are
+    // distributed well enough.
+    return cache_shards[id % cache_shard_count];
+  }
+
+  std::array<cache_shard, cache_shard_count> cache_shards;
 
   static thread_local std::stack<mountable*> target_archives;
 };
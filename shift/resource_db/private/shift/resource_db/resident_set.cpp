@@ -0,0 +1,70 @@
+#include "shift/resource_db/resident_set.hpp"
+
+namespace shift::resource_db
+{
+void resident_set::budget(std::size_t new_budget)
+{
+  _budget = new_budget;
+  evict(0);
+}
+
+bool resident_set::touch(resource_id id)
+{
+  auto index_iter = _indices.find(id);
+  if (index_iter == _indices.end())
+    return false;
+  _entries[index_iter->second].referenced = true;
+  return true;
+}
+
+void resident_set::insert(resource_id id,
+                          std::shared_ptr<resource_base> resource,
+                          std::size_t size)
+{
+  if (size > _budget || touch(id))
+    return;
+
+  evict(size);
+  // New entries start unreferenced, so that resources which are used only
+  // once are evicted first.
+  _indices.insert_or_assign(id, _entries.size());
+  _entries.push_back(entry{id, std::move(resource), size, false});
+  _memory_size += size;
+}
+
+void resident_set::clear()
+{
+  _entries.clear();
+  _indices.clear();
+  _hand = 0;
+  _memory_size = 0;
+}
+
+void resident_set::evict(std::size_t additional_size)
+{
+  while (!_entries.empty() && _memory_size + additional_size > _budget)
+  {
+    if (_hand >= _entries.size())
+      _hand = 0;
+    auto& victim = _entries[_hand];
+    if (victim.referenced)
+    {
+      // Give the entry a second chance.
+      victim.referenced = false;
+      ++_hand;
+      continue;
+    }
+
+    _memory_size -= victim.size;
+    _indices.erase(victim.id);
+    ++_evictions;
+    // Fill the gap with the last entry, which keeps the clock hand in place.
+    if (_hand + 1 != _entries.size())
+    {
+      victim = std::move(_entries.back());
+      _indices.insert_or_assign(victim.id, _hand);
+    }
+    _entries.pop_back();
+  }
+}
+}
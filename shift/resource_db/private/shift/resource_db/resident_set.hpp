@@ -0,0 +1,85 @@
+#ifndef SHIFT_RESOURCE_DB_RESIDENT_SET_HPP
+#define SHIFT_RESOURCE_DB_RESIDENT_SET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <shift/core/hash_table.hpp>
+#include "shift/resource_db/resource.hpp"
+
+namespace shift::resource_db
+{
+/// A set of strong references keeping recently used resources alive, limited
+/// by the total memory size of all resident resources.
+/// @remarks
+///   Resources are evicted using the CLOCK algorithm, which approximates LRU
+///   using a single reference bit per entry. The class is not thread-safe.
+class resident_set
+{
+public:
+  /// Returns the maximum total memory size of all resident resources.
+  std::size_t budget() const
+  {
+    return _budget;
+  }
+
+  /// Sets the maximum total memory size of all resident resources and evicts
+  /// resources exceeding the new budget. A budget of zero disables the set.
+  void budget(std::size_t new_budget);
+
+  /// Marks the resource as recently used.
+  /// @return
+  ///   False if the resource is not resident.
+  bool touch(resource_id id);
+
+  /// Makes the passed resource resident, evicting other resources if
+  /// necessary.
+  /// @remarks
+  ///   Resources larger than the budget are not made resident.
+  void insert(resource_id id, std::shared_ptr<resource_base> resource,
+              std::size_t size);
+
+  /// Releases all resources.
+  void clear();
+
+  /// Returns the number of resident resources.
+  std::size_t size() const
+  {
+    return _entries.size();
+  }
+
+  /// Returns the total memory size of all resident resources.
+  std::size_t memory_size() const
+  {
+    return _memory_size;
+  }
+
+  /// Returns the number of resources evicted so far.
+  std::uint64_t evictions() const
+  {
+    return _evictions;
+  }
+
+private:
+  struct entry
+  {
+    resource_id id;
+    std::shared_ptr<resource_base> resource;
+    std::size_t size;
+    bool referenced;
+  };
+
+  /// Evicts resources until additional_size more bytes fit into the budget.
+  void evict(std::size_t additional_size);
+
+  std::vector<entry> _entries;
+  core::hash_table<resource_id, std::size_t> _indices;
+  std::size_t _hand = 0;
+  std::size_t _budget = 0;
+  std::size_t _memory_size = 0;
+  std::uint64_t _evictions = 0;
+};
+}
+
+#endif
@@ -14,15 +14,23 @@ resource_type resource_base::type() const
 
 resource_id resource_base::id() const
 {
-  if (_id == 0)
+  auto result = _id.load(std::memory_order_relaxed);
+  if (result == 0)
   {
     crypto::sha256::digest_t digest{};
     crypto::sha256 context(digest);
     hash(context);
-    return crypto::reduce<resource_id>(context.finalize());
+    result = crypto::reduce<resource_id>(context.finalize());
+    // Concurrent calls compute the same value, so there is no need to
+    // synchronize the computation itself.
+    _id.store(result, std::memory_order_relaxed);
   }
-  else
-    return _id;
+  return result;
+}
+
+void resource_base::invalidate_id()
+{
+  _id.store(0, std::memory_order_relaxed);
 }
 
 crypto::sha256& operator<<(crypto::sha256& context,
@@ -35,4 +43,17 @@ crypto::sha256& operator<<(crypto::sha256& context,
 resource_base::resource_base(resource_type type) : _type(type)
 {
 }
+
+resource_base::resource_base(const resource_base& other) noexcept
+: _type(other._type), _id(other._id.load(std::memory_order_relaxed))
+{
+}
+
+resource_base& resource_base::operator=(const resource_base& other) noexcept
+{
+  _type = other._type;
+  _id.store(other._id.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+  return *this;
+}
 }
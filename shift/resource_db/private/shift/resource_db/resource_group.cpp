@@ -9,21 +9,20 @@
 namespace shift::resource_db
 {
 void resource_group::load(resource_id id,
-                          boost::iostreams::filtering_istream& stream)
+                          serialization2::compact_input_archive<>& archive)
 {
   _id = id;
 
   auto& repository = resource_db::repository::singleton_instance();
   std::uint32_t object_count;
 
-  serialization2::compact_input_archive<> archive{stream};
   archive >> object_count;
   for (images.reserve(object_count); object_count > 0; --object_count)
   {
     resource_id image_id;
     auto new_image = std::make_shared<image>();
     archive >> image_id;
-    new_image->load(image_id, stream);
+    new_image->load(image_id, archive);
     repository.add(new_image, image_id);
     images.emplace_back(std::move(new_image), image_id);
   }
@@ -34,30 +33,37 @@ void resource_group::load(resource_id id,
     resource_id mesh_id;
     auto new_mesh = std::make_shared<mesh>();
     archive >> mesh_id;
-    new_mesh->load(mesh_id, stream);
+    new_mesh->load(mesh_id, archive);
     repository.add(new_mesh, mesh_id);
     meshes.emplace_back(std::move(new_mesh), mesh_id);
   }
 }
 
-void resource_group::save(boost::iostreams::filtering_ostream& stream) const
+void resource_group::save(
+  serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   archive << static_cast<std::uint32_t>(images.size());
   for (const auto& image : images)
   {
     archive << image.id();
-    image.get_shared()->save(stream);
+    image.get_shared()->save(archive);
   }
 
   archive << static_cast<std::uint32_t>(meshes.size());
   for (const auto& mesh : meshes)
   {
     archive << mesh.id();
-    mesh.get_shared()->save(stream);
+    mesh.get_shared()->save(archive);
   }
 }
 
+std::size_t resource_group::memory_size() const
+{
+  // Images and meshes are cached separately.
+  return sizeof(*this) + images.capacity() * sizeof(resource_ptr<image>) +
+         meshes.capacity() * sizeof(resource_ptr<mesh>);
+}
+
 void resource_group::hash(crypto::sha256& context) const
 {
   context << "resource_group";
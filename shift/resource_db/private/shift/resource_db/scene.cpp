@@ -27,10 +27,10 @@ crypto::sha256& operator<<(crypto::sha256& context, const scene_node& node)
   return context;
 }
 
-void scene::load(resource_id id, boost::iostreams::filtering_istream& stream)
+void scene::load(resource_id id,
+                 serialization2::compact_input_archive<>& archive)
 {
   _id = id;
-  serialization2::compact_input_archive<> archive{stream};
   std::uint32_t num_nodes;
   archive >> num_nodes;
   nodes.resize(num_nodes);
@@ -57,9 +57,8 @@ void scene::load(resource_id id, boost::iostreams::filtering_istream& stream)
   root = index < nodes.size() ? nodes[index].get() : nullptr;
 }
 
-void scene::save(boost::iostreams::filtering_ostream& stream) const
+void scene::save(serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   auto num_nodes = static_cast<std::uint32_t>(nodes.size());
   archive << num_nodes;
   for (const auto& node : nodes)
@@ -96,6 +95,18 @@ void scene::save(boost::iostreams::filtering_ostream& stream) const
   BOOST_ASSERT(index < nodes.size());
 }
 
+std::size_t scene::memory_size() const
+{
+  std::size_t result =
+    sizeof(*this) + nodes.capacity() * sizeof(std::unique_ptr<scene_node>);
+  for (const auto& node : nodes)
+  {
+    result +=
+      sizeof(scene_node) + node->children.capacity() * sizeof(scene_node*);
+  }
+  return result;
+}
+
 void scene::hash(crypto::sha256& context) const
 {
   for (const auto& node : nodes)
@@ -30,19 +30,25 @@ crypto::sha256& operator<<(crypto::sha256& context,
   return context;
 }
 
-void shader::load(resource_id id, boost::iostreams::filtering_istream& stream)
+void shader::load(resource_id id,
+                  serialization2::compact_input_archive<>& archive)
 {
   _id = id;
-  serialization2::compact_input_archive<> archive{stream};
   archive >> storage >> stage_inputs >> stage_outputs;
 }
 
-void shader::save(boost::iostreams::filtering_ostream& stream) const
+void shader::save(serialization2::compact_output_archive<>& archive) const
 {
-  serialization2::compact_output_archive<> archive{stream};
   archive << storage << stage_inputs << stage_outputs;
 }
 
+std::size_t shader::memory_size() const
+{
+  return sizeof(*this) + storage.capacity() * sizeof(std::uint32_t) +
+         (stage_inputs.capacity() + stage_outputs.capacity()) *
+           sizeof(stage_binding);
+}
+
 void shader::hash(crypto::sha256& context) const
 {
   context << "shader" << storage << stage_inputs << stage_outputs;
@@ -0,0 +1,47 @@
+#ifndef SHIFT_RESOURCE_DB_ARCHIVE_MAINTENANCE_HPP
+#define SHIFT_RESOURCE_DB_ARCHIVE_MAINTENANCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <filesystem>
+#include "shift/resource_db/resource.hpp"
+
+namespace shift::resource_db
+{
+/// Storage statistics of all archive entries of a single resource type.
+struct archive_type_report
+{
+  resource_type type = resource_type::undefined;
+  std::size_t entry_count = 0;
+  std::size_t zstd_count = 0;
+  std::size_t lz4_count = 0;
+  /// The number of bytes stored in the archive file.
+  std::uint64_t stored_size = 0;
+  /// The size of all serialized resources before compression.
+  std::uint64_t raw_size = 0;
+  /// The time it took to decompress all entries.
+  std::chrono::nanoseconds decode_time{0};
+};
+
+/// Summary of an archive's storage statistics.
+struct archive_report
+{
+  /// Statistics for each resource type present in the archive, ordered by
+  /// type.
+  std::vector<archive_type_report> types;
+  /// The total size of unused storage within the archive file.
+  std::uint64_t free_size = 0;
+};
+
+/// Opens the archive at path read-only, collects storage statistics, and
+/// measures the decode speed by decompressing each entry once.
+archive_report report_archive(const std::filesystem::path& path);
+
+/// Rewrites the archive at path without any free space.
+/// @see archive::compact.
+bool compact_archive(const std::filesystem::path& path);
+}
+
+#endif
@@ -23,10 +23,14 @@ public:
   }
 
   /// @see resource_base::load.
-  void load(resource_id id, boost::iostreams::filtering_istream& stream) final;
+  void load(resource_id id,
+            serialization2::compact_input_archive<>& archive) final;
 
   /// @see resource_base::save.
-  void save(boost::iostreams::filtering_ostream& stream) const final;
+  void save(serialization2::compact_output_archive<>& archive) const final;
+
+  /// @see resource_base::memory_size.
+  std::size_t memory_size() const final;
 
 public:
   std::vector<std::byte> storage;
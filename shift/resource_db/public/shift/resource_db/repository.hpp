@@ -5,8 +5,13 @@
 #include <memory>
 #include <stack>
 #include <chrono>
+#include <vector>
+#include <functional>
+#include <exception>
 #include <filesystem>
 #include <shift/core/singleton.hpp>
+#include <shift/task/future.hpp>
+#include <shift/task/promise.hpp>
 #include "shift/resource_db/resource.hpp"
 #include "shift/resource_db/resource_ptr.hpp"
 
@@ -18,6 +23,34 @@ class mountable;
 class repository : public core::singleton<repository, core::create::on_stack>
 {
 public:
+  /// Called once an asynchronous load finished, passing either the loaded
+  /// resource or the exception thrown while loading it.
+  using load_handler = std::function<void(
+    const std::shared_ptr<resource_base>& resource, std::exception_ptr error)>;
+
+  /// Counters describing the efficiency of the resource cache.
+  struct cache_statistics
+  {
+    /// The number of requests served from the cache.
+    std::uint64_t hits = 0;
+    /// The number of requests which required loading a resource.
+    std::uint64_t misses = 0;
+    /// The number of resources evicted from the resident set.
+    std::uint64_t evictions = 0;
+    /// The number of resident resources.
+    std::size_t resident_count = 0;
+    /// The total memory size of all resident resources.
+    std::size_t resident_size = 0;
+  };
+
+  /// A single request passed to load_all.
+  struct load_request
+  {
+    resource_id id;
+    resource_type type;
+    load_handler handler;
+  };
+
   /// Default constructor.
   repository();
 
@@ -33,6 +66,19 @@ public:
   /// Manually add a resource to the cache
   void add(std::shared_ptr<resource_base> resource, resource_id id);
 
+  /// Returns the memory budget for keeping recently used resources alive.
+  std::size_t residency_budget() const;
+
+  /// Keeps recently used resources alive until their total memory size
+  /// exceeds the passed budget in bytes, so that they need not be loaded
+  /// again once the last resource_ptr has been released.
+  /// @remarks
+  ///   The default budget of zero disables the residency cache.
+  void residency_budget(std::size_t budget);
+
+  /// Returns the cache counters summed over all cache shards.
+  cache_statistics statistics() const;
+
   /// Returns the resource identified by path.
   /// @return
   ///   A new default created object is returned if either the resource
@@ -61,15 +107,61 @@ public:
   template <typename Resource>
   resource_ptr<Resource> load(resource_id id)
   {
-    if (auto resource = load(id, resource_traits<Resource>::type_id).first)
+    if (auto resource = load(id, resource_traits<Resource>::type_id))
     {
       // We do have the strong guarantee, that the object returned by load is
       // infact of type Resource.
-      return {std::static_pointer_cast<Resource>(resource), id};
+      return resource_ptr<Resource>{
+        std::static_pointer_cast<Resource>(resource), id};
     }
     return {};
   }
 
+  /// Loads the resource identified by id using the task system.
+  /// @remarks
+  ///   Concurrent requests for the same id share a single load. When called
+  ///   from outside of a task the resource is loaded synchronously, and the
+  ///   returned future is ready.
+  /// @return
+  ///   A future which either holds the loaded resource, or the exception
+  ///   thrown by load(resource_id, resource_type).
+  template <typename Resource>
+  task::future<resource_ptr<Resource>> load_async(resource_id id)
+  {
+    auto result = std::make_shared<task::promise<resource_ptr<Resource>>>();
+    auto future = result->get_future();
+    load_async(id, resource_traits<Resource>::type_id,
+               make_load_handler<Resource>(std::move(result), id));
+    return future;
+  }
+
+  /// Loads a batch of resources using the task system.
+  /// @remarks
+  ///   Requests are ordered by their location within the mounted archives to
+  ///   read files sequentially. When called from outside of a task all
+  ///   resources are loaded synchronously, and the returned futures are
+  ///   ready.
+  /// @return
+  ///   One future per passed id, in the same order.
+  template <typename Resource>
+  std::vector<task::future<resource_ptr<Resource>>> load_all(
+    const std::vector<resource_id>& ids)
+  {
+    std::vector<task::future<resource_ptr<Resource>>> futures;
+    std::vector<load_request> requests;
+    futures.reserve(ids.size());
+    requests.reserve(ids.size());
+    for (auto id : ids)
+    {
+      auto result = std::make_shared<task::promise<resource_ptr<Resource>>>();
+      futures.push_back(result->get_future());
+      requests.push_back({id, resource_traits<Resource>::type_id,
+                          make_load_handler<Resource>(std::move(result), id)});
+    }
+    load_all(std::move(requests));
+    return futures;
+  }
+
   template <typename Resource>
   bool save(resource_ptr<Resource>& resource,
             const std::filesystem::path& absolute_path)
@@ -78,6 +170,10 @@ public:
                 resource.id(), absolute_path);
   }
 
+  /// Returns the id of the resource stored at absolute_path, or zero if no
+  /// mount point knows the path.
+  resource_id lookup_id(const std::filesystem::path& absolute_path);
+
   /// Implementation for load<Resource>(const std::filesystem::path&) method.
   std::pair<std::shared_ptr<resource_base>, resource_id> load(
     const std::filesystem::path& absolute_path, resource_type type);
@@ -85,11 +181,50 @@ public:
   /// Implementation for load<Resource>(resource_id) method.
   std::shared_ptr<resource_base> load(resource_id id, resource_type type);
 
+  /// Implementation for load_async<Resource>(resource_id) method.
+  /// @remarks
+  ///   The handler is called right away if the resource is already cached.
+  void load_async(resource_id id, resource_type type, load_handler handler);
+
+  /// Implementation for load_all<Resource>(const std::vector<resource_id>&)
+  /// method.
+  void load_all(std::vector<load_request> requests);
+
   ///
   bool save(const resource_base& resource, resource_type type, resource_id id,
             const std::filesystem::path& absolute_path);
 
+  /// Registers the id of a resource file that was written to absolute_path
+  /// without calling save, e.g. when restoring it from a cache.
+  /// @return
+  ///   False if no writable mount point contains absolute_path.
+  bool insert(resource_id id, const std::filesystem::path& absolute_path);
+
 private:
+  /// Returns a handler fulfilling the passed promise.
+  template <typename Resource>
+  static load_handler make_load_handler(
+    std::shared_ptr<task::promise<resource_ptr<Resource>>> result,
+    resource_id id)
+  {
+    return [result = std::move(result), id](
+             const std::shared_ptr<resource_base>& resource,
+             std::exception_ptr error) {
+      if (error)
+        result->set_exception(error);
+      else
+      {
+        // The resource type has been checked by load_all.
+        result->set_value(resource_ptr<Resource>{
+          std::static_pointer_cast<Resource>(resource), id});
+      }
+    };
+  }
+
+  /// Loads the resource on behalf of all requests registered in
+  /// impl::pending_loads.
+  void finish_load(resource_id id, resource_type type);
+
   struct impl;
   std::unique_ptr<impl> _impl;
 };
@@ -1,11 +1,10 @@
 #ifndef SHIFT_RESOURCE_DB_RESOURCE_HPP
 #define SHIFT_RESOURCE_DB_RESOURCE_HPP
 
+#include <cstddef>
 #include <cstdint>
-#include <istream>
-#include <ostream>
+#include <atomic>
 #include <shift/serialization2/types.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
 
 namespace shift::crypto
 {
@@ -40,15 +39,33 @@ public:
   ///
   resource_type type() const;
 
-  ///
+  /// Returns the resource's id, which is derived from a hash of its contents.
+  /// @remarks
+  ///   The id is computed on first use and cached afterwards, so call
+  ///   invalidate_id after modifying a resource whose id has already been
+  ///   used.
   resource_id id() const;
 
-  ///
+  /// Discards the cached id, so that the next call to id() recomputes it.
+  void invalidate_id();
+
+  /// Deserializes the resource from the passed archive.
+  /// @remarks
+  ///   Archives may either wrap a stream or a plain memory buffer, which
+  ///   allows repositories to deserialize resources straight from memory
+  ///   mapped files.
   virtual void load(resource_id id,
-                    boost::iostreams::filtering_istream& stream) = 0;
+                    serialization2::compact_input_archive<>& archive) = 0;
 
-  ///
-  virtual void save(boost::iostreams::filtering_ostream& stream) const = 0;
+  /// Serializes the resource to the passed archive.
+  virtual void save(
+    serialization2::compact_output_archive<>& archive) const = 0;
+
+  /// Returns the approximate amount of memory used by this resource in bytes.
+  /// @remarks
+  ///   Resources referenced through resource_ptr are not included, because
+  ///   they are cached separately.
+  virtual std::size_t memory_size() const = 0;
 
   ///
   friend crypto::sha256& operator<<(crypto::sha256& context,
@@ -58,12 +75,20 @@ protected:
   /// Constructor.
   resource_base(resource_type type);
 
+  /// Copy constructor.
+  resource_base(const resource_base& other) noexcept;
+
+  /// Copy assignment operator.
+  resource_base& operator=(const resource_base& other) noexcept;
+
   ///
   virtual void hash(crypto::sha256& context) const = 0;
 
 protected:
   resource_type _type;
-  resource_id _id = 0;
+  /// Either the id the resource was loaded with, or the cached result of
+  /// id().
+  mutable std::atomic<resource_id> _id{0};
 };
 }
 
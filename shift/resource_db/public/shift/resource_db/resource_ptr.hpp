@@ -44,7 +44,8 @@ public:
   explicit resource_ptr(std::shared_ptr<T>&& resource)
   : _resource(std::move(resource))
   {
-    update_id();
+    if (_resource)
+      _id = _resource->id();
   }
 
   /// Copy constructor.
@@ -81,8 +82,7 @@ public:
   resource_ptr& operator=(std::shared_ptr<T>& resource)
   {
     _resource = resource;
-    _id = 0;
-    update_id();
+    _id = _resource ? _resource->id() : 0;
     return *this;
   }
 
@@ -184,11 +184,15 @@ public:
     _resource.reset();
   }
 
-  ///
+  /// Recomputes the id of the referenced resource, which has to be called
+  /// after modifying it.
   resource_id update_id()
   {
     if (_resource)
+    {
+      _resource->invalidate_id();
       _id = _resource->id();
+    }
     return _id;
   }
 
@@ -0,0 +1,527 @@
+#include "shift/resource_db/archive.hpp"
+#include <shift/resource_db/archive_maintenance.hpp>
+#include <shift/resource_db/buffer.hpp>
+#include <shift/serialization2/all.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <filesystem>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::resource_db;
+
+namespace
+{
+constexpr std::size_t entry_count = 4096;
+constexpr std::size_t thread_count = 32;
+
+/// Each entry is filled with a pattern depending on its id, with sizes
+/// ranging from 256 bytes to 64KiB.
+std::size_t entry_size(resource_id id)
+{
+  return 256u << (id % 9);
+}
+
+std::byte entry_byte(resource_id id, std::size_t index)
+{
+  return static_cast<std::byte>((id * 31 + index) & 0xFF);
+}
+
+/// Writes entry_count buffers to a new archive at path and returns the total
+/// payload size.
+std::size_t write_archive(const std::filesystem::path& path)
+{
+  std::filesystem::remove(path);
+  resource_db::archive writer{path};
+  BOOST_REQUIRE(writer.open(false));
+
+  std::size_t total_size = 0;
+  for (resource_id id = 1; id <= entry_count; ++id)
+  {
+    buffer entry;
+    entry.storage.resize(entry_size(id));
+    for (std::size_t i = 0; i < entry.storage.size(); ++i)
+      entry.storage[i] = entry_byte(id, i);
+    BOOST_CHECK(writer.save(entry, resource_type::buffer, id, {}));
+    total_size += entry.storage.size();
+  }
+  writer.close();
+  return total_size;
+}
+
+/// An archive entry as written by the first version of the archive format.
+struct archive_entry_v1
+{
+  resource_id id;
+  resource_type type;
+  file_flags flags;
+  std::uint64_t offset;
+  std::uint64_t size;
+};
+
+serialization2::compact_output_archive<>& operator<<(
+  serialization2::compact_output_archive<>& archive,
+  const archive_entry_v1& entry)
+{
+  archive << entry.id << entry.type << entry.flags << entry.offset
+          << entry.size;
+  return archive;
+}
+
+std::vector<char> read_file(const std::filesystem::path& path)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  return {std::istreambuf_iterator<char>{file},
+          std::istreambuf_iterator<char>{}};
+}
+
+/// Writes an archive in the first version of the archive format, whose
+/// header lacks the version field and whose dictionary is zlib compressed.
+void write_archive_v1(const std::filesystem::path& path)
+{
+  std::vector<char> data;
+  std::vector<archive_entry_v1> entries;
+  for (resource_id id = 1; id <= 2; ++id)
+  {
+    buffer entry;
+    entry.storage.resize(entry_size(id));
+    for (std::size_t i = 0; i < entry.storage.size(); ++i)
+      entry.storage[i] = entry_byte(id, i);
+
+    auto offset = data.size();
+    {
+      serialization2::compact_output_archive<> archive{data};
+      entry.save(archive);
+    }
+    entries.push_back({id, resource_type::buffer, file_flags{0}, offset,
+                       data.size() - offset});
+  }
+
+  std::vector<char> dictionary;
+  {
+    boost::iostreams::filtering_ostream stream;
+    stream.push(boost::iostreams::zlib_compressor());
+    stream.push(boost::iostreams::back_inserter(dictionary));
+    std::vector<named_resource> names = {{2, "second", 0}};
+    serialization2::compact_output_archive<> archive{stream};
+    archive << entries << names;
+  }
+
+  archive_header header{};
+  header.magic = {{'R', 'E', 'P', 'O'}};
+  header.header_size = offsetof(archive_header, version);
+  header.data_size = data.size();
+  header.dictionary_size = dictionary.size();
+  std::ofstream file(path, std::ios_base::out | std::ios_base::binary |
+                             std::ios_base::trunc);
+  file.write(reinterpret_cast<const char*>(&header), header.header_size);
+  file.write(data.data(), static_cast<std::streamsize>(data.size()));
+  file.write(dictionary.data(),
+             static_cast<std::streamsize>(dictionary.size()));
+}
+
+/// Checks that the archive contains exactly the entries written by
+/// write_archive_v1, plus the passed number of additional entries.
+void check_archive_v1(resource_db::archive& reader,
+                      std::size_t additional_count = 0)
+{
+  BOOST_CHECK_EQUAL(reader.dictionary().size(), 2 + additional_count);
+  BOOST_REQUIRE_EQUAL(reader.names().size(), 1u);
+  BOOST_CHECK_EQUAL(reader.names().front().id, 2u);
+  BOOST_CHECK_EQUAL(reader.names().front().name, "second");
+  for (resource_id id = 1; id <= 2; ++id)
+  {
+    buffer entry;
+    BOOST_REQUIRE(reader.load(id, entry, resource_type::buffer));
+    BOOST_REQUIRE_EQUAL(entry.storage.size(), entry_size(id));
+    for (std::size_t i = 0; i < entry.storage.size(); ++i)
+      BOOST_REQUIRE(entry.storage[i] == entry_byte(id, i));
+  }
+}
+
+/// Loads all entries from thread_count threads at once, each starting at a
+/// different entry, and returns the number of mismatching entries.
+std::size_t load_concurrently(resource_db::archive& reader)
+{
+  std::atomic<std::size_t> errors = 0;
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < thread_count; ++t)
+  {
+    threads.emplace_back([&, t]() {
+      for (std::size_t i = 0; i < entry_count; ++i)
+      {
+        resource_id id =
+          (t * entry_count / thread_count + i) % entry_count + 1;
+        buffer entry;
+        if (!reader.load(id, entry, resource_type::buffer) ||
+            entry.storage.size() != entry_size(id) ||
+            entry.storage.front() != entry_byte(id, 0) ||
+            entry.storage.back() != entry_byte(id, entry.storage.size() - 1))
+        {
+          ++errors;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  return errors;
+}
+}
+
+BOOST_AUTO_TEST_CASE(archive_concurrent_load)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.archive";
+  auto total_size = write_archive(path);
+
+  auto print = [&](const char* name, nanoseconds elapsed) {
+    std::cout << "    " << name << std::fixed << std::setprecision(1)
+              << (thread_count * total_size /
+                  duration_cast<duration<double>>(elapsed).count() / 1.0e6)
+              << " MB/s" << std::endl;
+  };
+  std::cout << "archive benchmark (" << entry_count << " entries, "
+            << thread_count << " threads):" << std::endl;
+
+  {
+    // Read-only archives are memory mapped.
+    resource_db::archive reader{path};
+    BOOST_REQUIRE(reader.open(true));
+    BOOST_CHECK_EQUAL(reader.dictionary().size(), entry_count);
+
+    buffer entry;
+    BOOST_CHECK(!reader.load(entry_count + 1, entry, resource_type::buffer));
+    BOOST_REQUIRE(reader.load(42, entry, resource_type::buffer));
+    BOOST_REQUIRE_EQUAL(entry.storage.size(), entry_size(42));
+    for (std::size_t i = 0; i < entry.storage.size(); ++i)
+      BOOST_REQUIRE(entry.storage[i] == entry_byte(42, i));
+
+    auto begin = high_resolution_clock::now();
+    BOOST_CHECK_EQUAL(load_concurrently(reader), 0u);
+    print("mapped:           ", high_resolution_clock::now() - begin);
+  }
+
+  {
+    // Writable archives use positional reads, and may still be written to.
+    resource_db::archive reader{path};
+    BOOST_REQUIRE(reader.open(false));
+    auto begin = high_resolution_clock::now();
+    BOOST_CHECK_EQUAL(load_concurrently(reader), 0u);
+    print("positional reads: ", high_resolution_clock::now() - begin);
+
+    buffer entry;
+    entry.storage.resize(100, std::byte{7});
+    BOOST_CHECK(
+      reader.save(entry, resource_type::buffer, entry_count + 1, {}));
+    entry.storage.clear();
+    BOOST_REQUIRE(
+      reader.load(entry_count + 1, entry, resource_type::buffer));
+    BOOST_CHECK_EQUAL(entry.storage.size(), 100u);
+  }
+
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(archive_codecs_and_compaction)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.archive_codecs";
+  std::filesystem::remove(path);
+
+  auto make_buffer = [](std::size_t size, bool compressible) {
+    buffer result;
+    result.storage.resize(size);
+    std::uint32_t state = 12345;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      state = state * 1664525u + 1013904223u;
+      result.storage[i] = static_cast<std::byte>(
+        compressible ? (i / 64) & 0xFF : state >> 24);
+    }
+    return result;
+  };
+
+  {
+    resource_db::archive writer{path};
+    BOOST_REQUIRE(writer.open(false));
+    BOOST_CHECK(writer.save(make_buffer(100, true), resource_type::buffer, 1,
+                            {}));
+    BOOST_CHECK(writer.save(make_buffer(65536, true), resource_type::buffer,
+                            2, {}));
+    BOOST_CHECK(writer.save(make_buffer(65536, false), resource_type::buffer,
+                            3, {}));
+    auto zstd_policy = writer.codec_policy();
+    zstd_policy.zstd_min_saving = 0.0f;
+    writer.codec_policy(zstd_policy);
+    BOOST_CHECK(writer.save(make_buffer(65536, true), resource_type::buffer,
+                            4, {}));
+
+    const auto& dictionary = writer.dictionary();
+    auto flags = [&](resource_id id) { return dictionary.find(id)->flags; };
+    // Small and incompressible entries are stored uncompressed.
+    BOOST_CHECK(flags(1) == file_flags{0});
+    BOOST_CHECK(flags(2) & file_flag::lz4_compressed);
+    BOOST_CHECK(flags(3) == file_flags{0});
+    BOOST_CHECK(flags(4) & file_flag::zstd_compressed);
+    BOOST_CHECK_LT(dictionary.find(2)->size, dictionary.find(2)->raw_size);
+
+    // Saving an id which is already stored with the same type keeps the
+    // existing entry.
+    auto offset = dictionary.find(1)->offset;
+    auto raw_size = dictionary.find(1)->raw_size;
+    BOOST_CHECK(writer.save(make_buffer(1000, false), resource_type::buffer, 1,
+                            {}));
+    BOOST_CHECK_EQUAL(dictionary.find(1)->offset, offset);
+    BOOST_CHECK_EQUAL(dictionary.find(1)->raw_size, raw_size);
+    BOOST_CHECK_EQUAL(writer.free_size(), 0u);
+
+    // Erased entries leave free space, which is reused.
+    writer.erase(3);
+    BOOST_CHECK(!dictionary.find(3));
+    BOOST_CHECK_GT(writer.free_size(), 60000u);
+    writer.erase(1);
+    BOOST_CHECK(writer.save(make_buffer(1000, false), resource_type::buffer, 1,
+                            {}));
+    BOOST_CHECK_LT(dictionary.find(1)->offset, dictionary.find(4)->offset);
+    BOOST_CHECK_GT(writer.free_size(), 0u);
+  }
+
+  {
+    // The free-space list is persistent.
+    resource_db::archive writer{path};
+    BOOST_REQUIRE(writer.open(false));
+    BOOST_CHECK_GT(writer.free_size(), 0u);
+    BOOST_REQUIRE(writer.compact({4}));
+    BOOST_CHECK_EQUAL(writer.free_size(), 0u);
+    BOOST_CHECK_EQUAL(writer.dictionary().find(4)->offset, 0u);
+  }
+
+  resource_db::archive reader{path};
+  BOOST_REQUIRE(reader.open(true));
+  BOOST_CHECK_EQUAL(reader.dictionary().size(), 3u);
+  for (resource_id id : {1, 2, 4})
+  {
+    auto expected = id == 1 ? make_buffer(1000, false)
+                            : make_buffer(65536, true);
+    buffer entry;
+    BOOST_REQUIRE(reader.load(id, entry, resource_type::buffer));
+    BOOST_CHECK(entry.storage == expected.storage);
+  }
+  reader.close();
+
+  auto report = report_archive(path);
+  BOOST_REQUIRE_EQUAL(report.types.size(), 1u);
+  BOOST_CHECK_EQUAL(report.types.front().entry_count, 3u);
+  BOOST_CHECK_EQUAL(report.types.front().lz4_count, 1u);
+  BOOST_CHECK_EQUAL(report.types.front().zstd_count, 1u);
+  BOOST_CHECK_GT(report.types.front().raw_size, 2 * 65536u + 1000);
+  BOOST_CHECK_LT(report.types.front().stored_size, 65536u);
+  BOOST_CHECK_EQUAL(report.free_size, 0u);
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(archive_legacy_versions)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.archive_v1";
+  write_archive_v1(path);
+  auto original = read_file(path);
+
+  {
+    // Archives of older versions can be read, and are left unchanged when
+    // opened read-only.
+    resource_db::archive reader{path};
+    BOOST_REQUIRE(reader.open(true));
+    check_archive_v1(reader);
+  }
+  BOOST_CHECK(read_file(path) == original);
+
+  {
+    // Opening them for writing upgrades them to the current version.
+    resource_db::archive writer{path};
+    BOOST_REQUIRE(writer.open(false));
+    check_archive_v1(writer);
+    buffer entry;
+    entry.storage.resize(100, std::byte{7});
+    BOOST_CHECK(writer.save(entry, resource_type::buffer, 3, {}));
+  }
+  auto upgraded = read_file(path);
+  archive_header header{};
+  BOOST_REQUIRE_GE(upgraded.size(), sizeof(header));
+  std::memcpy(&header, upgraded.data(), sizeof(header));
+  BOOST_CHECK_EQUAL(header.header_size, sizeof(header));
+  BOOST_CHECK_EQUAL(header.version, 4u);
+  {
+    resource_db::archive reader{path};
+    BOOST_REQUIRE(reader.open(true));
+    check_archive_v1(reader, 1);
+    buffer entry;
+    BOOST_REQUIRE(reader.load(3, entry, resource_type::buffer));
+    BOOST_CHECK_EQUAL(entry.storage.size(), 100u);
+  }
+
+  // Files which are no archive or of a newer version are rejected without
+  // modifying them.
+  header.version = 5;
+  std::memcpy(upgraded.data(), &header, sizeof(header));
+  {
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary |
+                               std::ios_base::trunc);
+    file.write(upgraded.data(), static_cast<std::streamsize>(upgraded.size()));
+  }
+  {
+    resource_db::archive writer{path};
+    BOOST_CHECK_THROW(writer.open(false), core::file_read_error);
+  }
+  BOOST_CHECK(read_file(path) == upgraded);
+
+  upgraded[0] = 'X';
+  {
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary |
+                               std::ios_base::trunc);
+    file.write(upgraded.data(), static_cast<std::streamsize>(upgraded.size()));
+  }
+  {
+    resource_db::archive writer{path};
+    BOOST_CHECK_THROW(writer.open(false), core::file_read_error);
+  }
+  BOOST_CHECK(read_file(path) == upgraded);
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(archive_legacy_flat_dictionary)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.archive_v3";
+  std::filesystem::remove(path);
+  {
+    resource_db::archive writer{path};
+    BOOST_REQUIRE(writer.open(false));
+    for (resource_id id = 1; id <= 16; ++id)
+    {
+      buffer entry;
+      entry.storage.resize(entry_size(id), entry_byte(id, 0));
+      BOOST_CHECK(writer.save(entry, resource_type::buffer, id, {}));
+    }
+  }
+
+  // Version 3 used the same dictionary layout as the current version, but
+  // marked the header by its magic value instead of the version field.
+  auto current = read_file(path);
+  archive_header header{};
+  BOOST_REQUIRE_GE(current.size(), sizeof(header));
+  std::memcpy(&header, current.data(), sizeof(header));
+  header.magic = {{'R', 'E', 'P', '3'}};
+  header.header_size = offsetof(archive_header, version);
+  {
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary |
+                               std::ios_base::trunc);
+    file.write(reinterpret_cast<const char*>(&header), header.header_size);
+    file.write(current.data() + sizeof(header),
+               static_cast<std::streamsize>(current.size() - sizeof(header)));
+  }
+
+  auto check = [&](resource_db::archive& reader) {
+    BOOST_CHECK_EQUAL(reader.dictionary().size(), 16u);
+    for (resource_id id = 1; id <= 16; ++id)
+    {
+      buffer entry;
+      BOOST_REQUIRE(reader.load(id, entry, resource_type::buffer));
+      BOOST_CHECK_EQUAL(entry.storage.size(), entry_size(id));
+      BOOST_CHECK(entry.storage.back() == entry_byte(id, 0));
+    }
+  };
+  {
+    resource_db::archive reader{path};
+    BOOST_REQUIRE(reader.open(true));
+    check(reader);
+  }
+  {
+    resource_db::archive writer{path};
+    BOOST_REQUIRE(writer.open(false));
+    check(writer);
+  }
+  auto upgraded = read_file(path);
+  BOOST_REQUIRE_GE(upgraded.size(), sizeof(header));
+  std::memcpy(&header, upgraded.data(), sizeof(header));
+  BOOST_CHECK_EQUAL(header.header_size, sizeof(header));
+  BOOST_CHECK_EQUAL(header.version, 4u);
+  {
+    resource_db::archive reader{path};
+    BOOST_REQUIRE(reader.open(true));
+    check(reader);
+  }
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(archive_dictionary_benchmark)
+{
+  constexpr std::size_t dictionary_size = 1 << 18;
+  constexpr std::size_t lookup_count = 1 << 22;
+  constexpr int open_count = 5;
+
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.archive_dictionary";
+  std::filesystem::remove(path);
+  auto make_id = [](std::size_t index) {
+    return static_cast<resource_id>(index * 0x9E3779B97F4A7C15ull + 1);
+  };
+  {
+    resource_db::archive writer{path};
+    BOOST_REQUIRE(writer.open(false));
+    buffer entry;
+    entry.storage.resize(16);
+    for (std::size_t i = 0; i < dictionary_size; ++i)
+      writer.save(entry, resource_type::buffer, make_id(i), {});
+  }
+
+  auto begin = high_resolution_clock::now();
+  for (int i = 0; i < open_count; ++i)
+  {
+    resource_db::archive reader{path};
+    BOOST_REQUIRE(reader.open(true));
+  }
+  auto open_time = (high_resolution_clock::now() - begin) / open_count;
+
+  resource_db::archive reader{path};
+  BOOST_REQUIRE(reader.open(true));
+  std::size_t found = 0;
+  std::uint64_t position;
+  std::uint64_t state = 1;
+  begin = high_resolution_clock::now();
+  for (std::size_t i = 0; i < lookup_count; ++i)
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    found += reader.locate(make_id((state >> 33) % dictionary_size),
+                           position)
+               ? 1
+               : 0;
+  }
+  auto lookup_time = high_resolution_clock::now() - begin;
+  BOOST_CHECK_EQUAL(found, lookup_count);
+
+  std::cout << "archive dictionary (" << dictionary_size
+            << " entries): open " << std::fixed << std::setprecision(2)
+            << duration_cast<microseconds>(open_time).count() / 1000.0
+            << " ms, random lookup " << std::setprecision(1)
+            << static_cast<double>(
+                 duration_cast<nanoseconds>(lookup_time).count()) /
+                 lookup_count
+            << " ns" << std::endl;
+  reader.close();
+  std::filesystem::remove(path);
+}
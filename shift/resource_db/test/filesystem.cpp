@@ -0,0 +1,138 @@
+#include "shift/resource_db/filesystem.hpp"
+#include <shift/resource_db/buffer.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <filesystem>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::resource_db;
+
+namespace
+{
+/// Writes a JSON index with entry_count entries. The referenced files don't
+/// exist, which doesn't matter because existence is only checked on load.
+void write_json_index(const std::filesystem::path& path,
+                      std::size_t entry_count)
+{
+  std::ofstream file(path / ".index.json",
+                     std::ios_base::out | std::ios_base::trunc);
+  file << "{\"index\":{";
+  for (std::size_t i = 0; i < entry_count; ++i)
+  {
+    file << (i > 0 ? "," : "") << "\"" << std::hex << std::setw(16)
+         << std::setfill('0') << (i * 0x9E3779B97F4A7C15ull + 1) << std::dec
+         << "\":[\"generated/" << i << ".buffer\"]";
+  }
+  file << "}}";
+}
+}
+
+BOOST_AUTO_TEST_CASE(filesystem_index)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.filesystem";
+  std::filesystem::remove_all(path);
+
+  buffer first;
+  first.storage.resize(100, std::byte{1});
+  buffer second;
+  second.storage.resize(200, std::byte{2});
+  {
+    resource_db::filesystem mount{path};
+    BOOST_REQUIRE(mount.open(false));
+    BOOST_CHECK(mount.save(first, resource_type::buffer, first.id(),
+                           "first.buffer"));
+    BOOST_CHECK(mount.save(second, resource_type::buffer, second.id(),
+                           "sub/second.buffer"));
+    BOOST_CHECK_EQUAL(mount.lookup_id("sub/second.buffer"), second.id());
+  }
+  BOOST_CHECK(std::filesystem::exists(path / ".index"));
+
+  {
+    // Changes are appended to the journal, which is replayed on open.
+    resource_db::filesystem mount{path};
+    BOOST_REQUIRE(mount.open(false));
+    BOOST_CHECK_EQUAL(mount.lookup_id("first.buffer"), first.id());
+    mount.erase(first.id());
+    BOOST_CHECK_EQUAL(mount.lookup_id("first.buffer"), 0u);
+    BOOST_CHECK(!std::filesystem::exists(path / "first.buffer"));
+    BOOST_CHECK_GT(std::filesystem::file_size(path / ".index.journal"), 8u);
+  }
+
+  {
+    resource_db::filesystem mount{path};
+    BOOST_REQUIRE(mount.open(true));
+    std::uint64_t position;
+    BOOST_CHECK(!mount.locate(first.id(), position));
+    BOOST_CHECK(mount.locate(second.id(), position));
+    buffer loaded;
+    BOOST_REQUIRE(mount.load(second.id(), loaded, resource_type::buffer));
+    BOOST_CHECK(loaded.storage == second.storage);
+
+    // Export the index as JSON and import it into a fresh directory.
+    BOOST_CHECK(mount.export_json(path / "export.json"));
+  }
+
+  auto import_path = path / "import";
+  std::filesystem::create_directories(import_path);
+  std::filesystem::rename(path / "export.json", import_path / ".index.json");
+  {
+    resource_db::filesystem mount{import_path};
+    BOOST_REQUIRE(mount.open(false));
+    BOOST_CHECK_EQUAL(mount.lookup_id("sub/second.buffer"), second.id());
+    BOOST_CHECK_EQUAL(mount.lookup_id("first.buffer"), 0u);
+  }
+  BOOST_CHECK(std::filesystem::exists(import_path / ".index"));
+
+  std::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE(filesystem_mount_benchmark)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.filesystem_mount";
+
+  std::cout << "filesystem mount benchmark:" << std::endl;
+  for (std::size_t entry_count : {10000u, 100000u, 1000000u})
+  {
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    write_json_index(path, entry_count);
+
+    // The first writable mount imports the JSON index.
+    auto begin = high_resolution_clock::now();
+    {
+      resource_db::filesystem mount{path};
+      BOOST_REQUIRE(mount.open(false));
+    }
+    auto import_time = high_resolution_clock::now() - begin;
+
+    begin = high_resolution_clock::now();
+    resource_db::filesystem mount{path};
+    BOOST_REQUIRE(mount.open(true));
+    auto mount_time = high_resolution_clock::now() - begin;
+
+    std::ostringstream last_path;
+    last_path << "generated/" << entry_count - 1 << ".buffer";
+    BOOST_CHECK_EQUAL(mount.lookup_id(last_path.str()),
+                      (entry_count - 1) * 0x9E3779B97F4A7C15ull + 1);
+    mount.close();
+
+    std::cout << "    " << std::setw(7) << entry_count
+              << " entries: JSON import " << std::fixed
+              << std::setprecision(1)
+              << duration_cast<microseconds>(import_time).count() / 1000.0
+              << " ms, binary mount " << std::setprecision(3)
+              << duration_cast<microseconds>(mount_time).count() / 1000.0
+              << " ms" << std::endl;
+  }
+  std::filesystem::remove_all(path);
+}
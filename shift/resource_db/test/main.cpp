@@ -0,0 +1,4 @@
+#define BOOST_TEST_MODULE SHIFT_TEST_MODULE_NAME
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
@@ -0,0 +1,232 @@
+#include <shift/resource_db/repository.hpp>
+#include <shift/resource_db/buffer.hpp>
+#include <shift/resource_db/image.hpp>
+#include "shift/resource_db/archive.hpp"
+#include "shift/resource_db/resident_set.hpp"
+#include <shift/task/task_system.hpp>
+#include <shift/task/async.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::resource_db;
+
+namespace
+{
+constexpr std::size_t entry_count = 2048;
+
+/// Writes entry_count buffers to a new archive at path and returns their ids
+/// in the order of writing.
+std::vector<resource_id> write_archive(const std::filesystem::path& path)
+{
+  std::filesystem::remove(path);
+  resource_db::archive writer{path};
+  BOOST_REQUIRE(writer.open(false));
+
+  std::vector<resource_id> ids;
+  for (std::size_t i = 0; i < entry_count; ++i)
+  {
+    buffer entry;
+    entry.storage.resize(4096 + i, static_cast<std::byte>(i & 0xFF));
+    auto id = entry.id();
+    BOOST_CHECK(writer.save(entry, resource_type::buffer, id, {}));
+    ids.push_back(id);
+  }
+  writer.close();
+  return ids;
+}
+}
+
+BOOST_AUTO_TEST_CASE(repository_load_async)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.repository";
+  auto ids = write_archive(path);
+  // Request resources in random order, with duplicates.
+  auto shuffled_ids = ids;
+  shuffled_ids.insert(shuffled_ids.end(), ids.begin(), ids.end());
+  std::shuffle(shuffled_ids.begin(), shuffled_ids.end(), std::mt19937{42});
+
+  resource_db::repository repository;
+  auto* mount_point = repository.mount(path, true);
+  BOOST_REQUIRE(mount_point != nullptr);
+
+  auto primary_task = [&]() {
+    // Concurrent requests for the same id share a single instance.
+    auto first = repository.load_async<buffer>(ids[7]);
+    auto second = repository.load_async<buffer>(ids[7]);
+    auto first_buffer = first.get();
+    BOOST_CHECK(first_buffer.get_shared() == second.get().get_shared());
+    BOOST_CHECK_EQUAL(first_buffer->storage.size(), 4096u + 7);
+
+    // Requests for unknown ids or of the wrong type report an exception.
+    BOOST_CHECK_THROW(repository.load_async<buffer>(1).get(),
+                      core::runtime_error);
+    BOOST_CHECK_THROW(repository.load_async<image>(ids[7]).get(),
+                      core::runtime_error);
+
+    auto begin = high_resolution_clock::now();
+    auto futures = repository.load_all<buffer>(shuffled_ids);
+    BOOST_REQUIRE_EQUAL(futures.size(), shuffled_ids.size());
+    std::vector<resource_ptr<buffer>> buffers;
+    buffers.reserve(futures.size());
+    for (auto& future : futures)
+      buffers.push_back(future.get());
+    auto duration = high_resolution_clock::now() - begin;
+    std::cout << "load_all (" << shuffled_ids.size() << " requests): "
+              << std::fixed << std::setprecision(1)
+              << duration_cast<microseconds>(duration).count() / 1000.0
+              << " ms" << std::endl;
+
+    for (std::size_t i = 0; i < buffers.size(); ++i)
+    {
+      BOOST_REQUIRE(buffers[i]);
+      BOOST_CHECK_EQUAL(buffers[i].id(), shuffled_ids[i]);
+    }
+    for (std::size_t i = 0; i < entry_count; ++i)
+    {
+      auto buffer_iter = std::find_if(
+        buffers.begin(), buffers.end(),
+        [&](const auto& buffer) { return buffer.id() == ids[i]; });
+      BOOST_REQUIRE(buffer_iter != buffers.end());
+      BOOST_CHECK_EQUAL((*buffer_iter)->storage.size(), 4096u + i);
+      // Both requests for each id got the same instance.
+      auto other_iter = std::find_if(
+        buffer_iter + 1, buffers.end(),
+        [&](const auto& buffer) { return buffer.id() == ids[i]; });
+      BOOST_REQUIRE(other_iter != buffers.end());
+      BOOST_CHECK(buffer_iter->get_shared() == other_iter->get_shared());
+    }
+    return 0;
+  };
+  task::task_system{}.num_workers(8).start(primary_task).join();
+
+  repository.unmount(mount_point);
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(repository_load_outside_task)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.repository_sync";
+  auto ids = write_archive(path);
+
+  resource_db::repository repository;
+  auto* mount_point = repository.mount(path, true);
+  BOOST_REQUIRE(mount_point != nullptr);
+
+  // Without a task system all loads complete before returning.
+  std::vector<resource_id> some_ids(ids.begin(), ids.begin() + 100);
+  auto futures = repository.load_all<buffer>(some_ids);
+  BOOST_REQUIRE_EQUAL(futures.size(), some_ids.size());
+  for (std::size_t i = 0; i < futures.size(); ++i)
+  {
+    BOOST_REQUIRE(futures[i].ready());
+    auto loaded = futures[i].get();
+    BOOST_REQUIRE(loaded);
+    BOOST_CHECK_EQUAL(loaded->storage.size(), 4096u + i);
+  }
+  auto single = repository.load_async<buffer>(ids[200]);
+  BOOST_REQUIRE(single.ready());
+  BOOST_CHECK_EQUAL(single.get()->storage.size(), 4096u + 200);
+
+  repository.unmount(mount_point);
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(repository_resident_set)
+{
+  auto make_buffer = [](std::size_t size) {
+    auto result = std::make_shared<buffer>();
+    result->storage.resize(size);
+    return result;
+  };
+
+  resident_set residents;
+  residents.insert(1, make_buffer(10), 10);
+  BOOST_CHECK_EQUAL(residents.size(), 0u);
+
+  residents.budget(100);
+  residents.insert(1, make_buffer(40), 40);
+  residents.insert(2, make_buffer(40), 40);
+  BOOST_CHECK(residents.touch(1));
+  // Resource 1 was used recently, so resource 2 gets evicted.
+  residents.insert(3, make_buffer(40), 40);
+  BOOST_CHECK_EQUAL(residents.size(), 2u);
+  BOOST_CHECK_EQUAL(residents.memory_size(), 80u);
+  BOOST_CHECK_EQUAL(residents.evictions(), 1u);
+  BOOST_CHECK(residents.touch(1));
+  BOOST_CHECK(!residents.touch(2));
+  BOOST_CHECK(residents.touch(3));
+
+  // Resources exceeding the budget are never resident.
+  residents.insert(4, make_buffer(200), 200);
+  BOOST_CHECK(!residents.touch(4));
+
+  residents.budget(50);
+  BOOST_CHECK_EQUAL(residents.size(), 1u);
+  BOOST_CHECK_LE(residents.memory_size(), 50u);
+  residents.clear();
+  BOOST_CHECK_EQUAL(residents.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(repository_residency)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              "test.shift.resource_db.residency";
+  auto ids = write_archive(path);
+
+  resource_db::repository repository;
+  auto* mount_point = repository.mount(path, true);
+  BOOST_REQUIRE(mount_point != nullptr);
+
+  // Without a budget resources are released along with their last
+  // resource_ptr.
+  BOOST_CHECK(repository.load<buffer>(ids[0]));
+  BOOST_CHECK(repository.load<buffer>(ids[0]));
+  auto statistics = repository.statistics();
+  BOOST_CHECK_EQUAL(statistics.hits, 0u);
+  BOOST_CHECK_EQUAL(statistics.misses, 2u);
+  BOOST_CHECK_EQUAL(statistics.resident_count, 0u);
+
+  constexpr std::size_t budget = 4 << 20;
+  repository.residency_budget(budget);
+  BOOST_CHECK_EQUAL(repository.residency_budget(), budget);
+  for (std::size_t i = 0; i < 100; ++i)
+    BOOST_CHECK(repository.load<buffer>(ids[i]));
+  for (std::size_t i = 0; i < 100; ++i)
+    BOOST_CHECK(repository.load<buffer>(ids[i]));
+  statistics = repository.statistics();
+  BOOST_CHECK_EQUAL(statistics.hits, 100u);
+  BOOST_CHECK_EQUAL(statistics.misses, 102u);
+  BOOST_CHECK_EQUAL(statistics.resident_count, 100u);
+  BOOST_CHECK_EQUAL(statistics.evictions, 0u);
+
+  // Loading more resources than fit into the budget evicts resources.
+  for (auto id : ids)
+    BOOST_CHECK(repository.load<buffer>(id));
+  statistics = repository.statistics();
+  BOOST_CHECK_GT(statistics.evictions, 0u);
+  BOOST_CHECK_LE(statistics.resident_size, budget);
+  std::cout << "residency (" << ids.size() << " buffers, " << (budget >> 20)
+            << " MiB budget): " << statistics.hits << " hits, "
+            << statistics.misses << " misses, " << statistics.evictions
+            << " evictions, " << statistics.resident_count << " resident"
+            << std::endl;
+
+  repository.residency_budget(0);
+  BOOST_CHECK_EQUAL(repository.statistics().resident_count, 0u);
+
+  repository.unmount(mount_point);
+  std::filesystem::remove(path);
+}
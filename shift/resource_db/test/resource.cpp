@@ -0,0 +1,85 @@
+#include <shift/resource_db/buffer.hpp>
+#include <shift/crypto/sha256.hpp>
+#include <shift/task/task_system.hpp>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+
+using namespace std::chrono;
+using namespace shift;
+using namespace shift::resource_db;
+
+BOOST_AUTO_TEST_CASE(resource_id_cache)
+{
+  auto source = std::make_shared<buffer>();
+  source->storage.resize(1000, std::byte{1});
+
+  // Ids of small buffers are a plain hash over their contents.
+  crypto::sha256::digest_t digest{};
+  crypto::sha256 context(digest);
+  context << "buffer" << source->storage;
+  auto expected_id = crypto::reduce<resource_id>(context.finalize());
+  BOOST_CHECK_EQUAL(source->id(), expected_id);
+
+  // The id is cached until it gets invalidated explicitly.
+  source->storage[0] = std::byte{2};
+  BOOST_CHECK_EQUAL(source->id(), expected_id);
+  source->invalidate_id();
+  BOOST_CHECK_NE(source->id(), expected_id);
+
+  resource_ptr<buffer> pointer{std::shared_ptr<buffer>{source}};
+  BOOST_CHECK_EQUAL(pointer.id(), source->id());
+  source->storage[0] = std::byte{1};
+  BOOST_CHECK_EQUAL(pointer.update_id(), expected_id);
+  BOOST_CHECK_EQUAL(source->id(), expected_id);
+
+  // Copies keep the cached id.
+  buffer copy = *source;
+  BOOST_CHECK_EQUAL(copy.id(), expected_id);
+}
+
+BOOST_AUTO_TEST_CASE(resource_id_tree_hash)
+{
+  buffer large;
+  large.storage.resize(64 << 20);
+  for (std::size_t i = 0; i < large.storage.size(); i += 4096)
+    large.storage[i] = static_cast<std::byte>(i >> 12);
+
+  auto begin = high_resolution_clock::now();
+  auto sequential_id = large.id();
+  auto sequential_time = high_resolution_clock::now() - begin;
+
+  // Hashing from within a task spreads the chunks over all workers, and must
+  // yield the same id.
+  large.invalidate_id();
+  resource_id parallel_id = 0;
+  nanoseconds parallel_time{};
+  task::task_system{}
+    .num_workers(8)
+    .start([&]() {
+      auto begin = high_resolution_clock::now();
+      parallel_id = large.id();
+      parallel_time = high_resolution_clock::now() - begin;
+      return 0;
+    })
+    .join();
+  BOOST_CHECK_EQUAL(sequential_id, parallel_id);
+
+  begin = high_resolution_clock::now();
+  BOOST_CHECK_EQUAL(large.id(), parallel_id);
+  auto cached_time = high_resolution_clock::now() - begin;
+
+  auto print = [](const char* name, nanoseconds elapsed) {
+    std::cout << "    " << name << std::fixed << std::setprecision(3)
+              << duration_cast<microseconds>(elapsed).count() / 1000.0
+              << " ms" << std::endl;
+  };
+  std::cout << "buffer id (64 MiB):" << std::endl;
+  print("sequential: ", sequential_time);
+  print("8 workers:  ", parallel_time);
+  print("cached:     ", cached_time);
+}
@@ -12,8 +12,13 @@ compact_input_archive<Order>& operator>>(compact_input_archive<Order>& archive,
                                          std::array<U, N>& array)
 {
   archive >> begin_array{N};
-  for (auto& element : array)
-    archive >> element;
+  if constexpr (trivial_serialization<U>::value)
+    archive.read_trivial(array.data(), N);
+  else
+  {
+    for (auto& element : array)
+      archive >> element;
+  }
   archive >> end_array{};
   return archive;
 }
@@ -24,8 +29,13 @@ compact_output_archive<Order>& operator<<(
   compact_output_archive<Order>& archive, const std::array<U, N>& array)
 {
   archive << begin_array{N};
-  for (const auto& element : array)
-    archive << element;
+  if constexpr (trivial_serialization<U>::value)
+    archive.write_trivial(array.data(), N);
+  else
+  {
+    for (const auto& element : array)
+      archive << element;
+  }
   archive << end_array{};
   return archive;
 }
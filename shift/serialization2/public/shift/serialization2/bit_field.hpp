@@ -6,6 +6,14 @@
 
 namespace shift::serialization2
 {
+/// Bit fields are serialized as their storage type, so arrays of them can be
+/// serialized as a single block of memory.
+template <typename U>
+struct trivial_serialization<core::bit_field<U>> : std::true_type
+{
+  using scalar_type = typename core::bit_field<U>::storage_type;
+};
+
 ///
 template <boost::endian::order Order, typename U>
 compact_input_archive<Order>& operator>>(compact_input_archive<Order>& archive,
@@ -1,6 +1,7 @@
 #ifndef SHIFT_SERIALIZATION2_COMPACT_INPUT_ARCHIVE_HPP
 #define SHIFT_SERIALIZATION2_COMPACT_INPUT_ARCHIVE_HPP
 
+#include <cstring>
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/endian/conversion.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
@@ -9,17 +10,29 @@
 
 namespace shift::serialization2
 {
-///
+/// An archive reading values in a compact binary format, either from a
+/// stream or directly from a contiguous memory buffer.
+/// @remarks
+///   Reading from memory avoids a virtual stream buffer call for every
+///   single value and is considerably faster. Reading past the end of the
+///   buffer throws a serialization_error.
 template <boost::endian::order Order>
 class compact_input_archive final
 {
 public:
-  /// Constructor.
+  /// Constructs an archive reading from a stream.
   compact_input_archive(boost::iostreams::filtering_istream& stream)
-  : _stream(stream)
+  : _stream(&stream)
+  {
+    _stream->exceptions(boost::iostreams::filtering_istream::failbit |
+                        boost::iostreams::filtering_istream::eofbit);
+  }
+
+  /// Constructs an archive reading from a memory buffer, which must stay
+  /// valid for the lifetime of the archive.
+  compact_input_archive(const void* data, std::size_t size)
+  : _cursor(static_cast<const char*>(data)), _end(_cursor + size)
   {
-    _stream.exceptions(boost::iostreams::filtering_istream::failbit |
-                       boost::iostreams::filtering_istream::eofbit);
   }
 
   /// Destructor.
@@ -353,28 +366,28 @@ public:
   ///
   compact_input_archive& operator>>(bool& value)
   {
-    _stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    read(reinterpret_cast<char*>(&value), sizeof(value));
     return *this;
   }
 
   ///
   compact_input_archive& operator>>(bool&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
   ///
   compact_input_archive& operator>>(char& value)
   {
-    _stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    read(reinterpret_cast<char*>(&value), sizeof(value));
     return *this;
   }
 
   ///
   compact_input_archive& operator>>(char&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -383,7 +396,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -391,7 +404,7 @@ public:
   ///
   compact_input_archive& operator>>(char16_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -400,7 +413,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -408,35 +421,35 @@ public:
   ///
   compact_input_archive& operator>>(char32_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
   ///
   compact_input_archive& operator>>(std::uint8_t& value)
   {
-    _stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    read(reinterpret_cast<char*>(&value), sizeof(value));
     return *this;
   }
 
   ///
   compact_input_archive& operator>>(std::uint8_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
   ///
   compact_input_archive& operator>>(std::int8_t& value)
   {
-    _stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    read(reinterpret_cast<char*>(&value), sizeof(value));
     return *this;
   }
 
   ///
   compact_input_archive& operator>>(std::int8_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -445,7 +458,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -453,7 +466,7 @@ public:
   ///
   compact_input_archive& operator>>(std::uint16_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -462,7 +475,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -470,7 +483,7 @@ public:
   ///
   compact_input_archive& operator>>(std::int16_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -479,7 +492,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -487,7 +500,7 @@ public:
   ///
   compact_input_archive& operator>>(std::uint32_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -496,7 +509,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -504,7 +517,7 @@ public:
   ///
   compact_input_archive& operator>>(std::int32_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -513,7 +526,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -521,7 +534,7 @@ public:
   ///
   compact_input_archive& operator>>(std::uint64_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -530,7 +543,7 @@ public:
   {
     using namespace boost::endian;
     std::decay_t<decltype(value)> source_value;
-    _stream.read(reinterpret_cast<char*>(&source_value), sizeof(value));
+    read(reinterpret_cast<char*>(&source_value), sizeof(value));
     value = conditional_reverse<Order, order::native>(source_value);
     return *this;
   }
@@ -538,7 +551,7 @@ public:
   ///
   compact_input_archive& operator>>(std::int64_t&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -554,7 +567,7 @@ public:
   ///
   compact_input_archive& operator>>(float&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -570,7 +583,7 @@ public:
   ///
   compact_input_archive& operator>>(double&& value)
   {
-    _stream.ignore(sizeof(value));
+    ignore(sizeof(value));
     return *this;
   }
 
@@ -580,7 +593,7 @@ public:
     compressed<std::uint32_t> length = 0;
     *this >> length;
     value.resize(length);
-    _stream.read(const_cast<char*>(value.data()), length);
+    read(value.data(), length);
     return *this;
   }
 
@@ -589,24 +602,71 @@ public:
   {
     compressed<std::uint32_t> length = 0;
     *this >> length;
-    _stream.ignore(length);
+    ignore(length);
     return *this;
   }
 
-  /// Read data from the underlying stream.
+  /// Read data from the underlying stream or buffer.
   inline void read(char* destination, std::size_t size)
   {
-    _stream.read(destination, static_cast<std::streamsize>(size));
+    if (_stream == nullptr)
+    {
+      if (static_cast<std::size_t>(_end - _cursor) < size)
+        throw_end_of_buffer();
+      std::memcpy(destination, _cursor, size);
+      _cursor += size;
+    }
+    else
+      _stream->read(destination, static_cast<std::streamsize>(size));
   }
 
-  /// Read and discard data from the underlying stream.
+  /// Read and discard data from the underlying stream or buffer.
   inline void ignore(std::size_t size)
   {
-    _stream.ignore(static_cast<std::streamsize>(size));
+    if (_stream == nullptr)
+    {
+      if (static_cast<std::size_t>(_end - _cursor) < size)
+        throw_end_of_buffer();
+      _cursor += size;
+    }
+    else
+      _stream->ignore(static_cast<std::streamsize>(size));
+  }
+
+  /// Reads count values of a type with trivial_serialization in a single
+  /// block and converts their byte order if necessary.
+  template <typename U>
+  void read_trivial(U* values, std::size_t count)
+  {
+    static_assert(trivial_serialization<U>::value &&
+                  std::is_trivially_copyable_v<U>);
+    read(reinterpret_cast<char*>(values), count * sizeof(U));
+    if constexpr (Order != boost::endian::order::native)
+    {
+      using scalar_t = typename trivial_serialization<U>::scalar_type;
+      detail::reverse_bytes<sizeof(scalar_t)>(
+        values, count * sizeof(U) / sizeof(scalar_t));
+    }
+  }
+
+  /// Returns the number of bytes left in the memory buffer, or zero if the
+  /// archive reads from a stream.
+  std::size_t remaining() const
+  {
+    return static_cast<std::size_t>(_end - _cursor);
   }
 
 private:
-  boost::iostreams::filtering_istream& _stream;
+  [[noreturn]] static void throw_end_of_buffer()
+  {
+    BOOST_THROW_EXCEPTION(
+      serialization_error() << serialization_error_info(
+        "Attempt to read beyond the end of the archive buffer."));
+  }
+
+  boost::iostreams::filtering_istream* _stream = nullptr;
+  const char* _cursor = nullptr;
+  const char* _end = nullptr;
 };
 
 ///
@@ -1,6 +1,9 @@
 #ifndef SHIFT_SERIALIZATION2_COMPACT_OUTPUT_ARCHIVE_HPP
 #define SHIFT_SERIALIZATION2_COMPACT_OUTPUT_ARCHIVE_HPP
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/endian/conversion.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
@@ -9,17 +12,27 @@
 
 namespace shift::serialization2
 {
-///
+/// An archive writing values in a compact binary format, either to a stream
+/// or by appending to a growing byte vector.
+/// @remarks
+///   Writing to a vector avoids a virtual stream buffer call for every
+///   single value and is considerably faster.
 template <boost::endian::order Order>
 class compact_output_archive final
 {
 public:
-  /// Constructor.
+  /// Constructs an archive writing to a stream.
   compact_output_archive(boost::iostreams::filtering_ostream& stream)
-  : _stream(stream)
+  : _stream(&stream)
+  {
+    _stream->exceptions(boost::iostreams::filtering_ostream::failbit |
+                        boost::iostreams::filtering_ostream::eofbit);
+  }
+
+  /// Constructs an archive appending to buffer, which must stay valid for
+  /// the lifetime of the archive.
+  compact_output_archive(std::vector<char>& buffer) : _buffer(&buffer)
   {
-    _stream.exceptions(boost::iostreams::filtering_ostream::failbit |
-                       boost::iostreams::filtering_ostream::eofbit);
   }
 
   compact_output_archive(const compact_output_archive&) = default;
@@ -323,14 +336,46 @@ public:
   }
 
 public:
-  /// Write data to the underlying stream.
-  void write(const char* source, std::size_t size)
-  {
-    _stream.write(source, static_cast<std::streamsize>(size));
+  /// Write data to the underlying stream or buffer.
+  inline void write(const char* source, std::size_t size)
+  {
+    if (_buffer != nullptr)
+      _buffer->insert(_buffer->end(), source, source + size);
+    else
+      _stream->write(source, static_cast<std::streamsize>(size));
+  }
+
+  /// Writes count values of a type with trivial_serialization in a single
+  /// block, converting their byte order if necessary.
+  template <typename U>
+  void write_trivial(const U* values, std::size_t count)
+  {
+    static_assert(trivial_serialization<U>::value &&
+                  std::is_trivially_copyable_v<U>);
+    if constexpr (Order == boost::endian::order::native)
+      write(reinterpret_cast<const char*>(values), count * sizeof(U));
+    else
+    {
+      // Convert the values in chunks of a fixed size buffer.
+      using scalar_t = typename trivial_serialization<U>::scalar_type;
+      alignas(scalar_t) char chunk[4096];
+      const auto* source = reinterpret_cast<const char*>(values);
+      for (std::size_t remaining = count * sizeof(U); remaining > 0;)
+      {
+        auto chunk_size = std::min(remaining, sizeof(chunk));
+        std::memcpy(chunk, source, chunk_size);
+        detail::reverse_bytes<sizeof(scalar_t)>(chunk,
+                                                chunk_size / sizeof(scalar_t));
+        write(chunk, chunk_size);
+        source += chunk_size;
+        remaining -= chunk_size;
+      }
+    }
   }
 
 private:
-  boost::iostreams::filtering_ostream& _stream;
+  boost::iostreams::filtering_ostream* _stream = nullptr;
+  std::vector<char>* _buffer = nullptr;
 };
 
 ///
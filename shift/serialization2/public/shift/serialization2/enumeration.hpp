@@ -6,6 +6,15 @@
 
 namespace shift::serialization2
 {
+/// Enumerations are serialized as their underlying type, so arrays of them
+/// can be serialized as a single block of memory.
+template <typename T>
+struct trivial_serialization<T, std::enable_if_t<std::is_enum_v<T>>>
+: std::true_type
+{
+  using scalar_type = std::underlying_type_t<T>;
+};
+
 ///
 template <boost::endian::order Order, typename U,
           ENABLE_IF(std::is_enum<U>::value)>
@@ -2,11 +2,14 @@
 #define SHIFT_SERIALIZATION2_TYPES_HPP
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <type_traits>
 #include <shift/core/exception.hpp>
 #include <shift/core/group_ptr.hpp>
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/endian/arithmetic.hpp>
+#include <boost/endian/conversion.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
 
@@ -36,6 +39,51 @@ union ieee754_to_uint<double> {
   std::uint64_t uint_value;
 };
 
+/// Marks types whose compact serialization equals their memory
+/// representation, except for the byte order of each scalar_type member.
+/// Arrays of such types are serialized as a single block of memory.
+/// @remarks
+///   Specializations must derive from std::true_type and define scalar_type.
+template <typename T, typename = void>
+struct trivial_serialization : std::false_type
+{
+};
+
+/// All arithmetic types except bool are trivially serialized.
+template <typename T>
+struct trivial_serialization<
+  T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>>
+: std::true_type
+{
+  using scalar_type = T;
+};
+
+namespace detail
+{
+  /// Reverses the byte order of count consecutive scalars of the passed
+  /// size. The loop is simple enough to be vectorized by the compiler.
+  template <std::size_t Size>
+  void reverse_bytes(void* data, std::size_t count)
+  {
+    if constexpr (Size > 1)
+    {
+      using uint_t = std::conditional_t<
+        Size == 2, std::uint16_t,
+        std::conditional_t<Size == 4, std::uint32_t, std::uint64_t>>;
+      static_assert(sizeof(uint_t) == Size);
+
+      auto* bytes = static_cast<char*>(data);
+      for (std::size_t i = 0; i < count; ++i, bytes += Size)
+      {
+        uint_t value;
+        std::memcpy(&value, bytes, Size);
+        value = boost::endian::endian_reverse(value);
+        std::memcpy(bytes, &value, Size);
+      }
+    }
+  }
+}
+
 template <typename Stream, boost::endian::order Order>
 class archive;
 
@@ -3,8 +3,11 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/iostreams/device/back_inserter.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
+#include <algorithm>
 #include <chrono>
 #include <ctime>
+#include <iomanip>
+#include <iostream>
 #include <string>
 #include <cstdio>
 
@@ -76,6 +79,40 @@ void test(T&& input)
   }
 
   BOOST_CHECK_EQUAL(input, output);
+
+  // Memory archives must produce the same bytes as stream archives.
+  std::vector<char> memory_buffer;
+  {
+    compact_output_archive<> output_archive(memory_buffer);
+    output_archive << input;
+  }
+  BOOST_CHECK(memory_buffer == buffer);
+  {
+    T memory_output;
+    compact_input_archive<> input_archive(memory_buffer.data(),
+                                          memory_buffer.size());
+    input_archive >> memory_output;
+    BOOST_CHECK_EQUAL(input, memory_output);
+    BOOST_CHECK_EQUAL(input_archive.remaining(), 0u);
+  }
+
+  // Round trip using the non-native byte order.
+  constexpr auto other_order =
+    boost::endian::order::native == boost::endian::order::little
+      ? boost::endian::order::big
+      : boost::endian::order::little;
+  std::vector<char> swapped_buffer;
+  {
+    compact_output_archive<other_order> output_archive(swapped_buffer);
+    output_archive << input;
+  }
+  {
+    T swapped_output;
+    compact_input_archive<other_order> input_archive(swapped_buffer.data(),
+                                                     swapped_buffer.size());
+    input_archive >> swapped_output;
+    BOOST_CHECK_EQUAL(input, swapped_output);
+  }
 }
 
 BOOST_AUTO_TEST_CASE(test_fundamentals)
@@ -112,4 +149,156 @@ BOOST_AUTO_TEST_CASE(test_containers)
   test(std::vector<std::int32_t>{});
   test(std::vector<std::int32_t>{1});
   test(std::vector<std::int32_t>{1, 2, 3, 4, 5});
+  test(std::vector<std::uint16_t>{1, 0x1234, 0xfedc});
+  test(std::vector<double>{0.5, -1.25, 3.14159265358979});
+  test(std::vector<std::string>{"a", "", "abc"});
+  test(std::vector<bool>{true, false, true});
+}
+
+BOOST_AUTO_TEST_CASE(test_byte_order)
+{
+  std::vector<char> buffer;
+  {
+    compact_output_archive<boost::endian::order::big> archive(buffer);
+    archive << std::vector<std::uint32_t>{0x01020304u};
+  }
+  // A single byte length prefix followed by the value in big endian order.
+  BOOST_CHECK(buffer == (std::vector<char>{1, 1, 2, 3, 4}));
+
+  compact_input_archive<boost::endian::order::big> archive(buffer.data(),
+                                                           buffer.size());
+  std::uint8_t length;
+  std::uint32_t value;
+  archive >> length >> value;
+  BOOST_CHECK_EQUAL(value, 0x01020304u);
+}
+
+BOOST_AUTO_TEST_CASE(test_buffer_overrun)
+{
+  std::vector<char> buffer;
+  {
+    compact_output_archive<> archive(buffer);
+    archive << std::vector<std::uint32_t>{1, 2, 3};
+  }
+  buffer.pop_back();
+
+  std::vector<std::uint32_t> values;
+  compact_input_archive<> archive(buffer.data(), buffer.size());
+  BOOST_CHECK_THROW(archive >> values, serialization_error);
+}
+
+namespace
+{
+struct benchmark_record
+{
+  std::uint32_t id;
+  std::string name;
+  std::vector<float> samples;
+};
+
+template <boost::endian::order Order>
+compact_input_archive<Order>& operator>>(compact_input_archive<Order>& archive,
+                                         benchmark_record& record)
+{
+  archive >> record.id >> record.name >> record.samples;
+  return archive;
+}
+
+template <boost::endian::order Order>
+compact_output_archive<Order>& operator<<(
+  compact_output_archive<Order>& archive, const benchmark_record& record)
+{
+  archive << record.id << record.name << record.samples;
+  return archive;
+}
+
+/// Returns the throughput in MB/s of running function count times on size
+/// bytes.
+template <typename Function>
+double throughput(std::size_t size, int count, Function&& function)
+{
+  using namespace std::chrono;
+  auto begin = high_resolution_clock::now();
+  for (int i = 0; i < count; ++i)
+    function();
+  auto duration = duration_cast<microseconds>(high_resolution_clock::now() -
+                                              begin);
+  return static_cast<double>(size) * count /
+         std::max<double>(static_cast<double>(duration.count()), 1.0);
+}
+
+template <boost::endian::order Order, typename T>
+void benchmark(const char* name, const T& input, int count)
+{
+  std::vector<char> buffer;
+  {
+    compact_output_archive<Order> archive(buffer);
+    archive << input;
+  }
+
+  auto stream_write = throughput(buffer.size(), count, [&]() {
+    std::vector<char> target;
+    boost::iostreams::filtering_ostream stream;
+    stream.push(boost::iostreams::back_inserter(target));
+    compact_output_archive<Order> archive(stream);
+    archive << input;
+  });
+  auto memory_write = throughput(buffer.size(), count, [&]() {
+    std::vector<char> target;
+    compact_output_archive<Order> archive(target);
+    archive << input;
+  });
+  auto stream_read = throughput(buffer.size(), count, [&]() {
+    T output;
+    boost::iostreams::filtering_istream stream;
+    stream.push(boost::iostreams::array_source(buffer.data(), buffer.size()));
+    compact_input_archive<Order> archive(stream);
+    archive >> output;
+  });
+  auto memory_read = throughput(buffer.size(), count, [&]() {
+    T output;
+    compact_input_archive<Order> archive(buffer.data(), buffer.size());
+    archive >> output;
+  });
+
+  std::cout << "  " << name << " (" << buffer.size() / 1024 << " KiB)"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(0)
+            << "    write: stream " << stream_write << " MB/s, memory "
+            << memory_write << " MB/s" << std::endl
+            << "    read:  stream " << stream_read << " MB/s, memory "
+            << memory_read << " MB/s" << std::endl;
+}
+}
+
+/// Compares stream and memory archives.
+BOOST_AUTO_TEST_CASE(serialization_benchmark)
+{
+  constexpr auto native = boost::endian::order::native;
+  constexpr auto swapped = native == boost::endian::order::little
+                             ? boost::endian::order::big
+                             : boost::endian::order::little;
+
+  std::vector<float> floats(1 << 20);
+  for (std::size_t i = 0; i < floats.size(); ++i)
+    floats[i] = static_cast<float>(i) * 0.25f;
+
+  std::vector<std::uint16_t> scalars(1 << 16);
+  for (std::size_t i = 0; i < scalars.size(); ++i)
+    scalars[i] = static_cast<std::uint16_t>(i);
+  std::vector<std::vector<std::uint16_t>> nested(16, scalars);
+
+  std::vector<benchmark_record> records(10000);
+  for (std::size_t i = 0; i < records.size(); ++i)
+  {
+    records[i].id = static_cast<std::uint32_t>(i);
+    records[i].name = "record " + std::to_string(i);
+    records[i].samples.assign(i % 8, 1.0f);
+  }
+
+  std::cout << "serialization benchmark:" << std::endl;
+  benchmark<native>("vector<float>, native order", floats, 20);
+  benchmark<swapped>("vector<float>, swapped order", floats, 20);
+  benchmark<native>("vector<vector<uint16_t>>", nested, 20);
+  benchmark<native>("vector of records", records, 20);
 }
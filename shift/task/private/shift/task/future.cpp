@@ -3,14 +3,62 @@
 
 namespace shift::task::detail
 {
-void associated_state_base::queue_task(std::unique_ptr<task_base> new_task)
+bool associated_state_base::add_continuation(continuation& node) noexcept
+{
+  auto head = continuations.load(std::memory_order_acquire);
+  do
+  {
+    if (head == ready_tag)
+      return false;
+    node.next_continuation = reinterpret_cast<continuation*>(head);
+  } while (!continuations.compare_exchange_weak(
+    head, reinterpret_cast<std::uintptr_t>(&node), std::memory_order_release,
+    std::memory_order_acquire));
+  return true;
+}
+
+void associated_state_base::wait()
 {
-  if (ready != 0)
-    task_system::singleton_instance().queue(std::move(new_task));
-  else
+  // Only leave the current task if there is no result, yet.
+  if (!is_ready())
+    task_system::singleton_instance().wait_ready(*this);
+}
+
+void associated_state_base::claim()
+{
+  if (has_stored_result.test_and_set(std::memory_order_relaxed))
   {
-    task_system::singleton_instance().queue_blocked(std::move(new_task),
-                                                    condition, state_mutex);
+    BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
+                            future_error_code::promise_already_satisfied));
   }
 }
+
+void associated_state_base::notify()
+{
+  auto head = continuations.exchange(ready_tag, std::memory_order_acq_rel);
+  BOOST_ASSERT(head != ready_tag);
+  // Reverse the list to notify continuations in the order they were added.
+  continuation* reversed = nullptr;
+  for (auto* node = reinterpret_cast<continuation*>(head); node != nullptr;)
+  {
+    auto* next = node->next_continuation;
+    node->next_continuation = reversed;
+    reversed = node;
+    node = next;
+  }
+  while (reversed != nullptr)
+  {
+    // The node may be reused as soon as it is notified.
+    auto* next = reversed->next_continuation;
+    reversed->next_continuation = nullptr;
+    reversed->on_ready();
+    reversed = next;
+  }
+}
+
+void associated_state_base::queue_task(std::unique_ptr<task_base> new_task)
+{
+  task_system::singleton_instance().queue_continuation(*this,
+                                                       std::move(new_task));
+}
 }
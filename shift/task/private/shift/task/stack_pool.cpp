@@ -0,0 +1,84 @@
+#include "shift/task/stack_pool.hpp"
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#include <boost/context/stack_traits.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <algorithm>
+
+namespace shift::task
+{
+thread_local stack_pool* stack_pool::current = nullptr;
+
+stack_pool::stack_pool()
+{
+  // Reserve all memory upfront so that deallocate never throws.
+  _stacks.reserve(max_cached_stacks);
+}
+
+stack_pool::~stack_pool()
+{
+  clear();
+}
+
+boost::context::stack_context stack_pool::allocate(std::size_t stack_size)
+{
+  // Most tasks use the default stack size, so searching backwards usually
+  // hits on the first element.
+  for (auto i = _stacks.size(); i > 0; --i)
+  {
+    if (_stacks[i - 1].size == stack_size)
+    {
+      auto stack = _stacks[i - 1].context;
+      _stacks[i - 1] = _stacks.back();
+      _stacks.pop_back();
+      _reuses.fetch_add(1, std::memory_order_relaxed);
+      return stack;
+    }
+  }
+  _allocations.fetch_add(1, std::memory_order_relaxed);
+  return boost::context::protected_fixedsize_stack{stack_size}.allocate();
+}
+
+void stack_pool::deallocate(std::size_t stack_size,
+                            boost::context::stack_context& stack)
+{
+  if (_stacks.size() < max_cached_stacks)
+    _stacks.push_back(cached_stack{stack_size, stack});
+  else
+    boost::context::protected_fixedsize_stack{stack_size}.deallocate(stack);
+}
+
+void stack_pool::clear()
+{
+  for (auto& stack : _stacks)
+  {
+    boost::context::protected_fixedsize_stack{stack.size}.deallocate(
+      stack.context);
+  }
+  _stacks.clear();
+}
+
+pooled_stack_allocator::pooled_stack_allocator(std::size_t stack_size) noexcept
+: _stack_size(
+    stack_size == 0
+      ? boost::context::stack_traits::default_size()
+      : std::max(stack_size, boost::context::stack_traits::minimum_size()))
+{
+}
+
+boost::context::stack_context pooled_stack_allocator::allocate()
+{
+  if (stack_pool::current != nullptr)
+    return stack_pool::current->allocate(_stack_size);
+  return boost::context::protected_fixedsize_stack{_stack_size}.allocate();
+}
+
+void pooled_stack_allocator::deallocate(
+  boost::context::stack_context& stack) noexcept
+{
+  if (stack_pool::current != nullptr)
+    stack_pool::current->deallocate(_stack_size, stack);
+  else
+    boost::context::protected_fixedsize_stack{_stack_size}.deallocate(stack);
+}
+}
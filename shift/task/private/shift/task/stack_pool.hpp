@@ -0,0 +1,100 @@
+#ifndef SHIFT_TASK_STACK_POOL_HPP
+#define SHIFT_TASK_STACK_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/context/stack_context.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+
+namespace shift::task
+{
+/// A cache of guard page protected coroutine stacks owned by a single worker
+/// thread.
+/// @remarks
+///   Stacks released by finished tasks are kept for reuse instead of being
+///   unmapped, which is considerably cheaper for short running tasks. Only
+///   the reuse counters may be accessed from other threads.
+class stack_pool
+{
+public:
+  /// The maximum number of unused stacks kept by a single pool.
+  static constexpr std::size_t max_cached_stacks = 64;
+
+  /// Constructor.
+  stack_pool();
+
+  stack_pool(const stack_pool&) = delete;
+  stack_pool(stack_pool&&) = delete;
+
+  /// Destructor.
+  ~stack_pool();
+
+  stack_pool& operator=(const stack_pool&) = delete;
+  stack_pool& operator=(stack_pool&&) = delete;
+
+  /// Returns a cached stack of the requested size, or allocates a new one.
+  boost::context::stack_context allocate(std::size_t stack_size);
+
+  /// Returns a stack to the pool. The stack is released immediately if the
+  /// pool is full.
+  void deallocate(std::size_t stack_size, boost::context::stack_context& stack);
+
+  /// Releases all cached stacks.
+  void clear();
+
+  /// Returns the number of allocations served from the cache.
+  std::uint64_t reuses() const
+  {
+    return _reuses.load(std::memory_order_relaxed);
+  }
+
+  /// Returns the number of allocations which required a new stack.
+  std::uint64_t allocations() const
+  {
+    return _allocations.load(std::memory_order_relaxed);
+  }
+
+  /// The pool of the current worker thread, or nullptr for any other thread.
+  static thread_local stack_pool* current;
+
+private:
+  struct cached_stack
+  {
+    std::size_t size;
+    boost::context::stack_context context;
+  };
+
+  std::vector<cached_stack> _stacks;
+  std::atomic<std::uint64_t> _reuses = ATOMIC_VAR_INIT(0);
+  std::atomic<std::uint64_t> _allocations = ATOMIC_VAR_INIT(0);
+};
+
+/// A StackAllocator for boost::coroutines2 which takes its stacks from the
+/// current worker's stack_pool.
+/// @remarks
+///   Threads other than task workers, as well as stacks outliving their
+///   worker, fall back to plain protected fixed size stacks.
+class pooled_stack_allocator
+{
+public:
+  /// Constructor.
+  /// @param stack_size
+  ///   The requested stack size in bytes, or zero to use the platform's
+  ///   default coroutine stack size.
+  explicit pooled_stack_allocator(std::size_t stack_size) noexcept;
+
+  ///
+  boost::context::stack_context allocate();
+
+  ///
+  void deallocate(boost::context::stack_context& stack) noexcept;
+
+private:
+  std::size_t _stack_size;
+};
+}
+
+#endif
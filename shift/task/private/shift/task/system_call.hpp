@@ -13,11 +13,9 @@ struct task_queue
   std::unique_ptr<task_base> task;
 };
 
-struct task_queue_blocked
+struct task_wait_ready
 {
-  std::unique_ptr<task_base> task;
-  condition_variable* condition = nullptr;
-  mutex* lock = nullptr;
+  detail::associated_state_base* state = nullptr;
 };
 
 struct task_yield
@@ -51,7 +49,7 @@ struct task_end
 };
 
 using system_call_t =
-  std::variant<task_queue, task_queue_blocked, task_yield, task_lock_mutex,
+  std::variant<task_queue, task_wait_ready, task_yield, task_lock_mutex,
                task_wait_condition, task_end>;
 }
 
@@ -1,9 +1,9 @@
 #include "shift/task/task_impl.hpp"
 #include "shift/task/task_system_impl.hpp"
+#include "shift/task/stack_pool.hpp"
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/coroutine2/coroutine.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
-#include <functional>
 #include <utility>
 
 namespace shift::task
@@ -11,10 +11,8 @@ namespace shift::task
 std::atomic<task_id_t> task_base::impl::next_id = ATOMIC_VAR_INIT(0);
 
 task_base::impl::impl(const task_create_info& create_info,
-                      std::function<void()> function) noexcept
-: task_create_info(create_info),
-  id(++next_id),
-  wrapped_function(std::move(function))
+                      task_base& owner) noexcept
+: task_create_info(create_info), id(++next_id), owner(owner)
 {
 }
 
@@ -25,14 +23,16 @@ system_call_t task_base::impl::resume()
 
   if (!coro)
   {
-    // Creating the coroutine executes the lambda.
-    coro = std::make_unique<asymmetric_coroutine::pull_type>(
+    // Creating the coroutine executes the lambda. The stack is taken from
+    // the current worker's pool.
+    coro.emplace(
+      pooled_stack_allocator{stack_size()},
       [&](asymmetric_coroutine::push_type& the_sink) {
         // Store a pointer to the sink in a member variable, so it does not
         // have to be passed through each function call.
         sink = &the_sink;
         // Execute the actual function.
-        wrapped_function();
+        owner.execute();
       });
   }
   else
@@ -49,9 +49,15 @@ void task_base::impl::system_call(system_call_t system_call_args)
   (*sink)(std::move(system_call_args));
 }
 
-task_base::task_base(const task_create_info& create_info,
-                     std::function<void()> wrapped_function)
-: _impl(std::make_unique<impl>(create_info, std::move(wrapped_function)))
+void task_base::impl::on_ready()
+{
+  // The task system took over ownership when parking the task.
+  task_system::singleton_instance().resume_parked(
+    std::unique_ptr<task_base>(&owner));
+}
+
+task_base::task_base(const task_create_info& create_info)
+: _impl(std::make_unique<impl>(create_info, *this))
 {
 }
 
@@ -69,13 +75,18 @@ task_id_t task_base::id() const
   return _impl->id;
 }
 
-void task_base::worker_affinity(worker_affinity_t affinity)
+void task_base::worker_affinity(worker_set affinity)
 {
-  _impl->worker_affinity(affinity);
+  _impl->worker_affinity(std::move(affinity));
 }
 
 worker_affinity_t task_base::worker_affinity() const
 {
   return _impl->worker_affinity();
 }
+
+const worker_set& task_base::affine_workers() const
+{
+  return _impl->affine_workers();
+}
 }
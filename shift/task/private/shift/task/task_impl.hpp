@@ -1,7 +1,7 @@
 #ifndef SHIFT_TASK_TASK_IMPL_HPP
 #define SHIFT_TASK_TASK_IMPL_HPP
 
-#include <functional>
+#include <optional>
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/coroutine2/coroutine.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
@@ -13,11 +13,13 @@ namespace shift::task
 using asymmetric_coroutine =
   boost::coroutines2::asymmetric_coroutine<system_call_t>;
 
-struct task_base::impl : public task_create_info
+struct task_base::impl : public task_create_info, public detail::continuation
 {
   /// Constructor.
-  explicit impl(const task_create_info& create_info,
-                std::function<void()> function) noexcept;
+  explicit impl(const task_create_info& create_info, task_base& owner) noexcept;
+
+  /// Destructor.
+  ~impl() override = default;
 
   impl(const impl&) = delete;
   impl(impl&&) = delete;
@@ -30,11 +32,14 @@ struct task_base::impl : public task_create_info
   ///
   void system_call(system_call_t system_call_args);
 
+  /// Makes the task runnable again after it has been parked on a future.
+  void on_ready() override;
+
   static std::atomic<task_id_t> next_id;
   task_id_t id;
-  std::unique_ptr<asymmetric_coroutine::pull_type> coro;
+  std::optional<asymmetric_coroutine::pull_type> coro;
   asymmetric_coroutine::push_type* sink = nullptr;
-  std::function<void()> wrapped_function;
+  task_base& owner;
 };
 }
 
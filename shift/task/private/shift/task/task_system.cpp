@@ -23,9 +23,8 @@ task_system& task_system::num_workers(std::size_t count)
 
   if (count == 0)
     count = std::max(std::thread::hardware_concurrency(), 1u);
-  // Limit the number of workers to the number of bits in worker_affinity_t.
-  count = std::min(count, sizeof(worker_affinity_t) * 8);
   _impl->workers.resize(count);
+  _impl->assign_worker_groups();
   return *this;
 }
 
@@ -34,6 +33,32 @@ std::uint32_t task_system::num_workers() const
   return static_cast<std::uint32_t>(_impl->workers.size());
 }
 
+task_system& task_system::scheduler(scheduler_mode mode)
+{
+  BOOST_ASSERT(!_impl->running);
+  if (_impl->running)
+    return *this;  /// ToDo: Throw logic_error.
+
+  _impl->mode = mode;
+  return *this;
+}
+
+scheduler_mode task_system::scheduler() const
+{
+  return _impl->mode;
+}
+
+std::size_t task_system::num_worker_groups() const
+{
+  return _impl->worker_groups.size();
+}
+
+const worker_set& task_system::worker_group(std::size_t group_index) const
+{
+  BOOST_ASSERT(group_index < _impl->worker_groups.size());
+  return _impl->worker_groups[group_index];
+}
+
 int task_system::join()
 {
   for (auto& worker : _impl->workers)
@@ -51,6 +76,20 @@ bool task_system::running() const noexcept
   return _impl->running;
 }
 
+task_system_statistics task_system::statistics() const
+{
+  task_system_statistics result;
+  result.wakeups = _impl->wakeup_count.load(std::memory_order_relaxed);
+  result.futile_wakeups =
+    _impl->futile_wakeup_count.load(std::memory_order_relaxed);
+  for (const auto& pool : _impl->stack_pools)
+  {
+    result.stack_reuses += pool->reuses();
+    result.stack_allocations += pool->allocations();
+  }
+  return result;
+}
+
 task_base* task_system::current_task() const
 {
   return _impl->current_task;
@@ -72,8 +111,23 @@ void task_system::initialize(std::unique_ptr<task_result<int>> primary_task)
 
   _impl->running = true;
   _impl->result = primary_task->get_future();
-  _impl->queued_tasks.emplace_back(std::move(primary_task));
-  _impl->worker_should_have_tasks = all_workers;
+  _impl->worker_should_have_tasks.resize(_impl->workers.size());
+  _impl->spinning_workers.resize(_impl->workers.size());
+  _impl->sleeping_workers.resize(_impl->workers.size());
+  while (_impl->stack_pools.size() < _impl->workers.size())
+    _impl->stack_pools.emplace_back(std::make_unique<stack_pool>());
+  if (_impl->mode == scheduler_mode::work_stealing)
+  {
+    for (auto& worker : _impl->workers)
+      worker.local_tasks = std::make_unique<work_stealing_deque<task_base*>>();
+    _impl->injected_tasks.emplace_back(std::move(primary_task));
+    ++_impl->injected_task_count;
+  }
+  else
+  {
+    _impl->worker_should_have_tasks.set(primary_task->affine_workers());
+    _impl->queued_tasks.emplace_back(std::move(primary_task));
+  }
   ++_impl->task_count;
 
   auto process_work = [&](worker_id_t worker_thread_id) {
@@ -84,11 +138,20 @@ void task_system::initialize(std::unique_ptr<task_result<int>> primary_task)
 
     std::condition_variable queue_condition;
     _impl->workers[worker_thread_id - 1].queue_condition = &queue_condition;
+    auto& worker_stack_pool = *_impl->stack_pools[worker_thread_id - 1];
+    stack_pool::current = &worker_stack_pool;
 
     std::stringstream thread_debug_name;
     thread_debug_name << "task worker thread #" << worker_thread_id;
     platform::environment::thread_debug_name(thread_debug_name.str());
 
+    // Keep workers on the processors of their NUMA node.
+    if (_impl->group_processors.size() > 1)
+    {
+      platform::environment::thread_processor_affinity(
+        _impl->group_processors[_impl->workers[worker_thread_id - 1].group]);
+    }
+
     // Wait until all worker threads started.
     {
       impl::queue_lock_t start_lock(_impl->start_stop_mutex);
@@ -109,7 +172,9 @@ void task_system::initialize(std::unique_ptr<task_result<int>> primary_task)
       {
         // Process system call.
         {
-          impl::queue_lock_t queue_lock(_impl->queue_mutex);
+          impl::queue_lock_t queue_lock(_impl->queue_mutex, std::defer_lock);
+          if (_impl->requires_queue_lock(system_call))
+            queue_lock.lock();
           current_task = std::visit(
             [&](auto& command) -> std::unique_ptr<task_base> {
               return (*_impl)(command, std::move(current_task), queue_lock);
@@ -136,6 +201,8 @@ void task_system::initialize(std::unique_ptr<task_result<int>> primary_task)
     _impl->start_stop_condition.notify_all();
 
     _impl->workers[worker_thread_id - 1].queue_condition = nullptr;
+    stack_pool::current = nullptr;
+    worker_stack_pool.clear();
   };
 
   _impl->worker_threads_starting =
@@ -154,15 +221,39 @@ void task_system::queue(std::unique_ptr<task_base> new_task)
     _impl->current_task->_impl->system_call(task_queue{std::move(new_task)});
 }
 
-void task_system::queue_blocked(std::unique_ptr<task_base> new_task,
-                                condition_variable& condition, mutex& lock)
+void task_system::wait_ready(detail::associated_state_base& state)
 {
-  BOOST_ASSERT(_impl->current_task);
   if (_impl->current_task != nullptr)
   {
-    _impl->current_task->_impl->system_call(
-      task_queue_blocked{std::move(new_task), &condition, &lock});
+    while (!state.is_ready())
+      _impl->current_task->_impl->system_call(task_wait_ready{&state});
   }
+  else
+  {
+    // Threads outside of the task system cannot be parked.
+    while (!state.is_ready())
+      std::this_thread::yield();
+  }
+}
+
+void task_system::queue_continuation(detail::associated_state_base& state,
+                                     std::unique_ptr<task_base> new_task)
+{
+  // The task has to be counted before it gets visible to other workers.
+  ++_impl->task_count;
+  if (state.add_continuation(*new_task->_impl))
+    new_task.release();
+  else
+    resume_parked(std::move(new_task));
+}
+
+void task_system::resume_parked(std::unique_ptr<task_base> parked_task)
+{
+  // Directly call implementation without leaving coroutine context.
+  impl::queue_lock_t queue_lock(_impl->queue_mutex, std::defer_lock);
+  if (_impl->mode == scheduler_mode::global_queue)
+    queue_lock.lock();
+  _impl->make_ready(std::move(parked_task));
 }
 
 void task_system::lock_mutex(mutex& lock)
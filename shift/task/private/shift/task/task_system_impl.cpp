@@ -1,7 +1,26 @@
 #include "shift/task/task_system_impl.hpp"
+#include "shift/task/task_impl.hpp"
+#include <shift/platform/environment.hpp>
+#include <algorithm>
 
 namespace shift::task
 {
+namespace
+{
+  /// Returns a pseudo random number used to select victims to steal tasks
+  /// from.
+  std::uint32_t next_random()
+  {
+    // Xorshift32, seeded differently for each thread.
+    static thread_local std::uint32_t state = static_cast<std::uint32_t>(
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1u);
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+}
+
 thread_local task_base* task_system::impl::current_task;
 thread_local std::uint32_t task_system::impl::current_worker_id;
 
@@ -13,6 +32,39 @@ task_system::impl::impl(unsigned int fp_exceptions,
 
 task_system::impl::~impl() = default;
 
+void task_system::impl::assign_worker_groups()
+{
+  worker_groups.clear();
+  group_processors.clear();
+
+  auto nodes = platform::environment::numa_nodes();
+  nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
+                             [](const auto& processors) {
+                               return processors.empty();
+                             }),
+              nodes.end());
+  if (nodes.size() <= 1 || workers.size() < nodes.size())
+  {
+    // Without NUMA topology there is only a single group of all workers.
+    worker_groups.emplace_back(worker_set::all());
+    for (auto& worker : workers)
+      worker.group = 0;
+    return;
+  }
+
+  // Distribute workers evenly across NUMA nodes in contiguous blocks.
+  worker_groups.resize(nodes.size(), worker_set::none());
+  for (std::size_t worker_index = 0; worker_index < workers.size();
+       ++worker_index)
+  {
+    auto group =
+      static_cast<std::uint32_t>(worker_index * nodes.size() / workers.size());
+    workers[worker_index].group = group;
+    worker_groups[group].insert(static_cast<worker_id_t>(worker_index + 1));
+  }
+  group_processors = std::move(nodes);
+}
+
 std::unique_ptr<task_base> task_system::impl::operator()(
   task_queue& command, std::unique_ptr<task_base> calling_task,
   task_system::impl::queue_lock_t& /*queue_lock*/)
@@ -21,48 +73,55 @@ std::unique_ptr<task_base> task_system::impl::operator()(
   if (!command.task)
     return calling_task;
 
-  // Put new tasks on the task queue.
-  worker_should_have_tasks |= command.task->worker_affinity();
-  queued_tasks.emplace_back(std::move(command.task));
+  // Put new tasks on the task queue. The task has to be counted before it
+  // gets visible to other workers, which might otherwise finish it early.
   ++task_count;
-
-  /// ToDo: Only signal a single worker.
-  for (auto& worker : workers)
-    worker.queue_condition->notify_one();
+  make_ready(std::move(command.task));
 
   // Continue executing current task.
   return calling_task;
 }
 
 std::unique_ptr<task_base> task_system::impl::operator()(
-  task_queue_blocked& command, std::unique_ptr<task_base> calling_task,
+  task_wait_ready command, std::unique_ptr<task_base> calling_task,
   task_system::impl::queue_lock_t& queue_lock)
 {
-  // Put new tasks on the blocked task queue.
-  (*this)(task_unlock_mutex{command.lock}, queue_lock);
-  blocking_tasks.insert(
-    std::make_pair(command.condition, std::move(command.task)));
-  ++task_count;
-  /// ToDo: Only signal a single worker.
-  for (auto& worker : workers)
-    worker.queue_condition->notify_one();
+  BOOST_ASSERT(calling_task);
+  if (!calling_task)
+    return nullptr;
 
-  // Continue executing current task.
-  return calling_task;
+  // The coroutine has already been left, so the task may safely be resumed
+  // by another worker as soon as it is registered with the state.
+  if (!command.state->add_continuation(*calling_task->_impl))
+    return calling_task;
+  calling_task.release();
+  return schedule_task(queue_lock);
 }
 
 std::unique_ptr<task_base> task_system::impl::operator()(
   task_yield /*command*/, std::unique_ptr<task_base> calling_task,
   task_system::impl::queue_lock_t& queue_lock)
 {
-  if (calling_task)
+  if (calling_task && mode == scheduler_mode::work_stealing)
+  {
+    auto next_task = find_task();
+    if (!next_task)
+    {
+      // There is nothing else to do, so continue executing the current task.
+      current_task = calling_task.get();
+      return calling_task;
+    }
+    make_ready(std::move(calling_task));
+    return next_task;
+  }
+  else if (calling_task)
   {
     if (queued_tasks.empty())
     {
       // We would get the current task again, so take the fast path out.
       return calling_task;
     }
-    worker_should_have_tasks |= calling_task->worker_affinity();
+    worker_should_have_tasks.set(calling_task->affine_workers());
     queued_tasks.emplace_back(std::move(calling_task));
   }
   return schedule_task(queue_lock);
@@ -111,34 +170,30 @@ std::unique_ptr<task_base> task_system::impl::operator()(
     return nullptr;
 
   // Free and forget calling_task.
+  calling_task.reset();
   if (--task_count == 0)
-  {
-    quit = true;
-    for (auto& worker : workers)
-      worker.queue_condition->notify_one();
-  }
+    signal_quit();
   return schedule_task(queue_lock);
 }
 
 void task_system::impl::operator()(
   task_unlock_mutex command, task_system::impl::queue_lock_t& /*queue_lock*/)
 {
-  // Find tasks in blocking_tasks and move them to the queued_tasks queue.
-  command.lock->_flag.clear(std::memory_order_release);
-  auto range = blocking_tasks.equal_range(command.lock);
-  for (auto task_iter = range.first; task_iter != range.second; ++task_iter)
+  // Hand the mutex over to a single blocking task, which returns from
+  // mutex::lock owning it. Waking all blocking tasks would let each of them
+  // enter the critical section. The flag thus stays set unless there is no
+  // task waiting.
+  auto task_iter = blocking_tasks.find(command.lock);
+  if (task_iter == blocking_tasks.end())
   {
-    worker_should_have_tasks |= task_iter->second->worker_affinity();
-    queued_tasks.emplace_back(std::move(task_iter->second));
-
-    // Notify an idle worker thread.
-    /// ToDo: Delay notification until the global queue_mutex has been
-    /// released.
-    /// ToDo: Only signal a single worker.
-    for (auto& worker : workers)
-      worker.queue_condition->notify_one();
+    command.lock->_flag.clear(std::memory_order_release);
+    return;
   }
-  blocking_tasks.erase(range.first, range.second);
+  // Notify an idle worker thread.
+  /// ToDo: Delay notification until the global queue_mutex has been
+  /// released.
+  make_ready(std::move(task_iter->second));
+  blocking_tasks.erase(task_iter);
 }
 
 void task_system::impl::operator()(
@@ -150,13 +205,9 @@ void task_system::impl::operator()(
   auto task_iter = range.first;
   while (task_iter != range.second)
   {
-    worker_should_have_tasks |= task_iter->second->worker_affinity();
-    queued_tasks.emplace_back(std::move(task_iter->second));
+    make_ready(std::move(task_iter->second));
     ++task_iter;
 
-    /// ToDo: Only signal a single worker, but not the wrong one.
-    for (auto& worker : workers)
-      worker.queue_condition->notify_one();
     if (command.count > 0)
     {
       if (--command.count == 0)
@@ -169,41 +220,305 @@ void task_system::impl::operator()(
 std::unique_ptr<task_base> task_system::impl::schedule_task(
   task_system::impl::queue_lock_t& queue_lock)
 {
+  if (mode == scheduler_mode::work_stealing)
+  {
+    // The global queue_mutex is not needed to find runnable tasks.
+    if (queue_lock.owns_lock())
+      queue_lock.unlock();
+    return find_or_wait_for_task();
+  }
+
+  bool idle = false;
+  bool woken = false;
   for (;;)
   {
-    workers[current_worker_id - 1].queue_condition->wait(queue_lock, [&]() {
-      return quit || (!queued_tasks.empty() &&
-                      ((worker_should_have_tasks &
-                        (1u << (current_worker_id - 1))) != 0u));
-    });
     if (quit)
       return nullptr;
-    else if (!queued_tasks.empty())
+    if (!queued_tasks.empty() &&
+        worker_should_have_tasks.test(current_worker_index()))
     {
       // Walk through list of queued tasks to find one that is affine to this
       // worker.
       for (auto task_iter = std::begin(queued_tasks);
            task_iter != std::end(queued_tasks); ++task_iter)
       {
-        if (((*task_iter)->worker_affinity() &
-             (1u << (current_worker_id - 1))) != 0u)
+        if ((*task_iter)->affine_workers().contains(current_worker_id))
         {
           auto task = std::move(*task_iter);
           queued_tasks.erase(task_iter);
           current_task = task.get();
+          if (idle)
+            propagate_wakeup();
           return task;
         }
       }
       // Even though worker_should_have_tasks had this worker's bit set, it
       // was no guarantee that there actually was a waiting task affine to
       // this worker. Thus, clear the bit now and try again.
-      worker_should_have_tasks &= ~(1u << (current_worker_id - 1));
+      worker_should_have_tasks.reset(current_worker_index());
+    }
+    if (woken)
+    {
+      futile_wakeup_count.fetch_add(1, std::memory_order_relaxed);
+      woken = false;
+    }
+    idle = true;
+
+    // Poll for new tasks for a short while before going to sleep. Workers
+    // register as spinning so that wake_worker prefers them over sleeping
+    // ones.
+    spinning_workers.set(current_worker_index());
+    queue_lock.unlock();
+    for (int round = 0; round < spin_rounds; ++round)
+    {
+      if (quit || worker_should_have_tasks.test(current_worker_index()))
+        break;
+      std::this_thread::yield();
+    }
+    queue_lock.lock();
+    spinning_workers.reset(current_worker_index());
+    if (quit || (!queued_tasks.empty() &&
+                 worker_should_have_tasks.test(current_worker_index())))
+    {
       continue;
     }
-    else
+
+    sleeping_workers.set(current_worker_index());
+    workers[current_worker_index()].queue_condition->wait(queue_lock, [&]() {
+      return quit || !sleeping_workers.test(current_worker_index());
+    });
+    sleeping_workers.reset(current_worker_index());
+    woken = true;
+  }
+}
+
+bool task_system::impl::requires_queue_lock(
+  const system_call_t& system_call) const
+{
+  if (mode == scheduler_mode::global_queue)
+    return true;
+  // In work stealing mode only accesses to blocking_tasks need to be
+  // synchronized.
+  return !std::holds_alternative<task_queue>(system_call) &&
+         !std::holds_alternative<task_wait_ready>(system_call) &&
+         !std::holds_alternative<task_yield>(system_call) &&
+         !std::holds_alternative<task_end>(system_call);
+}
+
+void task_system::impl::make_ready(std::unique_ptr<task_base> task)
+{
+  if (mode == scheduler_mode::global_queue)
+  {
+    worker_should_have_tasks.set(task->affine_workers());
+    const auto& queued_task = queued_tasks.emplace_back(std::move(task));
+    wake_worker(queued_task->affine_workers());
+    return;
+  }
+
+  // Keep a copy because the task may already be running and change its
+  // affinity once it is visible to other workers.
+  auto affinity = task->affine_workers();
+
+  if (current_worker_id != no_worker && unrestricted(affinity))
+  {
+    // Unrestricted tasks spawned by a worker go to its own deque, from where
+    // other workers may steal them.
+    workers[current_worker_index()].local_tasks->push(task.release());
+  }
+  else
+  {
+    std::lock_guard injection_lock(injection_mutex);
+    injected_tasks.emplace_back(std::move(task));
+    ++injected_task_count;
+  }
+  wake_worker(affinity);
+}
+
+void task_system::impl::signal_quit()
+{
+  if (mode == scheduler_mode::global_queue)
+  {
+    quit = true;
+    for (auto& worker : workers)
+      worker.queue_condition->notify_one();
+    return;
+  }
+
+  std::lock_guard sleep_lock(sleep_mutex);
+  quit = true;
+  for (auto& worker : workers)
+    worker.queue_condition->notify_one();
+}
+
+bool task_system::impl::unrestricted(const worker_set& affinity) const
+{
+  if (affinity.is_all())
+    return true;
+  for (worker_id_t worker_id = 1; worker_id <= workers.size(); ++worker_id)
+  {
+    if (!affinity.contains(worker_id))
+      return false;
+  }
+  return true;
+}
+
+std::unique_ptr<task_base> task_system::impl::find_task()
+{
+  auto worker_index = current_worker_index();
+  task_base* task = workers[worker_index].local_tasks->pop();
+  if (task == nullptr &&
+      injected_task_count.load(std::memory_order_relaxed) != 0)
+  {
+    task = pop_injected_task().release();
+  }
+  if (task == nullptr && workers.size() > 1)
+  {
+    // Start with a random victim and try each other worker once.
+    auto worker_count = static_cast<std::uint32_t>(workers.size());
+    auto victim = next_random() % worker_count;
+    for (auto i = 0u; i < worker_count && task == nullptr; ++i)
+    {
+      if (victim != worker_index)
+        task = workers[victim].local_tasks->steal();
+      if (++victim == worker_count)
+        victim = 0;
+    }
+  }
+  if (task != nullptr)
+    current_task = task;
+  return std::unique_ptr<task_base>(task);
+}
+
+std::unique_ptr<task_base> task_system::impl::pop_injected_task()
+{
+  std::lock_guard injection_lock(injection_mutex);
+  for (auto task_iter = std::begin(injected_tasks);
+       task_iter != std::end(injected_tasks); ++task_iter)
+  {
+    if ((*task_iter)->affine_workers().contains(current_worker_id))
     {
-      BOOST_ASSERT(false);
+      auto task = std::move(*task_iter);
+      injected_tasks.erase(task_iter);
+      --injected_task_count;
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+bool task_system::impl::has_visible_work()
+{
+  for (const auto& worker : workers)
+  {
+    if (!worker.local_tasks->empty())
+      return true;
+  }
+  if (injected_task_count.load(std::memory_order_relaxed) == 0)
+    return false;
+
+  std::lock_guard injection_lock(injection_mutex);
+  for (const auto& task : injected_tasks)
+  {
+    if (task->affine_workers().contains(current_worker_id))
+      return true;
+  }
+  return false;
+}
+
+std::unique_ptr<task_base> task_system::impl::find_or_wait_for_task()
+{
+  bool woken = false;
+  for (;;)
+  {
+    if (quit)
       return nullptr;
+    if (auto task = find_task(); task)
+      return task;
+    if (woken)
+    {
+      futile_wakeup_count.fetch_add(1, std::memory_order_relaxed);
+      woken = false;
+    }
+
+    // Poll for new tasks for a short while before going to sleep. Workers
+    // register as spinning so that wake_worker prefers them over sleeping
+    // ones.
+    spinning_workers.set(current_worker_index());
+    for (int round = 0; round < spin_rounds && !quit; ++round)
+    {
+      if (auto task = find_task(); task)
+      {
+        spinning_workers.reset(current_worker_index());
+        propagate_wakeup();
+        return task;
+      }
+      std::this_thread::yield();
+    }
+
+    std::unique_lock sleep_lock(sleep_mutex);
+    sleeping_workers.set(current_worker_index());
+    spinning_workers.reset(current_worker_index());
+    // Pairs with the fence in wake_worker to make sure that either we see the
+    // new task or the waking thread sees this worker sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!quit && !has_visible_work())
+    {
+      workers[current_worker_index()].queue_condition->wait(sleep_lock, [&]() {
+        return quit || !sleeping_workers.test(current_worker_index());
+      });
+      woken = true;
+    }
+    sleeping_workers.reset(current_worker_index());
+  }
+}
+
+void task_system::impl::wake_worker(const worker_set& affinity)
+{
+  std::unique_lock<std::mutex> sleep_lock;
+  if (mode == scheduler_mode::work_stealing)
+  {
+    // Pairs with the fence in find_or_wait_for_task.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+  if (spinning_workers.intersects(affinity) ||
+      !sleeping_workers.intersects(affinity))
+  {
+    return;
+  }
+
+  if (mode == scheduler_mode::work_stealing)
+    sleep_lock = std::unique_lock(sleep_mutex);
+  auto worker_index = sleeping_workers.find_first(affinity);
+  if (worker_index == worker_bitmap::npos)
+    return;
+  // Clearing the bit tells the worker that it has been woken on purpose, and
+  // prevents other threads from waking the same worker again.
+  sleeping_workers.reset(worker_index);
+  wakeup_count.fetch_add(1, std::memory_order_relaxed);
+  workers[worker_index].queue_condition->notify_one();
+}
+
+void task_system::impl::propagate_wakeup()
+{
+  if (mode == scheduler_mode::global_queue)
+  {
+    // Wake a worker which is allowed to run the next queued task.
+    if (!queued_tasks.empty())
+      wake_worker(queued_tasks.front()->affine_workers());
+    return;
+  }
+
+  if (injected_task_count.load(std::memory_order_relaxed) != 0)
+  {
+    wake_worker(worker_set::all());
+    return;
+  }
+  for (const auto& worker : workers)
+  {
+    if (!worker.local_tasks->empty())
+    {
+      wake_worker(worker_set::all());
+      return;
     }
   }
 }
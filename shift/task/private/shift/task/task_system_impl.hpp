@@ -9,6 +9,9 @@
 #include <thread>
 #include "shift/task/system_call.hpp"
 #include "shift/task/task_system.hpp"
+#include "shift/task/work_stealing_deque.hpp"
+#include "shift/task/worker_bitmap.hpp"
+#include "shift/task/stack_pool.hpp"
 
 namespace shift::task
 {
@@ -29,7 +32,7 @@ struct task_system::impl
                                         queue_lock_t& queue_lock);
 
   ///
-  std::unique_ptr<task_base> operator()(task_queue_blocked& command,
+  std::unique_ptr<task_base> operator()(task_wait_ready command,
                                         std::unique_ptr<task_base> calling_task,
                                         queue_lock_t& queue_lock);
 
@@ -62,27 +65,113 @@ struct task_system::impl
   ///
   std::unique_ptr<task_base> schedule_task(queue_lock_t& queue_lock);
 
+  /// Groups workers by NUMA node, if the platform reports more than a single
+  /// node.
+  void assign_worker_groups();
+
+  /// Returns whether processing the passed system call requires queue_mutex
+  /// to be locked.
+  bool requires_queue_lock(const system_call_t& system_call) const;
+
+  /// Hands a runnable task over to the worker threads.
+  /// @remarks
+  ///   In scheduler_mode::global_queue the caller must hold queue_mutex.
+  void make_ready(std::unique_ptr<task_base> task);
+
+  /// Sets the quit flag and wakes all worker threads.
+  void signal_quit();
+
+  /// Returns whether the passed affinity mask allows the task to be run by all
+  /// worker threads.
+  bool unrestricted(const worker_set& affinity) const;
+
+  /// Pops a task from the current worker's deque, the injection queue, or
+  /// steals one from another worker. Returns nullptr if no task was found.
+  /// @remarks
+  ///   Only used in scheduler_mode::work_stealing.
+  std::unique_ptr<task_base> find_task();
+
+  /// Pops the first task from the injection queue that is affine to the
+  /// current worker.
+  std::unique_ptr<task_base> pop_injected_task();
+
+  /// Returns whether there is any task the current worker might be able to
+  /// run.
+  bool has_visible_work();
+
+  /// Loops until a task is found or the task system quits.
+  std::unique_ptr<task_base> find_or_wait_for_task();
+
+  /// Wakes a single sleeping worker which is allowed to run tasks with the
+  /// passed affinity mask. No worker is woken if there is a spinning worker
+  /// with matching affinity, because it will pick up the task anyway.
+  /// @remarks
+  ///   In scheduler_mode::global_queue the caller must hold queue_mutex.
+  void wake_worker(const worker_set& affinity);
+
+  /// Called by a worker which left the idle state with a task. Wakes another
+  /// worker if there is still work left.
+  void propagate_wakeup();
+
+  /// Returns the zero based index of the current worker.
+  static std::uint32_t current_worker_index()
+  {
+    return current_worker_id - 1;
+  }
+
   struct worker_thread_t
   {
     std::thread thread;
     std::condition_variable* queue_condition = nullptr;
+    /// Unrestricted tasks spawned by this worker, only used in
+    /// scheduler_mode::work_stealing.
+    std::unique_ptr<work_stealing_deque<task_base*>> local_tasks;
+    /// Index into worker_groups.
+    std::uint32_t group = 0;
   };
 
   static thread_local task_base* current_task;
   static thread_local std::uint32_t current_worker_id;
-  bool quit = false;
+  scheduler_mode mode = scheduler_mode::global_queue;
+  std::atomic<bool> quit = ATOMIC_VAR_INIT(false);
   std::atomic<std::uint32_t> worker_threads_starting = ATOMIC_VAR_INIT(0);
   std::atomic<std::uint32_t> worker_threads_stopping = ATOMIC_VAR_INIT(0);
   std::mutex start_stop_mutex;
   std::condition_variable start_stop_condition;
   bool running = false;
   std::vector<worker_thread_t> workers;
+  /// Coroutine stack pools indexed by worker index. Pools are kept after
+  /// joining the workers to preserve their statistics.
+  std::vector<std::unique_ptr<stack_pool>> stack_pools;
+  std::vector<worker_set> worker_groups;
+  /// The logical processors of each worker group. Empty if workers are not
+  /// bound to specific processors.
+  std::vector<std::vector<std::uint32_t>> group_processors;
   std::mutex queue_mutex;
   std::atomic<std::uint32_t> task_count = ATOMIC_VAR_INIT(0);
   std::deque<std::unique_ptr<task_base>> queued_tasks;
-  std::atomic<worker_affinity_t> worker_should_have_tasks = ATOMIC_VAR_INIT(0);
+  worker_bitmap worker_should_have_tasks;
   std::unordered_multimap<void*, std::unique_ptr<task_base>> blocking_tasks;
   std::mutex block_mutex;
+
+  std::mutex injection_mutex;
+  std::deque<std::unique_ptr<task_base>> injected_tasks;
+  std::atomic<std::uint32_t> injected_task_count = ATOMIC_VAR_INIT(0);
+  /// Used together with each worker's queue_condition in
+  /// scheduler_mode::work_stealing, where queue_mutex is not held while
+  /// looking for tasks.
+  std::mutex sleep_mutex;
+
+  /// The number of times an idle worker polls for new tasks before it goes to
+  /// sleep.
+  static constexpr int spin_rounds = 16;
+  /// Idle workers actively polling for new tasks.
+  worker_bitmap spinning_workers;
+  /// Idle workers blocked on their queue_condition. A worker's bit gets
+  /// cleared by the thread waking it.
+  worker_bitmap sleeping_workers;
+  std::atomic<std::uint64_t> wakeup_count = ATOMIC_VAR_INIT(0);
+  std::atomic<std::uint64_t> futile_wakeup_count = ATOMIC_VAR_INIT(0);
   unsigned int fp_exceptions;
   unsigned int fp_exception_mask;
   future<int> result;
@@ -4,6 +4,12 @@
 
 namespace shift::task
 {
+bool this_task::inside_task()
+{
+  return task_system::singleton_instantiated() &&
+         task_system::singleton_instance().current_task() != nullptr;
+}
+
 void this_task::yield()
 {
   auto* task = task_system::singleton_instance().current_task();
@@ -34,10 +40,10 @@ void this_task::bind_to_current_worker()
   BOOST_ASSERT(task);
   BOOST_ASSERT(worker_id != no_worker);
   if (task != nullptr)
-    task->worker_affinity(worker_id);
+    task->worker_affinity(worker_set::single(worker_id));
 }
 
-void this_task::worker_affinity(worker_affinity_t affinity)
+void this_task::worker_affinity(const worker_set& affinity)
 {
   auto* task = task_system::singleton_instance().current_task();
   BOOST_ASSERT(task);
@@ -57,4 +63,13 @@ worker_affinity_t this_task::worker_affinity()
     return 0;
   return task->worker_affinity();
 }
+
+worker_set this_task::affine_workers()
+{
+  auto* task = task_system::singleton_instance().current_task();
+  BOOST_ASSERT(task);
+  if (task == nullptr)
+    return worker_set::none();
+  return task->affine_workers();
+}
 }
@@ -0,0 +1,176 @@
+#ifndef SHIFT_TASK_WORK_STEALING_DEQUE_HPP
+#define SHIFT_TASK_WORK_STEALING_DEQUE_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+namespace shift::task
+{
+/// A lock-free single-producer multi-consumer deque as described by Chase and
+/// Lev in "Dynamic Circular Work-Stealing Deque" (2005), using the memory
+/// orderings proposed by Lê et al. in "Correct and Efficient Work-Stealing for
+/// Weak Memory Models" (2013).
+/// @remarks
+///   Only the owning thread may call push and pop, which operate on the bottom
+///   end of the deque. Any other thread may call steal, which removes elements
+///   from the top end.
+template <typename T>
+class work_stealing_deque
+{
+  static_assert(std::is_pointer_v<T>,
+                "work_stealing_deque only supports pointer elements.");
+
+public:
+  /// Constructor.
+  /// @param initial_capacity
+  ///   The initial number of elements, which must be a power of two.
+  explicit work_stealing_deque(std::int64_t initial_capacity = 1024)
+  {
+    auto initial_array = std::make_unique<array>(initial_capacity);
+    _array.store(initial_array.get(), std::memory_order_relaxed);
+    _arrays.emplace_back(std::move(initial_array));
+  }
+
+  work_stealing_deque(const work_stealing_deque&) = delete;
+  work_stealing_deque(work_stealing_deque&&) = delete;
+  ~work_stealing_deque() = default;
+  work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+  work_stealing_deque& operator=(work_stealing_deque&&) = delete;
+
+  /// Pushes an element to the bottom of the deque.
+  /// @remarks
+  ///   Must only be called by the owning thread.
+  void push(T element)
+  {
+    auto bottom = _bottom.load(std::memory_order_relaxed);
+    auto top = _top.load(std::memory_order_acquire);
+    auto* current_array = _array.load(std::memory_order_relaxed);
+    if (bottom - top > current_array->capacity - 1)
+      current_array = grow(current_array, bottom, top);
+    current_array->put(bottom, element);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  /// Pops an element from the bottom of the deque.
+  /// @return
+  ///   The most recently pushed element, or nullptr if the deque is empty.
+  /// @remarks
+  ///   Must only be called by the owning thread.
+  T pop()
+  {
+    auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    auto* current_array = _array.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = _top.load(std::memory_order_relaxed);
+
+    T element = nullptr;
+    if (top <= bottom)
+    {
+      element = current_array->get(bottom);
+      if (top == bottom)
+      {
+        // This is the last element, so we race against thieves.
+        if (!_top.compare_exchange_strong(top, top + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+        {
+          element = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+      }
+    }
+    else
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    return element;
+  }
+
+  /// Steals an element from the top of the deque.
+  /// @return
+  ///   The least recently pushed element, or nullptr if the deque is empty
+  ///   or if another thread won the race for the element.
+  /// @remarks
+  ///   May be called from any thread.
+  T steal()
+  {
+    auto top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = _bottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+      return nullptr;
+
+    auto* current_array = _array.load(std::memory_order_acquire);
+    T element = current_array->get(top);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+    {
+      return nullptr;
+    }
+    return element;
+  }
+
+  /// Returns whether the deque appears to be empty.
+  /// @remarks
+  ///   The result is only a snapshot and may be outdated immediately.
+  bool empty() const
+  {
+    auto bottom = _bottom.load(std::memory_order_relaxed);
+    auto top = _top.load(std::memory_order_relaxed);
+    return bottom <= top;
+  }
+
+private:
+  struct array
+  {
+    explicit array(std::int64_t initial_capacity)
+    : capacity(initial_capacity),
+      mask(initial_capacity - 1),
+      elements(std::make_unique<std::atomic<T>[]>(
+        static_cast<std::size_t>(initial_capacity)))
+    {
+    }
+
+    T get(std::int64_t index) const
+    {
+      return elements[static_cast<std::size_t>(index & mask)].load(
+        std::memory_order_relaxed);
+    }
+
+    void put(std::int64_t index, T element)
+    {
+      elements[static_cast<std::size_t>(index & mask)].store(
+        element, std::memory_order_relaxed);
+    }
+
+    std::int64_t capacity;
+    std::int64_t mask;
+    std::unique_ptr<std::atomic<T>[]> elements;
+  };
+
+  /// Doubles the capacity of the circular array.
+  /// @remarks
+  ///   Thieves may still read from the old array, which is why it is only
+  ///   released together with the deque itself.
+  array* grow(array* old_array, std::int64_t bottom, std::int64_t top)
+  {
+    auto new_array = std::make_unique<array>(old_array->capacity * 2);
+    for (auto i = top; i != bottom; ++i)
+      new_array->put(i, old_array->get(i));
+    auto* result = new_array.get();
+    _arrays.emplace_back(std::move(new_array));
+    _array.store(result, std::memory_order_release);
+    return result;
+  }
+
+  alignas(64) std::atomic<std::int64_t> _top = ATOMIC_VAR_INIT(0);
+  alignas(64) std::atomic<std::int64_t> _bottom = ATOMIC_VAR_INIT(0);
+  std::atomic<array*> _array = ATOMIC_VAR_INIT(nullptr);
+  std::vector<std::unique_ptr<array>> _arrays;
+};
+}
+
+#endif
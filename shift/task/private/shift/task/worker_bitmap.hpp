@@ -0,0 +1,101 @@
+#ifndef SHIFT_TASK_WORKER_BITMAP_HPP
+#define SHIFT_TASK_WORKER_BITMAP_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <shift/core/algorithm.hpp>
+#include "shift/task/worker_set.hpp"
+
+namespace shift::task
+{
+/// A bitmap of atomic words with one bit per worker, used by the task_system
+/// to keep track of worker states.
+/// @remarks
+///   Bits are indexed by worker index, which is the worker id minus one.
+///   Each word is modified atomically, but operations spanning several words
+///   are not atomic as a whole.
+class worker_bitmap
+{
+public:
+  using word_t = worker_set::word_t;
+  static constexpr std::size_t bits_per_word = worker_set::bits_per_word;
+  static constexpr std::uint32_t npos =
+    std::numeric_limits<std::uint32_t>::max();
+
+  /// Resizes the bitmap to hold the passed number of bits and clears all of
+  /// them.
+  /// @remarks
+  ///   This method is not thread-safe.
+  void resize(std::size_t num_workers)
+  {
+    _word_count = (num_workers + bits_per_word - 1) / bits_per_word;
+    _words = std::make_unique<std::atomic<word_t>[]>(_word_count);
+    for (std::size_t word_index = 0; word_index < _word_count; ++word_index)
+      _words[word_index].store(0, std::memory_order_relaxed);
+  }
+
+  /// Sets the bit of a single worker.
+  void set(std::uint32_t worker_index)
+  {
+    _words[worker_index / bits_per_word].fetch_or(bit(worker_index));
+  }
+
+  /// Sets the bits of all workers in the passed set.
+  void set(const worker_set& workers)
+  {
+    for (std::size_t word_index = 0; word_index < _word_count; ++word_index)
+    {
+      if (auto mask = workers.word(word_index); mask != 0)
+        _words[word_index].fetch_or(mask);
+    }
+  }
+
+  /// Clears the bit of a single worker.
+  void reset(std::uint32_t worker_index)
+  {
+    _words[worker_index / bits_per_word].fetch_and(~bit(worker_index));
+  }
+
+  /// Returns whether the bit of a single worker is set.
+  bool test(std::uint32_t worker_index) const
+  {
+    return (_words[worker_index / bits_per_word].load() &
+            bit(worker_index)) != 0;
+  }
+
+  /// Returns the index of the first worker whose bit is set and which is
+  /// part of the passed set, or npos if there is no such worker.
+  std::uint32_t find_first(const worker_set& workers) const
+  {
+    for (std::size_t word_index = 0; word_index < _word_count; ++word_index)
+    {
+      if (auto mask = _words[word_index].load() & workers.word(word_index);
+          mask != 0)
+      {
+        return static_cast<std::uint32_t>(word_index * bits_per_word +
+                                          core::count_trailing_zeros(mask));
+      }
+    }
+    return npos;
+  }
+
+  /// Returns whether any bit of a worker in the passed set is set.
+  bool intersects(const worker_set& workers) const
+  {
+    return find_first(workers) != npos;
+  }
+
+private:
+  static word_t bit(std::uint32_t worker_index)
+  {
+    return word_t{1} << (worker_index % bits_per_word);
+  }
+
+  std::unique_ptr<std::atomic<word_t>[]> _words;
+  std::size_t _word_count = 0;
+};
+}
+
+#endif
@@ -26,20 +26,23 @@ auto async(Function&& function, Args&&... args)
                std::forward<Args>(args)...);
 }
 
+/// Runs a copy of the function on each worker in the passed set.
+/// @remarks
+///   Legacy worker_affinity_t masks implicitly convert to worker_set.
 template <typename Function, typename... Args>
-auto multi_async(worker_affinity_t affinity_mask, Function&& function,
+auto multi_async(const worker_set& workers, Function&& function,
                  Args&&... args)
 {
   auto num_workers = task_system::singleton_instance().num_workers();
   std::vector<future<decltype(function(std::forward<Args>(args)...))>> results;
   results.reserve(num_workers);
-  for (auto worker_id = 0u; worker_id < num_workers; ++worker_id)
+  for (worker_id_t worker_id = 1; worker_id <= num_workers; ++worker_id)
   {
-    if ((affinity_mask & (1u << worker_id)) != 0)
+    if (workers.contains(worker_id))
     {
       results.emplace_back(
-        async(task_create_info{}.worker_affinity(1u << worker_id), function,
-              std::forward<Args>(args)...));
+        async(task_create_info{}.worker_affinity(worker_set::single(worker_id)),
+              function, std::forward<Args>(args)...));
     }
   }
   return results;
@@ -1,6 +1,9 @@
 #ifndef SHIFT_TASK_FUTURE_HPP
 #define SHIFT_TASK_FUTURE_HPP
 
+#include <cstdint>
+#include <atomic>
+#include <exception>
 #include <shift/core/types.hpp>
 #include <shift/core/exception.hpp>
 #include "shift/task/types.hpp"
@@ -37,20 +40,66 @@ namespace detail
   {
   };
 
+  /// An intrusive list node which gets notified once an associated state
+  /// becomes ready.
+  class continuation
+  {
+  public:
+    continuation() noexcept = default;
+    continuation(const continuation&) = delete;
+    continuation(continuation&&) = delete;
+    virtual ~continuation() = default;
+    continuation& operator=(const continuation&) = delete;
+    continuation& operator=(continuation&&) = delete;
+
+    /// Called exactly once, right after the associated state became ready.
+    virtual void on_ready() = 0;
+
+    continuation* next_continuation = nullptr;
+  };
+
+  /// The part of the state shared between a future and a promise which does
+  /// not depend on the type of the stored value.
+  /// @remarks
+  ///   The state is implemented lock-free: A single atomic word either holds
+  ///   the ready tag or the head of an intrusive list of continuations, which
+  ///   are notified by whoever makes the state ready.
   class associated_state_base
   {
   public:
+    /// Returns whether a value or an exception has been stored.
+    bool is_ready() const noexcept
+    {
+      return continuations.load(std::memory_order_acquire) == ready_tag;
+    }
+
+    /// Adds a continuation to be notified once the state becomes ready.
+    /// @return
+    ///   False if the state is already ready, in which case the continuation
+    ///   has not been registered.
+    bool add_continuation(continuation& node) noexcept;
+
     std::exception_ptr exception_ptr = nullptr;
-    mutex state_mutex;
-    condition_variable condition;
-    bool already_retrieved = false;
-    int ready = 0;
-    bool ready_at_task_exit = false;
-    bool has_stored_result = false;
-    bool running = false;
+    std::atomic<bool> already_retrieved = ATOMIC_VAR_INIT(false);
 
   protected:
+    /// Blocks the current task until the state becomes ready.
+    void wait();
+
+    /// Throws promise_already_satisfied if a result has been stored before.
+    void claim();
+
+    /// Marks the state ready and notifies all continuations.
+    void notify();
+
+    /// Queues the passed task as soon as the state becomes ready.
     void queue_task(std::unique_ptr<task_base> new_task);
+
+  private:
+    static constexpr std::uintptr_t ready_tag = 1;
+
+    std::atomic_flag has_stored_result = ATOMIC_FLAG_INIT;
+    std::atomic<std::uintptr_t> continuations = ATOMIC_VAR_INIT(0);
   };
 
   ///
@@ -62,48 +111,49 @@ namespace detail
     associated_state() = default;
 
     associated_state(const associated_state&) = delete;
-    associated_state(associated_state&&) = default;
+    associated_state(associated_state&&) = delete;
     associated_state& operator=(const associated_state&) = delete;
-    associated_state& operator=(associated_state&&) = default;
+    associated_state& operator=(associated_state&&) = delete;
 
     ///
     R& value(bool get_only_once)
     {
-      std::unique_lock lock(state_mutex);
-      if (get_only_once && already_retrieved)
+      // Concurrent callers must not both pass this check.
+      if (already_retrieved.exchange(true, std::memory_order_acq_rel) &&
+          get_only_once)
       {
         BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
                                 future_error_code::future_already_retrieved));
       }
-      if (exception_ptr)
-        std::rethrow_exception(exception_ptr);
-      already_retrieved = true;
-      // _Maybe_run_deferred_function(_Lock);
-      condition.wait(lock, [&] { return ready != 0; });
+      wait();
       if (exception_ptr)
         std::rethrow_exception(exception_ptr);
       return result;
     }
 
     ///
-    void value(const R& new_value, bool defer)
+    void set_value(const R& new_value)
     {
-      std::unique_lock lock(state_mutex);
-      value(new_value, defer, lock);
+      claim();
+      result = new_value;
+      notify();
     }
 
     ///
-    void value(R&& new_value, bool defer)
+    void set_value(R&& new_value)
     {
-      std::unique_lock lock(state_mutex);
-      value(std::forward<R>(new_value), defer, lock);
+      claim();
+      result = std::forward<R>(new_value);
+      notify();
     }
 
     ///
-    void exception(std::exception_ptr new_exception, bool defer)
+    void set_exception(std::exception_ptr new_exception)
     {
-      std::unique_lock lock(state_mutex);
-      exception(new_exception, defer, lock);
+      claim();
+      exception_ptr =
+        new_exception ? new_exception : std::make_exception_ptr(private_type{});
+      notify();
     }
 
     ///
@@ -111,7 +161,6 @@ namespace detail
     auto then(const task_create_info& create_info, Function&& function,
               Future& future, Args&&... args)
     {
-      std::unique_lock lock(state_mutex);
       auto new_task = make_task(create_info, std::forward<Function>(function),
                                 future, std::forward<Args>(args)...);
       auto value = new_task->get_future();
@@ -124,7 +173,6 @@ namespace detail
     auto then(const task_create_info& create_info, Function&& function,
               Future&& future, Args&&... args)
     {
-      std::unique_lock lock(state_mutex);
       auto new_task =
         make_task(create_info, std::forward<Function>(function),
                   std::forward<Future>(future), std::forward<Args>(args)...);
@@ -134,57 +182,6 @@ namespace detail
     }
 
     R result = {};
-
-  private:
-    ///
-    void value(const R& new_value, bool defer, std::unique_lock<mutex>& lock)
-    {
-      if (has_stored_result)
-      {
-        BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
-                                future_error_code::promise_already_satisfied));
-      }
-      result = new_value;
-      notify(lock, defer);
-    }
-
-    ///
-    void value(R&& new_value, bool defer, std::unique_lock<mutex>& lock)
-    {
-      if (has_stored_result)
-      {
-        BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
-                                future_error_code::promise_already_satisfied));
-      }
-      result = std::forward<R>(new_value);
-      notify(lock, defer);
-    }
-
-    ///
-    void exception(std::exception_ptr new_exception, bool defer,
-                   std::unique_lock<mutex>& lock)
-    {
-      if (has_stored_result)
-      {
-        BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
-                                future_error_code::promise_already_satisfied));
-      }
-      exception_ptr =
-        new_exception ? new_exception : std::make_exception_ptr(private_type{});
-      notify(lock, defer);
-    }
-
-    void notify(std::unique_lock<mutex>& lock, bool defer)
-    {
-      has_stored_result = true;
-      if (defer)
-        condition.notify_on_task_exit(lock, &ready);
-      else
-      {
-        ready = 1;
-        condition.notify_all();
-      }
-    }
   };
 
   ///
@@ -223,7 +220,9 @@ namespace detail
     ///
     bool is_valid() const noexcept
     {
-      return _state && !(_get_only_once && _state->already_retrieved);
+      return _state &&
+             !(_get_only_once &&
+               _state->already_retrieved.load(std::memory_order_acquire));
     }
 
     ///
@@ -238,36 +237,36 @@ namespace detail
     }
 
     ///
-    void value(const R& new_value, bool defer)
+    void set_value(const R& new_value)
     {
       if (!is_valid())
       {
         BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
                                 future_error_code::no_state));
       }
-      _state->value(new_value, defer);
+      _state->set_value(new_value);
     }
 
     ///
-    void value(R&& new_value, bool defer)
+    void set_value(R&& new_value)
     {
       if (!is_valid())
       {
         BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
                                 future_error_code::no_state));
       }
-      _state->value(std::forward<R>(new_value), defer);
+      _state->set_value(std::forward<R>(new_value));
     }
 
     ///
-    void exception(std::exception_ptr new_exception, bool defer)
+    void set_exception(std::exception_ptr new_exception)
     {
       if (!is_valid())
       {
         BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
                                 future_error_code::no_state));
       }
-      _state->exception(new_exception, defer);
+      _state->set_exception(new_exception);
     }
 
     ///
@@ -278,7 +277,18 @@ namespace detail
         BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
                                 future_error_code::no_state));
       }
-      return _state->ready != 0;
+      return _state->is_ready();
+    }
+
+    ///
+    bool add_continuation(continuation& node)
+    {
+      if (!_state)
+      {
+        BOOST_THROW_EXCEPTION(future_error() << future_error_code_info(
+                                future_error_code::no_state));
+      }
+      return _state->add_continuation(node);
     }
 
   protected:
@@ -328,6 +338,18 @@ public:
     return detail::state_manager<R>::ready();
   }
 
+  /// Registers a continuation which is notified once the future is ready.
+  /// @return
+  ///   False if the future is already ready, in which case the continuation
+  ///   has not been registered.
+  /// @remarks
+  ///   This is a low level building block for combinators like when_all,
+  ///   which avoids spawning a task per future.
+  bool add_continuation(detail::continuation& node)
+  {
+    return detail::state_manager<R>::add_continuation(node);
+  }
+
   ///
   template <typename Function, typename... Args>
   auto then(const task_create_info& create_info, Function&& function,
@@ -422,6 +444,12 @@ public:
     return detail::state_manager<int>::ready();
   }
 
+  /// @see future::add_continuation.
+  bool add_continuation(detail::continuation& node)
+  {
+    return detail::state_manager<int>::add_continuation(node);
+  }
+
   ///
   template <typename Function, typename... Args>
   auto then(const task_create_info& create_info, Function&& function,
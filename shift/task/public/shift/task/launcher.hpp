@@ -26,6 +26,11 @@ public:
       "Number of worker threads to use to process tasks. The default value "
       "of zero lets the application automatically chose the number of "
       "threads.");
+    base_t::_visible_options.add_options()(
+      "task-work-stealing",
+      opt::value<bool>(&_work_stealing)->default_value(false),
+      "Distribute tasks using per-worker work stealing deques instead of a "
+      "single global task queue.");
     base_t::_visible_options.add_options()(
       "floating-point-exceptions",
       opt::value<bool>(&_floating_point_exceptions)->default_value(true),
@@ -40,6 +45,8 @@ public:
                            ? _MCW_EM & ~(_EM_INEXACT | _EM_UNDERFLOW)
                            : 0)
         .num_workers(_num_workers)
+        .scheduler(_work_stealing ? scheduler_mode::work_stealing
+                                  : scheduler_mode::global_queue)
         .start(handler)
         .join();
     });
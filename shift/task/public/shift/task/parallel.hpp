@@ -0,0 +1,283 @@
+#ifndef SHIFT_TASK_PARALLEL_HPP
+#define SHIFT_TASK_PARALLEL_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include "shift/task/async.hpp"
+#include "shift/task/when_all.hpp"
+#include "shift/task/this_task.hpp"
+
+namespace shift::task
+{
+namespace detail
+{
+  /// The number of chunks per worker a range is split into if no explicit
+  /// grain size is passed. Using more chunks than workers evens out chunks
+  /// of unequal cost.
+  static constexpr std::size_t chunks_per_worker = 8;
+
+  /// The number of times a task waiting on its sub-ranges yields to let the
+  /// current worker run other chunks before it blocks on the result.
+  static constexpr int help_rounds = 64;
+
+  /// Returns the default grain size used to split a range of the passed
+  /// length.
+  inline std::size_t default_grain_size(std::size_t count)
+  {
+    auto num_chunks = std::max<std::size_t>(
+      task_system::singleton_instance().num_workers() * chunks_per_worker, 1);
+    return std::max<std::size_t>((count + num_chunks - 1) / num_chunks, 1);
+  }
+
+  /// Waits for the passed future. Instead of blocking right away, the
+  /// current task repeatedly yields so that its worker can run other queued
+  /// tasks, which likely are the sub-ranges we wait for.
+  template <typename Future>
+  auto help_while_waiting(Future& result)
+  {
+    for (int round = 0; round < help_rounds && !result.ready(); ++round)
+      this_task::yield();
+    return result.get();
+  }
+
+  /// Recursively splits [first, last) in halves, passing the upper half to a
+  /// new task each time, until the remaining range is no larger than
+  /// grain_size. The results of all chunks are combined from left to right.
+  /// @remarks
+  ///   Exceptions thrown by any chunk are rethrown after all chunks
+  ///   finished, because they reference the caller's stack.
+  template <typename Result, typename Iterator, typename Body,
+            typename Reduction>
+  Result parallel_split(Iterator first, Iterator last, std::size_t grain_size,
+                        const Body& body, const Reduction& reduction)
+  {
+    std::vector<future<Result>> upper_halves;
+    while (static_cast<std::size_t>(std::distance(first, last)) > grain_size)
+    {
+      auto middle = first + std::distance(first, last) / 2;
+      upper_halves.emplace_back(
+        async([middle, last, grain_size, &body, &reduction]() {
+          return parallel_split<Result>(middle, last, grain_size, body,
+                                        reduction);
+        }));
+      last = middle;
+    }
+
+    Result result{};
+    std::exception_ptr exception = nullptr;
+    try
+    {
+      result = body(first, last);
+    }
+    catch (...)
+    {
+      exception = std::current_exception();
+    }
+
+    if (!upper_halves.empty())
+    {
+      auto all_halves = when_all(upper_halves.begin(), upper_halves.end());
+      auto finished_halves = help_while_waiting(all_halves);
+      // The last element holds the range directly following our own one.
+      for (auto half = finished_halves.rbegin(); half != finished_halves.rend();
+           ++half)
+      {
+        try
+        {
+          auto half_result = half->get();
+          if (!exception)
+            result = reduction(std::move(result), std::move(half_result));
+        }
+        catch (...)
+        {
+          if (!exception)
+            exception = std::current_exception();
+        }
+      }
+    }
+    if (exception)
+      std::rethrow_exception(exception);
+    return result;
+  }
+
+  /// A minimal random access iterator over a range of integers.
+  template <typename Integer>
+  class index_iterator
+  {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Integer;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Integer*;
+    using reference = Integer;
+
+    ///
+    explicit index_iterator(Integer value = 0) : _value(value)
+    {
+    }
+
+    ///
+    Integer operator*() const
+    {
+      return _value;
+    }
+
+    ///
+    index_iterator operator+(difference_type offset) const
+    {
+      return index_iterator{static_cast<Integer>(_value + offset)};
+    }
+
+    ///
+    difference_type operator-(const index_iterator& other) const
+    {
+      return static_cast<difference_type>(_value) -
+             static_cast<difference_type>(other._value);
+    }
+
+    ///
+    index_iterator& operator++()
+    {
+      ++_value;
+      return *this;
+    }
+
+    ///
+    bool operator==(const index_iterator& other) const
+    {
+      return _value == other._value;
+    }
+
+    ///
+    bool operator!=(const index_iterator& other) const
+    {
+      return _value != other._value;
+    }
+
+  private:
+    Integer _value;
+  };
+
+  /// Turns integral bounds into index_iterators and leaves iterators as they
+  /// are.
+  template <typename Iterator>
+  auto make_range_iterator(Iterator iterator)
+  {
+    if constexpr (std::is_integral_v<Iterator>)
+      return index_iterator<Iterator>{iterator};
+    else
+      return iterator;
+  }
+}
+
+/// Calls function for each element of [first, last), which is split into
+/// chunks processed by concurrent tasks.
+/// @param first
+///   Either an integral start index, in which case the function is called
+///   with each index, or a random access iterator, in which case the function
+///   is called with each dereferenced element.
+/// @param grain_size
+///   The maximum number of elements processed by a single task, or zero to
+///   derive a reasonable size from the number of workers.
+/// @remarks
+///   This function must be called from within a task. While waiting on
+///   chunks processed by other workers the calling task helps running queued
+///   tasks.
+template <typename Iterator, typename Function>
+void parallel_for(Iterator first, Iterator last, const Function& function,
+                  std::size_t grain_size = 0)
+{
+  auto range_first = detail::make_range_iterator(first);
+  auto range_last = detail::make_range_iterator(last);
+  auto count = static_cast<std::size_t>(std::distance(range_first, range_last));
+  if (count == 0)
+    return;
+  if (grain_size == 0)
+    grain_size = detail::default_grain_size(count);
+
+  detail::parallel_split<int>(
+    range_first, range_last, grain_size,
+    [&](auto chunk_first, auto chunk_last) {
+      for (auto i = chunk_first; i != chunk_last; ++i)
+        function(*i);
+      return 0;
+    },
+    [](int /*lhs*/, int /*rhs*/) { return 0; });
+}
+
+/// Maps each element of [first, last) using transformation and combines the
+/// results using reduction, starting with identity.
+/// @param reduction
+///   An associative binary function. Results are combined in range order, so
+///   the function does not need to be commutative.
+/// @remarks
+///   The result type must be default constructible. See parallel_for for
+///   details about the remaining parameters.
+template <typename Iterator, typename Result, typename Transformation,
+          typename Reduction>
+Result parallel_reduce(Iterator first, Iterator last, Result identity,
+                       const Transformation& transformation,
+                       const Reduction& reduction, std::size_t grain_size = 0)
+{
+  auto range_first = detail::make_range_iterator(first);
+  auto range_last = detail::make_range_iterator(last);
+  auto count = static_cast<std::size_t>(std::distance(range_first, range_last));
+  if (count == 0)
+    return identity;
+  if (grain_size == 0)
+    grain_size = detail::default_grain_size(count);
+
+  return reduction(
+    identity,
+    detail::parallel_split<Result>(
+      range_first, range_last, grain_size,
+      [&](auto chunk_first, auto chunk_last) {
+        Result result = transformation(*chunk_first);
+        for (auto i = ++chunk_first; i != chunk_last; ++i)
+          result = reduction(std::move(result), transformation(*i));
+        return result;
+      },
+      reduction));
+}
+
+/// Stores the result of function for each element of [first, last) in the
+/// range beginning at destination.
+/// @param destination
+///   A random access iterator to a range of at least as many elements as the
+///   input range.
+/// @return
+///   An iterator to the element past the last element written.
+/// @remarks
+///   See parallel_for for details about the remaining parameters.
+template <typename Iterator, typename OutputIterator, typename Function>
+OutputIterator parallel_transform(Iterator first, Iterator last,
+                                  OutputIterator destination,
+                                  const Function& function,
+                                  std::size_t grain_size = 0)
+{
+  auto range_first = detail::make_range_iterator(first);
+  auto range_last = detail::make_range_iterator(last);
+  auto count = std::distance(range_first, range_last);
+  if (count == 0)
+    return destination;
+  if (grain_size == 0)
+    grain_size = detail::default_grain_size(static_cast<std::size_t>(count));
+
+  detail::parallel_split<int>(
+    range_first, range_last, grain_size,
+    [&](auto chunk_first, auto chunk_last) {
+      auto output = destination + std::distance(range_first, chunk_first);
+      for (auto i = chunk_first; i != chunk_last; ++i, ++output)
+        *output = function(*i);
+      return 0;
+    },
+    [](int /*lhs*/, int /*rhs*/) { return 0; });
+  return destination + count;
+}
+}
+
+#endif
@@ -6,6 +6,7 @@ namespace shift::task
 struct program_options
 {
   std::uint32_t _num_workers;
+  bool _work_stealing;
   bool _floating_point_exceptions;
 };
 }
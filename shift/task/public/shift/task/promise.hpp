@@ -70,7 +70,7 @@ public:
       BOOST_THROW_EXCEPTION(
         future_error() << future_error_code_info(future_error_code::no_state));
     }
-    _state.value(new_value, false);
+    _state.set_value(new_value);
   }
 
   void set_value(R&& new_value)
@@ -80,7 +80,7 @@ public:
       BOOST_THROW_EXCEPTION(
         future_error() << future_error_code_info(future_error_code::no_state));
     }
-    _state.value(std::forward<R>(new_value), false);
+    _state.set_value(std::forward<R>(new_value));
   }
 
   // void set_value(R& new_value)
@@ -94,7 +94,7 @@ public:
       BOOST_THROW_EXCEPTION(
         future_error() << future_error_code_info(future_error_code::no_state));
     }
-    _state.exception(new_exception, false);
+    _state.set_exception(new_exception);
   }
 
 private:
@@ -167,7 +167,7 @@ public:
       BOOST_THROW_EXCEPTION(
         future_error() << future_error_code_info(future_error_code::no_state));
     }
-    _state.value(1, false);
+    _state.set_value(1);
   }
 
   void set_exception(std::exception_ptr new_exception)
@@ -177,7 +177,7 @@ public:
       BOOST_THROW_EXCEPTION(
         future_error() << future_error_code_info(future_error_code::no_state));
     }
-    _state.exception(new_exception, false);
+    _state.set_exception(new_exception);
   }
 
 private:
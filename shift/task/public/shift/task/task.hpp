@@ -2,7 +2,8 @@
 #define SHIFT_TASK_TASK_HPP
 
 #include <memory>
-#include <functional>
+#include <tuple>
+#include <utility>
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/coroutine2/detail/forced_unwind.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
@@ -18,8 +19,7 @@ class task_base
 {
 public:
   ///
-  task_base(const task_create_info& create_info,
-            std::function<void()> wrapped_function);
+  explicit task_base(const task_create_info& create_info);
 
   task_base(const task_base&) = delete;
   task_base(task_base&&) = delete;
@@ -37,11 +37,22 @@ public:
   task_id_t id() const;
 
   /// Forces the task to be processed only by specific worker threads.
-  void worker_affinity(worker_affinity_t affinity);
+  void worker_affinity(worker_set affinity);
 
-  /// Returns the worker affinity mask.
+  /// Returns the worker affinity as legacy mask, which only covers the first
+  /// 32 workers.
   worker_affinity_t worker_affinity() const;
 
+  /// Returns the set of workers allowed to process this task.
+  const worker_set& affine_workers() const;
+
+protected:
+  /// Runs the task body on the task's coroutine stack.
+  /// @remarks
+  ///   The body is stored inline in the derived task object, so starting a
+  ///   task does not require any additional heap allocation.
+  virtual void execute() = 0;
+
 private:
   friend class task_system;
 
@@ -56,9 +67,8 @@ public:
   using result_t = Result;
 
   ///
-  task_result(const task_create_info& create_info,
-              std::function<void()> wrapped_function)
-  : task_base(create_info, std::move(wrapped_function))
+  explicit task_result(const task_create_info& create_info)
+  : task_base(create_info)
   {
   }
 
@@ -82,22 +92,7 @@ public:
 
   /// Constructor.
   task(const task_create_info& create_info, Function&& function, Args&&... args)
-  : base_t(create_info,
-           [&]() {
-             try
-             {
-               base_t::_promise.set_value(
-                 call_function(_function, std::index_sequence_for<Args...>{}));
-             }
-             catch (const boost::coroutines2::detail::forced_unwind&)
-             {
-               // Ignore this type of exception.
-             }
-             catch (...)
-             {
-               base_t::_promise.set_exception(std::current_exception());
-             }
-           }),
+  : base_t(create_info),
     _function(std::forward<Function>(function)),
     _args(std::move(args)...)
   {
@@ -106,6 +101,25 @@ public:
   /// Destructor.
   ~task() override = default;
 
+protected:
+  ///
+  void execute() override
+  {
+    try
+    {
+      base_t::_promise.set_value(
+        call_function(_function, std::index_sequence_for<Args...>{}));
+    }
+    catch (const boost::coroutines2::detail::forced_unwind&)
+    {
+      // Ignore this type of exception.
+    }
+    catch (...)
+    {
+      base_t::_promise.set_exception(std::current_exception());
+    }
+  }
+
 private:
   ///
   template <std::size_t... Is>
@@ -1,7 +1,9 @@
 #ifndef SHIFT_TASK_TASK_CREATE_INFO_HPP
 #define SHIFT_TASK_TASK_CREATE_INFO_HPP
 
+#include <cstddef>
 #include "shift/task/types.hpp"
+#include "shift/task/worker_set.hpp"
 
 namespace shift::task
 {
@@ -11,21 +13,46 @@ class task_create_info
 public:
   task_create_info() = default;
 
-  ///
+  /// Returns the affinity as legacy mask, which only covers the first 32
+  /// workers.
   worker_affinity_t worker_affinity() const
   {
-    return _worker_affinity;
+    return _affine_workers.legacy_mask();
   }
 
-  ///
-  task_create_info& worker_affinity(worker_affinity_t affinity)
+  /// Returns the set of workers allowed to run the task.
+  const worker_set& affine_workers() const
   {
-    _worker_affinity = affinity;
+    return _affine_workers;
+  }
+
+  /// Restricts the task to the passed set of workers.
+  task_create_info& worker_affinity(worker_set affinity)
+  {
+    _affine_workers = std::move(affinity);
     return *this;
   };
 
+  /// Returns the requested coroutine stack size in bytes, where zero refers
+  /// to the platform's default stack size.
+  std::size_t stack_size() const
+  {
+    return _stack_size;
+  }
+
+  /// Sets the size of the task's coroutine stack.
+  /// @remarks
+  ///   Stacks are pooled by size, so tasks should stick to few distinct
+  ///   sizes. Each stack is additionally protected by a guard page.
+  task_create_info& stack_size(std::size_t size)
+  {
+    _stack_size = size;
+    return *this;
+  }
+
 private:
-  worker_affinity_t _worker_affinity = all_workers;
+  worker_set _affine_workers;
+  std::size_t _stack_size = 0;
 };
 }
 
@@ -13,6 +13,23 @@
 
 namespace shift::task
 {
+/// Counters collected by the task_system to measure scheduling overhead.
+struct task_system_statistics
+{
+  /// The number of times a sleeping worker has been woken to run a task.
+  std::uint64_t wakeups = 0;
+
+  /// The number of wakeups after which the worker did not find any task to
+  /// run.
+  std::uint64_t futile_wakeups = 0;
+
+  /// The number of coroutine stacks taken from a worker's stack pool.
+  std::uint64_t stack_reuses = 0;
+
+  /// The number of coroutine stacks which had to be newly allocated.
+  std::uint64_t stack_allocations = 0;
+};
+
 class task_system : public core::singleton<task_system, core::create::on_stack>
 {
 public:
@@ -41,6 +58,27 @@ public:
   /// Returns the number of worker threads.
   std::uint32_t num_workers() const;
 
+  /// Returns the number of worker groups.
+  /// @remarks
+  ///   If the platform reports more than a single NUMA node, workers are
+  ///   distributed evenly across nodes, each node forming a group, and bound
+  ///   to the node's processors. Otherwise there is a single group containing
+  ///   all workers.
+  std::size_t num_worker_groups() const;
+
+  /// Returns the set of workers belonging to the passed group, which may be
+  /// passed to task_create_info::worker_affinity.
+  const worker_set& worker_group(std::size_t group_index) const;
+
+  /// Selects the strategy used to distribute tasks among worker threads.
+  /// @remarks
+  ///   This call is only meaningful before start is called. After that it has
+  ///   no effect.
+  task_system& scheduler(scheduler_mode mode);
+
+  /// Returns the selected scheduling strategy.
+  scheduler_mode scheduler() const;
+
   /// Start the primary task.
   /// @remarks
   ///   At any given time there may only be a single primary task.
@@ -67,10 +105,14 @@ public:
   /// Returns whether the task_system is busy processing tasks.
   bool running() const noexcept;
 
+  /// Returns a snapshot of the scheduling statistics.
+  task_system_statistics statistics() const;
+
 private:
 private:
   friend class mutex;
   friend class condition_variable;
+  friend class task_base;
   friend class detail::associated_state_base;
 
   template <typename Function, typename... Args>
@@ -80,9 +122,17 @@ private:
   ///
   void queue(std::unique_ptr<task_base> new_task);
 
-  ///
-  void queue_blocked(std::unique_ptr<task_base> new_task,
-                     condition_variable& condition, mutex& lock);
+  /// Parks the current task until the passed state becomes ready.
+  void wait_ready(detail::associated_state_base& state);
+
+  /// Queues the passed task as soon as the passed state becomes ready.
+  void queue_continuation(detail::associated_state_base& state,
+                          std::unique_ptr<task_base> new_task);
+
+  /// Makes a task runnable which has been parked on a future's state.
+  /// @remarks
+  ///   This method does not leave the calling task.
+  void resume_parked(std::unique_ptr<task_base> parked_task);
 
   ///
   void lock_mutex(mutex& lock);
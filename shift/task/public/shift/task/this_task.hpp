@@ -2,6 +2,7 @@
 #define SHIFT_TASK_THIS_TASK_HPP
 
 #include "shift/task/types.hpp"
+#include "shift/task/worker_set.hpp"
 
 namespace shift::task
 {
@@ -9,6 +10,12 @@ namespace shift::task
 class this_task
 {
 public:
+  /// Returns whether the calling thread is currently executing a task.
+  /// @remarks
+  ///   Unlike the other methods of this class, this one may be called from
+  ///   any thread, even if no task_system exists.
+  static bool inside_task();
+
   /// Calls task_base::yield() on the task currently being executed by this
   /// worker thread.
   static void yield();
@@ -31,10 +38,14 @@ public:
   static void bind_to_current_worker();
 
   /// Forces the task to be processed only by specific worker threads.
-  static void worker_affinity(worker_affinity_t affinity);
+  static void worker_affinity(const worker_set& affinity);
 
-  /// Returns the worker affinity mask.
+  /// Returns the worker affinity as legacy mask, which only covers the first
+  /// 32 workers.
   static worker_affinity_t worker_affinity();
+
+  /// Returns the set of workers allowed to process this task.
+  static worker_set affine_workers();
 };
 }
 
@@ -8,6 +8,8 @@ namespace shift::task
 {
 namespace detail
 {
+  class associated_state_base;
+
   template <typename R>
   class associated_state;
 
@@ -46,13 +48,27 @@ class task_system;
 
 using worker_id_t = std::uint32_t;
 
-/// Each worker gets uniquely identifies by a bit, thus allowing up to 32
-/// workers right now.
+class worker_set;
+
+/// A legacy affinity mask where bit i refers to the worker with id i + 1. It
+/// only covers the first 32 workers. Use worker_set to address any worker.
 using worker_affinity_t = std::uint32_t;
 static constexpr worker_affinity_t no_worker = 0x00000000u;
 static constexpr worker_affinity_t all_workers = 0xFFFFFFFFu;
 
 using task_id_t = std::uint32_t;
+
+/// Selects the strategy used to distribute tasks among worker threads.
+enum class scheduler_mode
+{
+  /// All runnable tasks are kept in a single queue guarded by a global mutex.
+  global_queue,
+
+  /// Each worker owns a lock-free deque and idle workers steal tasks from
+  /// random victims. Tasks restricted to a subset of workers are passed
+  /// through a small shared injection queue.
+  work_stealing
+};
 }
 
 #endif
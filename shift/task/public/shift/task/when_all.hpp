@@ -2,7 +2,8 @@
 #define SHIFT_TASK_WHEN_ALL_HPP
 
 #include <atomic>
-#include "shift/task/mutex.hpp"
+#include <tuple>
+#include <vector>
 #include "shift/task/promise.hpp"
 #include "shift/task/future.hpp"
 
@@ -10,13 +11,80 @@ namespace shift::task
 {
 namespace detail
 {
+  ///
+  template <typename R, typename Visitor>
+  void for_each_future(std::vector<R>& futures, Visitor&& visitor)
+  {
+    for (auto& future : futures)
+      visitor(future);
+  }
+
+  ///
+  template <typename... Futures, typename Visitor>
+  void for_each_future(std::tuple<Futures...>& futures, Visitor&& visitor)
+  {
+    core::for_each_element(futures, std::forward<Visitor>(visitor));
+  }
+
+  /// The state shared by all input futures of a when_all call.
+  /// @remarks
+  ///   Each input future notifies the state through an intrusive
+  ///   continuation, which costs a single atomic decrement. The object
+  ///   deletes itself once the last input became ready.
   template <typename Futures>
-  struct when_all_data
+  class when_all_data
   {
-    std::atomic<std::uint32_t> satisfied = ATOMIC_VAR_INIT(0);
-    promise<Futures> promised_result;
-    mutex futures_mutex;
-    Futures futures;
+  public:
+    /// Constructor.
+    when_all_data(Futures&& futures, std::size_t count)
+    : _futures(std::move(futures)), _inputs(count), _remaining(count + 1)
+    {
+      for (auto& input : _inputs)
+        input.data = this;
+    }
+
+    /// Registers with all input futures and returns the combined future.
+    /// @remarks
+    ///   The object must not be accessed after calling this method.
+    future<Futures> start()
+    {
+      auto result = _promised_result.get_future();
+      auto* input = _inputs.data();
+      for_each_future(_futures, [&](auto& any_future) {
+        if (!any_future.add_continuation(*input))
+          input_ready();
+        ++input;
+      });
+      // Drop the extra reference which kept the futures from being moved
+      // while iterating them.
+      input_ready();
+      return result;
+    }
+
+  private:
+    struct input final : public continuation
+    {
+      void on_ready() override
+      {
+        data->input_ready();
+      }
+
+      when_all_data* data = nullptr;
+    };
+
+    void input_ready()
+    {
+      if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        _promised_result.set_value(std::move(_futures));
+        delete this;
+      }
+    }
+
+    promise<Futures> _promised_result;
+    Futures _futures;
+    std::vector<input> _inputs;
+    std::atomic<std::size_t> _remaining;
   };
 }
 
@@ -28,43 +96,14 @@ auto when_all(Iterator begin, Iterator end,
   using future_vector =
     std::vector<typename std::iterator_traits<Iterator>::value_type>;
 
-  // Create a shared data structure, mainly used to pass a single promise to
-  // several helper tasks.
-  auto shared_data = std::make_shared<detail::when_all_data<future_vector>>();
-  // Handle a special case where we need to manually satisfy the promise
-  // because no one else would.
-  if (begin == end)
-  {
-    shared_data->promised_result.set_value(std::move(shared_data->futures));
-    return shared_data->promised_result.get_future();
-  }
-  // Synchronize access to shared_data->futures, because it could be moved
-  // from within the inner lambda.
-  std::unique_lock futures_lock(shared_data->futures_mutex);
   // Move all passed futures from [begin..end) to a separate storage.
-  shared_data->futures.reserve(std::distance(begin, end));
+  future_vector futures;
+  futures.reserve(std::distance(begin, end));
   for (auto future_iter = begin; future_iter != end; ++future_iter)
-    shared_data->futures.emplace_back(std::move(*future_iter));
-  // If any of the passed futures get available, satisfy the shared promise.
-  for (auto& future_iter : shared_data->futures)
-  {
-    future_iter.then([shared_data](auto& /*any_future*/) {
-      // Only the last available future may satisfy the promise.
-      if (++shared_data->satisfied == shared_data->futures.size())
-      {
-        // Synchronize access to shared_data->futures, because the outer for
-        // loop might still be iterating through the list.
-        std::lock_guard futures_lock(shared_data->futures_mutex);
-        shared_data->promised_result.set_value(std::move(shared_data->futures));
-      }
-      /// ToDo: We don't want to return anything here (requires future<void>).
-      return true;
-    });
-  }
-  // Unlock futures_mutex befor waiting on the result.
-  futures_lock.unlock();
-  // Return the promised future object.
-  return shared_data->promised_result.get_future();
+    futures.emplace_back(std::move(*future_iter));
+  auto count = futures.size();
+  return (new detail::when_all_data<future_vector>(std::move(futures), count))
+    ->start();
 }
 
 ///
@@ -73,45 +112,10 @@ auto when_all(Futures&&... futures)
 {
   using future_tuple = std::tuple<Futures...>;
 
-  // Create a shared data structure, mainly used to pass a single promise to
-  // several helper tasks.
-  auto shared_data = std::make_shared<detail::when_all_data<future_tuple>>();
-  // Handle a special case where we need to manually satisfy the promise
-  // because no one else would.
-  if constexpr (sizeof...(Futures) == 0)
-  {
-    shared_data->promised_result.set_value(std::move(shared_data->futures));
-    return shared_data->promised_result.get_future();
-  }
-
-  auto wait_on_future = [&shared_data](auto& any_future) {
-    any_future.then([shared_data](auto& /* any_future */) {
-      // Only the last available future may satisfy the promise.
-      if (++shared_data->satisfied == std::tuple_size<future_tuple>::value)
-      {
-        // Synchronize access to shared_data->futures, because the outer for
-        // loop might still be iterating through the list.
-        std::lock_guard futures_lock(shared_data->futures_mutex);
-        shared_data->promised_result.set_value(std::move(shared_data->futures));
-      }
-      /// ToDo: We don't want to return anything here
-      /// (requires future<void>).
-      return true;
-    });
-  };
-
-  {
-    // Synchronize access to shared_data->futures, because it could be moved
-    // from within the for_each_element lambda.
-    std::lock_guard futures_lock(shared_data->futures_mutex);
-    // Move all passed futures to a separate storage.
-    shared_data->futures = std::make_tuple(std::forward<Futures>(futures)...);
-    // If any of the passed futures get available, satisfy the shared promise.
-    core::for_each_element(shared_data->futures, wait_on_future);
-    // Unlock futures_mutex befor waiting on the result.
-  }
-  // Return the promised future object.
-  return shared_data->promised_result.get_future();
+  return (new detail::when_all_data<future_tuple>(
+            future_tuple{std::forward<Futures>(futures)...},
+            sizeof...(Futures)))
+    ->start();
 }
 }
 
@@ -2,25 +2,103 @@
 #define SHIFT_TASK_WHEN_ANY_HPP
 
 #include <atomic>
-#include "shift/task/mutex.hpp"
+#include <tuple>
+#include <vector>
 #include "shift/task/promise.hpp"
 #include "shift/task/future.hpp"
+#include "shift/task/when_all.hpp"
 
 namespace shift::task
 {
 namespace detail
 {
+  /// The state shared by all input futures of a when_any call.
+  /// @remarks
+  ///   The result is set by the later of the first input becoming ready and
+  ///   the registration with all inputs finishing, because the futures must
+  ///   not be moved while registering. The object deletes itself once all
+  ///   inputs became ready, because each input's shared state keeps a pointer
+  ///   to one of its continuations until then. If an input is never
+  ///   satisfied, neither by a value nor by an exception, the object and all
+  ///   futures it holds leak.
   template <typename Futures>
-  struct when_any_data
+  class when_any_data
   {
-    std::atomic_flag satisfied = ATOMIC_FLAG_INIT;
-    promise<Futures> promised_result;
-    mutex futures_mutex;
-    Futures futures;
+  public:
+    /// Constructor.
+    when_any_data(Futures&& futures, std::size_t count)
+    : _futures(std::move(futures)),
+      _inputs(count),
+      _remaining(count + 1),
+      _pending_triggers(count > 0 ? 2 : 1)
+    {
+      for (auto& input : _inputs)
+        input.data = this;
+    }
+
+    /// Registers with all input futures and returns the combined future.
+    /// @remarks
+    ///   The object must not be accessed after calling this method.
+    future<Futures> start()
+    {
+      auto result = _promised_result.get_future();
+      auto* input = _inputs.data();
+      for_each_future(_futures, [&](auto& any_future) {
+        if (!any_future.add_continuation(*input))
+          input_ready();
+        ++input;
+      });
+      trigger();
+      release();
+      return result;
+    }
+
+  private:
+    struct input final : public continuation
+    {
+      void on_ready() override
+      {
+        data->input_ready();
+      }
+
+      when_any_data* data = nullptr;
+    };
+
+    void input_ready()
+    {
+      // Only the first available future may trigger the promise.
+      if (!_satisfied.test_and_set(std::memory_order_acq_rel))
+        trigger();
+      release();
+    }
+
+    void trigger()
+    {
+      if (_pending_triggers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        _promised_result.set_value(std::move(_futures));
+    }
+
+    void release()
+    {
+      if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+    }
+
+    promise<Futures> _promised_result;
+    Futures _futures;
+    std::vector<input> _inputs;
+    std::atomic<std::size_t> _remaining;
+    std::atomic<int> _pending_triggers;
+    std::atomic_flag _satisfied = ATOMIC_FLAG_INIT;
   };
 }
 
-///
+/// Returns a future which becomes ready as soon as any of the passed futures
+/// becomes ready. The result holds all passed futures.
+/// @remarks
+///   Internal bookkeeping is only freed after all passed futures became
+///   ready. Destroying a promise does not make its future ready, so every
+///   input must eventually receive a value or an exception.
 template <typename Iterator>
 auto when_any(Iterator begin, Iterator end,
               ENABLE_IF(core::is_iterator<Iterator>::value))
@@ -28,91 +106,26 @@ auto when_any(Iterator begin, Iterator end,
   using future_vector =
     std::vector<typename std::iterator_traits<Iterator>::value_type>;
 
-  // Create a shared data structure, mainly used to pass a single promise to
-  // several helper tasks.
-  auto shared_data = std::make_shared<detail::when_any_data<future_vector>>();
-  // Handle a special case where we need to manually satisfy the promise
-  // because no one else would.
-  if (begin == end)
-  {
-    shared_data->promised_result.set_value(std::move(shared_data->futures));
-    return shared_data->promised_result.get_future();
-  }
-  // Synchronize access to shared_data->futures, because it could be moved
-  // from within the inner lambda.
-  std::unique_lock futures_lock(shared_data->futures_mutex);
   // Move all passed futures from [begin..end) to a separate storage.
-  shared_data->futures.reserve(std::distance(begin, end));
+  future_vector futures;
+  futures.reserve(std::distance(begin, end));
   for (auto future_iter = begin; future_iter != end; ++future_iter)
-    shared_data->futures.emplace_back(std::move(*future_iter));
-  // If any of the passed futures get available, satisfy the shared promise.
-  for (auto& future_iter : shared_data->futures)
-  {
-    future_iter.then([shared_data](auto& /*any_future*/) {
-      // Only the first available future may satisfy the promise.
-      if (!shared_data->satisfied.test_and_set())
-      {
-        // Synchronize access to shared_data->futures, because the outer for
-        // loop might still be iterating through the list.
-        std::lock_guard futures_lock(shared_data->futures_mutex);
-        shared_data->promised_result.set_value(std::move(shared_data->futures));
-      }
-      /// ToDo: We don't want to return anything here (requires future<void>).
-      return true;
-    });
-  }
-  // Unlock futures_mutex befor waiting on the result.
-  futures_lock.unlock();
-  // Return the promised future object.
-  return shared_data->promised_result.get_future();
+    futures.emplace_back(std::move(*future_iter));
+  auto count = futures.size();
+  return (new detail::when_any_data<future_vector>(std::move(futures), count))
+    ->start();
 }
 
-///
+/// @see when_any(Iterator, Iterator).
 template <typename... Futures>
 auto when_any(Futures&&... futures)
 {
   using future_tuple = std::tuple<Futures...>;
 
-  // Create a shared data structure, mainly used to pass a single promise to
-  // several helper tasks.
-  auto shared_data = std::make_shared<detail::when_any_data<future_tuple>>();
-  // Handle a special case where we need to manually satisfy the promise
-  // because no one else would.
-  if constexpr (sizeof...(Futures) == 0)
-  {
-    shared_data->promised_result.set_value(std::move(shared_data->futures));
-    return shared_data->promised_result.get_future();
-  }
-
-  auto wait_on_future = [&shared_data](auto& any_future) {
-    any_future.then([shared_data](auto& /* any_future */) {
-      // Only the first available future may satisfy the promise.
-      if (!shared_data->satisfied.test_and_set())
-      {
-        // Synchronize access to shared_data->futures,
-        // because the outer for loop might still be
-        // iterating through the list.
-        std::lock_guard futures_lock(shared_data->futures_mutex);
-        shared_data->promised_result.set_value(std::move(shared_data->futures));
-      }
-      /// ToDo: We don't want to return anything here
-      /// (requires future<void>).
-      return true;
-    });
-  };
-
-  {
-    // Synchronize access to shared_data->futures, because it could be moved
-    // from within the for_each_element lambda.
-    std::lock_guard futures_lock(shared_data->futures_mutex);
-    // Move all passed futures to a separate storage.
-    shared_data->futures = std::make_tuple(std::forward<Futures>(futures)...);
-    // If any of the passed futures get available, satisfy the shared promise.
-    core::for_each_element(shared_data->futures, wait_on_future);
-    // Unlock futures_mutex befor waiting on the result.
-  }
-  // Return the promised future object.
-  return shared_data->promised_result.get_future();
+  return (new detail::when_any_data<future_tuple>(
+            future_tuple{std::forward<Futures>(futures)...},
+            sizeof...(Futures)))
+    ->start();
 }
 }
 
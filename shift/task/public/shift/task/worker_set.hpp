@@ -0,0 +1,153 @@
+#ifndef SHIFT_TASK_WORKER_SET_HPP
+#define SHIFT_TASK_WORKER_SET_HPP
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <shift/core/core.hpp>
+#include "shift/task/types.hpp"
+
+namespace shift::task
+{
+/// A set of worker threads used to restrict which workers may run a task.
+/// @remarks
+///   Unlike worker_affinity_t the set is not limited to 32 workers. The first
+///   64 workers are stored inline, so only sets referring to workers beyond
+///   that allocate memory.
+class worker_set
+{
+public:
+  using word_t = std::uint64_t;
+  static constexpr std::size_t bits_per_word = sizeof(word_t) * 8;
+
+  /// Constructs a set containing all workers.
+  worker_set() noexcept = default;
+
+  /// Converts a legacy affinity mask, where bit i refers to worker i + 1.
+  /// @remarks
+  ///   all_workers is mapped to the set of all workers, including those
+  ///   beyond the first 32. This constructor is intentionally implicit to
+  ///   keep code passing worker_affinity_t masks working.
+  worker_set(worker_affinity_t affinity)  // NOLINT
+  : _all(affinity == all_workers), _first(_all ? 0 : affinity)
+  {
+  }
+
+  /// Returns a set containing all workers.
+  static worker_set all() noexcept
+  {
+    return worker_set{};
+  }
+
+  /// Returns an empty set.
+  static worker_set none() noexcept
+  {
+    return worker_set{no_worker};
+  }
+
+  /// Returns a set containing just the worker with the passed id.
+  static worker_set single(worker_id_t worker_id)
+  {
+    return none().insert(worker_id);
+  }
+
+  /// Adds the worker with the passed id to the set.
+  worker_set& insert(worker_id_t worker_id)
+  {
+    BOOST_ASSERT(worker_id != 0);
+    if (_all)
+      return *this;
+    auto index = worker_id - 1;
+    auto word_index = index / bits_per_word;
+    auto bit = word_t{1} << (index % bits_per_word);
+    if (word_index == 0)
+      _first |= bit;
+    else
+    {
+      if (_more.size() < word_index)
+        _more.resize(word_index, 0);
+      _more[word_index - 1] |= bit;
+    }
+    return *this;
+  }
+
+  /// Returns whether the worker with the passed id is part of the set.
+  bool contains(worker_id_t worker_id) const noexcept
+  {
+    if (worker_id == 0)
+      return false;
+    auto index = worker_id - 1;
+    return (word(index / bits_per_word) &
+            (word_t{1} << (index % bits_per_word))) != 0;
+  }
+
+  /// Returns whether this set contains all workers.
+  bool is_all() const noexcept
+  {
+    return _all;
+  }
+
+  /// Returns whether the set does not contain any worker.
+  bool empty() const noexcept
+  {
+    if (_all)
+      return false;
+    if (_first != 0)
+      return false;
+    for (auto more : _more)
+    {
+      if (more != 0)
+        return false;
+    }
+    return true;
+  }
+
+  /// Returns a 64 bit word of the set's bitmask, where bit i of word w refers
+  /// to the worker with id w * 64 + i + 1.
+  word_t word(std::size_t word_index) const noexcept
+  {
+    if (_all)
+      return ~word_t{0};
+    else if (word_index == 0)
+      return _first;
+    else if (word_index - 1 < _more.size())
+      return _more[word_index - 1];
+    else
+      return 0;
+  }
+
+  /// Returns the set as legacy affinity mask, which only covers the first 32
+  /// workers.
+  worker_affinity_t legacy_mask() const noexcept
+  {
+    return _all ? all_workers : static_cast<worker_affinity_t>(_first);
+  }
+
+  ///
+  bool operator==(const worker_set& other) const noexcept
+  {
+    if (_all || other._all)
+      return _all == other._all;
+    auto word_count = std::max(_more.size(), other._more.size()) + 1;
+    for (std::size_t word_index = 0; word_index < word_count; ++word_index)
+    {
+      if (word(word_index) != other.word(word_index))
+        return false;
+    }
+    return true;
+  }
+
+  ///
+  bool operator!=(const worker_set& other) const noexcept
+  {
+    return !(*this == other);
+  }
+
+private:
+  bool _all = true;
+  word_t _first = 0;
+  std::vector<word_t> _more;
+};
+}
+
+#endif
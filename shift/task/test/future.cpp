@@ -3,12 +3,16 @@
 #include <shift/core/boost_disable_warnings.hpp>
 #include <boost/test/unit_test.hpp>
 #include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
 #include <thread>
 #include <vector>
 #include <array>
 #include <atomic>
 #include <cstdint>
 
+using namespace std::chrono;
 using namespace std::chrono_literals;
 using namespace shift;
 
@@ -294,3 +298,91 @@ BOOST_AUTO_TEST_CASE(future_when_all_empty_2)
   };
   task::task_system{}.start(primary_task).join();
 }
+
+BOOST_AUTO_TEST_CASE(future_cross_task_wait)
+{
+  constexpr int num_pairs = 500;
+  for (auto mode : {task::scheduler_mode::global_queue,
+                    task::scheduler_mode::work_stealing})
+  {
+    std::atomic<int> sum = ATOMIC_VAR_INIT(0);
+    auto primary_task = [&]() {
+      std::vector<task::future<int>> results;
+      for (int i = 0; i < num_pairs; ++i)
+      {
+        task::promise<int> promise;
+        // The consumer parks on the future until the producer sets it.
+        results.emplace_back(task::async(
+          [&sum](task::future<int> value) {
+            sum += value.get();
+            return 0;
+          },
+          promise.get_future()));
+        results.emplace_back(task::async(
+          [i](task::promise<int> value) {
+            task::this_task::yield();
+            value.set_value(i);
+            return 0;
+          },
+          std::move(promise)));
+      }
+      task::when_all(results.begin(), results.end()).get();
+      return 0;
+    };
+    task::task_system{}
+      .num_workers(4)
+      .scheduler(mode)
+      .start(primary_task)
+      .join();
+    BOOST_CHECK_EQUAL(sum, num_pairs * (num_pairs - 1) / 2);
+  }
+}
+
+/// Measures the throughput of resolving futures.
+BOOST_AUTO_TEST_CASE(future_benchmark)
+{
+  constexpr int num_futures = 100000;
+  constexpr int num_inputs = 64;
+
+  auto print = [](const char* name, int count, nanoseconds duration) {
+    auto seconds = duration_cast<microseconds>(duration).count() / 1.0e6;
+    std::cout << "  " << name << std::fixed << std::setprecision(0)
+              << (count / seconds) << " futures/s" << std::endl;
+  };
+
+  std::cout << "Future benchmark:" << std::endl;
+  auto primary_task = [&]() {
+    // Set and get a value on futures no other task is waiting for.
+    auto begin = high_resolution_clock::now();
+    std::int64_t sum = 0;
+    for (int i = 0; i < num_futures; ++i)
+    {
+      task::promise<int> promise;
+      auto future = promise.get_future();
+      promise.set_value(i);
+      sum += future.get();
+    }
+    print("uncontended set/get: ", num_futures,
+          high_resolution_clock::now() - begin);
+    BOOST_CHECK_EQUAL(sum, std::int64_t{num_futures} * (num_futures - 1) / 2);
+
+    // Combine groups of futures using when_all.
+    begin = high_resolution_clock::now();
+    for (int i = 0; i < num_futures / num_inputs; ++i)
+    {
+      std::vector<task::promise<int>> promises(num_inputs);
+      std::vector<task::future<int>> futures;
+      futures.reserve(num_inputs);
+      for (auto& promise : promises)
+        futures.emplace_back(promise.get_future());
+      auto all = task::when_all(futures.begin(), futures.end());
+      for (auto& promise : promises)
+        promise.set_value(i);
+      BOOST_CHECK_EQUAL(all.get().size(), num_inputs);
+    }
+    print("when_all:            ", num_futures,
+          high_resolution_clock::now() - begin);
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+}
@@ -0,0 +1,140 @@
+#include "shift/task/parallel.hpp"
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace shift;
+
+BOOST_AUTO_TEST_CASE(parallel_for_indices)
+{
+  constexpr std::uint32_t count = 10000;
+  std::vector<std::atomic<std::uint32_t>> visits(count);
+  auto primary_task = [&]() {
+    task::parallel_for(0u, count, [&](std::uint32_t i) { ++visits[i]; });
+    // Empty ranges must not call the function at all.
+    task::parallel_for(5, 5, [](int /*i*/) { BOOST_CHECK(false); });
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+  for (const auto& visit_count : visits)
+    BOOST_CHECK_EQUAL(visit_count, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_iterators)
+{
+  std::vector<int> values(1000, 1);
+  auto primary_task = [&]() {
+    task::parallel_for(
+      values.begin(), values.end(), [](int& value) { value *= 2; }, 7);
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+  BOOST_CHECK_EQUAL(std::accumulate(values.begin(), values.end(), 0), 2000);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_reduce_order)
+{
+  auto primary_task = [&]() {
+    auto sum = task::parallel_reduce(
+      1ull, 100001ull, 0ull, [](auto i) { return i; },
+      [](auto lhs, auto rhs) { return lhs + rhs; });
+    BOOST_CHECK_EQUAL(sum, 5000050000ull);
+
+    // String concatenation is not commutative, so this checks that chunks
+    // are combined in range order.
+    auto text = task::parallel_reduce(
+      0, 26, std::string{},
+      [](int i) { return std::string(1, static_cast<char>('a' + i)); },
+      [](const std::string& lhs, const std::string& rhs) { return lhs + rhs; },
+      3);
+    BOOST_CHECK_EQUAL(text, "abcdefghijklmnopqrstuvwxyz");
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+}
+
+BOOST_AUTO_TEST_CASE(parallel_transform_values)
+{
+  std::vector<int> input(5000);
+  std::iota(input.begin(), input.end(), 0);
+  std::vector<int> output(input.size());
+  auto primary_task = [&]() {
+    auto output_end =
+      task::parallel_transform(input.begin(), input.end(), output.begin(),
+                               [](int value) { return value * value; });
+    BOOST_CHECK(output_end == output.end());
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+  for (std::size_t i = 0; i < input.size(); ++i)
+    BOOST_CHECK_EQUAL(output[i], input[i] * input[i]);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_exception)
+{
+  std::atomic<int> visits = ATOMIC_VAR_INIT(0);
+  auto primary_task = [&]() {
+    BOOST_CHECK_THROW(task::parallel_for(0, 1000,
+                                         [&](int i) {
+                                           ++visits;
+                                           if (i == 500)
+                                             throw std::runtime_error("500");
+                                         },
+                                         10),
+                      std::runtime_error);
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+  // Only the chunk containing the failing element stops early.
+  BOOST_CHECK_GE(visits, 991);
+}
+
+/// Compares parallel_for to spawning a task per element.
+BOOST_AUTO_TEST_CASE(parallel_for_benchmark)
+{
+  constexpr int count = 1 << 16;
+  std::vector<float> values(count, 1.0f);
+  auto work = [&](int i) {
+    for (int j = 0; j < 64; ++j)
+      values[i] = values[i] * 0.5f + 1.0f;
+  };
+
+  std::cout << "parallel_for benchmark (" << count << " elements):" << std::endl;
+  auto primary_task = [&]() {
+    auto begin = high_resolution_clock::now();
+    std::vector<task::future<int>> results;
+    results.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+      results.emplace_back(task::async([&, i]() {
+        work(i);
+        return 0;
+      }));
+    }
+    task::when_all(results.begin(), results.end()).get();
+    auto task_per_element = high_resolution_clock::now() - begin;
+
+    begin = high_resolution_clock::now();
+    task::parallel_for(0, count, work);
+    auto parallel = high_resolution_clock::now() - begin;
+
+    std::cout << "  task per element: " << std::fixed << std::setprecision(3)
+              << duration_cast<microseconds>(task_per_element).count() / 1.0e3
+              << "ms" << std::endl;
+    std::cout << "  parallel_for:     " << std::fixed << std::setprecision(3)
+              << duration_cast<microseconds>(parallel).count() / 1.0e3 << "ms"
+              << std::endl;
+    return 0;
+  };
+  task::task_system{}.num_workers(4).start(primary_task).join();
+}
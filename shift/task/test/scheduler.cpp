@@ -0,0 +1,237 @@
+#include "shift/task/async.hpp"
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+using namespace shift;
+
+BOOST_AUTO_TEST_CASE(work_stealing_multiple_tasks)
+{
+  constexpr int num_tasks = 1000;
+  std::atomic<int> counter = ATOMIC_VAR_INIT(0);
+  auto primary_task = [&]() {
+    std::vector<task::future<int>> results;
+    results.reserve(num_tasks);
+    for (int i = 0; i < num_tasks; ++i)
+    {
+      results.emplace_back(task::async([&, i]() {
+        ++counter;
+        return i;
+      }));
+    }
+    for (int i = 0; i < num_tasks; ++i)
+      BOOST_CHECK_EQUAL(results[i].get(), i);
+    return 0;
+  };
+  task::task_system{}
+    .num_workers(4)
+    .scheduler(task::scheduler_mode::work_stealing)
+    .start(primary_task)
+    .join();
+  BOOST_CHECK_EQUAL(counter, num_tasks);
+}
+
+BOOST_AUTO_TEST_CASE(work_stealing_worker_affinity)
+{
+  auto secondary_task = [](task::worker_id_t supposed_worker_id) {
+    BOOST_CHECK_EQUAL(supposed_worker_id, task::this_task::current_worker_id());
+    return 0;
+  };
+  auto primary_task = [&]() {
+    auto num_workers = task::task_system::singleton_instance().num_workers();
+    std::vector<task::future<int>> results;
+    for (auto worker_id = num_workers; worker_id > 0; --worker_id)
+    {
+      results.emplace_back(task::async(
+        task::task_create_info{}.worker_affinity(
+          task::worker_set::single(worker_id)),
+        secondary_task, worker_id));
+    }
+    task::when_all(results.begin(), results.end()).get();
+    return 0;
+  };
+  task::task_system{}
+    .num_workers(8)
+    .scheduler(task::scheduler_mode::work_stealing)
+    .start(primary_task)
+    .join();
+}
+
+BOOST_AUTO_TEST_CASE(work_stealing_mutex)
+{
+  constexpr int num_tasks = 64;
+  constexpr int num_increments = 100;
+  int counter = 0;
+  auto primary_task = [&]() {
+    task::mutex counter_mutex;
+    std::vector<task::future<int>> results;
+    for (int i = 0; i < num_tasks; ++i)
+    {
+      results.emplace_back(task::async([&]() {
+        for (int j = 0; j < num_increments; ++j)
+        {
+          std::lock_guard lock(counter_mutex);
+          ++counter;
+          task::this_task::yield();
+        }
+        return 0;
+      }));
+    }
+    task::when_all(results.begin(), results.end()).get();
+    return 0;
+  };
+  task::task_system{}
+    .num_workers(4)
+    .scheduler(task::scheduler_mode::work_stealing)
+    .start(primary_task)
+    .join();
+  BOOST_CHECK_EQUAL(counter, num_tasks * num_increments);
+}
+
+BOOST_AUTO_TEST_CASE(scheduler_mutex_exclusion)
+{
+  constexpr int num_tasks = 32;
+  constexpr int num_iterations = 20;
+  for (auto mode : {task::scheduler_mode::global_queue,
+                    task::scheduler_mode::work_stealing})
+  {
+    std::atomic<int> owners = ATOMIC_VAR_INIT(0);
+    std::atomic<bool> overlapped = ATOMIC_VAR_INIT(false);
+    auto primary_task = [&]() {
+      task::mutex mutex;
+      std::vector<task::future<int>> results;
+      for (int i = 0; i < num_tasks; ++i)
+      {
+        results.emplace_back(task::async([&]() {
+          for (int j = 0; j < num_iterations; ++j)
+          {
+            std::lock_guard lock(mutex);
+            if (++owners != 1)
+              overlapped = true;
+            std::this_thread::sleep_for(10us);
+            --owners;
+          }
+          return 0;
+        }));
+      }
+      task::when_all(results.begin(), results.end()).get();
+      return 0;
+    };
+    task::task_system{}
+      .num_workers(4)
+      .scheduler(mode)
+      .start(primary_task)
+      .join();
+    BOOST_CHECK(!overlapped);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(scheduler_targeted_wakeup)
+{
+  constexpr std::size_t num_workers = 8;
+  for (auto mode : {task::scheduler_mode::global_queue,
+                    task::scheduler_mode::work_stealing})
+  {
+    auto primary_task = [&]() {
+      // Give all other workers enough time to fall asleep.
+      std::this_thread::sleep_for(100ms);
+      task::async([]() { return 0; }).get();
+      return 0;
+    };
+    task::task_system scheduler;
+    scheduler.num_workers(num_workers)
+      .scheduler(mode)
+      .start(primary_task)
+      .join();
+    auto statistics = scheduler.statistics();
+    // Each queued task may wake at most a single sleeping worker.
+    BOOST_CHECK_GE(statistics.wakeups, 1u);
+    BOOST_CHECK_LT(statistics.wakeups, num_workers);
+    BOOST_CHECK_LE(statistics.futile_wakeups, statistics.wakeups);
+  }
+}
+
+namespace
+{
+/// Recursively spawns a binary tree of tasks without waiting on any of them.
+void spawn_tree(int depth, std::atomic<int>& finished)
+{
+  if (depth > 0)
+  {
+    task::async([depth, &finished]() {
+      spawn_tree(depth - 1, finished);
+      return 0;
+    });
+    task::async([depth, &finished]() {
+      spawn_tree(depth - 1, finished);
+      return 0;
+    });
+  }
+  ++finished;
+}
+}
+
+/// Compares scheduler throughput for large numbers of tiny tasks.
+BOOST_AUTO_TEST_CASE(scheduler_contention_benchmark)
+{
+  constexpr int tree_depth = 13;
+  constexpr int num_tasks = (1 << (tree_depth + 1)) - 1;
+  constexpr std::array<std::size_t, 4> worker_counts = {1, 8, 32, 64};
+
+  std::cout << "Scheduler contention benchmark (" << num_tasks
+            << " tasks):" << std::endl;
+  for (auto mode : {task::scheduler_mode::global_queue,
+                    task::scheduler_mode::work_stealing})
+  {
+    for (auto worker_count : worker_counts)
+    {
+      std::atomic<int> finished = ATOMIC_VAR_INIT(0);
+      std::uint32_t actual_worker_count = 0;
+      auto primary_task = [&]() {
+        actual_worker_count =
+          task::task_system::singleton_instance().num_workers();
+        // The primary task is one node of the tree itself.
+        spawn_tree(tree_depth, finished);
+        while (finished < num_tasks)
+          task::this_task::yield();
+        return 0;
+      };
+
+      auto begin = high_resolution_clock::now();
+      task::task_system scheduler;
+      scheduler.num_workers(worker_count)
+        .scheduler(mode)
+        .start(primary_task)
+        .join();
+      auto duration = high_resolution_clock::now() - begin;
+      auto statistics = scheduler.statistics();
+      BOOST_CHECK_EQUAL(finished, num_tasks);
+      BOOST_CHECK_LE(statistics.futile_wakeups, statistics.wakeups);
+
+      auto seconds = duration_cast<microseconds>(duration).count() / 1.0e6;
+      std::cout << "  "
+                << (mode == task::scheduler_mode::global_queue
+                      ? "global_queue "
+                      : "work_stealing")
+                << " workers: " << std::setw(3) << actual_worker_count
+                << " time: " << std::fixed << std::setprecision(3) << seconds
+                << "s tasks/s: " << std::setprecision(0)
+                << (num_tasks / seconds)
+                << " wakeups: " << statistics.wakeups
+                << " futile: " << statistics.futile_wakeups
+                << " stack reuses: " << statistics.stack_reuses
+                << " stack allocations: " << statistics.stack_allocations
+                << std::endl;
+    }
+  }
+}
@@ -106,9 +106,15 @@ BOOST_AUTO_TEST_CASE(task_worker_affinity)
 {
   auto secondary_task = [](task::worker_id_t supposed_worker_id) {
     auto actual_worker_id = task::this_task::current_worker_id();
-    auto affinity = task::this_task::worker_affinity();
     BOOST_CHECK_EQUAL(supposed_worker_id, actual_worker_id);
-    BOOST_CHECK_EQUAL(affinity, 1u << (actual_worker_id - 1));
+    BOOST_CHECK(task::this_task::affine_workers() ==
+                task::worker_set::single(actual_worker_id));
+    // Legacy affinity masks only cover the first 32 workers.
+    if (actual_worker_id <= 32)
+    {
+      BOOST_CHECK_EQUAL(task::this_task::worker_affinity(),
+                        1u << (actual_worker_id - 1));
+    }
     return 0;
   };
   auto primary_task = [&]() {
@@ -127,7 +133,8 @@ BOOST_AUTO_TEST_CASE(task_worker_affinity)
     for (auto& worker_id : worker_ids)
     {
       results.emplace_back(task::async(
-        task::task_create_info{}.worker_affinity(1u << (worker_id - 1)),
+        task::task_create_info{}.worker_affinity(
+          task::worker_set::single(worker_id)),
         secondary_task, worker_id));
     }
     task::when_all(results.begin(), results.end()).get();
@@ -136,3 +143,39 @@ BOOST_AUTO_TEST_CASE(task_worker_affinity)
   };
   task::task_system{}.start(primary_task).join();
 }
+
+BOOST_AUTO_TEST_CASE(task_stack_reuse)
+{
+  constexpr int num_tasks = 1000;
+  auto primary_task = [&]() {
+    for (int i = 0; i < num_tasks; ++i)
+      BOOST_CHECK_EQUAL(task::async([i]() { return i; }).get(), i);
+    return 0;
+  };
+  task::task_system scheduler;
+  scheduler.num_workers(1).start(primary_task).join();
+  auto statistics = scheduler.statistics();
+  // Each task runs after its predecessor finished, so all but the first few
+  // stacks must come from the pool.
+  BOOST_CHECK_EQUAL(statistics.stack_reuses + statistics.stack_allocations,
+                    num_tasks + 1u);
+  BOOST_CHECK_LE(statistics.stack_allocations, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(task_stack_size)
+{
+  static constexpr std::size_t buffer_size = 1024 * 1024;
+  auto primary_task = [&]() {
+    auto result = task::async(
+      task::task_create_info{}.stack_size(2 * buffer_size), []() {
+        // Use a large local buffer which would overflow the default stack.
+        volatile std::uint8_t buffer[buffer_size];
+        for (std::size_t i = 0; i < buffer_size; i += 4096)
+          buffer[i] = static_cast<std::uint8_t>(i);
+        return static_cast<int>(buffer[4096]);
+      });
+    BOOST_CHECK_EQUAL(result.get(), 0);
+    return 0;
+  };
+  task::task_system{}.num_workers(2).start(primary_task).join();
+}
@@ -0,0 +1,77 @@
+#include "shift/task/async.hpp"
+#include <shift/core/boost_disable_warnings.hpp>
+#include <boost/test/unit_test.hpp>
+#include <shift/core/boost_restore_warnings.hpp>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+using namespace shift;
+
+BOOST_AUTO_TEST_CASE(worker_set_legacy_mask)
+{
+  task::worker_set all_workers = task::all_workers;
+  BOOST_CHECK(all_workers.is_all());
+  BOOST_CHECK(all_workers.contains(100));
+  BOOST_CHECK_EQUAL(all_workers.legacy_mask(), task::all_workers);
+
+  task::worker_set some_workers = 0b101u;
+  BOOST_CHECK(some_workers.contains(1));
+  BOOST_CHECK(!some_workers.contains(2));
+  BOOST_CHECK(some_workers.contains(3));
+  BOOST_CHECK(!some_workers.contains(33));
+  BOOST_CHECK_EQUAL(some_workers.legacy_mask(), 0b101u);
+  BOOST_CHECK(task::worker_set::none().empty());
+}
+
+BOOST_AUTO_TEST_CASE(worker_set_wide)
+{
+  auto workers = task::worker_set::single(70);
+  workers.insert(2).insert(200);
+  BOOST_CHECK(!workers.is_all());
+  BOOST_CHECK(workers.contains(2));
+  BOOST_CHECK(workers.contains(70));
+  BOOST_CHECK(workers.contains(200));
+  BOOST_CHECK(!workers.contains(1));
+  BOOST_CHECK(!workers.contains(71));
+  BOOST_CHECK_EQUAL(workers.legacy_mask(), 0b10u);
+  BOOST_CHECK(workers != task::worker_set::single(70));
+  BOOST_CHECK(task::worker_set::single(70) == task::worker_set::single(70));
+}
+
+BOOST_AUTO_TEST_CASE(task_more_than_32_workers)
+{
+  constexpr std::size_t num_workers = 80;
+  for (auto mode : {task::scheduler_mode::global_queue,
+                    task::scheduler_mode::work_stealing})
+  {
+    std::atomic<std::uint32_t> counter = ATOMIC_VAR_INIT(0);
+    auto primary_task = [&]() {
+      // Run a task on each worker beyond the legacy limit.
+      auto results = task::multi_async(task::all_workers, [&]() {
+        ++counter;
+        return task::this_task::current_worker_id();
+      });
+      BOOST_CHECK_EQUAL(results.size(), num_workers);
+      for (std::size_t i = 0; i < results.size(); ++i)
+        BOOST_CHECK_EQUAL(results[i].get(), i + 1);
+
+      // Legacy masks still address the first 32 workers.
+      auto legacy_results = task::multi_async(
+        0b1010u, []() { return task::this_task::current_worker_id(); });
+      BOOST_CHECK_EQUAL(legacy_results.size(), 2u);
+      BOOST_CHECK_EQUAL(legacy_results[0].get(), 2u);
+      BOOST_CHECK_EQUAL(legacy_results[1].get(), 4u);
+      auto& scheduler = task::task_system::singleton_instance();
+      BOOST_CHECK_EQUAL(scheduler.num_workers(), num_workers);
+      BOOST_CHECK_GE(scheduler.num_worker_groups(), 1u);
+      return 0;
+    };
+    task::task_system scheduler;
+    scheduler.num_workers(num_workers)
+      .scheduler(mode)
+      .start(primary_task)
+      .join();
+    BOOST_CHECK_EQUAL(counter, num_workers);
+  }
+}
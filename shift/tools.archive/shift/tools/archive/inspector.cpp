@@ -0,0 +1,90 @@
+#include "shift/tools/archive/inspector.hpp"
+#include <shift/resource_db/archive_maintenance.hpp>
+#include <shift/log/log.hpp>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+namespace shift::tools::archive
+{
+std::vector<std::filesystem::path> inspector::archive_paths;
+bool inspector::compact;
+
+static const char* type_name(resource_db::resource_type type)
+{
+  using resource_db::resource_type;
+
+  switch (type)
+  {
+  case resource_type::resource_group:
+    return "resource_group";
+  case resource_type::buffer:
+    return "buffer";
+  case resource_type::font:
+    return "font";
+  case resource_type::mesh:
+    return "mesh";
+  case resource_type::image:
+    return "image";
+  case resource_type::shader:
+    return "shader";
+  case resource_type::material_descriptor:
+    return "material_descriptor";
+  case resource_type::material:
+    return "material";
+  case resource_type::scene:
+    return "scene";
+  default:
+    return "undefined";
+  }
+}
+
+static void print_report(const resource_db::archive_report& report)
+{
+  using std::chrono::duration;
+  using std::chrono::duration_cast;
+
+  std::cout << std::left << std::setw(20) << "type" << std::right
+            << std::setw(8) << "entries" << std::setw(8) << "zstd"
+            << std::setw(8) << "lz4" << std::setw(14) << "stored"
+            << std::setw(14) << "raw" << std::setw(8) << "ratio"
+            << std::setw(12) << "MB/s" << std::endl;
+  for (const auto& type : report.types)
+  {
+    auto seconds = duration_cast<duration<double>>(type.decode_time).count();
+    std::cout << std::left << std::setw(20) << type_name(type.type)
+              << std::right << std::setw(8) << type.entry_count
+              << std::setw(8) << type.zstd_count << std::setw(8)
+              << type.lz4_count << std::setw(14) << type.stored_size
+              << std::setw(14) << type.raw_size << std::fixed
+              << std::setprecision(2) << std::setw(8)
+              << (type.raw_size > 0 ? static_cast<double>(type.stored_size) /
+                                        static_cast<double>(type.raw_size)
+                                    : 1.0)
+              << std::setprecision(1) << std::setw(12)
+              << (seconds > 0.0 ? static_cast<double>(type.raw_size) /
+                                    seconds / 1.0e6
+                                : 0.0)
+              << std::endl;
+  }
+  std::cout << "free space: " << report.free_size << " bytes" << std::endl;
+}
+
+int inspector::run()
+{
+  int result = EXIT_SUCCESS;
+  for (const auto& archive_path : archive_paths)
+  {
+    if (compact && !resource_db::compact_archive(archive_path))
+    {
+      log::error() << "Cannot compact archive " << archive_path << ".";
+      result = EXIT_FAILURE;
+    }
+
+    std::cout << archive_path.generic_string() << ":" << std::endl;
+    print_report(resource_db::report_archive(archive_path));
+  }
+  return result;
+}
+}
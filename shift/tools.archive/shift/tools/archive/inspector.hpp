@@ -0,0 +1,23 @@
+#ifndef SHIFT_TOOLS_ARCHIVE_INSPECTOR_HPP
+#define SHIFT_TOOLS_ARCHIVE_INSPECTOR_HPP
+
+#include <vector>
+#include <filesystem>
+
+namespace shift::tools::archive
+{
+/// Prints storage statistics of resource_db archives and optionally compacts
+/// them.
+class inspector
+{
+public:
+  /// Main application routine.
+  int run();
+
+public:
+  static std::vector<std::filesystem::path> archive_paths;
+  static bool compact;
+};
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SHIFT_TOOLS_ARCHIVE_LAUNCHER_HPP
+#define SHIFT_TOOLS_ARCHIVE_LAUNCHER_HPP
+
+#include <boost/program_options.hpp>
+#include "shift/tools/archive/inspector.hpp"
+
+namespace shift::tools::archive
+{
+template <typename NextModule>
+class launcher : public NextModule
+{
+public:
+  using base_t = NextModule;
+
+  launcher(int argc, char* argv[]) : base_t(argc, argv)
+  {
+    namespace opt = boost::program_options;
+
+    base_t::_visible_options.add_options()(
+      "archive", opt::value(&inspector::archive_paths)->required(),
+      "Path to a resource_db archive file.");
+    base_t::_visible_options.add_options()(
+      "compact", opt::bool_switch(&inspector::compact)->default_value(false),
+      "Rewrites each archive without free space, ordering resources by "
+      "their dependencies, before printing its statistics.");
+    base_t::_positional_options.add("archive", -1);
+  }
+};
+}
+
+#endif
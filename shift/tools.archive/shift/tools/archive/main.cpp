@@ -0,0 +1,11 @@
+#include "shift/tools/archive/inspector.hpp"
+#include "shift/tools/archive/launcher.hpp"
+#include <shift/application/launcher.hpp>
+
+int main(int argc, char* argv[])
+{
+  using namespace shift;
+
+  application::launcher_t<tools::archive::launcher> launcher(argc, argv);
+  return launcher.execute([]() { return tools::archive::inspector{}.run(); });
+}
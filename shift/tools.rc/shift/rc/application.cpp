@@ -4,6 +4,7 @@
 #include <shift/core/exception.hpp>
 #include <shift/core/mpl.hpp>
 #include <shift/core/string_util.hpp>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <memory>
@@ -17,6 +18,11 @@ namespace rc
   std::filesystem::path program_options::output_path;
   std::string program_options::rules_filename;
   std::string program_options::cache_filename;
+  std::string program_options::cache_json_filename;
+  std::string program_options::trace_filename;
+  std::filesystem::path program_options::artifact_path;
+  std::uint64_t program_options::artifact_max_size;
+  std::uint32_t program_options::artifact_max_age;
   std::uint32_t program_options::verbose;
   std::string program_options::image_magick;
 
@@ -37,14 +43,23 @@ namespace rc
     _compiler.output_path(output_path);
     _compiler.verbose(verbose);
     _compiler.image_magick(image_magick);
+    if (!artifact_path.empty())
+      _compiler.artifact_path(artifact_path);
     auto cache_filepath = build_path / cache_filename;
     if (fs::exists(cache_filepath) && !_compiler.load_cache(cache_filepath))
       log::warning() << "Cannot read cache file " << cache_filepath;
     _compiler.load_rules(rules_filename);
     _compiler.update();
+    if (!trace_filename.empty())
+      _compiler.save_trace(build_path / trace_filename);
 
     _compiler.collect_garbage();
+    _compiler.collect_artifacts(
+      artifact_max_size * 1024 * 1024,
+      std::chrono::hours{24} * artifact_max_age);
     _compiler.save_cache(cache_filepath);
+    if (!cache_json_filename.empty())
+      _compiler.export_cache(build_path / cache_json_filename);
 
     return EXIT_SUCCESS;
   }
@@ -35,9 +35,33 @@ namespace rc
         "Name of rules json files to search for.");
 
       base_t::_visible_options.add_options()(
-        "cache,c", opt::value(&cache_filename)->default_value(".rc-cache.json"),
-        "Name of a cache json file used to store private data which is used to "
-        "improve performance of subsequent rc invocations.");
+        "cache,c", opt::value(&cache_filename)->default_value(".rc-cache"),
+        "Name of a binary cache file used to store private data which is used "
+        "to improve performance of subsequent rc invocations.");
+
+      base_t::_visible_options.add_options()(
+        "cache-json", opt::value(&cache_json_filename),
+        "Optional name of a file to additionally export the cache to in a "
+        "human readable json format.");
+
+      base_t::_visible_options.add_options()(
+        "trace", opt::value(&trace_filename),
+        "Optional name of a file to write the timing of all processed jobs "
+        "to, using the Chrome trace event format.");
+
+      base_t::_visible_options.add_options()(
+        "artifacts", opt::value(&artifact_path),
+        "Optional path to a content addressed store of job outputs, which may "
+        "be shared between multiple machines.");
+
+      base_t::_visible_options.add_options()(
+        "artifacts-max-size",
+        opt::value(&artifact_max_size)->default_value(10240),
+        "Maximum size of the artifact store in MiB.");
+
+      base_t::_visible_options.add_options()(
+        "artifacts-max-age", opt::value(&artifact_max_age)->default_value(30),
+        "Number of days after which unused artifacts are removed.");
 
       base_t::_visible_options.add_options()(
         "verbose,v", opt::value(&verbose)->default_value(0)->implicit_value(1),
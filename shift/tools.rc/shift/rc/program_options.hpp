@@ -14,6 +14,11 @@ namespace rc
     static std::filesystem::path output_path;
     static std::string rules_filename;
     static std::string cache_filename;
+    static std::string cache_json_filename;
+    static std::string trace_filename;
+    static std::filesystem::path artifact_path;
+    static std::uint64_t artifact_max_size;
+    static std::uint32_t artifact_max_age;
     static std::uint32_t verbose;
     static std::string image_magick;
   };